@@ -244,7 +244,7 @@ if (result.success) {
     // Update graph timers if intervals changed
     if (settings.sensors.graph_interval !== 30 && graphUpdateTimer) {
         clearInterval(graphUpdateTimer);
-        graphUpdateTimer = setInterval(updateGraphs, settings.sensors.graph_interval * 1000);
+        graphUpdateTimer = setInterval(refreshDashboard, settings.sensors.graph_interval * 1000);
     }
 } else {
     showAlert(`Failed to save settings: ${result.message}`, 'danger');
@@ -778,7 +778,9 @@ data.relays.forEach(relay => {/**
 let temperatureChart = null;
 let humidityChart = null;
 let sensorUpdateTimer = null;
+let liveEvents = null;
 let graphUpdateTimer = null;
+let dashboardEtag = null;
 let environmentalThresholds = {
 humidityLow: 50,
 humidityHigh: 85,
@@ -793,14 +795,16 @@ document.addEventListener('DOMContentLoaded', function() {
 // Initialize charts
 initializeCharts();
 
-// Load environmental thresholds
-loadEnvironmentalThresholds();
-
-// Setup relay controls
-loadRelayStatus();
-
-// Start sensor updates
-startSensorUpdates();
+// Thresholds, relays, sensors and graphs in one request, the separate endpoints are the fallback
+loadDashboard().then(loaded => {
+    if (!loaded) {
+        loadEnvironmentalThresholds();
+        loadRelayStatus();
+    }
+    
+    // Start sensor updates
+    startSensorUpdates(!loaded);
+});
 
 // Setup event listeners
 setupEventListeners();
@@ -910,6 +914,14 @@ data: {
             borderColor: '#9966ff',
             backgroundColor: 'rgba(153, 102, 255, 0.2)',
             fill: false
+        },
+        {
+            label: 'Tent',
+            data: [],
+            borderColor: '#ff9f40',
+            backgroundColor: 'rgba(255, 159, 64, 0.2)',
+            borderWidth: 3,
+            fill: false
         }
     ]
 },
@@ -955,6 +967,14 @@ data: {
             borderColor: '#9966ff',
             backgroundColor: 'rgba(153, 102, 255, 0.2)',
             fill: false
+        },
+        {
+            label: 'Tent',
+            data: [],
+            borderColor: '#ff9f40',
+            backgroundColor: 'rgba(255, 159, 64, 0.2)',
+            borderWidth: 3,
+            fill: false
         }
     ]
 },
@@ -976,19 +996,84 @@ options: {
 
 /**
 * Start the sensor update timers
+* @param {boolean} fetchNow - Fetch sensors and graphs right away (not needed after loadDashboard)
 */
-function startSensorUpdates() {
+function startSensorUpdates(fetchNow = true) {
 // Update sensors immediately
-updateSensors();
+if (fetchNow) {
+    updateSensors();
+}
 
-// Start sensor update timer (every 5 seconds)
-sensorUpdateTimer = setInterval(updateSensors, 5000);
+// Prefer pushed updates, fall back to polling every 5 seconds
+if (!startLiveUpdates()) {
+    sensorUpdateTimer = setInterval(updateSensors, 5000);
+}
 
 // Update graphs immediately
-updateGraphs();
+if (fetchNow) {
+    updateGraphs();
+}
 
 // Start graph update timer (every 30 seconds)
-graphUpdateTimer = setInterval(updateGraphs, 30000);
+graphUpdateTimer = setInterval(refreshDashboard, 30000);
+}
+
+/**
+* Subscribe to server-sent sensor and relay updates
+* @returns {boolean} - True if the browser supports EventSource
+*/
+function startLiveUpdates() {
+if (!window.EventSource) {
+    return false;
+}
+
+if (liveEvents) {
+    liveEvents.close();
+}
+liveEvents = new EventSource(API.EVENTS);
+
+liveEvents.addEventListener('sensors', event => {
+    renderSensors(JSON.parse(event.data));
+});
+
+liveEvents.addEventListener('relay', event => {
+    updateRelayFromEvent(JSON.parse(event.data));
+});
+
+// Poll while the stream is down, EventSource reconnects on its own
+liveEvents.onerror = () => {
+    if (!sensorUpdateTimer) {
+        sensorUpdateTimer = setInterval(updateSensors, 5000);
+    }
+};
+
+liveEvents.onopen = () => {
+    if (sensorUpdateTimer) {
+        clearInterval(sensorUpdateTimer);
+        sensorUpdateTimer = null;
+    }
+};
+
+return true;
+}
+
+/**
+* Apply a pushed relay change to its control
+* @param {Object} relay - Relay id, is_on and last_trigger
+*/
+function updateRelayFromEvent(relay) {
+const input = document.querySelector(`#relayControlsContainer input[data-relay-id="${relay.id}"]`);
+if (!input) {
+    return;
+}
+
+input.checked = relay.is_on;
+
+const status = input.closest('.relay-card').querySelector('.relay-status');
+if (status) {
+    const triggers = ['Manual', 'Schedule', 'Environmental', 'Dependency'];
+    status.textContent = triggers[relay.last_trigger] || 'Unknown';
+}
 }
 
 /**
@@ -996,8 +1081,18 @@ graphUpdateTimer = setInterval(updateGraphs, 30000);
 */
 async function updateSensors() {
 try {
-const data = await apiRequest(API.SENSORS);
+const data = decodeSensorData(await apiRequestBinary(API.SENSORS));
+renderSensors(data);
+} catch (error) {
+console.error('Failed to update sensors:', error);
+}
+}
 
+/**
+* Render sensor readings into the sensor cards
+* @param {Object} data - Readings in the /api/sensors/data layout
+*/
+function renderSensors(data) {
 // Update Upper DHT
 if (data.upper_dht.valid) {
     document.getElementById('upperDhtTemp').innerHTML = `${data.upper_dht.temperature.toFixed(1)} <span class="sensor-unit">°C</span>`;
@@ -1048,10 +1143,6 @@ if (data.scd.valid) {
     document.getElementById('scdHumidity').innerHTML = `-- <span class="sensor-unit">%</span>`;
     document.getElementById('scdCo2').innerHTML = `-- <span class="sensor-unit">ppm</span>`;
 }
-
-} catch (error) {
-console.error('Failed to update sensors:', error);
-}
 }
 
 /**
@@ -1060,12 +1151,12 @@ console.error('Failed to update sensors:', error);
 async function updateGraphs() {
 try {
 // Update temperature graph
-const tempData = await apiRequest(`${API.GRAPH}?type=0&points=100`);
+const tempData = decodeGraphData(await apiRequestBinary(`${API.GRAPH}?type=0&points=100`));
 updateGraph(temperatureChart, tempData);
 flashUpdateIndicator(document.getElementById('tempUpdateIndicator'));
 
 // Update humidity graph
-const humidityData = await apiRequest(`${API.GRAPH}?type=1&points=100`);
+const humidityData = decodeGraphData(await apiRequestBinary(`${API.GRAPH}?type=1&points=100`));
 updateGraph(humidityChart, humidityData);
 flashUpdateIndicator(document.getElementById('humidityUpdateIndicator'));
 
@@ -1093,6 +1184,7 @@ chart.data.labels = formattedLabels;
 chart.data.datasets[0].data = data.upper_dht;
 chart.data.datasets[1].data = data.lower_dht;
 chart.data.datasets[2].data = data.scd;
+chart.data.datasets[3].data = data.tent;
 
 // Update the chart
 chart.update();
@@ -1121,12 +1213,71 @@ humidityChart.update();
 showAlert('Graphs cleared successfully', 'success', 3000);
 }
 
+/**
+* Load the whole dashboard from /api/dashboard
+*
+* The response carries an ETag made of one tag per section. Sending it back
+* makes the server leave out the sections that did not change, or answer
+* 304 when none did.
+* @returns {Promise<boolean>} - True if the dashboard is up to date
+*/
+async function loadDashboard() {
+try {
+await ensureSession();
+const response = await fetch(API.DASHBOARD, {
+    headers: dashboardEtag ? { 'If-None-Match': dashboardEtag } : {}
+});
+
+if (response.status === 304) {
+    return true;
+}
+if (!response.ok) {
+    throw new Error(`HTTP error ${response.status}: ${response.statusText}`);
+}
+
+const data = await response.json();
+dashboardEtag = response.headers.get('ETag');
+
+// Thresholds first, the sensor cards are colored by them
+if (data.thresholds) {
+    environmentalThresholds = data.thresholds;
+}
+if (data.sensors) {
+    renderSensors(data.sensors);
+}
+if (data.relays) {
+    loadRelayStatus(data.relays);
+}
+if (data.graphs) {
+    updateGraph(temperatureChart, data.graphs.temperature);
+    flashUpdateIndicator(document.getElementById('tempUpdateIndicator'));
+    updateGraph(humidityChart, data.graphs.humidity);
+    flashUpdateIndicator(document.getElementById('humidityUpdateIndicator'));
+}
+return true;
+} catch (error) {
+console.error('Failed to load dashboard:', error);
+dashboardEtag = null;
+return false;
+}
+}
+
+/**
+* Periodic refresh, only changed sections are transferred
+*/
+async function refreshDashboard() {
+if (!(await loadDashboard())) {
+    updateGraphs();
+}
+}
+
 /**
 * Load and display the current relay status
+* @param {Object} status - Relay status already fetched by loadDashboard, fetched here if omitted
 */
-async function loadRelayStatus() {
+async function loadRelayStatus(status = null) {
 try {
-const data = await apiRequest(API.RELAYS);
+const data = status || await apiRequest(API.RELAYS);
 
 // Clear existing relay controls
 const relayContainer = document.getElementById('relayControlsContainer');
@@ -5,8 +5,10 @@
 
 // API endpoints
 const API = {
+    DASHBOARD: '/api/dashboard',
     SENSORS: '/api/sensors/data',
     GRAPH: '/api/sensors/graph',
+    EVENTS: '/api/events',
     RELAYS: '/api/relays/status',
     RELAY_SET: '/api/relays/set',
     SETTINGS: '/api/settings',
@@ -29,10 +31,12 @@ const API = {
     PROFILE_EXPORT: '/api/profiles/export',
     PROFILE_IMPORT: '/api/profiles/import',
     CONFIG_SAVE: '/api/config/save',
+    SESSION: '/api/auth/session',
 };
 
 // Global variables
 let darkMode = localStorage.getItem('darkMode') === 'true';
+let sessionRequest = null;
 
 // Initialize theme based on saved preference
 document.addEventListener('DOMContentLoaded', function() {
@@ -136,6 +140,19 @@ function showAlert(message, type = 'info', duration = 5000) {
     }
 }
 
+/**
+ * Open a session once per page load. Afterwards the browser sends the
+ * session cookie and the device skips the password check; if this fails,
+ * requests simply keep using Basic auth.
+ * @returns {Promise} - Resolves when the attempt is done
+ */
+function ensureSession() {
+    if (!sessionRequest) {
+        sessionRequest = fetch(API.SESSION, { method: 'POST' }).catch(() => null);
+    }
+    return sessionRequest;
+}
+
 /**
  * Make an API request
  * @param {string} endpoint - API endpoint to call
@@ -156,6 +173,7 @@ async function apiRequest(endpoint, method = 'GET', data = null) {
     }
     
     try {
+        await ensureSession();
         const response = await fetch(endpoint, options);
         
         // Check for HTTP errors
@@ -172,6 +190,89 @@ async function apiRequest(endpoint, method = 'GET', data = null) {
     }
 }
 
+/**
+ * Get WiFi scan results, polling while the device scans in the background
+ * @param {boolean} refresh - Start a new scan even if the cached results are fresh
+ * @returns {Promise<Object>} - Scan response
+ */
+async function fetchWiFiScan(refresh = false) {
+    let result = await apiRequest(API.WIFI_SCAN + (refresh ? '?refresh=1' : ''));
+
+    for (let attempt = 0; result.scanning && attempt < 20; attempt++) {
+        await new Promise(resolve => setTimeout(resolve, 1000));
+        result = await apiRequest(API.WIFI_SCAN);
+    }
+
+    return result;
+}
+
+/**
+ * Make a GET request that returns the compact binary encoding
+ * @param {string} endpoint - API endpoint (format=bin is appended)
+ * @returns {Promise<ArrayBuffer>} - Raw response body
+ */
+async function apiRequestBinary(endpoint) {
+    const url = endpoint + (endpoint.includes('?') ? '&' : '?') + 'format=bin';
+    await ensureSession();
+    const response = await fetch(url, {
+        headers: {
+            'Accept': 'application/octet-stream'
+        }
+    });
+
+    if (!response.ok) {
+        throw new Error(`HTTP error ${response.status}: ${response.statusText}`);
+    }
+
+    return response.arrayBuffer();
+}
+
+/**
+ * Decode a binary /api/sensors/data response into the JSON layout
+ * @param {ArrayBuffer} buffer - Float32[15] values followed by a uint32 validity mask
+ * @returns {Object} - Same shape as the JSON response
+ */
+function decodeSensorData(buffer) {
+    const v = new Float32Array(buffer, 0, 15);
+    const mask = new Uint32Array(buffer, 60, 1)[0];
+
+    return {
+        upper_dht: { temperature: v[0], humidity: v[1], valid: (mask & 1) !== 0 },
+        lower_dht: { temperature: v[2], humidity: v[3], valid: (mask & 2) !== 0 },
+        scd: { temperature: v[4], humidity: v[5], co2: v[6], valid: (mask & 4) !== 0 },
+        average: { temperature: v[7], humidity: v[8] },
+        thresholds: {
+            humidity_low: v[9],
+            humidity_high: v[10],
+            temperature_low: v[11],
+            temperature_high: v[12],
+            co2_low: v[13],
+            co2_high: v[14]
+        }
+    };
+}
+
+/**
+ * Decode a binary /api/sensors/graph response into the JSON layout
+ * @param {ArrayBuffer} buffer - uint32 count and resolution, three Float32 series, Uint32 timestamps
+ * @returns {Object} - Same shape as the JSON response (NaN gaps become null)
+ */
+function decodeGraphData(buffer) {
+    const header = new Uint32Array(buffer, 0, 2);
+    const count = header[0];
+    const series = (index) => Array.from(new Float32Array(buffer, 8 + index * count * 4, count),
+                                         value => isNaN(value) ? null : value);
+
+    return {
+        upper_dht: series(0),
+        lower_dht: series(1),
+        scd: series(2),
+        tent: series(3),
+        timestamps: Array.from(new Uint32Array(buffer, 8 + 4 * count * 4, count)),
+        resolution: header[1]
+    };
+}
+
 /**
  * Format a timestamp for display
  * @param {number} timestamp - Timestamp in seconds
@@ -72,7 +72,7 @@ function setupNetworkHandlers() {
         refreshWifiScanBtn.addEventListener('click', function() {
             // Get current scan target
             const index = parseInt(document.getElementById('wifiScanModal').dataset.scanTarget || '1');
-            scanWiFi(index);
+            scanWiFi(index, true);
         });
     }
 
@@ -233,8 +233,9 @@ async function saveNetworkConfig() {
 /**
  * Scan for WiFi networks
  * @param {number} index - WiFi credential index (1-3)
+ * @param {boolean} refresh - Ignore cached results
  */
-async function scanWiFi(index) {
+async function scanWiFi(index, refresh = false) {
     // Store current scan target
     document.getElementById('wifiScanModal').dataset.scanTarget = index;
     
@@ -246,7 +247,7 @@ async function scanWiFi(index) {
     document.getElementById('wifiNetworksList').style.display = 'none';
     
     try {
-        const result = await apiRequest(API.WIFI_SCAN);
+        const result = await fetchWiFiScan(refresh);
         
         // Hide scanning message
         document.getElementById('scanningMessage').style.display = 'none';
@@ -0,0 +1,57 @@
+"""
+Gzip the web UI in data/ before the filesystem image is built.
+
+StaticAssetHandler serves "<file>.gz" in place of "<file>" when the browser
+accepts gzip. Only files that changed since their .gz was written are
+compressed again, and the gzip header carries no timestamp, so the image stays
+reproducible. Each file also gets a "<file>.etag" holding a hash of its
+content, which the handler sends as the file's ETag.
+"""
+
+import gzip
+import hashlib
+import os
+import shutil
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+EXTENSIONS = (".html", ".css", ".js")
+
+
+def write_etag(source):
+    # Same hash as the .gz content, both come from the uncompressed source
+    with open(source, "rb") as src:
+        tag = hashlib.sha1(src.read()).hexdigest()[:16]
+
+    target = source + ".etag"
+    if os.path.exists(target):
+        with open(target, "r") as existing:
+            if existing.read() == tag:
+                return
+    with open(target, "w") as dst:
+        dst.write(tag)
+
+
+def compress_assets(data_dir):
+    for root, _, files in os.walk(data_dir):
+        for name in files:
+            if not name.endswith(EXTENSIONS):
+                continue
+
+            source = os.path.join(root, name)
+            target = source + ".gz"
+            if os.path.getsize(source) == 0:
+                continue
+            write_etag(source)
+            if os.path.exists(target) and os.path.getmtime(target) >= os.path.getmtime(source):
+                continue
+
+            with open(source, "rb") as src, open(target, "wb") as raw:
+                with gzip.GzipFile(filename="", mode="wb", fileobj=raw, compresslevel=9, mtime=0) as dst:
+                    shutil.copyfileobj(src, dst)
+
+            print("Compressed %s: %d -> %d bytes" % (
+                os.path.relpath(source, data_dir), os.path.getsize(source), os.path.getsize(target)))
+
+
+compress_assets(env.subst("$PROJECT_DATA_DIR"))  # noqa: F821
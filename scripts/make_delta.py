@@ -0,0 +1,90 @@
+"""
+Build a delta OTA patch from the firmware a device runs to a new build.
+
+    python scripts/make_delta.py old_firmware.bin new_firmware.bin firmware.delta
+
+The patch is the "TDL1" stream OTAManager::streamDelta() applies: COPY
+records take bytes from the running partition, INSERT records carry new
+bytes. It prints the "delta" object for the update manifest. source_sha256
+is the digest esp_partition_get_sha256() reports for the old image, which is
+the SHA-256 the build appends to the image.
+"""
+
+import hashlib
+import json
+import struct
+import sys
+
+MAGIC = b"TDL1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+BLOCK = 32     # Shortest run worth a COPY record
+STEP = 4       # Source positions indexed, code is mostly word aligned
+
+
+def image_digest(image):
+    # Images carry the SHA-256 of everything before it in their last 32 bytes
+    if len(image) > 32 and hashlib.sha256(image[:-32]).digest() == image[-32:]:
+        return image[-32:]
+    return hashlib.sha256(image).digest()
+
+
+def build_delta(source, target):
+    index = {}
+    for offset in range(0, len(source) - BLOCK + 1, STEP):
+        index.setdefault(source[offset:offset + BLOCK], offset)
+
+    out = bytearray(MAGIC + struct.pack("<I", len(target)))
+    pending = bytearray()
+
+    def flush_insert():
+        if pending:
+            out.extend(struct.pack("<BI", OP_INSERT, len(pending)))
+            out.extend(pending)
+            pending.clear()
+
+    position = 0
+    while position < len(target):
+        offset = index.get(target[position:position + BLOCK])
+        if offset is None:
+            pending.append(target[position])
+            position += 1
+            continue
+
+        length = BLOCK
+        while (position + length < len(target) and offset + length < len(source)
+               and target[position + length] == source[offset + length]):
+            length += 1
+
+        flush_insert()
+        out.extend(struct.pack("<BII", OP_COPY, offset, length))
+        position += length
+
+    flush_insert()
+    out.append(OP_END)
+    return bytes(out)
+
+
+def main(argv):
+    if len(argv) != 4:
+        print(__doc__.strip())
+        return 1
+
+    with open(argv[1], "rb") as f:
+        source = f.read()
+    with open(argv[2], "rb") as f:
+        target = f.read()
+
+    delta = build_delta(source, target)
+    with open(argv[3], "wb") as f:
+        f.write(delta)
+
+    print("Delta: %d bytes for a %d byte image (%.1f%%)" % (len(delta), len(target), 100.0 * len(delta) / len(target)))
+    print(json.dumps({"url": "<where firmware.delta is served>", "source_sha256": image_digest(source).hex()}, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
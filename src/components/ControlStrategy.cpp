@@ -0,0 +1,156 @@
+/**
+ * @file ControlStrategy.cpp
+ * @brief Implementation of the ControlLoop class
+ */
+
+ #include "ControlStrategy.h"
+
+ ControlLoop::ControlLoop() :
+     _integral(0.0f),
+     _lastMeasurement(0.0f),
+     _output(0.0f),
+     _lastUpdateMs(0),
+     _windowStartMs(0),
+     _hasState(false),
+     _lastIsOn(false),
+     _lastSwitchMs(0),
+     _hasSwitched(false)
+ {
+ }
+
+ void ControlLoop::configure(const ControlSettings& settings) {
+     _settings = settings;
+     if (_settings.windowSeconds == 0) {
+         _settings.windowSeconds = Constants::DEFAULT_CONTROL_WINDOW_SECONDS;
+     }
+     reset();
+ }
+
+ bool ControlLoop::update(float measurement, float low, float high, bool isOn, uint32_t nowMs) {
+     // Track switches made by anyone (dependencies, overrides) for the dwell timer
+     if (isOn != _lastIsOn) {
+         _lastIsOn = isOn;
+         _lastSwitchMs = nowMs;
+         _hasSwitched = true;
+     }
+
+     // No usable reading, the loop starts over with the next one
+     if (isnan(measurement)) {
+         reset();
+         return isOn;
+     }
+
+     bool desired;
+     if (_settings.mode == ControlMode::PID) {
+         desired = timeProportional(measurement, (low + high) / 2.0f, nowMs);
+     } else {
+         desired = hysteresis(measurement, low, high, isOn);
+     }
+
+     return applyDwell(desired, isOn, nowMs);
+ }
+
+ uint32_t ControlLoop::msUntilNextChange(uint32_t nowMs) const {
+     uint32_t next = UINT32_MAX;
+
+     if (_settings.mode == ControlMode::PID && _hasState) {
+         uint32_t windowMs = static_cast<uint32_t>(_settings.windowSeconds) * 1000;
+         uint32_t elapsed = nowMs - _windowStartMs;
+         uint32_t onMs = static_cast<uint32_t>(_output * windowMs);
+
+         // End of the ON slice, otherwise the start of the next window. A window
+         // that passed without an update() has nothing due until a new reading.
+         if (elapsed < onMs) {
+             next = onMs - elapsed;
+         } else if (elapsed < windowMs) {
+             next = windowMs - elapsed;
+         }
+     }
+
+     if (_hasSwitched) {
+         uint32_t dwellMs = static_cast<uint32_t>(_lastIsOn ? _settings.minOnSeconds : _settings.minOffSeconds) * 1000;
+         uint32_t elapsed = nowMs - _lastSwitchMs;
+         if (elapsed < dwellMs) {
+             next = min(next, dwellMs - elapsed);
+         }
+     }
+
+     return next;
+ }
+
+ void ControlLoop::reset() {
+     _integral = 0.0f;
+     _output = 0.0f;
+     _hasState = false;
+ }
+
+ bool ControlLoop::hysteresis(float measurement, float low, float high, bool isOn) {
+     if (measurement < low) {
+         _output = 1.0f;
+     } else if (measurement >= high) {
+         _output = 0.0f;
+     } else {
+         // Between thresholds, maintain current state
+         _output = isOn ? 1.0f : 0.0f;
+     }
+     return _output > 0.5f;
+ }
+
+ bool ControlLoop::timeProportional(float measurement, float setpoint, uint32_t nowMs) {
+     uint32_t windowMs = static_cast<uint32_t>(_settings.windowSeconds) * 1000;
+
+     // Restart after a long gap (outside the operating window, sensor outage)
+     if (_hasState && nowMs - _lastUpdateMs > windowMs) {
+         reset();
+     }
+
+     if (!_hasState) {
+         _lastMeasurement = measurement;
+         _lastUpdateMs = nowMs;
+         _windowStartMs = nowMs;
+         _hasState = true;
+     }
+
+     float dt = (nowMs - _lastUpdateMs) / 1000.0f;
+     float error = setpoint - measurement;
+
+     // Derivative on measurement so setpoint changes do not kick the output
+     float derivative = 0.0f;
+     if (dt > 0.0f) {
+         _integral += _settings.ki * error * dt;
+         derivative = -_settings.kd * (measurement - _lastMeasurement) / dt;
+     }
+
+     // Clamp the integrator to the output range (anti-windup)
+     _integral = constrain(_integral, 0.0f, 1.0f);
+
+     _lastMeasurement = measurement;
+     _lastUpdateMs = nowMs;
+
+     // Start a new window when the previous one has elapsed, the output is
+     // only resampled there so the relay switches at most twice per window
+     uint32_t elapsed = nowMs - _windowStartMs;
+     if (elapsed >= windowMs || elapsed == 0) {
+         if (elapsed >= windowMs) {
+             _windowStartMs += (elapsed / windowMs) * windowMs;
+             elapsed = nowMs - _windowStartMs;
+         }
+         _output = constrain(_settings.kp * error + _integral + derivative, 0.0f, 1.0f);
+     }
+
+     return elapsed < static_cast<uint32_t>(_output * windowMs);
+ }
+
+ bool ControlLoop::applyDwell(bool desired, bool isOn, uint32_t nowMs) {
+     if (desired == isOn || !_hasSwitched) {
+         return desired;
+     }
+
+     // Hold the current state until its minimum dwell has passed
+     uint32_t dwellMs = static_cast<uint32_t>(isOn ? _settings.minOnSeconds : _settings.minOffSeconds) * 1000;
+     if (nowMs - _lastSwitchMs < dwellMs) {
+         return isOn;
+     }
+
+     return desired;
+ }
@@ -0,0 +1,123 @@
+/**
+ * @file ControlStrategy.h
+ * @brief Per-relay environmental control strategies (bang-bang with deadband, time-proportional PID)
+ */
+
+ #ifndef CONTROL_STRATEGY_H
+ #define CONTROL_STRATEGY_H
+
+ #include <Arduino.h>
+ #include "../utils/Constants.h"
+
+ /**
+  * @enum ControlMode
+  * @brief How an environmental relay turns a reading into an on/off decision
+  */
+ enum class ControlMode : uint8_t {
+     HYSTERESIS = 0,  // ON below the low threshold, OFF at the high threshold
+     PID              // Time-proportional PID around the middle of the band
+ };
+
+ /**
+  * @struct ControlSettings
+  * @brief Tuning for one environmental relay
+  *
+  * The setpoints themselves are the profile's environmental thresholds; these
+  * settings only choose how the relay tracks them.
+  */
+ struct ControlSettings {
+     ControlMode mode;
+     float kp;                // Duty cycle per unit of error (0.1 = 10% per °C or %RH)
+     float ki;                // Duty cycle per unit of error per second
+     float kd;                // Duty cycle per unit/second of measurement change
+     uint16_t windowSeconds;  // PID output period
+     uint16_t minOnSeconds;   // Minimum dwell after switching ON
+     uint16_t minOffSeconds;  // Minimum dwell after switching OFF
+
+     ControlSettings() :
+         mode(ControlMode::HYSTERESIS),
+         kp(Constants::DEFAULT_CONTROL_KP),
+         ki(Constants::DEFAULT_CONTROL_KI),
+         kd(Constants::DEFAULT_CONTROL_KD),
+         windowSeconds(Constants::DEFAULT_CONTROL_WINDOW_SECONDS),
+         minOnSeconds(Constants::DEFAULT_CONTROL_MIN_ON_SECONDS),
+         minOffSeconds(Constants::DEFAULT_CONTROL_MIN_OFF_SECONDS) {}
+ };
+
+ /**
+  * @class ControlLoop
+  * @brief Stateful controller for a single relay that raises the measured value while ON
+  *
+  * HYSTERESIS is the classic band: switch ON below the low threshold, OFF at
+  * or above the high threshold, hold the current state in between. PID aims
+  * for the middle of the band and converts its 0..1 output into an ON slice at
+  * the start of every window, so the relay switches at most twice per window.
+  * Both modes honour the minimum ON/OFF dwell, which is what prevents short
+  * cycling when a reading jitters around a threshold. The loop is not
+  * thread-safe; callers are expected to hold their own lock.
+  */
+ class ControlLoop {
+ public:
+     ControlLoop();
+
+     /**
+      * @brief Replace the tuning and restart the controller
+      * @param settings New control settings
+      */
+     void configure(const ControlSettings& settings);
+
+     const ControlSettings& getSettings() const { return _settings; }
+
+     /**
+      * @brief Decide the relay state for a new measurement
+      * @param measurement Current reading (°C or %RH)
+      * @param low Low threshold from the active profile
+      * @param high High threshold from the active profile
+      * @param isOn Current relay state
+      * @param nowMs Current millis()
+      * @return True if the relay should be ON
+      */
+     bool update(float measurement, float low, float high, bool isOn, uint32_t nowMs);
+
+     /**
+      * @brief Get how long until the decision may change without a new measurement
+      * @param nowMs Current millis()
+      * @return Milliseconds until the next PID slice edge or dwell expiry, UINT32_MAX if none
+      *         (also for a reset loop or a window that passed without an update())
+      */
+     uint32_t msUntilNextChange(uint32_t nowMs) const;
+
+     /**
+      * @brief Drop integrator and window state (e.g. outside the operating window)
+      */
+     void reset();
+
+     /**
+      * @brief Get the last PID output
+      * @return Duty cycle 0..1 (1 or 0 in HYSTERESIS mode)
+      */
+     float getOutput() const { return _output; }
+
+ private:
+     ControlSettings _settings;
+
+     // PID state
+     float _integral;
+     float _lastMeasurement;
+     float _output;
+     uint32_t _lastUpdateMs;
+     uint32_t _windowStartMs;
+     bool _hasState;
+
+     // Dwell tracking
+     bool _lastIsOn;
+     uint32_t _lastSwitchMs;
+     bool _hasSwitched;
+
+     // Private methods
+     bool hysteresis(float measurement, float low, float high, bool isOn);
+     bool timeProportional(float measurement, float setpoint, uint32_t nowMs);
+     bool applyDwell(bool desired, bool isOn, uint32_t nowMs);
+ };
+
+ #endif // CONTROL_STRATEGY_H
@@ -0,0 +1,218 @@
+/**
+ * @file Dht22Rmt.cpp
+ * @brief Implementation of the Dht22Rmt class
+ */
+
+ #include "Dht22Rmt.h"
+ #include <driver/gpio.h>
+ #include <freertos/ringbuf.h>
+ 
+ namespace {
+     const uint8_t DHT_CLOCK_DIVIDER = 80;            // 1 µs ticks from the 80 MHz APB clock
+     const uint8_t DHT_FILTER_APB_TICKS = 100;        // Ignore glitches shorter than 1.25 µs
+     const uint16_t DHT_IDLE_THRESHOLD_US = 100;      // Longest level in a reply is 80 µs
+     const size_t DHT_RING_BUFFER_SIZE = 512;         // One frame is about 43 items of 4 bytes
+     const uint32_t DHT_START_SIGNAL_MS = 3;          // Datasheet asks for at least 1 ms low
+     const uint32_t DHT_CAPTURE_TIMEOUT_MS = 20;      // A frame takes about 5 ms
+     const uint32_t DHT_MIN_INTERVAL_MS = 2000;       // Sensor needs 2 s between conversions
+     const uint8_t DHT_DATA_BITS = 40;
+     const uint16_t DHT_ONE_THRESHOLD_US = 50;        // High pulse is ~27 µs for a 0, ~70 µs for a 1
+     const uint16_t DHT_MAX_BIT_US = 100;
+     const size_t DHT_MAX_HIGH_PULSES = 64;
+ }
+ 
+ Dht22Rmt::Dht22Rmt(uint8_t pin, rmt_channel_t channel) :
+     _pin(pin),
+     _channel(channel),
+     _installed(false),
+     _mutex(nullptr),
+     _temperature(NAN),
+     _humidity(NAN),
+     _lastReadMs(0),
+     _hasReading(false)
+ {
+ }
+ 
+ Dht22Rmt::~Dht22Rmt() {
+     end();
+     
+     if (_mutex != nullptr) {
+         vSemaphoreDelete(_mutex);
+     }
+ }
+ 
+ bool Dht22Rmt::begin(uint8_t pin) {
+     if (_mutex == nullptr) {
+         _mutex = xSemaphoreCreateMutex();
+         if (_mutex == nullptr) {
+             return false;
+         }
+     }
+     
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (_installed) {
+             rmt_driver_uninstall(_channel);
+             _installed = false;
+         }
+         
+         _pin = pin;
+         _hasReading = false;
+         
+         gpio_num_t gpio = static_cast<gpio_num_t>(pin);
+         rmt_config_t config = RMT_DEFAULT_CONFIG_RX(gpio, _channel);
+         config.clk_div = DHT_CLOCK_DIVIDER;
+         config.mem_block_num = 1;
+         config.rx_config.filter_en = true;
+         config.rx_config.filter_ticks_thresh = DHT_FILTER_APB_TICKS;
+         config.rx_config.idle_threshold = DHT_IDLE_THRESHOLD_US;
+         
+         if (rmt_config(&config) == ESP_OK &&
+             rmt_driver_install(_channel, DHT_RING_BUFFER_SIZE, 0) == ESP_OK) {
+             // Open drain output for the start signal, the RMT keeps listening on the same pad
+             gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+             gpio_set_direction(gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+             gpio_set_level(gpio, 1);
+             
+             _installed = true;
+             success = true;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_mutex);
+     }
+     
+     return success;
+ }
+ 
+ void Dht22Rmt::end() {
+     if (_mutex == nullptr) {
+         return;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (_installed) {
+             rmt_driver_uninstall(_channel);
+             _installed = false;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_mutex);
+     }
+ }
+ 
+ bool Dht22Rmt::read(float& temperature, float& humidity, bool force) {
+     if (_mutex == nullptr) {
+         return false;
+     }
+     
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t now = millis();
+         
+         if (!force && _hasReading && now - _lastReadMs < DHT_MIN_INTERVAL_MS) {
+             // Too soon for a new conversion, report the last one
+             success = true;
+         } else {
+             uint8_t data[5];
+             if (_installed && capture(data)) {
+                 _humidity = ((data[0] << 8) | data[1]) * 0.1f;
+                 _temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+                 if (data[2] & 0x80) {
+                     _temperature = -_temperature;
+                 }
+                 
+                 _lastReadMs = now;
+                 _hasReading = true;
+                 success = true;
+             }
+         }
+         
+         if (success) {
+             temperature = _temperature;
+             humidity = _humidity;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_mutex);
+     }
+     
+     return success;
+ }
+ 
+ bool Dht22Rmt::capture(uint8_t data[5]) {
+     RingbufHandle_t ringBuffer = nullptr;
+     if (rmt_get_ringbuf_handle(_channel, &ringBuffer) != ESP_OK || ringBuffer == nullptr) {
+         return false;
+     }
+     
+     // Drop anything left from an earlier, timed out capture
+     size_t size = 0;
+     void* stale;
+     while ((stale = xRingbufferReceive(ringBuffer, &size, 0)) != nullptr) {
+         vRingbufferReturnItem(ringBuffer, stale);
+     }
+     
+     gpio_num_t gpio = static_cast<gpio_num_t>(_pin);
+     
+     // Start signal, the task sleeps while the line is held low
+     gpio_set_level(gpio, 0);
+     vTaskDelay(pdMS_TO_TICKS(DHT_START_SIGNAL_MS));
+     
+     // Receive before releasing the line, the reply starts 20-40 µs later
+     rmt_rx_start(_channel, true);
+     gpio_set_level(gpio, 1);
+     
+     rmt_item32_t* items = static_cast<rmt_item32_t*>(
+         xRingbufferReceive(ringBuffer, &size, pdMS_TO_TICKS(DHT_CAPTURE_TIMEOUT_MS)));
+     rmt_rx_stop(_channel);
+     
+     if (items == nullptr) {
+         return false;
+     }
+     
+     bool success = decode(items, size / sizeof(rmt_item32_t), data);
+     vRingbufferReturnItem(ringBuffer, items);
+     return success;
+ }
+ 
+ bool Dht22Rmt::decode(const rmt_item32_t* items, size_t count, uint8_t data[5]) {
+     // Only the high pulses carry information. The last 40 are the data
+     // bits, the ones before them are the line release and the 80 µs response.
+     uint16_t highs[DHT_MAX_HIGH_PULSES];
+     size_t highCount = 0;
+     
+     for (size_t i = 0; i < count && highCount < DHT_MAX_HIGH_PULSES; i++) {
+         if (items[i].level0 == 1 && items[i].duration0 > 0) {
+             highs[highCount++] = items[i].duration0;
+         }
+         if (items[i].level1 == 1 && items[i].duration1 > 0 && highCount < DHT_MAX_HIGH_PULSES) {
+             highs[highCount++] = items[i].duration1;
+         }
+     }
+     
+     if (highCount < DHT_DATA_BITS) {
+         return false;
+     }
+     
+     memset(data, 0, 5);
+     const uint16_t* bits = highs + (highCount - DHT_DATA_BITS);
+     for (uint8_t i = 0; i < DHT_DATA_BITS; i++) {
+         if (bits[i] > DHT_MAX_BIT_US) {
+             return false;
+         }
+         
+         data[i / 8] <<= 1;
+         if (bits[i] > DHT_ONE_THRESHOLD_US) {
+             data[i / 8] |= 1;
+         }
+     }
+     
+     // Checksum is the low byte of the sum of the four data bytes
+     return data[4] == static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]);
+ }
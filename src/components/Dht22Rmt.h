@@ -0,0 +1,73 @@
+/**
+ * @file Dht22Rmt.h
+ * @brief DHT22 driver that captures the sensor's pulse train with the RMT peripheral
+ */
+
+ #ifndef DHT22_RMT_H
+ #define DHT22_RMT_H
+
+ #include <Arduino.h>
+ #include <driver/rmt.h>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/semphr.h>
+
+ /**
+  * @class Dht22Rmt
+  * @brief Reads a DHT22 without bit-banging or disabling interrupts
+  *
+  * The start signal is a plain GPIO low pulse with the task blocked, after
+  * which an RMT receive channel records the sensor's 40 bit reply in
+  * hardware while the task waits on the ring buffer. Decoding works on the
+  * captured durations, so nothing in a read is timing critical for the CPU.
+  * One read yields temperature and humidity; reads closer together than the
+  * sensor's 2 s minimum return the previous values. Reads of one instance
+  * are serialized by its own mutex.
+  */
+ class Dht22Rmt {
+ public:
+     /**
+      * @param pin Data pin
+      * @param channel RMT channel, one per sensor
+      */
+     Dht22Rmt(uint8_t pin, rmt_channel_t channel);
+     ~Dht22Rmt();
+
+     /**
+      * @brief Install the RMT receiver on a pin, reinstalling it if already running
+      * @param pin Data pin
+      * @return True if the channel is ready
+      */
+     bool begin(uint8_t pin);
+
+     /**
+      * @brief Release the RMT channel
+      */
+     void end();
+
+     /**
+      * @brief Read temperature and humidity
+      * @param temperature Output in °C
+      * @param humidity Output in %RH
+      * @param force Capture even if the last read is less than 2 s old
+      * @return True with a checksum-valid reading
+      */
+     bool read(float& temperature, float& humidity, bool force = false);
+
+ private:
+     uint8_t _pin;
+     rmt_channel_t _channel;
+     bool _installed;
+     SemaphoreHandle_t _mutex;
+
+     // Last good reading, returned for reads inside the minimum interval
+     float _temperature;
+     float _humidity;
+     uint32_t _lastReadMs;
+     bool _hasReading;
+
+     // Private methods
+     bool capture(uint8_t data[5]);
+     static bool decode(const rmt_item32_t* items, size_t count, uint8_t data[5]);
+ };
+
+ #endif // DHT22_RMT_H
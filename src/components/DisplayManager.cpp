@@ -0,0 +1,305 @@
+/**
+ * @file DisplayManager.cpp
+ * @brief Implementation of the DisplayManager class
+ */
+
+ #include "DisplayManager.h"
+ #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+ #include <Wire.h>
+ 
+ namespace {
+     const uint8_t SSD1306_CONTROL_COMMANDS = 0x00;   // Control byte: the rest of the transfer is commands
+     const uint8_t SSD1306_CONTROL_DATA = 0x40;       // Control byte: the rest of the transfer is display RAM
+     const uint8_t RELAY_COUNT = 8;
+ }
+ 
+ DisplayManager::DisplayManager() :
+     _display(Constants::DISPLAY_WIDTH, Constants::DISPLAY_HEIGHT, &Wire, -1,
+              Constants::DISPLAY_I2C_CLOCK_HZ, Constants::DISPLAY_I2C_CLOCK_HZ),
+     _stalePages(0xFF),
+     _isAvailable(false),
+     _hasProbed(false),
+     _panelOn(true),
+     _dimmed(false),
+     _powerMode(static_cast<uint8_t>(PowerMode::NO_SLEEP)),
+     _displayTaskHandle(nullptr)
+ {
+     memset(_front, 0, sizeof(_front));
+ }
+ 
+ DisplayManager::~DisplayManager() {
+     if (_displayTaskHandle != nullptr) {
+         vTaskDelete(_displayTaskHandle);
+     }
+ }
+ 
+ bool DisplayManager::begin() {
+     bool found = false;
+     
+     {
+         ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::DISPLAY, 1000);
+         if (bus.isLocked()) {
+             // Probe first, the library would initialize blind
+             Wire.beginTransmission(Constants::DISPLAY_I2C_ADDRESS);
+             found = Wire.endTransmission() == 0;
+             
+             // No reset pin and no Wire.begin(), the bus belongs to the sensors
+             if (found && !_display.begin(SSD1306_SWITCHCAPVCC, Constants::DISPLAY_I2C_ADDRESS, false, false)) {
+                 LOG_ERROR("Display", "Failed to allocate the display buffer");
+                 found = false;
+             }
+         }
+     }
+     
+     _hasProbed = true;
+     
+     if (!found) {
+         LOG_INFO("Display", "No SSD1306 at 0x%02X, status display disabled", Constants::DISPLAY_I2C_ADDRESS);
+         
+         // Nothing to drive, free the task's stack
+         if (_displayTaskHandle != nullptr) {
+             TaskHandle_t task = _displayTaskHandle;
+             _displayTaskHandle = nullptr;
+             vTaskDelete(task);
+         }
+         return false;
+     }
+     
+     _display.setTextColor(SSD1306_WHITE);
+     _display.setTextWrap(false);
+     
+     // Panel RAM holds noise after power-up, send every page once
+     _stalePages = 0xFF;
+     _isAvailable = true;
+     
+     if (_displayTaskHandle != nullptr) {
+         xTaskNotifyGive(_displayTaskHandle);
+     }
+     
+     LOG_INFO("Display", "SSD1306 status display initialized");
+     return true;
+ }
+ 
+ void DisplayManager::createTasks() {
+     // begin() already ran and found nothing
+     if (_hasProbed && !_isAvailable) {
+         return;
+     }
+     
+     BaseType_t result = xTaskCreatePinnedToCore(
+         displayTask,                  // Task function
+         "DisplayTask",                // Task name
+         Constants::STACK_SIZE_DISPLAY,// Stack size (words)
+         this,                         // Task parameters
+         Constants::PRIORITY_DISPLAY,  // Priority
+         &_displayTaskHandle,          // Task handle
+         1                             // Core ID (1 - application core)
+     );
+     
+     if (result != pdPASS) {
+         LOG_ERROR("Display", "Failed to create display task");
+     }
+ }
+ 
+ void DisplayManager::setPowerMode(PowerMode mode) {
+     _powerMode = static_cast<uint8_t>(mode);
+     
+     if (!_isAvailable) {
+         return;
+     }
+     
+     if (mode == PowerMode::DEEP_SLEEP || mode == PowerMode::HIBERNATION) {
+         // Otherwise the panel keeps showing the last frame through the sleep
+         ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::DISPLAY, Constants::DISPLAY_BUS_TIMEOUT_MS);
+         if (bus.isLocked()) {
+             _display.ssd1306_command(SSD1306_DISPLAYOFF);
+             _panelOn = false;
+         }
+         return;
+     }
+     
+     if (_displayTaskHandle != nullptr) {
+         xTaskNotifyGive(_displayTaskHandle);
+     }
+ }
+ 
+ bool DisplayManager::wantsPanelOn() const {
+     PowerMode mode = static_cast<PowerMode>(_powerMode.load());
+     return mode == PowerMode::NO_SLEEP || mode == PowerMode::MODEM_SLEEP;
+ }
+ 
+ bool DisplayManager::updatePanelPower() {
+     bool on = wantsPanelOn();
+     bool dim = static_cast<PowerMode>(_powerMode.load()) == PowerMode::MODEM_SLEEP;
+     if (on == _panelOn && dim == _dimmed) {
+         return _panelOn;
+     }
+     
+     // Retried with the next frame if the bus stays busy
+     ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::DISPLAY, Constants::DISPLAY_BUS_TIMEOUT_MS);
+     if (!bus.isLocked()) {
+         return _panelOn;
+     }
+     
+     if (dim != _dimmed) {
+         _display.dim(dim);
+         _dimmed = dim;
+     }
+     
+     // Display RAM is kept while the panel is off, the front buffer stays valid
+     if (on != _panelOn) {
+         _display.ssd1306_command(on ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF);
+         _panelOn = on;
+     }
+     
+     return _panelOn;
+ }
+ 
+ void DisplayManager::render() {
+     SensorReading upperDht, lowerDht, scd;
+     FusedReading tent;
+     getAppCore()->getSensorManager()->getSensorReadings(upperDht, lowerDht, scd, tent);
+     uint8_t relayMask = getAppCore()->getRelayManager()->getOnMask();
+     
+     _display.clearDisplay();
+     
+     // One text row per 8-pixel page, so a changed value dirties one page
+     char line[24];
+     if (tent.reading.valid) {
+         snprintf(line, sizeof(line), "Tent %5.1fC %5.1f%%", tent.reading.temperature, tent.reading.humidity);
+     } else {
+         snprintf(line, sizeof(line), "Tent  --.-C  --.-%%");
+     }
+     _display.setCursor(0, 0);
+     _display.print(line);
+     
+     if (tent.hasCo2) {
+         snprintf(line, sizeof(line), "CO2 %5.0fppm %3.0f%%", tent.reading.co2, tent.confidence * 100.0f);
+     } else {
+         snprintf(line, sizeof(line), "CO2  ----ppm %3.0f%%", tent.confidence * 100.0f);
+     }
+     _display.setCursor(0, 8);
+     _display.print(line);
+     
+     drawReading(3, "Up ", upperDht);
+     drawReading(4, "Low", lowerDht);
+     drawReading(5, "SCD", scd);
+     
+     // Relays that are on are drawn inverted
+     _display.setCursor(0, 48);
+     _display.print("R");
+     for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+         int16_t x = 12 + i * 14;
+         bool isOn = relayMask & (1 << i);
+         if (isOn) {
+             _display.fillRect(x - 2, 48, 10, 8, SSD1306_WHITE);
+         }
+         _display.setTextColor(isOn ? SSD1306_BLACK : SSD1306_WHITE);
+         _display.setCursor(x, 48);
+         _display.print(i + 1);
+     }
+     _display.setTextColor(SSD1306_WHITE);
+     
+     // Minutes only, a seconds field would dirty a page every frame
+     TimeManager* timeManager = getAppCore()->getTimeManager();
+     _display.setCursor(0, 56);
+     _display.print(timeManager->isTimeSet() ? timeManager->getTimeString("%H:%M") : String("--:--"));
+ }
+ 
+ void DisplayManager::drawReading(uint8_t row, const char* label, const SensorReading& reading) {
+     char line[24];
+     if (reading.valid) {
+         snprintf(line, sizeof(line), "%s  %5.1fC %5.1f%%", label, reading.temperature, reading.humidity);
+     } else {
+         snprintf(line, sizeof(line), "%s   --.-C  --.-%%", label);
+     }
+     _display.setCursor(0, row * 8);
+     _display.print(line);
+ }
+ 
+ void DisplayManager::flush() {
+     const uint8_t* back = _display.getBuffer();
+     I2CBus* bus = getAppCore()->getI2CBus();
+     
+     for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+         const uint8_t* backRow = back + page * Constants::DISPLAY_WIDTH;
+         uint8_t* frontRow = _front + page * Constants::DISPLAY_WIDTH;
+         bool stale = _stalePages & (1 << page);
+         
+         // Changed column span of this page
+         int16_t first = -1;
+         int16_t last = -1;
+         for (int16_t column = 0; column < Constants::DISPLAY_WIDTH; column++) {
+             if (stale || backRow[column] != frontRow[column]) {
+                 if (first < 0) {
+                     first = column;
+                 }
+                 last = column;
+             }
+         }
+         
+         if (first < 0) {
+             continue;
+         }
+         
+         // Take the bus per chunk, a waiting CO2 read gets it in between
+         for (int16_t column = first; column <= last; column += Constants::DISPLAY_CHUNK_BYTES) {
+             uint8_t count = (last - column + 1 < Constants::DISPLAY_CHUNK_BYTES) ? last - column + 1 : Constants::DISPLAY_CHUNK_BYTES;
+             
+             ScopedBusLock lock(bus, I2CClient::DISPLAY, Constants::DISPLAY_BUS_TIMEOUT_MS);
+             if (!lock.isLocked() || !writeRegion(page, column, backRow + column, count)) {
+                 // The rest still differs from the front buffer and goes out next frame
+                 return;
+             }
+             memcpy(frontRow + column, backRow + column, count);
+         }
+         
+         _stalePages &= ~(1 << page);
+     }
+ }
+ 
+ bool DisplayManager::writeRegion(uint8_t page, uint8_t column, const uint8_t* data, uint8_t count) {
+     // Address window from the column to the end of the page (horizontal addressing)
+     Wire.beginTransmission(Constants::DISPLAY_I2C_ADDRESS);
+     Wire.write(SSD1306_CONTROL_COMMANDS);
+     Wire.write(SSD1306_PAGEADDR);
+     Wire.write(page);
+     Wire.write(page);
+     Wire.write(SSD1306_COLUMNADDR);
+     Wire.write(column);
+     Wire.write(Constants::DISPLAY_WIDTH - 1);
+     if (Wire.endTransmission() != 0) {
+         return false;
+     }
+     
+     Wire.beginTransmission(Constants::DISPLAY_I2C_ADDRESS);
+     Wire.write(SSD1306_CONTROL_DATA);
+     Wire.write(data, count);
+     return Wire.endTransmission() == 0;
+ }
+ 
+ void DisplayManager::displayTask(void* parameter) {
+     DisplayManager* displayManager = static_cast<DisplayManager*>(parameter);
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Wait for begin(), which may run after the task is created
+         if (!displayManager->_isAvailable) {
+             ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+             continue;
+         }
+         
+         bool isOn = displayManager->updatePanelPower();
+         if (isOn) {
+             displayManager->render();
+             displayManager->flush();
+         }
+         
+         // Blanked for the power mode: no frames and no wakeups until it changes
+         TickType_t wait = (!isOn && !displayManager->wantsPanelOn()) ? portMAX_DELAY
+                                                                     : pdMS_TO_TICKS(Constants::DISPLAY_FRAME_INTERVAL_MS);
+         ulTaskNotifyTake(pdTRUE, wait);
+     }
+ }
\ No newline at end of file
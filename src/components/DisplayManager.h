@@ -0,0 +1,98 @@
+/**
+ * @file DisplayManager.h
+ * @brief Local status readout on an SSD1306 OLED
+ */
+
+ #ifndef DISPLAY_MANAGER_H
+ #define DISPLAY_MANAGER_H
+
+ #include <Arduino.h>
+ #include <atomic>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/task.h>
+ #include <Adafruit_GFX.h>
+ #include <Adafruit_SSD1306.h>
+ #include "../utils/Constants.h"
+ #include "I2CBus.h"
+ #include "SensorFusion.h"
+
+ /**
+  * @class DisplayManager
+  * @brief Shows the tent reading, the three sensors and the relays at the tent
+  *
+  * Each frame is drawn into the library's buffer (the back buffer) from
+  * the lock-free sensor and relay snapshots, then compared with a copy of
+  * what the panel shows (the front buffer). Only the changed column span of
+  * each 8-pixel page goes out, in short chunks that each take the I2CBus
+  * as the lower-priority client, so a frame in which one value changed
+  * costs a few dozen bytes instead of 1 KB. A chunk that did not get the
+  * bus stays different from the front buffer and is sent with the next
+  * frame. Frames are at least DISPLAY_FRAME_INTERVAL_MS apart.
+  *
+  * The panel follows the power mode: full contrast awake, dimmed in modem
+  * sleep and switched off in light sleep, deep sleep and hibernation. While
+  * it is off the task renders nothing and does not wake up.
+  */
+ class DisplayManager {
+ public:
+     DisplayManager();
+     ~DisplayManager();
+
+     /**
+      * @brief Probe and initialize the panel, Wire must already be started by SensorManager
+      * @return True if a panel answered and was initialized
+      */
+     bool begin();
+
+     /**
+      * @brief Create the display task (ends itself if begin() finds no panel)
+      */
+     void createTasks();
+
+     /**
+      * @brief Follow a power mode change
+      *
+      * Non-blocking for the modes the device stays up in. Before deep sleep
+      * and hibernation the panel is switched off right away, the task never
+      * runs again to do it.
+      * @param mode Power mode being entered
+      */
+     void setPowerMode(PowerMode mode);
+
+     /**
+      * @brief Check if a panel was found
+      * @return True after a successful begin()
+      */
+     bool isAvailable() const { return _isAvailable; }
+
+ private:
+     static constexpr uint8_t PAGE_COUNT = Constants::DISPLAY_HEIGHT / 8;
+     static constexpr size_t BUFFER_SIZE = Constants::DISPLAY_WIDTH * PAGE_COUNT;
+
+     Adafruit_SSD1306 _display;
+
+     // What the panel currently shows, and the pages whose content is unknown
+     uint8_t _front[BUFFER_SIZE];
+     uint8_t _stalePages;
+
+     // Status tracking
+     volatile bool _isAvailable;
+     bool _hasProbed;
+     bool _panelOn;
+     bool _dimmed;
+     std::atomic<uint8_t> _powerMode;
+
+     // RTOS resources
+     TaskHandle_t _displayTaskHandle;
+
+     // Private methods
+     bool wantsPanelOn() const;
+     bool updatePanelPower();
+     void render();
+     void drawReading(uint8_t row, const char* label, const SensorReading& reading);
+     void flush();
+     bool writeRegion(uint8_t page, uint8_t column, const uint8_t* data, uint8_t count);
+     static void displayTask(void* parameter);
+ };
+
+ #endif // DISPLAY_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,72 @@
+/**
+ * @file I2CBus.cpp
+ * @brief Implementation of the I2CBus class
+ */
+
+ #include "I2CBus.h"
+ 
+ I2CBus::I2CBus() :
+     _mutex(xSemaphoreCreateMutex()),
+     _sensorWaiting(0),
+     _reservedStartMs(0),
+     _reservedEndMs(0)
+ {
+ }
+ 
+ I2CBus::~I2CBus() {
+     if (_mutex != nullptr) {
+         vSemaphoreDelete(_mutex);
+     }
+ }
+ 
+ bool I2CBus::acquire(I2CClient client, uint32_t timeoutMs) {
+     if (_mutex == nullptr) {
+         return false;
+     }
+     
+     if (client == I2CClient::SENSOR) {
+         // Announce the wait so the display yields after its current chunk
+         _sensorWaiting++;
+         bool locked = xSemaphoreTake(_mutex, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+         _sensorWaiting--;
+         return locked;
+     }
+     
+     // The display polls instead of queueing behind a sensor
+     uint32_t start = millis();
+     while (true) {
+         if (!isSensorPending() && xSemaphoreTake(_mutex, 0) == pdTRUE) {
+             // A sensor may have started waiting in between
+             if (_sensorWaiting == 0) {
+                 return true;
+             }
+             xSemaphoreGive(_mutex);
+         }
+         
+         if (millis() - start >= timeoutMs) {
+             return false;
+         }
+         vTaskDelay(1);
+     }
+ }
+ 
+ void I2CBus::release() {
+     xSemaphoreGive(_mutex);
+ }
+ 
+ void I2CBus::reserve(uint32_t startMs, uint32_t durationMs) {
+     _reservedEndMs = startMs + durationMs;
+     _reservedStartMs = startMs;
+ }
+ 
+ bool I2CBus::isSensorPending() const {
+     if (_sensorWaiting > 0) {
+         return true;
+     }
+     
+     // Inside the window, or close enough that a chunk could run into it
+     uint32_t now = millis();
+     int32_t untilStart = static_cast<int32_t>(_reservedStartMs - now);
+     int32_t untilEnd = static_cast<int32_t>(_reservedEndMs - now);
+     return untilEnd > 0 && untilStart < static_cast<int32_t>(Constants::I2C_RESERVATION_GUARD_MS);
+ }
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * @file I2CBus.h
+ * @brief Arbitration of the shared Wire bus between the SCD40 and the display
+ */
+
+ #ifndef I2C_BUS_H
+ #define I2C_BUS_H
+
+ #include <Arduino.h>
+ #include <atomic>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/semphr.h>
+ #include "../utils/Constants.h"
+
+ /**
+  * @enum I2CClient
+  * @brief Users of the bus, in order of precedence
+  */
+ enum class I2CClient : uint8_t {
+     SENSOR = 0,   // SCD40, waits for the bus
+     DISPLAY       // Status display, only gets an idle bus
+ };
+
+ /**
+  * @class I2CBus
+  * @brief Keeps display traffic out of the way of the CO2 reads
+  *
+  * Every Wire transaction runs with the bus lock held. The sensor waits for
+  * it like for any mutex; the display only takes it when no sensor is
+  * waiting and outside the window the SCD task reserved for its next read,
+  * and gives it back after each short chunk. A CO2 read therefore waits at
+  * most for one display chunk, and normally not at all. The lock is created
+  * with the object, so the sensors can use the bus before any begin() runs.
+  */
+ class I2CBus {
+ public:
+     I2CBus();
+     ~I2CBus();
+
+     /**
+      * @brief Take the bus for a transaction
+      * @param client Who is asking
+      * @param timeoutMs Longest wait; the display never waits past a sensor
+      * @return True if the bus is held and must be given back with release()
+      */
+     bool acquire(I2CClient client, uint32_t timeoutMs = 1000);
+
+     /**
+      * @brief Give the bus back after acquire()
+      */
+     void release();
+
+     /**
+      * @brief Keep the display off the bus while a sensor read is expected
+      *
+      * A new reservation replaces the previous one.
+      * @param startMs millis() at which the read starts
+      * @param durationMs Longest time the read may take
+      */
+     void reserve(uint32_t startMs, uint32_t durationMs);
+
+     /**
+      * @brief Check whether the display should leave the bus alone right now
+      * @return True while a sensor waits or its reserved window is close
+      */
+     bool isSensorPending() const;
+
+ private:
+     SemaphoreHandle_t _mutex;
+     std::atomic<uint8_t> _sensorWaiting;
+
+     // Reserved window, written by the SCD task only
+     std::atomic<uint32_t> _reservedStartMs;
+     std::atomic<uint32_t> _reservedEndMs;
+ };
+
+ /**
+  * @class ScopedBusLock
+  * @brief Holds the bus for the lifetime of the object
+  */
+ class ScopedBusLock {
+ public:
+     ScopedBusLock(I2CBus* bus, I2CClient client, uint32_t timeoutMs = 1000) :
+         _bus(bus),
+         _locked(bus->acquire(client, timeoutMs)) {}
+
+     ~ScopedBusLock() {
+         if (_locked) {
+             _bus->release();
+         }
+     }
+
+     ScopedBusLock(const ScopedBusLock&) = delete;
+     ScopedBusLock& operator=(const ScopedBusLock&) = delete;
+
+     bool isLocked() const { return _locked; }
+
+ private:
+     I2CBus* _bus;
+     bool _locked;
+ };
+
+ #endif // I2C_BUS_H
\ No newline at end of file
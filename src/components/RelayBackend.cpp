@@ -0,0 +1,38 @@
+/**
+ * @file RelayBackend.cpp
+ * @brief Implementation of the relay backends
+ */
+
+ #include "RelayBackend.h"
+ #include "TapoManager.h"
+ 
+ GpioRelayBackend::GpioRelayBackend(uint8_t pin) :
+     _pin(pin)
+ {
+ }
+ 
+ bool GpioRelayBackend::begin() {
+     pinMode(_pin, OUTPUT);
+     digitalWrite(_pin, LOW);
+     return true;
+ }
+ 
+ bool GpioRelayBackend::apply(bool on) {
+     digitalWrite(_pin, on ? HIGH : LOW);
+     return true;
+ }
+ 
+ TapoRelayBackend::TapoRelayBackend(TapoManager* tapoManager, const String& deviceId) :
+     _tapoManager(tapoManager),
+     _deviceId(deviceId)
+ {
+ }
+ 
+ bool TapoRelayBackend::begin() {
+     return _tapoManager != nullptr;
+ }
+ 
+ bool TapoRelayBackend::apply(bool on) {
+     // Only queues the request, the round trip happens on a poll worker
+     return _tapoManager != nullptr && _tapoManager->requestState(_deviceId, on);
+ }
\ No newline at end of file
@@ -0,0 +1,83 @@
+/**
+ * @file RelayBackend.h
+ * @brief Actuators behind the relays: GPIO pins and Tapo smart plugs
+ */
+
+ #ifndef RELAY_BACKEND_H
+ #define RELAY_BACKEND_H
+
+ #include <Arduino.h>
+ #include "../utils/Constants.h"
+
+ // Forward declarations
+ class TapoManager;
+
+ /**
+  * @class RelayBackend
+  * @brief Switches the load of one relay
+  *
+  * RelayManager keeps schedules, dependencies, environmental control and
+  * overrides per relay ID and only calls the backend to change the output,
+  * so every kind of actuator gets the same automation. apply() runs on the
+  * relay control task with the relay lock held and must not wait on the
+  * network; backends that need a round trip hand the command to their own
+  * worker and return at once.
+  */
+ class RelayBackend {
+ public:
+     virtual ~RelayBackend() {}
+
+     /**
+      * @brief Prepare the output, leaving the load off
+      * @return True if the backend is ready
+      */
+     virtual bool begin() = 0;
+
+     /**
+      * @brief Switch the load
+      * @param on True to turn on
+      * @return True if switched or queued for switching
+      */
+     virtual bool apply(bool on) = 0;
+
+     virtual RelayBackendType getType() const = 0;
+ };
+
+ /**
+  * @class GpioRelayBackend
+  * @brief Relay module on a GPIO pin, active high
+  */
+ class GpioRelayBackend : public RelayBackend {
+ public:
+     explicit GpioRelayBackend(uint8_t pin);
+
+     bool begin() override;
+     bool apply(bool on) override;
+     RelayBackendType getType() const override { return RelayBackendType::GPIO; }
+
+ private:
+     uint8_t _pin;
+ };
+
+ /**
+  * @class TapoRelayBackend
+  * @brief Tapo plug standing in for a relay
+  *
+  * The requested state is handed to the TapoManager poll workers, which
+  * keep only the latest request per plug and retry it with the next sweep
+  * while the plug is unreachable.
+  */
+ class TapoRelayBackend : public RelayBackend {
+ public:
+     TapoRelayBackend(TapoManager* tapoManager, const String& deviceId);
+
+     bool begin() override;
+     bool apply(bool on) override;
+     RelayBackendType getType() const override { return RelayBackendType::TAPO; }
+
+ private:
+     TapoManager* _tapoManager;
+     String _deviceId;
+ };
+
+ #endif // RELAY_BACKEND_H
\ No newline at end of file
@@ -7,14 +7,20 @@
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
  #include "../components/SensorManager.h"
+ #include "../components/TapoManager.h"
+ #include "../system/LatencyMonitor.h"
  #include <time.h>
  
  RelayManager::RelayManager() :
      _overrideDurationMinutes(Constants::DEFAULT_USER_OVERRIDE_TIME_MIN),
      _relayMutex(nullptr),
      _relayControlTaskHandle(nullptr),
-     _isInitialized(false)
+     _isInitialized(false),
+     _onMask(0)
  {
+     // Humidifier and heater start out with the classic threshold band
+     _controlLoops[5].configure(ControlSettings());
+     _controlLoops[6].configure(ControlSettings());
  }
  
  RelayManager::~RelayManager() {
@@ -28,9 +34,8 @@
      }
      
      // Ensure all relays are off
-     for (const auto& entry : _relayConfigs) {
-         pinMode(entry.second.pin, OUTPUT);
-         digitalWrite(entry.second.pin, LOW);
+     for (const auto& entry : _backends) {
+         entry.second->apply(false);
      }
  }
  
@@ -47,7 +52,7 @@
  }
  
  bool RelayManager::initRelays() {
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", "Initializing relays");
+     LOG_INFO("Relays", "Initializing relays");
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
@@ -129,21 +134,26 @@
          relay8.hasDependency = false;
          _relayConfigs[8] = relay8;
          
-         // Initialize all relay pins
+         // Initialize all relay pins, plugs are bound once the Tapo devices are known
          for (auto& entry : _relayConfigs) {
-             pinMode(entry.second.pin, OUTPUT);
-             digitalWrite(entry.second.pin, LOW);
+             _backends[entry.first].reset(new GpioRelayBackend(entry.second.pin));
+             _backends[entry.first]->begin();
              entry.second.isOn = false;
              entry.second.state = RelayState::AUTO;
              entry.second.lastTrigger = RelayTrigger::MANUAL;
              
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Initialized relay " + String(entry.first) + " (" + entry.second.name + ") on pin " + String(entry.second.pin));
+             LOG_INFO("Relays", "Initialized relay %u (%s) on pin %u", 
+                 entry.first, entry.second.name.c_str(), entry.second.pin);
          }
+         _onMask = 0;
+         
+         // Compile the default windows and cycle into the schedule timeline
+         rebuildTimeline();
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
          
+         refreshBackends();
          return true;
      }
      
@@ -160,18 +170,17 @@
          // Get current pin
          uint8_t currentPin = _relayConfigs[relayId].pin;
          
-         // Set pin to LOW before changing
+         // Move the relay to the new pin, the old one goes LOW
          if (currentPin != pin) {
-             digitalWrite(currentPin, LOW);
-             
-             // Configure new pin
              _relayConfigs[relayId].pin = pin;
-             pinMode(pin, OUTPUT);
-             digitalWrite(pin, _relayConfigs[relayId].isOn ? HIGH : LOW);
              
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Changed relay " + String(relayId) + " (" + _relayConfigs[relayId].name + ") from pin " + 
-                 String(currentPin) + " to pin " + String(pin));
+             // A plug keeps switching the relay, the pin only matters once it is unbound
+             if (_relayConfigs[relayId].backend == RelayBackendType::GPIO) {
+                 bindBackend(relayId, new GpioRelayBackend(pin));
+             }
+             
+             LOG_INFO("Relays", "Changed relay %u (%s) from pin %u to pin %u", 
+                 relayId, _relayConfigs[relayId].name.c_str(), currentPin, pin);
          }
          
          // Release mutex
@@ -210,11 +219,13 @@
          // Update name
          _relayConfigs[relayId].name = name;
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Renamed relay " + String(relayId) + " to \"" + name + "\"");
+         LOG_INFO("Relays", "Renamed relay %u to \"%s\"", relayId, name.c_str());
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // The Home Assistant entity carries the name
+         getAppCore()->getMQTTClient()->notifyDiscoveryChange();
          return true;
      }
      
@@ -257,13 +268,16 @@
          _relayConfigs[relayId].operatingTime.startMinute = startMinute;
          _relayConfigs[relayId].operatingTime.endHour = endHour;
          _relayConfigs[relayId].operatingTime.endMinute = endMinute;
+         rebuildTimeline();
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Set operating time for relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-             ") to " + _relayConfigs[relayId].operatingTime.toString());
+         LOG_INFO("Relays", "Set operating time for relay %u (%s) to %02u:%02u-%02u:%02u", 
+             relayId, _relayConfigs[relayId].name.c_str(), startHour, startMinute, endHour, endMinute);
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // The next schedule transition may have moved
+         notifyControlTask(WAKE_CONFIG);
          return true;
      }
      
@@ -298,12 +312,14 @@
          // Update visibility
          _relayConfigs[relayId].visible = visible;
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Set relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-             ") visibility to " + (visible ? "visible" : "hidden"));
+         LOG_INFO("Relays", "Set relay %u (%s) visibility to %s", 
+             relayId, _relayConfigs[relayId].name.c_str(), visible ? "visible" : "hidden");
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // Hidden relays are removed from Home Assistant
+         getAppCore()->getMQTTClient()->notifyDiscoveryChange();
          return true;
      }
      
@@ -344,14 +360,11 @@
          _relayConfigs[relayId].dependsOnRelay = dependsOnRelay;
          
          if (hasDependency) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Set relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                 ") to depend on relay " + String(dependsOnRelay) + 
-                 " (" + _relayConfigs[dependsOnRelay].name + ")");
+             LOG_INFO("Relays", "Set relay %u (%s) to depend on relay %u (%s)", 
+                 relayId, _relayConfigs[relayId].name.c_str(), dependsOnRelay, _relayConfigs[dependsOnRelay].name.c_str());
          } else {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Set relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                 ") to have no dependencies");
+             LOG_INFO("Relays", "Set relay %u (%s) to have no dependencies", 
+                 relayId, _relayConfigs[relayId].name.c_str());
          }
          
          // Release mutex
@@ -390,13 +403,16 @@
          // Update cycle configuration
          _cycleConfig.onDurationMinutes = onDurationMinutes;
          _cycleConfig.intervalMinutes = intervalMinutes;
+         rebuildTimeline();
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Set cycle configuration to " + String(onDurationMinutes) + 
-             " minutes ON every " + String(intervalMinutes) + " minutes");
+         LOG_INFO("Relays", "Set cycle configuration to %u minutes ON every %u minutes", 
+             onDurationMinutes, intervalMinutes);
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // The next schedule transition may have moved
+         notifyControlTask(WAKE_CONFIG);
          return true;
      }
      
@@ -427,7 +443,8 @@
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Update thresholds
+         // Update thresholds, explicit values replace a running ramp
+         _thresholdRamp.active = false;
          _thresholds.humidityLow = humidityLow;
          _thresholds.humidityHigh = humidityHigh;
          _thresholds.temperatureLow = temperatureLow;
@@ -435,20 +452,93 @@
          _thresholds.co2Low = co2Low;
          _thresholds.co2High = co2High;
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Set environmental thresholds: Humidity=" + String(humidityLow, 1) + 
-             "%-" + String(humidityHigh, 1) + "%, Temperature=" + String(temperatureLow, 1) + 
-             "°C-" + String(temperatureHigh, 1) + "°C, CO2=" + String(co2Low, 0) + 
-             "-" + String(co2High, 0) + "ppm");
+         LOG_INFO("Relays", 
+             "Set environmental thresholds: Humidity=%.1f%%-%.1f%%, Temperature=%.1f°C-%.1f°C, CO2=%.0f-%.0fppm", 
+             humidityLow, humidityHigh, temperatureLow, temperatureHigh, co2Low, co2High);
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // Re-evaluate against the new thresholds right away
+         notifyControlTask(WAKE_CONFIG);
          return true;
      }
      
      return false;
  }
  
+ bool RelayManager::startThresholdRamp(const EnvironmentalThresholds& from, const EnvironmentalThresholds& to,
+                                       time_t start, uint32_t durationSeconds) {
+     // Both ends must be valid, every point in between then is as well
+     if (durationSeconds == 0 ||
+         from.humidityLow >= from.humidityHigh || from.temperatureLow >= from.temperatureHigh || from.co2Low >= from.co2High ||
+         to.humidityLow >= to.humidityHigh || to.temperatureLow >= to.temperatureHigh || to.co2Low >= to.co2High) {
+         return false;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _thresholdRamp.from = from;
+         _thresholdRamp.to = to;
+         _thresholdRamp.start = start;
+         _thresholdRamp.durationSeconds = durationSeconds;
+         _thresholdRamp.active = true;
+         advanceThresholdRamp(time(nullptr));
+         
+         LOG_INFO("Relays", "Ramping environmental thresholds over %lu min", 
+             static_cast<unsigned long>(durationSeconds / 60));
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+         
+         notifyControlTask(WAKE_CONFIG);
+         return true;
+     }
+     
+     return false;
+ }
+ 
+ void RelayManager::cancelThresholdRamp() {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _thresholdRamp.active = false;
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+     }
+ }
+ 
+ void RelayManager::advanceThresholdRamp(time_t now) {
+     // Caller must hold _relayMutex
+     if (!_thresholdRamp.active) {
+         return;
+     }
+     
+     // The control task passes at least every RELAY_CONTROL_MAX_SLEEP_MS, so
+     // the setpoints move in steps of a minute or less
+     float fraction = 0.0f;
+     if (now > _thresholdRamp.start) {
+         fraction = static_cast<float>(now - _thresholdRamp.start) / _thresholdRamp.durationSeconds;
+     }
+     if (fraction >= 1.0f) {
+         fraction = 1.0f;
+         _thresholdRamp.active = false;
+     }
+     
+     const EnvironmentalThresholds& from = _thresholdRamp.from;
+     const EnvironmentalThresholds& to = _thresholdRamp.to;
+     _thresholds.humidityLow = from.humidityLow + (to.humidityLow - from.humidityLow) * fraction;
+     _thresholds.humidityHigh = from.humidityHigh + (to.humidityHigh - from.humidityHigh) * fraction;
+     _thresholds.temperatureLow = from.temperatureLow + (to.temperatureLow - from.temperatureLow) * fraction;
+     _thresholds.temperatureHigh = from.temperatureHigh + (to.temperatureHigh - from.temperatureHigh) * fraction;
+     _thresholds.co2Low = from.co2Low + (to.co2Low - from.co2Low) * fraction;
+     _thresholds.co2High = from.co2High + (to.co2High - from.co2High) * fraction;
+     
+     if (!_thresholdRamp.active) {
+         LOG_INFO("Relays", "Threshold ramp complete");
+     }
+ }
+ 
  bool RelayManager::getEnvironmentalThresholds(float& humidityLow, float& humidityHigh,
                                               float& temperatureLow, float& temperatureHigh,
                                               float& co2Low, float& co2High) {
@@ -469,6 +559,54 @@
      return false;
  }
  
+ bool RelayManager::setControlSettings(uint8_t relayId, const ControlSettings& settings) {
+     if (_controlLoops.find(relayId) == _controlLoops.end()) {
+         return false;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _controlLoops[relayId].configure(settings);
+         
+         if (settings.mode == ControlMode::PID) {
+             LOG_INFO("Relays", 
+                 "Set control for relay %u to PID (kp=%.3f, ki=%.4f, kd=%.3f, window=%us), min on/off %u/%us", 
+                 relayId, settings.kp, settings.ki, settings.kd, settings.windowSeconds, 
+                 settings.minOnSeconds, settings.minOffSeconds);
+         } else {
+             LOG_INFO("Relays", 
+                 "Set control for relay %u to hysteresis, min on/off %u/%us", 
+                 relayId, settings.minOnSeconds, settings.minOffSeconds);
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+         
+         // Re-evaluate with the new strategy right away
+         notifyControlTask(WAKE_CONFIG);
+         return true;
+     }
+     
+     return false;
+ }
+ 
+ bool RelayManager::getControlSettings(uint8_t relayId, ControlSettings& settings) {
+     if (_controlLoops.find(relayId) == _controlLoops.end()) {
+         return false;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         settings = _controlLoops[relayId].getSettings();
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+         return true;
+     }
+     
+     return false;
+ }
+ 
  bool RelayManager::setOverrideDuration(uint16_t minutes) {
      if (minutes == 0) {
          return false;
@@ -478,8 +616,7 @@
      if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          _overrideDurationMinutes = minutes;
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-             "Set user override duration to " + String(minutes) + " minutes");
+         LOG_INFO("Relays", "Set user override duration to %u minutes", minutes);
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
@@ -533,20 +670,22 @@
              // Now control this relay
              physicallyControlRelay(relayId, turnOn, RelayTrigger::MANUAL);
              
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Manual override for relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                 "), set to " + (turnOn ? "ON" : "OFF") + " for " + String(_overrideDurationMinutes) + " minutes");
+             LOG_INFO("Relays", "Manual override for relay %u (%s), set to %s for %u minutes", 
+                 relayId, _relayConfigs[relayId].name.c_str(), turnOn ? "ON" : "OFF", _overrideDurationMinutes);
          } else {
              // Clear override, return to automatic control
              _relayConfigs[relayId].overrideUntil = 0;
              
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                 ") set to AUTO mode");
+             LOG_INFO("Relays", "Relay %u (%s) set to AUTO mode", 
+                 relayId, _relayConfigs[relayId].name.c_str());
          }
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
+         
+         // Reschedule the override expiry (or resume automation now)
+         notifyControlTask(WAKE_OVERRIDE);
+         getAppCore()->getMQTTClient()->notifyRelayChange();
          return true;
      }
      
@@ -562,21 +701,9 @@
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         state = _relayConfigs[relayId].state;
-         
          // Check if manual override has expired
-         if (state != RelayState::AUTO && _relayConfigs[relayId].overrideUntil > 0) {
-             if (millis() > _relayConfigs[relayId].overrideUntil) {
-                 // Override expired, set back to auto
-                 _relayConfigs[relayId].state = RelayState::AUTO;
-                 _relayConfigs[relayId].overrideUntil = 0;
-                 state = RelayState::AUTO;
-                 
-                 getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                     "Manual override for relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                     ") expired, returning to AUTO mode");
-             }
-         }
+         expireOverride(relayId);
+         state = _relayConfigs[relayId].state;
          
          // Release mutex
          xSemaphoreGive(_relayMutex);
@@ -637,6 +764,27 @@
      return configs;
  }
  
+ bool RelayManager::getStatus(RelayStatus& status) {
+     status.relays.clear();
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         status.relays.reserve(_relayConfigs.size());
+         for (const auto& entry : _relayConfigs) {
+             status.relays.push_back(entry.second);
+         }
+         status.thresholds = _thresholds;
+         status.cycle = _cycleConfig;
+         status.overrideDurationMinutes = _overrideDurationMinutes;
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+         return true;
+     }
+     
+     return false;
+ }
+ 
  void RelayManager::createTasks() {
      // Create relay control task
      BaseType_t result = xTaskCreatePinnedToCore(
@@ -650,12 +798,126 @@
      );
      
      if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Relays", 
+         LOG_ERROR("Relays", 
              "Failed to create relay control task");
      }
  }
  
+ void RelayManager::notifyControlTask(uint32_t reason) {
+     if (_relayControlTaskHandle != nullptr) {
+         xTaskNotify(_relayControlTaskHandle, reason, eSetBits);
+     }
+ }
+ 
+ bool RelayManager::expireOverride(uint8_t relayId) {
+     // Caller must hold _relayMutex
+     RelayConfig& config = _relayConfigs[relayId];
+     if (config.state == RelayState::AUTO || config.overrideUntil == 0) {
+         return false;
+     }
+     
+     // Signed difference so the comparison survives millis() wrapping
+     if (static_cast<int32_t>(millis() - config.overrideUntil) < 0) {
+         return false;
+     }
+     
+     // Override expired, set back to auto
+     config.state = RelayState::AUTO;
+     config.overrideUntil = 0;
+     
+     LOG_INFO("Relays", "Manual override for relay %u (%s) expired, returning to AUTO mode", 
+         relayId, config.name.c_str());
+     return true;
+ }
+ 
+ uint32_t RelayManager::msUntilNextEvent() {
+     uint32_t sleepMs = Constants::RELAY_CONTROL_MAX_SLEEP_MS;
+     time_t now = time(nullptr);
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         // Exact instant of the next window edge or cycle phase change
+         _timeline.update(now);
+         uint32_t scheduleMs = static_cast<uint32_t>(_timeline.getNextTransition() - now) * 1000;
+         sleepMs = min(sleepMs, scheduleMs);
+         
+         // Pending override expiry
+         uint32_t nowMs = millis();
+         for (const auto& entry : _relayConfigs) {
+             const RelayConfig& config = entry.second;
+             if (config.state != RelayState::AUTO && config.overrideUntil > 0) {
+                 int32_t remaining = static_cast<int32_t>(config.overrideUntil - nowMs);
+                 sleepMs = min(sleepMs, static_cast<uint32_t>(max(remaining, static_cast<int32_t>(0))));
+             }
+         }
+         
+         // PID slice edges and dwell expiry
+         for (const auto& entry : _controlLoops) {
+             sleepMs = min(sleepMs, entry.second.msUntilNextChange(nowMs));
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+     }
+     
+     return sleepMs;
+ }
+ 
+ void RelayManager::rebuildTimeline() {
+     // Caller must hold _relayMutex
+     TimeRange windows[8];
+     for (uint8_t relayId = 1; relayId <= 8; relayId++) {
+         windows[relayId - 1] = _relayConfigs[relayId].operatingTime;
+     }
+     _timeline.build(windows, 8, _cycleConfig);
+ }
+ 
+ bool RelayManager::evaluateControl(uint8_t relayId, float measurement, bool isOn) {
+     bool shouldBeOn = isOn;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         ControlLoop& loop = _controlLoops[relayId];
+         if (relayId == 5) {
+             shouldBeOn = loop.update(measurement, _thresholds.humidityLow, _thresholds.humidityHigh, isOn, millis());
+         } else {
+             shouldBeOn = loop.update(measurement, _thresholds.temperatureLow, _thresholds.temperatureHigh, isOn, millis());
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+     }
+     
+     return shouldBeOn;
+ }
+ 
+ void RelayManager::resetControl(uint8_t relayId) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _controlLoops[relayId].reset();
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+     }
+ }
+ 
+ bool RelayManager::getSchedulePreview(std::vector<ScheduleEvent>& events, time_t& nextTransition) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _timeline.preview(time(nullptr), events, Constants::SCHEDULE_PREVIEW_MAX_EVENTS);
+         nextTransition = _timeline.getNextTransition();
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+         return true;
+     }
+     
+     return false;
+ }
+ 
  bool RelayManager::physicallyControlRelay(uint8_t relayId, bool turnOn, RelayTrigger trigger) {
+     LATENCY_SCOPE("relay.switch");
+     
      if (relayId < 1 || relayId > 8) {
          return false;
      }
@@ -667,19 +929,35 @@
          
          // Only take action if state is changing
          if (currentlyOn != turnOn) {
-             // Control the physical pin
-             digitalWrite(_relayConfigs[relayId].pin, turnOn ? HIGH : LOW);
+             // GPIO switches here, a plug only gets the command queued
+             auto backend = _backends.find(relayId);
+             if (backend == _backends.end() || !backend->second->apply(turnOn)) {
+                 LOG_WARN("Relays", "Relay %u (%s) has no working backend", 
+                     relayId, _relayConfigs[relayId].name.c_str());
+                 
+                 // Release mutex
+                 xSemaphoreGive(_relayMutex);
+                 return false;
+             }
              
              // Update state
              _relayConfigs[relayId].isOn = turnOn;
              _relayConfigs[relayId].lastTrigger = trigger;
+             if (turnOn) {
+                 _onMask.fetch_or(1 << (relayId - 1), std::memory_order_relaxed);
+             } else {
+                 _onMask.fetch_and(~(1 << (relayId - 1)), std::memory_order_relaxed);
+             }
+             
+             // Push the change to live clients (non-blocking)
+             getAppCore()->getWebServer()->notifyRelayUpdate(relayId, turnOn, static_cast<uint8_t>(trigger));
+             getAppCore()->getMQTTClient()->notifyRelayChange();
              
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Relays", 
-                 "Relay " + String(relayId) + " (" + _relayConfigs[relayId].name + 
-                 ") turned " + (turnOn ? "ON" : "OFF") + " by " + 
-                 (trigger == RelayTrigger::MANUAL ? "manual control" : 
-                  trigger == RelayTrigger::SCHEDULE ? "schedule" : 
-                  trigger == RelayTrigger::ENVIRONMENTAL ? "environmental control" : "dependency"));
+             LOG_INFO("Relays", "Relay %u (%s) turned %s by %s", 
+                 relayId, _relayConfigs[relayId].name.c_str(), turnOn ? "ON" : "OFF", 
+                 trigger == RelayTrigger::MANUAL ? "manual control" : 
+                 trigger == RelayTrigger::SCHEDULE ? "schedule" : 
+                 trigger == RelayTrigger::ENVIRONMENTAL ? "environmental control" : "dependency");
              
              // If turning off, check for dependent relays
              if (!turnOn) {
@@ -695,6 +973,60 @@
      return false;
  }
  
+ void RelayManager::refreshBackends() {
+     if (_relayMutex == nullptr) {
+         return;
+     }
+     
+     // Copy the devices before taking our lock
+     std::vector<TapoDevice> devices = getAppCore()->getTapoManager()->getAllDevices();
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (auto& entry : _relayConfigs) {
+             RelayConfig& config = entry.second;
+             
+             String deviceId;
+             for (const TapoDevice& device : devices) {
+                 if (device.relayReplacement == entry.first) {
+                     deviceId = device.id;
+                     break;
+                 }
+             }
+             
+             if (!deviceId.isEmpty()) {
+                 if (config.backend != RelayBackendType::TAPO || config.backendDevice != deviceId) {
+                     bindBackend(entry.first, new TapoRelayBackend(getAppCore()->getTapoManager(), deviceId));
+                     config.backendDevice = deviceId;
+                     LOG_INFO("Relays", "Relay %u (%s) switched by Tapo device %s", 
+                         entry.first, config.name.c_str(), deviceId.c_str());
+                 }
+             } else if (config.backend != RelayBackendType::GPIO) {
+                 bindBackend(entry.first, new GpioRelayBackend(config.pin));
+                 config.backendDevice = "";
+                 LOG_INFO("Relays", "Relay %u (%s) back on pin %u", 
+                     entry.first, config.name.c_str(), config.pin);
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_relayMutex);
+     }
+ }
+ 
+ void RelayManager::bindBackend(uint8_t relayId, RelayBackend* backend) {
+     // Called with _relayMutex held, the old output is released before the new one takes over
+     auto previous = _backends.find(relayId);
+     if (previous != _backends.end()) {
+         previous->second->apply(false);
+     }
+     
+     backend->begin();
+     backend->apply(_relayConfigs[relayId].isOn);
+     _relayConfigs[relayId].backend = backend->getType();
+     _backends[relayId].reset(backend);
+ }
+ 
  bool RelayManager::checkDependencyChain(uint8_t relayId) {
      if (relayId < 1 || relayId > 8) {
          return false;
@@ -715,14 +1047,9 @@
          return false;
      }
      
-     // Get current time
-     time_t now;
-     time(&now);
-     struct tm timeInfo;
-     localtime_r(&now, &timeInfo);
-     
-     // Check if current time is within operating time
-     return _relayConfigs[relayId].operatingTime.isInRange(timeInfo.tm_hour, timeInfo.tm_min);
+     // O(1) unless the active timeline slot has ended
+     _timeline.update(time(nullptr));
+     return _timeline.isInWindow(relayId);
  }
  
  void RelayManager::manageDependentRelays(uint8_t relayId, bool turnOn) {
@@ -760,55 +1087,34 @@
  
  void RelayManager::relayControlTask(void* parameter) {
      RelayManager* relayManager = static_cast<RelayManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
      
      // Get reference to the sensor manager for environmental readings
      SensorManager* sensorManager = getAppCore()->getSensorManager();
+     LatencyHistogram* loopLatency = LatencyMonitor::probe("relay.loop");
      
      while (true) {
-         // Get current time
-         time_t now;
-         time(&now);
-         struct tm timeInfo;
-         localtime_r(&now, &timeInfo);
-         
-         // Determine what minute of the day we're in (0-1439)
-         uint16_t currentMinuteOfDay = timeInfo.tm_hour * 60 + timeInfo.tm_min;
-         
-         // Get sensor readings
-         SensorReading upperDht, lowerDht, scd;
-         bool hasReadings = sensorManager->getSensorReadings(upperDht, lowerDht, scd);
-         
-         // Calculate average temperature and humidity if we have readings
-         float avgTemperature = 0.0f;
-         float avgHumidity = 0.0f;
-         uint16_t validSensors = 0;
-         
-         if (hasReadings) {
-             if (upperDht.valid) {
-                 avgTemperature += upperDht.temperature;
-                 avgHumidity += upperDht.humidity;
-                 validSensors++;
-             }
-             
-             if (lowerDht.valid) {
-                 avgTemperature += lowerDht.temperature;
-                 avgHumidity += lowerDht.humidity;
-                 validSensors++;
-             }
+         TASK_LOOP_MARK();
+         int64_t passStart = esp_timer_get_time();
+         
+         // Look up the cycle phase in the schedule timeline
+         bool cycleOn = false;
+         if (xSemaphoreTake(relayManager->_relayMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+             time_t now = time(nullptr);
+             relayManager->_timeline.update(now);
+             cycleOn = relayManager->_timeline.isCycleOn();
              
-             if (scd.valid) {
-                 avgTemperature += scd.temperature;
-                 avgHumidity += scd.humidity;
-                 validSensors++;
-             }
+             // Step a running threshold ramp, a few float operations per pass
+             relayManager->advanceThresholdRamp(now);
              
-             if (validSensors > 0) {
-                 avgTemperature /= validSensors;
-                 avgHumidity /= validSensors;
-             }
+             // Release mutex
+             xSemaphoreGive(relayManager->_relayMutex);
          }
          
+         // Filtered tent reading, glitches and sensors that disagree are already left out
+         FusedReading tent;
+         bool hasReading = sensorManager->getTentReading(tent);
+         bool hasCo2 = hasReading && tent.hasCo2;
+         
          // Control relays based on their type and conditions
          for (uint8_t relayId = 1; relayId <= 8; relayId++) {
              // Take mutex to ensure thread safety
@@ -819,10 +1125,9 @@
                      continue;
                  }
                  
-                 // Check if relay is in manual mode
-                 RelayState state = relayManager->getRelayState(relayId);
-                 if (state != RelayState::AUTO) {
-                     // Check for override expiration is done in getRelayState
+                 // Check if relay is in manual mode (the mutex is already held here)
+                 relayManager->expireOverride(relayId);
+                 if (relayManager->_relayConfigs[relayId].state != RelayState::AUTO) {
                      xSemaphoreGive(relayManager->_relayMutex);
                      continue;
                  }
@@ -847,8 +1152,7 @@
                          // Alternate with Grow Light (Relay 3) in operating time
                          if (inOperatingTime) {
                              // Check if we're in the "on" phase of the cycle
-                             uint16_t cycleMinutes = currentMinuteOfDay % relayManager->_cycleConfig.intervalMinutes;
-                             bool shouldBeOn = (cycleMinutes < relayManager->_cycleConfig.onDurationMinutes);
+                             bool shouldBeOn = cycleOn;
                              
                              // Only turn on in the first half of the interval
                              if (shouldBeOn) {
@@ -872,9 +1176,8 @@
                      case 3: // Grow Light
                          // Alternate with UV Light (Relay 2) in operating time
                          if (inOperatingTime) {
-                             // Check if we're in the "on" phase of the cycle
-                             uint16_t cycleMinutes = currentMinuteOfDay % relayManager->_cycleConfig.intervalMinutes;
-                             bool shouldBeOn = (cycleMinutes >= relayManager->_cycleConfig.onDurationMinutes);
+                             // Check if we're in the "off" phase of the cycle
+                             bool shouldBeOn = !cycleOn;
                              
                              // Only turn on in the second half of the interval
                              if (shouldBeOn) {
@@ -893,13 +1196,12 @@
                              bool shouldBeOn = false;
                              
                              // Check cycle timing
-                             uint16_t cycleMinutes = currentMinuteOfDay % relayManager->_cycleConfig.intervalMinutes;
-                             if (cycleMinutes < relayManager->_cycleConfig.onDurationMinutes) {
+                             if (cycleOn) {
                                  shouldBeOn = true;
                              }
                              
                              // Also check CO2 level
-                             if (scd.valid && scd.co2 < relayManager->_thresholds.co2Low) {
+                             if (hasCo2 && tent.reading.co2 < relayManager->_thresholds.co2Low) {
                                  shouldBeOn = true;
                              }
                              
@@ -928,18 +1230,9 @@
                          
                      case 5: // Humidifier
                          // Run based on humidity level in operating time
-                         if (inOperatingTime && validSensors > 0) {
-                             bool shouldBeOn = false;
-                             
-                             // Check humidity level
-                             if (avgHumidity < relayManager->_thresholds.humidityLow) {
-                                 shouldBeOn = true;
-                             } else if (avgHumidity >= relayManager->_thresholds.humidityHigh) {
-                                 shouldBeOn = false;
-                             } else {
-                                 // Between thresholds, maintain current state
-                                 shouldBeOn = config.isOn;
-                             }
+                         if (inOperatingTime && hasReading) {
+                             // Check humidity level with the relay's control strategy
+                             bool shouldBeOn = relayManager->evaluateControl(relayId, tent.reading.humidity, config.isOn);
                              
                              // Run together with IN/OUT Fans (Relay 7)
                              if (relayManager->_relayConfigs[7].isOn) {
@@ -960,30 +1253,26 @@
                                  relayManager->physicallyControlRelay(relayId, false, RelayTrigger::ENVIRONMENTAL);
                              }
                          } else {
+                             // Control is skipped, the loop starts over with the next reading
+                             relayManager->resetControl(relayId);
                              relayManager->physicallyControlRelay(relayId, false, RelayTrigger::SCHEDULE);
                          }
                          break;
                          
                      case 6: // Heater
                          // Run based on temperature level
-                         if (validSensors > 0) {
-                             bool shouldBeOn = false;
-                             
-                             // Check temperature level
-                             if (avgTemperature < relayManager->_thresholds.temperatureLow) {
-                                 shouldBeOn = true;
-                             } else if (avgTemperature >= relayManager->_thresholds.temperatureHigh) {
-                                 shouldBeOn = false;
-                             } else {
-                                 // Between thresholds, maintain current state
-                                 shouldBeOn = config.isOn;
-                             }
+                         if (hasReading) {
+                             // Check temperature level with the relay's control strategy
+                             bool shouldBeOn = relayManager->evaluateControl(relayId, tent.reading.temperature, config.isOn);
                              
                              if (shouldBeOn) {
                                  relayManager->physicallyControlRelay(relayId, true, RelayTrigger::ENVIRONMENTAL);
                              } else {
                                  relayManager->physicallyControlRelay(relayId, false, RelayTrigger::ENVIRONMENTAL);
                              }
+                         } else {
+                             // Control is skipped, the loop starts over with the next reading
+                             relayManager->resetControl(relayId);
                          }
                          break;
                          
@@ -993,16 +1282,15 @@
                              bool shouldBeOn = false;
                              
                              // Check cycle timing
-                             uint16_t cycleMinutes = currentMinuteOfDay % relayManager->_cycleConfig.intervalMinutes;
-                             if (cycleMinutes < relayManager->_cycleConfig.onDurationMinutes) {
+                             if (cycleOn) {
                                  shouldBeOn = true;
                              }
                              
                              // Also check CO2 level
-                             if (scd.valid) {
-                                 if (scd.co2 > relayManager->_thresholds.co2High) {
+                             if (hasCo2) {
+                                 if (tent.reading.co2 > relayManager->_thresholds.co2High) {
                                      shouldBeOn = true;
-                                 } else if (scd.co2 < relayManager->_thresholds.co2Low && shouldBeOn) {
+                                 } else if (tent.reading.co2 < relayManager->_thresholds.co2Low && shouldBeOn) {
                                      // Only turn off due to CO2 if it's already on due to cycling
                                      shouldBeOn = false;
                                  }
@@ -1033,8 +1321,15 @@
              }
          }
          
-         // Wait for the next control period (check every 10 seconds)
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(10000));
+         LatencyMonitor::record(loopLatency, static_cast<uint32_t>(esp_timer_get_time() - passStart));
+         
+         // Sleep until a new sample, an override or config change, the next
+         // schedule boundary or override expiry, whichever comes first
+         uint32_t wakeReasons = 0;
+         TickType_t sleepTicks = pdMS_TO_TICKS(relayManager->msUntilNextEvent());
+         xTaskNotifyWait(0, UINT32_MAX, &wakeReasons, sleepTicks);
+         LOG_DEBUG("Relays", "Control loop woke (reasons 0x%02lx, planned sleep %lu ticks)", 
+                   static_cast<unsigned long>(wakeReasons), static_cast<unsigned long>(sleepTicks));
      }
  }
                  /**
@@ -13,73 +13,18 @@
  #include <freertos/queue.h>
  #include <vector>
  #include <map>
+ #include <memory>
+ #include <atomic>
  #include <time.h>
  #include "../utils/Constants.h"
+ #include "ScheduleTimeline.h"
+ #include "ControlStrategy.h"
+ #include "RelayBackend.h"
  
  // Forward declarations
  class AppCore;
  class SensorManager;
  
- /**
-  * @struct TimeRange
-  * @brief Structure to hold operating time range
-  */
- struct TimeRange {
-     uint8_t startHour;
-     uint8_t startMinute;
-     uint8_t endHour;
-     uint8_t endMinute;
-     
-     TimeRange() : startHour(0), startMinute(0), endHour(23), endMinute(59) {}
-     
-     TimeRange(uint8_t sh, uint8_t sm, uint8_t eh, uint8_t em) 
-         : startHour(sh), startMinute(sm), endHour(eh), endMinute(em) {}
-     
-     String toString() const {
-         char buffer[12];
-         sprintf(buffer, "%02d:%02d-%02d:%02d", startHour, startMinute, endHour, endMinute);
-         return String(buffer);
-     }
-     
-     void fromString(const String& str) {
-         if (sscanf(str.c_str(), "%hhu:%hhu-%hhu:%hhu", &startHour, &startMinute, &endHour, &endMinute) != 4) {
-             // Default to all day if parsing fails
-             startHour = 0;
-             startMinute = 0;
-             endHour = 23;
-             endMinute = 59;
-         }
-     }
-     
-     bool isInRange(uint8_t hour, uint8_t minute) const {
-         uint16_t currentMinutes = hour * 60 + minute;
-         uint16_t startMinutes = startHour * 60 + startMinute;
-         uint16_t endMinutes = endHour * 60 + endMinute;
-         
-         if (endMinutes >= startMinutes) {
-             // Normal range (e.g., 08:00-16:00)
-             return currentMinutes >= startMinutes && currentMinutes <= endMinutes;
-         } else {
-             // Overnight range (e.g., 22:00-06:00)
-             return currentMinutes >= startMinutes || currentMinutes <= endMinutes;
-         }
-     }
- };
- 
- /**
-  * @struct CycleConfig
-  * @brief Structure to hold cycle configuration for relays
-  */
- struct CycleConfig {
-     uint16_t onDurationMinutes;
-     uint16_t intervalMinutes;
-     
-     CycleConfig() : onDurationMinutes(5), intervalMinutes(60) {}
-     
-     CycleConfig(uint16_t on, uint16_t interval) 
-         : onDurationMinutes(on), intervalMinutes(interval) {}
- };
- 
  /**
   * @struct RelayConfig
   * @brief Structure to hold relay configuration
@@ -96,6 +41,8 @@
      RelayState state;
      RelayTrigger lastTrigger;
      uint32_t overrideUntil;  // Time in millis when override expires
+     RelayBackendType backend;  // What actually switches the load
+     String backendDevice;      // Tapo device ID for a TAPO backend
      
      RelayConfig() : 
          relayId(0),
@@ -107,7 +54,9 @@
          isOn(false),
          state(RelayState::OFF),
          lastTrigger(RelayTrigger::MANUAL),
-         overrideUntil(0) {}
+         overrideUntil(0),
+         backend(RelayBackendType::GPIO),
+         backendDevice("") {}
  };
  
  /**
@@ -131,9 +80,42 @@
          co2High(Constants::DEFAULT_CO2_HIGH_THRESHOLD) {}
  };
  
+ /**
+  * @struct RelayStatus
+  * @brief Everything the dashboard shows about the relays, copied under one lock
+  */
+ struct RelayStatus {
+     std::vector<RelayConfig> relays;
+     EnvironmentalThresholds thresholds;
+     CycleConfig cycle;
+     uint16_t overrideDurationMinutes;
+     
+     RelayStatus() : overrideDurationMinutes(Constants::DEFAULT_USER_OVERRIDE_TIME_MIN) {}
+ };
+ 
+ /**
+  * @struct ThresholdRamp
+  * @brief Linear transition of the environmental thresholds between two sets of values
+  */
+ struct ThresholdRamp {
+     EnvironmentalThresholds from;
+     EnvironmentalThresholds to;
+     time_t start;                 // Unix time at which the values equal "from"
+     uint32_t durationSeconds;     // Time after start at which they reach "to"
+     bool active;
+     
+     ThresholdRamp() : start(0), durationSeconds(0), active(false) {}
+ };
+ 
  /**
   * @class RelayManager
   * @brief Manages relay operations with scheduling, dependencies, and automation
+  *
+  * Each relay ID is switched through a RelayBackend: its GPIO pin, or a
+  * Tapo plug whose relay replacement names it. The automation only sees
+  * the relay ID, so schedules, dependencies, environmental control and
+  * overrides work the same for both. Plug commands are queued for the
+  * Tapo workers, a slow plug never holds up the control loop.
   */
  class RelayManager {
  public:
@@ -167,6 +149,14 @@
       */
      uint8_t getRelayPin(uint8_t relayId);
      
+     /**
+      * @brief Bind each relay to the Tapo plug that replaces it, or back to its pin
+      *
+      * The new backend takes over the relay's current state. Called by the
+      * Tapo manager whenever its device list changes.
+      */
+     void refreshBackends();
+     
      /**
       * @brief Set relay name
       * @param relayId Relay ID (1-8)
@@ -278,6 +268,41 @@
                                     float& temperatureLow, float& temperatureHigh,
                                     float& co2Low, float& co2High);
      
+     /**
+      * @brief Move the environmental thresholds linearly from one set to another
+      *
+      * The control task interpolates the thresholds on every pass until the
+      * ramp ends; setEnvironmentalThresholds() cancels a running ramp.
+      * @param from Thresholds at the start time
+      * @param to Thresholds once the duration has elapsed
+      * @param start Unix time the ramp starts (may be in the past)
+      * @param durationSeconds Length of the ramp
+      * @return True if the ramp was started
+      */
+     bool startThresholdRamp(const EnvironmentalThresholds& from, const EnvironmentalThresholds& to,
+                             time_t start, uint32_t durationSeconds);
+     
+     /**
+      * @brief Stop a running threshold ramp, keeping the current values
+      */
+     void cancelThresholdRamp();
+     
+     /**
+      * @brief Set the control strategy of an environmental relay
+      * @param relayId Relay ID (5 for the humidifier, 6 for the heater)
+      * @param settings Control mode, PID tuning and minimum dwell times
+      * @return True if settings applied successfully
+      */
+     bool setControlSettings(uint8_t relayId, const ControlSettings& settings);
+     
+     /**
+      * @brief Get the control strategy of an environmental relay
+      * @param relayId Relay ID (5 for the humidifier, 6 for the heater)
+      * @param settings Output parameter for the control settings
+      * @return True if settings retrieved successfully
+      */
+     bool getControlSettings(uint8_t relayId, ControlSettings& settings);
+     
      /**
       * @brief Set user override duration
       * @param minutes Override duration in minutes
@@ -326,21 +351,70 @@
       */
      std::vector<RelayConfig> getAllRelayConfigs();
      
+     /**
+      * @brief Get relays, thresholds, cycle and override duration in one lock
+      * @param status Output parameter for the relay status
+      * @return True if the status was retrieved successfully
+      */
+     bool getStatus(RelayStatus& status);
+     
+     /**
+      * @brief Get which relays are on without taking the relay mutex
+      * @return Bit n-1 set while relay n is on
+      */
+     uint8_t getOnMask() const { return _onMask.load(std::memory_order_relaxed); }
+     
+     /**
+      * @brief Get upcoming schedule slots for preview
+      * @param events Output list of slots, starting with the active one
+      * @param nextTransition Output parameter for the next schedule change
+      * @return True if the preview was retrieved successfully
+      */
+     bool getSchedulePreview(std::vector<ScheduleEvent>& events, time_t& nextTransition);
+     
      /**
       * @brief Create RTOS tasks for relay operations
       */
      void createTasks();
      
+     /**
+      * @brief Wake the relay control task so it re-evaluates immediately
+      * @param reason Bitmask of WAKE_* flags (non-blocking, safe before tasks exist)
+      */
+     void notifyControlTask(uint32_t reason);
+     
+     // Reasons for waking the relay control task (task notification bits)
+     static constexpr uint32_t WAKE_SENSORS = 0x01;   // New sensor sample available
+     static constexpr uint32_t WAKE_OVERRIDE = 0x02;  // Manual override set or cleared
+     static constexpr uint32_t WAKE_CONFIG = 0x04;    // Schedule, cycle or threshold changed
+     static constexpr uint32_t WAKE_RESUME = 0x08;    // Back from a light sleep
+     
+     /**
+      * @brief Get the time until the control loop has to act next
+      * @return Milliseconds until the next schedule edge, override expiry or PID change
+      */
+     uint32_t msUntilNextEvent();
+     
  private:
      // Relay configurations
      std::map<uint8_t, RelayConfig> _relayConfigs;
      
-     // Environmental thresholds
+     // Actuator of each relay, guarded by _relayMutex
+     std::map<uint8_t, std::unique_ptr<RelayBackend>> _backends;
+     
+     // Environmental thresholds, interpolated by the control task while a ramp runs
      EnvironmentalThresholds _thresholds;
+     ThresholdRamp _thresholdRamp;
+     
+     // Control loops for the environmental relays, keyed by relay ID
+     std::map<uint8_t, ControlLoop> _controlLoops;
      
      // Cycle configuration
      CycleConfig _cycleConfig;
      
+     // Operating windows and cycle phases compiled into a daily timeline
+     ScheduleTimeline _timeline;
+     
      // User override duration in minutes
      uint16_t _overrideDurationMinutes;
      
@@ -351,11 +425,20 @@
      // Status tracking
      bool _isInitialized;
      
+     // Copy of the isOn flags for lock-free readers, written under _relayMutex
+     std::atomic<uint8_t> _onMask;
+     
      // Private methods
      bool physicallyControlRelay(uint8_t relayId, bool turnOn, RelayTrigger trigger);
+     void bindBackend(uint8_t relayId, RelayBackend* backend);
      bool checkDependencyChain(uint8_t relayId);
      bool isInOperatingTime(uint8_t relayId);
      void manageDependentRelays(uint8_t relayId, bool turnOn);
+     bool expireOverride(uint8_t relayId);
+     void rebuildTimeline();
+     bool evaluateControl(uint8_t relayId, float measurement, bool isOn);
+     void resetControl(uint8_t relayId);
+     void advanceThresholdRamp(time_t now);
      
      // Task functions
      static void relayControlTask(void* parameter);
@@ -0,0 +1,131 @@
+/**
+ * @file ScheduleTimeline.cpp
+ * @brief Implementation of the ScheduleTimeline class
+ */
+
+ #include "ScheduleTimeline.h"
+ #include <algorithm>
+
+ static constexpr uint16_t MINUTES_PER_DAY = 1440;
+
+ ScheduleTimeline::ScheduleTimeline() :
+     _current(0),
+     _slotStart(0),
+     _nextTransition(0),
+     _located(false)
+ {
+     // Until build() runs every relay is in its default all-day window
+     _slots.push_back({0, 0xFF, false});
+ }
+
+ void ScheduleTimeline::build(const TimeRange* windows, uint8_t count, const CycleConfig& cycle) {
+     count = min(count, static_cast<uint8_t>(8));
+
+     // Collect every minute at which something may change
+     std::vector<uint16_t> edges;
+     edges.push_back(0);
+     for (uint8_t i = 0; i < count; i++) {
+         edges.push_back(windows[i].startHour * 60 + windows[i].startMinute);
+         edges.push_back((windows[i].endHour * 60 + windows[i].endMinute + 1) % MINUTES_PER_DAY);
+     }
+     if (cycle.intervalMinutes > 0) {
+         for (uint16_t minute = 0; minute < MINUTES_PER_DAY; minute += cycle.intervalMinutes) {
+             edges.push_back(minute);
+             if (minute + cycle.onDurationMinutes < MINUTES_PER_DAY) {
+                 edges.push_back(minute + cycle.onDurationMinutes);
+             }
+         }
+     }
+     std::sort(edges.begin(), edges.end());
+     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+     // Evaluate each edge once and drop the ones that change nothing
+     _slots.clear();
+     for (uint16_t minute : edges) {
+         ScheduleSlot slot;
+         slot.startMinute = minute;
+         slot.windowMask = 0;
+         for (uint8_t i = 0; i < count; i++) {
+             if (windows[i].isInRange(minute / 60, minute % 60)) {
+                 slot.windowMask |= (1 << i);
+             }
+         }
+         slot.cycleOn = cycle.intervalMinutes > 0 &&
+             (minute % cycle.intervalMinutes) < cycle.onDurationMinutes;
+
+         // Keep the midnight slot so every minute of the day is covered
+         if (!_slots.empty() && _slots.back().windowMask == slot.windowMask &&
+             _slots.back().cycleOn == slot.cycleOn) {
+             continue;
+         }
+         _slots.push_back(slot);
+     }
+     _slots.shrink_to_fit();
+
+     // Force the next update() to re-locate
+     _located = false;
+     _nextTransition = 0;
+ }
+
+ bool ScheduleTimeline::update(time_t now) {
+     if (_located && now >= _slotStart && now < _nextTransition) {
+         return false;
+     }
+
+     size_t previous = _current;
+     bool wasLocated = _located;
+     locate(now);
+     return !wasLocated || previous != _current;
+ }
+
+ bool ScheduleTimeline::isInWindow(uint8_t relayId) const {
+     if (relayId < 1 || relayId > 8) {
+         return false;
+     }
+     return (_slots[_current].windowMask & (1 << (relayId - 1))) != 0;
+ }
+
+ bool ScheduleTimeline::isCycleOn() const {
+     return _slots[_current].cycleOn;
+ }
+
+ void ScheduleTimeline::preview(time_t now, std::vector<ScheduleEvent>& events, size_t maxEvents) {
+     events.clear();
+     update(now);
+
+     // Walk forward from the active slot for at most one day
+     size_t index = _current;
+     time_t start = _slotStart;
+     time_t midnight = _slotStart - static_cast<time_t>(_slots[_current].startMinute) * 60;
+     for (size_t i = 0; i < _slots.size() && events.size() < maxEvents; i++) {
+         ScheduleEvent event;
+         event.time = start;
+         event.windowMask = _slots[index].windowMask;
+         event.cycleOn = _slots[index].cycleOn;
+         events.push_back(event);
+
+         index++;
+         if (index == _slots.size()) {
+             index = 0;
+             midnight += static_cast<time_t>(MINUTES_PER_DAY) * 60;
+         }
+         start = midnight + static_cast<time_t>(_slots[index].startMinute) * 60;
+     }
+ }
+
+ void ScheduleTimeline::locate(time_t now) {
+     struct tm timeInfo;
+     localtime_r(&now, &timeInfo);
+     uint16_t minuteOfDay = timeInfo.tm_hour * 60 + timeInfo.tm_min;
+     time_t midnight = now - (minuteOfDay * 60 + timeInfo.tm_sec);
+
+     // Last slot starting at or before the current minute (slot 0 starts at midnight)
+     auto it = std::upper_bound(_slots.begin(), _slots.end(), minuteOfDay,
+         [](uint16_t minute, const ScheduleSlot& slot) { return minute < slot.startMinute; });
+     _current = (it - _slots.begin()) - 1;
+
+     uint16_t endMinute = (_current + 1 < _slots.size()) ? _slots[_current + 1].startMinute : MINUTES_PER_DAY;
+     _slotStart = midnight + static_cast<time_t>(_slots[_current].startMinute) * 60;
+     _nextTransition = midnight + static_cast<time_t>(endMinute) * 60;
+     _located = true;
+ }
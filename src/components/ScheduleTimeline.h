@@ -0,0 +1,162 @@
+/**
+ * @file ScheduleTimeline.h
+ * @brief Precompiled daily timeline of relay operating windows and cycle phases
+ */
+
+ #ifndef SCHEDULE_TIMELINE_H
+ #define SCHEDULE_TIMELINE_H
+
+ #include <Arduino.h>
+ #include <vector>
+ #include <time.h>
+
+ /**
+  * @struct TimeRange
+  * @brief Structure to hold operating time range
+  */
+ struct TimeRange {
+     uint8_t startHour;
+     uint8_t startMinute;
+     uint8_t endHour;
+     uint8_t endMinute;
+
+     TimeRange() : startHour(0), startMinute(0), endHour(23), endMinute(59) {}
+
+     TimeRange(uint8_t sh, uint8_t sm, uint8_t eh, uint8_t em)
+         : startHour(sh), startMinute(sm), endHour(eh), endMinute(em) {}
+
+     String toString() const {
+         char buffer[12];
+         sprintf(buffer, "%02d:%02d-%02d:%02d", startHour, startMinute, endHour, endMinute);
+         return String(buffer);
+     }
+
+     void fromString(const String& str) {
+         if (sscanf(str.c_str(), "%hhu:%hhu-%hhu:%hhu", &startHour, &startMinute, &endHour, &endMinute) != 4) {
+             // Default to all day if parsing fails
+             startHour = 0;
+             startMinute = 0;
+             endHour = 23;
+             endMinute = 59;
+         }
+     }
+
+     bool isInRange(uint8_t hour, uint8_t minute) const {
+         uint16_t currentMinutes = hour * 60 + minute;
+         uint16_t startMinutes = startHour * 60 + startMinute;
+         uint16_t endMinutes = endHour * 60 + endMinute;
+
+         if (endMinutes >= startMinutes) {
+             // Normal range (e.g., 08:00-16:00)
+             return currentMinutes >= startMinutes && currentMinutes <= endMinutes;
+         } else {
+             // Overnight range (e.g., 22:00-06:00)
+             return currentMinutes >= startMinutes || currentMinutes <= endMinutes;
+         }
+     }
+ };
+
+ /**
+  * @struct CycleConfig
+  * @brief Structure to hold cycle configuration for relays
+  */
+ struct CycleConfig {
+     uint16_t onDurationMinutes;
+     uint16_t intervalMinutes;
+
+     CycleConfig() : onDurationMinutes(5), intervalMinutes(60) {}
+
+     CycleConfig(uint16_t on, uint16_t interval)
+         : onDurationMinutes(on), intervalMinutes(interval) {}
+ };
+
+ /**
+  * @struct ScheduleSlot
+  * @brief One stretch of the day during which no window or cycle phase changes
+  */
+ struct ScheduleSlot {
+     uint16_t startMinute;    // Minute of day the slot begins (0-1439)
+     uint8_t windowMask;      // Bit (relayId - 1) set while that relay is inside its operating window
+     bool cycleOn;            // Cycle is in its ON phase
+ };
+
+ /**
+  * @struct ScheduleEvent
+  * @brief A slot placed on the wall clock, as returned by ScheduleTimeline::preview
+  */
+ struct ScheduleEvent {
+     time_t time;             // Local time the slot begins
+     uint8_t windowMask;
+     bool cycleOn;
+ };
+
+ /**
+  * @class ScheduleTimeline
+  * @brief Sorted table of the day's schedule transitions with a cursor for "now"
+  *
+  * build() merges every relay's operating window edges and the cycle phase
+  * boundaries into a list of slots, so the control loop no longer evaluates
+  * minute-of-day comparisons per relay. update() only compares the current
+  * time against the cached end of the active slot and re-locates the cursor
+  * (binary search) when it is crossed or the clock jumps. The end of the
+  * active slot is also the exact instant the schedule next changes. The
+  * timeline is not thread-safe; callers are expected to hold their own lock.
+  */
+ class ScheduleTimeline {
+ public:
+     ScheduleTimeline();
+
+     /**
+      * @brief Rebuild the timeline from the current windows and cycle
+      * @param windows Operating windows, index 0 is relay 1
+      * @param count Number of windows (at most 8)
+      * @param cycle Cycle configuration shared by the cycled relays
+      */
+     void build(const TimeRange* windows, uint8_t count, const CycleConfig& cycle);
+
+     /**
+      * @brief Move the cursor to the slot covering a point in time
+      * @param now Current time
+      * @return True if the active slot changed
+      */
+     bool update(time_t now);
+
+     /**
+      * @brief Check whether a relay is inside its operating window in the active slot
+      * @param relayId Relay ID (1-8)
+      */
+     bool isInWindow(uint8_t relayId) const;
+
+     /**
+      * @brief Check whether the cycle is in its ON phase in the active slot
+      */
+     bool isCycleOn() const;
+
+     /**
+      * @brief Get the instant the active slot ends
+      * @return Local time of the next transition, 0 before the first update()
+      */
+     time_t getNextTransition() const { return _nextTransition; }
+
+     /**
+      * @brief List upcoming slots, starting with the active one
+      * @param now Current time
+      * @param events Output list (cleared first)
+      * @param maxEvents Maximum number of slots to return
+      */
+     void preview(time_t now, std::vector<ScheduleEvent>& events, size_t maxEvents);
+
+     size_t size() const { return _slots.size(); }
+
+ private:
+     std::vector<ScheduleSlot> _slots;
+     size_t _current;
+     time_t _slotStart;
+     time_t _nextTransition;
+     bool _located;
+
+     // Private methods
+     void locate(time_t now);
+ };
+
+ #endif // SCHEDULE_TIMELINE_H
@@ -0,0 +1,139 @@
+/**
+ * @file SensorFusion.cpp
+ * @brief Implementation of the SensorFusion class
+ */
+
+ #include "SensorFusion.h"
+ 
+ ChannelFilter::ChannelFilter() {
+     reset();
+ }
+ 
+ void ChannelFilter::reset() {
+     _count = 0;
+     _next = 0;
+     _ema = NAN;
+ }
+ 
+ float ChannelFilter::add(float value) {
+     _window[_next] = value;
+     _next = (_next + 1) % Constants::SENSOR_FUSION_MEDIAN_WINDOW;
+     if (_count < Constants::SENSOR_FUSION_MEDIAN_WINDOW) {
+         _count++;
+     }
+     
+     // Insertion sort of at most five values
+     float sorted[Constants::SENSOR_FUSION_MEDIAN_WINDOW];
+     for (uint8_t i = 0; i < _count; i++) {
+         float v = _window[i];
+         uint8_t j = i;
+         while (j > 0 && sorted[j - 1] > v) {
+             sorted[j] = sorted[j - 1];
+             j--;
+         }
+         sorted[j] = v;
+     }
+     float median = sorted[_count / 2];
+     
+     _ema = isnan(_ema) ? median : _ema + Constants::SENSOR_FUSION_EMA_ALPHA * (median - _ema);
+     return _ema;
+ }
+ 
+ SensorFusion::SensorFusion() {
+     reset();
+ }
+ 
+ void SensorFusion::reset() {
+     for (auto& source : _sources) {
+         source.temperature.reset();
+         source.humidity.reset();
+         source.co2.reset();
+         source.timestamp = 0;
+     }
+     
+     _fused.reading = {0.0f, 0.0f, 0.0f, 0, false};
+     _fused.confidence = 0.0f;
+     _fused.sourceMask = 0;
+     _fused.hasCo2 = false;
+ }
+ 
+ const FusedReading& SensorFusion::addSample(uint8_t sensorId, const SensorReading& sample) {
+     if (sensorId >= SOURCE_COUNT) {
+         return _fused;
+     }
+     
+     Source& source = _sources[sensorId];
+     source.temperature.add(sample.temperature);
+     source.humidity.add(sample.humidity);
+     if (sensorId == 2) {
+         source.co2.add(sample.co2);
+     }
+     source.timestamp = sample.timestamp;
+     
+     // Sensors that stopped delivering drop out after a while
+     uint8_t freshMask = 0;
+     float temperatures[SOURCE_COUNT];
+     float humidities[SOURCE_COUNT];
+     for (uint8_t i = 0; i < SOURCE_COUNT; i++) {
+         const Source& s = _sources[i];
+         if (s.temperature.hasValue() && sample.timestamp - s.timestamp <= Constants::SENSOR_FUSION_MAX_AGE_S) {
+             freshMask |= 1 << i;
+         }
+         temperatures[i] = s.temperature.value();
+         humidities[i] = s.humidity.value();
+     }
+     
+     uint8_t temperatureMask = 0;
+     uint8_t humidityMask = 0;
+     float temperature = fuseChannel(temperatures, freshMask, Constants::SENSOR_FUSION_TEMPERATURE_TOLERANCE, temperatureMask);
+     float humidity = fuseChannel(humidities, freshMask, Constants::SENSOR_FUSION_HUMIDITY_TOLERANCE, humidityMask);
+     
+     _fused.hasCo2 = (freshMask & 0x04) != 0;
+     _fused.reading.temperature = temperature;
+     _fused.reading.humidity = humidity;
+     _fused.reading.co2 = _fused.hasCo2 ? _sources[2].co2.value() : 0.0f;
+     _fused.reading.timestamp = sample.timestamp;
+     _fused.reading.valid = !isnan(temperature) && !isnan(humidity);
+     _fused.sourceMask = temperatureMask & humidityMask;
+     _fused.confidence = min(__builtin_popcount(temperatureMask), __builtin_popcount(humidityMask)) /
+                         static_cast<float>(SOURCE_COUNT);
+     return _fused;
+ }
+ 
+ float SensorFusion::fuseChannel(const float* values, uint8_t freshMask, float tolerance, uint8_t& agreeMask) {
+     float fresh[SOURCE_COUNT];
+     uint8_t count = 0;
+     for (uint8_t i = 0; i < SOURCE_COUNT; i++) {
+         if (freshMask & (1 << i)) {
+             fresh[count++] = values[i];
+         }
+     }
+     
+     agreeMask = 0;
+     if (count == 0) {
+         return NAN;
+     }
+     
+     // Reference is the median of three, or the mean of two
+     float reference;
+     if (count == 3) {
+         reference = max(min(fresh[0], fresh[1]), min(max(fresh[0], fresh[1]), fresh[2]));
+     } else if (count == 2) {
+         reference = (fresh[0] + fresh[1]) / 2.0f;
+     } else {
+         reference = fresh[0];
+     }
+     
+     float sum = 0.0f;
+     uint8_t used = 0;
+     for (uint8_t i = 0; i < SOURCE_COUNT; i++) {
+         if ((freshMask & (1 << i)) && fabsf(values[i] - reference) <= tolerance) {
+             sum += values[i];
+             used++;
+             agreeMask |= 1 << i;
+         }
+     }
+     
+     // Two sensors that disagree: no way to tell which is right, report the mean
+     return used > 0 ? sum / used : reference;
+ }
\ No newline at end of file
@@ -0,0 +1,104 @@
+/**
+ * @file SensorFusion.h
+ * @brief Per-channel filtering and cross-sensor fusion of the tent readings
+ */
+
+ #ifndef SENSOR_FUSION_H
+ #define SENSOR_FUSION_H
+
+ #include <Arduino.h>
+ #include "../utils/Constants.h"
+ #include "SensorHistory.h"
+
+ /**
+  * @struct FusedReading
+  * @brief Tent temperature, humidity and CO2 derived from all sensors
+  */
+ struct FusedReading {
+     SensorReading reading;    // co2 is 0 without a fresh SCD40 sample
+     float confidence;         // 0..1, share of the three sensors that agree with each other
+     uint8_t sourceMask;       // Bit 0 upper DHT, bit 1 lower DHT, bit 2 SCD40 went into the values
+     bool hasCo2;
+ };
+
+ /**
+  * @class ChannelFilter
+  * @brief Median of the last samples followed by an exponential moving average
+  *
+  * The median drops isolated spikes (up to two in a window of five) before
+  * they reach the average, which then smooths the sensor noise.
+  */
+ class ChannelFilter {
+ public:
+     ChannelFilter();
+
+     /**
+      * @brief Forget all samples
+      */
+     void reset();
+
+     /**
+      * @brief Add a sample
+      * @param value Raw sample
+      * @return Filtered value
+      */
+     float add(float value);
+
+     float value() const { return _ema; }
+     bool hasValue() const { return _count > 0; }
+
+ private:
+     float _window[Constants::SENSOR_FUSION_MEDIAN_WINDOW];
+     uint8_t _count;
+     uint8_t _next;
+     float _ema;
+ };
+
+ /**
+  * @class SensorFusion
+  * @brief Turns the samples of the two DHT22s and the SCD40 into one tent reading
+  *
+  * Every sample is filtered per sensor and channel, then the tent values are
+  * recomputed from the filtered values of all sensors with a sample in the
+  * last SENSOR_FUSION_MAX_AGE_S seconds. With three sensors a value further
+  * than the tolerance from their median is left out; with two that disagree
+  * both are averaged at low confidence. The work per sample is a handful of
+  * float operations. Not thread-safe, SensorManager calls it under its lock.
+  */
+ class SensorFusion {
+ public:
+     static constexpr uint8_t SOURCE_COUNT = 3;
+
+     SensorFusion();
+
+     /**
+      * @brief Forget all samples
+      */
+     void reset();
+
+     /**
+      * @brief Add a valid sample and update the tent reading
+      * @param sensorId 0 for upper DHT22, 1 for lower DHT22, 2 for SCD40
+      * @param sample Raw sample
+      * @return Updated tent reading
+      */
+     const FusedReading& addSample(uint8_t sensorId, const SensorReading& sample);
+
+     const FusedReading& getReading() const { return _fused; }
+
+ private:
+     struct Source {
+         ChannelFilter temperature;
+         ChannelFilter humidity;
+         ChannelFilter co2;
+         uint32_t timestamp;
+     };
+
+     Source _sources[SOURCE_COUNT];
+     FusedReading _fused;
+
+     // Private methods
+     static float fuseChannel(const float* values, uint8_t freshMask, float tolerance, uint8_t& agreeMask);
+ };
+
+ #endif // SENSOR_FUSION_H
@@ -0,0 +1,225 @@
+/**
+ * @file SensorHistory.cpp
+ * @brief Implementation of the SensorHistory class
+ */
+
+ #include "SensorHistory.h"
+ #include "../utils/Constants.h"
+
+ namespace {
+     constexpr HistoryTier kRollupTiers[SensorHistory::ROLLUP_TIER_COUNT] = {
+         HistoryTier::MINUTE,
+         HistoryTier::QUARTER_HOUR,
+         HistoryTier::HOUR
+     };
+
+     int16_t toCenti(float value) {
+         return (int16_t)constrain(lroundf(value * 100.0f), -32768L, 32767L);
+     }
+
+     uint16_t toPpm(float value) {
+         return (uint16_t)constrain(lroundf(value), 0L, 65535L);
+     }
+ }
+
+ SensorHistory::SensorHistory() {
+     for (uint8_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+         resetAccumulator(_pending[i], 0);
+     }
+ }
+
+ bool SensorHistory::begin(size_t rawCapacity) {
+     bool success = _raw.reset(rawCapacity);
+
+     for (uint8_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+         success = _rollups[i].reset(rollupCapacity(kRollupTiers[i])) && success;
+         resetAccumulator(_pending[i], 0);
+     }
+
+     return success;
+ }
+
+ bool SensorHistory::add(const SensorReading& reading) {
+     bool minuteClosed = false;
+     _raw.push(reading);
+
+     for (uint8_t i = 0; i < ROLLUP_TIER_COUNT; i++) {
+         uint32_t resolution = resolutionSeconds(kRollupTiers[i]);
+         uint32_t bucketStart = reading.timestamp - (reading.timestamp % resolution);
+         Accumulator& acc = _pending[i];
+
+         // A clock that runs behind restored buckets (no NTP yet) must not reopen them
+         if (acc.count > 0 && bucketStart < acc.bucketStart) {
+             continue;
+         }
+
+         // Close the open bucket once a reading lands in a later one
+         if (acc.count > 0 && acc.bucketStart != bucketStart) {
+             _rollups[i].push(closeAccumulator(acc));
+             resetAccumulator(acc, bucketStart);
+             minuteClosed = minuteClosed || (kRollupTiers[i] == HistoryTier::MINUTE);
+         } else if (acc.count == 0) {
+             resetAccumulator(acc, bucketStart);
+         }
+
+         accumulate(acc, reading);
+     }
+
+     return minuteClosed;
+ }
+
+ void SensorHistory::restoreRollup(const SensorRollup& minute) {
+     _rollups[0].push(minute);
+
+     // The 1-minute bucket is complete, only the coarser tiers need accumulating
+     for (uint8_t i = 1; i < ROLLUP_TIER_COUNT; i++) {
+         uint32_t resolution = resolutionSeconds(kRollupTiers[i]);
+         uint32_t bucketStart = minute.timestamp - (minute.timestamp % resolution);
+         Accumulator& acc = _pending[i];
+
+         if (acc.count > 0 && acc.bucketStart != bucketStart) {
+             _rollups[i].push(closeAccumulator(acc));
+             resetAccumulator(acc, bucketStart);
+         } else if (acc.count == 0) {
+             resetAccumulator(acc, bucketStart);
+         }
+
+         accumulateRollup(acc, minute);
+     }
+ }
+
+ size_t SensorHistory::size(HistoryTier tier) const {
+     if (tier == HistoryTier::RAW) {
+         return _raw.size();
+     }
+     return _rollups[static_cast<uint8_t>(tier) - 1].size();
+ }
+
+ uint32_t SensorHistory::sequenceEnd(HistoryTier tier) const {
+     if (tier == HistoryTier::RAW) {
+         return _raw.pushed();
+     }
+     return _rollups[static_cast<uint8_t>(tier) - 1].pushed();
+ }
+
+ const SensorRollup& SensorHistory::rollup(HistoryTier tier, size_t index) const {
+     return _rollups[static_cast<uint8_t>(tier) - 1][index];
+ }
+
+ const SensorRollup& SensorHistory::newestRollup(HistoryTier tier) const {
+     return _rollups[static_cast<uint8_t>(tier) - 1].newest();
+ }
+
+ HistoryTier SensorHistory::selectTier(uint32_t spanSeconds) const {
+     if (spanSeconds == 0 || _raw.empty()) {
+         return HistoryTier::RAW;
+     }
+
+     // The raw ring covers everything recorded so far until it wraps
+     uint32_t rawSpanSeconds = _raw.newest().timestamp - _raw[0].timestamp;
+     if (!_raw.full() || rawSpanSeconds >= spanSeconds) {
+         return HistoryTier::RAW;
+     }
+
+     for (uint8_t i = 0; i < ROLLUP_TIER_COUNT - 1; i++) {
+         uint32_t tierSpanSeconds = resolutionSeconds(kRollupTiers[i]) * rollupCapacity(kRollupTiers[i]);
+         if (tierSpanSeconds >= spanSeconds) {
+             return kRollupTiers[i];
+         }
+     }
+
+     return HistoryTier::HOUR;
+ }
+
+ uint32_t SensorHistory::resolutionSeconds(HistoryTier tier) {
+     switch (tier) {
+         case HistoryTier::MINUTE:       return 60UL;
+         case HistoryTier::QUARTER_HOUR: return 15UL * 60UL;
+         case HistoryTier::HOUR:         return 60UL * 60UL;
+         default:                        return 0;
+     }
+ }
+
+ size_t SensorHistory::rollupCapacity(HistoryTier tier) {
+     switch (tier) {
+         case HistoryTier::MINUTE:       return Constants::HISTORY_MINUTE_POINTS;
+         case HistoryTier::QUARTER_HOUR: return Constants::HISTORY_QUARTER_HOUR_POINTS;
+         case HistoryTier::HOUR:         return Constants::HISTORY_HOUR_POINTS;
+         default:                        return 0;
+     }
+ }
+
+ float SensorHistory::channelValue(const SensorReading& reading, uint8_t dataType) {
+     switch (dataType) {
+         case 0:  return reading.temperature;
+         case 1:  return reading.humidity;
+         case 2:  return reading.co2;
+         default: return 0.0f;
+     }
+ }
+
+ float SensorHistory::channelValue(const SensorRollup& rollup, uint8_t dataType) {
+     switch (dataType) {
+         case 0:  return rollup.temperatureAvg / 100.0f;
+         case 1:  return rollup.humidityAvg / 100.0f;
+         case 2:  return rollup.co2Avg;
+         default: return 0.0f;
+     }
+ }
+
+ void SensorHistory::resetAccumulator(Accumulator& acc, uint32_t bucketStart) {
+     acc.bucketStart = bucketStart;
+     acc.count = 0;
+     acc.temperatureSum = 0.0f;
+     acc.temperatureMin = INFINITY;
+     acc.temperatureMax = -INFINITY;
+     acc.humiditySum = 0.0f;
+     acc.humidityMin = INFINITY;
+     acc.humidityMax = -INFINITY;
+     acc.co2Sum = 0.0f;
+     acc.co2Min = INFINITY;
+     acc.co2Max = -INFINITY;
+ }
+
+ void SensorHistory::accumulate(Accumulator& acc, const SensorReading& reading) {
+     acc.count++;
+     acc.temperatureSum += reading.temperature;
+     acc.temperatureMin = min(acc.temperatureMin, reading.temperature);
+     acc.temperatureMax = max(acc.temperatureMax, reading.temperature);
+     acc.humiditySum += reading.humidity;
+     acc.humidityMin = min(acc.humidityMin, reading.humidity);
+     acc.humidityMax = max(acc.humidityMax, reading.humidity);
+     acc.co2Sum += reading.co2;
+     acc.co2Min = min(acc.co2Min, reading.co2);
+     acc.co2Max = max(acc.co2Max, reading.co2);
+ }
+
+ void SensorHistory::accumulateRollup(Accumulator& acc, const SensorRollup& rollup) {
+     // Weight the bucket average by its sample count so coarser averages stay exact
+     acc.count += rollup.count;
+     acc.temperatureSum += (rollup.temperatureAvg / 100.0f) * rollup.count;
+     acc.temperatureMin = min(acc.temperatureMin, rollup.temperatureMin / 100.0f);
+     acc.temperatureMax = max(acc.temperatureMax, rollup.temperatureMax / 100.0f);
+     acc.humiditySum += (rollup.humidityAvg / 100.0f) * rollup.count;
+     acc.humidityMin = min(acc.humidityMin, rollup.humidityMin / 100.0f);
+     acc.humidityMax = max(acc.humidityMax, rollup.humidityMax / 100.0f);
+     acc.co2Sum += (float)rollup.co2Avg * rollup.count;
+     acc.co2Min = min(acc.co2Min, (float)rollup.co2Min);
+     acc.co2Max = max(acc.co2Max, (float)rollup.co2Max);
+ }
+
+ SensorRollup SensorHistory::closeAccumulator(const Accumulator& acc) {
+     SensorRollup rollup;
+     rollup.timestamp = acc.bucketStart;
+     rollup.count = acc.count;
+     rollup.temperatureMin = toCenti(acc.temperatureMin);
+     rollup.temperatureAvg = toCenti(acc.temperatureSum / acc.count);
+     rollup.temperatureMax = toCenti(acc.temperatureMax);
+     rollup.humidityMin = toCenti(acc.humidityMin);
+     rollup.humidityAvg = toCenti(acc.humiditySum / acc.count);
+     rollup.humidityMax = toCenti(acc.humidityMax);
+     rollup.co2Min = toPpm(acc.co2Min);
+     rollup.co2Avg = toPpm(acc.co2Sum / acc.count);
+     rollup.co2Max = toPpm(acc.co2Max);
+     return rollup;
+ }
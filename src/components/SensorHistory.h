@@ -0,0 +1,183 @@
+/**
+ * @file SensorHistory.h
+ * @brief Multi-resolution history of readings for a single sensor
+ */
+
+ #ifndef SENSOR_HISTORY_H
+ #define SENSOR_HISTORY_H
+
+ #include <Arduino.h>
+ #include "../utils/RingBuffer.h"
+
+ /**
+  * @struct SensorReading
+  * @brief Structure to hold sensor data
+  */
+ struct SensorReading {
+     float temperature;
+     float humidity;
+     float co2;
+     uint32_t timestamp;      // Unix time in seconds (uptime seconds until NTP sync)
+     bool valid;
+ };
+
+ /**
+  * @enum HistoryTier
+  * @brief Resolution tiers kept by SensorHistory
+  */
+ enum class HistoryTier : uint8_t {
+     RAW = 0,
+     MINUTE,
+     QUARTER_HOUR,
+     HOUR
+ };
+
+ /**
+  * @struct SensorRollup
+  * @brief Min/avg/max of all readings that fell into one time bucket
+  *
+  * Values are stored in fixed point to keep the tiers small: temperature and
+  * humidity in hundredths, CO2 in whole ppm.
+  */
+ struct SensorRollup {
+     uint32_t timestamp;      // Bucket start in Unix seconds
+     uint16_t count;
+     int16_t temperatureMin;
+     int16_t temperatureAvg;
+     int16_t temperatureMax;
+     int16_t humidityMin;
+     int16_t humidityAvg;
+     int16_t humidityMax;
+     uint16_t co2Min;
+     uint16_t co2Avg;
+     uint16_t co2Max;
+ };
+
+ /**
+  * @class SensorHistory
+  * @brief Raw sample ring plus incrementally maintained 1 min / 15 min / 1 h rollups
+  *
+  * Every add() updates one open accumulator per tier and closes it into the
+  * tier's ring once the reading crosses a bucket boundary, so the cost per
+  * sample is constant regardless of how much time the tiers cover.
+  * Not thread-safe; SensorManager guards it with _sensorMutex.
+  */
+ class SensorHistory {
+ public:
+     static constexpr uint8_t ROLLUP_TIER_COUNT = 3;
+
+     SensorHistory();
+
+     /**
+      * @brief Allocate storage for all tiers, discarding existing contents
+      * @param rawCapacity Number of raw samples to keep
+      * @return True if all tiers were allocated
+      */
+     bool begin(size_t rawCapacity);
+
+     /**
+      * @brief Add a reading to the raw tier and update all rollups
+      * @param reading Valid sensor reading
+      * @return True if the reading closed a 1-minute bucket (see newestRollup())
+      */
+     bool add(const SensorReading& reading);
+
+     /**
+      * @brief Re-insert a persisted 1-minute bucket, folding it into the coarser tiers
+      * @param minute Bucket as produced by the MINUTE tier
+      */
+     void restoreRollup(const SensorRollup& minute);
+
+     /**
+      * @brief Get the number of entries stored in a tier
+      * @param tier Tier to query
+      * @return Entry count
+      */
+     size_t size(HistoryTier tier) const;
+
+     /**
+      * @brief Get the sequence number one past the newest entry of a tier
+      * @param tier Tier to query
+      * @return Total entries pushed into the tier since begin()
+      */
+     uint32_t sequenceEnd(HistoryTier tier) const;
+
+     /**
+      * @brief Get a raw sample by logical index (0 = oldest)
+      */
+     const SensorReading& raw(size_t index) const { return _raw[index]; }
+
+     /**
+      * @brief Get a rollup bucket by logical index (0 = oldest)
+      * @param tier Rollup tier (must not be RAW)
+      * @param index Logical index
+      */
+     const SensorRollup& rollup(HistoryTier tier, size_t index) const;
+
+     /**
+      * @brief Get the most recently closed bucket of a rollup tier
+      * @param tier Rollup tier (must not be RAW, tier must not be empty)
+      */
+     const SensorRollup& newestRollup(HistoryTier tier) const;
+
+     /**
+      * @brief Pick the finest tier that covers the requested time span
+      * @param spanSeconds Requested span in seconds (0 selects RAW)
+      * @return Selected tier
+      */
+     HistoryTier selectTier(uint32_t spanSeconds) const;
+
+     /**
+      * @brief Get the bucket width of a tier
+      * @param tier Tier to query
+      * @return Bucket width in seconds (0 for RAW)
+      */
+     static uint32_t resolutionSeconds(HistoryTier tier);
+
+     /**
+      * @brief Get the number of buckets kept for a rollup tier
+      * @param tier Rollup tier
+      * @return Bucket capacity
+      */
+     static size_t rollupCapacity(HistoryTier tier);
+
+     /**
+      * @brief Extract a single channel from a raw sample
+      * @param reading Raw sample
+      * @param dataType 0 for temperature, 1 for humidity, 2 for CO2
+      */
+     static float channelValue(const SensorReading& reading, uint8_t dataType);
+
+     /**
+      * @brief Extract the average of a single channel from a rollup bucket
+      * @param rollup Rollup bucket
+      * @param dataType 0 for temperature, 1 for humidity, 2 for CO2
+      */
+     static float channelValue(const SensorRollup& rollup, uint8_t dataType);
+
+ private:
+     struct Accumulator {
+         uint32_t bucketStart;
+         uint16_t count;
+         float temperatureSum;
+         float temperatureMin;
+         float temperatureMax;
+         float humiditySum;
+         float humidityMin;
+         float humidityMax;
+         float co2Sum;
+         float co2Min;
+         float co2Max;
+     };
+
+     RingBuffer<SensorReading> _raw;
+     RingBuffer<SensorRollup> _rollups[ROLLUP_TIER_COUNT];
+     Accumulator _pending[ROLLUP_TIER_COUNT];
+
+     static void resetAccumulator(Accumulator& acc, uint32_t bucketStart);
+     static void accumulate(Accumulator& acc, const SensorReading& reading);
+     static void accumulateRollup(Accumulator& acc, const SensorRollup& rollup);
+     static SensorRollup closeAccumulator(const Accumulator& acc);
+ };
+
+ #endif // SENSOR_HISTORY_H
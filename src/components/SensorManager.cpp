@@ -6,16 +6,38 @@
  #include "SensorManager.h"
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
+ #include "../system/LatencyMonitor.h"
+ #include "I2CBus.h"
+ 
+ namespace {
+     const uint8_t SCD40_I2C_ADDRESS = 0x62;
+     const uint16_t SCD40_CMD_SINGLE_SHOT = 0x219D;
+     const uint16_t SCD40_BUS_BUSY = 0xFFFF;          // Stands in for a Sensirion error when the bus was not granted
+     
+     // Keep the display off the bus while the sample may land and is polled for
+     void reserveScdWindow(uint32_t startMs) {
+         getAppCore()->getI2CBus()->reserve(startMs, Constants::SCD40_READY_LEAD_MS + Constants::SCD40_READY_TIMEOUT_MS);
+     }
+     
+     // The read is done, hand the rest of the window back to the display
+     void releaseScdWindow() {
+         getAppCore()->getI2CBus()->reserve(0, 0);
+     }
+ }
  
  SensorManager::SensorManager() :
-     _upperDht(Constants::DEFAULT_DHT1_PIN, DHT22),
-     _lowerDht(Constants::DEFAULT_DHT2_PIN, DHT22),
+     _upperDht(Constants::DEFAULT_DHT1_PIN, static_cast<rmt_channel_t>(Constants::DHT1_RMT_CHANNEL)),
+     _lowerDht(Constants::DEFAULT_DHT2_PIN, static_cast<rmt_channel_t>(Constants::DHT2_RMT_CHANNEL)),
      _dht1Pin(Constants::DEFAULT_DHT1_PIN),
      _dht2Pin(Constants::DEFAULT_DHT2_PIN),
      _scdSdaPin(Constants::DEFAULT_SCD40_SDA_PIN),
      _scdSclPin(Constants::DEFAULT_SCD40_SCL_PIN),
      _dhtInterval(Constants::DEFAULT_DHT_READ_INTERVAL_MS),
      _scdInterval(Constants::DEFAULT_SCD40_READ_INTERVAL_MS),
+     _scdMode(ScdMode::PERIODIC),
+     _scdSampleMs(0),
+     _nextDhtReadMs(0),
+     _nextScdReadMs(0),
      _isDht1Initialized(false),
      _isDht2Initialized(false),
      _isScdInitialized(false),
@@ -23,7 +45,7 @@
      _dht2ErrorCount(0),
      _scdErrorCount(0),
      _maxErrorCount(5),
-     _maxHistoryPoints(Constants::DEFAULT_GRAPH_MAX_POINTS),
+     _maxHistoryPoints(Constants::DEFAULT_HISTORY_MAX_POINTS),
      _sensorMutex(nullptr),
      _dhtTaskHandle(nullptr),
      _scdTaskHandle(nullptr)
@@ -32,6 +54,12 @@
      _upperDhtReading = {0.0f, 0.0f, 0.0f, 0, false};
      _lowerDhtReading = {0.0f, 0.0f, 0.0f, 0, false};
      _scdReading = {0.0f, 0.0f, 0.0f, 0, false};
+     
+     for (uint8_t i = 0; i < 4; i++) {
+         _hasClosedRollup[i] = false;
+     }
+     
+     publishSnapshot();
  }
  
  SensorManager::~SensorManager() {
@@ -57,12 +85,24 @@
          return false;
      }
      
+     // Preallocate history storage so sampling never touches the heap
+     if (!_upperDhtHistory.begin(_maxHistoryPoints) ||
+         !_lowerDhtHistory.begin(_maxHistoryPoints) ||
+         !_scdHistory.begin(_maxHistoryPoints) ||
+         !_tentHistory.begin(_maxHistoryPoints)) {
+         Serial.println("Failed to allocate sensor history!");
+         return false;
+     }
+     
+     // Rebuild the rollup tiers from the persisted 1-minute buckets
+     restoreHistory();
+     
      // Basic initialization here, full initialization will be done in fullInitialization()
      return true;
  }
  
  bool SensorManager::fullInitialization() {
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Starting sensor initialization");
+     LOG_INFO("Sensors", "Starting sensor initialization");
      
      // Initialize DHT sensors
      bool dhtInitialized = initializeDhtSensors();
@@ -71,14 +111,14 @@
      bool scdInitialized = initializeScdSensor();
      
      if (dhtInitialized && scdInitialized) {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "All sensors initialized successfully");
+         LOG_INFO("Sensors", "All sensors initialized successfully");
          return true;
      } else {
          if (!dhtInitialized) {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "DHT sensors initialization failed");
+             LOG_ERROR("Sensors", "DHT sensors initialization failed");
          }
          if (!scdInitialized) {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "SCD40 sensor initialization failed");
+             LOG_ERROR("Sensors", "SCD40 sensor initialization failed");
          }
          return false;
      }
@@ -97,11 +137,8 @@
          xSemaphoreGive(_sensorMutex);
          
          // Log the change
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", 
-             "Sensor pins updated: DHT1=" + String(dht1Pin) + 
-             ", DHT2=" + String(dht2Pin) + 
-             ", SCD_SDA=" + String(scdSdaPin) + 
-             ", SCD_SCL=" + String(scdSclPin));
+         LOG_INFO("Sensors", "Sensor pins updated: DHT1=%u, DHT2=%u, SCD_SDA=%u, SCD_SCL=%u", 
+             dht1Pin, dht2Pin, scdSdaPin, scdSclPin);
          
          // Reinitialize sensors with new pins
          return fullInitialization();
@@ -135,11 +172,34 @@
          xSemaphoreGive(_sensorMutex);
          
          // Log the change
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", 
-             "Sensor intervals updated: DHT=" + String(dhtInterval) + "ms, SCD=" + String(scdInterval) + "ms");
+         LOG_INFO("Sensors", "Sensor intervals updated: DHT=%lums, SCD=%lums", 
+             static_cast<unsigned long>(dhtInterval), static_cast<unsigned long>(scdInterval));
      }
  }
  
+ bool SensorManager::setScdMode(ScdMode mode) {
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _scdMode = mode;
+         
+         // An uninitialized sensor starts in this mode in initializeScdSensor()
+         success = !_isScdInitialized || startScdMeasurement();
+         
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
+         
+         LOG_INFO("Sensors", "SCD40 measurement mode set to %u", static_cast<uint8_t>(mode));
+     }
+     
+     return success;
+ }
+ 
+ ScdMode SensorManager::getScdMode() {
+     return _scdMode;
+ }
+ 
  void SensorManager::getSensorIntervals(uint32_t& dhtInterval, uint32_t& scdInterval) {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
@@ -153,90 +213,223 @@
  }
  
  bool SensorManager::getSensorReadings(SensorReading& upperDht, SensorReading& lowerDht, SensorReading& scd) {
-     bool hasValidReadings = false;
+     // Lock-free read, never waits for a sensor read or history operation in progress
+     SensorSnapshot snapshot = _snapshot.read();
+     upperDht = snapshot.upperDht;
+     lowerDht = snapshot.lowerDht;
+     scd = snapshot.scd;
+     
+     // Check if any readings are valid
+     return upperDht.valid || lowerDht.valid || scd.valid;
+ }
+ 
+ bool SensorManager::getSensorReadings(SensorReading& upperDht, SensorReading& lowerDht, SensorReading& scd,
+                                        FusedReading& tent) {
+     SensorSnapshot snapshot = _snapshot.read();
+     upperDht = snapshot.upperDht;
+     lowerDht = snapshot.lowerDht;
+     scd = snapshot.scd;
+     tent = snapshot.tent;
+     
+     return upperDht.valid || lowerDht.valid || scd.valid;
+ }
+ 
+ bool SensorManager::getTentReading(FusedReading& tent) {
+     tent = _snapshot.read().tent;
+     return tent.reading.valid;
+ }
+ 
+ bool SensorManager::prepareGraphQuery(uint8_t dataType, uint16_t maxPoints, uint32_t spanSeconds, GraphQuery& query) {
+     query.dataType = dataType;
+     query.fromStore = false;
+     query.pointCount = 0;
+     query.available = 0;
      
      // Take mutex to ensure thread safety
-     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Copy current readings
-         upperDht = _upperDhtReading;
-         lowerDht = _lowerDhtReading;
-         scd = _scdReading;
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return false;
+     }
+     
+     // Use the coarsest tier any sensor needs so all series share one time base
+     query.tier = max(max(_upperDhtHistory.selectTier(spanSeconds), 
+                          _lowerDhtHistory.selectTier(spanSeconds)), 
+                      max(_scdHistory.selectTier(spanSeconds), 
+                          _tentHistory.selectTier(spanSeconds)));
+     query.resolution = SensorHistory::resolutionSeconds(query.tier);
+     
+     // Number of entries inside the requested span, common to all sensors
+     query.available = min(min(countPointsInSpan(_upperDhtHistory, query.tier, spanSeconds), 
+                               countPointsInSpan(_lowerDhtHistory, query.tier, spanSeconds)), 
+                           min(countPointsInSpan(_scdHistory, query.tier, spanSeconds), 
+                               countPointsInSpan(_tentHistory, query.tier, spanSeconds)));
+     query.pointCount = min(query.available, (size_t)min(maxPoints, Constants::GRAPH_MAX_POINTS));
+     
+     // Each history may hold a different number of entries, so align on the newest ones
+     const SensorHistory* histories[4] = {&_upperDhtHistory, &_lowerDhtHistory, &_scdHistory, &_tentHistory};
+     for (uint8_t i = 0; i < 4; i++) {
+         query.firstSequence[i] = histories[i]->sequenceEnd(query.tier) - query.available;
+     }
+     
+     // Release mutex
+     xSemaphoreGive(_sensorMutex);
+     return true;
+ }
+ 
+ bool SensorManager::prepareGraphRangeQuery(uint8_t dataType, uint16_t maxPoints, uint32_t from, uint32_t to, 
+                                            GraphQuery& query) {
+     query.dataType = dataType;
+     query.tier = HistoryTier::MINUTE;
+     query.fromStore = true;
+     query.pointCount = 0;
+     query.available = 0;
+     query.from = from;
+     query.to = to;
+     
+     if (from > to || maxPoints == 0) {
+         return false;
+     }
+     maxPoints = min(maxPoints, Constants::GRAPH_MAX_POINTS);
+     
+     // Slot width is a whole number of minutes so every stored bucket lands in exactly one slot
+     uint32_t rangeSeconds = to - from + 1;
+     uint32_t slotSeconds = (rangeSeconds + maxPoints - 1) / maxPoints;
+     query.resolution = ((slotSeconds + 59) / 60) * 60;
+     query.pointCount = (rangeSeconds + query.resolution - 1) / query.resolution;
+     return true;
+ }
+ 
+ size_t SensorManager::readGraphPoints(const GraphQuery& query, size_t first, size_t count, GraphPoint* points) {
+     if (first >= query.pointCount) {
+         return 0;
+     }
+     count = min(min(count, query.pointCount - first), Constants::GRAPH_READ_BATCH_POINTS);
+     
+     if (query.fromStore) {
+         // Average every stored bucket of the requested slots with one range read
+         float sums[Constants::GRAPH_READ_BATCH_POINTS][4] = {};
+         uint16_t counts[Constants::GRAPH_READ_BATCH_POINTS][4] = {};
+         uint32_t batchStart = query.from + first * query.resolution;
+         uint32_t batchEnd = min(query.to, batchStart + (uint32_t)(count * query.resolution) - 1);
          
-         // Check if any readings are valid
-         hasValidReadings = _upperDhtReading.valid || _lowerDhtReading.valid || _scdReading.valid;
+         getAppCore()->getTimeSeriesStore()->readRange(batchStart, batchEnd, 
+             [&](uint8_t sensorId, const SensorRollup& rollup) {
+                 if (sensorId < 4) {
+                     size_t slot = (rollup.timestamp - batchStart) / query.resolution;
+                     sums[slot][sensorId] += SensorHistory::channelValue(rollup, query.dataType);
+                     counts[slot][sensorId]++;
+                 }
+             });
          
-         // Release mutex
-         xSemaphoreGive(_sensorMutex);
+         for (size_t i = 0; i < count; i++) {
+             points[i].upperDht = counts[i][0] == 0 ? NAN : (query.dataType == 2 ? 0 : sums[i][0] / counts[i][0]);
+             points[i].lowerDht = counts[i][1] == 0 ? NAN : (query.dataType == 2 ? 0 : sums[i][1] / counts[i][1]);
+             points[i].scd = counts[i][2] == 0 ? NAN : sums[i][2] / counts[i][2];
+             points[i].tent = counts[i][3] == 0 ? NAN : sums[i][3] / counts[i][3];
+             points[i].timestamp = batchStart + i * query.resolution;
+         }
+         return count;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return 0;
      }
      
-     return hasValidReadings;
+     const SensorHistory* histories[4] = {&_upperDhtHistory, &_lowerDhtHistory, &_scdHistory, &_tentHistory};
+     for (size_t i = 0; i < count; i++) {
+         // Stride evenly if the span holds more than pointCount entries
+         size_t offset = ((first + i) * query.available) / query.pointCount;
+         float values[4];
+         uint32_t timestamp = 0;
+         
+         for (uint8_t s = 0; s < 4; s++) {
+             const SensorHistory& history = *histories[s];
+             size_t size = history.size(query.tier);
+             uint32_t oldest = history.sequenceEnd(query.tier) - size;
+             uint32_t sequence = query.firstSequence[s] + offset;
+             
+             // The entry may have been overwritten since the query was prepared, or the history reset
+             if (sequence < oldest || sequence - oldest >= size) {
+                 values[s] = NAN;
+                 continue;
+             }
+             
+             size_t index = sequence - oldest;
+             if (query.tier == HistoryTier::RAW) {
+                 const SensorReading& reading = history.raw(index);
+                 values[s] = SensorHistory::channelValue(reading, query.dataType);
+                 timestamp = (s == 0 || timestamp == 0) ? reading.timestamp : timestamp;
+             } else {
+                 const SensorRollup& rollup = history.rollup(query.tier, index);
+                 values[s] = SensorHistory::channelValue(rollup, query.dataType);
+                 timestamp = (s == 0 || timestamp == 0) ? rollup.timestamp : timestamp;
+             }
+         }
+         
+         points[i].upperDht = (query.dataType == 2 && !isnan(values[0])) ? 0 : values[0];
+         points[i].lowerDht = (query.dataType == 2 && !isnan(values[1])) ? 0 : values[1];
+         points[i].scd = values[2];
+         points[i].tent = values[3];
+         points[i].timestamp = timestamp;
+     }
+     
+     // Release mutex
+     xSemaphoreGive(_sensorMutex);
+     return count;
  }
  
- std::vector<std::vector<float>> SensorManager::getGraphData(uint8_t dataType, uint16_t maxPoints) {
-     std::vector<std::vector<float>> result;
+ bool SensorManager::setHistoryCapacity(uint16_t points) {
+     if (points == 0 || points > Constants::MAX_HISTORY_POINTS) {
+         return false;
+     }
+     
+     bool success = false;
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Prepare data vectors
-         std::vector<float> upperDhtData;
-         std::vector<float> lowerDhtData;
-         std::vector<float> scdData;
-         std::vector<float> timestamps;
-         
-         // Calculate how many points to include
-         size_t pointCount = min(min(min(_upperDhtHistory.size(), _lowerDhtHistory.size()), _scdHistory.size()), (size_t)maxPoints);
+         success = _upperDhtHistory.begin(points) &&
+                   _lowerDhtHistory.begin(points) &&
+                   _scdHistory.begin(points) &&
+                   _tentHistory.begin(points);
          
-         // If we have no data, return empty vectors
-         if (pointCount == 0) {
-             xSemaphoreGive(_sensorMutex);
-             result.push_back(upperDhtData);
-             result.push_back(lowerDhtData);
-             result.push_back(scdData);
-             result.push_back(timestamps);
-             return result;
+         if (success) {
+             _maxHistoryPoints = points;
+         } else {
+             // Fall back to the previous capacity so sampling keeps working
+             _upperDhtHistory.begin(_maxHistoryPoints);
+             _lowerDhtHistory.begin(_maxHistoryPoints);
+             _scdHistory.begin(_maxHistoryPoints);
+             _tentHistory.begin(_maxHistoryPoints);
          }
          
-         // Get starting index to include only the latest points
-         size_t startIdx = 0;
-         if (_upperDhtHistory.size() > maxPoints) {
-             startIdx = _upperDhtHistory.size() - maxPoints;
-         }
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
          
-         // Extract the relevant data
-         for (size_t i = startIdx; i < _upperDhtHistory.size(); i++) {
-             switch (dataType) {
-                 case 0: // Temperature
-                     upperDhtData.push_back(_upperDhtHistory[i].temperature);
-                     lowerDhtData.push_back(_lowerDhtHistory[i].temperature);
-                     scdData.push_back(_scdHistory[i].temperature);
-                     break;
-                 case 1: // Humidity
-                     upperDhtData.push_back(_upperDhtHistory[i].humidity);
-                     lowerDhtData.push_back(_lowerDhtHistory[i].humidity);
-                     scdData.push_back(_scdHistory[i].humidity);
-                     break;
-                 case 2: // CO2 (only for SCD40)
-                     upperDhtData.push_back(0);
-                     lowerDhtData.push_back(0);
-                     scdData.push_back(_scdHistory[i].co2);
-                     break;
-             }
-             
-             // Add timestamp
-             timestamps.push_back(_upperDhtHistory[i].timestamp / 1000.0f); // Convert to seconds
+         // Reallocation cleared the tiers, refill them from flash
+         restoreHistory();
+         
+         if (success) {
+             LOG_INFO("Sensors", "History capacity set to %u points per sensor", points);
+         } else {
+             LOG_ERROR("Sensors", "Failed to allocate history for %u points", points);
          }
+     }
+     
+     return success;
+ }
+ 
+ uint16_t SensorManager::getHistoryCapacity() {
+     uint16_t points = 0;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         points = _maxHistoryPoints;
          
          // Release mutex
          xSemaphoreGive(_sensorMutex);
-         
-         // Add data to result
-         result.push_back(upperDhtData);
-         result.push_back(lowerDhtData);
-         result.push_back(scdData);
-         result.push_back(timestamps);
      }
      
-     return result;
+     return points;
  }
  
  bool SensorManager::testSensor(uint8_t sensorType) {
@@ -244,70 +437,105 @@
      
      switch (sensorType) {
          case 0: // Upper DHT22
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Testing Upper DHT22 sensor");
+             LOG_INFO("Sensors", "Testing Upper DHT22 sensor");
              testResult = readDhtSensor(_upperDht, _upperDhtReading, _dht1ErrorCount, "Upper DHT");
              break;
          case 1: // Lower DHT22
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Testing Lower DHT22 sensor");
+             LOG_INFO("Sensors", "Testing Lower DHT22 sensor");
              testResult = readDhtSensor(_lowerDht, _lowerDhtReading, _dht2ErrorCount, "Lower DHT");
              break;
          case 2: // SCD40
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Testing SCD40 sensor");
-             testResult = readScdSensor();
+             LOG_INFO("Sensors", "Testing SCD40 sensor");
+             testResult = readScdSensor(0);
              break;
          default:
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Invalid sensor type for testing");
+             LOG_ERROR("Sensors", "Invalid sensor type for testing");
              return false;
      }
      
      if (testResult) {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Sensor test passed");
+         LOG_INFO("Sensors", "Sensor test passed");
      } else {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Sensor test failed");
+         LOG_ERROR("Sensors", "Sensor test failed");
      }
      
      return testResult;
  }
  
+ bool SensorManager::benchmarkSensors(uint32_t& dhtUs, uint32_t& scdUs) {
+     bool result = false;
+     dhtUs = 0;
+     scdUs = 0;
+     
+     // The DHT driver serializes its own reads
+     float temperature;
+     float humidity;
+     uint32_t start = micros();
+     bool dhtOk = _upperDht.read(temperature, humidity, true);
+     if (dhtOk) {
+         dhtUs = micros() - start;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         bool dataReady = false;
+         uint16_t error = SCD40_BUS_BUSY;
+         {
+             ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+             start = micros();
+             if (bus.isLocked()) {
+                 error = _scd40.getDataReadyFlag(dataReady);
+             }
+         }
+         if (error == 0) {
+             scdUs = micros() - start;
+         }
+         
+         result = dhtOk || error == 0;
+         
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
+     }
+     
+     return result;
+ }
+ 
  bool SensorManager::resetSensor(uint8_t sensorType) {
      bool resetResult = false;
      
      switch (sensorType) {
          case 0: // Upper DHT22
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Resetting Upper DHT22 sensor");
-             _upperDht = DHT(_dht1Pin, DHT22);
-             _upperDht.begin();
+             LOG_INFO("Sensors", "Resetting Upper DHT22 sensor");
+             resetResult = _upperDht.begin(_dht1Pin);
              _dht1ErrorCount = 0;
-             resetResult = true;
              break;
          case 1: // Lower DHT22
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Resetting Lower DHT22 sensor");
-             _lowerDht = DHT(_dht2Pin, DHT22);
-             _lowerDht.begin();
+             LOG_INFO("Sensors", "Resetting Lower DHT22 sensor");
+             resetResult = _lowerDht.begin(_dht2Pin);
              _dht2ErrorCount = 0;
-             resetResult = true;
              break;
          case 2: // SCD40
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Resetting SCD40 sensor");
-             Wire.end();
-             delay(100);
-             Wire.begin(_scdSdaPin, _scdSclPin);
-             _scd40.begin(Wire);
-             _scd40.stopPeriodicMeasurement();
-             delay(500);
-             _scd40.startPeriodicMeasurement();
+             LOG_INFO("Sensors", "Resetting SCD40 sensor");
+             {
+                 // The display shares the bus, keep it off while Wire restarts
+                 ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+                 Wire.end();
+                 delay(100);
+                 Wire.begin(_scdSdaPin, _scdSclPin);
+                 _scd40.begin(Wire);
+             }
+             resetResult = startScdMeasurement();
              _scdErrorCount = 0;
-             resetResult = true;
              break;
          default:
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Invalid sensor type for reset");
+             LOG_ERROR("Sensors", "Invalid sensor type for reset");
              return false;
      }
      
      if (resetResult) {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Sensor reset successful");
+         LOG_INFO("Sensors", "Sensor reset successful");
      } else {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Sensor reset failed");
+         LOG_ERROR("Sensors", "Sensor reset failed");
      }
      
      return resetResult;
@@ -326,7 +554,7 @@
      );
      
      if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Failed to create DHT reading task");
+         LOG_ERROR("Sensors", "Failed to create DHT reading task");
      }
      
      // Create SCD reading task
@@ -341,24 +569,20 @@
      );
      
      if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Failed to create SCD reading task");
+         LOG_ERROR("Sensors", "Failed to create SCD reading task");
      }
  }
  
  bool SensorManager::initializeDhtSensors() {
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Initializing DHT sensors");
+     LOG_INFO("Sensors", "Initializing DHT sensors");
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Initialize upper DHT sensor
-         _upperDht = DHT(_dht1Pin, DHT22);
-         _upperDht.begin();
-         _isDht1Initialized = true;
+         _isDht1Initialized = _upperDht.begin(_dht1Pin);
          
          // Initialize lower DHT sensor
-         _lowerDht = DHT(_dht2Pin, DHT22);
-         _lowerDht.begin();
-         _isDht2Initialized = true;
+         _isDht2Initialized = _lowerDht.begin(_dht2Pin);
          
          // Reset error counters
          _dht1ErrorCount = 0;
@@ -376,18 +600,18 @@
          bool lowerReadSuccess = readDhtSensor(_lowerDht, lowerReading, _dht2ErrorCount, "Lower DHT");
          
          if (upperReadSuccess) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", 
-                 "Upper DHT initialized: Temp=" + String(upperReading.temperature, 1) + "°C, Humidity=" + String(upperReading.humidity, 1) + "%");
+             LOG_INFO("Sensors", "Upper DHT initialized: Temp=%.1f°C, Humidity=%.1f%%", 
+                 upperReading.temperature, upperReading.humidity);
          } else {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Upper DHT initialization failed");
+             LOG_ERROR("Sensors", "Upper DHT initialization failed");
              _isDht1Initialized = false;
          }
          
          if (lowerReadSuccess) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", 
-                 "Lower DHT initialized: Temp=" + String(lowerReading.temperature, 1) + "°C, Humidity=" + String(lowerReading.humidity, 1) + "%");
+             LOG_INFO("Sensors", "Lower DHT initialized: Temp=%.1f°C, Humidity=%.1f%%", 
+                 lowerReading.temperature, lowerReading.humidity);
          } else {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "Lower DHT initialization failed");
+             LOG_ERROR("Sensors", "Lower DHT initialization failed");
              _isDht2Initialized = false;
          }
          
@@ -398,46 +622,48 @@
  }
  
  bool SensorManager::initializeScdSensor() {
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", "Initializing SCD40 sensor");
+     LOG_INFO("Sensors", "Initializing SCD40 sensor");
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Initialize I2C
-         Wire.begin(_scdSdaPin, _scdSclPin);
-         
-         // Initialize SCD40 sensor
-         _scd40.begin(Wire);
-         
-         // Stop any existing measurement
-         _scd40.stopPeriodicMeasurement();
-         vTaskDelay(pdMS_TO_TICKS(500));
+         // Initialize I2C, shared with the status display
+         {
+             ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+             Wire.begin(_scdSdaPin, _scdSclPin);
+             
+             // Initialize SCD40 sensor
+             _scd40.begin(Wire);
+         }
          
-         // Start periodic measurement
-         uint16_t error = _scd40.startPeriodicMeasurement();
-         if (error) {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", 
-                 "SCD40 start measurement failed with error: " + String(error));
-             _isScdInitialized = false;
-         } else {
-             _isScdInitialized = true;
+         // Stop any existing measurement, feed the compensation and start the configured mode
+         _isScdInitialized = startScdMeasurement();
+         if (_isScdInitialized) {
              _scdErrorCount = 0;
          }
          
+         // Take the first sample, single shot needs a conversion triggered
+         uint32_t sampleDue = nextScdSample(millis());
+         if (_scdMode == ScdMode::SINGLE_SHOT) {
+             startScdSingleShot();
+             sampleDue = millis() + Constants::SCD40_SINGLE_SHOT_MS;
+         }
+         
          // Release mutex
          xSemaphoreGive(_sensorMutex);
          
-         // Wait 5 seconds for the SCD40 to take first measurement
-         vTaskDelay(pdMS_TO_TICKS(5000));
+         // Wait for the SCD40 to take its first measurement
+         int32_t wait = static_cast<int32_t>(sampleDue - Constants::SCD40_READY_LEAD_MS - millis());
+         if (wait > 0) {
+             vTaskDelay(pdMS_TO_TICKS(wait));
+         }
          
          // Try to read from sensor to verify it's working
-         if (readScdSensor()) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Sensors", 
-                 "SCD40 initialized: Temp=" + String(_scdReading.temperature, 1) + 
-                 "°C, Humidity=" + String(_scdReading.humidity, 1) + 
-                 "%, CO2=" + String(_scdReading.co2, 0) + "ppm");
+         if (readScdSensor(Constants::SCD40_READY_LEAD_MS + Constants::SCD40_READY_TIMEOUT_MS)) {
+             LOG_INFO("Sensors", "SCD40 initialized: Temp=%.1f°C, Humidity=%.1f%%, CO2=%.0fppm", 
+                 _scdReading.temperature, _scdReading.humidity, _scdReading.co2);
              return true;
          } else {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", "SCD40 initialization failed");
+             LOG_ERROR("Sensors", "SCD40 initialization failed");
              _isScdInitialized = false;
              return false;
          }
@@ -446,19 +672,21 @@
      return false;
  }
  
- bool SensorManager::readDhtSensor(DHT& sensor, SensorReading& reading, uint8_t& errorCount, const char* sensorName) {
+ bool SensorManager::readDhtSensor(Dht22Rmt& sensor, SensorReading& reading, uint8_t& errorCount, const char* sensorName) {
+     LATENCY_SCOPE("sensor.dht");
+     
+     // Capture and decode outside the sensor lock, one capture gives both values
+     float temperature = NAN;
+     float humidity = NAN;
+     bool captured = sensor.read(temperature, humidity);
+     
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Read temperature and humidity
-         float temperature = sensor.readTemperature();
-         float humidity = sensor.readHumidity();
-         
          // Check if readings are valid
-         if (isnan(temperature) || isnan(humidity)) {
+         if (!captured || isnan(temperature) || isnan(humidity)) {
              errorCount++;
              if (errorCount > _maxErrorCount) {
-                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", 
-                     String(sensorName) + " read failed too many times, resetting sensor");
+                 LOG_ERROR("Sensors", "%s read failed too many times, resetting sensor", sensorName);
                  // Release mutex before reset to avoid deadlock
                  xSemaphoreGive(_sensorMutex);
                  // Determine sensor type from name and reset
@@ -470,8 +698,7 @@
                  return false;
              }
              
-             getAppCore()->getLogManager()->log(LogLevel::WARN, "Sensors", 
-                 String(sensorName) + " read failed, error count: " + String(errorCount));
+             LOG_WARN("Sensors", "%s read failed, error count: %u", sensorName, errorCount);
              
              // Release mutex
              xSemaphoreGive(_sensorMutex);
@@ -481,17 +708,20 @@
          // Update reading
          reading.temperature = temperature;
          reading.humidity = humidity;
-         reading.timestamp = millis();
+         reading.timestamp = (uint32_t)time(nullptr);
          reading.valid = true;
+         _fusion.addSample(strcmp(sensorName, "Upper DHT") == 0 ? 0 : 1, reading);
+         publishSnapshot();
          
          // Reset error counter on successful read
          errorCount = 0;
+         LOG_DEBUG("Sensors", "%s: %.1f°C, %.1f%%", sensorName, temperature, humidity);
          
          // Add to history if this is not a test read
          if (strcmp(sensorName, "Upper DHT") == 0) {
-             addReadingToHistory(reading, _upperDhtHistory);
+             addReadingToHistory(reading, _upperDhtHistory, 0);
          } else if (strcmp(sensorName, "Lower DHT") == 0) {
-             addReadingToHistory(reading, _lowerDhtHistory);
+             addReadingToHistory(reading, _lowerDhtHistory, 1);
          }
          
          // Release mutex
@@ -502,27 +732,60 @@
      return false;
  }
  
- bool SensorManager::readScdSensor() {
+ bool SensorManager::readScdSensor(uint32_t readyTimeoutMs) {
+     // Poll the data-ready flag, holding the lock only for each transaction
+     uint16_t error = 0;
+     bool dataReady = false;
+     bool sawPending = false;
+     uint32_t pollStart = millis();
+     
+     while (true) {
+         if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+             {
+                 ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+                 error = bus.isLocked() ? _scd40.getDataReadyFlag(dataReady) : SCD40_BUS_BUSY;
+             }
+             
+             // Release mutex
+             xSemaphoreGive(_sensorMutex);
+         } else {
+             return false;
+         }
+         
+         if (error || dataReady || millis() - pollStart >= readyTimeoutMs) {
+             break;
+         }
+         
+         sawPending = true;
+         vTaskDelay(pdMS_TO_TICKS(Constants::SCD40_READY_POLL_MS));
+     }
+     
+     LATENCY_SCOPE("sensor.scd40");
+     
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Check if data is available
-         uint16_t error;
-         bool dataReady;
-         error = _scd40.getDataReadyFlag(dataReady);
+         // Keep the sensor's sample clock in phase for nextScdSample()
+         if (dataReady && _scdMode != ScdMode::SINGLE_SHOT && readyTimeoutMs > 0) {
+             if (sawPending) {
+                 // Saw the sample land
+                 _scdSampleMs = millis();
+             } else {
+                 // Sample was already there, wake earlier next time to catch it landing
+                 _scdSampleMs -= Constants::SCD40_READY_LEAD_MS;
+             }
+         }
          
          if (error || !dataReady) {
              _scdErrorCount++;
              if (_scdErrorCount > _maxErrorCount) {
-                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "Sensors", 
-                     "SCD40 read failed too many times, resetting sensor");
+                 LOG_ERROR("Sensors", "SCD40 read failed too many times, resetting sensor");
                  // Release mutex before reset to avoid deadlock
                  xSemaphoreGive(_sensorMutex);
                  resetSensor(2);
                  return false;
              }
              
-             getAppCore()->getLogManager()->log(LogLevel::WARN, "Sensors", 
-                 "SCD40 data not ready or error: " + String(error) + ", error count: " + String(_scdErrorCount));
+             LOG_WARN("Sensors", "SCD40 data not ready or error: %u, error count: %u", error, _scdErrorCount);
              
              // Release mutex
              xSemaphoreGive(_sensorMutex);
@@ -533,12 +796,14 @@
          uint16_t co2;
          float temperature;
          float humidity;
-         error = _scd40.readMeasurement(co2, temperature, humidity);
+         {
+             ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+             error = bus.isLocked() ? _scd40.readMeasurement(co2, temperature, humidity) : SCD40_BUS_BUSY;
+         }
          
          if (error) {
              _scdErrorCount++;
-             getAppCore()->getLogManager()->log(LogLevel::WARN, "Sensors", 
-                 "SCD40 read failed with error: " + String(error) + ", error count: " + String(_scdErrorCount));
+             LOG_WARN("Sensors", "SCD40 read failed with error: %u, error count: %u", error, _scdErrorCount);
              
              // Release mutex
              xSemaphoreGive(_sensorMutex);
@@ -549,14 +814,17 @@
          _scdReading.temperature = temperature;
          _scdReading.humidity = humidity;
          _scdReading.co2 = co2;
-         _scdReading.timestamp = millis();
+         _scdReading.timestamp = (uint32_t)time(nullptr);
          _scdReading.valid = true;
+         _fusion.addSample(2, _scdReading);
+         publishSnapshot();
          
          // Reset error counter on successful read
          _scdErrorCount = 0;
+         LOG_DEBUG("Sensors", "SCD40: %.1f°C, %.1f%%, %uppm", temperature, humidity, co2);
          
          // Add to history
-         addReadingToHistory(_scdReading, _scdHistory);
+         addReadingToHistory(_scdReading, _scdHistory, 2);
          
          // Release mutex
          xSemaphoreGive(_sensorMutex);
@@ -566,23 +834,243 @@
      return false;
  }
  
- void SensorManager::addReadingToHistory(const SensorReading& reading, std::vector<SensorReading>& history) {
-     // Add reading to history
-     history.push_back(reading);
+ bool SensorManager::startScdMeasurement() {
+     // Commands other than stop are only accepted 500 ms after a stop,
+     // the bus is free for the display in between
+     {
+         ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+         _scd40.stopPeriodicMeasurement();
+     }
+     vTaskDelay(pdMS_TO_TICKS(500));
+     
+     ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+     if (!bus.isLocked()) {
+         LOG_ERROR("Sensors", "I2C bus busy, SCD40 measurement not started");
+         return false;
+     }
+     
+     // The altitude stands in for the ambient pressure, which nothing here
+     // measures. It lives in the sensor's RAM and is only accepted while idle.
+     uint16_t error = _scd40.setSensorAltitude(Constants::SCD40_ALTITUDE_M);
+     if (error) {
+         LOG_WARN("Sensors", "SCD40 altitude compensation failed with error: %u", error);
+     }
+     
+     switch (_scdMode) {
+         case ScdMode::LOW_POWER:
+             error = _scd40.startLowPowerPeriodicMeasurement();
+             break;
+         case ScdMode::SINGLE_SHOT:
+             // Conversions are triggered per read
+             error = 0;
+             break;
+         default:
+             error = _scd40.startPeriodicMeasurement();
+             break;
+     }
+     
+     if (error) {
+         LOG_ERROR("Sensors", "SCD40 start measurement failed with error: %u", error);
+         return false;
+     }
+     
+     // Samples land one period after the start, then every period
+     _scdSampleMs = (_scdMode == ScdMode::SINGLE_SHOT) ? 0 : millis();
+     return true;
+ }
+ 
+ bool SensorManager::startScdSingleShot() {
+     // measure_single_shot sent directly, the library call also sleeps through the conversion
+     ScopedBusLock bus(getAppCore()->getI2CBus(), I2CClient::SENSOR);
+     if (!bus.isLocked()) {
+         return false;
+     }
+     
+     Wire.beginTransmission(SCD40_I2C_ADDRESS);
+     Wire.write(static_cast<uint8_t>(SCD40_CMD_SINGLE_SHOT >> 8));
+     Wire.write(static_cast<uint8_t>(SCD40_CMD_SINGLE_SHOT & 0xFF));
+     return Wire.endTransmission() == 0;
+ }
+ 
+ uint32_t SensorManager::scdSamplePeriod() const {
+     switch (_scdMode) {
+         case ScdMode::LOW_POWER:
+             return Constants::SCD40_LOW_POWER_MS;
+         case ScdMode::SINGLE_SHOT:
+             return Constants::SCD40_SINGLE_SHOT_MS;
+         default:
+             return Constants::SCD40_PERIODIC_MS;
+     }
+ }
+ 
+ uint32_t SensorManager::nextScdSample(uint32_t afterMs) const {
+     if (_scdMode == ScdMode::SINGLE_SHOT || _scdSampleMs == 0) {
+         return afterMs;
+     }
+     
+     // First sample of the sensor's clock at or after afterMs
+     uint32_t period = scdSamplePeriod();
+     int32_t elapsed = static_cast<int32_t>(afterMs - _scdSampleMs);
+     uint32_t periods = elapsed > 0 ? (static_cast<uint32_t>(elapsed) + period - 1) / period : 1;
+     return _scdSampleMs + periods * period;
+ }
+ 
+ void SensorManager::publishSnapshot() {
+     // Writers are serialized by _sensorMutex (or run before the tasks exist)
+     SensorSnapshot snapshot = {_upperDhtReading, _lowerDhtReading, _scdReading, _fusion.getReading()};
+     _snapshot.write(snapshot);
+ }
+ 
+ void SensorManager::addReadingToHistory(const SensorReading& reading, SensorHistory& history, uint8_t sensorId) {
+     // Add reading to the raw ring and fold it into the minute/quarter-hour/hour rollups
+     if (history.add(reading)) {
+         // Keep the closed bucket for persistClosedRollups(), flash is not written under _sensorMutex
+         _closedRollups[sensorId] = history.newestRollup(HistoryTier::MINUTE);
+         _hasClosedRollup[sensorId] = true;
+     }
+ }
+ 
+ void SensorManager::recordTentSample() {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         // One tent sample per DHT cycle, the fused value already includes the latest SCD40 sample
+         SensorReading tent = _fusion.getReading().reading;
+         if (tent.valid) {
+             tent.timestamp = (uint32_t)time(nullptr);
+             addReadingToHistory(tent, _tentHistory, 3);
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
+     }
+ }
+ 
+ void SensorManager::persistClosedRollups() {
+     SensorRollup pending[4];
+     bool hasPending[4] = {false, false, false, false};
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (uint8_t i = 0; i < 4; i++) {
+             if (_hasClosedRollup[i]) {
+                 pending[i] = _closedRollups[i];
+                 hasPending[i] = true;
+                 _hasClosedRollup[i] = false;
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
+     }
+     
+     TimeSeriesStore* store = getAppCore()->getTimeSeriesStore();
+     for (uint8_t i = 0; i < 4; i++) {
+         if (hasPending[i]) {
+             store->append(i, pending[i]);
+         }
+     }
+ }
+ 
+ void SensorManager::restoreHistory() {
+     TimeSeriesStore* store = getAppCore()->getTimeSeriesStore();
+     uint32_t newest = store->getNewestTimestamp();
+     if (newest == 0) {
+         return;
+     }
+     
+     uint32_t from = newest > Constants::TIME_SERIES_RESTORE_SECONDS ? newest - Constants::TIME_SERIES_RESTORE_SECONDS : 0;
+     size_t restored = 0;
      
-     // Limit history size
-     if (history.size() > _maxHistoryPoints) {
-         history.erase(history.begin());
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         SensorHistory* histories[4] = {&_upperDhtHistory, &_lowerDhtHistory, &_scdHistory, &_tentHistory};
+         restored = store->readRange(from, newest, [&](uint8_t sensorId, const SensorRollup& rollup) {
+             if (sensorId < 4) {
+                 histories[sensorId]->restoreRollup(rollup);
+             }
+         });
+         
+         // Release mutex
+         xSemaphoreGive(_sensorMutex);
+     }
+     
+     LOG_INFO("Sensors", "Restored %zu history buckets from flash", restored);
+ }
+ 
+ size_t SensorManager::countPointsInSpan(const SensorHistory& history, HistoryTier tier, uint32_t spanSeconds) {
+     size_t count = history.size(tier);
+     if (spanSeconds == 0 || count == 0) {
+         return count;
+     }
+     
+     if (tier != HistoryTier::RAW) {
+         // Rollup buckets are evenly spaced, so the span maps directly to a bucket count
+         size_t buckets = (spanSeconds + SensorHistory::resolutionSeconds(tier) - 1) / SensorHistory::resolutionSeconds(tier);
+         return min(count, buckets);
+     }
+     
+     // Raw samples can be irregular, walk back from the newest until we leave the span
+     uint32_t newest = history.raw(count - 1).timestamp;
+     size_t inSpan = 0;
+     while (inSpan < count && newest - history.raw(count - 1 - inSpan).timestamp <= spanSeconds) {
+         inSpan++;
+     }
+     return inSpan;
+ }
+ 
+ uint32_t SensorManager::msUntilNextRead() {
+     uint32_t now = millis();
+     int32_t remaining = INT32_MAX;
+     
+     if (_dhtTaskHandle != nullptr) {
+         remaining = min(remaining, static_cast<int32_t>(_nextDhtReadMs - now));
+     }
+     if (_scdTaskHandle != nullptr) {
+         remaining = min(remaining, static_cast<int32_t>(_nextScdReadMs - now));
+     }
+     
+     if (remaining == INT32_MAX) {
+         return UINT32_MAX;
+     }
+     return static_cast<uint32_t>(max(remaining, static_cast<int32_t>(0)));
+ }
+ 
+ void SensorManager::wakeTasks() {
+     if (_dhtTaskHandle != nullptr) {
+         xTaskNotifyGive(_dhtTaskHandle);
+     }
+     if (_scdTaskHandle != nullptr) {
+         xTaskNotifyGive(_scdTaskHandle);
+     }
+ }
+ 
+ uint32_t SensorManager::nextReadTime(uint32_t previousMs, uint32_t intervalMs) {
+     // Keep the period like vTaskDelayUntil, but read right away instead of
+     // catching up when a deadline was missed
+     uint32_t next = previousMs + intervalMs;
+     uint32_t now = millis();
+     return (static_cast<int32_t>(next - now) < 0) ? now : next;
+ }
+ 
+ void SensorManager::waitUntil(uint32_t deadlineMs) {
+     // millis() keeps counting through a light sleep while the tick count may
+     // not, so the wait is re-checked whenever the power manager wakes the task
+     int32_t remaining;
+     while ((remaining = static_cast<int32_t>(deadlineMs - millis())) > 0) {
+         ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining));
      }
  }
  
  void SensorManager::dhtReadTask(void* parameter) {
      SensorManager* sensorManager = static_cast<SensorManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
+     sensorManager->_nextDhtReadMs = millis();
      
      while (true) {
-         // Read upper DHT sensor
+         TASK_LOOP_MARK();
+         
+         // Read upper DHT sensor, at full clock so the RMT keeps its 1 µs APB ticks
          if (sensorManager->_isDht1Initialized) {
+             ScopedPowerLock powerLock(getAppCore()->getPowerManager(), PowerLock::SENSORS);
              sensorManager->readDhtSensor(sensorManager->_upperDht, sensorManager->_upperDhtReading, 
                                           sensorManager->_dht1ErrorCount, "Upper DHT");
          }
@@ -592,29 +1080,87 @@
          
          // Read lower DHT sensor
          if (sensorManager->_isDht2Initialized) {
+             ScopedPowerLock powerLock(getAppCore()->getPowerManager(), PowerLock::SENSORS);
              sensorManager->readDhtSensor(sensorManager->_lowerDht, sensorManager->_lowerDhtReading, 
                                           sensorManager->_dht2ErrorCount, "Lower DHT");
          }
          
+         // Record the fused tent reading once per cycle
+         sensorManager->recordTentSample();
+         
+         // Hand closed minute buckets to the time-series store outside the sensor lock
+         sensorManager->persistClosedRollups();
+         
+         // Let live clients know, the web server only pushes actual changes
+         getAppCore()->getWebServer()->notifySensorUpdate();
+         
+         // Fresh samples may cross a threshold, wake the relay control loop
+         getAppCore()->getRelayManager()->notifyControlTask(RelayManager::WAKE_SENSORS);
+         
          // Wait for the next reading period
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(sensorManager->_dhtInterval));
+         sensorManager->_nextDhtReadMs = nextReadTime(sensorManager->_nextDhtReadMs, sensorManager->_dhtInterval);
+         waitUntil(sensorManager->_nextDhtReadMs);
      }
  }
  
  void SensorManager::scdReadTask(void* parameter) {
      SensorManager* sensorManager = static_cast<SensorManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
      
      // Initial delay to stagger readings
-     vTaskDelay(pdMS_TO_TICKS(1000));
+     uint32_t intervalStart = millis() + 1000;
+     sensorManager->_nextScdReadMs = sensorManager->nextScdSample(intervalStart);
+     if (sensorManager->_scdMode != ScdMode::SINGLE_SHOT) {
+         sensorManager->_nextScdReadMs -= Constants::SCD40_READY_LEAD_MS;
+     }
+     reserveScdWindow(sensorManager->_nextScdReadMs);
+     waitUntil(sensorManager->_nextScdReadMs);
      
      while (true) {
+         TASK_LOOP_MARK();
+         
          // Read SCD40 sensor
          if (sensorManager->_isScdInitialized) {
-             sensorManager->readScdSensor();
+             // Single shot: trigger a conversion and sleep through it
+             if (sensorManager->_scdMode == ScdMode::SINGLE_SHOT) {
+                 bool triggered = false;
+                 
+                 if (xSemaphoreTake(sensorManager->_sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                     ScopedPowerLock powerLock(getAppCore()->getPowerManager(), PowerLock::SENSORS);
+                     triggered = sensorManager->startScdSingleShot();
+                     
+                     // Release mutex
+                     xSemaphoreGive(sensorManager->_sensorMutex);
+                 }
+                 
+                 if (triggered) {
+                     sensorManager->_nextScdReadMs = millis() + Constants::SCD40_SINGLE_SHOT_MS - Constants::SCD40_READY_LEAD_MS;
+                     reserveScdWindow(sensorManager->_nextScdReadMs);
+                     waitUntil(sensorManager->_nextScdReadMs);
+                 }
+             }
+             
+             // The sample is due now, poll for it instead of reading blind
+             ScopedPowerLock powerLock(getAppCore()->getPowerManager(), PowerLock::SENSORS);
+             sensorManager->readScdSensor(Constants::SCD40_READY_LEAD_MS + Constants::SCD40_READY_TIMEOUT_MS);
          }
+         releaseScdWindow();
          
-         // Wait for the next reading period
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(sensorManager->_scdInterval));
+         // Hand closed minute buckets to the time-series store outside the sensor lock
+         sensorManager->persistClosedRollups();
+         
+         // Let live clients know, the web server only pushes actual changes
+         getAppCore()->getWebServer()->notifySensorUpdate();
+         
+         // Fresh samples may cross a threshold, wake the relay control loop
+         getAppCore()->getRelayManager()->notifyControlTask(RelayManager::WAKE_SENSORS);
+         
+         // Wait for the next reading period, until just before the first sample due after it
+         intervalStart = nextReadTime(intervalStart, sensorManager->_scdInterval);
+         sensorManager->_nextScdReadMs = sensorManager->nextScdSample(intervalStart);
+         if (sensorManager->_scdMode != ScdMode::SINGLE_SHOT) {
+             sensorManager->_nextScdReadMs -= Constants::SCD40_READY_LEAD_MS;
+         }
+         reserveScdWindow(sensorManager->_nextScdReadMs);
+         waitUntil(sensorManager->_nextScdReadMs);
      }
  }
\ No newline at end of file
@@ -7,7 +7,6 @@
  #define SENSOR_MANAGER_H
  
  #include <Arduino.h>
- #include <DHT.h>
  #include <SensirionI2cScd4x.h>
  #include <Wire.h>
  #include <freertos/FreeRTOS.h>
@@ -16,20 +15,43 @@
  #include <freertos/queue.h>
  #include <vector>
  #include "../utils/Constants.h"
+ #include "../utils/SeqLock.h"
+ #include "SensorHistory.h"
+ #include "Dht22Rmt.h"
+ #include "SensorFusion.h"
  
  // Forward declarations
  class AppCore;
  
  /**
-  * @struct SensorReading
-  * @brief Structure to hold sensor data
+  * @struct GraphPoint
+  * @brief One aligned graph sample of the three sensors and the fused tent reading (NAN where no data)
   */
- struct SensorReading {
-     float temperature;
-     float humidity;
-     float co2;
-     uint32_t timestamp;
-     bool valid;
+ struct GraphPoint {
+     float upperDht;
+     float lowerDht;
+     float scd;
+     float tent;
+     uint32_t timestamp;      // Unix seconds
+ };
+ 
+ /**
+  * @struct GraphQuery
+  * @brief Resolved graph request whose points can be read back in batches
+  *
+  * Entries are addressed by sequence number rather than ring index, so points
+  * read later still refer to the same samples while new readings arrive.
+  */
+ struct GraphQuery {
+     uint8_t dataType;
+     HistoryTier tier;
+     bool fromStore;                  // Served from the TimeSeriesStore instead of RAM
+     uint32_t resolution;             // Bucket width in seconds (0 for raw samples)
+     size_t pointCount;
+     size_t available;                // RAM: entries inside the span, strided down to pointCount
+     uint32_t firstSequence[4];       // RAM: sequence number of the oldest selected entry per series
+     uint32_t from;                   // Store: start of the first slot in Unix seconds
+     uint32_t to;                     // Store: end of the range in Unix seconds
  };
  
  /**
@@ -87,7 +109,25 @@
      void getSensorIntervals(uint32_t& dhtInterval, uint32_t& scdInterval);
      
      /**
-      * @brief Get the most recent sensor readings
+      * @brief Switch the SCD40 measurement mode
+      *
+      * Periodic modes are read right after a sample lands at the first one
+      * due after each read interval; single shot triggers a conversion per
+      * read and leaves the sensor idle in between. Intervals shorter than
+      * the mode's sample period read at the sample period.
+      * @param mode Measurement mode
+      * @return True if the sensor accepted the mode (it is kept for the next init otherwise)
+      */
+     bool setScdMode(ScdMode mode);
+     
+     /**
+      * @brief Get the SCD40 measurement mode
+      * @return Measurement mode
+      */
+     ScdMode getScdMode();
+     
+     /**
+      * @brief Get the most recent sensor readings (lock-free, safe from any task or core)
       * @param upperDht Output parameter for upper DHT22 reading
       * @param lowerDht Output parameter for lower DHT22 reading
       * @param scd Output parameter for SCD40 reading
@@ -96,12 +136,68 @@
      bool getSensorReadings(SensorReading& upperDht, SensorReading& lowerDht, SensorReading& scd);
      
      /**
-      * @brief Get graph data for a specified time period
+      * @brief Get the filtered tent reading fused from all sensors (lock-free)
+      *
+      * Updated with every sensor sample. Sensors that disagree with the
+      * others or stopped reporting are left out and lower the confidence.
+      * @param tent Output parameter for the fused reading
+      * @return True if the reading is valid
+      */
+     bool getTentReading(FusedReading& tent);
+     
+     /**
+      * @brief Get the sensor readings and the tent reading from the same sample (lock-free)
+      * @param upperDht Output parameter for upper DHT22 reading
+      * @param lowerDht Output parameter for lower DHT22 reading
+      * @param scd Output parameter for SCD40 reading
+      * @param tent Output parameter for the fused reading
+      * @return True if any sensor reading is valid
+      */
+     bool getSensorReadings(SensorReading& upperDht, SensorReading& lowerDht, SensorReading& scd, FusedReading& tent);
+     
+     /**
+      * @brief Prepare a graph query over the in-memory history
       * @param dataType 0 for temperature, 1 for humidity, 2 for CO2
       * @param maxPoints Maximum number of data points to return
-      * @return Vector of data points
+      * @param spanSeconds Time span to cover, 0 for the latest raw points
+      * @param query Output query for readGraphPoints()
+      * @return True if the history could be locked
+      */
+     bool prepareGraphQuery(uint8_t dataType, uint16_t maxPoints, uint32_t spanSeconds, GraphQuery& query);
+     
+     /**
+      * @brief Prepare a graph query for an absolute time range in the persistent store
+      * @param dataType 0 for temperature, 1 for humidity, 2 for CO2
+      * @param maxPoints Maximum number of data points to return
+      * @param from Range start in Unix seconds
+      * @param to Range end in Unix seconds
+      * @param query Output query for readGraphPoints(), averaged into pointCount slots
+      * @return True if the range is valid
+      */
+     bool prepareGraphRangeQuery(uint8_t dataType, uint16_t maxPoints, uint32_t from, uint32_t to, GraphQuery& query);
+     
+     /**
+      * @brief Read a batch of points of a prepared query
+      * @param query Query from prepareGraphQuery() or prepareGraphRangeQuery()
+      * @param first Index of the first point to read
+      * @param count Number of points to read (at most GRAPH_READ_BATCH_POINTS)
+      * @param points Output buffer for count points
+      * @return Number of points written
       */
-     std::vector<std::vector<float>> getGraphData(uint8_t dataType, uint16_t maxPoints);
+     size_t readGraphPoints(const GraphQuery& query, size_t first, size_t count, GraphPoint* points);
+     
+     /**
+      * @brief Set the number of readings kept in each sensor history
+      * @param points History capacity per sensor (clears existing history)
+      * @return True if history storage was reallocated successfully
+      */
+     bool setHistoryCapacity(uint16_t points);
+     
+     /**
+      * @brief Get the number of readings kept in each sensor history
+      * @return History capacity per sensor
+      */
+     uint16_t getHistoryCapacity();
      
      /**
       * @brief Test a specific sensor
@@ -117,15 +213,37 @@
       */
      bool resetSensor(uint8_t sensorType);
      
+     /**
+      * @brief Time one forced upper DHT22 read and one SCD40 I2C transaction
+      *
+      * The DHT22 read bypasses the driver's 2 s cache, so the next
+      * scheduled read of that sensor may come early for the sensor.
+      * @param dhtUs Start signal plus RMT capture in microseconds, 0 if the read failed
+      * @param scdUs Data ready query duration in microseconds, 0 if it failed
+      * @return True if either sensor answered
+      */
+     bool benchmarkSensors(uint32_t& dhtUs, uint32_t& scdUs);
+     
      /**
       * @brief Create RTOS tasks for sensor operations
       */
      void createTasks();
      
+     /**
+      * @brief Get the time until the earlier of the next DHT22 and SCD40 reads
+      * @return Milliseconds, 0 while a read is due or running, UINT32_MAX without read tasks
+      */
+     uint32_t msUntilNextRead();
+     
+     /**
+      * @brief Make the read tasks re-check their deadlines (e.g. after a light sleep)
+      */
+     void wakeTasks();
+     
  private:
      // Sensor instances
-     DHT _upperDht;
-     DHT _lowerDht;
+     Dht22Rmt _upperDht;
+     Dht22Rmt _lowerDht;
      SensirionI2CScd4x _scd40;
      
      // Sensor pins
@@ -138,6 +256,14 @@
      uint32_t _dhtInterval;
      uint32_t _scdInterval;
      
+     // SCD40 measurement mode and millis() of a sample seen landing (0 while unknown)
+     volatile ScdMode _scdMode;
+     uint32_t _scdSampleMs;
+     
+     // millis() of the next read, kept by the read tasks
+     volatile uint32_t _nextDhtReadMs;
+     volatile uint32_t _nextScdReadMs;
+     
      // Sensor status
      bool _isDht1Initialized;
      bool _isDht2Initialized;
@@ -154,12 +280,34 @@
      SensorReading _lowerDhtReading;
      SensorReading _scdReading;
      
+     /**
+      * @struct SensorSnapshot
+      * @brief Latest readings of all sensors, published as one unit
+      */
+     struct SensorSnapshot {
+         SensorReading upperDht;
+         SensorReading lowerDht;
+         SensorReading scd;
+         FusedReading tent;
+     };
+     
+     // Lock-free copy of the latest readings for getSensorReadings()
+     SeqLock<SensorSnapshot> _snapshot;
+     
      // Graph data storage
-     std::vector<SensorReading> _upperDhtHistory;
-     std::vector<SensorReading> _lowerDhtHistory;
-     std::vector<SensorReading> _scdHistory;
+     SensorHistory _upperDhtHistory;
+     SensorHistory _lowerDhtHistory;
+     SensorHistory _scdHistory;
+     SensorHistory _tentHistory;
      uint16_t _maxHistoryPoints;
      
+     // Filtering and fusion of the samples into the tent reading
+     SensorFusion _fusion;
+     
+     // Closed 1-minute buckets waiting to be persisted (indexed by sensor id, 3 is the tent)
+     SensorRollup _closedRollups[4];
+     bool _hasClosedRollup[4];
+     
      // RTOS resources
      SemaphoreHandle_t _sensorMutex;
      TaskHandle_t _dhtTaskHandle;
@@ -168,9 +316,20 @@
      // Private methods
      bool initializeDhtSensors();
      bool initializeScdSensor();
-     bool readDhtSensor(DHT& sensor, SensorReading& reading, uint8_t& errorCount, const char* sensorName);
-     bool readScdSensor();
-     void addReadingToHistory(const SensorReading& reading, std::vector<SensorReading>& history);
+     bool readDhtSensor(Dht22Rmt& sensor, SensorReading& reading, uint8_t& errorCount, const char* sensorName);
+     bool readScdSensor(uint32_t readyTimeoutMs);
+     bool startScdMeasurement();
+     bool startScdSingleShot();
+     uint32_t scdSamplePeriod() const;
+     uint32_t nextScdSample(uint32_t afterMs) const;
+     void publishSnapshot();
+     void addReadingToHistory(const SensorReading& reading, SensorHistory& history, uint8_t sensorId);
+     void recordTentSample();
+     void persistClosedRollups();
+     void restoreHistory();
+     size_t countPointsInSpan(const SensorHistory& history, HistoryTier tier, uint32_t spanSeconds);
+     static uint32_t nextReadTime(uint32_t previousMs, uint32_t intervalMs);
+     static void waitUntil(uint32_t deadlineMs);
      
      // Task functions
      static void dhtReadTask(void* parameter);
@@ -12,15 +12,78 @@
  #include <mbedtls/base64.h>
  #include <mbedtls/md.h>
  #include <mbedtls/aes.h>
+ #include <esp_system.h>
+ #include <initializer_list>
+ #include <memory>
+ #include <new>
+ 
+ namespace {
+     const size_t KLAP_SEED_SIZE = 16;
+     const size_t KLAP_HASH_SIZE = 32;
+     const size_t AES_BLOCK_SIZE = 16;
+     const uint32_t SESSION_MARGIN_MS = 60000;    // Renew a session this long before the device drops it
+     const uint8_t REQUEST_ATTEMPTS = 2;          // A rejected session gets one new handshake
+     
+     struct DigestPart {
+         const void* data;
+         size_t length;
+     };
+     
+     // Hash of the concatenated parts
+     void digest(mbedtls_md_type_t type, std::initializer_list<DigestPart> parts, uint8_t* output) {
+         mbedtls_md_context_t context;
+         mbedtls_md_init(&context);
+         mbedtls_md_setup(&context, mbedtls_md_info_from_type(type), 0);
+         mbedtls_md_starts(&context);
+         for (const DigestPart& part : parts) {
+             mbedtls_md_update(&context, static_cast<const uint8_t*>(part.data), part.length);
+         }
+         mbedtls_md_finish(&context, output);
+         mbedtls_md_free(&context);
+     }
+     
+     void writeBigEndian(int32_t value, uint8_t output[4]) {
+         uint32_t bits = static_cast<uint32_t>(value);
+         output[0] = bits >> 24;
+         output[1] = bits >> 16;
+         output[2] = bits >> 8;
+         output[3] = bits;
+     }
+     
+     // AES-128-CBC in place, the IV is the session prefix followed by the sequence number
+     bool aesCbc(int mode, const TapoSession& session, uint8_t* data, size_t length) {
+         uint8_t iv[AES_BLOCK_SIZE];
+         memcpy(iv, session.ivPrefix, sizeof(session.ivPrefix));
+         writeBigEndian(session.sequence, iv + sizeof(session.ivPrefix));
+         
+         mbedtls_aes_context aes;
+         mbedtls_aes_init(&aes);
+         int result = mode == MBEDTLS_AES_ENCRYPT ? mbedtls_aes_setkey_enc(&aes, session.key, 128) 
+                                                  : mbedtls_aes_setkey_dec(&aes, session.key, 128);
+         if (result == 0) {
+             result = mbedtls_aes_crypt_cbc(&aes, mode, length, iv, data, data);
+         }
+         mbedtls_aes_free(&aes);
+         return result == 0;
+     }
+     
+     void beginRequest(HTTPClient& http) {
+         http.setConnectTimeout(Constants::TAPO_HTTP_TIMEOUT_MS);
+         http.setTimeout(Constants::TAPO_HTTP_TIMEOUT_MS);
+     }
+ }
  
  TapoManager::TapoManager() :
      _username(""),
      _password(""),
-     _token(""),
-     _tokenExpiry(0),
-     _tapoMutex(nullptr),
-     _tapoTaskHandle(nullptr)
+     _hasAuthHash(false),
+     _tapoMutex(xSemaphoreCreateMutex()),    // Before begin(), the tasks and web handlers may run first
+     _tapoTaskHandle(nullptr),
+     _pollQueue(nullptr)
  {
+     for (uint8_t i = 0; i < Constants::TAPO_POLL_WORKERS; i++) {
+         _workerHandles[i] = nullptr;
+     }
  }
  
  TapoManager::~TapoManager() {
@@ -32,16 +95,30 @@
      if (_tapoTaskHandle != nullptr) {
          vTaskDelete(_tapoTaskHandle);
      }
+     
+     for (uint8_t i = 0; i < Constants::TAPO_POLL_WORKERS; i++) {
+         if (_workerHandles[i] != nullptr) {
+             vTaskDelete(_workerHandles[i]);
+         }
+     }
+     
+     if (_pollQueue != nullptr) {
+         vQueueDelete(_pollQueue);
+     }
  }
  
  bool TapoManager::begin() {
-     // Create mutex for thread-safe operations
-     _tapoMutex = xSemaphoreCreateMutex();
+     // The mutex is created with the object
      if (_tapoMutex == nullptr) {
          Serial.println("Failed to create Tapo mutex!");
          return false;
      }
      
+     // The poll tasks are already running
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return false;
+     }
+     
      // Load saved devices
      loadDevices();
      
@@ -70,8 +147,17 @@
          nvs_close(nvsHandle);
      }
      
+     // Derive the local credential
+     authenticate();
+     
+     size_t deviceCount = _devices.size();
+     xSemaphoreGive(_tapoMutex);
+     
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Tapo", 
-         "Tapo manager initialized with " + String(_devices.size()) + " devices");
+         "Tapo manager initialized with " + String(deviceCount) + " devices");
+     
+     // Plugs that replace a relay take over its automation
+     getAppCore()->getRelayManager()->refreshBackends();
      
      return true;
  }
@@ -85,7 +171,6 @@
      if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          _username = username;
          _password = password;
-         _token = "";  // Invalidate token, will be refreshed on next use
          
          // Save credentials to NVS
          nvs_handle_t nvsHandle;
@@ -100,7 +185,7 @@
          getAppCore()->getLogManager()->log(LogLevel::INFO, "Tapo", 
              "Tapo credentials updated for user: " + username);
          
-         // Test authentication
+         // New credential, sessions made with the old one are dropped
          bool authResult = authenticate();
          
          xSemaphoreGive(_tapoMutex);
@@ -132,6 +217,12 @@
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Add or update device
+         if (_devices.find(device.id) == _devices.end() && _devices.size() >= Constants::TAPO_MAX_DEVICES) {
+             xSemaphoreGive(_tapoMutex);
+             getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+                 "Tapo device limit reached, not adding " + device.id);
+             return false;
+         }
          _devices[device.id] = device;
          
          // Save to storage
@@ -146,8 +237,735 @@
          }
          
          xSemaphoreGive(_tapoMutex);
+         
+         if (success) {
+             getAppCore()->getRelayManager()->refreshBackends();
+         }
          return success;
      }
      
      return false;
+ }
+ 
+ bool TapoManager::removeDevice(const String& deviceId) {
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             String name = it->second.name;
+             _sessions.erase(it->second.ipAddress);
+             _devices.erase(it);
+             
+             // Save to storage
+             success = saveDevices();
+             
+             if (success) {
+                 getAppCore()->getLogManager()->log(LogLevel::INFO, "Tapo", 
+                     "Removed Tapo device: " + name + " (" + deviceId + ")");
+             } else {
+                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+                     "Failed to save Tapo devices after removing " + deviceId);
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     // A relay the device replaced goes back to its pin
+     if (success) {
+         getAppCore()->getRelayManager()->refreshBackends();
+     }
+     return success;
+ }
+ 
+ bool TapoManager::updateDevice(const String& deviceId, const TapoDevice& device) {
+     if (device.ipAddress.isEmpty()) {
+         return false;
+     }
+     
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             TapoDevice& existing = it->second;
+             
+             // A session belongs to an address
+             if (existing.ipAddress != device.ipAddress) {
+                 _sessions.erase(existing.ipAddress);
+                 existing.lastUpdate = 0;
+             }
+             
+             // The ID and the polled state are kept
+             existing.name = device.name;
+             existing.deviceType = device.deviceType;
+             existing.ipAddress = device.ipAddress;
+             existing.macAddress = device.macAddress;
+             existing.relayReplacement = device.relayReplacement;
+             
+             // Save to storage
+             success = saveDevices();
+             
+             if (success) {
+                 getAppCore()->getLogManager()->log(LogLevel::INFO, "Tapo", 
+                     "Updated Tapo device: " + device.name + " (" + deviceId + ")");
+             } else {
+                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+                     "Failed to save Tapo device: " + deviceId);
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     // The relay replacement may have moved
+     if (success) {
+         getAppCore()->getRelayManager()->refreshBackends();
+     }
+     return success;
+ }
+ 
+ TapoDevice TapoManager::getDevice(const String& deviceId) {
+     TapoDevice device;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             device = it->second;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return device;
+ }
+ 
+ std::vector<TapoDevice> TapoManager::getAllDevices() {
+     std::vector<TapoDevice> devices;
+     
+     // The mutex could not be created
+     if (_tapoMutex == nullptr) {
+         return devices;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t now = millis();
+         devices.reserve(_devices.size());
+         
+         for (auto& entry : _devices) {
+             TapoDevice& device = entry.second;
+             
+             // Serve the cached status, stale entries are refreshed in the background
+             if (device.lastUpdate == 0 || now - device.lastUpdate >= Constants::TAPO_STATUS_TTL_MS) {
+                 queuePoll(device);
+             }
+             devices.push_back(device);
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return devices;
+ }
+ 
+ bool TapoManager::requestState(const String& deviceId, bool state) {
+     bool known = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             TapoDevice& device = it->second;
+             device.hasTargetState = true;
+             device.targetState = state;
+             
+             // A device already in the queue picks up the new state when it is served
+             queuePoll(device);
+             known = true;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return known;
+ }
+ 
+ bool TapoManager::controlDevice(const String& deviceId, bool state) {
+     String ipAddress;
+     String name;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             ipAddress = it->second.ipAddress;
+             name = it->second.name;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     if (ipAddress.isEmpty()) {
+         return false;
+     }
+     
+     StaticJsonDocument<64> params;
+     params["device_on"] = state;
+     bool success = sendDeviceCommand(ipAddress, "set_device_info", params.as<JsonVariant>());
+     
+     // The new state is known without another poll
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             it->second.online = success;
+             if (success) {
+                 it->second.isOn = state;
+                 it->second.lastUpdate = millis();
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     if (success) {
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "Tapo", 
+             "Tapo device " + name + " turned " + (state ? "ON" : "OFF"));
+     } else {
+         getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+             "Failed to switch Tapo device " + name + " (" + ipAddress + ")");
+     }
+     
+     return success;
+ }
+ 
+ bool TapoManager::getDeviceStatus(const String& deviceId, bool forceUpdate) {
+     if (forceUpdate) {
+         pollDevice(deviceId);
+     }
+     
+     bool isOn = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             TapoDevice& device = it->second;
+             if (!forceUpdate && (device.lastUpdate == 0 || millis() - device.lastUpdate >= Constants::TAPO_STATUS_TTL_MS)) {
+                 queuePoll(device);
+             }
+             isOn = device.isOn;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return isOn;
+ }
+ 
+ int TapoManager::updateAllDeviceStatus() {
+     int queued = 0;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (auto& entry : _devices) {
+             TapoDevice& device = entry.second;
+             if (!device.pollQueued) {
+                 queuePoll(device);
+                 queued += device.pollQueued ? 1 : 0;
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return queued;
+ }
+ 
+ void TapoManager::createTasks() {
+     _pollQueue = xQueueCreate(Constants::TAPO_POLL_QUEUE_SIZE, sizeof(PollRequest));
+     if (_pollQueue == nullptr) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", "Failed to create Tapo poll queue");
+         return;
+     }
+     
+     // Workers poll in parallel, so each only waits on its own device's round trips
+     for (uint8_t i = 0; i < Constants::TAPO_POLL_WORKERS; i++) {
+         char taskName[16];
+         snprintf(taskName, sizeof(taskName), "TapoPoll%u", i);
+         
+         BaseType_t result = xTaskCreatePinnedToCore(
+             pollWorkerTask,
+             taskName,
+             Constants::STACK_SIZE_TAPO_WORKER,
+             this,
+             Constants::PRIORITY_TAPO,
+             &_workerHandles[i],
+             0
+         );
+         
+         if (result != pdPASS) {
+             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+                 "Failed to create " + String(taskName) + " task");
+         }
+     }
+     
+     BaseType_t result = xTaskCreatePinnedToCore(
+         tapoTask,                     // Task function
+         "TapoTask",                   // Task name
+         Constants::STACK_SIZE_TAPO,   // Stack size (words)
+         this,                         // Task parameters
+         Constants::PRIORITY_TAPO,     // Priority (low)
+         &_tapoTaskHandle,             // Task handle
+         0                             // Core ID (0 - protocol core)
+     );
+     
+     if (result != pdPASS) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", "Failed to create Tapo task");
+     }
+ }
+ 
+ bool TapoManager::loadDevices() {
+     // Caller must hold _tapoMutex
+     if (!SPIFFS.exists(Constants::TAPO_DEVICES_FILE)) {
+         return false;
+     }
+     
+     File file = SPIFFS.open(Constants::TAPO_DEVICES_FILE, FILE_READ);
+     if (!file) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+             "Failed to open " + String(Constants::TAPO_DEVICES_FILE));
+         return false;
+     }
+     
+     DynamicJsonDocument doc(Constants::TAPO_DEVICES_DOC_SIZE);
+     DeserializationError error = deserializeJson(doc, file);
+     file.close();
+     
+     if (error || !doc["devices"].is<JsonArrayConst>()) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+             "Failed to parse " + String(Constants::TAPO_DEVICES_FILE));
+         return false;
+     }
+     
+     _devices.clear();
+     for (JsonObjectConst entry : doc["devices"].as<JsonArrayConst>()) {
+         TapoDevice device(entry["id"] | "", entry["name"] | "", entry["type"] | "", 
+                           entry["ip"] | "", entry["mac"] | "", entry["relay"] | 0);
+         if (device.id.isEmpty() || device.ipAddress.isEmpty() || _devices.size() >= Constants::TAPO_MAX_DEVICES) {
+             continue;
+         }
+         _devices[device.id] = device;
+     }
+     
+     return true;
+ }
+ 
+ bool TapoManager::saveDevices() {
+     // Caller must hold _tapoMutex, only the configuration is saved
+     DynamicJsonDocument doc(Constants::TAPO_DEVICES_DOC_SIZE);
+     JsonArray devices = doc.createNestedArray("devices");
+     for (const auto& entry : _devices) {
+         const TapoDevice& device = entry.second;
+         JsonObject deviceObj = devices.createNestedObject();
+         deviceObj["id"] = device.id;
+         deviceObj["name"] = device.name;
+         deviceObj["type"] = device.deviceType;
+         deviceObj["ip"] = device.ipAddress;
+         deviceObj["mac"] = device.macAddress;
+         deviceObj["relay"] = device.relayReplacement;
+     }
+     
+     File file = SPIFFS.open(Constants::TAPO_DEVICES_FILE, FILE_WRITE);
+     if (!file) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Tapo", 
+             "Failed to open " + String(Constants::TAPO_DEVICES_FILE) + " for writing");
+         return false;
+     }
+     
+     bool success = serializeJson(doc, file) > 0;
+     file.close();
+     return success;
+ }
+ 
+ bool TapoManager::authenticate() {
+     // Caller must hold _tapoMutex. KLAP has no cloud
+     // login, each device checks this hash of the account credentials.
+     _sessions.clear();
+     _hasAuthHash = false;
+     
+     if (_username.isEmpty() || _password.isEmpty()) {
+         return false;
+     }
+     
+     uint8_t usernameHash[20];
+     uint8_t passwordHash[20];
+     digest(MBEDTLS_MD_SHA1, {{_username.c_str(), _username.length()}}, usernameHash);
+     digest(MBEDTLS_MD_SHA1, {{_password.c_str(), _password.length()}}, passwordHash);
+     digest(MBEDTLS_MD_SHA256, {{usernameHash, sizeof(usernameHash)}, {passwordHash, sizeof(passwordHash)}}, _authHash);
+     
+     _hasAuthHash = true;
+     return true;
+ }
+ 
+ bool TapoManager::sendDeviceCommand(const String& ipAddress, const String& command, const JsonVariant& payload, 
+                                     String* response) {
+     DynamicJsonDocument request(512);
+     request["method"] = command;
+     if (!payload.isNull()) {
+         request["params"] = payload;
+     }
+     
+     String plain;
+     serializeJson(request, plain);
+     
+     // PKCS#7 always pads, so the ciphertext is at least one byte longer
+     size_t paddedLength = (plain.length() / AES_BLOCK_SIZE + 1) * AES_BLOCK_SIZE;
+     std::unique_ptr<uint8_t[]> body(new (std::nothrow) uint8_t[KLAP_HASH_SIZE + paddedLength]);
+     if (!body) {
+         return false;
+     }
+     uint8_t* cipher = body.get() + KLAP_HASH_SIZE;
+     
+     for (uint8_t attempt = 0; attempt < REQUEST_ATTEMPTS; attempt++) {
+         TapoSession session;
+         if (!getSession(ipAddress, session)) {
+             return false;
+         }
+         
+         // Signature hash of the sequence number and ciphertext, then the ciphertext
+         uint8_t padding = paddedLength - plain.length();
+         memcpy(cipher, plain.c_str(), plain.length());
+         memset(cipher + plain.length(), padding, padding);
+         if (!aesCbc(MBEDTLS_AES_ENCRYPT, session, cipher, paddedLength)) {
+             return false;
+         }
+         
+         uint8_t sequence[4];
+         writeBigEndian(session.sequence, sequence);
+         digest(MBEDTLS_MD_SHA256, {{session.signature, sizeof(session.signature)}, {sequence, sizeof(sequence)}, 
+                                    {cipher, paddedLength}}, body.get());
+         
+         WiFiClient client;
+         HTTPClient http;
+         beginRequest(http);
+         if (!http.begin(client, "http://" + ipAddress + "/app/request?seq=" + String(session.sequence))) {
+             return false;
+         }
+         http.addHeader("Cookie", session.cookie);
+         
+         int httpCode = http.POST(body.get(), KLAP_HASH_SIZE + paddedLength);
+         String reply = httpCode == HTTP_CODE_OK ? http.getString() : String();
+         http.end();
+         
+         if (httpCode <= 0) {
+             // Unreachable, a new handshake would not help
+             return false;
+         }
+         
+         // A rejected request or an undecodable reply means the device dropped the session
+         size_t replyLength = reply.length();
+         if (httpCode != HTTP_CODE_OK || replyLength <= KLAP_HASH_SIZE || 
+             (replyLength - KLAP_HASH_SIZE) % AES_BLOCK_SIZE != 0) {
+             invalidateSession(ipAddress);
+             continue;
+         }
+         
+         uint8_t* data = reinterpret_cast<uint8_t*>(&reply[KLAP_HASH_SIZE]);
+         size_t dataLength = replyLength - KLAP_HASH_SIZE;
+         uint8_t replyPadding = 0;
+         if (aesCbc(MBEDTLS_AES_DECRYPT, session, data, dataLength)) {
+             replyPadding = data[dataLength - 1];
+         }
+         if (replyPadding == 0 || replyPadding > AES_BLOCK_SIZE) {
+             invalidateSession(ipAddress);
+             continue;
+         }
+         
+         String decrypted = reply.substring(KLAP_HASH_SIZE, replyLength - replyPadding);
+         
+         StaticJsonDocument<32> filter;
+         filter["error_code"] = true;
+         StaticJsonDocument<64> status;
+         DeserializationError error = deserializeJson(status, decrypted, DeserializationOption::Filter(filter));
+         int errorCode = error ? -1 : (status["error_code"] | -1);
+         
+         if (errorCode != 0) {
+             getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+                 "Tapo device " + ipAddress + " " + command + " failed with error " + String(errorCode));
+             return false;
+         }
+         
+         if (response != nullptr) {
+             *response = decrypted;
+         }
+         return true;
+     }
+     
+     return false;
+ }
+ 
+ bool TapoManager::getSession(const String& ipAddress, TapoSession& session) {
+     bool found = false;
+     bool hasCredential = false;
+     uint8_t authHash[KLAP_HASH_SIZE];
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _sessions.find(ipAddress);
+         if (it != _sessions.end() && static_cast<int32_t>(it->second.expiresMs - millis()) > 0) {
+             // Every request needs its own sequence number, also from concurrent callers
+             it->second.sequence++;
+             session = it->second;
+             found = true;
+         }
+         
+         hasCredential = _hasAuthHash;
+         memcpy(authHash, _authHash, sizeof(authHash));
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     if (found) {
+         return true;
+     }
+     if (!hasCredential || !handshake(ipAddress, authHash, session)) {
+         return false;
+     }
+     
+     // Keep the session for the following requests, this one uses the next sequence number
+     session.sequence++;
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _sessions[ipAddress] = session;
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return true;
+ }
+ 
+ bool TapoManager::handshake(const String& ipAddress, const uint8_t authHash[32], TapoSession& session) {
+     uint8_t localSeed[KLAP_SEED_SIZE];
+     esp_fill_random(localSeed, sizeof(localSeed));
+     
+     WiFiClient client;
+     HTTPClient http;
+     beginRequest(http);
+     
+     // First round trip: exchange seeds, the device proves it knows the credential
+     if (!http.begin(client, "http://" + ipAddress + "/app/handshake1")) {
+         return false;
+     }
+     const char* headerKeys[] = {"Set-Cookie"};
+     http.collectHeaders(headerKeys, 1);
+     
+     int httpCode = http.POST(localSeed, sizeof(localSeed));
+     String reply = httpCode == HTTP_CODE_OK ? http.getString() : String();
+     String cookie = http.header("Set-Cookie");
+     http.end();
+     
+     if (reply.length() != KLAP_SEED_SIZE + KLAP_HASH_SIZE || cookie.isEmpty()) {
+         getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+             "Tapo handshake with " + ipAddress + " failed, HTTP " + String(httpCode));
+         return false;
+     }
+     
+     const uint8_t* remoteSeed = reinterpret_cast<const uint8_t*>(reply.c_str());
+     uint8_t hash[KLAP_HASH_SIZE];
+     digest(MBEDTLS_MD_SHA256, {{localSeed, KLAP_SEED_SIZE}, {remoteSeed, KLAP_SEED_SIZE}, 
+                                {authHash, KLAP_HASH_SIZE}}, hash);
+     if (memcmp(hash, remoteSeed + KLAP_SEED_SIZE, KLAP_HASH_SIZE) != 0) {
+         getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+             "Tapo device " + ipAddress + " does not accept the account credentials");
+         return false;
+     }
+     
+     // The cookie is "TP_SESSIONID=<id>;TIMEOUT=<seconds>"
+     uint32_t lifetimeMs = Constants::TAPO_SESSION_MAX_MS;
+     int timeoutPos = cookie.indexOf("TIMEOUT=");
+     if (timeoutPos >= 0) {
+         long seconds = cookie.substring(timeoutPos + 8).toInt();
+         if (seconds > 0) {
+             lifetimeMs = min(lifetimeMs, static_cast<uint32_t>(seconds) * 1000U);
+         }
+     }
+     int separator = cookie.indexOf(';');
+     session.cookie = separator >= 0 ? cookie.substring(0, separator) : cookie;
+     
+     // Second round trip: the same proof in the other direction
+     digest(MBEDTLS_MD_SHA256, {{remoteSeed, KLAP_SEED_SIZE}, {localSeed, KLAP_SEED_SIZE}, 
+                                {authHash, KLAP_HASH_SIZE}}, hash);
+     if (!http.begin(client, "http://" + ipAddress + "/app/handshake2")) {
+         return false;
+     }
+     http.addHeader("Cookie", session.cookie);
+     httpCode = http.POST(hash, sizeof(hash));
+     http.end();
+     
+     if (httpCode != HTTP_CODE_OK) {
+         getAppCore()->getLogManager()->log(LogLevel::WARN, "Tapo", 
+             "Tapo handshake with " + ipAddress + " rejected, HTTP " + String(httpCode));
+         return false;
+     }
+     
+     // Session keys come from both seeds and the credential
+     digest(MBEDTLS_MD_SHA256, {{"lsk", 3}, {localSeed, KLAP_SEED_SIZE}, {remoteSeed, KLAP_SEED_SIZE}, 
+                                {authHash, KLAP_HASH_SIZE}}, hash);
+     memcpy(session.key, hash, sizeof(session.key));
+     
+     digest(MBEDTLS_MD_SHA256, {{"iv", 2}, {localSeed, KLAP_SEED_SIZE}, {remoteSeed, KLAP_SEED_SIZE}, 
+                                {authHash, KLAP_HASH_SIZE}}, hash);
+     memcpy(session.ivPrefix, hash, sizeof(session.ivPrefix));
+     session.sequence = static_cast<int32_t>((static_cast<uint32_t>(hash[28]) << 24) | (hash[29] << 16) | 
+                                             (hash[30] << 8) | hash[31]);
+     
+     digest(MBEDTLS_MD_SHA256, {{"ldk", 3}, {localSeed, KLAP_SEED_SIZE}, {remoteSeed, KLAP_SEED_SIZE}, 
+                                {authHash, KLAP_HASH_SIZE}}, hash);
+     memcpy(session.signature, hash, sizeof(session.signature));
+     
+     session.expiresMs = millis() + (lifetimeMs > 2 * SESSION_MARGIN_MS ? lifetimeMs - SESSION_MARGIN_MS : lifetimeMs / 2);
+     return true;
+ }
+ 
+ void TapoManager::invalidateSession(const String& ipAddress) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _sessions.erase(ipAddress);
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+ }
+ 
+ bool TapoManager::pollDevice(const String& deviceId) {
+     String ipAddress;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             ipAddress = it->second.ipAddress;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     if (ipAddress.isEmpty()) {
+         return false;
+     }
+     
+     // Network round trip without the lock
+     String response;
+     bool success = sendDeviceCommand(ipAddress, "get_device_info", JsonVariant(), &response);
+     bool isOn = false;
+     
+     if (success) {
+         // Only the power state is kept from the full device info
+         StaticJsonDocument<64> filter;
+         filter["result"]["device_on"] = true;
+         StaticJsonDocument<Constants::TAPO_STATUS_DOC_SIZE> doc;
+         success = !deserializeJson(doc, response, DeserializationOption::Filter(filter)) && 
+                   doc["result"]["device_on"].is<bool>();
+         isOn = doc["result"]["device_on"] | false;
+     }
+     
+     // Update the cache, a failed poll also counts so an offline plug is not retried on every read
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             TapoDevice& device = it->second;
+             device.online = success;
+             device.lastUpdate = millis();
+             if (success) {
+                 device.isOn = isOn;
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     return success;
+ }
+ 
+ void TapoManager::serviceDevice(const String& deviceId) {
+     bool hasTarget = false;
+     bool target = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             hasTarget = it->second.hasTargetState;
+             target = it->second.targetState;
+             it->second.hasTargetState = false;
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+     
+     // A switch also refreshes the state, no poll needed after it
+     bool success = hasTarget ? controlDevice(deviceId, target) : pollDevice(deviceId);
+     
+     if (xSemaphoreTake(_tapoMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _devices.find(deviceId);
+         if (it != _devices.end()) {
+             TapoDevice& device = it->second;
+             device.pollQueued = false;
+             
+             if (device.hasTargetState) {
+                 // Requested while this one was in flight, the device stays with one worker at a time
+                 queuePoll(device);
+             } else if (hasTarget && !success) {
+                 // Keep the request for the next sweep rather than retrying an offline plug at once
+                 device.hasTargetState = true;
+                 device.targetState = target;
+             }
+         }
+         
+         xSemaphoreGive(_tapoMutex);
+     }
+ }
+ 
+ void TapoManager::queuePoll(TapoDevice& device) {
+     // Called with _tapoMutex held, a device waits in the queue at most once
+     if (_pollQueue == nullptr || device.pollQueued) {
+         return;
+     }
+     
+     PollRequest request;
+     strlcpy(request.deviceId, device.id.c_str(), sizeof(request.deviceId));
+     if (xQueueSend(_pollQueue, &request, 0) == pdTRUE) {
+         device.pollQueued = true;
+     }
+ }
+ 
+ void TapoManager::tapoTask(void* parameter) {
+     TapoManager* tapoManager = static_cast<TapoManager*>(parameter);
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Only queues the sweep, the workers do the round trips
+         if (WiFi.status() == WL_CONNECTED) {
+             tapoManager->updateAllDeviceStatus();
+         }
+         
+         vTaskDelay(pdMS_TO_TICKS(Constants::TAPO_POLL_INTERVAL_MS));
+     }
+ }
+ 
+ void TapoManager::pollWorkerTask(void* parameter) {
+     TapoManager* tapoManager = static_cast<TapoManager*>(parameter);
+     PollRequest request;
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         if (xQueueReceive(tapoManager->_pollQueue, &request, portMAX_DELAY) == pdTRUE) {
+             tapoManager->serviceDevice(String(request.deviceId));
+         }
+     }
  }
\ No newline at end of file
@@ -10,6 +10,7 @@
  #include <freertos/FreeRTOS.h>
  #include <freertos/task.h>
  #include <freertos/semphr.h>
+ #include <freertos/queue.h>
  #include <HTTPClient.h>
  #include <ArduinoJson.h>
  #include <vector>
@@ -31,8 +32,11 @@
      String macAddress;     // MAC address
      bool isOn;             // Current power state
      uint8_t relayReplacement; // Which relay this device replaces (0 = none)
-     uint32_t lastUpdate;   // Timestamp of last status update
+     uint32_t lastUpdate;   // millis() of the last status poll, 0 if never polled
      bool online;           // Whether the device is online
+     bool pollQueued;       // Queued for or being served by a poll worker (runtime only)
+     bool hasTargetState;   // A requested switch has not been sent yet (runtime only)
+     bool targetState;      // State to switch to once a worker is free
      
      TapoDevice() : 
          id(""),
@@ -43,7 +47,10 @@
          isOn(false),
          relayReplacement(0),
          lastUpdate(0),
-         online(false) {}
+         online(false),
+         pollQueued(false),
+         hasTargetState(false),
+         targetState(false) {}
      
      TapoDevice(const String& id, const String& name, const String& deviceType, 
                const String& ipAddress, const String& macAddress, uint8_t relayReplacement) :
@@ -55,12 +62,36 @@
          isOn(false),
          relayReplacement(relayReplacement),
          lastUpdate(0),
-         online(false) {}
+         online(false),
+         pollQueued(false),
+         hasTargetState(false),
+         targetState(false) {}
+ };
+ 
+ /**
+  * @struct TapoSession
+  * @brief Local KLAP session with one device, reused until it expires
+  */
+ struct TapoSession {
+     String cookie;         // TP_SESSIONID from the handshake
+     uint8_t key[16];       // AES-128 key
+     uint8_t ivPrefix[12];  // First 12 bytes of every IV, the sequence number follows
+     uint8_t signature[28]; // Prefix of the request signature hash
+     int32_t sequence;      // Last sequence number used
+     uint32_t expiresMs;    // millis() after which a new handshake is needed
  };
  
  /**
   * @class TapoManager
   * @brief Manages Tapo P100 smart socket devices
+  *
+  * Devices are reached over the local KLAP protocol. The handshake costs two
+  * round trips and a few hashes, so each device's session is kept until the
+  * device lets it expire and requests only pay for one AES round trip.
+  * Status is polled by a small pool of worker tasks, so one slow or offline
+  * plug does not delay the others, and readers are served from the cached
+  * status. A status older than TAPO_STATUS_TTL_MS is queued for a refresh
+  * instead of being fetched in the caller.
   */
  class TapoManager {
  public:
@@ -105,6 +136,8 @@
      
      /**
       * @brief Update a Tapo device's information
+      *
+      * The ID and the polled state are kept, a new address gets a new session.
       * @param deviceId Device ID to update
       * @param device Updated device information
       * @return True if device updated successfully
@@ -114,12 +147,12 @@
      /**
       * @brief Get a specific Tapo device
       * @param deviceId Device ID to retrieve
-      * @return Device information
+      * @return Device information, with an empty ID if the device is unknown
       */
      TapoDevice getDevice(const String& deviceId);
      
      /**
-      * @brief Get all Tapo devices
+      * @brief Get all Tapo devices with their cached status, never waits on the network
       * @return Vector of all Tapo devices
       */
      std::vector<TapoDevice> getAllDevices();
@@ -132,23 +165,31 @@
       */
      bool controlDevice(const String& deviceId, bool state);
      
+     /**
+      * @brief Queue a switch of a Tapo device for the poll workers, never waits on the network
+      *
+      * Only the latest request per device is kept. A request that fails is
+      * retried with the next status sweep unless a newer one replaced it.
+      * @param deviceId Device ID to control
+      * @param state True to turn on, false to turn off
+      * @return True if the device is known
+      */
+     bool requestState(const String& deviceId, bool state);
+     
      /**
       * @brief Get the status of a Tapo device
+      *
+      * Without forceUpdate the cached state is returned at once and a stale
+      * one is queued for a refresh.
       * @param deviceId Device ID to check
-      * @param forceUpdate Force a status update from the device
+      * @param forceUpdate Query the device now, blocking the caller
       * @return True if device is on
       */
      bool getDeviceStatus(const String& deviceId, bool forceUpdate = false);
      
      /**
-      * @brief Discover Tapo devices on the network
-      * @return Number of devices discovered
-      */
-     int discoverDevices();
-     
-     /**
-      * @brief Update all device statuses
-      * @return Number of devices successfully updated
+      * @brief Queue a status poll of every device for the worker pool
+      * @return Number of devices queued
       */
      int updateAllDeviceStatus();
      
@@ -158,31 +199,50 @@
      void createTasks();
      
  private:
+     /**
+      * @struct PollRequest
+      * @brief Device queued for a status poll
+      */
+     struct PollRequest {
+         char deviceId[Constants::TAPO_DEVICE_ID_SIZE];
+     };
+     
      // Configuration
      String _username;
      String _password;
-     String _token;
-     uint32_t _tokenExpiry;
+     uint8_t _authHash[32];     // SHA-256 of SHA-1(username) and SHA-1(password), the KLAP credential
+     bool _hasAuthHash;
      
      // Device storage
      std::map<String, TapoDevice> _devices;
      
+     // Sessions by IP address, guarded by _tapoMutex
+     std::map<String, TapoSession> _sessions;
+     
      // RTOS resources
      SemaphoreHandle_t _tapoMutex;
      TaskHandle_t _tapoTaskHandle;
+     QueueHandle_t _pollQueue;
+     TaskHandle_t _workerHandles[Constants::TAPO_POLL_WORKERS];
      
      // API implementation
      bool authenticate();
-     bool sendDeviceCommand(const String& ipAddress, const String& command, const JsonVariant& payload = JsonVariant());
-     bool refreshToken();
-     String getDeviceToken(const String& ipAddress);
+     bool sendDeviceCommand(const String& ipAddress, const String& command, const JsonVariant& payload = JsonVariant(), 
+                            String* response = nullptr);
+     bool getSession(const String& ipAddress, TapoSession& session);
+     bool handshake(const String& ipAddress, const uint8_t authHash[32], TapoSession& session);
+     void invalidateSession(const String& ipAddress);
      
      // Helper methods
      bool loadDevices();
      bool saveDevices();
+     bool pollDevice(const String& deviceId);
+     void serviceDevice(const String& deviceId);
+     void queuePoll(TapoDevice& device);
      
-     // Task function
+     // Task functions
      static void tapoTask(void* parameter);
+     static void pollWorkerTask(void* parameter);
  };
  
  #endif // TAPO_MANAGER_H
\ No newline at end of file
@@ -5,6 +5,7 @@
 
  #include "AppCore.h"
  #include "../utils/Constants.h"
+ #include "../web/SecureWebServer.h"
  #include <esp_system.h>
  #include <esp_task_wdt.h>
  
@@ -20,6 +21,7 @@
      _isFirstBoot(false),
      _isInSetupMode(false),
      _isInitialized(false),
+     _secureWebServer(nullptr),
      _systemMutex(nullptr),
      _initTaskHandle(nullptr)
  {
@@ -37,6 +39,8 @@
      if (_initTaskHandle != nullptr) {
          vTaskDelete(_initTaskHandle);
      }
+     
+     delete _secureWebServer;
  }
  
  bool AppCore::begin() {
@@ -138,6 +142,10 @@
  
  void AppCore::reboot() {
      _logManager.log(LogLevel::INFO, "System", "System rebooting...");
+     _timeSeriesStore.flush();    // Keep the batched history records
+     _profileManager.flush();     // Write debounced profile edits
+     _storageManager.saveSettings();  // Commit dirty settings blocks
+     _logManager.flush();         // Write out the partial log block
      delay(1000);  // Allow log to be written
      esp_restart();
  }
@@ -151,15 +159,28 @@
          _networkManager.createTasks();
          _webServer.createTasks();
          _logManager.createTasks();
+         if (_secureWebServer != nullptr) {
+             _secureWebServer->createTasks();
+         }
      } else {
-         // For normal operation, create all tasks
+         // For normal operation, create all tasks. Sensor acquisition and
+         // relay control run on the application core, away from WiFi and lwIP.
          _networkManager.createTasks();
          _webServer.createTasks();
+         if (_secureWebServer != nullptr) {
+             _secureWebServer->createTasks();
+         }
          _sensorManager.createTasks();
+         _displayManager.createTasks();
          _relayManager.createTasks();
+         _tapoManager.createTasks();
          _logManager.createTasks();
+         
+         // Low-rate periodic jobs share the scheduler task, add them before it starts
          _maintenanceManager.createTasks();
          _timeManager.createTasks();
+         _powerManager.createTasks();
+         _jobScheduler.createTasks();
          
          if (_profileManager.isMQTTEnabled()) {
              _mqttClient.createTasks();
@@ -177,24 +198,30 @@
                     ", SSID: " + ssid + 
                     ", hostname: " + hostname + 
                     "\nYou can access the device at http://" + ip + ":" + String(webPort) + "/index.html or http://" + hostname + ".local:" + String(webPort) + "/index.html");
+     
+     _mqttClient.setNetworkAvailable(true);
  }
  
  void AppCore::onWiFiDisconnected() {
-    _logManager.log(LogLevel::WARN, "System", "WiFi disconnected. Attempting to reconnect...");
-    
-    _logManager.log(LogLevel::INFO, "System", 
-        "Configuration mode started. Connect to WiFi AP '" + 
-        String(Constants::DEFAULT_AP_SSID) + 
-        "' and visit http://192.168.4.1 to configure the device");
-    
-    // Initialize RTOS tasks for setup mode
-    initRTOSTasks();
-}
+     _logManager.log(LogLevel::WARN, "System", "WiFi disconnected. Attempting to reconnect...");
+     
+     // The network manager reconnects (and brings up the configuration AP
+     // if that keeps failing), MQTT just stops trying the broker meanwhile
+     _mqttClient.setNetworkAvailable(false);
+ }
  
  void AppCore::startNormalOperation() {
      _logManager.log(LogLevel::INFO, "System", "Starting normal operation mode");
      _isInSetupMode = false;
      
+     // Connection changes are pushed by the network manager's state machine
+     _networkManager.onWiFiConnected([this](const String& ip, const String& ssid) {
+         onWiFiConnected(ip, ssid);
+     });
+     _networkManager.onWiFiDisconnected([this]() {
+         onWiFiDisconnected();
+     });
+     
      // Start in station mode with saved credentials
      if (_networkManager.startSTAMode()) {
          _logManager.log(LogLevel::INFO, "System", "Connecting to WiFi...");
@@ -212,6 +239,7 @@
      
      // Start the web server for normal operation
      _webServer.startNormalMode();
+     startSecureWebServer(false);
      
      // Enable OTA updates
      _otaManager.enableUpdates();
@@ -219,6 +247,9 @@
      // Initialize sensors fully
      _sensorManager.fullInitialization();
      
+     // Status display, on the bus the SCD40 initialization just started
+     _displayManager.begin();
+     
      // Initialize relays
      _relayManager.initRelays();
      
@@ -228,12 +259,14 @@
      _logManager.log(LogLevel::INFO, "System", "Starting " + String(Constants::APP_NAME) + " v" + String(Constants::APP_VERSION));
      
      _storageManager.begin();
+     _timeSeriesStore.begin();
      _securityManager.begin();
      _timeManager.begin();
      _maintenanceManager.begin();
      _powerManager.begin();
      _notificationManager.begin();
      _profileManager.begin();
+     _growPhaseScheduler.begin();
      
      // These will be fully initialized in the appropriate mode
      _networkManager.begin();
@@ -241,11 +274,34 @@
      _otaManager.begin();
      _sensorManager.begin();
      _relayManager.begin();
+     _tapoManager.begin();        // After the relays, it binds the plugs that replace one
      
      _logManager.log(LogLevel::INFO, "System", "All managers initialized");
      _isInitialized = true;
  }
  
+ void AppCore::startSecureWebServer(bool configMode) {
+ #if HTTPS_SERVER_ENABLED
+     // Certificate loaded from NVS, made once on the first start
+     if (_secureWebServer == nullptr) {
+         _secureWebServer = new SecureWebServer();
+         if (!_secureWebServer->begin()) {
+             _logManager.log(LogLevel::ERROR, "System", "Secure web server unavailable, serving HTTP only");
+             delete _secureWebServer;
+             _secureWebServer = nullptr;
+             return;
+         }
+     }
+     
+     // Its task starts it, or restarts it in the other mode
+     if (configMode) {
+         _secureWebServer->startConfigurationMode();
+     } else {
+         _secureWebServer->startNormalMode();
+     }
+ #endif
+ }
+ 
  bool AppCore::needsInitialSetup() {
      // Check if WiFi credentials exist in NVS
      nvs_handle_t nvsHandle;
@@ -291,6 +347,7 @@
      
      // Start the web server for configuration
      _webServer.startConfigurationMode();
+     startSecureWebServer(true);
      
      _logManager.log(LogLevel::INFO, "System");
     }
\ No newline at end of file
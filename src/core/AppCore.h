@@ -16,18 +16,33 @@
  #include "../network/NetworkManager.h"
  #include "../network/MQTTClient.h"
  #include "../system/StorageManager.h"
+ #include "../system/TimeSeriesStore.h"
  #include "../system/TimeManager.h"
  #include "../system/LogManager.h"
  #include "../system/MaintenanceManager.h"
  #include "../system/PowerManager.h"
  #include "../system/NotificationManager.h"
  #include "../system/ProfileManager.h"
+ #include "../system/GrowPhaseScheduler.h"
+ #include "../system/JobScheduler.h"
  #include "../web/WebServer.h"       // Changed back to regular WebServer
  #include "../ota/OTAManager.h"
+ #include "../components/I2CBus.h"
  #include "../components/SensorManager.h"
  #include "../components/RelayManager.h"
+ #include "../components/TapoManager.h"
+ #include "../components/DisplayManager.h"
  #include "../core/SecurityManager.h"
  
+ // HTTPS server next to the plain one, set with -D HTTPS_SERVER_ENABLED=0 to leave it out.
+ // Each open TLS connection costs about 40 KB of heap.
+ #ifndef HTTPS_SERVER_ENABLED
+ #define HTTPS_SERVER_ENABLED 1
+ #endif
+ 
+ // Kept out of this header, the HTTPS library's names would reach every file
+ class SecureWebServer;
+ 
  /**
   * @class AppCore
   * @brief Central orchestrator that manages all system modules and tasks
@@ -73,16 +88,22 @@
      NetworkManager* getNetworkManager() { return &_networkManager; }
      MQTTClient* getMQTTClient() { return &_mqttClient; }
      StorageManager* getStorageManager() { return &_storageManager; }
+     TimeSeriesStore* getTimeSeriesStore() { return &_timeSeriesStore; }
      TimeManager* getTimeManager() { return &_timeManager; }
      LogManager* getLogManager() { return &_logManager; }
      MaintenanceManager* getMaintenanceManager() { return &_maintenanceManager; }
      PowerManager* getPowerManager() { return &_powerManager; }
      NotificationManager* getNotificationManager() { return &_notificationManager; }
      ProfileManager* getProfileManager() { return &_profileManager; }
+     GrowPhaseScheduler* getGrowPhaseScheduler() { return &_growPhaseScheduler; }
+     JobScheduler* getJobScheduler() { return &_jobScheduler; }
      WebServer* getWebServer() { return &_webServer; }  // Changed back to WebServer
      OTAManager* getOTAManager() { return &_otaManager; }
+     I2CBus* getI2CBus() { return &_i2cBus; }
      SensorManager* getSensorManager() { return &_sensorManager; }
      RelayManager* getRelayManager() { return &_relayManager; }
+     TapoManager* getTapoManager() { return &_tapoManager; }
+     DisplayManager* getDisplayManager() { return &_displayManager; }
      SecurityManager* getSecurityManager() { return &_securityManager; }
      
      // Global event handlers
@@ -99,17 +120,24 @@
      NetworkManager _networkManager;
      MQTTClient _mqttClient;
      StorageManager _storageManager;
+     TimeSeriesStore _timeSeriesStore;
      TimeManager _timeManager;
      LogManager _logManager;
      MaintenanceManager _maintenanceManager;
      PowerManager _powerManager;
      NotificationManager _notificationManager;
      ProfileManager _profileManager;
+     GrowPhaseScheduler _growPhaseScheduler;
+     JobScheduler _jobScheduler;
      WebServer _webServer;            // Changed back to WebServer
      OTAManager _otaManager;
+     I2CBus _i2cBus;                  // Shared by the SCD40 and the display
      SensorManager _sensorManager;
      RelayManager _relayManager;
+     TapoManager _tapoManager;
+     DisplayManager _displayManager;
      SecurityManager _securityManager;
+     SecureWebServer* _secureWebServer;   // Created on start, nullptr without HTTPS
      
      // RTOS resources
      SemaphoreHandle_t _systemMutex;
@@ -121,6 +149,7 @@
      bool initNVS();
      void initManagers();
      void initRTOSTasks();
+     void startSecureWebServer(bool configMode);
      
      // Task functions (static because they need to be passed to xTaskCreate)
      static void initTaskFunction(void* parameter);
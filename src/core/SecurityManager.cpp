@@ -5,12 +5,19 @@
 
  #include "SecurityManager.h"
  #include "../core/AppCore.h"
+ #include <mbedtls/platform_util.h>
+ #include <esp_system.h>
  
  SecurityManager::SecurityManager() :
      _securityMutex(nullptr),
      _isInitialized(false),
      _otaPassword("")
  {
+     for (auto& session : _sessions) {
+         session.token[0] = '\0';
+         session.lastUsed = 0;
+         session.active = false;
+     }
  }
  
  SecurityManager::~SecurityManager() {
@@ -114,25 +121,59 @@
  }
  
  bool SecurityManager::validatePassword(const String& password, const String& storedHash) {
-     // Calculate hash of the provided password
-     String calculatedHash = hashPassword(password);
+     // Legacy format, Base64 of an unsalted SHA-256
+     if (!storedHash.startsWith("pbkdf2$")) {
+         uint8_t digest[32];
+         sha256((const uint8_t*)password.c_str(), password.length(), digest);
+         String calculatedHash = base64Encode(digest, sizeof(digest));
+         
+         // Compare with stored hash, without returning early on the first difference
+         return calculatedHash.length() == storedHash.length() && 
+                constantTimeEquals(calculatedHash.c_str(), storedHash.c_str(), storedHash.length());
+     }
+     
+     // "pbkdf2$<iterations>$<salt>$<hash>"
+     int first = storedHash.indexOf('$');
+     int second = storedHash.indexOf('$', first + 1);
+     int third = second < 0 ? -1 : storedHash.indexOf('$', second + 1);
+     if (third < 0) {
+         return false;
+     }
+     
+     uint32_t iterations = storedHash.substring(first + 1, second).toInt();
+     uint8_t salt[Constants::PASSWORD_SALT_SIZE];
+     size_t saltLength = sizeof(salt);
+     uint8_t expected[32];
+     size_t expectedLength = sizeof(expected);
+     if (iterations == 0 || 
+         !base64Decode(storedHash.substring(second + 1, third), salt, &saltLength) || 
+         !base64Decode(storedHash.substring(third + 1), expected, &expectedLength) || 
+         expectedLength != sizeof(expected)) {
+         return false;
+     }
+     
+     uint8_t calculated[32];
+     if (!deriveKey(password, salt, saltLength, iterations, calculated, sizeof(calculated))) {
+         return false;
+     }
      
-     // Compare with stored hash
-     return calculatedHash.equals(storedHash);
+     return constantTimeEquals((const char*)calculated, (const char*)expected, sizeof(calculated));
  }
  
  String SecurityManager::hashPassword(const String& password) {
-     // Use SHA-256 for password hashing
-     uint8_t hash[32];
-     mbedtls_sha256_context ctx;
+     // A fresh salt per password, so equal passwords get different hashes
+     uint8_t salt[Constants::PASSWORD_SALT_SIZE];
+     esp_fill_random(salt, sizeof(salt));
      
-     mbedtls_sha256_init(&ctx);
-     mbedtls_sha256_starts_ret(&ctx, 0); // 0 for SHA-256, 1 for SHA-224
-     mbedtls_sha256_update_ret(&ctx, (const unsigned char*)password.c_str(), password.length());
-     mbedtls_sha256_finish_ret(&ctx, hash);
+     uint8_t hash[32];
+     if (!deriveKey(password, salt, sizeof(salt), Constants::PASSWORD_KDF_ITERATIONS, hash, sizeof(hash))) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Security", "Password hashing failed");
+         return "";
+     }
      
-     // Convert hash to base64 string for storage
-     return base64Encode(hash, sizeof(hash));
+     // Convert salt and hash to base64 strings for storage
+     return "pbkdf2$" + String(Constants::PASSWORD_KDF_ITERATIONS) + "$" + 
+            base64Encode(salt, sizeof(salt)) + "$" + base64Encode(hash, sizeof(hash));
  }
  
  String SecurityManager::generateRandomToken(size_t length) {
@@ -147,45 +188,172 @@
      return token;
  }
  
- String SecurityManager::encrypt(const String& data, const String& key) {
-     // Simple XOR encryption for demonstration purposes
-     // In a real application, use a proper encryption algorithm like AES
+ String SecurityManager::createSession() {
+     String token = "";
+     if (!_isInitialized) {
+         return token;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_securityMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t now = millis();
+         
+         // A free or expired slot, otherwise the one idle the longest
+         HttpSession* slot = &_sessions[0];
+         for (auto& session : _sessions) {
+             if (!session.active || now - session.lastUsed > Constants::HTTP_SESSION_TTL_MS) {
+                 slot = &session;
+                 break;
+             }
+             if (now - session.lastUsed > now - slot->lastUsed) {
+                 slot = &session;
+             }
+         }
+         
+         token = generateRandomToken(Constants::HTTP_SESSION_TOKEN_LENGTH);
+         memcpy(slot->token, token.c_str(), Constants::HTTP_SESSION_TOKEN_LENGTH + 1);
+         slot->lastUsed = now;
+         slot->active = true;
+         
+         // Release mutex
+         xSemaphoreGive(_securityMutex);
+     }
+     
+     return token;
+ }
+ 
+ bool SecurityManager::validateSession(const String& token) {
+     if (!_isInitialized || token.length() != Constants::HTTP_SESSION_TOKEN_LENGTH) {
+         return false;
+     }
+     
+     bool valid = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_securityMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t now = millis();
+         
+         for (auto& session : _sessions) {
+             if (!session.active) {
+                 continue;
+             }
+             if (now - session.lastUsed > Constants::HTTP_SESSION_TTL_MS) {
+                 session.active = false;
+                 continue;
+             }
+             if (constantTimeEquals(session.token, token.c_str(), Constants::HTTP_SESSION_TOKEN_LENGTH)) {
+                 session.lastUsed = now;
+                 valid = true;
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_securityMutex);
+     }
      
-     uint8_t* encrypted = new uint8_t[data.length()];
+     return valid;
+ }
+ 
+ void SecurityManager::revokeSession(const String& token) {
+     if (!_isInitialized || token.length() != Constants::HTTP_SESSION_TOKEN_LENGTH) {
+         return;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_securityMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (auto& session : _sessions) {
+             if (session.active && 
+                 constantTimeEquals(session.token, token.c_str(), Constants::HTTP_SESSION_TOKEN_LENGTH)) {
+                 session.active = false;
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_securityMutex);
+     }
+ }
+ 
+ void SecurityManager::revokeAllSessions() {
+     if (!_isInitialized) {
+         return;
+     }
      
-     for (size_t i = 0; i < data.length(); i++) {
-         encrypted[i] = data[i] ^ key[i % key.length()];
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_securityMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (auto& session : _sessions) {
+             session.active = false;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_securityMutex);
+     }
+ }
+ 
+ String SecurityManager::encrypt(const String& data, const String& key) {
+     // 256-bit AES key from the key string
+     uint8_t aesKey[32];
+     sha256((const uint8_t*)key.c_str(), key.length(), aesKey);
+     
+     // Nonce, ciphertext and tag in one buffer
+     size_t length = data.length();
+     size_t sealedLength = Constants::CRYPTO_GCM_IV_SIZE + length + Constants::CRYPTO_GCM_TAG_SIZE;
+     uint8_t* sealed = new uint8_t[sealedLength];
+     uint8_t* ciphertext = sealed + Constants::CRYPTO_GCM_IV_SIZE;
+     esp_fill_random(sealed, Constants::CRYPTO_GCM_IV_SIZE);
+     
+     mbedtls_gcm_context ctx;
+     mbedtls_gcm_init(&ctx);
+     int ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, aesKey, 256);
+     if (ret == 0) {
+         ret = mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, length, 
+                                         sealed, Constants::CRYPTO_GCM_IV_SIZE, nullptr, 0, 
+                                         (const unsigned char*)data.c_str(), ciphertext, 
+                                         Constants::CRYPTO_GCM_TAG_SIZE, ciphertext + length);
      }
+     mbedtls_gcm_free(&ctx);
+     mbedtls_platform_zeroize(aesKey, sizeof(aesKey));
      
-     String result = base64Encode(encrypted, data.length());
+     String result = ret == 0 ? base64Encode(sealed, sealedLength) : "";
      
-     delete[] encrypted;
+     delete[] sealed;
      
      return result;
  }
  
  String SecurityManager::decrypt(const String& data, const String& key) {
-     // Simple XOR decryption for demonstration purposes
-     // In a real application, use a proper encryption algorithm like AES
+     size_t sealedLength = data.length() * 3 / 4; // Upper bound of the base64 decoded length
+     uint8_t* sealed = new uint8_t[sealedLength];
      
-     size_t decodedLength = data.length() * 3 / 4; // Approximate base64 decoded length
-     uint8_t* decoded = new uint8_t[decodedLength];
-     
-     if (!base64Decode(data, decoded, &decodedLength)) {
-         delete[] decoded;
+     if (!base64Decode(data, sealed, &sealedLength) || 
+         sealedLength < Constants::CRYPTO_GCM_IV_SIZE + Constants::CRYPTO_GCM_TAG_SIZE) {
+         delete[] sealed;
          return "";
      }
      
-     char* decrypted = new char[decodedLength + 1];
-     
-     for (size_t i = 0; i < decodedLength; i++) {
-         decrypted[i] = decoded[i] ^ key[i % key.length()];
+     size_t length = sealedLength - Constants::CRYPTO_GCM_IV_SIZE - Constants::CRYPTO_GCM_TAG_SIZE;
+     const uint8_t* ciphertext = sealed + Constants::CRYPTO_GCM_IV_SIZE;
+     char* decrypted = new char[length + 1];
+     
+     uint8_t aesKey[32];
+     sha256((const uint8_t*)key.c_str(), key.length(), aesKey);
+     
+     // Fails on a wrong key or modified data, nothing is returned then
+     mbedtls_gcm_context ctx;
+     mbedtls_gcm_init(&ctx);
+     int ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, aesKey, 256);
+     if (ret == 0) {
+         ret = mbedtls_gcm_auth_decrypt(&ctx, length, sealed, Constants::CRYPTO_GCM_IV_SIZE, nullptr, 0, 
+                                        ciphertext + length, Constants::CRYPTO_GCM_TAG_SIZE, 
+                                        ciphertext, (unsigned char*)decrypted);
      }
+     mbedtls_gcm_free(&ctx);
+     mbedtls_platform_zeroize(aesKey, sizeof(aesKey));
      
-     decrypted[decodedLength] = '\0';
-     String result = String(decrypted);
+     decrypted[length] = '\0';
+     String result = ret == 0 ? String(decrypted) : "";
      
-     delete[] decoded;
+     mbedtls_platform_zeroize(decrypted, length);
+     delete[] sealed;
      delete[] decrypted;
      
      return result;
@@ -256,6 +424,41 @@
      return result;
  }
  
+ bool SecurityManager::constantTimeEquals(const char* a, const char* b, size_t length) {
+     // Time depends only on the length, not on where the strings differ
+     uint8_t diff = 0;
+     for (size_t i = 0; i < length; i++) {
+         diff |= static_cast<uint8_t>(a[i]) ^ static_cast<uint8_t>(b[i]);
+     }
+     return diff == 0;
+ }
+ 
+ bool SecurityManager::deriveKey(const String& password, const uint8_t* salt, size_t saltLength, 
+                                 uint32_t iterations, uint8_t* output, size_t outputLength) {
+     mbedtls_md_context_t ctx;
+     mbedtls_md_init(&ctx);
+     
+     // HMAC-SHA256, every SHA block runs on the accelerator
+     int ret = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+     if (ret == 0) {
+         ret = mbedtls_pkcs5_pbkdf2_hmac(&ctx, (const unsigned char*)password.c_str(), password.length(), 
+                                         salt, saltLength, iterations, outputLength, output);
+     }
+     
+     mbedtls_md_free(&ctx);
+     return ret == 0;
+ }
+ 
+ void SecurityManager::sha256(const uint8_t* data, size_t length, uint8_t* digest) {
+     mbedtls_sha256_context ctx;
+     
+     mbedtls_sha256_init(&ctx);
+     mbedtls_sha256_starts_ret(&ctx, 0); // 0 for SHA-256, 1 for SHA-224
+     mbedtls_sha256_update_ret(&ctx, data, length);
+     mbedtls_sha256_finish_ret(&ctx, digest);
+     mbedtls_sha256_free(&ctx);
+ }
+ 
  bool SecurityManager::base64Decode(const String& input, uint8_t* output, size_t* outputLength) {
      int ret = mbedtls_base64_decode(output, *outputLength, outputLength, 
                                     (const unsigned char*)input.c_str(), input.length());
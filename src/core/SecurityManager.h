@@ -14,11 +14,28 @@
  #include <mbedtls/md.h>
  #include <mbedtls/sha256.h>
  #include <mbedtls/base64.h>
+ #include <mbedtls/gcm.h>
+ #include <mbedtls/pkcs5.h>
  #include "../utils/Constants.h"
  
+ /**
+  * @struct HttpSession
+  * @brief Web session issued after one successful password check
+  */
+ struct HttpSession {
+     char token[Constants::HTTP_SESSION_TOKEN_LENGTH + 1];
+     uint32_t lastUsed;        // millis() of the last request, sessions expire when idle
+     bool active;
+ };
+ 
  /**
   * @class SecurityManager
   * @brief Manages security-related functions including authentication, encryption, and key management
+  *
+  * All hashing and encryption goes through mbedTLS, which the ESP32 core
+  * builds with the SHA and AES peripherals as backends. Passwords are
+  * stored as PBKDF2-HMAC-SHA256 with a random salt, data is sealed with
+  * AES-256-GCM.
   */
  class SecurityManager {
  public:
@@ -63,15 +80,15 @@
      /**
       * @brief Validate password against stored hash
       * @param password Password to validate
-      * @param storedHash Stored password hash
+      * @param storedHash Hash from hashPassword(), or a legacy unsalted SHA-256
       * @return True if password is valid
       */
      bool validatePassword(const String& password, const String& storedHash);
      
      /**
-      * @brief Generate a password hash
+      * @brief Generate a salted password hash
       * @param password Password to hash
-      * @return Hashed password
+      * @return "pbkdf2$<iterations>$<salt>$<hash>", salt and hash Base64 encoded
       */
      String hashPassword(const String& password);
      
@@ -83,18 +100,42 @@
      String generateRandomToken(size_t length = 32);
      
      /**
-      * @brief Encrypt a string
+      * @brief Start a web session, replacing the least recently used one if all slots are taken
+      * @return Session token, empty on failure
+      */
+     String createSession();
+     
+     /**
+      * @brief Check a session token and extend its expiry
+      * @param token Token from the session cookie
+      * @return True if the token belongs to a live session
+      */
+     bool validateSession(const String& token);
+     
+     /**
+      * @brief End a web session (logout)
+      * @param token Token from the session cookie
+      */
+     void revokeSession(const String& token);
+     
+     /**
+      * @brief End all web sessions, e.g. after the credentials changed
+      */
+     void revokeAllSessions();
+     
+     /**
+      * @brief Encrypt a string with AES-256-GCM
       * @param data String to encrypt
-      * @param key Encryption key
-      * @return Encrypted string (Base64 encoded)
+      * @param key Encryption key (any length, hashed to 256 bits)
+      * @return Base64 of nonce, ciphertext and tag, empty on failure
       */
      String encrypt(const String& data, const String& key);
      
      /**
-      * @brief Decrypt a string
+      * @brief Decrypt and authenticate a string from encrypt()
       * @param data Encrypted string (Base64 encoded)
       * @param key Encryption key
-      * @return Decrypted string
+      * @return Decrypted string, empty if the data was tampered with or the key is wrong
       */
      String decrypt(const String& data, const String& key);
      
@@ -106,11 +147,18 @@
      bool _isInitialized;
      String _otaPassword;
      
+     // Web sessions, guarded by _securityMutex
+     HttpSession _sessions[Constants::HTTP_SESSION_SLOTS];
+     
      // Helper methods
      bool saveToNvs(const char* key, const String& value);
      String loadFromNvs(const char* key);
      String base64Encode(const uint8_t* data, size_t length);
      bool base64Decode(const String& input, uint8_t* output, size_t* outputLength);
+     static bool constantTimeEquals(const char* a, const char* b, size_t length);
+     static bool deriveKey(const String& password, const uint8_t* salt, size_t saltLength, 
+                           uint32_t iterations, uint8_t* output, size_t outputLength);
+     static void sha256(const uint8_t* data, size_t length, uint8_t* digest);
  };
  
  #endif // SECURITY_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,176 @@
+/**
+ * @file HomeAssistantDiscovery.cpp
+ * @brief Implementation of the HomeAssistantDiscovery class
+ */
+
+ #include "HomeAssistantDiscovery.h"
+ #include "../utils/Helpers.h"
+ #include <ArduinoJson.h>
+
+ namespace {
+     struct SensorEntitySpec {
+         const char* objectId;
+         const char* name;
+         const char* sensor;        // Object in the "sensors" payload
+         const char* field;
+         const char* deviceClass;
+         const char* unit;
+     };
+
+     const SensorEntitySpec SENSOR_SPECS[HomeAssistantDiscovery::SENSOR_ENTITIES] = {
+         {"upper_temperature", "Upper Temperature", "upper_dht", "temperature", "temperature", "°C"},
+         {"upper_humidity", "Upper Humidity", "upper_dht", "humidity", "humidity", "%"},
+         {"lower_temperature", "Lower Temperature", "lower_dht", "temperature", "temperature", "°C"},
+         {"lower_humidity", "Lower Humidity", "lower_dht", "humidity", "humidity", "%"},
+         {"scd_temperature", "SCD40 Temperature", "scd40", "temperature", "temperature", "°C"},
+         {"scd_humidity", "SCD40 Humidity", "scd40", "humidity", "humidity", "%"},
+         {"co2", "CO2", "scd40", "co2", "carbon_dioxide", "ppm"},
+         {"tent_temperature", "Tent Temperature", "tent", "temperature", "temperature", "°C"},
+         {"tent_humidity", "Tent Humidity", "tent", "humidity", "humidity", "%"}
+     };
+ }
+
+ HomeAssistantDiscovery::HomeAssistantDiscovery() :
+     _identitySignature(0)
+ {
+     for (auto& entity : _entities) {
+         entity.topic[0] = '\0';
+         entity.signature = 0;
+         entity.pending = false;
+     }
+ }
+
+ void HomeAssistantDiscovery::configure(const String& nodeId, const String& baseTopic, const String& deviceName) {
+     uint32_t signature = Helpers::hashFNV1a(deviceName.c_str(), Helpers::hashFNV1a(baseTopic.c_str(), Helpers::hashFNV1a(nodeId.c_str())));
+     if (signature == _identitySignature) {
+         return;
+     }
+
+     _nodeId = nodeId;
+     _baseTopic = baseTopic;
+     _deviceName = deviceName;
+     _identitySignature = signature;
+
+     // The sensors only depend on the identity
+     for (uint8_t i = 0; i < SENSOR_ENTITIES; i++) {
+         DiscoveryEntity& entity = _entities[RELAY_ENTITIES + i];
+         buildSensor(entity, i);
+         entity.signature = signature;
+         entity.pending = true;
+     }
+
+     // Relays are rebuilt by the next updateRelays()
+     for (uint8_t i = 0; i < RELAY_ENTITIES; i++) {
+         _entities[i].signature = 0;
+     }
+ }
+
+ void HomeAssistantDiscovery::updateRelays(const std::vector<RelayConfig>& relays) {
+     for (const auto& relay : relays) {
+         if (relay.relayId < 1 || relay.relayId > RELAY_ENTITIES) {
+             continue;
+         }
+
+         DiscoveryEntity& entity = _entities[relay.relayId - 1];
+         uint32_t signature = Helpers::hashFNV1a(relay.name.c_str(), _identitySignature) ^ (relay.visible ? 0x55 : 0xAA);
+         if (signature == entity.signature) {
+             continue;
+         }
+
+         buildRelay(entity, relay);
+         entity.signature = signature;
+         entity.pending = true;
+     }
+ }
+
+ void HomeAssistantDiscovery::markAllPending() {
+     for (auto& entity : _entities) {
+         entity.pending = entity.topic[0] != '\0';
+     }
+ }
+
+ DiscoveryEntity* HomeAssistantDiscovery::nextPending() {
+     for (auto& entity : _entities) {
+         if (entity.pending) {
+             return &entity;
+         }
+     }
+     return nullptr;
+ }
+
+ void HomeAssistantDiscovery::buildRelay(DiscoveryEntity& entity, const RelayConfig& relay) {
+     snprintf(entity.topic, sizeof(entity.topic), "%s/switch/%s/relay%u/config",
+              Constants::MQTT_HA_DISCOVERY_PREFIX, _nodeId.c_str(), relay.relayId);
+
+     // An empty retained config removes the entity
+     if (!relay.visible) {
+         entity.payload = "";
+         return;
+     }
+
+     char uniqueId[64];
+     snprintf(uniqueId, sizeof(uniqueId), "%s_relay%u", _nodeId.c_str(), relay.relayId);
+     char valueTemplate[80];
+     snprintf(valueTemplate, sizeof(valueTemplate),
+              "{{ 'ON' if value_json.relays[%u].is_on else 'OFF' }}", relay.relayId - 1);
+     char commandTopic[32];
+     snprintf(commandTopic, sizeof(commandTopic), "~command/relay/%u", relay.relayId);
+
+     DynamicJsonDocument doc(1024);
+     doc["~"] = _baseTopic;
+     doc["name"] = relay.name;
+     doc["uniq_id"] = uniqueId;
+     doc["stat_t"] = "~relays";
+     doc["val_tpl"] = valueTemplate;
+     doc["cmd_t"] = commandTopic;
+     doc["pl_on"] = "ON";
+     doc["pl_off"] = "OFF";
+     doc["avty_t"] = "~status";
+     doc["pl_avail"] = "online";
+     doc["pl_not_avail"] = "offline";
+
+     JsonObject device = doc.createNestedObject("dev");
+     device["ids"][0] = _nodeId;
+     device["name"] = _deviceName;
+     device["mdl"] = Constants::APP_NAME;
+     device["sw"] = Constants::APP_VERSION;
+
+     entity.payload = "";
+     serializeJson(doc, entity.payload);
+ }
+
+ void HomeAssistantDiscovery::buildSensor(DiscoveryEntity& entity, uint8_t index) {
+     const SensorEntitySpec& spec = SENSOR_SPECS[index];
+     snprintf(entity.topic, sizeof(entity.topic), "%s/sensor/%s/%s/config",
+              Constants::MQTT_HA_DISCOVERY_PREFIX, _nodeId.c_str(), spec.objectId);
+
+     char uniqueId[64];
+     snprintf(uniqueId, sizeof(uniqueId), "%s_%s", _nodeId.c_str(), spec.objectId);
+
+     // "None" makes Home Assistant show the sensor as unknown while it is invalid
+     char valueTemplate[112];
+     snprintf(valueTemplate, sizeof(valueTemplate),
+              "{{ value_json.%s.%s if value_json.%s.valid else None }}", spec.sensor, spec.field, spec.sensor);
+
+     DynamicJsonDocument doc(1024);
+     doc["~"] = _baseTopic;
+     doc["name"] = spec.name;
+     doc["uniq_id"] = uniqueId;
+     doc["stat_t"] = "~sensors";
+     doc["val_tpl"] = valueTemplate;
+     doc["dev_cla"] = spec.deviceClass;
+     doc["unit_of_meas"] = spec.unit;
+     doc["stat_cla"] = "measurement";
+     doc["avty_t"] = "~status";
+     doc["pl_avail"] = "online";
+     doc["pl_not_avail"] = "offline";
+
+     JsonObject device = doc.createNestedObject("dev");
+     device["ids"][0] = _nodeId;
+     device["name"] = _deviceName;
+     device["mdl"] = Constants::APP_NAME;
+     device["sw"] = Constants::APP_VERSION;
+
+     entity.payload = "";
+     serializeJson(doc, entity.payload);
+ }
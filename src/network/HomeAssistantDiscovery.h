@@ -0,0 +1,82 @@
+/**
+ * @file HomeAssistantDiscovery.h
+ * @brief Precomputed Home Assistant MQTT discovery configs for the relays and sensors
+ */
+
+ #ifndef HOME_ASSISTANT_DISCOVERY_H
+ #define HOME_ASSISTANT_DISCOVERY_H
+
+ #include <Arduino.h>
+ #include <vector>
+ #include "../utils/Constants.h"
+ #include "../components/RelayManager.h"
+
+ /**
+  * @struct DiscoveryEntity
+  * @brief One discovery config and whether it still has to be (re)published
+  */
+ struct DiscoveryEntity {
+     char topic[Constants::MQTT_TOPIC_SIZE];   // Absolute topic under the discovery prefix
+     String payload;                           // Empty removes the entity from Home Assistant
+     uint32_t signature;                       // Hash of the inputs the payload was built from
+     bool pending;
+ };
+
+ /**
+  * @class HomeAssistantDiscovery
+  * @brief Builds the discovery configs once and rebuilds only those whose inputs change
+  *
+  * There is one switch per relay (hidden relays publish an empty config so
+  * Home Assistant removes them) and one sensor per measurement of the upper
+  * DHT22, lower DHT22 and SCD40. Payloads use the abbreviated keys and a "~"
+  * base topic to stay small. Each entity keeps a signature of the node id,
+  * base topic, device name and (for relays) name and visibility; update
+  * calls only rebuild an entity when its signature changes. Not thread-safe,
+  * the MQTT task is the only user.
+  */
+ class HomeAssistantDiscovery {
+ public:
+     static constexpr uint8_t RELAY_ENTITIES = 8;
+     static constexpr uint8_t SENSOR_ENTITIES = 9;
+     static constexpr uint8_t ENTITY_COUNT = RELAY_ENTITIES + SENSOR_ENTITIES;
+
+     HomeAssistantDiscovery();
+
+     /**
+      * @brief Set the identity shared by all entities, rebuilding everything if it changed
+      * @param nodeId MQTT client ID, used for unique IDs and discovery topics
+      * @param baseTopic Base topic of the state and command topics (with trailing slash)
+      * @param deviceName Device name shown in Home Assistant
+      */
+     void configure(const String& nodeId, const String& baseTopic, const String& deviceName);
+
+     /**
+      * @brief Rebuild the relay switches whose name or visibility changed
+      * @param relays All relay configurations, ordered by relay ID
+      */
+     void updateRelays(const std::vector<RelayConfig>& relays);
+
+     /**
+      * @brief Queue every config for republishing (e.g. after Home Assistant restarts)
+      */
+     void markAllPending();
+
+     /**
+      * @brief Get the next config waiting to be published
+      * @return Entity, nullptr if all are published
+      */
+     DiscoveryEntity* nextPending();
+
+ private:
+     DiscoveryEntity _entities[ENTITY_COUNT];
+     String _nodeId;
+     String _baseTopic;
+     String _deviceName;
+     uint32_t _identitySignature;
+
+     // Private methods
+     void buildRelay(DiscoveryEntity& entity, const RelayConfig& relay);
+     void buildSensor(DiscoveryEntity& entity, uint8_t index);
+ };
+
+ #endif // HOME_ASSISTANT_DISCOVERY_H
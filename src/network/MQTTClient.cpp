@@ -5,10 +5,54 @@
 
  #include "MQTTClient.h"
  #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+ #include "../utils/Helpers.h"
+ #include "../system/LatencyMonitor.h"
+ #include <algorithm>
+ #include <time.h>
  
  // Static pointer to the current instance for use in the callback
  static MQTTClient* currentInstance = nullptr;
  
+ namespace {
+     const MqttCommandRoute COMMAND_ROUTES[] = {
+         {"command", MqttCommand::COMMAND, 0},
+         {"command/reboot", MqttCommand::REBOOT, 0},
+         {"command/relay", MqttCommand::RELAY, 0},
+         {"command/relay/1", MqttCommand::RELAY_STATE, 1},
+         {"command/relay/2", MqttCommand::RELAY_STATE, 2},
+         {"command/relay/3", MqttCommand::RELAY_STATE, 3},
+         {"command/relay/4", MqttCommand::RELAY_STATE, 4},
+         {"command/relay/5", MqttCommand::RELAY_STATE, 5},
+         {"command/relay/6", MqttCommand::RELAY_STATE, 6},
+         {"command/relay/7", MqttCommand::RELAY_STATE, 7},
+         {"command/relay/8", MqttCommand::RELAY_STATE, 8}
+     };
+     constexpr uint8_t COMMAND_ROUTE_COUNT = sizeof(COMMAND_ROUTES) / sizeof(COMMAND_ROUTES[0]);
+     constexpr uint8_t COMMAND_ROUTE_MASK = Constants::MQTT_COMMAND_ROUTE_SLOTS - 1;
+     constexpr size_t COMMAND_PAYLOAD_SIZE = 64;
+     
+     // Indexed by MqttTopic
+     const char* const TOPIC_NAMES[] = {"status", "sensors", "relays", "system", "diagnostics"};
+     static_assert(sizeof(TOPIC_NAMES) / sizeof(TOPIC_NAMES[0]) == static_cast<size_t>(MqttTopic::COUNT), 
+                   "Every MqttTopic needs a name");
+     
+     static_assert(COMMAND_ROUTE_COUNT < Constants::MQTT_COMMAND_ROUTE_SLOTS, "Command route table needs an empty slot");
+     
+     bool parseRelayState(const char* text, RelayState& state) {
+         if (strcmp(text, "ON") == 0 || strcmp(text, "1") == 0) {
+             state = RelayState::ON;
+         } else if (strcmp(text, "OFF") == 0 || strcmp(text, "0") == 0) {
+             state = RelayState::OFF;
+         } else if (strcmp(text, "AUTO") == 0 || strcmp(text, "2") == 0) {
+             state = RelayState::AUTO;
+         } else {
+             return false;
+         }
+         return true;
+     }
+ }
+ 
  MQTTClient::MQTTClient() :
      _mqttClient(_wifiClient),
      _broker(Constants::DEFAULT_MQTT_BROKER),
@@ -16,21 +60,41 @@
      _username(Constants::DEFAULT_MQTT_USERNAME),
      _password(Constants::DEFAULT_MQTT_PASSWORD),
      _clientId(""),
-     _baseTopic(Constants::DEFAULT_MQTT_TOPIC),
+     _baseTopicLength(0),
      _isConnected(false),
      _lastConnectAttempt(0),
-     _lastPublishTime(0),
      _connectRetryInterval(5000),  // 5 seconds
-     _publishInterval(30000),      // 30 seconds
+     _networkAvailable(true),
+     _lastKeepAlive(0),
+     _sensorRate(Constants::MQTT_SENSOR_MIN_INTERVAL_MS, Constants::DEFAULT_MQTT_HEARTBEAT_SECONDS * 1000),
+     _relayRate(0, Constants::DEFAULT_MQTT_HEARTBEAT_SECONDS * 1000),
+     _systemRate(Constants::MQTT_SYSTEM_INTERVAL_MS, Constants::MQTT_SYSTEM_INTERVAL_MS),
+     _deadbands{Constants::DEFAULT_MQTT_DEADBAND_TEMPERATURE, 
+                Constants::DEFAULT_MQTT_DEADBAND_HUMIDITY, 
+                Constants::DEFAULT_MQTT_DEADBAND_CO2},
+     _publishedReadings{},
+     _lastSensorCheck(0),
+     _relayStatusDirty(false),
+     _lastReplay(0),
+     _discoveryDirty(true),
+     _discoveryRepublish(false),
+     _discoveryEnabled(Constants::DEFAULT_MQTT_HA_DISCOVERY),
      _mqttMutex(nullptr),
      _mqttTaskHandle(nullptr),
-     _publishQueue(nullptr)
+     _publishQueue(nullptr),
+     _freeSlots(nullptr),
+     _publishDoc(Constants::MQTT_JSON_DOC_SIZE),
+     _droppedMessages(0)
  {
      // Set the current instance for the static callback
      currentInstance = this;
      
      // Set the callback function for incoming messages
      _mqttClient.setCallback(mqttCallback);
+     _mqttClient.setKeepAlive(Constants::MQTT_KEEPALIVE_SECONDS);
+     
+     buildTopics(Constants::DEFAULT_MQTT_TOPIC);
+     buildCommandRoutes();
  }
  
  MQTTClient::~MQTTClient() {
@@ -49,6 +113,10 @@
      if (_publishQueue != nullptr) {
          vQueueDelete(_publishQueue);
      }
+     
+     if (_freeSlots != nullptr) {
+         vQueueDelete(_freeSlots);
+     }
  }
  
  bool MQTTClient::begin() {
@@ -59,18 +127,36 @@
          return false;
      }
      
-     // Create queue for publish messages
-     _publishQueue = xQueueCreate(20, sizeof(MqttMessage));
-     if (_publishQueue == nullptr) {
+     // Create queues of pool slot indices, every slot starts out free
+     _publishQueue = xQueueCreate(Constants::MQTT_POOL_SLOTS, sizeof(uint8_t));
+     _freeSlots = xQueueCreate(Constants::MQTT_POOL_SLOTS, sizeof(uint8_t));
+     if (_publishQueue == nullptr || _freeSlots == nullptr) {
          Serial.println("Failed to create MQTT publish queue!");
          return false;
      }
+     for (uint8_t slot = 0; slot < Constants::MQTT_POOL_SLOTS; slot++) {
+         xQueueSend(_freeSlots, &slot, 0);
+     }
+     
+     // Let PubSubClient send a full slot (its default buffer is 256 bytes)
+     if (!_mqttClient.setBufferSize(Constants::MQTT_TOPIC_SIZE + Constants::MQTT_PAYLOAD_SIZE + 8)) {
+         Serial.println("Failed to allocate MQTT buffer!");
+         return false;
+     }
+     
+     // Telemetry queued while the broker is unreachable
+     if (!_backlog.begin(Constants::DEFAULT_MQTT_BACKLOG_SPILL)) {
+         return false;
+     }
      
      // Generate client ID if not set
      if (_clientId.isEmpty()) {
          _clientId = "mushroomtent_" + String(ESP.getEfuseMac(), HEX);
      }
      
+     // "command/#" also matches "command" itself
+     _subscriptions.push_back("command/#");
+     
      return true;
  }
  
@@ -105,12 +191,24 @@
                  "Connected to MQTT broker: " + _broker);
              
              // Re-subscribe to all topics
+             char topic[Constants::MQTT_TOPIC_SIZE];
              for (const auto& subtopic : _subscriptions) {
-                 _mqttClient.subscribe(getFullTopic(subtopic).c_str());
+                 if (getFullTopic(subtopic.c_str(), topic)) {
+                     _mqttClient.subscribe(topic);
+                 }
              }
              
+             // Home Assistant announces its restarts here
+             _mqttClient.subscribe(Constants::MQTT_HA_STATUS_TOPIC);
+             _discoveryRepublish = true;
+             
              // Publish a connection message
-             _mqttClient.publish(getFullTopic("status").c_str(), "online", true);
+             _mqttClient.publish(getTopic(MqttTopic::STATUS), "online", true);
+             
+             // Bring every topic up to date after the gap
+             _sensorRate.published = false;
+             _relayRate.published = false;
+             _systemRate.published = false;
          } else {
              _isConnected = false;
              _lastConnectAttempt = millis();
@@ -132,7 +230,7 @@
      if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          if (_mqttClient.connected()) {
              // Publish an offline status message
-             _mqttClient.publish(getFullTopic("status").c_str(), "offline", true);
+             _mqttClient.publish(getTopic(MqttTopic::STATUS), "offline", true);
              
              // Disconnect
              _mqttClient.disconnect();
@@ -176,8 +274,9 @@
          _username = username;
          _password = password;
          
-         if (clientId.length() > 0) {
+         if (clientId.length() > 0 && clientId != _clientId) {
              _clientId = clientId;
+             _discoveryDirty = true;
          }
          
          // Disconnect if already connected
@@ -200,15 +299,16 @@
  void MQTTClient::setBaseTopic(const String& baseTopic) {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         _baseTopic = baseTopic;
+         buildTopics(baseTopic.c_str());
+         _discoveryDirty = true;
          
-         // Make sure base topic ends with a slash
-         if (_baseTopic.length() > 0 && _baseTopic.charAt(_baseTopic.length() - 1) != '/') {
-             _baseTopic += "/";
+         // Reconnect so the subscriptions and status move to the new topic
+         if (_mqttClient.connected()) {
+             _mqttClient.disconnect();
+             _isConnected = false;
          }
          
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-             "MQTT base topic set to: " + _baseTopic);
+         LOG_INFO("MQTT", "MQTT base topic set to: %s", _baseTopic);
          
          // Release mutex
          xSemaphoreGive(_mqttMutex);
@@ -220,7 +320,7 @@
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         baseTopic = _baseTopic;
+         baseTopic = String(_baseTopic);
          
          // Release mutex
          xSemaphoreGive(_mqttMutex);
@@ -230,19 +330,46 @@
  }
  
  bool MQTTClient::publish(const String& subtopic, const String& payload, bool retain) {
-     // Create a message structure
-     MqttMessage message;
-     message.topic = getFullTopic(subtopic);
-     message.payload = payload;
-     message.retain = retain;
+     if (payload.length() >= Constants::MQTT_PAYLOAD_SIZE) {
+         _droppedMessages++;
+         return false;
+     }
      
-     // Add to publish queue
-     if (_publishQueue && xQueueSend(_publishQueue, &message, 0) == pdPASS) {
-         return true;
+     uint8_t slot;
+     if (!acquireSlot(slot)) {
+         return false;
      }
      
-     // If queue is full or not available, try to publish directly
-     return _mqttClient.publish(message.topic.c_str(), message.payload.c_str(), message.retain);
+     memcpy(_pool[slot].payload, payload.c_str(), payload.length() + 1);
+     if (!setSlotTopic(slot, subtopic.c_str())) {
+         return false;
+     }
+     queueSlot(slot, payload.length(), retain);
+     return true;
+ }
+ 
+ bool MQTTClient::publishJson(const char* subtopic, const JsonDocument& doc, bool retain) {
+     uint8_t slot;
+     size_t length;
+     if (!serializeToSlot(doc, slot, length) || !setSlotTopic(slot, subtopic)) {
+         return false;
+     }
+     
+     queueSlot(slot, length, retain);
+     return true;
+ }
+ 
+ bool MQTTClient::publishJson(MqttTopic topic, const JsonDocument& doc, bool retain) {
+     uint8_t slot;
+     size_t length;
+     if (!serializeToSlot(doc, slot, length)) {
+         return false;
+     }
+     
+     // The topic was resolved by buildTopics(), just copy it
+     memcpy(_pool[slot].topic, getTopic(topic), Constants::MQTT_TOPIC_SIZE);
+     queueSlot(slot, length, retain);
+     return true;
  }
  
  bool MQTTClient::subscribe(const String& subtopic) {
@@ -264,15 +391,16 @@
          }
          
          // Subscribe if connected
-         if (_mqttClient.connected()) {
-             result = _mqttClient.subscribe(getFullTopic(subtopic).c_str());
+         char topic[Constants::MQTT_TOPIC_SIZE];
+         if (!getFullTopic(subtopic.c_str(), topic)) {
+             LOG_ERROR("MQTT", "Topic too long: %s%s", _baseTopic, subtopic.c_str());
+         } else if (_mqttClient.connected()) {
+             result = _mqttClient.subscribe(topic);
              
              if (result) {
-                 getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-                     "Subscribed to: " + getFullTopic(subtopic));
+                 LOG_INFO("MQTT", "Subscribed to: %s", topic);
              } else {
-                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "MQTT", 
-                     "Failed to subscribe to: " + getFullTopic(subtopic));
+                 LOG_ERROR("MQTT", "Failed to subscribe to: %s", topic);
              }
          } else {
              // If not connected, subscription will happen on connect
@@ -300,15 +428,14 @@
          }
          
          // Unsubscribe if connected
-         if (_mqttClient.connected()) {
-             result = _mqttClient.unsubscribe(getFullTopic(subtopic).c_str());
+         char topic[Constants::MQTT_TOPIC_SIZE];
+         if (_mqttClient.connected() && getFullTopic(subtopic.c_str(), topic)) {
+             result = _mqttClient.unsubscribe(topic);
              
              if (result) {
-                 getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-                     "Unsubscribed from: " + getFullTopic(subtopic));
+                 LOG_INFO("MQTT", "Unsubscribed from: %s", topic);
              } else {
-                 getAppCore()->getLogManager()->log(LogLevel::ERROR, "MQTT", 
-                     "Failed to unsubscribe from: " + getFullTopic(subtopic));
+                 LOG_ERROR("MQTT", "Failed to unsubscribe from: %s", topic);
              }
          } else {
              // If not connected, it's already effectively unsubscribed
@@ -331,51 +458,44 @@
          return false;
      }
      
-     // Create a JSON document with sensor data
-     DynamicJsonDocument doc(1024);
+     FusedReading tent;
+     getAppCore()->getSensorManager()->getTentReading(tent);
      
-     // Add timestamp
-     doc["timestamp"] = millis();
-     
-     // Upper DHT sensor
-     JsonObject upperDhtObj = doc.createNestedObject("upper_dht");
-     upperDhtObj["valid"] = upperDht.valid;
-     if (upperDht.valid) {
-         upperDhtObj["temperature"] = upperDht.temperature;
-         upperDhtObj["humidity"] = upperDht.humidity;
+     // While offline, or while older samples are still being replayed, queue
+     // behind them so the broker sees every sample in timestamp order
+     TelemetrySample sample = makeSample(upperDht, lowerDht, scd, tent);
+     bool result = true;
+     if (!isConnected() || !_backlog.isEmpty()) {
+         _backlog.push(sample);
+     } else {
+         result = publishSample(sample, false);
      }
      
-     // Lower DHT sensor
-     JsonObject lowerDhtObj = doc.createNestedObject("lower_dht");
-     lowerDhtObj["valid"] = lowerDht.valid;
-     if (lowerDht.valid) {
-         lowerDhtObj["temperature"] = lowerDht.temperature;
-         lowerDhtObj["humidity"] = lowerDht.humidity;
-     }
-     
-     // SCD40 sensor
-     JsonObject scdObj = doc.createNestedObject("scd40");
-     scdObj["valid"] = scd.valid;
-     if (scd.valid) {
-         scdObj["temperature"] = scd.temperature;
-         scdObj["humidity"] = scd.humidity;
-         scdObj["co2"] = scd.co2;
+     // The deadbands compare against what was last sent or stored
+     if (result && xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _publishedReadings[0] = upperDht;
+         _publishedReadings[1] = lowerDht;
+         _publishedReadings[2] = scd;
+         _publishedReadings[3] = tent.reading;
+         _sensorRate.markPublished(millis());
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
      }
      
-     // Serialize to JSON
-     String payload;
-     serializeJson(doc, payload);
-     
-     // Publish to MQTT
-     return publish("sensors", payload);
+     return result;
  }
  
  bool MQTTClient::publishRelayStatus() {
      // Get relay status
      std::vector<RelayConfig> relays = getAppCore()->getRelayManager()->getAllRelayConfigs();
      
-     // Create a JSON document with relay status
-     DynamicJsonDocument doc(2048);
+     // Build the document in the shared, preallocated buffer
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return false;
+     }
+     JsonDocument& doc = _publishDoc;
+     doc.clear();
      
      // Add timestamp
      doc["timestamp"] = millis();
@@ -392,20 +512,27 @@
          relayObj["last_trigger"] = static_cast<int>(relay.lastTrigger);
      }
      
-     // Serialize to JSON
-     String payload;
-     serializeJson(doc, payload);
+     // Serialize straight into a pool slot, retained so new subscribers see the current state
+     bool result = publishJson(MqttTopic::RELAYS, doc, true);
+     if (result) {
+         _relayRate.markPublished(millis());
+     }
      
-     // Publish to MQTT
-     return publish("relays", payload);
+     // Release mutex
+     xSemaphoreGive(_mqttMutex);
+     return result;
  }
  
  bool MQTTClient::publishSystemStatus() {
      // Get system information
      FilesystemStats fsStats = getAppCore()->getStorageManager()->getFilesystemStats();
      
-     // Create a JSON document with system status
-     DynamicJsonDocument doc(1024);
+     // Build the document in the shared, preallocated buffer
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return false;
+     }
+     JsonDocument& doc = _publishDoc;
+     doc.clear();
      
      // Add timestamp
      doc["timestamp"] = millis();
@@ -434,12 +561,78 @@
      memoryObj["min_free_heap"] = ESP.getMinFreeHeap();
      memoryObj["max_alloc_heap"] = ESP.getMaxAllocHeap();
      
-     // Serialize to JSON
-     String payload;
-     serializeJson(doc, payload);
+     // Serialize straight into a pool slot
+     bool result = publishJson(MqttTopic::SYSTEM, doc);
+     if (result) {
+         _systemRate.markPublished(millis());
+     }
+     
+     // Release mutex
+     xSemaphoreGive(_mqttMutex);
+     return result;
+ }
+ 
+ bool MQTTClient::publishDiagnostics() {
+     LatencySummary summaries[Constants::LATENCY_PROBE_SLOTS];
+     size_t count = LatencyMonitor::getSummaries(summaries, Constants::LATENCY_PROBE_SLOTS);
+     std::sort(summaries, summaries + count, [](const LatencySummary& a, const LatencySummary& b) {
+         return a.p99Us > b.p99Us;
+     });
+     
+     uint8_t slot;
+     if (!acquireSlot(slot)) {
+         return false;
+     }
+     
+     // Written row by row into the slot, keeping room for the closing brace
+     char* payload = _pool[slot].payload;
+     const size_t limit = Constants::MQTT_PAYLOAD_SIZE - 1;
+     size_t length = 1;
+     payload[0] = '{';
+     for (size_t i = 0; i < count; i++) {
+         int written = snprintf(payload + length, limit - length, "%s\"%s\":[%lu,%lu,%lu,%lu]",
+                                length > 1 ? "," : "", summaries[i].name,
+                                static_cast<unsigned long>(summaries[i].count), static_cast<unsigned long>(summaries[i].p50Us),
+                                static_cast<unsigned long>(summaries[i].p99Us), static_cast<unsigned long>(summaries[i].maxUs));
+         if (written < 0 || static_cast<size_t>(written) >= limit - length) {
+             break;
+         }
+         length += written;
+     }
+     payload[length++] = '}';
+     payload[length] = '\0';
+     
+     memcpy(_pool[slot].topic, getTopic(MqttTopic::DIAGNOSTICS), Constants::MQTT_TOPIC_SIZE);
+     queueSlot(slot, length, false);
+     return true;
+ }
+ 
+ uint32_t MQTTClient::measureBrokerRtt() {
+     String broker;
+     uint16_t port = 0;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         broker = _broker;
+         port = _port;
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
+     }
+     
+     // Resolve first so the DNS lookup is not timed
+     IPAddress address;
+     if (broker.isEmpty() || WiFi.status() != WL_CONNECTED || !WiFi.hostByName(broker.c_str(), address)) {
+         return 0;
+     }
      
-     // Publish to MQTT
-     return publish("system", payload);
+     WiFiClient client;
+     uint32_t start = micros();
+     bool connected = client.connect(address, port, Constants::BENCH_RTT_TIMEOUT_MS);
+     uint32_t elapsed = micros() - start;
+     client.stop();
+     
+     return connected ? elapsed : 0;
  }
  
  void MQTTClient::createTasks() {
@@ -460,101 +653,540 @@
      }
  }
  
- void MQTTClient::processIncomingMessage(const String& topic, const String& payload) {
+ void MQTTClient::processIncomingMessage(const char* topic, const char* payload) {
+     // Home Assistant restarted and needs the configs and current state again
+     if (strcmp(topic, Constants::MQTT_HA_STATUS_TOPIC) == 0) {
+         if (strcmp(payload, "online") == 0) {
+             _discoveryRepublish = true;
+             _sensorRate.published = false;
+             _relayRate.published = false;
+         }
+         return;
+     }
+     
      // Extract subtopic by removing base topic prefix
-     String subtopic = topic;
-     if (topic.startsWith(_baseTopic)) {
-         subtopic = topic.substring(_baseTopic.length());
+     const char* subtopic = topic;
+     if (strncmp(topic, _baseTopic, _baseTopicLength) == 0) {
+         subtopic += _baseTopicLength;
      }
      
      // Log the message
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-         "Received message on topic: " + subtopic + ", payload: " + payload);
+     LOG_INFO("MQTT", "Received message on topic: %s, payload: %s", subtopic, payload);
      
-     // Handle different types of messages
-     if (subtopic == "command") {
-         handleCommand(payload, "");
-     } else if (subtopic.startsWith("command/")) {
-         String command = subtopic.substring(8);
-         handleCommand(command, payload);
+     // One hash and one compare instead of walking every known command
+     const MqttCommandRoute* route = findCommandRoute(subtopic);
+     if (route != nullptr) {
+         handleCommand(route->command, route->relayId, payload);
      }
  }
  
- void MQTTClient::handleCommand(const String& command, const String& payload) {
-     // Handle different commands
-     if (command == "reboot" || payload == "reboot") {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-             "Received reboot command");
-         
-         // Schedule a reboot
-         getAppCore()->reboot();
-     } else if (command == "relay") {
-         // Parse relay command (format: "relay_id:state")
-         int separatorPos = payload.indexOf(':');
-         if (separatorPos > 0) {
-             String relayIdStr = payload.substring(0, separatorPos);
-             String stateStr = payload.substring(separatorPos + 1);
+ void MQTTClient::handleCommand(MqttCommand command, uint8_t relayId, const char* payload) {
+     RelayState state;
+     
+     switch (command) {
+         case MqttCommand::COMMAND:
+             if (strcmp(payload, "reboot") != 0) {
+                 break;
+             }
+             // Fall through
+         case MqttCommand::REBOOT:
+             LOG_INFO("MQTT", "Received reboot command");
              
-             uint8_t relayId = relayIdStr.toInt();
-             int state = stateStr.toInt();
+             // Schedule a reboot
+             getAppCore()->reboot();
+             break;
              
-             if (relayId >= 1 && relayId <= 8 && state >= 0 && state <= 2) {
-                 getAppCore()->getLogManager()->log(LogLevel::INFO, "MQTT", 
-                     "Setting relay " + String(relayId) + " to state " + String(state));
-                 
-                 getAppCore()->getRelayManager()->setRelayState(relayId, static_cast<RelayState>(state));
+         case MqttCommand::RELAY: {
+             // Parse relay command (format: "relay_id:state")
+             const char* separator = strchr(payload, ':');
+             if (separator == nullptr || separator == payload) {
+                 break;
              }
+             
+             int id = atoi(payload);
+             if (id >= 1 && id <= 8 && parseRelayState(separator + 1, state)) {
+                 LOG_INFO("MQTT", "Setting relay %d to state %d", id, static_cast<int>(state));
+                 getAppCore()->getRelayManager()->setRelayState(id, state);
+             }
+             break;
          }
+             
+         case MqttCommand::RELAY_STATE:
+             // Home Assistant switches send ON and OFF
+             if (parseRelayState(payload, state)) {
+                 LOG_INFO("MQTT", "Setting relay %u to state %d", relayId, static_cast<int>(state));
+                 getAppCore()->getRelayManager()->setRelayState(relayId, state);
+             } else {
+                 LOG_WARN("MQTT", "Ignoring relay %u command \"%s\"", relayId, payload);
+             }
+             break;
+     }
+ }
+ 
+ void MQTTClient::buildCommandRoutes() {
+     memset(_commandRoutes, 0, sizeof(_commandRoutes));
+     
+     // Open addressing with linear probing, the table is never full
+     for (uint8_t i = 0; i < COMMAND_ROUTE_COUNT; i++) {
+         uint8_t slot = Helpers::hashFNV1a(COMMAND_ROUTES[i].subtopic) & COMMAND_ROUTE_MASK;
+         while (_commandRoutes[slot] != 0) {
+             slot = (slot + 1) & COMMAND_ROUTE_MASK;
+         }
+         _commandRoutes[slot] = i + 1;
+     }
+ }
+ 
+ const MqttCommandRoute* MQTTClient::findCommandRoute(const char* subtopic) const {
+     uint8_t slot = Helpers::hashFNV1a(subtopic) & COMMAND_ROUTE_MASK;
+     
+     while (_commandRoutes[slot] != 0) {
+         const MqttCommandRoute& route = COMMAND_ROUTES[_commandRoutes[slot] - 1];
+         if (strcmp(route.subtopic, subtopic) == 0) {
+             return &route;
+         }
+         slot = (slot + 1) & COMMAND_ROUTE_MASK;
      }
+     
+     return nullptr;
  }
  
- String MQTTClient::getFullTopic(const String& subtopic) {
-     return _baseTopic + subtopic;
+ void MQTTClient::setDiscoveryEnabled(bool enabled) {
+     // Announce everything again when switched back on
+     if (enabled && !_discoveryEnabled) {
+         _discoveryRepublish = true;
+     }
+     _discoveryEnabled = enabled;
+ }
+ 
+ void MQTTClient::setNetworkAvailable(bool available) {
+     // Skip the retry delay so the broker is reached right after WiFi
+     if (available && !_networkAvailable) {
+         _lastConnectAttempt = millis() - _connectRetryInterval - 1;
+     }
+     _networkAvailable = available;
+ }
+ 
+ void MQTTClient::publishDiscovery() {
+     // Rebuild only the configs whose inputs changed
+     if (_discoveryDirty) {
+         _discoveryDirty = false;
+         
+         String clientId, baseTopic;
+         if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+             clientId = _clientId;
+             baseTopic = String(_baseTopic);
+             
+             // Release mutex
+             xSemaphoreGive(_mqttMutex);
+         } else {
+             _discoveryDirty = true;
+             return;
+         }
+         
+         _discovery.configure(clientId, baseTopic, getAppCore()->getNetworkManager()->getHostname());
+         _discovery.updateRelays(getAppCore()->getRelayManager()->getAllRelayConfigs());
+     }
+     
+     if (_discoveryRepublish) {
+         _discoveryRepublish = false;
+         _discovery.markAllPending();
+     }
+     
+     // The payloads are prebuilt, so a pass is just a few retained publishes
+     for (uint8_t i = 0; i < Constants::MQTT_DISCOVERY_BATCH; i++) {
+         DiscoveryEntity* entity = _discovery.nextPending();
+         if (entity == nullptr) {
+             break;
+         }
+         
+         if (!_mqttClient.publish(entity->topic, reinterpret_cast<const uint8_t*>(entity->payload.c_str()), 
+                                  entity->payload.length(), true)) {
+             break;
+         }
+         entity->pending = false;
+     }
+ }
+ 
+ void MQTTClient::buildTopics(const char* baseTopic) {
+     // Make sure base topic ends with a slash, leaving room for the longest subtopic
+     size_t length = strnlen(baseTopic, Constants::MQTT_TOPIC_SIZE);
+     size_t limit = Constants::MQTT_TOPIC_SIZE - 16;
+     if (length > limit) {
+         LOG_WARN("MQTT", "Base topic truncated to %u characters", static_cast<unsigned>(limit));
+         length = limit;
+     }
+     memcpy(_baseTopic, baseTopic, length);
+     if (length > 0 && _baseTopic[length - 1] != '/') {
+         _baseTopic[length++] = '/';
+     }
+     _baseTopic[length] = '\0';
+     _baseTopicLength = length;
+     
+     for (uint8_t i = 0; i < static_cast<uint8_t>(MqttTopic::COUNT); i++) {
+         snprintf(_topics[i], Constants::MQTT_TOPIC_SIZE, "%s%s", _baseTopic, TOPIC_NAMES[i]);
+     }
+ }
+ 
+ bool MQTTClient::getFullTopic(const char* subtopic, char* topic) const {
+     size_t subtopicLength = strlen(subtopic);
+     if (_baseTopicLength + subtopicLength >= Constants::MQTT_TOPIC_SIZE) {
+         return false;
+     }
+     
+     memcpy(topic, _baseTopic, _baseTopicLength);
+     memcpy(topic + _baseTopicLength, subtopic, subtopicLength + 1);
+     return true;
+ }
+ 
+ void MQTTClient::setSensorDeadbands(const MqttDeadbands& deadbands) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _deadbands = deadbands;
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
+     }
+ }
+ 
+ MqttDeadbands MQTTClient::getSensorDeadbands() {
+     MqttDeadbands deadbands = _deadbands;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         deadbands = _deadbands;
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
+     }
+     
+     return deadbands;
+ }
+ 
+ void MQTTClient::setHeartbeatInterval(uint32_t seconds) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _sensorRate.maxAgeMs = max(seconds, static_cast<uint32_t>(1)) * 1000;
+         _relayRate.maxAgeMs = _sensorRate.maxAgeMs;
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
+     }
+ }
+ 
+ uint32_t MQTTClient::getHeartbeatInterval() {
+     return _sensorRate.maxAgeMs / 1000;
+ }
+ 
+ bool MQTTClient::sensorsChanged() {
+     SensorReading upperDht, lowerDht, scd;
+     if (!getAppCore()->getSensorManager()->getSensorReadings(upperDht, lowerDht, scd)) {
+         return false;
+     }
+     
+     FusedReading tent;
+     getAppCore()->getSensorManager()->getTentReading(tent);
+     
+     bool changed = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         changed = readingChanged(upperDht, _publishedReadings[0], _deadbands, false) ||
+                   readingChanged(lowerDht, _publishedReadings[1], _deadbands, false) ||
+                   readingChanged(scd, _publishedReadings[2], _deadbands, true) ||
+                   readingChanged(tent.reading, _publishedReadings[3], _deadbands, tent.hasCo2);
+         
+         // Release mutex
+         xSemaphoreGive(_mqttMutex);
+     }
+     
+     return changed;
+ }
+ 
+ bool MQTTClient::readingChanged(const SensorReading& current, const SensorReading& published, 
+                                 const MqttDeadbands& deadbands, bool hasCo2) {
+     if (current.valid != published.valid) {
+         return true;
+     }
+     if (!current.valid) {
+         return false;
+     }
+     
+     // Compared against the last published value, so slow drift still crosses the band
+     return fabsf(current.temperature - published.temperature) > deadbands.temperature ||
+            fabsf(current.humidity - published.humidity) > deadbands.humidity ||
+            (hasCo2 && fabsf(current.co2 - published.co2) > deadbands.co2);
+ }
+ 
+ bool MQTTClient::publishSample(const TelemetrySample& sample, bool replayed) {
+     // Build the document in the shared, preallocated buffer
+     if (xSemaphoreTake(_mqttMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return false;
+     }
+     JsonDocument& doc = _publishDoc;
+     doc.clear();
+     
+     // Add timestamps, replayed samples only carry the time they were taken
+     if (!replayed) {
+         doc["timestamp"] = millis();
+     }
+     doc["time"] = sample.timestamp;
+     if (replayed) {
+         doc["replayed"] = true;
+     }
+     
+     // Upper DHT sensor
+     JsonObject upperDhtObj = doc.createNestedObject("upper_dht");
+     upperDhtObj["valid"] = (sample.validMask & 0x01) != 0;
+     if (sample.validMask & 0x01) {
+         upperDhtObj["temperature"] = sample.upperTemperature;
+         upperDhtObj["humidity"] = sample.upperHumidity;
+     }
+     
+     // Lower DHT sensor
+     JsonObject lowerDhtObj = doc.createNestedObject("lower_dht");
+     lowerDhtObj["valid"] = (sample.validMask & 0x02) != 0;
+     if (sample.validMask & 0x02) {
+         lowerDhtObj["temperature"] = sample.lowerTemperature;
+         lowerDhtObj["humidity"] = sample.lowerHumidity;
+     }
+     
+     // SCD40 sensor
+     JsonObject scdObj = doc.createNestedObject("scd40");
+     scdObj["valid"] = (sample.validMask & 0x04) != 0;
+     if (sample.validMask & 0x04) {
+         scdObj["temperature"] = sample.scdTemperature;
+         scdObj["humidity"] = sample.scdHumidity;
+         scdObj["co2"] = sample.scdCo2;
+     }
+     
+     // Filtered tent reading fused from all sensors
+     JsonObject tentObj = doc.createNestedObject("tent");
+     tentObj["valid"] = (sample.validMask & 0x08) != 0;
+     if (sample.validMask & 0x08) {
+         tentObj["temperature"] = sample.tentTemperature;
+         tentObj["humidity"] = sample.tentHumidity;
+         if (sample.validMask & 0x10) {
+             tentObj["co2"] = sample.tentCo2;
+         }
+         tentObj["confidence"] = sample.tentConfidence;
+     }
+     
+     // Serialize straight into a pool slot
+     bool result;
+     if (!replayed) {
+         result = publishJson(MqttTopic::SENSORS, doc);
+     } else {
+         // Replay runs on the MQTT task, publish right away so the caller
+         // only drops the sample from the backlog once the broker has it
+         uint8_t slot;
+         size_t length;
+         result = serializeToSlot(doc, slot, length);
+         if (result) {
+             result = _mqttClient.publish(getTopic(MqttTopic::SENSORS), 
+                 reinterpret_cast<const uint8_t*>(_pool[slot].payload), length, false);
+             releaseSlot(slot);
+         }
+     }
+     
+     // Release mutex
+     xSemaphoreGive(_mqttMutex);
+     return result;
+ }
+ 
+ void MQTTClient::replayBacklog() {
+     // A few samples per batch so the reconnect does not flood the TCP send buffer.
+     // Only published samples are consumed, a failed one is retried next batch.
+     TelemetrySample batch[Constants::MQTT_REPLAY_BATCH];
+     size_t count = _backlog.peek(batch, Constants::MQTT_REPLAY_BATCH);
+     
+     size_t sent = 0;
+     while (sent < count && publishSample(batch[sent], true)) {
+         sent++;
+     }
+     _backlog.consume(sent);
+     
+     if (_backlog.isEmpty()) {
+         LOG_INFO("MQTT", "Telemetry backlog replayed");
+     }
+ }
+ 
+ TelemetrySample MQTTClient::makeSample(const SensorReading& upperDht, const SensorReading& lowerDht, 
+                                        const SensorReading& scd, const FusedReading& tent) {
+     TelemetrySample sample;
+     sample.timestamp = time(nullptr);
+     sample.upperTemperature = upperDht.temperature;
+     sample.upperHumidity = upperDht.humidity;
+     sample.lowerTemperature = lowerDht.temperature;
+     sample.lowerHumidity = lowerDht.humidity;
+     sample.scdTemperature = scd.temperature;
+     sample.scdHumidity = scd.humidity;
+     sample.scdCo2 = scd.co2;
+     sample.tentTemperature = tent.reading.temperature;
+     sample.tentHumidity = tent.reading.humidity;
+     sample.tentCo2 = tent.reading.co2;
+     sample.tentConfidence = tent.confidence;
+     sample.validMask = (upperDht.valid ? 0x01 : 0) | (lowerDht.valid ? 0x02 : 0) | (scd.valid ? 0x04 : 0) |
+                        (tent.reading.valid ? 0x08 : 0) | (tent.reading.valid && tent.hasCo2 ? 0x10 : 0);
+     return sample;
+ }
+ 
+ bool MQTTClient::acquireSlot(uint8_t& slot) {
+     // Never wait for a slot, a full pool means the broker is not keeping up
+     if (_freeSlots == nullptr || xQueueReceive(_freeSlots, &slot, 0) != pdPASS) {
+         _droppedMessages++;
+         return false;
+     }
+     return true;
+ }
+ 
+ void MQTTClient::releaseSlot(uint8_t slot) {
+     xQueueSend(_freeSlots, &slot, 0);
+ }
+ 
+ bool MQTTClient::serializeToSlot(const JsonDocument& doc, uint8_t& slot, size_t& length) {
+     // Refuse documents that would be cut off rather than publish broken JSON
+     length = measureJson(doc);
+     if (length >= Constants::MQTT_PAYLOAD_SIZE) {
+         _droppedMessages++;
+         return false;
+     }
+     
+     if (!acquireSlot(slot)) {
+         return false;
+     }
+     
+     length = serializeJson(doc, _pool[slot].payload, Constants::MQTT_PAYLOAD_SIZE);
+     return true;
+ }
+ 
+ bool MQTTClient::setSlotTopic(uint8_t slot, const char* subtopic) {
+     if (!getFullTopic(subtopic, _pool[slot].topic)) {
+         releaseSlot(slot);
+         _droppedMessages++;
+         return false;
+     }
+     return true;
+ }
+ 
+ void MQTTClient::queueSlot(uint8_t slot, size_t payloadLength, bool retain) {
+     MqttMessage& message = _pool[slot];
+     message.payloadLength = payloadLength;
+     message.retain = retain;
+     
+     // The queue has room for every slot, so this cannot fail
+     xQueueSend(_publishQueue, &slot, 0);
  }
  
  void MQTTClient::mqttCallback(char* topic, byte* payload, unsigned int length) {
-     // Convert payload to string
-     String payloadStr;
-     for (unsigned int i = 0; i < length; i++) {
-         payloadStr += (char)payload[i];
+     // Commands are short, terminate a copy on the stack instead of building a String
+     if (length >= COMMAND_PAYLOAD_SIZE) {
+         LOG_WARN("MQTT", "Ignoring %u byte message on topic: %s", length, topic);
+         return;
      }
+     char payloadStr[COMMAND_PAYLOAD_SIZE];
+     memcpy(payloadStr, payload, length);
+     payloadStr[length] = '\0';
      
      // Pass to the current instance
      if (currentInstance) {
-         currentInstance->processIncomingMessage(String(topic), payloadStr);
+         currentInstance->processIncomingMessage(topic, payloadStr);
      }
  }
  
+ uint32_t MQTTClient::msUntilKeepAlive() {
+     if (_mqttTaskHandle == nullptr || !_networkAvailable) {
+         return UINT32_MAX;
+     }
+     
+     // PubSubClient pings once the link was idle for a full keep-alive and the
+     // broker allows one and a half, so looping every half interval is enough
+     uint32_t now = millis();
+     int32_t remaining;
+     if (isConnected()) {
+         remaining = static_cast<int32_t>(_lastKeepAlive + Constants::MQTT_KEEPALIVE_SECONDS * 500UL - now);
+     } else {
+         remaining = static_cast<int32_t>(_lastConnectAttempt + _connectRetryInterval - now);
+     }
+     return static_cast<uint32_t>(max(remaining, static_cast<int32_t>(0)));
+ }
+ 
  void MQTTClient::mqttTask(void* parameter) {
      MQTTClient* mqttClient = static_cast<MQTTClient*>(parameter);
      TickType_t lastWakeTime = xTaskGetTickCount();
+     LatencyHistogram* publishLatency = LatencyMonitor::probe("mqtt.publish");
      
      while (true) {
+         TASK_LOOP_MARK();
+         
+         uint32_t now = millis();
+         
+         // Full clock for this pass, released before the task sleeps
+         esp_pm_lock_handle_t powerLock = getAppCore()->getPowerManager()->acquireLock(PowerLock::MQTT);
+         
          // Check if we need to connect
-         if (!mqttClient->isConnected()) {
+         bool connected = mqttClient->isConnected();
+         if (!connected) {
              // Try to connect if enough time has passed since last attempt
-             if (millis() - mqttClient->_lastConnectAttempt > mqttClient->_connectRetryInterval) {
+             if (mqttClient->_networkAvailable && 
+                 millis() - mqttClient->_lastConnectAttempt > mqttClient->_connectRetryInterval) {
                  mqttClient->connect();
              }
          } else {
              // Keep the connection alive
              mqttClient->_mqttClient.loop();
+             mqttClient->_lastKeepAlive = millis();
              
-             // Process publish queue
-             MqttMessage message;
-             while (xQueueReceive(mqttClient->_publishQueue, &message, 0) == pdPASS) {
-                 mqttClient->_mqttClient.publish(message.topic.c_str(), message.payload.c_str(), message.retain);
+             // Process publish queue, handing each slot back once it is sent
+             uint8_t slot;
+             while (xQueueReceive(mqttClient->_publishQueue, &slot, 0) == pdPASS) {
+                 const MqttMessage& message = mqttClient->_pool[slot];
+                 int64_t publishStart = esp_timer_get_time();
+                 if (!mqttClient->_mqttClient.publish(message.topic, 
+                         reinterpret_cast<const uint8_t*>(message.payload), message.payloadLength, message.retain)) {
+                     mqttClient->_droppedMessages++;
+                 }
+                 LatencyMonitor::record(publishLatency, static_cast<uint32_t>(esp_timer_get_time() - publishStart));
+                 mqttClient->releaseSlot(slot);
              }
              
-             // Publish periodic updates
-             if (millis() - mqttClient->_lastPublishTime > mqttClient->_publishInterval) {
-                 mqttClient->publishSensorData();
-                 mqttClient->publishRelayStatus();
+             // Home Assistant discovery configs, rebuilt and republished only when needed
+             if (mqttClient->_discoveryEnabled) {
+                 mqttClient->publishDiscovery();
+             }
+             
+             // Replay stored telemetry in small, paced batches
+             if (!mqttClient->_backlog.isEmpty() && 
+                 now - mqttClient->_lastReplay >= Constants::MQTT_REPLAY_INTERVAL_MS) {
+                 mqttClient->_lastReplay = now;
+                 mqttClient->replayBacklog();
+             }
+             
+             // Relay changes go out on the next pass, otherwise on the heartbeat
+             if (mqttClient->_relayStatusDirty || mqttClient->_relayRate.isDue(false, now)) {
+                 mqttClient->_relayStatusDirty = false;
+                 if (!mqttClient->publishRelayStatus()) {
+                     mqttClient->_relayStatusDirty = true;
+                 }
+             }
+             
+             // System status at a fixed, slow rate
+             if (mqttClient->_systemRate.isDue(false, now)) {
                  mqttClient->publishSystemStatus();
-                 mqttClient->_lastPublishTime = millis();
+                 mqttClient->publishDiagnostics();
+             }
+         }
+         
+         // Sensors when a reading leaves its deadband (rate-limited) or on the
+         // heartbeat, also while offline so the backlog has no gaps
+         if (now - mqttClient->_lastSensorCheck >= Constants::MQTT_SENSOR_CHECK_MS) {
+             mqttClient->_lastSensorCheck = now;
+             if (mqttClient->_sensorRate.isDue(mqttClient->sensorsChanged(), now)) {
+                 mqttClient->publishSensorData();
              }
          }
          
+         getAppCore()->getPowerManager()->releaseLock(powerLock);
+         
          // Sleep to avoid hogging CPU
          vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(100));
      }
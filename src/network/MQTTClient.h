@@ -14,21 +14,101 @@
  #include <freertos/semphr.h>
  #include <freertos/queue.h>
  #include <vector>
+ #include <ArduinoJson.h>
  #include "../utils/Constants.h"
+ #include "../components/SensorHistory.h"
+ #include "../components/SensorFusion.h"
+ #include "MqttBacklog.h"
+ #include "HomeAssistantDiscovery.h"
  
  // Forward declarations
  class AppCore;
  
  /**
   * @struct MqttMessage
-  * @brief Structure to hold an MQTT message
+  * @brief One preallocated slot of the MQTT publish pool
+  *
+  * Only the slot index travels through the FreeRTOS queues; whoever holds
+  * the index owns the slot, so the buffers need no lock.
   */
  struct MqttMessage {
-     String topic;
-     String payload;
+     char topic[Constants::MQTT_TOPIC_SIZE];
+     char payload[Constants::MQTT_PAYLOAD_SIZE];
+     uint16_t payloadLength;
      bool retain;
  };
  
+ /**
+  * @struct MqttTopicRate
+  * @brief Publish schedule of one periodic topic
+  */
+ struct MqttTopicRate {
+     uint32_t minIntervalMs;   // Changes closer together than this are held back
+     uint32_t maxAgeMs;        // Heartbeat, republish after this long even without a change
+     uint32_t lastPublishMs;
+     bool published;           // False until the first publish after (re)connecting
+     
+     MqttTopicRate(uint32_t minInterval, uint32_t maxAge) :
+         minIntervalMs(minInterval), maxAgeMs(maxAge), lastPublishMs(0), published(false) {}
+     
+     bool isDue(bool changed, uint32_t nowMs) const {
+         if (!published) {
+             return true;
+         }
+         uint32_t elapsed = nowMs - lastPublishMs;
+         return elapsed >= maxAgeMs || (changed && elapsed >= minIntervalMs);
+     }
+     
+     void markPublished(uint32_t nowMs) {
+         lastPublishMs = nowMs;
+         published = true;
+     }
+ };
+ 
+ /**
+  * @struct MqttDeadbands
+  * @brief Minimum change of a reading that triggers a sensor publish
+  */
+ struct MqttDeadbands {
+     float temperature;
+     float humidity;
+     float co2;
+ };
+ 
+ /**
+  * @enum MqttTopic
+  * @brief Topics published on a schedule, resolved against the base topic once
+  */
+ enum class MqttTopic : uint8_t {
+     STATUS,
+     SENSORS,
+     RELAYS,
+     SYSTEM,
+     DIAGNOSTICS,
+     COUNT
+ };
+ 
+ /**
+  * @enum MqttCommand
+  * @brief Action behind a command topic
+  */
+ enum class MqttCommand : uint8_t {
+     COMMAND,        // "command", the payload names the action
+     REBOOT,         // "command/reboot"
+     RELAY,          // "command/relay", payload "relay_id:state"
+     RELAY_STATE     // "command/relay/<id>", payload ON, OFF, AUTO or 0-2
+ };
+ 
+ /**
+  * @struct MqttCommandRoute
+  * @brief Command subtopic and the action it dispatches to
+  */
+ struct MqttCommandRoute {
+     const char* subtopic;
+     MqttCommand command;
+     uint8_t relayId;          // RELAY_STATE only
+ };
+ 
  /**
   * @class MQTTClient
   * @brief Manages MQTT connection, publishing, and subscription
@@ -76,6 +156,8 @@
      
      /**
       * @brief Set the base topic for all publications and subscriptions
+      * 
+      * Rebuilds the precomputed topics and reconnects so the subscriptions move too.
       * @param baseTopic Base topic
       */
      void setBaseTopic(const String& baseTopic);
@@ -95,6 +177,21 @@
       */
      bool publish(const String& subtopic, const String& payload, bool retain = false);
      
+     /**
+      * @brief Serialize a JSON document straight into a pool slot and queue it
+      * @param subtopic Topic suffix (added to base topic)
+      * @param doc Document to publish
+      * @param retain Whether to retain the message
+      * @return True if the message was queued
+      */
+     bool publishJson(const char* subtopic, const JsonDocument& doc, bool retain = false);
+     
+     /**
+      * @brief Get the number of messages dropped because the pool was exhausted or a message did not fit
+      * @return Dropped message count since boot
+      */
+     uint32_t getDroppedMessages() const { return _droppedMessages; }
+     
      /**
       * @brief Subscribe to a topic
       * @param subtopic Topic suffix (added to base topic)
@@ -110,8 +207,8 @@
      bool unsubscribe(const String& subtopic);
      
      /**
-      * @brief Publish sensor data
-      * @return True if data published successfully
+      * @brief Publish sensor data, or store it in the backlog while offline or replaying
+      * @return True if data was published or stored
       */
      bool publishSensorData();
      
@@ -127,11 +224,84 @@
       */
      bool publishSystemStatus();
      
+     /**
+      * @brief Publish the hot path latencies as {"name":[count,p50_us,p99_us,max_us]}
+      *
+      * Probes are sorted by p99, slowest first, and the rows that do not
+      * fit in one pool slot are left out.
+      * @return True if the latencies were queued
+      */
+     bool publishDiagnostics();
+     
+     /**
+      * @brief Time a TCP handshake with the broker, one network round trip
+      * @return Microseconds, 0 without a broker or if it could not be reached
+      */
+     uint32_t measureBrokerRtt();
+     
+     /**
+      * @brief Flag the relay status for publishing on the next MQTT task pass
+      */
+     void notifyRelayChange() { _relayStatusDirty = true; }
+     
+     /**
+      * @brief Flag the Home Assistant discovery configs for a rebuild (relay renamed or hidden)
+      */
+     void notifyDiscoveryChange() { _discoveryDirty = true; }
+     
+     /**
+      * @brief Enable or disable publishing Home Assistant discovery configs
+      * @param enabled Whether discovery configs are published
+      */
+     void setDiscoveryEnabled(bool enabled);
+     
+     bool isDiscoveryEnabled() const { return _discoveryEnabled; }
+     
+     /**
+      * @brief Track WiFi, connecting to the broker as soon as the network is back
+      * @param available Whether the station has an IP address
+      */
+     void setNetworkAvailable(bool available);
+     
+     /**
+      * @brief Set how far a reading must move before sensors are republished
+      * @param deadbands Temperature (°C), humidity (%RH) and CO2 (ppm) deadbands
+      */
+     void setSensorDeadbands(const MqttDeadbands& deadbands);
+     
+     /**
+      * @brief Get the sensor deadbands
+      */
+     MqttDeadbands getSensorDeadbands();
+     
+     /**
+      * @brief Set the heartbeat after which sensors and relays are republished without a change
+      * @param seconds Heartbeat interval in seconds
+      */
+     void setHeartbeatInterval(uint32_t seconds);
+     
+     /**
+      * @brief Get the heartbeat interval
+      * @return Heartbeat interval in seconds
+      */
+     uint32_t getHeartbeatInterval();
+     
+     /**
+      * @brief Get the store of telemetry waiting for the broker
+      */
+     MqttBacklog* getBacklog() { return &_backlog; }
+     
      /**
       * @brief Create RTOS tasks for MQTT operations
       */
      void createTasks();
      
+     /**
+      * @brief Get the time until the MQTT task must run to keep the session (or retry it)
+      * @return Milliseconds, UINT32_MAX while there is no network or no MQTT task
+      */
+     uint32_t msUntilKeepAlive();
+     
  private:
      // MQTT client instance
      WiFiClient _wifiClient;
@@ -143,7 +313,11 @@
      String _username;
      String _password;
      String _clientId;
-     String _baseTopic;
+     
+     // Topics resolved when the base topic is set, so publishing never formats them
+     char _baseTopic[Constants::MQTT_TOPIC_SIZE];   // Always ends with a slash
+     size_t _baseTopicLength;
+     char _topics[static_cast<uint8_t>(MqttTopic::COUNT)][Constants::MQTT_TOPIC_SIZE];
      
      // Subscription list
      std::vector<String> _subscriptions;
@@ -151,19 +325,65 @@
      // Status tracking
      bool _isConnected;
      uint32_t _lastConnectAttempt;
-     uint32_t _lastPublishTime;
      uint32_t _connectRetryInterval;
-     uint32_t _publishInterval;
+     volatile bool _networkAvailable;     // No broker attempts while WiFi is down
+     volatile uint32_t _lastKeepAlive;    // millis() of the last PubSubClient loop
+     
+     // Change-driven publishing
+     MqttTopicRate _sensorRate;
+     MqttTopicRate _relayRate;
+     MqttTopicRate _systemRate;
+     MqttDeadbands _deadbands;
+     SensorReading _publishedReadings[4];   // Upper DHT, lower DHT, SCD40, tent as last published
+     uint32_t _lastSensorCheck;
+     volatile bool _relayStatusDirty;
+     
+     // Store-and-forward of sensor samples while the broker is unreachable
+     MqttBacklog _backlog;
+     uint32_t _lastReplay;
+     
+     // Home Assistant discovery, only touched by the MQTT task
+     HomeAssistantDiscovery _discovery;
+     volatile bool _discoveryDirty;       // Inputs may have changed, rebuild
+     volatile bool _discoveryRepublish;   // Publish every config again (reconnect, Home Assistant restart)
+     volatile bool _discoveryEnabled;
+     
+     // Command subtopics hashed to MqttCommandRoute index + 1, 0 marks an empty slot
+     uint8_t _commandRoutes[Constants::MQTT_COMMAND_ROUTE_SLOTS];
      
      // RTOS resources
      SemaphoreHandle_t _mqttMutex;
      TaskHandle_t _mqttTaskHandle;
-     QueueHandle_t _publishQueue;
+     QueueHandle_t _publishQueue;      // Slot indices waiting to be published
+     QueueHandle_t _freeSlots;         // Slot indices available to publishers
+     
+     // Publish pool, fixed at construction
+     MqttMessage _pool[Constants::MQTT_POOL_SLOTS];
+     DynamicJsonDocument _publishDoc;  // Reused by the periodic publishes, guarded by _mqttMutex
+     volatile uint32_t _droppedMessages;
      
      // Private methods
-     void processIncomingMessage(const String& topic, const String& payload);
-     void handleCommand(const String& command, const String& payload);
-     String getFullTopic(const String& subtopic);
+     void processIncomingMessage(const char* topic, const char* payload);
+     void handleCommand(MqttCommand command, uint8_t relayId, const char* payload);
+     void buildCommandRoutes();
+     const MqttCommandRoute* findCommandRoute(const char* subtopic) const;
+     void publishDiscovery();
+     void buildTopics(const char* baseTopic);
+     bool getFullTopic(const char* subtopic, char* topic) const;
+     const char* getTopic(MqttTopic topic) const { return _topics[static_cast<uint8_t>(topic)]; }
+     bool publishJson(MqttTopic topic, const JsonDocument& doc, bool retain = false);
+     bool sensorsChanged();
+     bool publishSample(const TelemetrySample& sample, bool replayed);
+     void replayBacklog();
+     static TelemetrySample makeSample(const SensorReading& upperDht, const SensorReading& lowerDht, 
+                                       const SensorReading& scd, const FusedReading& tent);
+     static bool readingChanged(const SensorReading& current, const SensorReading& published, 
+                                const MqttDeadbands& deadbands, bool hasCo2);
+     bool acquireSlot(uint8_t& slot);
+     void releaseSlot(uint8_t slot);
+     bool serializeToSlot(const JsonDocument& doc, uint8_t& slot, size_t& length);
+     bool setSlotTopic(uint8_t slot, const char* subtopic);
+     void queueSlot(uint8_t slot, size_t payloadLength, bool retain);
      
      // Static callback for PubSubClient
      static void mqttCallback(char* topic, byte* payload, unsigned int length);
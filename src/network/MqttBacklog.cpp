@@ -0,0 +1,235 @@
+/**
+ * @file MqttBacklog.cpp
+ * @brief Implementation of the MqttBacklog class
+ */
+
+ #include "MqttBacklog.h"
+ #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+ #include <new>
+
+ namespace {
+     constexpr size_t SEGMENT_SAMPLES = Constants::MQTT_BACKLOG_SEGMENT_SIZE / sizeof(TelemetrySample);
+
+     // The file name changes with the sample layout, segments in an older layout are dropped
+     const char* const SEGMENT_FORMAT = "%s/telemetry%u.bin";
+     const char* const LEGACY_SEGMENT_FORMAT = "%s/backlog%u.bin";
+ }
+
+ MqttBacklog::MqttBacklog() :
+     _ram(nullptr),
+     _ramHead(0),
+     _ramCount(0),
+     _spillToFlash(false),
+     _readSegment(0),
+     _writeSegment(0),
+     _readOffset(0),
+     _segmentSamples{0, 0},
+     _peekedFlash(false),
+     _dropped(0)
+ {
+ }
+
+ MqttBacklog::~MqttBacklog() {
+     delete[] _ram;
+ }
+
+ bool MqttBacklog::begin(bool spillToFlash) {
+     _spillToFlash = spillToFlash;
+
+     // Preallocate the RAM ring, pushes never allocate after this
+     _ram = new (std::nothrow) TelemetrySample[Constants::MQTT_BACKLOG_RAM_SAMPLES];
+     if (_ram == nullptr) {
+         Serial.println("Failed to allocate MQTT backlog!");
+         return false;
+     }
+
+     // Samples spilled by a firmware without the tent reading cannot be read back
+     for (uint8_t i = 0; i < 2; i++) {
+         char legacyPath[32];
+         snprintf(legacyPath, sizeof(legacyPath), LEGACY_SEGMENT_FORMAT, Constants::MQTT_BACKLOG_DIR, i);
+         if (SPIFFS.exists(legacyPath)) {
+             SPIFFS.remove(legacyPath);
+             LOG_WARN("MQTT", "Dropped telemetry backlog %s in an old format", legacyPath);
+         }
+     }
+
+     // Pick up samples that were spilled before a reboot
+     uint32_t firstTimestamp[2] = {0, 0};
+     for (uint8_t i = 0; i < 2; i++) {
+         String path = segmentPath(i);
+         if (!SPIFFS.exists(path)) {
+             continue;
+         }
+
+         File file = SPIFFS.open(path, FILE_READ);
+         if (!file) {
+             continue;
+         }
+         _segmentSamples[i] = file.size() / sizeof(TelemetrySample);
+
+         TelemetrySample first;
+         if (_segmentSamples[i] > 0 &&
+             file.read(reinterpret_cast<uint8_t*>(&first), sizeof(first)) == sizeof(first)) {
+             firstTimestamp[i] = first.timestamp;
+         }
+         file.close();
+     }
+
+     // The segment with the older first sample is read first, appends go to the other
+     if (_segmentSamples[0] > 0 && _segmentSamples[1] > 0) {
+         _readSegment = firstTimestamp[0] <= firstTimestamp[1] ? 0 : 1;
+         _writeSegment = 1 - _readSegment;
+     } else {
+         _readSegment = _segmentSamples[1] > 0 ? 1 : 0;
+         _writeSegment = _readSegment;
+     }
+
+     if (flashSamples() > 0) {
+         LOG_INFO("MQTT", "Found %lu unsent telemetry samples on flash",
+                  static_cast<unsigned long>(flashSamples()));
+     }
+
+     return true;
+ }
+
+ void MqttBacklog::push(const TelemetrySample& sample) {
+     if (_ram == nullptr) {
+         _dropped++;
+         return;
+     }
+
+     // A full ring moves to flash in one write, or loses its oldest sample
+     if (_ramCount == Constants::MQTT_BACKLOG_RAM_SAMPLES && !(_spillToFlash && spill())) {
+         _ramHead = (_ramHead + 1) % Constants::MQTT_BACKLOG_RAM_SAMPLES;
+         _ramCount--;
+         _dropped++;
+     }
+
+     _ram[(_ramHead + _ramCount) % Constants::MQTT_BACKLOG_RAM_SAMPLES] = sample;
+     _ramCount++;
+ }
+
+ size_t MqttBacklog::peek(TelemetrySample* samples, size_t maxSamples) {
+     _peekedFlash = false;
+
+     // Flash holds the oldest samples
+     if (flashSamples() > 0) {
+         size_t count = min(static_cast<size_t>(_segmentSamples[_readSegment] - _readOffset), maxSamples);
+
+         File file = SPIFFS.open(segmentPath(_readSegment), FILE_READ);
+         size_t bytes = 0;
+         if (file && file.seek(_readOffset * sizeof(TelemetrySample))) {
+             bytes = file.read(reinterpret_cast<uint8_t*>(samples), count * sizeof(TelemetrySample));
+         }
+         if (file) {
+             file.close();
+         }
+
+         if (bytes < sizeof(TelemetrySample)) {
+             // Unreadable segment, give it up rather than replaying it forever
+             dropSegment(_readSegment);
+             return 0;
+         }
+
+         _peekedFlash = true;
+         return bytes / sizeof(TelemetrySample);
+     }
+
+     size_t count = min(_ramCount, maxSamples);
+     for (size_t i = 0; i < count; i++) {
+         samples[i] = _ram[(_ramHead + i) % Constants::MQTT_BACKLOG_RAM_SAMPLES];
+     }
+     return count;
+ }
+
+ void MqttBacklog::consume(size_t count) {
+     if (!_peekedFlash) {
+         count = min(count, _ramCount);
+         _ramHead = (_ramHead + count) % Constants::MQTT_BACKLOG_RAM_SAMPLES;
+         _ramCount -= count;
+         return;
+     }
+
+     // Delete a segment as soon as it has been replayed completely
+     _readOffset += count;
+     if (_readOffset >= _segmentSamples[_readSegment]) {
+         SPIFFS.remove(segmentPath(_readSegment));
+         _segmentSamples[_readSegment] = 0;
+         _readOffset = 0;
+         _readSegment = _segmentSamples[1 - _readSegment] > 0 ? 1 - _readSegment : _writeSegment;
+     }
+     _peekedFlash = false;
+ }
+
+ size_t MqttBacklog::size() const {
+     return flashSamples() + _ramCount;
+ }
+
+ bool MqttBacklog::spill() {
+     // Recycle the older segment once the active one is full
+     if (_segmentSamples[_writeSegment] + _ramCount > SEGMENT_SAMPLES) {
+         uint8_t next = 1 - _writeSegment;
+         if (_segmentSamples[next] > 0) {
+             dropSegment(next);
+         }
+         _writeSegment = next;
+     }
+     if (flashSamples() == 0) {
+         _readSegment = _writeSegment;
+         _readOffset = 0;
+     }
+
+     File file = SPIFFS.open(segmentPath(_writeSegment), FILE_APPEND);
+     if (!file) {
+         return false;
+     }
+
+     // The ring may wrap, which takes two writes
+     size_t first = min(_ramCount, Constants::MQTT_BACKLOG_RAM_SAMPLES - _ramHead);
+     size_t bytes = file.write(reinterpret_cast<const uint8_t*>(&_ram[_ramHead]), first * sizeof(TelemetrySample));
+     if (first < _ramCount) {
+         bytes += file.write(reinterpret_cast<const uint8_t*>(_ram), (_ramCount - first) * sizeof(TelemetrySample));
+     }
+     file.close();
+
+     _segmentSamples[_writeSegment] += bytes / sizeof(TelemetrySample);
+     if (bytes != _ramCount * sizeof(TelemetrySample)) {
+         // A partial record would misalign every later append, stop spilling
+         _spillToFlash = false;
+         _dropped += _ramCount - bytes / sizeof(TelemetrySample);
+         _ramHead = 0;
+         _ramCount = 0;
+         LOG_ERROR("MQTT", "Telemetry backlog spill failed, keeping samples in RAM only");
+         return true;
+     }
+
+     _ramHead = 0;
+     _ramCount = 0;
+     return true;
+ }
+
+ void MqttBacklog::dropSegment(uint8_t index) {
+     uint32_t unread = _segmentSamples[index] - (index == _readSegment ? _readOffset : 0);
+     _dropped += unread;
+
+     SPIFFS.remove(segmentPath(index));
+     _segmentSamples[index] = 0;
+
+     if (index == _readSegment) {
+         _readSegment = 1 - index;
+         _readOffset = 0;
+     }
+
+     LOG_WARN("MQTT", "Dropped %lu unsent telemetry samples", static_cast<unsigned long>(unread));
+ }
+
+ size_t MqttBacklog::flashSamples() const {
+     return _segmentSamples[0] + _segmentSamples[1] - _readOffset;
+ }
+
+ String MqttBacklog::segmentPath(uint8_t index) {
+     char path[32];
+     snprintf(path, sizeof(path), SEGMENT_FORMAT, Constants::MQTT_BACKLOG_DIR, index);
+     return String(path);
+ }
@@ -0,0 +1,122 @@
+/**
+ * @file MqttBacklog.h
+ * @brief Bounded store of telemetry samples that could not be published
+ */
+
+ #ifndef MQTT_BACKLOG_H
+ #define MQTT_BACKLOG_H
+
+ #include <Arduino.h>
+ #include <SPIFFS.h>
+ #include "../utils/Constants.h"
+
+ /**
+  * @struct TelemetrySample
+  * @brief One sensor publish, kept in binary form until it can be sent
+  */
+ struct __attribute__((packed)) TelemetrySample {
+     uint32_t timestamp;          // Unix seconds (uptime seconds until NTP sync)
+     float upperTemperature;
+     float upperHumidity;
+     float lowerTemperature;
+     float lowerHumidity;
+     float scdTemperature;
+     float scdHumidity;
+     float scdCo2;
+     float tentTemperature;       // Fused tent reading
+     float tentHumidity;
+     float tentCo2;
+     float tentConfidence;
+     uint8_t validMask;           // Bit 0 upper DHT, bit 1 lower DHT, bit 2 SCD40, bit 3 tent, bit 4 tent CO2
+ };
+
+ /**
+  * @class MqttBacklog
+  * @brief FIFO of unsent telemetry in RAM with optional spill to two SPIFFS segments
+  *
+  * Samples are appended to a preallocated RAM ring. When the ring fills and
+  * spilling is enabled, the whole ring is appended to the active segment file
+  * in one write; when that segment is full the other one is recycled, which
+  * drops the oldest samples. Without spilling the ring overwrites its oldest
+  * sample. Segments are always older than the RAM ring, so peek() returns
+  * samples in the order they were pushed, and segments left over from before
+  * a reboot are replayed first. Only the MQTT task uses the backlog, so it
+  * takes no lock.
+  */
+ class MqttBacklog {
+ public:
+     MqttBacklog();
+     ~MqttBacklog();
+
+     /**
+      * @brief Allocate the RAM ring and pick up segments left from a previous boot
+      * @param spillToFlash Whether a full RAM ring moves to SPIFFS instead of overwriting
+      * @return True if initialized successfully
+      */
+     bool begin(bool spillToFlash);
+
+     /**
+      * @brief Enable or disable spilling to SPIFFS (samples already on flash are kept)
+      * @param spillToFlash Whether a full RAM ring moves to SPIFFS
+      */
+     void setSpillToFlash(bool spillToFlash) { _spillToFlash = spillToFlash; }
+
+     bool getSpillToFlash() const { return _spillToFlash; }
+
+     /**
+      * @brief Append a sample
+      * @param sample Sample to store
+      */
+     void push(const TelemetrySample& sample);
+
+     /**
+      * @brief Copy the oldest samples without removing them
+      * @param samples Output array
+      * @param maxSamples Capacity of the output array
+      * @return Number of samples copied
+      */
+     size_t peek(TelemetrySample* samples, size_t maxSamples);
+
+     /**
+      * @brief Remove samples returned by the last peek()
+      * @param count Number of samples that were delivered
+      */
+     void consume(size_t count);
+
+     /**
+      * @brief Get the number of samples waiting
+      */
+     size_t size() const;
+
+     bool isEmpty() const { return size() == 0; }
+
+     /**
+      * @brief Get the number of samples lost to the size bound
+      * @return Dropped samples since boot
+      */
+     uint32_t getDropped() const { return _dropped; }
+
+ private:
+     // RAM ring
+     TelemetrySample* _ram;
+     size_t _ramHead;
+     size_t _ramCount;
+
+     // Spill segments
+     bool _spillToFlash;
+     uint8_t _readSegment;        // Oldest segment with unread samples
+     uint8_t _writeSegment;       // Segment the next spill appends to
+     uint32_t _readOffset;        // Samples already consumed from _readSegment
+     uint32_t _segmentSamples[2];
+
+     bool _peekedFlash;           // Whether the last peek() came from a segment
+     uint32_t _dropped;
+
+     // Private methods
+     bool spill();
+     void dropSegment(uint8_t index);
+     size_t flashSamples() const;
+     static String segmentPath(uint8_t index);
+ };
+
+ #endif // MQTT_BACKLOG_H
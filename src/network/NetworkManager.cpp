@@ -7,6 +7,13 @@
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
  
+ namespace {
+     // Task notification bits set by the event handler
+     constexpr uint32_t EVENT_GOT_IP = 1UL << 0;
+     constexpr uint32_t EVENT_DISCONNECTED = 1UL << 1;
+     constexpr uint32_t EVENT_RSSI_LOW = 1UL << 2;
+ }
+ 
  NetworkManager::NetworkManager() :
      _isInitialized(false),
      _isInAPMode(false),
@@ -16,6 +23,16 @@
      _minRSSI(Constants::DEFAULT_MIN_RSSI),
      _wifiCheckInterval(Constants::WIFI_CHECK_INTERVAL),
      _useDHCP(true),
+     _fastCache{},
+     _fastCacheValid(false),
+     _reusedLease(false),
+     _preferFullScan(false),
+     _state(WiFiState::CONNECTING),
+     _failedAttempts(0),
+     _retryAt(0),
+     _scanTimestamp(0),
+     _scanValid(false),
+     _scanRunning(false),
      _networkMutex(nullptr),
      _wifiTaskHandle(nullptr),
      _connectedCallback(nullptr),
@@ -24,6 +41,11 @@
  }
  
  NetworkManager::~NetworkManager() {
+     esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &wifiEventHandler);
+     esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_BSS_RSSI_LOW, &wifiEventHandler);
+     esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifiEventHandler);
+     esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_LOST_IP, &wifiEventHandler);
+     
      // Clean up RTOS resources
      if (_networkMutex != nullptr) {
          vSemaphoreDelete(_networkMutex);
@@ -63,6 +85,9 @@
          nvs_close(nvsHandle);
      }
      
+     // Last access point, for the fast connect
+     loadFastConnectCache();
+     
      _isInitialized = true;
      return true;
  }
@@ -105,24 +130,15 @@
      // Set hostname
      WiFi.setHostname(_hostname.c_str());
      
-     // Setup mDNS
-     setupMDNS();
+     // Reconnects are driven by the state machine, not the driver
+     WiFi.setAutoReconnect(false);
      
      // Connect to WiFi using credentials
      bool connected = connectToWiFi();
      
      if (connected) {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", 
-             "Connected to WiFi SSID: " + getConnectedSSID() + 
-             " with IP: " + getIPAddress());
-         
          _isInAPMode = false;
-         _isConnected = true;
-         
-         // Call connection callback if set
-         if (_connectedCallback) {
-             _connectedCallback(getIPAddress(), getConnectedSSID());
-         }
+         enterConnected();
      } else {
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Network", "Failed to connect to any WiFi network");
      }
@@ -134,22 +150,104 @@
      std::vector<NetworkInfo> networks;
      
      // Ensure we're in a mode that can scan (STA or AP+STA)
+     enableScanMode();
+     
+     getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", "Scanning for WiFi networks...");
+     
+     int numNetworks = WiFi.scanNetworks();
+     collectScanResults(numNetworks, networks);
+     
+     return networks;
+ }
+ 
+ bool NetworkManager::startScan() {
+     bool running = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_networkMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         pollScan();
+         
+         if (!_scanRunning) {
+             enableScanMode();
+             
+             // Async scan, the results are picked up by pollScan()
+             int result = WiFi.scanNetworks(true);
+             _scanRunning = result == WIFI_SCAN_RUNNING;
+             if (_scanRunning) {
+                 LOG_INFO("Network", "Started background WiFi scan");
+             } else {
+                 LOG_ERROR("Network", "Failed to start WiFi scan (%d)", result);
+             }
+         }
+         running = _scanRunning;
+         
+         // Release mutex
+         xSemaphoreGive(_networkMutex);
+     }
+     
+     return running;
+ }
+ 
+ bool NetworkManager::getScanResults(std::vector<NetworkInfo>& networks, uint32_t& ageMs, bool& running) {
+     bool valid = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_networkMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         pollScan();
+         
+         valid = _scanValid;
+         running = _scanRunning;
+         if (valid) {
+             networks = _scanResults;
+             ageMs = millis() - _scanTimestamp;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_networkMutex);
+     }
+     
+     return valid;
+ }
+ 
+ void NetworkManager::enableScanMode() {
      if (WiFi.getMode() == WIFI_AP) {
          WiFi.mode(WIFI_AP_STA);
      } else if (WiFi.getMode() == WIFI_OFF) {
          WiFi.mode(WIFI_STA);
      }
+ }
+ 
+ void NetworkManager::pollScan() {
+     if (!_scanRunning) {
+         return;
+     }
      
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", "Scanning for WiFi networks...");
+     // Non-blocking, still running until the driver reports a count
+     int result = WiFi.scanComplete();
+     if (result == WIFI_SCAN_RUNNING) {
+         return;
+     }
      
-     int numNetworks = WiFi.scanNetworks();
+     _scanRunning = false;
+     if (result == WIFI_SCAN_FAILED) {
+         LOG_ERROR("Network", "Background WiFi scan failed");
+         return;
+     }
      
-     if (numNetworks == 0) {
+     _scanResults.clear();
+     collectScanResults(result, _scanResults);
+     _scanTimestamp = millis();
+     _scanValid = true;
+ }
+ 
+ void NetworkManager::collectScanResults(int count, std::vector<NetworkInfo>& networks) {
+     if (count <= 0) {
          getAppCore()->getLogManager()->log(LogLevel::WARN, "Network", "No WiFi networks found!");
      } else {
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", String(numNetworks) + " WiFi networks found");
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", String(count) + " WiFi networks found");
          
-         for (int i = 0; i < numNetworks; i++) {
+         networks.reserve(count);
+         for (int i = 0; i < count; i++) {
              NetworkInfo network;
              network.ssid = WiFi.SSID(i);
              network.rssi = WiFi.RSSI(i);
@@ -171,8 +269,6 @@
      
      // Free memory used by scan
      WiFi.scanDelete();
-     
-     return networks;
  }
  
  bool NetworkManager::setWiFiCredentials(uint8_t index, const String& ssid, const String& password) {
@@ -450,6 +546,10 @@
  
  void NetworkManager::setMinRSSI(int32_t rssi) {
      _minRSSI = rssi;
+     
+     if (_isConnected) {
+         esp_wifi_set_rssi_threshold(rssi);
+     }
  }
  
  int32_t NetworkManager::getMinRSSI() {
@@ -493,6 +593,13 @@
  }
  
  bool NetworkManager::connectToWiFi() {
+     // Straight to the last access point first, the scan is only the fallback
+     if (!_preferFullScan && connectFast()) {
+         saveFastConnectCache();
+         return true;
+     }
+     _preferFullScan = false;
+     
      // Clear any existing configurations in WiFiMulti
      _wifiMulti = WiFiMulti();
      
@@ -531,17 +638,291 @@
      
      if (WiFi.status() == WL_CONNECTED) {
          _currentSSID = WiFi.SSID();
+         saveFastConnectCache();
          return true;
      }
      
      return false;
  }
  
+ bool NetworkManager::connectFast() {
+     if (!_fastCacheValid) {
+         return false;
+     }
+     
+     // The cached network must still be one of the stored credentials
+     String password;
+     bool found = false;
+     for (uint8_t i = 0; i < 3 && !found; i++) {
+         String ssid;
+         found = getWiFiCredentials(i, ssid, password) && ssid == _fastCache.ssid;
+     }
+     if (!found) {
+         return false;
+     }
+     
+     // Reusing the lease skips the DHCP exchange; a fresh one is fetched every
+     // few connects so the lease does not run out under us
+     _reusedLease = _useDHCP && _fastCache.ip != 0 && _fastCache.leaseReuses < Constants::WIFI_LEASE_MAX_REUSES;
+     if (!_useDHCP) {
+         WiFi.config(_staticIP, _staticGateway, _staticSubnet, _staticDNS1, _staticDNS2);
+     } else if (_reusedLease) {
+         WiFi.config(IPAddress(_fastCache.ip), IPAddress(_fastCache.gateway), 
+                     IPAddress(_fastCache.subnet), IPAddress(_fastCache.dns));
+     } else {
+         // Drop the static config of an earlier reused lease so DHCP runs again
+         WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+     }
+     
+     // Join the known BSSID on its channel, no scan
+     uint32_t startTime = millis();
+     WiFi.begin(_fastCache.ssid, password.c_str(), _fastCache.channel, _fastCache.bssid);
+     while (WiFi.status() != WL_CONNECTED && millis() - startTime < Constants::WIFI_FAST_CONNECT_TIMEOUT) {
+         delay(20);
+     }
+     
+     if (WiFi.status() == WL_CONNECTED) {
+         _currentSSID = WiFi.SSID();
+         LOG_INFO("Network", "Fast connect to %s (channel %u) took %lu ms%s", _fastCache.ssid, 
+                  _fastCache.channel, static_cast<unsigned long>(millis() - startTime), 
+                  _reusedLease ? ", reusing DHCP lease" : "");
+         return true;
+     }
+     
+     LOG_WARN("Network", "Fast connect to %s failed, scanning for networks", _fastCache.ssid);
+     WiFi.disconnect();
+     if (_useDHCP) {
+         WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+     }
+     _reusedLease = false;
+     return false;
+ }
+ 
+ void NetworkManager::loadFastConnectCache() {
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_WIFI_NAMESPACE, NVS_READONLY, &nvsHandle) != ESP_OK) {
+         return;
+     }
+     
+     // A size mismatch means an older layout, ignore it
+     size_t len = sizeof(_fastCache);
+     esp_err_t err = nvs_get_blob(nvsHandle, Constants::NVS_WIFI_FAST_KEY, &_fastCache, &len);
+     nvs_close(nvsHandle);
+     
+     _fastCacheValid = err == ESP_OK && len == sizeof(_fastCache) && _fastCache.ssid[0] != '\0' && 
+                       _fastCache.ssid[sizeof(_fastCache.ssid) - 1] == '\0';
+ }
+ 
+ void NetworkManager::saveFastConnectCache() {
+     WiFiFastConnectCache cache = {};
+     const uint8_t* bssid = WiFi.BSSID();
+     if (bssid == nullptr) {
+         return;
+     }
+     strncpy(cache.ssid, WiFi.SSID().c_str(), sizeof(cache.ssid) - 1);
+     memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+     cache.channel = WiFi.channel();
+     
+     if (_reusedLease) {
+         cache.ip = _fastCache.ip;
+         cache.gateway = _fastCache.gateway;
+         cache.subnet = _fastCache.subnet;
+         cache.dns = _fastCache.dns;
+         cache.leaseReuses = _fastCache.leaseReuses + 1;
+     } else if (_useDHCP) {
+         cache.ip = static_cast<uint32_t>(WiFi.localIP());
+         cache.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
+         cache.subnet = static_cast<uint32_t>(WiFi.subnetMask());
+         cache.dns = static_cast<uint32_t>(WiFi.dnsIP(0));
+     }
+     _reusedLease = false;
+     
+     // Unchanged, spare the flash
+     if (_fastCacheValid && memcmp(&cache, &_fastCache, sizeof(cache)) == 0) {
+         return;
+     }
+     
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_WIFI_NAMESPACE, NVS_READWRITE, &nvsHandle) != ESP_OK) {
+         return;
+     }
+     
+     esp_err_t err = nvs_set_blob(nvsHandle, Constants::NVS_WIFI_FAST_KEY, &cache, sizeof(cache));
+     if (err == ESP_OK) {
+         err = nvs_commit(nvsHandle);
+     }
+     nvs_close(nvsHandle);
+     
+     if (err == ESP_OK) {
+         _fastCache = cache;
+         _fastCacheValid = true;
+     } else {
+         LOG_WARN("Network", "Failed to save fast connect cache (%d)", err);
+     }
+ }
+ 
+ void NetworkManager::attemptConnect() {
+     bool connected = connectToWiFi();
+     
+     // Events raised while joining describe the attempt, not the outcome
+     xTaskNotifyWait(0, UINT32_MAX, nullptr, 0);
+     
+     if (connected && WiFi.status() == WL_CONNECTED) {
+         enterConnected();
+     } else {
+         scheduleRetry();
+     }
+ }
+ 
+ void NetworkManager::enterConnected() {
+     _isConnected = true;
+     _currentSSID = WiFi.SSID();
+     _failedAttempts = 0;
+     
+     if (_state == WiFiState::AP_FALLBACK) {
+         WiFi.softAPdisconnect(true);
+         LOG_INFO("Network", "Configuration AP stopped");
+     }
+     _state = WiFiState::CONNECTED;
+     
+     getAppCore()->getLogManager()->log(LogLevel::INFO, "Network", 
+         "Connected to WiFi SSID: " + getConnectedSSID() + 
+         " with IP: " + getIPAddress());
+     
+     // Announce the (possibly new) address
+     setupMDNS();
+     
+     // A weak signal is reported by an event instead of polling the RSSI
+     esp_wifi_set_rssi_threshold(_minRSSI);
+     
+     // Call connection callback if set
+     if (_connectedCallback) {
+         _connectedCallback(getIPAddress(), getConnectedSSID());
+     }
+ }
+ 
+ void NetworkManager::handleConnectionLost() {
+     _isConnected = false;
+     _state = WiFiState::CONNECTING;
+     
+     // Call disconnection callback if set
+     if (_disconnectedCallback) {
+         _disconnectedCallback();
+     }
+ }
+ 
+ void NetworkManager::scheduleRetry() {
+     _isConnected = false;
+     if (_failedAttempts < UINT8_MAX) {
+         _failedAttempts++;
+     }
+     
+     // Exponential backoff, capped at the check interval
+     uint8_t shift = _failedAttempts > 16 ? 15 : _failedAttempts - 1;
+     uint32_t backoff = Constants::WIFI_BACKOFF_MIN_MS << shift;
+     if (backoff > _wifiCheckInterval) {
+         backoff = _wifiCheckInterval;
+     }
+     _retryAt = millis() + backoff;
+     
+     if (_state != WiFiState::AP_FALLBACK && _failedAttempts >= Constants::WIFI_AP_FALLBACK_FAILURES) {
+         startFallbackAP();
+     }
+     if (_state != WiFiState::AP_FALLBACK) {
+         _state = WiFiState::BACKOFF;
+     }
+     
+     LOG_WARN("Network", "WiFi connect attempt %u failed, retrying in %lu ms", 
+              _failedAttempts, static_cast<unsigned long>(backoff));
+ }
+ 
+ void NetworkManager::startFallbackAP() {
+     // The station keeps retrying while the AP lets the user reach the device
+     WiFi.mode(WIFI_AP_STA);
+     if (!WiFi.softAP(Constants::DEFAULT_AP_SSID, Constants::DEFAULT_AP_PASSWORD)) {
+         LOG_ERROR("Network", "Failed to start the configuration AP");
+         return;
+     }
+     
+     _state = WiFiState::AP_FALLBACK;
+     LOG_WARN("Network", "No WiFi after %u attempts, configuration AP '%s' started at %s", 
+              _failedAttempts, Constants::DEFAULT_AP_SSID, WiFi.softAPIP().toString().c_str());
+ }
+ 
+ void NetworkManager::handleEvents(uint32_t events) {
+     // Setup mode, the configuration portal owns the radio
+     if (_isInAPMode) {
+         return;
+     }
+     
+     switch (_state) {
+         case WiFiState::CONNECTED: {
+             bool lost = (events & EVENT_DISCONNECTED) != 0;
+             
+             if (!lost && (events & EVENT_RSSI_LOW)) {
+                 int32_t rssi = WiFi.RSSI();
+                 if (rssi < _minRSSI) {
+                     // Try to connect to a different network, the cached AP is the weak one
+                     LOG_WARN("Network", "WiFi signal weak (%d dBm), looking for better network", rssi);
+                     _preferFullScan = true;
+                     WiFi.disconnect();
+                     lost = true;
+                 } else {
+                     // Re-arm, the event fires once per crossing
+                     esp_wifi_set_rssi_threshold(_minRSSI);
+                 }
+             } else if (lost) {
+                 LOG_WARN("Network", "WiFi connection lost, reconnecting");
+             }
+             
+             if (lost) {
+                 handleConnectionLost();
+             }
+             break;
+         }
+         
+         case WiFiState::CONNECTING:
+             attemptConnect();
+             break;
+         
+         case WiFiState::BACKOFF:
+         case WiFiState::AP_FALLBACK:
+             // Joined by someone else (e.g. a credential test), otherwise
+             // keep waiting out the delay when woken early
+             if ((events & EVENT_GOT_IP) && WiFi.status() == WL_CONNECTED) {
+                 enterConnected();
+             } else if (static_cast<int32_t>(_retryAt - millis()) <= 0) {
+                 attemptConnect();
+             }
+             break;
+     }
+ }
+ 
+ TickType_t NetworkManager::nextWakeDelay() {
+     if (_isInAPMode) {
+         return portMAX_DELAY;
+     }
+     
+     switch (_state) {
+         case WiFiState::CONNECTING:
+             return 0;
+         
+         case WiFiState::BACKOFF:
+         case WiFiState::AP_FALLBACK: {
+             int32_t remaining = static_cast<int32_t>(_retryAt - millis());
+             return remaining > 0 ? pdMS_TO_TICKS(remaining) : 0;
+         }
+         
+         default:
+             return portMAX_DELAY;
+     }
+ }
+ 
  void NetworkManager::createTasks() {
-     // Create the WiFi watchdog task
+     // Create the WiFi state machine task
      BaseType_t result = xTaskCreatePinnedToCore(
-         wifiWatchdogTask,          // Task function
-         "WiFiWatchdog",            // Task name
+         wifiStateTask,             // Task function
+         "WiFiState",               // Task name
          Constants::STACK_SIZE_WIFI,// Stack size (words)
          this,                      // Task parameters
          Constants::PRIORITY_WIFI,  // Priority
@@ -551,74 +932,51 @@
      
      if (result != pdPASS) {
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Network", 
-             "Failed to create WiFi watchdog task");
+             "Failed to create WiFi state task");
+         return;
      }
+     
+     // The handler only wakes the task, all the work happens there
+     esp_err_t err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &wifiEventHandler, this);
+     if (err == ESP_OK) {
+         err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_BSS_RSSI_LOW, &wifiEventHandler, this);
+     }
+     if (err == ESP_OK) {
+         err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifiEventHandler, this);
+     }
+     if (err == ESP_OK) {
+         err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_LOST_IP, &wifiEventHandler, this);
+     }
+     if (err != ESP_OK) {
+         LOG_ERROR("Network", "Failed to register WiFi event handlers (%d)", err);
+     }
+ }
+ 
+ void NetworkManager::wifiEventHandler(void* arg, esp_event_base_t base, int32_t id, void* data) {
+     NetworkManager* networkManager = static_cast<NetworkManager*>(arg);
+     if (networkManager->_wifiTaskHandle == nullptr) {
+         return;
+     }
+     
+     uint32_t event = EVENT_DISCONNECTED;
+     if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+         event = EVENT_GOT_IP;
+     } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+         event = EVENT_RSSI_LOW;
+     }
+     
+     xTaskNotify(networkManager->_wifiTaskHandle, event, eSetBits);
  }
  
- void NetworkManager::wifiWatchdogTask(void* parameter) {
+ void NetworkManager::wifiStateTask(void* parameter) {
      NetworkManager* networkManager = static_cast<NetworkManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
      
      while (true) {
-         // Only do checks in station mode
-         if (!networkManager->_isInAPMode) {
-             if (WiFi.status() != WL_CONNECTED) {
-                 // We lost connection, try to reconnect
-                 if (networkManager->_isConnected) {
-                     networkManager->_isConnected = false;
-                     
-                     // Call disconnection callback if set
-                     if (networkManager->_disconnectedCallback) {
-                         networkManager->_disconnectedCallback();
-                     }
-                 }
-                 
-                 // Try to reconnect
-                 if (networkManager->connectToWiFi()) {
-                     networkManager->_isConnected = true;
-                     
-                     // Call connection callback if set
-                     if (networkManager->_connectedCallback) {
-                         networkManager->_connectedCallback(
-                             networkManager->getIPAddress(), 
-                             networkManager->getConnectedSSID()
-                         );
-                     }
-                 }
-             } else {
-                 // We're connected, check signal strength
-                 if (networkManager->_isConnected) {
-                     int32_t rssi = WiFi.RSSI();
-                     if (rssi < networkManager->_minRSSI) {
-                         // Signal is too weak, try to find a better network
-                         getAppCore()->getLogManager()->log(LogLevel::WARN, "Network", 
-                             "WiFi signal weak (" + String(rssi) + " dBm), looking for better network");
-                         
-                         // Try to connect to a different network
-                         WiFi.disconnect();
-                         networkManager->_isConnected = false;
-                         
-                         // Call disconnection callback if set
-                         if (networkManager->_disconnectedCallback) {
-                             networkManager->_disconnectedCallback();
-                         }
-                     }
-                 } else {
-                     // We just got connected
-                     networkManager->_isConnected = true;
-                     
-                     // Call connection callback if set
-                     if (networkManager->_connectedCallback) {
-                         networkManager->_connectedCallback(
-                             networkManager->getIPAddress(), 
-                             networkManager->getConnectedSSID()
-                         );
-                     }
-                 }
-             }
-         }
+         TASK_LOOP_MARK();
          
-         // Wait for the next check period
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(networkManager->_wifiCheckInterval));
+         // Sleep until an event arrives or the backoff runs out, nothing is polled
+         uint32_t events = 0;
+         xTaskNotifyWait(0, UINT32_MAX, &events, networkManager->nextWakeDelay());
+         networkManager->handleEvents(events);
      }
- }
\ No newline at end of file
+ }
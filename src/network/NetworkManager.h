@@ -15,6 +15,8 @@
  #include <freertos/semphr.h>
  #include <nvs.h>
  #include <nvs_flash.h>
+ #include <esp_event.h>
+ #include <esp_wifi.h>
  #include "../utils/Constants.h"
  
  // Callback function types
@@ -33,9 +35,41 @@
      wifi_auth_mode_t encryptionType;
  };
  
+ /**
+  * @enum WiFiState
+  * @brief States of the station connection, driven by WiFi/IP events
+  */
+ enum class WiFiState : uint8_t {
+     CONNECTING,     // Join a network on the next pass
+     CONNECTED,
+     BACKOFF,        // Waiting out the delay after a failed attempt
+     AP_FALLBACK     // Backing off with the configuration AP up
+ };
+ 
+ /**
+  * @struct WiFiFastConnectCache
+  * @brief Last successful association, kept in NVS so the next connect can skip the scan
+  */
+ struct __attribute__((packed)) WiFiFastConnectCache {
+     char ssid[33];
+     uint8_t bssid[6];
+     uint8_t channel;
+     uint32_t ip;              // DHCP lease, 0 with a static IP
+     uint32_t gateway;
+     uint32_t subnet;
+     uint32_t dns;
+     uint8_t leaseReuses;      // Fast connects that reused the lease instead of asking DHCP
+ };
+ 
  /**
   * @class NetworkManager
   * @brief Manages all network-related functionality
+  *
+  * The station connection is owned by one task that sleeps until a WiFi/IP
+  * event arrives or a backoff delay runs out. A lost connection is retried
+  * at once, failed attempts back off exponentially up to the check interval,
+  * and after repeated failures the configuration AP is brought up alongside
+  * the retries until the station connects again.
   */
  class NetworkManager {
  public:
@@ -69,6 +103,21 @@
       */
      std::vector<NetworkInfo> scanNetworks();
      
+     /**
+      * @brief Start a scan in the background, returning immediately
+      * @return True if a scan is running (started now or earlier)
+      */
+     bool startScan();
+     
+     /**
+      * @brief Get the results of the last background scan
+      * @param networks Output, networks found by the last completed scan
+      * @param ageMs Output, milliseconds since that scan completed
+      * @param running Output, whether a scan is still in progress
+      * @return True if a completed scan is available
+      */
+     bool getScanResults(std::vector<NetworkInfo>& networks, uint32_t& ageMs, bool& running);
+     
      /**
       * @brief Set WiFi credentials
       * @param index Credential set index (0-2)
@@ -166,10 +215,16 @@
      
      /**
       * @brief Set WiFi check interval
-      * @param interval Check interval in milliseconds
+      * @param interval Longest retry backoff while disconnected, in milliseconds
       */
      void setWiFiCheckInterval(uint32_t interval);
      
+     /**
+      * @brief Get the state of the station connection
+      * @return Current state
+      */
+     WiFiState getWiFiState() const { return _state; }
+     
      /**
       * @brief Register callback for WiFi connected event
       * @param callback Function to call when WiFi connects
@@ -208,10 +263,27 @@
      // WiFi instances
      WiFiMulti _wifiMulti;
      
+     // Fast reconnect to the last access point
+     WiFiFastConnectCache _fastCache;
+     bool _fastCacheValid;
+     bool _reusedLease;         // The current connection runs on the cached lease
+     bool _preferFullScan;      // Skip the fast path once, e.g. to roam away from a weak AP
+     
+     // Connection state machine, only changed by the WiFi task after boot
+     volatile WiFiState _state;
+     uint8_t _failedAttempts;
+     uint32_t _retryAt;            // millis() at which the backoff ends
+     
      // RTOS resources
      SemaphoreHandle_t _networkMutex;
      TaskHandle_t _wifiTaskHandle;
      
+     // Background scan, guarded by _networkMutex
+     std::vector<NetworkInfo> _scanResults;
+     uint32_t _scanTimestamp;
+     bool _scanValid;
+     bool _scanRunning;
+     
      // Callbacks
      WiFiConnectedCallback _connectedCallback;
      WiFiDisconnectedCallback _disconnectedCallback;
@@ -220,9 +292,23 @@
      bool initializeNVS();
      bool setupMDNS();
      bool connectToWiFi();
+     void enableScanMode();
+     void collectScanResults(int count, std::vector<NetworkInfo>& networks);
+     void pollScan();
+     bool connectFast();
+     void loadFastConnectCache();
+     void saveFastConnectCache();
+     void attemptConnect();
+     void enterConnected();
+     void handleConnectionLost();
+     void scheduleRetry();
+     void startFallbackAP();
+     void handleEvents(uint32_t events);
+     TickType_t nextWakeDelay();
      
-     // Task function
-     static void wifiWatchdogTask(void* parameter);
+     // Event handler (ESP event loop) and task function
+     static void wifiEventHandler(void* arg, esp_event_base_t base, int32_t id, void* data);
+     static void wifiStateTask(void* parameter);
  };
  
  #endif // NETWORK_MANAGER_H
\ No newline at end of file
@@ -5,6 +5,40 @@
 
  #include "OTAManager.h"
  #include "../core/AppCore.h"
+ #include "../utils/Helpers.h"
+ #include <ArduinoJson.h>
+ #include <mbedtls/sha256.h>
+ #include <mbedtls/pk.h>
+ #include <mbedtls/base64.h>
+ #include <esp_ota_ops.h>
+ #include <esp_partition.h>
+ 
+ namespace {
+     const uint8_t DELTA_MAGIC[4] = {'T', 'D', 'L', '1'};
+     const uint8_t DELTA_OP_END = 0x00;
+     const uint8_t DELTA_OP_COPY = 0x01;
+     const uint8_t DELTA_OP_INSERT = 0x02;
+     
+     uint32_t readLe32(const uint8_t* data) {
+         return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | 
+                (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+     }
+     
+     // Compare "major.minor.patch" numerically, missing parts count as 0
+     int compareVersions(const String& a, const String& b) {
+         unsigned int partsA[3] = {0, 0, 0};
+         unsigned int partsB[3] = {0, 0, 0};
+         sscanf(a.c_str(), "%u.%u.%u", &partsA[0], &partsA[1], &partsA[2]);
+         sscanf(b.c_str(), "%u.%u.%u", &partsB[0], &partsB[1], &partsB[2]);
+         
+         for (uint8_t i = 0; i < 3; i++) {
+             if (partsA[i] != partsB[i]) {
+                 return partsA[i] < partsB[i] ? -1 : 1;
+             }
+         }
+         return 0;
+     }
+ }
  
  OTAManager::OTAManager() :
      _otaMutex(nullptr),
@@ -13,7 +47,9 @@
      _updateStatus(OTAStatus::IDLE),
      _lastError(""),
      _totalSize(0),
-     _currentSize(0)
+     _currentSize(0),
+     _allowDowngrade(false),
+     _pullTaskHandle(nullptr)
  {
  }
  
@@ -41,6 +77,9 @@
      ArduinoOTA.onProgress([this](uint progress, uint total) { this->onProgress(progress, total); });
      ArduinoOTA.onError([this](ota_error_t error) { this->onError(error); });
      
+     // Progress of every Update.write(), whichever path feeds it
+     Update.onProgress([this](size_t progress, size_t total) { this->onProgress(progress, total); });
+     
      return true;
  }
  
@@ -324,19 +363,13 @@
          return false;
      }
      
-     // Write data
+     // Write data, progress is reported through Update.onProgress
      size_t written = Update.write(data, len);
      if (written != len) {
          _lastError = Update.errorString();
          return false;
      }
      
-     // Update progress
-     _currentSize += written;
-     if (_totalSize > 0) {
-         _updateProgress = (_currentSize * 100) / _totalSize;
-     }
-     
      return true;
  }
  
@@ -360,4 +393,435 @@
      getAppCore()->getLogManager()->log(LogLevel::INFO, "OTA", "Update completed successfully");
      
      return true;
- }
\ No newline at end of file
+ }
+ 
+ bool OTAManager::startPullUpdate(const String& manifestUrl, bool allowDowngrade) {
+     bool started = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_otaMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (strlen(Constants::OTA_SIGNING_PUBLIC_KEY) == 0) {
+             _lastError = "No manifest signing key in this build";
+         } else if (_updateStatus == OTAStatus::UPDATING_FIRMWARE || _updateStatus == OTAStatus::UPDATING_FILESYSTEM) {
+             _lastError = "Update already in progress";
+         } else {
+             _manifestUrl = manifestUrl;
+             _allowDowngrade = allowDowngrade;
+             _updateStatus = OTAStatus::UPDATING_FIRMWARE;
+             _updateProgress = 0;
+             _currentSize = 0;
+             _totalSize = 0;
+             _lastError = "";
+             
+             started = xTaskCreatePinnedToCore(
+                 pullUpdateTask,                    // Task function
+                 "OTAPullTask",                     // Task name
+                 Constants::STACK_SIZE_OTA_PULL,    // Stack size (words)
+                 this,                              // Task parameters
+                 Constants::PRIORITY_OTA_PULL,      // Priority (low)
+                 &_pullTaskHandle,                  // Task handle
+                 0                                  // Core ID (0 - protocol core)
+             ) == pdPASS;
+             
+             if (!started) {
+                 _pullTaskHandle = nullptr;
+                 _updateStatus = OTAStatus::UPDATE_FAILED;
+                 _lastError = "Failed to create update task";
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_otaMutex);
+     }
+     
+     return started;
+ }
+ 
+ bool OTAManager::beginRequest(HTTPClient& http, WiFiClientSecure& tls, const String& url) {
+     bool begun;
+     if (url.startsWith("https://")) {
+         if (strlen(Constants::OTA_SERVER_CA_CERT) == 0) {
+             _lastError = "No update server CA in this build";
+             return false;
+         }
+         
+         tls.setCACert(Constants::OTA_SERVER_CA_CERT);
+         begun = http.begin(tls, url);
+     } else {
+         // Plain http relies on the manifest signature and image digest alone
+         begun = http.begin(url);
+     }
+     
+     if (!begun) {
+         _lastError = "Invalid update URL";
+     }
+     return begun;
+ }
+ 
+ bool OTAManager::fetchManifest(const String& url, OTAManifest& manifest) {
+     WiFiClientSecure tls;
+     HTTPClient http;
+     if (!beginRequest(http, tls, url)) {
+         return false;
+     }
+     int httpCode = http.GET();
+     if (httpCode != 200) {
+         http.end();
+         _lastError = "Manifest request failed (" + String(httpCode) + ")";
+         return false;
+     }
+     
+     DynamicJsonDocument doc(1024);
+     DeserializationError error = deserializeJson(doc, http.getStream());
+     http.end();
+     if (error) {
+         _lastError = "Invalid manifest";
+         return false;
+     }
+     
+     manifest.version = doc["version"] | "";
+     manifest.url = doc["url"] | "";
+     manifest.size = doc["size"] | 0;
+     manifest.sha256Hex = doc["sha256"] | "";
+     manifest.signature = doc["signature"] | "";
+     manifest.sha256Hex.toLowerCase();
+     
+     // Optional patch against the running image, checked by deltaApplies()
+     manifest.deltaUrl = doc["delta"]["url"] | "";
+     String deltaSource = doc["delta"]["source_sha256"] | "";
+     if (!manifest.deltaUrl.isEmpty() && 
+         Helpers::hexToBytes(deltaSource, manifest.deltaSourceSha256, sizeof(manifest.deltaSourceSha256)) != sizeof(manifest.deltaSourceSha256)) {
+         manifest.deltaUrl = "";
+     }
+     
+     if (manifest.url.isEmpty() || manifest.size == 0 || manifest.signature.isEmpty() || 
+         manifest.sha256Hex.length() != 64 || 
+         Helpers::hexToBytes(manifest.sha256Hex, manifest.sha256, sizeof(manifest.sha256)) != sizeof(manifest.sha256)) {
+         _lastError = "Incomplete manifest";
+         return false;
+     }
+     
+     return true;
+ }
+ 
+ bool OTAManager::checkManifestVersion(const OTAManifest& manifest) {
+     // The version is covered by the signature, so only the running one has to be trusted
+     if (_allowDowngrade || compareVersions(manifest.version, getFirmwareVersion()) > 0) {
+         return true;
+     }
+     
+     _lastError = "Manifest version " + manifest.version + " is not newer than " + getFirmwareVersion();
+     return false;
+ }
+ 
+ bool OTAManager::verifyManifestSignature(const OTAManifest& manifest) {
+     // Digest of the signed fields
+     String signedText = manifest.version + ":" + String(manifest.size) + ":" + manifest.sha256Hex;
+     uint8_t digest[32];
+     mbedtls_sha256_ret(reinterpret_cast<const uint8_t*>(signedText.c_str()), signedText.length(), digest, 0);
+     
+     uint8_t signature[96];
+     size_t signatureLength = 0;
+     if (mbedtls_base64_decode(signature, sizeof(signature), &signatureLength, 
+                               reinterpret_cast<const uint8_t*>(manifest.signature.c_str()), 
+                               manifest.signature.length()) != 0) {
+         _lastError = "Invalid manifest signature encoding";
+         return false;
+     }
+     
+     mbedtls_pk_context key;
+     mbedtls_pk_init(&key);
+     int ret = mbedtls_pk_parse_public_key(&key, reinterpret_cast<const uint8_t*>(Constants::OTA_SIGNING_PUBLIC_KEY), 
+                                           strlen(Constants::OTA_SIGNING_PUBLIC_KEY) + 1);
+     if (ret == 0) {
+         ret = mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, signatureLength);
+     }
+     mbedtls_pk_free(&key);
+     
+     if (ret != 0) {
+         _lastError = "Manifest signature rejected";
+         return false;
+     }
+     
+     return true;
+ }
+ 
+ bool OTAManager::readStream(WiFiClient* stream, uint8_t* buffer, size_t length) {
+     size_t received = 0;
+     uint32_t lastData = millis();
+     
+     while (received < length) {
+         size_t available = stream->available();
+         if (available == 0) {
+             if (!stream->connected() || millis() - lastData > Constants::OTA_STREAM_TIMEOUT_MS) {
+                 _lastError = "Download stalled";
+                 return false;
+             }
+             vTaskDelay(pdMS_TO_TICKS(1));
+             continue;
+         }
+         
+         received += stream->readBytes(buffer + received, min(available, length - received));
+         lastData = millis();
+     }
+     
+     return true;
+ }
+ 
+ bool OTAManager::writeImageChunk(mbedtls_sha256_context& sha, const uint8_t* data, size_t length) {
+     // Hash what goes to flash, so the digest covers the image as written
+     mbedtls_sha256_update_ret(&sha, data, length);
+     if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+         _lastError = Update.errorString();
+         return false;
+     }
+     return true;
+ }
+ 
+ bool OTAManager::finishImage(mbedtls_sha256_context& sha, const OTAManifest& manifest, bool success) {
+     uint8_t digest[32];
+     mbedtls_sha256_finish_ret(&sha, digest);
+     mbedtls_sha256_free(&sha);
+     
+     // Only a complete image with the signed digest is committed
+     if (success && memcmp(digest, manifest.sha256, sizeof(digest)) != 0) {
+         _lastError = "Image digest does not match the manifest";
+         success = false;
+     }
+     
+     if (!success) {
+         Update.abort();
+         return false;
+     }
+     
+     if (!Update.end()) {
+         _lastError = Update.errorString();
+         return false;
+     }
+     
+     return true;
+ }
+ 
+ bool OTAManager::streamImage(const OTAManifest& manifest) {
+     WiFiClientSecure tls;
+     HTTPClient http;
+     if (!beginRequest(http, tls, manifest.url)) {
+         return false;
+     }
+     int httpCode = http.GET();
+     if (httpCode != 200) {
+         http.end();
+         _lastError = "Image request failed (" + String(httpCode) + ")";
+         return false;
+     }
+     
+     int length = http.getSize();
+     if (length >= 0 && static_cast<size_t>(length) != manifest.size) {
+         http.end();
+         _lastError = "Image size does not match the manifest";
+         return false;
+     }
+     
+     // Update picks the inactive app partition (factory or ota_0)
+     if (!Update.begin(manifest.size, U_FLASH)) {
+         http.end();
+         _lastError = Update.errorString();
+         return false;
+     }
+     _totalSize = manifest.size;
+     
+     // Hash and write each chunk as it arrives, the SHA peripheral does the digest
+     mbedtls_sha256_context sha;
+     mbedtls_sha256_init(&sha);
+     mbedtls_sha256_starts_ret(&sha, 0);
+     
+     WiFiClient* stream = http.getStreamPtr();
+     uint8_t buffer[Constants::OTA_STREAM_CHUNK_SIZE];
+     size_t received = 0;
+     bool success = true;
+     
+     while (success && received < manifest.size) {
+         size_t chunk = min(sizeof(buffer), manifest.size - received);
+         success = readStream(stream, buffer, chunk) && writeImageChunk(sha, buffer, chunk);
+         received += chunk;
+     }
+     http.end();
+     
+     return finishImage(sha, manifest, success);
+ }
+ 
+ bool OTAManager::deltaApplies(const OTAManifest& manifest) {
+     if (manifest.deltaUrl.isEmpty()) {
+         return false;
+     }
+     
+     // The patch only fits the exact image it was built against
+     uint8_t runningDigest[32];
+     const esp_partition_t* running = esp_ota_get_running_partition();
+     return running != nullptr && esp_partition_get_sha256(running, runningDigest) == ESP_OK && 
+            memcmp(runningDigest, manifest.deltaSourceSha256, sizeof(runningDigest)) == 0;
+ }
+ 
+ bool OTAManager::streamDelta(const OTAManifest& manifest) {
+     const esp_partition_t* source = esp_ota_get_running_partition();
+     
+     WiFiClientSecure tls;
+     HTTPClient http;
+     if (!beginRequest(http, tls, manifest.deltaUrl)) {
+         return false;
+     }
+     int httpCode = http.GET();
+     if (httpCode != 200) {
+         http.end();
+         _lastError = "Delta request failed (" + String(httpCode) + ")";
+         return false;
+     }
+     
+     // Header: magic and the size of the image it produces
+     WiFiClient* stream = http.getStreamPtr();
+     uint8_t header[8];
+     if (!readStream(stream, header, sizeof(header)) || memcmp(header, DELTA_MAGIC, 4) != 0 || 
+         readLe32(header + 4) != manifest.size) {
+         http.end();
+         _lastError = "Invalid delta header";
+         return false;
+     }
+     
+     // The target is the inactive slot, the source the slot we run from
+     if (!Update.begin(manifest.size, U_FLASH)) {
+         http.end();
+         _lastError = Update.errorString();
+         return false;
+     }
+     _totalSize = manifest.size;
+     
+     mbedtls_sha256_context sha;
+     mbedtls_sha256_init(&sha);
+     mbedtls_sha256_starts_ret(&sha, 0);
+     
+     uint8_t buffer[Constants::OTA_STREAM_CHUNK_SIZE];
+     size_t written = 0;
+     bool success = true;
+     bool finished = false;
+     
+     while (success && !finished) {
+         uint8_t op[9];
+         if (!readStream(stream, op, 1)) {
+             success = false;
+             break;
+         }
+         
+         if (op[0] == DELTA_OP_END) {
+             finished = true;
+             break;
+         }
+         
+         if (op[0] != DELTA_OP_COPY && op[0] != DELTA_OP_INSERT) {
+             _lastError = "Invalid delta operation";
+             success = false;
+             break;
+         }
+         
+         // COPY carries a source offset and a length, INSERT a length and the bytes
+         size_t argumentBytes = op[0] == DELTA_OP_COPY ? 8 : 4;
+         if (!readStream(stream, op + 1, argumentBytes)) {
+             success = false;
+             break;
+         }
+         uint32_t offset = op[0] == DELTA_OP_COPY ? readLe32(op + 1) : 0;
+         uint32_t length = readLe32(op + 1 + argumentBytes - 4);
+         
+         if (written + length > manifest.size || 
+             (op[0] == DELTA_OP_COPY && static_cast<uint64_t>(offset) + length > source->size)) {
+             _lastError = "Delta operation out of range";
+             success = false;
+             break;
+         }
+         
+         while (success && length > 0) {
+             size_t chunk = min(static_cast<size_t>(length), sizeof(buffer));
+             if (op[0] == DELTA_OP_COPY) {
+                 success = esp_partition_read(source, offset, buffer, chunk) == ESP_OK;
+                 if (!success) {
+                     _lastError = "Failed to read the running partition";
+                 }
+                 offset += chunk;
+             } else {
+                 success = readStream(stream, buffer, chunk);
+             }
+             
+             success = success && writeImageChunk(sha, buffer, chunk);
+             written += chunk;
+             length -= chunk;
+         }
+     }
+     http.end();
+     
+     if (success && written != manifest.size) {
+         _lastError = "Delta produced an incomplete image";
+         success = false;
+     }
+     
+     return finishImage(sha, manifest, success);
+ }
+ 
+ void OTAManager::finishPullUpdate(bool success, const String& error) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_otaMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _updateStatus = success ? OTAStatus::UPDATE_COMPLETE : OTAStatus::UPDATE_FAILED;
+         if (success) {
+             _updateProgress = 100;
+         } else {
+             _lastError = error;
+         }
+         _pullTaskHandle = nullptr;
+         
+         // Release mutex
+         xSemaphoreGive(_otaMutex);
+     }
+ }
+ 
+ void OTAManager::pullUpdateTask(void* parameter) {
+     OTAManager* otaManager = static_cast<OTAManager*>(parameter);
+     LogManager* logManager = getAppCore()->getLogManager();
+     
+     // Only this task touches _lastError until finishPullUpdate()
+     otaManager->_lastError = "";
+     OTAManifest manifest;
+     bool success = otaManager->fetchManifest(otaManager->_manifestUrl, manifest) && 
+                    otaManager->verifyManifestSignature(manifest) && 
+                    otaManager->checkManifestVersion(manifest);
+     
+     if (success) {
+         logManager->log(LogLevel::INFO, "OTA", 
+             "Pull update to " + manifest.version + " (" + String(manifest.size) + " bytes)");
+         
+         // A patch against the running image first, the full image if it cannot be used
+         bool patched = false;
+         if (otaManager->deltaApplies(manifest)) {
+             patched = otaManager->streamDelta(manifest);
+             if (!patched) {
+                 logManager->log(LogLevel::WARN, "OTA", 
+                     "Delta update failed (" + otaManager->_lastError + "), downloading the full image");
+                 otaManager->_lastError = "";
+                 otaManager->_updateProgress = 0;
+                 otaManager->_currentSize = 0;
+             }
+         }
+         
+         success = patched || otaManager->streamImage(manifest);
+     }
+     
+     String error = otaManager->_lastError;
+     otaManager->finishPullUpdate(success, error);
+     
+     if (success) {
+         logManager->log(LogLevel::INFO, "OTA", "Pull update complete, rebooting");
+         vTaskDelay(pdMS_TO_TICKS(1000));
+         getAppCore()->reboot();
+     } else {
+         logManager->log(LogLevel::ERROR, "OTA", "Pull update failed: " + error);
+     }
+     
+     vTaskDelete(nullptr);
+ }
@@ -9,7 +9,12 @@
  #include <Arduino.h>
  #include <ArduinoOTA.h>
  #include <Update.h>
+ #include <WiFiClient.h>
+ #include <WiFiClientSecure.h>
+ #include <HTTPClient.h>
+ #include <mbedtls/sha256.h>
  #include <freertos/FreeRTOS.h>
+ #include <freertos/task.h>
  #include <freertos/semphr.h>
  #include "../utils/Constants.h"
  
@@ -32,6 +37,31 @@
      UPDATE_FAILED
  };
  
+ /**
+  * @struct OTAManifest
+  * @brief Description of a firmware image, fetched before the image itself
+  *
+  * The signature is ECDSA P-256 (DER, Base64) over the SHA-256 of
+  * "<version>:<size>:<sha256 hex>", so the digest it vouches for also
+  * pins the version and the size.
+  *
+  * An optional delta rebuilds the same image from the running one. It is
+  * a stream of little-endian records after the magic "TDL1" and the
+  * uint32 image size: 0x01 COPY (uint32 source offset, uint32 length),
+  * 0x02 INSERT (uint32 length, then the bytes) and 0x00 END. The result is
+  * checked against the same signed digest as the full image.
+  */
+ struct OTAManifest {
+     String version;
+     String url;               // Firmware image, HTTP or HTTPS
+     size_t size;
+     uint8_t sha256[32];
+     String sha256Hex;
+     String signature;
+     String deltaUrl;          // Empty without a usable delta
+     uint8_t deltaSourceSha256[32];    // Image the delta was built against
+ };
+ 
  /**
   * @class OTAManager
   * @brief Manages over-the-air firmware and file system updates
@@ -96,6 +126,30 @@
       */
      bool handleFilesystemUpdate(uint8_t* data, size_t len, bool final);
      
+     /**
+      * @brief Start a pull update from a signed manifest in a background task
+      *
+      * The manifest signature is checked first. The image is then streamed
+      * from HTTP(S) straight into the inactive app partition, hashed on the
+      * way with the SHA peripheral, and only committed with Update.end() if
+      * the digest matches the manifest. Nothing is staged on SPIFFS. When
+      * the manifest has a delta for the running image, the delta is tried
+      * first and the full image is the fallback. The device reboots into
+      * the new firmware once it is committed. A manifest whose version is
+      * not newer than the running firmware is rejected, so an old signed
+      * manifest cannot be replayed to downgrade the device.
+      * @param manifestUrl URL of the JSON manifest (version, url, size, sha256, signature)
+      * @param allowDowngrade Also accept a version that is not newer than the running one
+      * @return True if the update task was started
+      */
+     bool startPullUpdate(const String& manifestUrl, bool allowDowngrade = false);
+     
+     /**
+      * @brief Get the number of image bytes written so far
+      * @return Bytes written to flash by the current or last update
+      */
+     size_t getUpdateBytes() const { return _currentSize; }
+     
      /**
       * @brief Get update progress
       * @return Update progress (0-100)
@@ -125,6 +179,9 @@
      String _lastError;
      size_t _totalSize;
      size_t _currentSize;
+     String _manifestUrl;
+     bool _allowDowngrade;
+     TaskHandle_t _pullTaskHandle;
      
      // OTA handlers
      void onStart();
@@ -136,6 +193,20 @@
      bool beginUpdate(OTAType type, size_t size);
      bool writeUpdate(uint8_t* data, size_t len);
      bool endUpdate();
+     bool beginRequest(HTTPClient& http, WiFiClientSecure& tls, const String& url);
+     bool fetchManifest(const String& url, OTAManifest& manifest);
+     bool verifyManifestSignature(const OTAManifest& manifest);
+     bool checkManifestVersion(const OTAManifest& manifest);
+     bool streamImage(const OTAManifest& manifest);
+     bool deltaApplies(const OTAManifest& manifest);
+     bool streamDelta(const OTAManifest& manifest);
+     bool readStream(WiFiClient* stream, uint8_t* buffer, size_t length);
+     bool writeImageChunk(mbedtls_sha256_context& sha, const uint8_t* data, size_t length);
+     bool finishImage(mbedtls_sha256_context& sha, const OTAManifest& manifest, bool success);
+     void finishPullUpdate(bool success, const String& error);
+     
+     // Task function
+     static void pullUpdateTask(void* parameter);
  };
  
  #endif // OTA_MANAGER_H
\ No newline at end of file
@@ -98,12 +98,12 @@
      return Constants::FS_VERSION;
  }
  
- bool VersionManager::performUpdate() {
-     // Placeholder for update logic
+ bool VersionManager::performUpdate(const String& manifestUrl) {
      getAppCore()->getLogManager()->log(LogLevel::INFO, "VersionManager", 
-         "Attempting to perform update");
+         "Attempting to perform update from: " + manifestUrl);
      
-     return false;
+     // Download, hashing and flashing happen in one pass, nothing is staged
+     return getAppCore()->getOTAManager()->startPullUpdate(manifestUrl);
  }
  
  uint16_t VersionManager::getMajorVersion() const {
@@ -125,19 +125,3 @@
  uint32_t VersionManager::getVersionTimestamp() const {
      return _versionTimestamp;
  }
- 
- bool VersionManager::downloadUpdateFile(const String& url) {
-     // Placeholder for download logic
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "VersionManager", 
-         "Attempting to download update from: " + url);
-     
-     return false;
- }
- 
- bool VersionManager::validateUpdate() {
-     // Placeholder for update validation logic
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "VersionManager", 
-         "Validating downloaded update");
-     
-     return false;
- }
\ No newline at end of file
@@ -39,10 +39,11 @@
      String getCurrentFsVersion() const;
  
      /**
-      * @brief Perform version update if available
-      * @return True if update successful, false otherwise
+      * @brief Start a streamed, signature-checked update through the OTA manager
+      * @param manifestUrl URL of the signed update manifest
+      * @return True if the update was started
       */
-     bool performUpdate();
+     bool performUpdate(const String& manifestUrl);
  
      /**
       * @brief Get major version
@@ -107,19 +108,6 @@
                        uint16_t& patch, 
                        uint16_t& build, 
                        uint32_t& timestamp);
- 
-     /**
-      * @brief Download update file
-      * @param url URL of update file
-      * @return True if download successful, false otherwise
-      */
-     bool downloadUpdateFile(const String& url);
- 
-     /**
-      * @brief Validate downloaded update
-      * @return True if update is valid, false otherwise
-      */
-     bool validateUpdate();
  };
  
  #endif // VERSION_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,300 @@
+/**
+ * @file GrowPhaseScheduler.cpp
+ * @brief Implementation of the GrowPhaseScheduler class
+ */
+
+ #include "GrowPhaseScheduler.h"
+ #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+ #include "../system/ProfileManager.h"
+ #include "../components/RelayManager.h"
+ 
+ namespace {
+     EnvironmentalThresholds thresholdsOf(const ProfileSettings& settings) {
+         EnvironmentalThresholds thresholds;
+         thresholds.humidityLow = settings.humidityLow;
+         thresholds.humidityHigh = settings.humidityHigh;
+         thresholds.temperatureLow = settings.temperatureLow;
+         thresholds.temperatureHigh = settings.temperatureHigh;
+         thresholds.co2Low = settings.co2Low;
+         thresholds.co2High = settings.co2High;
+         return thresholds;
+     }
+ }
+ 
+ GrowPhaseScheduler::GrowPhaseScheduler() :
+     _startTime(0),
+     _enabled(false),
+     _activePhase(-1),
+     _scheduleMutex(nullptr)
+ {
+ }
+ 
+ GrowPhaseScheduler::~GrowPhaseScheduler() {
+     // Clean up RTOS resources
+     if (_scheduleMutex != nullptr) {
+         vSemaphoreDelete(_scheduleMutex);
+     }
+ }
+ 
+ bool GrowPhaseScheduler::begin() {
+     // Create mutex for thread-safe operations
+     _scheduleMutex = xSemaphoreCreateMutex();
+     if (_scheduleMutex == nullptr) {
+         Serial.println("Failed to create grow phase mutex!");
+         return false;
+     }
+     
+     // No schedule is fine, profiles are then only loaded by hand
+     loadFromFile();
+     
+     return true;
+ }
+ 
+ bool GrowPhaseScheduler::parseSchedule(JsonObjectConst json, std::vector<GrowPhase>& phases, 
+                                        time_t& start, bool& enabled) {
+     JsonArrayConst phasesArray = json["phases"];
+     if (phasesArray.isNull() || phasesArray.size() == 0 || phasesArray.size() > Constants::MAX_GROW_PHASES) {
+         return false;
+     }
+     
+     enabled = json["enabled"] | true;
+     start = json["start"] | static_cast<time_t>(0);
+     
+     phases.clear();
+     for (JsonObjectConst phaseObj : phasesArray) {
+         GrowPhase phase;
+         phase.profile = phaseObj["profile"] | "";
+         phase.durationHours = phaseObj["duration_hours"] | 0;
+         phase.rampHours = phaseObj["ramp_hours"] | 0;
+         
+         if (phase.profile.isEmpty() || phase.durationHours == 0 || phase.rampHours > phase.durationHours) {
+             return false;
+         }
+         phases.push_back(phase);
+     }
+     
+     return true;
+ }
+ 
+ bool GrowPhaseScheduler::setSchedule(JsonObjectConst json) {
+     std::vector<GrowPhase> phases;
+     time_t start;
+     bool enabled;
+     if (!parseSchedule(json, phases, start, enabled)) {
+         LOG_ERROR("GrowPhase", "Invalid grow phase schedule");
+         return false;
+     }
+     
+     // Every phase has to name an existing profile
+     ProfileManager* profileManager = getAppCore()->getProfileManager();
+     for (const auto& phase : phases) {
+         ProfileSettings settings;
+         if (!profileManager->getProfileSettings(phase.profile, settings)) {
+             LOG_ERROR("GrowPhase", "Unknown profile in grow phase schedule: %s", phase.profile.c_str());
+             return false;
+         }
+     }
+     
+     // Without a start time the cycle starts now, which needs a synced clock
+     if (start == 0) {
+         TimeManager* timeManager = getAppCore()->getTimeManager();
+         if (!timeManager->isTimeSet()) {
+             LOG_ERROR("GrowPhase", "Grow phase schedule needs a start time before NTP sync");
+             return false;
+         }
+         start = timeManager->getTimestamp();
+     }
+     
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_scheduleMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _phases = phases;
+         _startTime = start;
+         _enabled = enabled;
+         _activePhase = -1;
+         success = saveToFile();
+         
+         // Release mutex
+         xSemaphoreGive(_scheduleMutex);
+     }
+     
+     if (!success) {
+         return false;
+     }
+     
+     LOG_INFO("GrowPhase", "Grow phase schedule %s with %u phases", 
+         enabled ? "enabled" : "disabled", static_cast<unsigned>(phases.size()));
+     
+     // Apply the phase due now rather than at the next maintenance pass
+     if (enabled) {
+         update();
+     } else {
+         getAppCore()->getRelayManager()->cancelThresholdRamp();
+     }
+     
+     return true;
+ }
+ 
+ String GrowPhaseScheduler::getScheduleJson() {
+     DynamicJsonDocument doc(2048);
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_scheduleMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         fillScheduleJson(doc.to<JsonObject>());
+         
+         // Where the schedule currently stands
+         time_t phaseStart = 0;
+         int8_t index = _phases.empty() ? -1 : phaseAt(time(nullptr), phaseStart);
+         doc["active_phase"] = _enabled ? _activePhase : -1;
+         doc["phase_ends"] = index >= 0 ? phaseStart + _phases[index].durationHours * 3600UL : 0;
+         
+         // Release mutex
+         xSemaphoreGive(_scheduleMutex);
+     }
+     
+     String json;
+     serializeJson(doc, json);
+     return json;
+ }
+ 
+ void GrowPhaseScheduler::update() {
+     // The calendar means nothing before NTP sync
+     TimeManager* timeManager = getAppCore()->getTimeManager();
+     if (!timeManager->isTimeSet()) {
+         return;
+     }
+     time_t now = timeManager->getTimestamp();
+     
+     GrowPhase phase;
+     String previousProfile;
+     time_t phaseStart = 0;
+     bool enter = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_scheduleMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (_enabled && !_phases.empty()) {
+             int8_t index = phaseAt(now, phaseStart);
+             if (index >= 0 && index != _activePhase) {
+                 phase = _phases[index];
+                 if (index > 0) {
+                     previousProfile = _phases[index - 1].profile;
+                 }
+                 _activePhase = index;
+                 enter = true;
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_scheduleMutex);
+     }
+     
+     // Profile and relay managers take their own mutexes
+     if (enter) {
+         enterPhase(phase, previousProfile, phaseStart);
+     }
+ }
+ 
+ int8_t GrowPhaseScheduler::phaseAt(time_t now, time_t& phaseStart) {
+     // Caller must hold _scheduleMutex
+     if (now < _startTime) {
+         return -1;
+     }
+     
+     // The last phase stays active once the schedule has run out
+     phaseStart = _startTime;
+     for (size_t i = 0; i + 1 < _phases.size(); i++) {
+         time_t phaseEnd = phaseStart + _phases[i].durationHours * 3600UL;
+         if (now < phaseEnd) {
+             return i;
+         }
+         phaseStart = phaseEnd;
+     }
+     
+     return _phases.size() - 1;
+ }
+ 
+ void GrowPhaseScheduler::enterPhase(const GrowPhase& phase, const String& previousProfile, time_t phaseStart) {
+     ProfileManager* profileManager = getAppCore()->getProfileManager();
+     if (!profileManager->loadProfile(phase.profile)) {
+         LOG_ERROR("GrowPhase", "Failed to enter grow phase, profile missing: %s", phase.profile.c_str());
+         return;
+     }
+     
+     LOG_INFO("GrowPhase", "Entered grow phase with profile %s", phase.profile.c_str());
+     
+     // Loading set the new thresholds, a ramp starts them back at the previous phase's
+     uint32_t rampSeconds = phase.rampHours * 3600UL;
+     if (rampSeconds == 0 || previousProfile.isEmpty() || time(nullptr) >= phaseStart + rampSeconds) {
+         return;
+     }
+     
+     ProfileSettings from;
+     ProfileSettings to;
+     if (profileManager->getProfileSettings(previousProfile, from) && from.hasEnvironment &&
+         profileManager->getProfileSettings(phase.profile, to) && to.hasEnvironment) {
+         getAppCore()->getRelayManager()->startThresholdRamp(thresholdsOf(from), thresholdsOf(to), 
+                                                             phaseStart, rampSeconds);
+     }
+ }
+ 
+ void GrowPhaseScheduler::fillScheduleJson(JsonObject obj) {
+     // Caller must hold _scheduleMutex
+     obj["enabled"] = _enabled;
+     obj["start"] = _startTime;
+     
+     JsonArray phasesArray = obj.createNestedArray("phases");
+     for (const auto& phase : _phases) {
+         JsonObject phaseObj = phasesArray.createNestedObject();
+         phaseObj["profile"] = phase.profile;
+         phaseObj["duration_hours"] = phase.durationHours;
+         phaseObj["ramp_hours"] = phase.rampHours;
+     }
+ }
+ 
+ bool GrowPhaseScheduler::loadFromFile() {
+     if (!SPIFFS.exists(Constants::GROW_PHASES_FILE)) {
+         return false;
+     }
+     
+     File file = SPIFFS.open(Constants::GROW_PHASES_FILE, FILE_READ);
+     if (!file) {
+         LOG_ERROR("GrowPhase", "Failed to open %s", Constants::GROW_PHASES_FILE);
+         return false;
+     }
+     
+     DynamicJsonDocument doc(2048);
+     DeserializationError error = deserializeJson(doc, file);
+     file.close();
+     
+     if (error || !parseSchedule(doc.as<JsonObjectConst>(), _phases, _startTime, _enabled)) {
+         LOG_ERROR("GrowPhase", "Failed to parse %s", Constants::GROW_PHASES_FILE);
+         _phases.clear();
+         _enabled = false;
+         return false;
+     }
+     
+     LOG_INFO("GrowPhase", "Loaded grow phase schedule with %u phases", static_cast<unsigned>(_phases.size()));
+     return true;
+ }
+ 
+ bool GrowPhaseScheduler::saveToFile() {
+     // Caller must hold _scheduleMutex
+     DynamicJsonDocument doc(2048);
+     fillScheduleJson(doc.to<JsonObject>());
+     
+     File file = SPIFFS.open(Constants::GROW_PHASES_FILE, FILE_WRITE);
+     if (!file) {
+         LOG_ERROR("GrowPhase", "Failed to open %s for writing", Constants::GROW_PHASES_FILE);
+         return false;
+     }
+     
+     bool success = serializeJson(doc, file) > 0;
+     file.close();
+     
+     if (!success) {
+         LOG_ERROR("GrowPhase", "Failed to write %s", Constants::GROW_PHASES_FILE);
+     }
+     return success;
+ }
@@ -0,0 +1,92 @@
+/**
+ * @file GrowPhaseScheduler.h
+ * @brief Switches profiles through the phases of a grow cycle on a calendar
+ */
+
+ #ifndef GROW_PHASE_SCHEDULER_H
+ #define GROW_PHASE_SCHEDULER_H
+ 
+ #include <Arduino.h>
+ #include <ArduinoJson.h>
+ #include <SPIFFS.h>
+ #include <time.h>
+ #include <vector>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/semphr.h>
+ #include "../utils/Constants.h"
+ 
+ /**
+  * @struct GrowPhase
+  * @brief One phase of the grow cycle and the profile it runs
+  */
+ struct GrowPhase {
+     String profile;
+     uint32_t durationHours;
+     uint16_t rampHours;       // Thresholds move from the previous phase's over this time
+     
+     GrowPhase() : durationHours(0), rampHours(0) {}
+ };
+ 
+ /**
+  * @class GrowPhaseScheduler
+  * @brief Loads the profile of each grow phase when it begins
+  *
+  * The phases run back to back from a start time; the last one stays active
+  * once the schedule is over. Entering a phase loads its profile and, when
+  * the phase has a ramp, hands RelayManager the previous and new profile's
+  * thresholds so the control task interpolates between them instead of
+  * jumping. Both sets come from ProfileManager's parsed settings, no JSON is
+  * touched after the schedule is set. update() is driven by the maintenance
+  * task once a minute.
+  */
+ class GrowPhaseScheduler {
+ public:
+     GrowPhaseScheduler();
+     ~GrowPhaseScheduler();
+     
+     /**
+      * @brief Initialize the scheduler and load the saved schedule
+      * @return True if initialized successfully
+      */
+     bool begin();
+     
+     /**
+      * @brief Replace the schedule
+      * @param json Object with "enabled", optional "start" (Unix time, default now) and "phases"
+      * @return True if the schedule is valid and was saved
+      */
+     bool setSchedule(JsonObjectConst json);
+     
+     /**
+      * @brief Get the schedule and the active phase as JSON string
+      * @return Schedule as JSON string
+      */
+     String getScheduleJson();
+     
+     /**
+      * @brief Enter the phase due at the current time if it is not active yet
+      */
+     void update();
+     
+ private:
+     // Schedule
+     std::vector<GrowPhase> _phases;
+     time_t _startTime;
+     bool _enabled;
+     
+     // Phase last entered, -1 until the first update
+     int8_t _activePhase;
+     
+     // RTOS resources
+     SemaphoreHandle_t _scheduleMutex;
+     
+     // Private methods
+     bool parseSchedule(JsonObjectConst json, std::vector<GrowPhase>& phases, time_t& start, bool& enabled);
+     bool loadFromFile();
+     bool saveToFile();
+     void fillScheduleJson(JsonObject obj);
+     int8_t phaseAt(time_t now, time_t& phaseStart);
+     void enterPhase(const GrowPhase& phase, const String& previousProfile, time_t phaseStart);
+ };
+ 
+ #endif // GROW_PHASE_SCHEDULER_H
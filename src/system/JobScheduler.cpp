@@ -0,0 +1,107 @@
+/**
+ * @file JobScheduler.cpp
+ * @brief Implementation of the JobScheduler class
+ */
+
+ #include "JobScheduler.h"
+ #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+ 
+ JobScheduler::JobScheduler() :
+     _jobCount(0),
+     _schedulerTaskHandle(nullptr)
+ {
+ }
+ 
+ JobScheduler::~JobScheduler() {
+     // Clean up RTOS resources
+     if (_schedulerTaskHandle != nullptr) {
+         vTaskDelete(_schedulerTaskHandle);
+     }
+ }
+ 
+ bool JobScheduler::addJob(const char* name, JobFunction function, void* context, uint32_t firstDelayMs) {
+     if (_schedulerTaskHandle != nullptr || _jobCount >= Constants::SCHEDULER_MAX_JOBS || function == nullptr) {
+         LOG_ERROR("Scheduler", "Cannot add job %s", name);
+         return false;
+     }
+     
+     // Relative until the task starts, see schedulerTask()
+     _jobs[_jobCount++] = {name, function, context, firstDelayMs};
+     return true;
+ }
+ 
+ void JobScheduler::wake() {
+     if (_schedulerTaskHandle != nullptr) {
+         xTaskNotifyGive(_schedulerTaskHandle);
+     }
+ }
+ 
+ uint32_t JobScheduler::msUntilNextJob() {
+     if (_schedulerTaskHandle == nullptr) {
+         return UINT32_MAX;
+     }
+     
+     uint32_t now = millis();
+     int32_t earliest = INT32_MAX;
+     for (uint8_t i = 0; i < _jobCount; i++) {
+         earliest = min(earliest, static_cast<int32_t>(_jobs[i].dueMs - now));
+     }
+     
+     return static_cast<uint32_t>(max(earliest, static_cast<int32_t>(0)));
+ }
+ 
+ void JobScheduler::createTasks() {
+     // Jobs are added with delays from now, make them deadlines
+     uint32_t now = millis();
+     for (uint8_t i = 0; i < _jobCount; i++) {
+         _jobs[i].dueMs += now;
+     }
+     
+     // Create scheduler task
+     BaseType_t result = xTaskCreatePinnedToCore(
+         schedulerTask,                   // Task function
+         "SchedulerTask",                 // Task name
+         Constants::STACK_SIZE_SCHEDULER, // Stack size (words)
+         this,                            // Task parameters
+         Constants::PRIORITY_SCHEDULER,   // Priority (low)
+         &_schedulerTaskHandle,           // Task handle
+         0                                // Core ID (0 - protocol core)
+     );
+     
+     if (result != pdPASS) {
+         LOG_ERROR("Scheduler", "Failed to create scheduler task");
+     } else {
+         LOG_INFO("Scheduler", "Scheduler task running %u jobs", _jobCount);
+     }
+ }
+ 
+ void JobScheduler::schedulerTask(void* parameter) {
+     JobScheduler* scheduler = static_cast<JobScheduler*>(parameter);
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Run every job that is due, in the order they were added
+         for (uint8_t i = 0; i < scheduler->_jobCount; i++) {
+             Job& job = scheduler->_jobs[i];
+             if (static_cast<int32_t>(millis() - job.dueMs) >= 0) {
+                 uint32_t nextMs = job.function(job.context);
+                 job.dueMs = millis() + nextMs;
+             }
+         }
+         
+         // Until the earliest deadline, light sleep from deadline to deadline or just wait
+         uint32_t waitMs = scheduler->msUntilNextJob();
+         if (waitMs == 0) {
+             continue;
+         }
+         
+         PowerManager* powerManager = getAppCore()->getPowerManager();
+         if (powerManager->getCurrentPowerMode() == PowerMode::LIGHT_SLEEP) {
+             powerManager->sleepUntilNextDeadline(waitMs);
+         } else {
+             ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+         }
+     }
+ }
\ No newline at end of file
@@ -0,0 +1,83 @@
+/**
+ * @file JobScheduler.h
+ * @brief Runs the low-rate periodic jobs of several managers on one task
+ */
+
+ #ifndef JOB_SCHEDULER_H
+ #define JOB_SCHEDULER_H
+
+ #include <Arduino.h>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/task.h>
+ #include "../utils/Constants.h"
+
+ /**
+  * @class JobScheduler
+  * @brief One task for the time sync check, power schedule and maintenance pass
+  *
+  * Those jobs run for a few milliseconds once a minute or less and spent the
+  * rest of the time in a task of their own, each with its own stack. Here a
+  * job returns how long until it wants to run again and the task sleeps
+  * until the earliest deadline, in light sleep when the power mode asks for
+  * it. Deadlines are in millis(), which keeps counting through a light sleep.
+  * Jobs are added before createTasks() and the table is fixed afterwards, so
+  * the task reads it without a lock. A job blocks the ones behind it while
+  * it runs; nothing latency-sensitive belongs here.
+  */
+ class JobScheduler {
+ public:
+     /**
+      * @brief A periodic job
+      * @param context Pointer given to addJob()
+      * @return Milliseconds until the job runs again
+      */
+     typedef uint32_t (*JobFunction)(void* context);
+
+     JobScheduler();
+     ~JobScheduler();
+
+     /**
+      * @brief Add a job, only before createTasks()
+      * @param name Name for the log, must outlive the scheduler
+      * @param function Job to run
+      * @param context Passed to the job
+      * @param firstDelayMs Time from the task start to the first run
+      * @return True if added
+      */
+     bool addJob(const char* name, JobFunction function, void* context, uint32_t firstDelayMs);
+
+     /**
+      * @brief Make the task re-check its deadlines (non-blocking, safe before tasks exist)
+      */
+     void wake();
+
+     /**
+      * @brief Get the time until the next job is due
+      * @return Milliseconds, UINT32_MAX without a running task
+      */
+     uint32_t msUntilNextJob();
+
+     /**
+      * @brief Create the scheduler task
+      */
+     void createTasks();
+
+ private:
+     struct Job {
+         const char* name;
+         JobFunction function;
+         void* context;
+         volatile uint32_t dueMs;   // millis() the job runs at next
+     };
+
+     Job _jobs[Constants::SCHEDULER_MAX_JOBS];
+     uint8_t _jobCount;
+
+     // RTOS resources
+     TaskHandle_t _schedulerTaskHandle;
+
+     // Task function
+     static void schedulerTask(void* parameter);
+ };
+
+ #endif // JOB_SCHEDULER_H
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+ * @file LatencyMonitor.cpp
+ * @brief Implementation of the LatencyMonitor class
+ */
+
+ #include "LatencyMonitor.h"
+ #include <freertos/FreeRTOS.h>
+ 
+ namespace {
+     LatencyHistogram histograms[Constants::LATENCY_PROBE_SLOTS];
+     uint8_t histogramCount = 0;
+     portMUX_TYPE histogramLock = portMUX_INITIALIZER_UNLOCKED;
+     
+     uint32_t percentile(const LatencyHistogram& histogram, uint32_t perMille) {
+         // Smallest bucket edge with the requested share of samples below it
+         uint64_t target = (static_cast<uint64_t>(histogram.count) * perMille + 999) / 1000;
+         uint64_t seen = 0;
+         for (uint8_t i = 0; i < Constants::LATENCY_BUCKETS; i++) {
+             seen += histogram.buckets[i];
+             if (seen >= target) {
+                 uint32_t edge = (i + 1 < 32) ? (1UL << (i + 1)) - 1 : UINT32_MAX;
+                 return min(edge, histogram.maxUs);
+             }
+         }
+         return histogram.maxUs;
+     }
+ }
+ 
+ LatencyHistogram* LatencyMonitor::probe(const char* name) {
+     LatencyHistogram* histogram = nullptr;
+     
+     portENTER_CRITICAL(&histogramLock);
+     for (uint8_t i = 0; i < histogramCount; i++) {
+         if (strcmp(histograms[i].name, name) == 0) {
+             histogram = &histograms[i];
+             break;
+         }
+     }
+     if (histogram == nullptr && histogramCount < Constants::LATENCY_PROBE_SLOTS) {
+         histogram = &histograms[histogramCount];
+         memset(histogram, 0, sizeof(LatencyHistogram));
+         histogram->name = name;
+         histogramCount++;
+     }
+     portEXIT_CRITICAL(&histogramLock);
+     
+     return histogram;
+ }
+ 
+ void LatencyMonitor::record(LatencyHistogram* histogram, uint32_t elapsedUs) {
+     if (histogram == nullptr) {
+         return;
+     }
+     
+     uint8_t bucket = 31 - __builtin_clz(elapsedUs | 1);
+     if (bucket >= Constants::LATENCY_BUCKETS) {
+         bucket = Constants::LATENCY_BUCKETS - 1;
+     }
+     
+     portENTER_CRITICAL(&histogramLock);
+     histogram->count++;
+     histogram->buckets[bucket]++;
+     if (elapsedUs > histogram->maxUs) {
+         histogram->maxUs = elapsedUs;
+     }
+     portEXIT_CRITICAL(&histogramLock);
+ }
+ 
+ size_t LatencyMonitor::getSummaries(LatencySummary* summaries, size_t maxSummaries) {
+     size_t written = 0;
+     
+     for (uint8_t i = 0; i < histogramCount && written < maxSummaries; i++) {
+         // Copy under the lock, the percentiles are worked out afterwards
+         LatencyHistogram snapshot;
+         portENTER_CRITICAL(&histogramLock);
+         snapshot = histograms[i];
+         portEXIT_CRITICAL(&histogramLock);
+         
+         if (snapshot.count == 0) {
+             continue;
+         }
+         
+         LatencySummary& summary = summaries[written++];
+         summary.name = snapshot.name;
+         summary.count = snapshot.count;
+         summary.p50Us = percentile(snapshot, 500);
+         summary.p99Us = percentile(snapshot, 990);
+         summary.maxUs = snapshot.maxUs;
+     }
+     
+     return written;
+ }
+ 
+ void LatencyMonitor::fillJson(JsonObject obj) {
+     LatencySummary summaries[Constants::LATENCY_PROBE_SLOTS];
+     size_t count = getSummaries(summaries, Constants::LATENCY_PROBE_SLOTS);
+     
+     for (size_t i = 0; i < count; i++) {
+         JsonObject probeObj = obj.createNestedObject(summaries[i].name);
+         probeObj["count"] = summaries[i].count;
+         probeObj["p50_us"] = summaries[i].p50Us;
+         probeObj["p99_us"] = summaries[i].p99Us;
+         probeObj["max_us"] = summaries[i].maxUs;
+     }
+ }
@@ -0,0 +1,109 @@
+/**
+ * @file LatencyMonitor.h
+ * @brief Fixed-bucket latency histograms for the hot paths
+ */
+
+ #ifndef LATENCY_MONITOR_H
+ #define LATENCY_MONITOR_H
+ 
+ #include <Arduino.h>
+ #include <esp_timer.h>
+ #include <ArduinoJson.h>
+ #include "../utils/Constants.h"
+ 
+ /**
+  * Times the rest of the enclosing scope into the histogram of this call
+  * site. The name must be a literal, it is registered on the first pass.
+  */
+ #define LATENCY_CONCAT_INNER(a, b) a##b
+ #define LATENCY_CONCAT(a, b) LATENCY_CONCAT_INNER(a, b)
+ #define LATENCY_SCOPE(name) \
+     static LatencyHistogram* const LATENCY_CONCAT(_latencyProbe, __LINE__) = LatencyMonitor::probe(name); \
+     ScopedLatency LATENCY_CONCAT(_latencyScope, __LINE__)(LATENCY_CONCAT(_latencyProbe, __LINE__))
+ 
+ /**
+  * @struct LatencyHistogram
+  * @brief Durations of one call site in log2 microsecond buckets
+  */
+ struct LatencyHistogram {
+     const char* name;
+     uint32_t count;
+     uint32_t maxUs;
+     uint32_t buckets[Constants::LATENCY_BUCKETS];   // Bucket i counts [2^i, 2^(i+1)) us
+ };
+ 
+ /**
+  * @struct LatencySummary
+  * @brief Percentiles of one histogram, rounded up to the bucket edge
+  */
+ struct LatencySummary {
+     const char* name;
+     uint32_t count;
+     uint32_t p50Us;
+     uint32_t p99Us;
+     uint32_t maxUs;
+ };
+ 
+ /**
+  * @class LatencyMonitor
+  * @brief Registry of the latency histograms, all in static memory
+  *
+  * Recording is a bucket index from the leading zero count and three
+  * increments under a spinlock, cheap enough for every sensor read and
+  * HTTP handler. Histograms are never removed; once all slots are taken
+  * new call sites are not recorded.
+  */
+ class LatencyMonitor {
+ public:
+     /**
+      * @brief Get the histogram of a call site, registering it on first use
+      * @param name Literal name, e.g. "sensor.dht"
+      * @return Histogram, nullptr if all slots are taken
+      */
+     static LatencyHistogram* probe(const char* name);
+     
+     /**
+      * @brief Add one duration
+      * @param histogram Histogram from probe() (nullptr is ignored)
+      * @param elapsedUs Duration in microseconds
+      */
+     static void record(LatencyHistogram* histogram, uint32_t elapsedUs);
+     
+     /**
+      * @brief Get the percentiles of every histogram that has samples
+      * @param summaries Output array
+      * @param maxSummaries Capacity of the output array
+      * @return Number of summaries written
+      */
+     static size_t getSummaries(LatencySummary* summaries, size_t maxSummaries);
+     
+     /**
+      * @brief Fill an object with count, p50, p99 and max per histogram
+      * @param obj Object to fill, keyed by histogram name
+      */
+     static void fillJson(JsonObject obj);
+ };
+ 
+ /**
+  * @class ScopedLatency
+  * @brief Records the time from construction to destruction
+  */
+ class ScopedLatency {
+ public:
+     explicit ScopedLatency(LatencyHistogram* histogram) :
+         _histogram(histogram),
+         _start(esp_timer_get_time()) {}
+     
+     ~ScopedLatency() {
+         LatencyMonitor::record(_histogram, static_cast<uint32_t>(esp_timer_get_time() - _start));
+     }
+     
+     ScopedLatency(const ScopedLatency&) = delete;
+     ScopedLatency& operator=(const ScopedLatency&) = delete;
+     
+ private:
+     LatencyHistogram* _histogram;
+     int64_t _start;
+ };
+ 
+ #endif // LATENCY_MONITOR_H
@@ -5,23 +5,79 @@
 
  #include "LogManager.h"
  #include "../core/AppCore.h"
+ #include <WiFi.h>
+ #include <lwip/dns.h>
  #include <time.h>
  
+ // Argument classes understood by captureArgs/formatMessage
+ enum class LogArg : uint8_t { NONE = 0, INT, LONG, LONG_LONG, SIZE, DOUBLE, STRING, POINTER };
+ 
+ /**
+  * @brief Parse one conversion spec starting after the '%'
+  * @param spec Pointer to the character after '%', advanced past the conversion
+  * @return Argument class, NONE for "%%" or unsupported conversions
+  */
+ static LogArg parseConversion(const char*& spec) {
+     // Flags, width and precision
+     while (*spec && strchr("-+ #0123456789.", *spec)) {
+         spec++;
+     }
+     
+     // Length modifiers
+     uint8_t longs = 0;
+     bool isSize = false;
+     while (*spec == 'l' || *spec == 'h' || *spec == 'z') {
+         if (*spec == 'l') longs++;
+         if (*spec == 'z') isSize = true;
+         spec++;
+     }
+     
+     switch (*spec) {
+         case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+             if (isSize) return LogArg::SIZE;
+             if (longs >= 2) return LogArg::LONG_LONG;
+             if (longs == 1) return LogArg::LONG;
+             return LogArg::INT;
+         case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+             return LogArg::DOUBLE;
+         case 's':
+             return LogArg::STRING;
+         case 'p':
+             return LogArg::POINTER;
+         default:
+             return LogArg::NONE;
+     }
+ }
+ 
  LogManager::LogManager() :
      _logLevel(LogLevel::INFO),
      _maxLogSize(Constants::MAX_LOG_FILE_SIZE / 1024),  // Convert to KB
      _remoteLogServer(""),
      _flushInterval(60),  // 60 seconds default
-     _bufferMaxSize(100),  // Maximum entries in memory buffer
+     _logFileSize(0),
+     _writeBlockUsed(0),
+     _printedSequence(0),
+     _writtenSequence(0),
+     _sentSequence(0),
+     _remotePort(0),
+     _remoteAddress(0),
+     _remoteResolving(false),
+     _lastResolveMs(0),
+     _remoteStats{0, 0, 0, false},
+     _clearedSequence(0),
+     _moduleLevelCount(0),
+     _lowestModuleLevel(LogLevel::ERROR),
      _logMutex(nullptr),
-     _logTaskHandle(nullptr),
-     _logQueue(nullptr)
+     _fileMutex(nullptr),
+     _logTaskHandle(nullptr)
  {
+     _remoteHost[0] = '\0';
  }
  
  LogManager::~LogManager() {
-     // Close log file if open
+     // Write out the partial block and close log file if open
      if (_logFile) {
+         writeBlock(true);
          _logFile.close();
      }
      
@@ -30,16 +86,29 @@
          vSemaphoreDelete(_logMutex);
      }
      
-     if (_logTaskHandle != nullptr) {
-         vTaskDelete(_logTaskHandle);
+     if (_fileMutex != nullptr) {
+         vSemaphoreDelete(_fileMutex);
      }
      
-     if (_logQueue != nullptr) {
-         vQueueDelete(_logQueue);
+     if (_logTaskHandle != nullptr) {
+         vTaskDelete(_logTaskHandle);
      }
  }
  
  bool LogManager::begin() {
+     // Preallocate the record ring, log calls never allocate after this
+     if (!_ring.reset(Constants::LOG_RING_RECORDS)) {
+         Serial.println("Failed to allocate log ring!");
+         return false;
+     }
+     
+     // Create mutex for the file before the ring mutex, which enables logging
+     _fileMutex = xSemaphoreCreateMutex();
+     if (_fileMutex == nullptr) {
+         Serial.println("Failed to create log file mutex!");
+         return false;
+     }
+     
      // Create mutex for thread-safe operations
      _logMutex = xSemaphoreCreateMutex();
      if (_logMutex == nullptr) {
@@ -47,13 +116,6 @@
          return false;
      }
      
-     // Create queue for log messages
-     _logQueue = xQueueCreate(50, sizeof(LogEntry));
-     if (_logQueue == nullptr) {
-         Serial.println("Failed to create log queue!");
-         return false;
-     }
-     
      // Create necessary directory
      if (!SPIFFS.exists("/logs")) {
          SPIFFS.mkdir("/logs");
@@ -72,55 +134,136 @@
  }
  
  void LogManager::log(LogLevel level, const String& module, const String& message) {
-     // Ignore messages below current log level
-     if (level < _logLevel) {
+     // Ignore messages below the module's (or the global) log level
+     if (!isEnabled(level, module.c_str())) {
          return;
      }
      
-     // Create log entry
-     LogEntry entry;
-     entry.level = level;
-     entry.module = module;
-     entry.message = message;
-     entry.timestamp = millis();
-     
-     // Print to serial (for debugging)
-     Serial.print(getLogLevelString(level));
-     Serial.print(" [");
-     Serial.print(module);
-     Serial.print("] ");
-     Serial.println(message);
-     
-     // Add to queue for processing
-     if (_logQueue) {
-         // Make a copy for the queue
-         LogEntry* entryCopy = new LogEntry(entry);
-         if (xQueueSend(_logQueue, entryCopy, 0) != pdPASS) {
-             // Queue is full, just delete the copy
-             delete entryCopy;
-         }
+     // Store the finished text, truncated to the payload
+     LogRecord record;
+     initRecord(record, level, module.c_str());
+     size_t length = min(message.length(), Constants::LOG_RECORD_PAYLOAD_SIZE);
+     memcpy(record.payload, message.c_str(), length);
+     record.payloadLength = length;
+     record.truncated = message.length() > length;
+     
+     commit(record);
+ }
+ 
+ void LogManager::log(LogLevel level, const String& message) {
+     log(level, "System", message);
+ }
+ 
+ void LogManager::logf(LogLevel level, const char* module, const char* format, ...) {
+     // Ignore messages below the module's (or the global) log level
+     if (!isEnabled(level, module)) {
+         return;
      }
      
-     // Also add to memory buffer (for recent logs API)
-     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-         _memoryBuffer.push_back(entry);
+     // Store the format pointer and raw arguments, formatting happens later
+     LogRecord record;
+     initRecord(record, level, module);
+     record.format = format;
+     
+     va_list args;
+     va_start(args, format);
+     captureArgs(record, format, args);
+     va_end(args);
+     
+     commit(record);
+ }
+ 
+ void LogManager::setLogLevel(LogLevel level) {
+     _logLevel = level;
+     logf(LogLevel::INFO, "LogManager", "Log level set to %s", getLogLevelString(level));
+ }
+ 
+ LogLevel LogManager::getLogLevel() {
+     return _logLevel;
+ }
+ 
+ bool LogManager::setModuleLogLevel(const char* module, LogLevel level) {
+     bool stored = false;
+     
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         // Update an existing override in place
+         for (uint8_t i = 0; i < _moduleLevelCount; i++) {
+             if (strncmp(_moduleLevels[i].name, module, sizeof(_moduleLevels[i].name)) == 0) {
+                 _moduleLevels[i].level = level;
+                 stored = true;
+                 break;
+             }
+         }
          
-         // Limit buffer size
-         if (_memoryBuffer.size() > _bufferMaxSize) {
-             _memoryBuffer.erase(_memoryBuffer.begin());
+         // Fill the new slot before publishing it through the count
+         if (!stored && _moduleLevelCount < Constants::LOG_MAX_MODULE_LEVELS) {
+             ModuleLevel& entry = _moduleLevels[_moduleLevelCount];
+             strncpy(entry.name, module, sizeof(entry.name) - 1);
+             entry.name[sizeof(entry.name) - 1] = '\0';
+             entry.level = level;
+             _moduleLevelCount = _moduleLevelCount + 1;
+             stored = true;
          }
          
+         updateLowestModuleLevel();
          xSemaphoreGive(_logMutex);
      }
+     
+     if (stored) {
+         logf(LogLevel::INFO, "LogManager", "Log level for %s set to %s", module, getLogLevelString(level));
+     }
+     return stored;
  }
  
- void LogManager::setLogLevel(LogLevel level) {
-     _logLevel = level;
-     log(LogLevel::INFO, "LogManager", "Log level set to " + getLogLevelString(level));
+ void LogManager::clearModuleLogLevel(const char* module) {
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (uint8_t i = 0; i < _moduleLevelCount; i++) {
+             if (strncmp(_moduleLevels[i].name, module, sizeof(_moduleLevels[i].name)) == 0) {
+                 // Move the last override into the freed slot
+                 _moduleLevels[i] = _moduleLevels[_moduleLevelCount - 1];
+                 _moduleLevelCount = _moduleLevelCount - 1;
+                 break;
+             }
+         }
+         
+         updateLowestModuleLevel();
+         xSemaphoreGive(_logMutex);
+     }
  }
  
- LogLevel LogManager::getLogLevel() {
-     return _logLevel;
+ std::vector<std::pair<String, LogLevel>> LogManager::getModuleLogLevels() {
+     std::vector<std::pair<String, LogLevel>> levels;
+     
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (uint8_t i = 0; i < _moduleLevelCount; i++) {
+             levels.push_back(std::make_pair(String(_moduleLevels[i].name), _moduleLevels[i].level));
+         }
+         
+         xSemaphoreGive(_logMutex);
+     }
+     
+     return levels;
+ }
+ 
+ bool LogManager::isEnabled(LogLevel level, const char* module) const {
+     // Lock-free: a racing override change affects at most one message
+     uint8_t count = _moduleLevelCount;
+     if (count == 0) {
+         return level >= _logLevel;
+     }
+     
+     // Below every configured level, no need to look the module up
+     if (level < _logLevel && level < _lowestModuleLevel) {
+         return false;
+     }
+     
+     for (uint8_t i = 0; i < count; i++) {
+         if (strncmp(_moduleLevels[i].name, module, sizeof(_moduleLevels[i].name)) == 0) {
+             return level >= _moduleLevels[i].level;
+         }
+     }
+     
+     return level >= _logLevel;
  }
  
  void LogManager::setMaxLogSize(size_t sizeKB) {
@@ -129,8 +272,30 @@
  }
  
  void LogManager::setRemoteLogServer(const String& server) {
-     _remoteLogServer = server;
-     if (server.length() > 0) {
+     // Split host[:port], the log task resolves the host on its next pass
+     String host = server;
+     uint16_t port = server.length() > 0 ? Constants::LOG_SYSLOG_DEFAULT_PORT : 0;
+     int colonPos = server.lastIndexOf(':');
+     if (colonPos > 0) {
+         host = server.substring(0, colonPos);
+         long parsed = server.substring(colonPos + 1).toInt();
+         port = (parsed > 0 && parsed <= 65535) ? static_cast<uint16_t>(parsed) : 0;
+     }
+     
+     if (_logMutex != nullptr && xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _remoteLogServer = server;
+         strncpy(_remoteHost, host.c_str(), sizeof(_remoteHost) - 1);
+         _remoteHost[sizeof(_remoteHost) - 1] = '\0';
+         _remotePort = port;
+         _remoteAddress = 0;
+         _lastResolveMs = 0;
+         
+         xSemaphoreGive(_logMutex);
+     }
+     
+     if (server.length() > 0 && port == 0) {
+         log(LogLevel::ERROR, "LogManager", "Invalid remote log server: " + server);
+     } else if (server.length() > 0) {
          log(LogLevel::INFO, "LogManager", "Remote log server set to " + server);
      } else {
          log(LogLevel::INFO, "LogManager", "Remote logging disabled");
@@ -142,38 +307,74 @@
      log(LogLevel::INFO, "LogManager", "Log flush interval set to " + String(seconds) + "s");
  }
  
+ String LogManager::getRemoteLogServer() {
+     String server;
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         server = _remoteLogServer;
+         
+         xSemaphoreGive(_logMutex);
+     }
+     return server;
+ }
+ 
+ RemoteLogStats LogManager::getRemoteLogStats() const {
+     RemoteLogStats stats = _remoteStats;
+     stats.resolved = _remoteAddress != 0;
+     return stats;
+ }
+ 
  std::vector<LogEntry> LogManager::getRecentLogs(size_t maxEntries) {
      std::vector<LogEntry> result;
      
+     // Copy the newest records out of the ring first, format them afterwards
+     std::vector<LogRecord> records;
      if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Calculate how many entries to return
-         size_t count = min(_memoryBuffer.size(), maxEntries);
-         size_t startIndex = _memoryBuffer.size() - count;
-         
-         // Copy the most recent logs
-         for (size_t i = startIndex; i < _memoryBuffer.size(); i++) {
-             result.push_back(_memoryBuffer[i]);
+         uint32_t oldest = _ring.pushed() - _ring.size();
+         size_t visible = _ring.pushed() - max(oldest, _clearedSequence);
+         size_t count = min(visible, maxEntries);
+         records.reserve(count);
+         for (size_t i = _ring.size() - count; i < _ring.size(); i++) {
+             records.push_back(_ring[i]);
          }
          
          xSemaphoreGive(_logMutex);
      }
      
+     char message[Constants::LOG_LINE_SIZE];
+     result.reserve(records.size());
+     for (const auto& record : records) {
+         formatMessage(record, message, sizeof(message));
+         
+         LogEntry entry;
+         entry.level = record.level;
+         entry.module = record.module;
+         entry.message = message;
+         entry.timestamp = record.uptimeMs;
+         result.push_back(entry);
+     }
+     
      return result;
  }
  
  void LogManager::clearLogs() {
-     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+     if (xSemaphoreTake(_fileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Close existing file
          if (_logFile) {
              _logFile.close();
          }
          
-         // Delete and recreate log file
+         // Delete and recreate log file, dropping whatever was still buffered
+         _writeBlockUsed = 0;
          SPIFFS.remove(Constants::LOG_FILE_PATH);
          openLogFile();
          
-         // Clear memory buffer
-         _memoryBuffer.clear();
+         xSemaphoreGive(_fileMutex);
+     }
+     
+     // Hide older records from the recent logs API, the ring itself keeps
+     // counting so the log task's cursors stay valid
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _clearedSequence = _ring.pushed();
          
          xSemaphoreGive(_logMutex);
      }
@@ -181,6 +382,31 @@
      log(LogLevel::INFO, "LogManager", "Logs cleared");
  }
  
+ bool LogManager::flush() {
+     if (_logMutex == nullptr) {
+         return false;
+     }
+     
+     uint32_t newest = 0;
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         newest = _ring.pushed();
+         _writtenSequence = max(_writtenSequence, newest - static_cast<uint32_t>(_ring.size()));
+         
+         xSemaphoreGive(_logMutex);
+     } else {
+         return false;
+     }
+     
+     bool success = false;
+     if (xSemaphoreTake(_fileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         success = drainToFile(newest, true);
+         
+         xSemaphoreGive(_fileMutex);
+     }
+     
+     return success;
+ }
+ 
  void LogManager::createTasks() {
      // Create log processing task
      BaseType_t result = xTaskCreatePinnedToCore(
@@ -201,109 +427,501 @@
  bool LogManager::openLogFile() {
      // Open log file in append mode
      _logFile = SPIFFS.open(Constants::LOG_FILE_PATH, FILE_APPEND);
+     _logFileSize = _logFile ? _logFile.size() : 0;
      return _logFile;
  }
  
- void LogManager::writeToFile(const LogEntry& entry) {
+ void LogManager::commit(LogRecord& record) {
+     // Before begin() there is no ring yet, print straight away
+     if (_logMutex == nullptr) {
+         char line[Constants::LOG_LINE_SIZE];
+         formatLine(record, line, sizeof(line));
+         Serial.println(line);
+         return;
+     }
+     
+     // Copy the record into the ring, the log task does the rest
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+         record.sequence = _ring.pushed();
+         _ring.push(record);
+         
+         xSemaphoreGive(_logMutex);
+     }
+ }
+ 
+ bool LogManager::fetchRecord(uint32_t sequence, LogRecord& record) {
+     bool found = false;
+     
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+         uint32_t oldest = _ring.pushed() - _ring.size();
+         if (sequence >= oldest && sequence < _ring.pushed()) {
+             record = _ring[sequence - oldest];
+             found = true;
+         }
+         
+         xSemaphoreGive(_logMutex);
+     }
+     
+     return found;
+ }
+ 
+ void LogManager::writeToFile(const LogRecord& record) {
      if (!_logFile) {
          if (!openLogFile()) {
              return;
          }
      }
      
-     // Format and write log entry
-     String formattedEntry = formatLogEntry(entry);
-     _logFile.println(formattedEntry);
-     _logFile.flush();
+     // Format the entry and append it to the write block, a line that does
+     // not fit is split so every full block lands on a block boundary
+     char line[Constants::LOG_LINE_SIZE + 2];
+     size_t length = formatLine(record, line, Constants::LOG_LINE_SIZE);
+     line[length++] = '\r';
+     line[length++] = '\n';
      
-     // Check if log rotation is needed
-     if (_logFile.size() > _maxLogSize * 1024) {
-         rotateLogFile();
+     size_t offset = 0;
+     while (offset < length) {
+         size_t chunk = min(length - offset, blockSpace());
+         memcpy(_writeBlock + _writeBlockUsed, line + offset, chunk);
+         _writeBlockUsed += chunk;
+         offset += chunk;
+         
+         if (blockSpace() == 0 && !writeBlock(false)) {
+             return;
+         }
      }
  }
  
- void LogManager::sendToRemoteServer(const LogEntry& entry) {
-     if (_remoteLogServer.length() == 0) {
-         return;
+ size_t LogManager::blockSpace() const {
+     // Room left before the file reaches the next block boundary, so an
+     // appended file (or one after a partial flush) realigns by itself
+     size_t limit = Constants::LOG_WRITE_BLOCK_SIZE - _logFileSize % Constants::LOG_WRITE_BLOCK_SIZE;
+     return limit - _writeBlockUsed;
+ }
+ 
+ bool LogManager::writeBlock(bool sync) {
+     // Caller must hold _fileMutex
+     if (_writeBlockUsed > 0) {
+         size_t written = _logFile.write(reinterpret_cast<const uint8_t*>(_writeBlock), _writeBlockUsed);
+         _logFileSize += written;
+         _writeBlockUsed = 0;
+         
+         if (written == 0) {
+             // Drop the block rather than stalling the log task on a full or broken file system
+             _logFile.close();
+             return false;
+         }
      }
      
-     // Parse server address
-     int colonPos = _remoteLogServer.indexOf(':');
-     if (colonPos <= 0) {
-         return;
+     if (sync) {
+         _logFile.flush();
+     }
+     
+     // Rotate only between blocks, never halfway through one
+     if (_logFileSize > _maxLogSize * 1024) {
+         return rotateLogFile();
+     }
+     
+     return true;
+ }
+ 
+ bool LogManager::drainToFile(uint32_t newest, bool sync) {
+     // Caller must hold _fileMutex
+     LogRecord record;
+     while (_writtenSequence < newest) {
+         if (fetchRecord(_writtenSequence, record)) {
+             writeToFile(record);
+         }
+         _writtenSequence++;
      }
      
-     String host = _remoteLogServer.substring(0, colonPos);
-     int port = _remoteLogServer.substring(colonPos + 1).toInt();
+     if (!sync) {
+         return true;
+     }
      
-     if (port <= 0 || port > 65535) {
+     if (!_logFile && !openLogFile()) {
+         _writeBlockUsed = 0;
+         return false;
+     }
+     return writeBlock(true);
+ }
+ 
+ void LogManager::sendToRemoteServer(uint32_t newest) {
+     if (_remotePort == 0) {
+         _sentSequence = newest;
          return;
      }
      
-     // Connect to server
-     WiFiClient client;
-     if (!client.connect(host.c_str(), port)) {
+     // Records stay queued in the ring while the network or the address is
+     // missing; anything the ring overwrites meanwhile is counted as dropped
+     if (WiFi.status() != WL_CONNECTED || !resolveRemoteServer()) {
          return;
      }
      
-     // Send log entry
-     String formattedEntry = formatLogEntry(entry);
-     client.println(formattedEntry);
+     LogRecord record;
+     char message[Constants::LOG_LINE_SIZE + 96];
+     IPAddress address(_remoteAddress);
+     for (uint8_t datagrams = 0; datagrams < Constants::LOG_SYSLOG_DATAGRAMS_PER_CYCLE && _sentSequence < newest; datagrams++) {
+         // Pack as many newline-terminated messages as fit into one datagram
+         size_t used = 0;
+         uint32_t packed = 0;
+         while (_sentSequence < newest) {
+             if (!fetchRecord(_sentSequence, record)) {
+                 _sentSequence++;
+                 _remoteStats.dropped++;
+                 continue;
+             }
+             
+             size_t length = formatSyslog(record, message, sizeof(message));
+             if (length == 0) {
+                 _sentSequence++;
+                 _remoteStats.dropped++;
+                 continue;
+             }
+             if (used + length > sizeof(_datagram)) {
+                 break;
+             }
+             memcpy(_datagram + used, message, length);
+             used += length;
+             packed++;
+             _sentSequence++;
+         }
+         
+         if (packed == 0) {
+             break;
+         }
+         
+         // UDP send never waits for the server, a failure costs this datagram only
+         if (_remoteUdp.beginPacket(address, _remotePort) &&
+             _remoteUdp.write(reinterpret_cast<const uint8_t*>(_datagram), used) == used &&
+             _remoteUdp.endPacket()) {
+             _remoteStats.sent += packed;
+             _remoteStats.datagrams++;
+         } else {
+             _remoteStats.dropped += packed;
+         }
+     }
+ }
+ 
+ bool LogManager::resolveRemoteServer() {
+     if (_remoteAddress != 0) {
+         return true;
+     }
+     if (_remoteResolving || (_lastResolveMs != 0 && millis() - _lastResolveMs < Constants::LOG_SYSLOG_RESOLVE_RETRY_MS)) {
+         return false;
+     }
+     _lastResolveMs = millis();
      
-     // Close connection
-     client.stop();
+     // The web server may change the host while we resolve it
+     char host[Constants::LOG_SYSLOG_HOST_SIZE];
+     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+         return false;
+     }
+     strncpy(host, _remoteHost, sizeof(host) - 1);
+     host[sizeof(host) - 1] = '\0';
+     xSemaphoreGive(_logMutex);
+     
+     // Literal addresses need no lookup
+     IPAddress literal;
+     if (literal.fromString(host)) {
+         _remoteAddress = static_cast<uint32_t>(literal);
+         return true;
+     }
+     
+     // Start an asynchronous lookup, the callback fills in the address later
+     ip_addr_t address;
+     _remoteResolving = true;
+     err_t err = dns_gethostbyname(host, &address, remoteServerFound, this);
+     if (err == ERR_OK) {
+         _remoteAddress = ip4_addr_get_u32(ip_2_ip4(&address));
+         _remoteResolving = false;
+         return true;
+     }
+     if (err != ERR_INPROGRESS) {
+         _remoteResolving = false;
+     }
+     return false;
+ }
+ 
+ void LogManager::remoteServerFound(const char* name, const ip_addr_t* address, void* arg) {
+     // Runs in the TCP/IP task
+     LogManager* logManager = static_cast<LogManager*>(arg);
+     if (address != nullptr && strcmp(name, logManager->_remoteHost) == 0) {
+         logManager->_remoteAddress = ip4_addr_get_u32(ip_2_ip4(address));
+     }
+     logManager->_remoteResolving = false;
+ }
+ 
+ size_t LogManager::formatSyslog(const LogRecord& record, char* buffer, size_t size) {
+     // RFC 5424: <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [SD] MSG
+     static const uint8_t severities[] = { 7, 6, 4, 3 };  // debug, info, warning, error
+     uint8_t severity = severities[min(static_cast<uint8_t>(record.level), static_cast<uint8_t>(3))];
+     
+     char timeStr[24] = "-";
+     if (record.time > 0) {
+         time_t when = record.time;
+         struct tm timeinfo;
+         gmtime_r(&when, &timeinfo);
+         strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+     }
+     
+     const char* hostname = WiFi.getHostname();
+     int prefix = snprintf(buffer, size, "<%u>1 %s %s %s - - [meta sequenceId=\"%lu\" sysUpTime=\"%lu\"] ",
+                           Constants::LOG_SYSLOG_FACILITY * 8 + severity, timeStr,
+                           (hostname != nullptr && hostname[0] != '\0') ? hostname : "-",
+                           record.module[0] != '\0' ? record.module : "-",
+                           static_cast<unsigned long>(record.sequence + 1),
+                           static_cast<unsigned long>(record.uptimeMs / 10));
+     if (prefix < 0 || static_cast<size_t>(prefix) >= size - 1) {
+         return 0;
+     }
+     
+     // Leave room for the terminating newline
+     size_t length = prefix + formatMessage(record, buffer + prefix, size - prefix - 1);
+     buffer[length++] = '\n';
+     return length;
  }
  
  bool LogManager::rotateLogFile() {
-     if (xSemaphoreTake(_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Close existing file
-         if (_logFile) {
-             _logFile.close();
+     // Caller must hold _fileMutex
+     
+     // Close existing file
+     if (_logFile) {
+         _logFile.close();
+     }
+     
+     // Create backup file name
+     const char* backupName = "/logs/system_backup.log";
+     
+     // Remove old backup if exists
+     if (SPIFFS.exists(backupName)) {
+         SPIFFS.remove(backupName);
+     }
+     
+     // Rename current log to backup
+     SPIFFS.rename(Constants::LOG_FILE_PATH, backupName);
+     
+     // Open new log file
+     bool opened = openLogFile();
+     
+     log(LogLevel::INFO, "LogManager", "Log file rotated");
+     return opened;
+ }
+ 
+ void LogManager::initRecord(LogRecord& record, LogLevel level, const char* module) {
+     record.sequence = 0;
+     record.uptimeMs = millis();
+     time_t now = time(nullptr);
+     record.time = (now >= static_cast<time_t>(Constants::MIN_VALID_EPOCH)) ? static_cast<uint32_t>(now) : 0;
+     record.format = nullptr;
+     record.level = level;
+     record.payloadLength = 0;
+     record.truncated = false;
+     strncpy(record.module, module, sizeof(record.module) - 1);
+     record.module[sizeof(record.module) - 1] = '\0';
+ }
+ 
+ void LogManager::fillRecord(LogRecord& record, const char* format, ...) {
+     record.format = format;
+     
+     va_list args;
+     va_start(args, format);
+     captureArgs(record, format, args);
+     va_end(args);
+ }
+ 
+ uint32_t LogManager::benchmarkFormatting(uint16_t rounds) {
+     // Shaped like the sensor messages, a string, two floats and an integer
+     LogRecord record;
+     initRecord(record, LogLevel::INFO, "Sensors");
+     fillRecord(record, "%s read %.1f C, %.1f %% (%d errors)", "Upper DHT", 23.4, 81.5, 0);
+     
+     char line[Constants::LOG_LINE_SIZE];
+     size_t total = 0;
+     uint32_t start = micros();
+     for (uint16_t i = 0; i < rounds; i++) {
+         total += formatLine(record, line, sizeof(line));
+     }
+     uint32_t elapsed = micros() - start;
+     
+     // Keeps the loop from being optimized away
+     return total > 0 ? elapsed : 0;
+ }
+ 
+ void LogManager::captureArgs(LogRecord& record, const char* format, va_list args) {
+     size_t used = 0;
+     
+     // Walk the conversions and copy each argument's raw bytes
+     for (const char* p = format; *p; p++) {
+         if (*p != '%') {
+             continue;
          }
-         
-         // Create backup file name
-         String backupName = "/logs/system_backup.log";
-         
-         // Remove old backup if exists
-         if (SPIFFS.exists(backupName)) {
-             SPIFFS.remove(backupName);
+         p++;
+         if (*p == '%') {
+             continue;
          }
          
-         // Rename current log to backup
-         SPIFFS.rename(Constants::LOG_FILE_PATH, backupName);
+         LogArg type = parseConversion(p);
+         if (type == LogArg::NONE) {
+             break;
+         }
          
-         // Open new log file
-         openLogFile();
+         size_t remaining = sizeof(record.payload) - used;
+         uint8_t* out = record.payload + used;
+         size_t size = 0;
          
-         xSemaphoreGive(_logMutex);
+         switch (type) {
+             case LogArg::INT: { int v = va_arg(args, int); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::LONG: { long v = va_arg(args, long); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::LONG_LONG: { long long v = va_arg(args, long long); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::SIZE: { size_t v = va_arg(args, size_t); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::DOUBLE: { double v = va_arg(args, double); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::POINTER: { void* v = va_arg(args, void*); size = sizeof(v); if (size <= remaining) memcpy(out, &v, size); break; }
+             case LogArg::STRING: {
+                 // Strings are copied (they rarely outlive the call), cut to fit
+                 const char* v = va_arg(args, const char*);
+                 if (v == nullptr) {
+                     v = "(null)";
+                 }
+                 size_t length = strlen(v);
+                 if (remaining == 0) {
+                     size = 1;
+                     break;
+                 }
+                 if (length + 1 > remaining) {
+                     length = remaining - 1;
+                     record.truncated = true;
+                 }
+                 memcpy(out, v, length);
+                 out[length] = '\0';
+                 size = length + 1;
+                 break;
+             }
+             default:
+                 break;
+         }
          
-         log(LogLevel::INFO, "LogManager", "Log file rotated");
-         return true;
+         if (size > remaining) {
+             record.truncated = true;
+             break;
+         }
+         used += size;
      }
      
-     return false;
+     record.payloadLength = used;
  }
  
- String LogManager::formatLogEntry(const LogEntry& entry) {
-     // Get current timestamp
-     time_t now;
-     time(&now);
-     struct tm timeinfo;
-     localtime_r(&now, &timeinfo);
+ size_t LogManager::formatMessage(const LogRecord& record, char* buffer, size_t size) {
+     if (size == 0) {
+         return 0;
+     }
+     
+     size_t pos = 0;
+     
+     // Text records were stored finished
+     if (record.format == nullptr) {
+         pos = min(static_cast<size_t>(record.payloadLength), size - 1);
+         memcpy(buffer, record.payload, pos);
+         buffer[pos] = '\0';
+     } else {
+         size_t offset = 0;
+         const char* p = record.format;
+         
+         while (*p && pos < size - 1) {
+             if (*p != '%') {
+                 buffer[pos++] = *p++;
+                 continue;
+             }
+             if (p[1] == '%') {
+                 buffer[pos++] = '%';
+                 p += 2;
+                 continue;
+             }
+             
+             // Copy a single conversion spec and format it with its stored argument
+             const char* specStart = p;
+             const char* specEnd = p + 1;
+             LogArg type = parseConversion(specEnd);
+             if (type == LogArg::NONE || *specEnd == '\0') {
+                 break;
+             }
+             specEnd++;
+             
+             char spec[16];
+             size_t specLength = min(static_cast<size_t>(specEnd - specStart), sizeof(spec) - 1);
+             memcpy(spec, specStart, specLength);
+             spec[specLength] = '\0';
+             
+             const uint8_t* in = record.payload + offset;
+             size_t available = record.payloadLength - offset;
+             size_t room = size - pos;
+             int written = -1;
+             size_t consumed = 0;
+             
+             switch (type) {
+                 case LogArg::INT: { int v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::LONG: { long v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::LONG_LONG: { long long v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::SIZE: { size_t v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::DOUBLE: { double v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::POINTER: { void* v; consumed = sizeof(v); if (consumed <= available) { memcpy(&v, in, consumed); written = snprintf(buffer + pos, room, spec, v); } break; }
+                 case LogArg::STRING: {
+                     const char* v = reinterpret_cast<const char*>(in);
+                     consumed = strnlen(v, available) + 1;
+                     if (consumed <= available) {
+                         written = snprintf(buffer + pos, room, spec, v);
+                     }
+                     break;
+                 }
+                 default:
+                     break;
+             }
+             
+             // Argument was not captured, the payload was full
+             if (written < 0) {
+                 break;
+             }
+             
+             pos = min(pos + static_cast<size_t>(written), size - 1);
+             offset += consumed;
+             p = specEnd;
+         }
+         buffer[pos] = '\0';
+     }
+     
+     // Mark cut-off messages
+     if (record.truncated && pos + 3 < size) {
+         memcpy(buffer + pos, "...", 4);
+         pos += 3;
+     }
      
+     return pos;
+ }
+ 
+ size_t LogManager::formatLine(const LogRecord& record, char* buffer, size_t size) {
+     // Wall-clock time of the record, uptime until NTP has synced
      char timeStr[20];
-     strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+     if (record.time > 0) {
+         time_t when = record.time;
+         struct tm timeinfo;
+         localtime_r(&when, &timeinfo);
+         strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+     } else {
+         snprintf(timeStr, sizeof(timeStr), "+%lu.%03lus", 
+                  static_cast<unsigned long>(record.uptimeMs / 1000), 
+                  static_cast<unsigned long>(record.uptimeMs % 1000));
+     }
      
      // Format full log entry
-     String formattedEntry = String(timeStr) + " " + 
-                           getLogLevelString(entry.level) + " [" + 
-                           entry.module + "] " + 
-                           entry.message;
+     int prefix = snprintf(buffer, size, "%s %s [%s] ", timeStr, getLogLevelString(record.level), record.module);
+     if (prefix < 0 || static_cast<size_t>(prefix) >= size) {
+         return size - 1;
+     }
      
-     return formattedEntry;
+     return prefix + formatMessage(record, buffer + prefix, size - prefix);
  }
  
- String LogManager::getLogLevelString(LogLevel level) {
+ const char* LogManager::getLogLevelString(LogLevel level) {
      switch (level) {
          case LogLevel::DEBUG: return "DEBUG";
          case LogLevel::INFO:  return "INFO ";
@@ -313,42 +931,72 @@
      }
  }
  
+ void LogManager::updateLowestModuleLevel() {
+     // Caller must hold _logMutex
+     _lowestModuleLevel = LogLevel::ERROR;
+     for (uint8_t i = 0; i < _moduleLevelCount; i++) {
+         _lowestModuleLevel = min(_lowestModuleLevel, _moduleLevels[i].level);
+     }
+ }
+ 
  void LogManager::logProcessingTask(void* parameter) {
      LogManager* logManager = static_cast<LogManager*>(parameter);
      TickType_t lastFlushTime = xTaskGetTickCount();
-     
-     // Buffer to store log entries for batch processing
-     std::vector<LogEntry> logBuffer;
+     char line[Constants::LOG_LINE_SIZE];
+     LogRecord record;
      
      while (true) {
-         // Process any queued log entries
-         LogEntry entry;
-         while (xQueueReceive(logManager->_logQueue, &entry, 0) == pdPASS) {
-             logBuffer.push_back(entry);
-         }
+         TASK_LOOP_MARK();
          
-         // Write accumulated logs to file/server at flush interval
-         if (xTaskGetTickCount() - lastFlushTime >= pdMS_TO_TICKS(logManager->_flushInterval * 1000) ||
-             logBuffer.size() > 20) {  // Also flush if buffer gets large
+         // Print new records to serial (formatting happens here, not in the caller)
+         uint32_t newest = 0;
+         uint32_t oldest = 0;
+         if (xSemaphoreTake(logManager->_logMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+             newest = logManager->_ring.pushed();
+             oldest = newest - logManager->_ring.size();
              
-             if (xSemaphoreTake(logManager->_logMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                 for (const auto& entry : logBuffer) {
-                     logManager->writeToFile(entry);
-                     logManager->sendToRemoteServer(entry);
+             // Skip whatever was overwritten before we got to it
+             logManager->_printedSequence = max(logManager->_printedSequence, oldest);
+             logManager->_writtenSequence = max(logManager->_writtenSequence, oldest);
+             if (logManager->_sentSequence < oldest) {
+                 // The remote sink fell a full ring behind
+                 if (logManager->_remotePort != 0) {
+                     logManager->_remoteStats.dropped += oldest - logManager->_sentSequence;
                  }
-                 xSemaphoreGive(logManager->_logMutex);
-                 
-                 // Clear buffer after processing
-                 logBuffer.clear();
+                 logManager->_sentSequence = oldest;
+             }
+             
+             xSemaphoreGive(logManager->_logMutex);
+         }
+         
+         while (logManager->_printedSequence < newest) {
+             if (logManager->fetchRecord(logManager->_printedSequence, record)) {
+                 formatLine(record, line, sizeof(line));
+                 Serial.println(line);
+             }
+             logManager->_printedSequence++;
+         }
+         
+         // Move new records into the write block, which only reaches flash when
+         // it fills; the partial block is written and synced at the flush interval
+         bool flushDue = xTaskGetTickCount() - lastFlushTime >= pdMS_TO_TICKS(logManager->_flushInterval * 1000);
+         if (flushDue || logManager->_writtenSequence != newest) {
+             if (xSemaphoreTake(logManager->_fileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                 logManager->drainToFile(newest, flushDue);
+                 xSemaphoreGive(logManager->_fileMutex);
                  
                  // Update last flush time
-                 lastFlushTime = xTaskGetTickCount();
+                 if (flushDue) {
+                     lastFlushTime = xTaskGetTickCount();
+                 }
              }
          }
          
-         // Check for shutdown request
+         // Ship to the syslog server with its own cursor, so a dead server
+         // never holds up the file; sends are non-blocking UDP
+         logManager->sendToRemoteServer(newest);
          
          // Sleep to avoid hogging CPU
          vTaskDelay(pdMS_TO_TICKS(500));
      }
- }
\ No newline at end of file
+ }
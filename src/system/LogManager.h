@@ -13,12 +13,57 @@
  #include <freertos/semphr.h>
  #include <freertos/queue.h>
  #include <vector>
- #include <WiFiClient.h>
+ #include <stdarg.h>
+ #include <WiFiUdp.h>
+ #include <lwip/ip_addr.h>
  #include "../utils/Constants.h"
+ #include "../utils/RingBuffer.h"
+ 
+ // Lowest level compiled in (0 DEBUG, 1 INFO, 2 WARN, 3 ERROR, 4 none), set with -D LOG_COMPILE_LEVEL
+ #ifndef LOG_COMPILE_LEVEL
+ #define LOG_COMPILE_LEVEL 0
+ #endif
+ 
+ /**
+  * Logging macros. Levels below LOG_COMPILE_LEVEL compile to nothing; the rest
+  * check the module's runtime level before any argument is evaluated, so a
+  * disabled DEBUG line costs one table lookup. The format must be a literal.
+  */
+ #define LOG_AT(level, module, format, ...) \
+     do { \
+         LogManager* _logManager = getAppCore()->getLogManager(); \
+         if (_logManager->isEnabled(level, module)) { \
+             _logManager->logf(level, module, format, ##__VA_ARGS__); \
+         } \
+     } while (0)
+ 
+ #if LOG_COMPILE_LEVEL <= 0
+ #define LOG_DEBUG(module, format, ...) LOG_AT(LogLevel::DEBUG, module, format, ##__VA_ARGS__)
+ #else
+ #define LOG_DEBUG(module, format, ...) do {} while (0)
+ #endif
+ 
+ #if LOG_COMPILE_LEVEL <= 1
+ #define LOG_INFO(module, format, ...) LOG_AT(LogLevel::INFO, module, format, ##__VA_ARGS__)
+ #else
+ #define LOG_INFO(module, format, ...) do {} while (0)
+ #endif
+ 
+ #if LOG_COMPILE_LEVEL <= 2
+ #define LOG_WARN(module, format, ...) LOG_AT(LogLevel::WARN, module, format, ##__VA_ARGS__)
+ #else
+ #define LOG_WARN(module, format, ...) do {} while (0)
+ #endif
+ 
+ #if LOG_COMPILE_LEVEL <= 3
+ #define LOG_ERROR(module, format, ...) LOG_AT(LogLevel::ERROR, module, format, ##__VA_ARGS__)
+ #else
+ #define LOG_ERROR(module, format, ...) do {} while (0)
+ #endif
  
  /**
   * @struct LogEntry
-  * @brief Structure to hold a log entry
+  * @brief Structure to hold a formatted log entry
   */
  struct LogEntry {
      LogLevel level;
@@ -27,6 +72,37 @@
      uint32_t timestamp;
  };
  
+ /**
+  * @struct LogRecord
+  * @brief Fixed-size binary log record kept in the preallocated log ring
+  *
+  * logf() stores the format string pointer plus the raw argument bytes,
+  * log() stores the finished text. Either way nothing is formatted until the
+  * record is printed, written to file, sent remotely or served over the API.
+  */
+ struct LogRecord {
+     uint32_t sequence;
+     uint32_t uptimeMs;
+     uint32_t time;            // Unix seconds, 0 before NTP sync
+     const char* format;       // Literal format string, nullptr for text records
+     LogLevel level;
+     uint8_t payloadLength;
+     bool truncated;           // Arguments or text did not fit the payload
+     char module[Constants::LOG_MODULE_NAME_SIZE];
+     uint8_t payload[Constants::LOG_RECORD_PAYLOAD_SIZE];
+ };
+ 
+ /**
+  * @struct RemoteLogStats
+  * @brief Counters of the remote syslog sink
+  */
+ struct RemoteLogStats {
+     uint32_t sent;            // Records delivered to the network stack
+     uint32_t dropped;         // Records lost to ring overrun, send failures or the network being down
+     uint32_t datagrams;       // Datagrams sent
+     bool resolved;            // Server address is known
+ };
+ 
  /**
   * @class LogManager
   * @brief Manages system logging with support for different log levels and destinations
@@ -52,6 +128,18 @@
      
      void log(LogLevel level, const String& message);
      
+     /**
+      * @brief Log a printf-style message without formatting it or touching the heap
+      * @param level Log level
+      * @param module Module name
+      * @param format Format string, must be a literal (only the pointer is stored)
+      *
+      * Supports the d/i/u/x/X/o/c, f/e/g, s and p conversions with the h, l, ll
+      * and z length modifiers; `*` widths are not supported. String arguments
+      * are copied into the record.
+      */
+     void logf(LogLevel level, const char* module, const char* format, ...) __attribute__((format(printf, 4, 5)));
+     
      /**
       * @brief Set the log level
       * @param level Minimum log level to record
@@ -64,6 +152,41 @@
       */
      LogLevel getLogLevel();
      
+     /**
+      * @brief Override the log level for one module (e.g. DEBUG for "Sensors" only)
+      * @param module Module name as passed to log()
+      * @param level Minimum log level to record for this module
+      * @return True if set, false if the module table is full
+      */
+     bool setModuleLogLevel(const char* module, LogLevel level);
+     
+     /**
+      * @brief Remove a module override so the module follows the global level again
+      * @param module Module name
+      */
+     void clearModuleLogLevel(const char* module);
+     
+     /**
+      * @brief Get all module overrides
+      * @return Pairs of module name and level
+      */
+     std::vector<std::pair<String, LogLevel>> getModuleLogLevels();
+     
+     /**
+      * @brief Check whether a message would be recorded, before formatting it
+      * @param level Log level
+      * @param module Module name
+      * @return True if the module's level (or the global one) lets it through
+      */
+     bool isEnabled(LogLevel level, const char* module) const;
+     
+     /**
+      * @brief Time the formatting of a typical record into a log line
+      * @param rounds Number of lines to format
+      * @return Elapsed microseconds
+      */
+     static uint32_t benchmarkFormatting(uint16_t rounds);
+     
      /**
       * @brief Set the maximum log file size
       * @param sizeKB Maximum size in kilobytes
@@ -71,11 +194,23 @@
      void setMaxLogSize(size_t sizeKB);
      
      /**
-      * @brief Set the remote log server
-      * @param server Server address (IP:port)
+      * @brief Set the remote syslog server (RFC 5424 over UDP)
+      * @param server Server address (host or host:port, default port 514), empty to disable
       */
      void setRemoteLogServer(const String& server);
      
+     /**
+      * @brief Get the configured remote log server
+      * @return Server address as set, empty if disabled
+      */
+     String getRemoteLogServer();
+     
+     /**
+      * @brief Get the remote syslog sink counters
+      * @return Counters since boot
+      */
+     RemoteLogStats getRemoteLogStats() const;
+     
      /**
       * @brief Set the log flush interval
       * @param seconds Interval in seconds
@@ -94,6 +229,12 @@
       */
      void clearLogs();
      
+     /**
+      * @brief Write all pending records to the log file (e.g. before a reboot)
+      * @return True if the file is up to date
+      */
+     bool flush();
+     
      /**
       * @brief Create RTOS tasks for logging operations
       */
@@ -106,23 +247,61 @@
      String _remoteLogServer;
      uint32_t _flushInterval;
      
+     // Per-module overrides of _logLevel, looked up before formatting
+     struct ModuleLevel {
+         char name[Constants::LOG_MODULE_NAME_SIZE];
+         LogLevel level;
+     };
+     ModuleLevel _moduleLevels[Constants::LOG_MAX_MODULE_LEVELS];
+     volatile uint8_t _moduleLevelCount;
+     LogLevel _lowestModuleLevel;      // Fast path when no override is below the global level
+     
      // Internal state
      File _logFile;
-     std::vector<LogEntry> _memoryBuffer;
-     size_t _bufferMaxSize;
+     size_t _logFileSize;          // Bytes on flash, tracked to avoid size() calls
+     char _writeBlock[Constants::LOG_WRITE_BLOCK_SIZE];
+     size_t _writeBlockUsed;       // Bytes of _writeBlock waiting to be written
+     RingBuffer<LogRecord> _ring;
+     uint32_t _printedSequence;    // Next record to print to Serial
+     uint32_t _writtenSequence;    // Next record to write to the log file
+     uint32_t _sentSequence;       // Next record to send to the remote server
+     
+     // Remote syslog sink, the ring is its bounded send queue
+     char _remoteHost[Constants::LOG_SYSLOG_HOST_SIZE];
+     uint16_t _remotePort;
+     volatile uint32_t _remoteAddress;    // IPv4 in network order, 0 until resolved
+     volatile bool _remoteResolving;      // DNS lookup in flight
+     uint32_t _lastResolveMs;
+     WiFiUDP _remoteUdp;
+     char _datagram[Constants::LOG_SYSLOG_DATAGRAM_SIZE];
+     RemoteLogStats _remoteStats;
+     uint32_t _clearedSequence;    // First record shown after clearLogs()
      
      // RTOS resources
-     SemaphoreHandle_t _logMutex;
+     SemaphoreHandle_t _logMutex;      // Guards the record ring
+     SemaphoreHandle_t _fileMutex;     // Guards the log file
      TaskHandle_t _logTaskHandle;
-     QueueHandle_t _logQueue;
      
      // Private methods
      bool openLogFile();
-     void writeToFile(const LogEntry& entry);
-     void sendToRemoteServer(const LogEntry& entry);
+     void commit(LogRecord& record);
+     bool fetchRecord(uint32_t sequence, LogRecord& record);
+     void writeToFile(const LogRecord& record);
+     bool writeBlock(bool sync);
+     size_t blockSpace() const;
+     bool drainToFile(uint32_t newest, bool sync);
+     void sendToRemoteServer(uint32_t newest);
+     bool resolveRemoteServer();
+     static size_t formatSyslog(const LogRecord& record, char* buffer, size_t size);
+     static void remoteServerFound(const char* name, const ip_addr_t* address, void* arg);
      bool rotateLogFile();
-     String formatLogEntry(const LogEntry& entry);
-     String getLogLevelString(LogLevel level);
+     static void initRecord(LogRecord& record, LogLevel level, const char* module);
+     static void captureArgs(LogRecord& record, const char* format, va_list args);
+     static void fillRecord(LogRecord& record, const char* format, ...);
+     static size_t formatMessage(const LogRecord& record, char* buffer, size_t size);
+     static size_t formatLine(const LogRecord& record, char* buffer, size_t size);
+     static const char* getLogLevelString(LogLevel level);
+     void updateLowestModuleLevel();
      
      // Task function
      static void logProcessingTask(void* parameter);
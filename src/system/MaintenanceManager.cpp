@@ -6,18 +6,134 @@
  #include "MaintenanceManager.h"
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
+ #include "../system/LatencyMonitor.h"
  #include "../components/SensorManager.h"
  #include "../components/RelayManager.h"
+ #include "../components/ScheduleTimeline.h"
+ #include "../web/GraphStream.h"
+ #include "../utils/Helpers.h"
+ #include "../utils/RingBuffer.h"
+ #include "../ota/VersionManager.h"
+ #include <nvs.h>
  #include <esp_task_wdt.h>
+ #include <esp_system.h>
+ #include <esp_heap_caps.h>
  #include <ArduinoJson.h>
+ #include <mbedtls/sha256.h>
+ #include <mbedtls/gcm.h>
+ #include <vector>
+ #if HEAP_TRACKING_ENABLED && defined(CONFIG_HEAP_TASK_TRACKING)
+ #include <esp_heap_task_info.h>
+ #endif
  
+ namespace {
+     // Written by the failed-allocation hook, from whichever task allocated
+     volatile uint32_t allocFailureCount = 0;
+     volatile uint32_t lastFailedSize = 0;
+     volatile uint32_t lastFailedCaps = 0;
+     char lastFailedTask[configMAX_TASK_NAME_LEN] = "";
+     
+     // Plain C SHA-256 (FIPS 180-4), only the software baseline of the crypto benchmark
+     const uint32_t SHA256_K[64] = {
+         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+     };
+     
+     inline uint32_t rotr(uint32_t x, uint8_t n) {
+         return (x >> n) | (x << (32 - n));
+     }
+     
+     void softSha256Block(uint32_t state[8], const uint8_t* block) {
+         uint32_t w[64];
+         for (uint8_t i = 0; i < 16; i++) {
+             w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | 
+                    (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+         }
+         for (uint8_t i = 16; i < 64; i++) {
+             uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+             uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+             w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+         }
+         
+         uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+         uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+         for (uint8_t i = 0; i < 64; i++) {
+             uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+             uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+             h = g;
+             g = f;
+             f = e;
+             e = d + t1;
+             d = c;
+             c = b;
+             b = a;
+             a = t1 + t2;
+         }
+         
+         state[0] += a;
+         state[1] += b;
+         state[2] += c;
+         state[3] += d;
+         state[4] += e;
+         state[5] += f;
+         state[6] += g;
+         state[7] += h;
+     }
+     
+     void softSha256(const uint8_t* data, size_t length, uint8_t* digest) {
+         uint32_t state[8] = {
+             0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+         };
+         
+         size_t fullBlocks = length / 64;
+         for (size_t i = 0; i < fullBlocks; i++) {
+             softSha256Block(state, data + i * 64);
+         }
+         
+         // Padding: 0x80, zeros, then the bit length in the last 8 bytes
+         uint8_t tail[128] = {0};
+         size_t rest = length % 64;
+         memcpy(tail, data + fullBlocks * 64, rest);
+         tail[rest] = 0x80;
+         size_t tailLength = rest < 56 ? 64 : 128;
+         uint64_t bits = (uint64_t)length * 8;
+         for (uint8_t i = 0; i < 8; i++) {
+             tail[tailLength - 1 - i] = (uint8_t)(bits >> (8 * i));
+         }
+         softSha256Block(state, tail);
+         if (tailLength == 128) {
+             softSha256Block(state, tail + 64);
+         }
+         
+         for (uint8_t i = 0; i < 8; i++) {
+             digest[i * 4] = (uint8_t)(state[i] >> 24);
+             digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+             digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+             digest[i * 4 + 3] = (uint8_t)state[i];
+         }
+     }
+ }
+
  MaintenanceManager::MaintenanceManager() :
      _watchdogEnabled(false),
      _watchdogTimeout(30),
      _lastRebootCheck(0),
      _isInitialized(false),
+     _cryptoBenchmark{},
+     _lastHeapSample(0),
+ #if TASK_STATS_ENABLED
+     _loopStats{},
+     _runTimeSamples{},
+     _lastTotalRunTime(0),
+ #endif
      _maintenanceMutex(nullptr),
-     _maintenanceTaskHandle(nullptr)
+     _benchmarkTaskHandle(nullptr)
  {
  }
  
@@ -27,10 +143,6 @@
          vSemaphoreDelete(_maintenanceMutex);
      }
      
-     if (_maintenanceTaskHandle != nullptr) {
-         vTaskDelete(_maintenanceTaskHandle);
-     }
-     
      // Disable watchdog if it was enabled
      if (_watchdogEnabled) {
          esp_task_wdt_deinit();
@@ -45,31 +157,48 @@
          return false;
      }
      
-     // Load reboot schedule from NVS if available
-     nvs_handle_t nvsHandle;
-     esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
-     if (err == ESP_OK) {
-         uint8_t enabled;
-         if (nvs_get_u8(nvsHandle, "reboot_enabled", &enabled) == ESP_OK) {
-             _rebootSchedule.enabled = (enabled == 1);
-         }
-         
-         uint8_t day, hour, minute;
-         if (nvs_get_u8(nvsHandle, "reboot_day", &day) == ESP_OK) {
-             _rebootSchedule.dayOfWeek = day;
-         }
-         
-         if (nvs_get_u8(nvsHandle, "reboot_hour", &hour) == ESP_OK) {
-             _rebootSchedule.hour = hour;
+     // Load the reboot schedule block; older firmware kept one key per field
+     StorageManager* storageManager = getAppCore()->getStorageManager();
+     if (!storageManager->getSettings(SettingsBlock::MAINTENANCE, _rebootSchedule)) {
+         nvs_handle_t nvsHandle;
+         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
+         if (err == ESP_OK) {
+             uint8_t enabled;
+             if (nvs_get_u8(nvsHandle, "reboot_enabled", &enabled) == ESP_OK) {
+                 _rebootSchedule.enabled = (enabled == 1);
+             }
+             
+             uint8_t day, hour, minute;
+             if (nvs_get_u8(nvsHandle, "reboot_day", &day) == ESP_OK) {
+                 _rebootSchedule.dayOfWeek = day;
+             }
+             
+             if (nvs_get_u8(nvsHandle, "reboot_hour", &hour) == ESP_OK) {
+                 _rebootSchedule.hour = hour;
+             }
+             
+             if (nvs_get_u8(nvsHandle, "reboot_minute", &minute) == ESP_OK) {
+                 _rebootSchedule.minute = minute;
+             }
+             
+             nvs_close(nvsHandle);
          }
          
-         if (nvs_get_u8(nvsHandle, "reboot_minute", &minute) == ESP_OK) {
-             _rebootSchedule.minute = minute;
+         // Move them into the block once it is safely written
+         static const char* const LEGACY_KEYS[] = {"reboot_enabled", "reboot_day", "reboot_hour", "reboot_minute"};
+         storageManager->putSettings(SettingsBlock::MAINTENANCE, _rebootSchedule);
+         if (storageManager->saveSettings()) {
+             storageManager->eraseLegacyKeys(LEGACY_KEYS, sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]));
          }
-         
-         nvs_close(nvsHandle);
      }
      
+     // Once per boot, the diagnostics report the cached result
+     runCryptoBenchmark();
+     
+     // Heap trend for the diagnostics, and a record of allocations that failed
+     _heapHistory.reset(Constants::HEAP_HISTORY_SAMPLES);
+     heap_caps_register_failed_alloc_callback(allocFailedHook);
+     
      _isInitialized = true;
      
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Maintenance", 
@@ -79,7 +208,8 @@
  }
  
  String MaintenanceManager::runDiagnostics(bool fullTest) {
-     DynamicJsonDocument doc(2048);
+     // Room for the latency summaries of every probe slot
+     DynamicJsonDocument doc(6144);
      
      // Basic diagnostics - always run
      doc["wifi"] = testWiFi();
@@ -94,6 +224,19 @@
      sysInfo["uptime_seconds"] = millis() / 1000;
      sysInfo["cpu_freq_mhz"] = ESP.getCpuFreqMHz();
      
+     // Crypto accelerator timings measured at boot
+     if (_cryptoBenchmark.valid) {
+         JsonObject crypto = doc.createNestedObject("crypto");
+         crypto["bytes"] = _cryptoBenchmark.bytes;
+         crypto["sha256_hw_us"] = _cryptoBenchmark.sha256HardwareUs;
+         crypto["sha256_sw_us"] = _cryptoBenchmark.sha256SoftwareUs;
+         crypto["sha256_match"] = _cryptoBenchmark.digestsMatch;
+         crypto["aes_gcm_hw_us"] = _cryptoBenchmark.aesGcmHardwareUs;
+     }
+     
+     // Hot path latencies since boot
+     LatencyMonitor::fillJson(doc.createNestedObject("latency"));
+     
      // Full diagnostics - more comprehensive tests
      if (fullTest) {
          // Additional tests could be added here
@@ -190,6 +333,7 @@
      size_t heapSize = ESP.getHeapSize();
      size_t freeHeap = ESP.getFreeHeap();
      size_t minFreeHeap = ESP.getMinFreeHeap();
+     size_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
      
      // Calculate memory health (0-100%)
      uint8_t memoryHealth = (uint8_t)((float)freeHeap / (float)heapSize * 100.0f);
@@ -228,6 +372,8 @@
      doc["uptime_seconds"] = uptime;
      doc["free_heap"] = freeHeap;
      doc["min_free_heap"] = minFreeHeap;
+     doc["largest_free_block"] = largestBlock;
+     doc["fragmentation_percent"] = freeHeap > 0 ? 100 - (largestBlock * 100) / freeHeap : 0;
      doc["status"] = systemHealth > 70 ? "good" : (systemHealth > 40 ? "fair" : "poor");
      
      String result;
@@ -249,17 +395,8 @@
          _rebootSchedule.hour = hour;
          _rebootSchedule.minute = minute;
          
-         // Save to NVS
-         nvs_handle_t nvsHandle;
-         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle);
-         if (err == ESP_OK) {
-             nvs_set_u8(nvsHandle, "reboot_enabled", enabled ? 1 : 0);
-             nvs_set_u8(nvsHandle, "reboot_day", dayOfWeek);
-             nvs_set_u8(nvsHandle, "reboot_hour", hour);
-             nvs_set_u8(nvsHandle, "reboot_minute", minute);
-             nvs_commit(nvsHandle);
-             nvs_close(nvsHandle);
-         }
+         // Committed with the next settings save
+         getAppCore()->getStorageManager()->putSettings(SettingsBlock::MAINTENANCE, _rebootSchedule);
          
          getAppCore()->getLogManager()->log(LogLevel::INFO, "Maintenance", 
              "Reboot schedule " + String(enabled ? "enabled" : "disabled") + 
@@ -390,24 +527,310 @@
      }
  }
  
- void MaintenanceManager::createTasks() {
-     // Create maintenance task
-     BaseType_t result = xTaskCreatePinnedToCore(
-         maintenanceTask,             // Task function
-         "MaintenanceTask",           // Task name
-         2048,                        // Stack size (words)
-         this,                        // Task parameters
-         1,                           // Priority (low)
-         &_maintenanceTaskHandle,     // Task handle
-         0                            // Core ID (0 - protocol core)
-     );
-     
-     if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Maintenance", 
-             "Failed to create maintenance task");
+ void MaintenanceManager::runCryptoBenchmark() {
+     const size_t size = Constants::CRYPTO_BENCH_BYTES;
+     uint8_t* buffer = new uint8_t[size * 2];
+     uint8_t* output = buffer + size;
+     esp_fill_random(buffer, size);
+     
+     uint8_t hardwareDigest[32];
+     uint8_t softwareDigest[32];
+     
+     // SHA-256 through mbedTLS, which the core backs with the SHA peripheral
+     uint32_t start = micros();
+     for (uint8_t i = 0; i < Constants::CRYPTO_BENCH_ROUNDS; i++) {
+         mbedtls_sha256_ret(buffer, size, hardwareDigest, 0);
+     }
+     _cryptoBenchmark.sha256HardwareUs = micros() - start;
+     
+     start = micros();
+     for (uint8_t i = 0; i < Constants::CRYPTO_BENCH_ROUNDS; i++) {
+         softSha256(buffer, size, softwareDigest);
+     }
+     _cryptoBenchmark.sha256SoftwareUs = micros() - start;
+     
+     // AES-256-GCM as used by SecurityManager::encrypt
+     uint8_t key[32];
+     uint8_t iv[Constants::CRYPTO_GCM_IV_SIZE];
+     uint8_t tag[Constants::CRYPTO_GCM_TAG_SIZE];
+     esp_fill_random(key, sizeof(key));
+     esp_fill_random(iv, sizeof(iv));
+     
+     mbedtls_gcm_context ctx;
+     mbedtls_gcm_init(&ctx);
+     int ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, 256);
+     start = micros();
+     for (uint8_t i = 0; i < Constants::CRYPTO_BENCH_ROUNDS && ret == 0; i++) {
+         ret = mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, size, iv, sizeof(iv), nullptr, 0, 
+                                         buffer, output, sizeof(tag), tag);
+     }
+     _cryptoBenchmark.aesGcmHardwareUs = micros() - start;
+     mbedtls_gcm_free(&ctx);
+     
+     _cryptoBenchmark.bytes = size * Constants::CRYPTO_BENCH_ROUNDS;
+     _cryptoBenchmark.digestsMatch = memcmp(hardwareDigest, softwareDigest, sizeof(hardwareDigest)) == 0;
+     _cryptoBenchmark.valid = ret == 0;
+     
+     delete[] buffer;
+     
+     LOG_INFO("Maintenance", "Crypto benchmark over %lu bytes: SHA-256 hardware %lu us, software %lu us, AES-256-GCM %lu us", 
+              static_cast<unsigned long>(_cryptoBenchmark.bytes), 
+              static_cast<unsigned long>(_cryptoBenchmark.sha256HardwareUs), 
+              static_cast<unsigned long>(_cryptoBenchmark.sha256SoftwareUs), 
+              static_cast<unsigned long>(_cryptoBenchmark.aesGcmHardwareUs));
+     if (!_cryptoBenchmark.digestsMatch) {
+         LOG_ERROR("Maintenance", "Hardware and software SHA-256 digests differ");
+     }
+     if (ret != 0) {
+         LOG_ERROR("Maintenance", "AES-GCM benchmark failed (%d)", ret);
+     }
+ }
+ 
+ bool MaintenanceManager::startBenchmark() {
+     bool started = false;
+     
+     // Take mutex so two requests cannot both start a run
+     if (xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (_benchmarkTaskHandle == nullptr) {
+             started = xTaskCreatePinnedToCore(
+                 benchmarkTask,                     // Task function
+                 "BenchmarkTask",                   // Task name
+                 Constants::STACK_SIZE_BENCHMARK,   // Stack size (words)
+                 this,                              // Task parameters
+                 Constants::PRIORITY_BENCHMARK,     // Priority (low)
+                 &_benchmarkTaskHandle,             // Task handle
+                 1                                  // Core ID (1 - application core)
+             ) == pdPASS;
+             
+             if (!started) {
+                 _benchmarkTaskHandle = nullptr;
+                 LOG_ERROR("Maintenance", "Failed to create benchmark task");
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
+     }
+     
+     return started;
+ }
+ 
+ String MaintenanceManager::getBenchmarkResults() {
+     String runs = getAppCore()->getStorageManager()->readFile(Constants::BENCH_RESULTS_FILE);
+     return runs.isEmpty() ? String("[]") : runs;
+ }
+ 
+ void MaintenanceManager::benchmarkTask(void* parameter) {
+     MaintenanceManager* maintenanceManager = static_cast<MaintenanceManager*>(parameter);
+     LOG_INFO("Maintenance", "Benchmark started");
+     
+     // One run, tagged with the build so results can be compared across tents
+     VersionManager versionManager;
+     DynamicJsonDocument run(1536);
+     run["version"] = versionManager.getCurrentVersion();
+     run["build_timestamp"] = versionManager.getVersionTimestamp();
+     run["device"] = WiFi.getHostname();
+     run["time"] = static_cast<uint32_t>(time(nullptr));
+     run["cpu_freq_mhz"] = ESP.getCpuFreqMHz();
+     
+     size_t graphPoints = 0;
+     maintenanceManager->runCodeBenchmarks(run.createNestedObject("ns_per_op"), graphPoints);
+     run["graph_points"] = graphPoints;
+     maintenanceManager->runHardwareBenchmarks(run.createNestedObject("hardware"));
+     
+     maintenanceManager->storeBenchmark(run);
+     LOG_INFO("Maintenance", "Benchmark finished");
+     
+     maintenanceManager->_benchmarkTaskHandle = nullptr;
+     vTaskDelete(nullptr);
+ }
+ 
+ void MaintenanceManager::runCodeBenchmarks(JsonObject nsPerOp, size_t& graphPoints) {
+     BenchmarkResult results[6];
+     uint8_t count = 0;
+     auto add = [&](const char* name, uint32_t ops, int64_t elapsedUs) {
+         results[count++] = {name, ops, ops > 0 ? static_cast<uint32_t>(elapsedUs * 1000 / ops) : 0};
+     };
+     int64_t start;
+     
+     // Graph serialization per point, over whatever the history holds
+     uint8_t chunk[512];
+     GraphQuery query = {};
+     if (getAppCore()->getSensorManager()->prepareGraphQuery(0, Constants::BENCH_GRAPH_POINTS, 0, query)) {
+         const GraphStream::Format formats[] = {GraphStream::Format::JSON, GraphStream::Format::BINARY};
+         const char* names[] = {"graph_json_point", "graph_binary_point"};
+         for (uint8_t f = 0; f < 2; f++) {
+             start = esp_timer_get_time();
+             for (uint8_t i = 0; i < Constants::BENCH_GRAPH_ROUNDS; i++) {
+                 GraphStream stream(query, formats[f]);
+                 while (stream.fill(chunk, sizeof(chunk)) > 0) {
+                 }
+             }
+             add(names[f], query.pointCount * Constants::BENCH_GRAPH_ROUNDS, esp_timer_get_time() - start);
+         }
+     }
+     
+     // Schedule evaluation, minute by minute through a day of 8 windows
+     ScheduleTimeline timeline;
+     TimeRange windows[8];
+     for (uint8_t i = 0; i < 8; i++) {
+         windows[i] = TimeRange(i * 3, 15, (i * 3 + 14) % 24, 45);
+     }
+     timeline.build(windows, 8, CycleConfig(5, 60));
+     time_t base = time(nullptr);
+     start = esp_timer_get_time();
+     for (uint16_t i = 0; i < Constants::BENCH_SCHEDULE_ROUNDS; i++) {
+         timeline.update(base + i * 60);
+     }
+     add("schedule_update", Constants::BENCH_SCHEDULE_ROUNDS, esp_timer_get_time() - start);
+     
+     // Log line formatting
+     add("log_format", Constants::BENCH_LOG_ROUNDS, LogManager::benchmarkFormatting(Constants::BENCH_LOG_ROUNDS));
+     
+     // History buffer pushes
+     RingBuffer<SensorReading> history(256);
+     SensorReading reading = {};
+     start = esp_timer_get_time();
+     for (uint16_t i = 0; i < Constants::BENCH_RING_ROUNDS; i++) {
+         reading.timestamp = i;
+         history.push(reading);
+     }
+     add("history_push", Constants::BENCH_RING_ROUNDS, esp_timer_get_time() - start);
+     
+     // Helpers string utilities, heap allocations included
+     size_t length = 0;
+     start = esp_timer_get_time();
+     for (uint16_t i = 0; i < Constants::BENCH_HELPER_ROUNDS; i++) {
+         length += Helpers::formatDuration(static_cast<uint64_t>(i) * 3723000ULL).length();
+     }
+     add("helpers_format_duration", length > 0 ? Constants::BENCH_HELPER_ROUNDS : 0, esp_timer_get_time() - start);
+     
+     graphPoints = query.pointCount;
+     for (uint8_t i = 0; i < count; i++) {
+         nsPerOp[results[i].name] = results[i].nsPerOp;
      }
  }
  
+ void MaintenanceManager::runHardwareBenchmarks(JsonObject hardware) {
+     auto kbPerSecond = [](size_t bytes, int64_t elapsedUs) -> uint32_t {
+         return elapsedUs > 0 ? static_cast<uint32_t>(static_cast<int64_t>(bytes) * 1000000 / elapsedUs / 1024) : 0;
+     };
+     int64_t start;
+     
+     // SPIFFS sequential write and read of a temporary file, skipped when space is short
+     StorageManager* storage = getAppCore()->getStorageManager();
+     if (storage->getFilesystemStats().freeBytes > Constants::BENCH_SPIFFS_BYTES * 2) {
+         uint8_t buffer[Constants::FILE_CHUNK_SIZE];
+         esp_fill_random(buffer, sizeof(buffer));
+         
+         File file = storage->openFile(Constants::BENCH_TEMP_FILE, FILE_WRITE);
+         if (file) {
+             size_t written = 0;
+             start = esp_timer_get_time();
+             while (written < Constants::BENCH_SPIFFS_BYTES && file.write(buffer, sizeof(buffer)) == sizeof(buffer)) {
+                 written += sizeof(buffer);
+             }
+             file.close();
+             hardware["spiffs_write_kbps"] = kbPerSecond(written, esp_timer_get_time() - start);
+         }
+         
+         file = storage->openFile(Constants::BENCH_TEMP_FILE, FILE_READ);
+         if (file) {
+             size_t read = 0;
+             int chunk;
+             start = esp_timer_get_time();
+             while ((chunk = file.read(buffer, sizeof(buffer))) > 0) {
+                 read += chunk;
+             }
+             file.close();
+             hardware["spiffs_read_kbps"] = kbPerSecond(read, esp_timer_get_time() - start);
+         }
+         
+         storage->deleteFile(Constants::BENCH_TEMP_FILE);
+     }
+     
+     // NVS set and commit of one small value
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle) == ESP_OK) {
+         int64_t total = 0;
+         uint8_t rounds = 0;
+         for (uint8_t i = 0; i < Constants::BENCH_NVS_ROUNDS; i++) {
+             start = esp_timer_get_time();
+             if (nvs_set_u32(nvsHandle, "bench_seq", i) == ESP_OK && nvs_commit(nvsHandle) == ESP_OK) {
+                 total += esp_timer_get_time() - start;
+                 rounds++;
+             }
+         }
+         
+         // Leave no benchmark key behind in the config namespace
+         nvs_erase_key(nvsHandle, "bench_seq");
+         nvs_commit(nvsHandle);
+         nvs_close(nvsHandle);
+         if (rounds > 0) {
+             hardware["nvs_commit_us"] = static_cast<uint32_t>(total / rounds);
+         }
+     }
+     
+     // Sensor transactions, 0 for a sensor that did not answer
+     uint32_t dhtUs = 0;
+     uint32_t scdUs = 0;
+     getAppCore()->getSensorManager()->benchmarkSensors(dhtUs, scdUs);
+     hardware["dht_read_us"] = dhtUs;
+     hardware["scd40_read_us"] = scdUs;
+     
+     // TCP round trip to the broker, 0 without one
+     hardware["broker_rtt_us"] = getAppCore()->getMQTTClient()->measureBrokerRtt();
+     
+     // JSON serialize rate on a document shaped like the sensor payload
+     DynamicJsonDocument doc(512);
+     const char* sensors[] = {"upper_dht", "lower_dht", "scd40"};
+     for (uint8_t i = 0; i < 3; i++) {
+         JsonObject sensor = doc.createNestedObject(sensors[i]);
+         sensor["temperature"] = 23.4f + i;
+         sensor["humidity"] = 81.5f - i;
+         sensor["valid"] = true;
+     }
+     doc["scd40"]["co2"] = 1250;
+     doc["time"] = 1760000000UL;
+     
+     char json[256];
+     size_t bytes = 0;
+     start = esp_timer_get_time();
+     for (uint16_t i = 0; i < Constants::BENCH_JSON_ROUNDS; i++) {
+         bytes += serializeJson(doc, json, sizeof(json));
+     }
+     hardware["json_serialize_kbps"] = kbPerSecond(bytes, esp_timer_get_time() - start);
+ }
+ 
+ void MaintenanceManager::storeBenchmark(const JsonDocument& run) {
+     StorageManager* storage = getAppCore()->getStorageManager();
+     
+     DynamicJsonDocument history(Constants::BENCH_HISTORY_RUNS * 1536);
+     if (deserializeJson(history, storage->readFile(Constants::BENCH_RESULTS_FILE)) != DeserializationError::Ok || 
+         !history.is<JsonArray>()) {
+         history.to<JsonArray>();
+     }
+     
+     // Keep the newest runs only
+     JsonArray runs = history.as<JsonArray>();
+     while (runs.size() >= Constants::BENCH_HISTORY_RUNS) {
+         runs.remove(0);
+     }
+     runs.add(run.as<JsonObjectConst>());
+     
+     String content;
+     serializeJson(history, content);
+     if (!storage->writeFile(Constants::BENCH_RESULTS_FILE, content)) {
+         LOG_ERROR("Maintenance", "Failed to store benchmark results");
+     }
+ }
+ 
+ 
+ void MaintenanceManager::createTasks() {
+     // Initial delay to allow system to stabilize
+     getAppCore()->getJobScheduler()->addJob("maintenance", maintenanceJob, this, 30000);
+ }
+ 
  bool MaintenanceManager::testWiFi() {
      if (WiFi.status() != WL_CONNECTED) {
          return false;
@@ -504,31 +927,265 @@
      return (err == ESP_OK && testValue == 12345);
  }
  
- void MaintenanceManager::maintenanceTask(void* parameter) {
-     MaintenanceManager* maintenanceManager = static_cast<MaintenanceManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
+ void MaintenanceManager::markTaskLoop() {
+ #if TASK_STATS_ENABLED
+     TaskHandle_t task = xTaskGetCurrentTaskHandle();
+     uint32_t now = millis();
      
-     // Initial delay to allow system to stabilize
-     vTaskDelay(pdMS_TO_TICKS(30000));  // 30 seconds
+     // A claimed slot is only written by its own task
+     for (auto& slot : _loopStats) {
+         if (slot.handle == task) {
+             uint32_t period = now - slot.lastLoopMs;
+             slot.lastLoopMs = now;
+             slot.periodMs = (slot.periodMs == 0) ? period : (slot.periodMs * 7 + period) / 8;
+             slot.maxPeriodMs = max(slot.maxPeriodMs, period);
+             return;
+         }
+     }
      
-     while (true) {
-         // Feed watchdog if enabled
-         maintenanceManager->feedWatchdog();
+     // First pass of this task, claim a free slot (tasks may start before begin())
+     if (_maintenanceMutex != nullptr && xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (auto& slot : _loopStats) {
+             if (slot.handle == nullptr) {
+                 slot.lastLoopMs = now;
+                 slot.periodMs = 0;
+                 slot.maxPeriodMs = 0;
+                 slot.handle = task;
+                 break;
+             }
+         }
          
-         // Check for scheduled reboot
-         if (maintenanceManager->checkScheduledReboot()) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Maintenance", 
-                 "Executing scheduled reboot...");
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
+     }
+ #endif
+ }
+ 
+ String MaintenanceManager::getTaskStatsJson() {
+ #if TASK_STATS_ENABLED
+     static const char* const STATE_NAMES[] = {"running", "ready", "blocked", "suspended", "deleted", "invalid"};
+     
+     UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+     std::vector<TaskStatus_t> tasks(capacity);
+     UBaseType_t count = uxTaskGetSystemState(tasks.data(), capacity, nullptr);
+     
+     DynamicJsonDocument doc(6144);
+     doc["run_time_stats"] = configGENERATE_RUN_TIME_STATS != 0;
+     JsonArray tasksArray = doc.createNestedArray("tasks");
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (UBaseType_t i = 0; i < count; i++) {
+             const TaskStatus_t& task = tasks[i];
+             JsonObject taskObj = tasksArray.createNestedObject();
+             taskObj["name"] = task.pcTaskName;
+             
+             BaseType_t affinity = xTaskGetAffinity(task.xHandle);
+             taskObj["core"] = (affinity == tskNO_AFFINITY) ? -1 : static_cast<int>(affinity);
+             taskObj["priority"] = task.uxCurrentPriority;
+             taskObj["state"] = STATE_NAMES[min(static_cast<int>(task.eCurrentState), 5)];
+             taskObj["stack_free_min"] = task.usStackHighWaterMark;   // Bytes, ESP-IDF stacks are byte-sized
+             
+             for (const auto& sample : _runTimeSamples) {
+                 if (sample.handle == task.xHandle) {
+                     taskObj["cpu_percent"] = sample.cpuPercent;
+                     break;
+                 }
+             }
              
-             // Perform reboot
-             vTaskDelay(pdMS_TO_TICKS(1000));  // Give time for log to be saved
-             getAppCore()->reboot();
+             for (const auto& slot : _loopStats) {
+                 if (slot.handle == task.xHandle) {
+                     taskObj["loop_period_ms"] = slot.periodMs;
+                     taskObj["max_loop_period_ms"] = slot.maxPeriodMs;
+                     break;
+                 }
+             }
          }
          
-         // Perform periodic maintenance checks
-         // This could include monitoring system health, checking for updates, etc.
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
+     }
+     
+     String result;
+     serializeJson(doc, result);
+     return result;
+ #else
+     return "";
+ #endif
+ }
+ 
+ void MaintenanceManager::sampleTaskRunTime() {
+ #if TASK_STATS_ENABLED && configGENERATE_RUN_TIME_STATS
+     UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+     std::vector<TaskStatus_t> tasks(capacity);
+     uint32_t totalRunTime = 0;
+     UBaseType_t count = uxTaskGetSystemState(tasks.data(), capacity, &totalRunTime);
+     count = min(count, static_cast<UBaseType_t>(Constants::TASK_STATS_MAX_TASKS));
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t elapsed = totalRunTime - _lastTotalRunTime;
+         std::vector<TaskRunTimeSample> samples(count);
+         
+         // Tasks already seen at the previous sample get their share of the interval
+         for (UBaseType_t i = 0; i < count; i++) {
+             samples[i] = {tasks[i].xHandle, tasks[i].ulRunTimeCounter, 0.0f};
+             for (const auto& previous : _runTimeSamples) {
+                 if (previous.handle == tasks[i].xHandle && _lastTotalRunTime > 0 && elapsed > 0) {
+                     samples[i].cpuPercent = 100.0f * (tasks[i].ulRunTimeCounter - previous.runTime) / elapsed;
+                     break;
+                 }
+             }
+         }
+         
+         for (uint8_t i = 0; i < Constants::TASK_STATS_MAX_TASKS; i++) {
+             _runTimeSamples[i] = (i < count) ? samples[i] : TaskRunTimeSample{};
+         }
+         _lastTotalRunTime = totalRunTime;
          
-         // Sleep until next maintenance period (every minute)
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(60000));
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
      }
+ #endif
+ }
+ 
+ HeapSample MaintenanceManager::sampleHeap() {
+     HeapSample sample;
+     sample.uptimeSeconds = millis() / 1000;
+     sample.freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+     sample.largestInternal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+     sample.minFreeInternal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+     sample.freeDma = heap_caps_get_free_size(MALLOC_CAP_DMA);
+     sample.largestDma = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         uint32_t now = millis();
+         if (_heapHistory.empty() || now - _lastHeapSample >= Constants::HEAP_SAMPLE_INTERVAL_MS) {
+             _heapHistory.push(sample);
+             _lastHeapSample = now;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
+     }
+     
+     return sample;
+ }
+ 
+ void MaintenanceManager::printHeapJson(Print& out) {
+     HeapSample current = sampleHeap();
+     uint32_t fragmentation = current.freeInternal > 0 ? 
+         100 - (current.largestInternal * 100) / current.freeInternal : 0;
+     
+     out.printf("{\"uptime_seconds\":%lu,\"current\":{\"free_internal\":%lu,\"largest_internal\":%lu,"
+                "\"min_free_internal\":%lu,\"free_dma\":%lu,\"largest_dma\":%lu,\"fragmentation_percent\":%lu}",
+                static_cast<unsigned long>(current.uptimeSeconds), 
+                static_cast<unsigned long>(current.freeInternal), 
+                static_cast<unsigned long>(current.largestInternal), 
+                static_cast<unsigned long>(current.minFreeInternal), 
+                static_cast<unsigned long>(current.freeDma), 
+                static_cast<unsigned long>(current.largestDma), 
+                static_cast<unsigned long>(fragmentation));
+     
+     out.printf(",\"alloc_failures\":{\"count\":%lu,\"last_size\":%lu,\"last_caps\":%lu,\"last_task\":\"%s\"}",
+                static_cast<unsigned long>(allocFailureCount), 
+                static_cast<unsigned long>(lastFailedSize), 
+                static_cast<unsigned long>(lastFailedCaps), 
+                lastFailedTask);
+     
+     // History as rows of [uptime, free, largest, min free, DMA free, DMA largest], oldest first
+     out.printf(",\"sample_interval_seconds\":%lu,\"samples\":[", 
+                static_cast<unsigned long>(Constants::HEAP_SAMPLE_INTERVAL_MS / 1000));
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_maintenanceMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (size_t i = 0; i < _heapHistory.size(); i++) {
+             const HeapSample& sample = _heapHistory[i];
+             out.printf("%s[%lu,%lu,%lu,%lu,%lu,%lu]", i > 0 ? "," : "", 
+                        static_cast<unsigned long>(sample.uptimeSeconds), 
+                        static_cast<unsigned long>(sample.freeInternal), 
+                        static_cast<unsigned long>(sample.largestInternal), 
+                        static_cast<unsigned long>(sample.minFreeInternal), 
+                        static_cast<unsigned long>(sample.freeDma), 
+                        static_cast<unsigned long>(sample.largestDma));
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_maintenanceMutex);
+     }
+     out.print("]");
+     
+ #if HEAP_TRACKING_ENABLED && defined(CONFIG_HEAP_TASK_TRACKING)
+     // Bytes each task currently holds; the managers mostly allocate from
+     // their own task, web handlers from async_tcp
+     std::vector<heap_task_totals_t> totals(Constants::HEAP_TRACKING_MAX_TASKS);
+     size_t totalCount = 0;
+     heap_task_info_params_t params = {};
+     params.caps[0] = MALLOC_CAP_INTERNAL;
+     params.mask[0] = MALLOC_CAP_INTERNAL;
+     params.caps[1] = MALLOC_CAP_DMA;
+     params.mask[1] = MALLOC_CAP_DMA;
+     params.totals = totals.data();
+     params.num_totals = &totalCount;
+     params.max_totals = totals.size();
+     heap_caps_get_per_task_info(&params);
+     
+     out.print(",\"tasks\":[");
+     for (size_t i = 0; i < totalCount; i++) {
+         const heap_task_totals_t& task = totals[i];
+         out.printf("%s{\"task\":\"%s\",\"internal\":%u,\"internal_blocks\":%u,\"dma\":%u}", i > 0 ? "," : "", 
+                    task.task != nullptr ? pcTaskGetTaskName(task.task) : "startup", 
+                    static_cast<unsigned>(task.size[0]), 
+                    static_cast<unsigned>(task.count[0]), 
+                    static_cast<unsigned>(task.size[1]));
+     }
+     out.print("]");
+ #endif
+     
+     out.print("}");
+ }
+ 
+ void MaintenanceManager::allocFailedHook(size_t size, uint32_t caps, const char* functionName) {
+     // Runs inside the failing allocation, so only record it
+     allocFailureCount++;
+     lastFailedSize = size;
+     lastFailedCaps = caps;
+     TaskHandle_t task = xTaskGetCurrentTaskHandle();
+     strncpy(lastFailedTask, task != nullptr ? pcTaskGetTaskName(task) : "startup", sizeof(lastFailedTask) - 1);
+ }
+ 
+ uint32_t MaintenanceManager::maintenanceJob(void* context) {
+     MaintenanceManager* maintenanceManager = static_cast<MaintenanceManager*>(context);
+     
+     // Feed watchdog if enabled
+     maintenanceManager->feedWatchdog();
+     
+     // Check for scheduled reboot
+     if (maintenanceManager->checkScheduledReboot()) {
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "Maintenance", 
+             "Executing scheduled reboot...");
+         
+         // Perform reboot
+         vTaskDelay(pdMS_TO_TICKS(1000));  // Give time for log to be saved
+         getAppCore()->reboot();
+     }
+     
+     // Perform periodic maintenance checks
+     // This could include monitoring system health, checking for updates, etc.
+     
+     // Switch to the next grow phase when its time has come
+     getAppCore()->getGrowPhaseScheduler()->update();
+     
+     // Commit settings blocks changed outside of an API save
+     getAppCore()->getStorageManager()->saveSettings();
+     
+     // Per-task CPU share over the last minute
+     maintenanceManager->sampleTaskRunTime();
+     
+     // Heap trend, the history keeps one sample per interval
+     maintenanceManager->sampleHeap();
+     
+     // Next maintenance period (every minute)
+     return 60000;
  }
\ No newline at end of file
@@ -10,16 +10,96 @@
  #include <freertos/FreeRTOS.h>
  #include <freertos/task.h>
  #include <freertos/semphr.h>
+ #include <ArduinoJson.h>
  #include "../utils/Constants.h"
+ #include "../utils/RingBuffer.h"
+ 
+ // Heap use per task in /api/maintenance/heap, set with -D HEAP_TRACKING_ENABLED=1.
+ // Needs a framework built with CONFIG_HEAP_TASK_TRACKING
+ #ifndef HEAP_TRACKING_ENABLED
+ #define HEAP_TRACKING_ENABLED 0
+ #endif
+ 
+ // Per-task loop periods and CPU time for /api/maintenance/tasks, set with -D TASK_STATS_ENABLED=1.
+ // CPU time also needs a framework built with CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+ #ifndef TASK_STATS_ENABLED
+ #define TASK_STATS_ENABLED 0
+ #endif
+ 
+ // Marks one pass of the calling task's loop, nothing unless TASK_STATS_ENABLED
+ #if TASK_STATS_ENABLED
+ #define TASK_LOOP_MARK() getAppCore()->getMaintenanceManager()->markTaskLoop()
+ #else
+ #define TASK_LOOP_MARK() do {} while (0)
+ #endif
  
  // Forward declarations
  class AppCore;
  
+ /**
+  * @struct HeapSample
+  * @brief Internal and DMA capable heap at one point in time
+  */
+ struct HeapSample {
+     uint32_t uptimeSeconds;
+     uint32_t freeInternal;
+     uint32_t largestInternal;     // Largest block that can still be allocated
+     uint32_t minFreeInternal;     // Low-water mark since boot
+     uint32_t freeDma;
+     uint32_t largestDma;
+ };
+ 
+ /**
+  * @struct TaskLoopStats
+  * @brief Time between passes of one task's loop
+  */
+ struct TaskLoopStats {
+     TaskHandle_t handle;          // nullptr marks a free slot
+     uint32_t lastLoopMs;
+     uint32_t periodMs;            // Smoothed over the last passes
+     uint32_t maxPeriodMs;
+ };
+ 
+ /**
+  * @struct TaskRunTimeSample
+  * @brief Run-time counter of one task at the last sample
+  */
+ struct TaskRunTimeSample {
+     TaskHandle_t handle;
+     uint32_t runTime;
+     float cpuPercent;             // Share of one core since the sample before
+ };
+ 
+ /**
+  * @struct CryptoBenchmark
+  * @brief Boot-time timings of the crypto accelerators against a software baseline
+  */
+ struct CryptoBenchmark {
+     bool valid;
+     uint32_t bytes;               // Total bytes processed per measurement
+     uint32_t sha256HardwareUs;    // mbedTLS, SHA peripheral
+     uint32_t sha256SoftwareUs;    // Plain C implementation
+     uint32_t aesGcmHardwareUs;    // mbedTLS AES-256-GCM, AES peripheral
+     bool digestsMatch;
+ };
+ 
+ /**
+  * @struct BenchmarkResult
+  * @brief Cost of one operation of a microbenchmark
+  */
+ struct BenchmarkResult {
+     const char* name;
+     uint32_t ops;                 // Operations timed
+     uint32_t nsPerOp;
+ };
+ 
  /**
   * @struct RebootSchedule
   * @brief Structure to hold scheduled reboot information
   */
  struct RebootSchedule {
+     static constexpr uint16_t SETTINGS_VERSION = 1;   // Bump when the layout changes
+     
      bool enabled;
      uint8_t dayOfWeek;  // 0 = Sunday, 6 = Saturday
      uint8_t hour;
@@ -53,6 +133,30 @@
       */
      String runDiagnostics(bool fullTest = false);
      
+     /**
+      * @brief Start a benchmark run in a low-priority task
+      *
+      * Times the hot code paths (graph serialization, schedule evaluation,
+      * log formatting, history pushes, Helpers) and what only the hardware
+      * can tell: SPIFFS throughput, NVS commits, SCD40 and DHT22
+      * transactions, the TCP round trip to the broker and the JSON
+      * serialize rate. The run is stored with the firmware version.
+      * @return True if started, false if a run is already in progress
+      */
+     bool startBenchmark();
+     
+     /**
+      * @brief Check whether a benchmark run is in progress
+      * @return True while the benchmark task exists
+      */
+     bool isBenchmarkRunning() const { return _benchmarkTaskHandle != nullptr; }
+     
+     /**
+      * @brief Get the stored benchmark runs
+      * @return JSON array of runs, oldest first
+      */
+     String getBenchmarkResults();
+     
      /**
       * @brief Test a specific system component
       * @param component Component identifier (1 = WiFi, 2 = Sensors, 3 = Relays, etc.)
@@ -108,10 +212,33 @@
      void feedWatchdog();
      
      /**
-      * @brief Create RTOS tasks for maintenance operations
+      * @brief Add the once-a-minute maintenance pass to the job scheduler
       */
      void createTasks();
      
+     /**
+      * @brief Record a pass of the calling task's loop, use TASK_LOOP_MARK()
+      */
+     void markTaskLoop();
+     
+     /**
+      * @brief Get name, core, priority, stack high-water mark, CPU share and loop period of every task
+      * @return JSON string, empty unless built with TASK_STATS_ENABLED
+      */
+     String getTaskStatsJson();
+     
+     /**
+      * @brief Take a heap sample now, it goes into the history once per HEAP_SAMPLE_INTERVAL_MS
+      * @return Current heap figures
+      */
+     HeapSample sampleHeap();
+     
+     /**
+      * @brief Write the current heap, allocation failures, history and (tracking builds) per-task use
+      * @param out Destination, written in pieces so the history needs no JSON document
+      */
+     void printHeapJson(Print& out);
+     
  private:
      // Configuration
      RebootSchedule _rebootSchedule;
@@ -121,19 +248,38 @@
      
      // Status tracking
      bool _isInitialized;
+     CryptoBenchmark _cryptoBenchmark;
+     
+     // Heap history for trend graphs
+     RingBuffer<HeapSample> _heapHistory;
+     uint32_t _lastHeapSample;
+     
+ #if TASK_STATS_ENABLED
+     // Task statistics
+     TaskLoopStats _loopStats[Constants::TASK_STATS_LOOP_SLOTS];
+     TaskRunTimeSample _runTimeSamples[Constants::TASK_STATS_MAX_TASKS];
+     uint32_t _lastTotalRunTime;
+ #endif
      
      // RTOS resources
      SemaphoreHandle_t _maintenanceMutex;
-     TaskHandle_t _maintenanceTaskHandle;
+     TaskHandle_t _benchmarkTaskHandle;
      
      // Helper methods
      bool testWiFi();
      bool testSensors();
      bool testRelays();
      bool testStorage();
+     void runCryptoBenchmark();
+     void runCodeBenchmarks(JsonObject nsPerOp, size_t& graphPoints);
+     void runHardwareBenchmarks(JsonObject hardware);
+     void storeBenchmark(const JsonDocument& run);
+     void sampleTaskRunTime();
+     static void allocFailedHook(size_t size, uint32_t caps, const char* functionName);
      
-     // Task function
-     static void maintenanceTask(void* parameter);
+     // Scheduler job and task function
+     static uint32_t maintenanceJob(void* context);
+     static void benchmarkTask(void* parameter);
  };
  
  #endif // MAINTENANCE_MANAGER_H
\ No newline at end of file
@@ -7,16 +7,38 @@
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
  #include "../network/MQTTClient.h"
- #include <HTTPClient.h>
  #include <ArduinoJson.h>
  
+ namespace {
+     void recordToJson(JsonObject obj, const NotificationRecord& record) {
+         obj["level"] = static_cast<uint8_t>(record.level);
+         obj["source"] = record.source;
+         obj["title"] = record.title;
+         obj["message"] = record.message;
+         obj["timestamp"] = record.timestamp;
+     }
+ }
+ 
  NotificationManager::NotificationManager() :
      _minLevel(NotificationLevel::WARNING),
      _maxHistorySize(20),
      _notificationMutex(nullptr),
      _notificationTaskHandle(nullptr),
-     _notificationQueue(nullptr)
+     _notificationQueue(nullptr),
+     _nextId(0)
  {
+     const NotificationChannel httpChannels[CHANNEL_WORKERS] = {
+         NotificationChannel::TELEGRAM,
+         NotificationChannel::HTTP_WEBHOOK
+     };
+     
+     for (uint8_t i = 0; i < CHANNEL_WORKERS; i++) {
+         _workers[i].channel = httpChannels[i];
+         _workers[i].owner = this;
+         _workers[i].queue = nullptr;
+         _workers[i].taskHandle = nullptr;
+         _workers[i].dropped = 0;
+     }
  }
  
  NotificationManager::~NotificationManager() {
@@ -32,6 +54,16 @@
      if (_notificationQueue != nullptr) {
          vQueueDelete(_notificationQueue);
      }
+     
+     for (auto& worker : _workers) {
+         if (worker.taskHandle != nullptr) {
+             vTaskDelete(worker.taskHandle);
+         }
+         
+         if (worker.queue != nullptr) {
+             vQueueDelete(worker.queue);
+         }
+     }
  }
  
  bool NotificationManager::begin() {
@@ -42,13 +74,21 @@
          return false;
      }
      
-     // Create queue for notification messages
-     _notificationQueue = xQueueCreate(10, sizeof(NotificationMessage));
+     // Create queues for notification records, copied byte for byte
+     _notificationQueue = xQueueCreate(Constants::NOTIFICATION_QUEUE_SIZE, sizeof(NotificationRecord));
      if (_notificationQueue == nullptr) {
          Serial.println("Failed to create notification queue!");
          return false;
      }
      
+     for (auto& worker : _workers) {
+         worker.queue = xQueueCreate(Constants::NOTIFICATION_CHANNEL_QUEUE_SIZE, sizeof(NotificationRecord));
+         if (worker.queue == nullptr) {
+             Serial.println("Failed to create notification channel queue!");
+             return false;
+         }
+     }
+     
      // Load notification configurations from NVS if available
      nvs_handle_t nvsHandle;
      esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
@@ -96,6 +136,19 @@
                      delete[] endpointBuf;
                  }
                  
+                 // Get the server's root CA and the insecure opt-in
+                 size_t caLen = 0;
+                 if (nvs_get_str(nvsHandle, (prefix + "ca").c_str(), nullptr, &caLen) == ESP_OK && caLen > 0) {
+                     char* caBuf = new char[caLen];
+                     nvs_get_str(nvsHandle, (prefix + "ca").c_str(), caBuf, &caLen);
+                     config.caCert = String(caBuf);
+                     delete[] caBuf;
+                 }
+                 uint8_t insecure = 0;
+                 if (nvs_get_u8(nvsHandle, (prefix + "insec").c_str(), &insecure) == ESP_OK) {
+                     config.allowInsecureTls = insecure == 1;
+                 }
+                 
                  // Add to channel configs
                  _channelConfigs[channel] = config;
              }
@@ -119,6 +172,7 @@
      if (xSemaphoreTake(_notificationMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Store configuration
          _channelConfigs[channel] = config;
+         _channelConfigs[channel].channel = channel;
          _channelConfigs[channel].enabled = true;
          
          // Save to NVS
@@ -131,6 +185,8 @@
              nvs_set_str(nvsHandle, (prefix + "recipient").c_str(), config.recipient.c_str());
              nvs_set_str(nvsHandle, (prefix + "credentials").c_str(), config.credentials.c_str());
              nvs_set_str(nvsHandle, (prefix + "endpoint").c_str(), config.endpoint.c_str());
+             nvs_set_str(nvsHandle, (prefix + "ca").c_str(), config.caCert.c_str());
+             nvs_set_u8(nvsHandle, (prefix + "insec").c_str(), config.allowInsecureTls ? 1 : 0);
              
              nvs_commit(nvsHandle);
              nvs_close(nvsHandle);
@@ -184,13 +240,13 @@
  
  bool NotificationManager::testChannel(NotificationChannel channel) {
      // Create a test notification
-     NotificationMessage testMsg(
-         NotificationLevel::INFO,
-         "System",
-         "Test Notification",
-         "This is a test notification from " + String(Constants::APP_NAME)
-     );
+     NotificationRecord testMsg;
+     fillRecord(testMsg, NotificationLevel::INFO, "System", "Test Notification", 
+                "This is a test notification from " + String(Constants::APP_NAME));
+     testMsg.id = 0;
      
+     // Own connection, the channel task may be using its own right now
+     ChannelConnection connection;
      bool result = false;
      
      // Send test message via the specified channel
@@ -200,7 +256,7 @@
              break;
              
          case NotificationChannel::TELEGRAM:
-             result = sendTelegram(testMsg);
+             result = sendTelegram(connection, &testMsg, 1);
              break;
              
          case NotificationChannel::MQTT:
@@ -208,7 +264,7 @@
              break;
              
          case NotificationChannel::HTTP_WEBHOOK:
-             result = sendWebhook(testMsg);
+             result = sendWebhook(connection, &testMsg, 1);
              break;
              
          case NotificationChannel::PUSH_NOTIFICATION:
@@ -281,6 +337,7 @@
      
      // Add to message history
      if (xSemaphoreTake(_notificationMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         notification.id = ++_nextId;
          _recentNotifications.push_back(notification);
          
          // Limit history size
@@ -314,7 +371,11 @@
      
      // Add to notification queue for async processing
      if (_notificationQueue && notification.level >= _minLevel) {
-         return xQueueSend(_notificationQueue, &notification, 0) == pdTRUE;
+         NotificationRecord record;
+         fillRecord(record, level, source, title, message);
+         record.id = notification.id;
+         record.timestamp = notification.timestamp;
+         return xQueueSend(_notificationQueue, &record, 0) == pdTRUE;
      }
      
      return false;
@@ -373,9 +434,123 @@
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Notification", 
              "Failed to create notification task");
      }
+     
+     // One task per HTTP channel so a slow endpoint only delays itself
+     const char* taskNames[CHANNEL_WORKERS] = {"NotifyTelegram", "NotifyWebhook"};
+     for (uint8_t i = 0; i < CHANNEL_WORKERS; i++) {
+         result = xTaskCreatePinnedToCore(
+             channelTask,
+             taskNames[i],
+             Constants::STACK_SIZE_NOTIFY_CHANNEL,
+             &_workers[i],
+             Constants::PRIORITY_NOTIFY_CHANNEL,
+             &_workers[i].taskHandle,
+             0
+         );
+         
+         if (result != pdPASS) {
+             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Notification", 
+                 "Failed to create " + String(taskNames[i]) + " task");
+         }
+     }
+ }
+ 
+ bool NotificationManager::isChannelEnabled(NotificationChannel channel) {
+     bool enabled = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_notificationMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         auto it = _channelConfigs.find(channel);
+         enabled = (it != _channelConfigs.end() && it->second.enabled);
+         
+         xSemaphoreGive(_notificationMutex);
+     }
+     
+     return enabled;
+ }
+ 
+ void NotificationManager::markSent(const NotificationRecord* records, size_t count) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_notificationMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         // Find the notifications in history and mark them as sent
+         for (auto& histNotification : _recentNotifications) {
+             for (size_t i = 0; i < count; i++) {
+                 if (histNotification.id == records[i].id) {
+                     histNotification.sent = true;
+                     break;
+                 }
+             }
+         }
+         
+         xSemaphoreGive(_notificationMutex);
+     }
+ }
+ 
+ void NotificationManager::fillRecord(NotificationRecord& record, NotificationLevel level, const String& source, 
+                                      const String& title, const String& message) {
+     record.level = level;
+     record.timestamp = millis();
+     strlcpy(record.source, source.c_str(), sizeof(record.source));
+     strlcpy(record.title, title.c_str(), sizeof(record.title));
+     strlcpy(record.message, message.c_str(), sizeof(record.message));
+ }
+ 
+ int NotificationManager::postJson(ChannelConnection& connection, const NotificationConfig& config, const String& url, 
+                                   const String& payload, const String& bearerToken) {
+     HTTPClient& http = connection.http;
+     bool isHttps = url.startsWith("https://");
+     
+     // Start over only when the endpoint or its trust settings changed, or the server closed the connection
+     if (!http.connected() || connection.url != url || 
+         connection.caCert != config.caCert || connection.insecure != config.allowInsecureTls) {
+         connection.tls.stop();
+         connection.plain.stop();
+         connection.url = "";
+         
+         // The token goes inside this session, never hand it to an unverified server by default
+         if (isHttps) {
+             connection.caCert = config.caCert;
+             connection.insecure = config.allowInsecureTls;
+             if (!connection.caCert.isEmpty()) {
+                 connection.tls.setCACert(connection.caCert.c_str());
+             } else if (connection.insecure) {
+                 connection.tls.setInsecure();
+             } else {
+                 getAppCore()->getLogManager()->log(LogLevel::WARN, "Notification", 
+                     "No CA certificate for channel " + String(static_cast<uint8_t>(config.channel)) + 
+                     ", refusing to send over unverified TLS");
+                 return -1;
+             }
+         }
+         
+         http.setReuse(true);
+         bool started = isHttps ? http.begin(connection.tls, url) : http.begin(connection.plain, url);
+         if (!started) {
+             connection.url = "";
+             return -1;
+         }
+         
+         connection.url = url;
+     }
+     
+     http.addHeader("Content-Type", "application/json");
+     if (!bearerToken.isEmpty()) {
+         http.addHeader("Authorization", "Bearer " + bearerToken);
+     }
+     
+     int httpCode = http.POST(payload);
+     
+     // Read the body so the next request starts on a clean stream
+     if (httpCode > 0) {
+         http.getString();
+     }
+     
+     // Keeps the socket open when the server allows it
+     http.end();
+     return httpCode;
  }
  
- bool NotificationManager::sendEmail(const NotificationMessage& notification) {
+ bool NotificationManager::sendEmail(const NotificationRecord& notification) {
      // Get email configuration
      NotificationConfig config = getChannelConfig(NotificationChannel::EMAIL);
      if (!config.enabled || config.recipient.isEmpty() || config.endpoint.isEmpty()) {
@@ -386,42 +561,42 @@
      // a proper SMTP library or email service API. For now, we'll just log it.
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Notification", 
          "Email would be sent to " + config.recipient + 
-         " with title: " + notification.title);
+         " with title: " + String(notification.title));
      
      // Placeholder for actual email sending code
      return true;
  }
  
- bool NotificationManager::sendTelegram(const NotificationMessage& notification) {
+ bool NotificationManager::sendTelegram(ChannelConnection& connection, const NotificationRecord* records, size_t count) {
      // Get Telegram configuration
      NotificationConfig config = getChannelConfig(NotificationChannel::TELEGRAM);
      if (!config.enabled || config.recipient.isEmpty() || config.credentials.isEmpty()) {
          return false;
      }
      
-     // Format message
-     String messageText = "*" + notification.title + "*\n" + notification.message;
-     
-     // Create HTTP client
-     HTTPClient http;
-     
-     // Format URL with bot token and chat ID
-     String url = "https://api.telegram.org/bot" + config.credentials + 
-                  "/sendMessage?chat_id=" + config.recipient + 
-                  "&parse_mode=Markdown&text=" + urlEncode(messageText);
+     // One message for the whole batch, blank line between notifications
+     String messageText;
+     for (size_t i = 0; i < count; i++) {
+         if (i > 0) {
+             messageText += "\n\n";
+         }
+         messageText += "*" + String(records[i].title) + "*\n" + records[i].message;
+     }
      
-     // Send request
-     http.begin(url);
-     int httpCode = http.GET();
+     DynamicJsonDocument doc(512 + messageText.length());
+     doc["chat_id"] = config.recipient;
+     doc["parse_mode"] = "Markdown";
+     doc["text"] = messageText;
      
-     // Check result
-     bool success = (httpCode == 200);
+     String payload;
+     serializeJson(doc, payload);
      
-     http.end();
-     return success;
+     // POST keeps the text out of the URL and lets the connection be reused
+     String url = "https://api.telegram.org/bot" + config.credentials + "/sendMessage";
+     return postJson(connection, config, url, payload, "") == 200;
  }
  
- bool NotificationManager::sendMqtt(const NotificationMessage& notification) {
+ bool NotificationManager::sendMqtt(const NotificationRecord& notification) {
      // Get MQTT configuration
      NotificationConfig config = getChannelConfig(NotificationChannel::MQTT);
      if (!config.enabled || config.recipient.isEmpty()) {
@@ -430,11 +605,7 @@
      
      // Create JSON message
      DynamicJsonDocument doc(512);
-     doc["level"] = static_cast<uint8_t>(notification.level);
-     doc["source"] = notification.source;
-     doc["title"] = notification.title;
-     doc["message"] = notification.message;
-     doc["timestamp"] = notification.timestamp;
+     recordToJson(doc.to<JsonObject>(), notification);
      
      String payload;
      serializeJson(doc, payload);
@@ -448,47 +619,32 @@
      return false;
  }
  
- bool NotificationManager::sendWebhook(const NotificationMessage& notification) {
+ bool NotificationManager::sendWebhook(ChannelConnection& connection, const NotificationRecord* records, size_t count) {
      // Get webhook configuration
      NotificationConfig config = getChannelConfig(NotificationChannel::HTTP_WEBHOOK);
      if (!config.enabled || config.endpoint.isEmpty()) {
          return false;
      }
      
-     // Create JSON payload
-     DynamicJsonDocument doc(512);
-     doc["level"] = static_cast<uint8_t>(notification.level);
-     doc["source"] = notification.source;
-     doc["title"] = notification.title;
-     doc["message"] = notification.message;
-     doc["timestamp"] = notification.timestamp;
+     // A single notification is sent as an object, a batch as an array of them
+     DynamicJsonDocument doc(512 * count);
+     if (count == 1) {
+         recordToJson(doc.to<JsonObject>(), records[0]);
+     } else {
+         JsonArray array = doc.to<JsonArray>();
+         for (size_t i = 0; i < count; i++) {
+             recordToJson(array.createNestedObject(), records[i]);
+         }
+     }
      
      String payload;
      serializeJson(doc, payload);
      
-     // Create HTTP client
-     HTTPClient http;
-     
-     // Set up request
-     http.begin(config.endpoint);
-     http.addHeader("Content-Type", "application/json");
-     
-     // Add authentication if provided
-     if (!config.credentials.isEmpty()) {
-         http.addHeader("Authorization", "Bearer " + config.credentials);
-     }
-     
-     // Send POST request
-     int httpCode = http.POST(payload);
-     
-     // Check result
-     bool success = (httpCode >= 200 && httpCode < 300);
-     
-     http.end();
-     return success;
+     int httpCode = postJson(connection, config, config.endpoint, payload, config.credentials);
+     return httpCode >= 200 && httpCode < 300;
  }
  
- bool NotificationManager::sendPushNotification(const NotificationMessage& notification) {
+ bool NotificationManager::sendPushNotification(const NotificationRecord& notification) {
      // Get push notification configuration
      NotificationConfig config = getChannelConfig(NotificationChannel::PUSH_NOTIFICATION);
      if (!config.enabled || config.endpoint.isEmpty() || config.credentials.isEmpty()) {
@@ -498,117 +654,125 @@
      // This is a simplified implementation. In a real application, you'd use
      // a service like Firebase Cloud Messaging, OneSignal, etc.
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Notification", 
-         "Push notification would be sent with title: " + notification.title);
+         "Push notification would be sent with title: " + String(notification.title));
      
      // Placeholder for actual push notification sending code
      return true;
  }
  
- // Helper function to URL-encode a string
- String NotificationManager::urlEncode(const String& text) {
-    String encoded = "";
-    char c;
-    char code0;
-    char code1;
-    
-    for (int i = 0; i < text.length(); i++) {
-        c = text.charAt(i);
-        // Keep alphanumeric and other accepted characters intact
-        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            encoded += c;
-        } 
-        // Space should be encoded as '+'
-        else if (c == ' ') {
-            encoded += '+';
-        } 
-        // Any other characters are percent-encoded
-        else {
-            code1 = (c & 0xf) + '0';
-            if ((c & 0xf) > 9) {
-                code1 = (c & 0xf) - 10 + 'A';
-            }
-            c = (c >> 4) & 0xf;
-            code0 = c + '0';
-            if (c > 9) {
-                code0 = c - 10 + 'A';
-            }
-            encoded += '%';
-            encoded += code0;
-            encoded += code1;
-        }
-    }
-    
-    return encoded;
-}
-
- 
  void NotificationManager::notificationTask(void* parameter) {
      NotificationManager* notificationManager = static_cast<NotificationManager*>(parameter);
      
+     // Channels sent from this task, the HTTP ones have their own
+     const NotificationChannel localChannels[] = {
+         NotificationChannel::EMAIL,
+         NotificationChannel::MQTT,
+         NotificationChannel::PUSH_NOTIFICATION
+     };
+     
      // Buffer for received notifications
-     NotificationMessage notification;
+     NotificationRecord notification;
      
      while (true) {
+         TASK_LOOP_MARK();
+         
          // Wait for a notification to be available in the queue
          if (xQueueReceive(notificationManager->_notificationQueue, &notification, portMAX_DELAY) == pdTRUE) {
-             // Process notification and send through configured channels
-             bool anySent = false;
-             
-             // Check each enabled channel
-             for (const auto& entry : notificationManager->_channelConfigs) {
-                 if (entry.second.enabled) {
-                     bool sent = false;
-                     
-                     switch (entry.first) {
-                         case NotificationChannel::EMAIL:
-                             sent = notificationManager->sendEmail(notification);
-                             break;
-                             
-                         case NotificationChannel::TELEGRAM:
-                             sent = notificationManager->sendTelegram(notification);
-                             break;
-                             
-                         case NotificationChannel::MQTT:
-                             sent = notificationManager->sendMqtt(notification);
-                             break;
-                             
-                         case NotificationChannel::HTTP_WEBHOOK:
-                             sent = notificationManager->sendWebhook(notification);
-                             break;
-                             
-                         case NotificationChannel::PUSH_NOTIFICATION:
-                             sent = notificationManager->sendPushNotification(notification);
-                             break;
-                             
-                         default:
-                             break;
-                     }
-                     
-                     if (sent) {
-                         anySent = true;
-                         getAppCore()->getLogManager()->log(LogLevel::INFO, "Notification", 
-                             "Notification sent via channel " + String(static_cast<uint8_t>(entry.first)));
-                     } else {
-                         getAppCore()->getLogManager()->log(LogLevel::WARN, "Notification", 
-                             "Failed to send notification via channel " + String(static_cast<uint8_t>(entry.first)));
-                     }
+             // Hand a copy to every enabled HTTP channel
+             for (auto& worker : notificationManager->_workers) {
+                 if (!notificationManager->isChannelEnabled(worker.channel)) {
+                     continue;
+                 }
+                 
+                 if (xQueueSend(worker.queue, &notification, 0) != pdTRUE) {
+                     worker.dropped++;
+                     getAppCore()->getLogManager()->log(LogLevel::WARN, "Notification", 
+                         "Channel " + String(static_cast<uint8_t>(worker.channel)) + " queue full, " + 
+                         String(worker.dropped) + " notifications dropped");
                  }
              }
              
-             // Update notification status
-             if (xSemaphoreTake(notificationManager->_notificationMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-                 // Find the notification in history and mark as sent
-                 for (auto& histNotification : notificationManager->_recentNotifications) {
-                     if (histNotification.timestamp == notification.timestamp &&
-                         histNotification.title == notification.title &&
-                         histNotification.message == notification.message) {
-                         histNotification.sent = anySent;
+             // Send through the remaining enabled channels
+             bool anySent = false;
+             
+             for (NotificationChannel channel : localChannels) {
+                 if (!notificationManager->isChannelEnabled(channel)) {
+                     continue;
+                 }
+                 
+                 bool sent = false;
+                 
+                 switch (channel) {
+                     case NotificationChannel::EMAIL:
+                         sent = notificationManager->sendEmail(notification);
+                         break;
+                         
+                     case NotificationChannel::MQTT:
+                         sent = notificationManager->sendMqtt(notification);
+                         break;
+                         
+                     case NotificationChannel::PUSH_NOTIFICATION:
+                         sent = notificationManager->sendPushNotification(notification);
+                         break;
+                         
+                     default:
                          break;
-                     }
                  }
                  
-                 xSemaphoreGive(notificationManager->_notificationMutex);
+                 if (sent) {
+                     anySent = true;
+                     getAppCore()->getLogManager()->log(LogLevel::INFO, "Notification", 
+                         "Notification sent via channel " + String(static_cast<uint8_t>(channel)));
+                 } else {
+                     getAppCore()->getLogManager()->log(LogLevel::WARN, "Notification", 
+                         "Failed to send notification via channel " + String(static_cast<uint8_t>(channel)));
+                 }
              }
+             
+             // Update notification status
+             if (anySent) {
+                 notificationManager->markSent(&notification, 1);
+             }
+         }
+     }
+ }
+ 
+ void NotificationManager::channelTask(void* parameter) {
+     ChannelWorker* worker = static_cast<ChannelWorker*>(parameter);
+     NotificationManager* notificationManager = worker->owner;
+     
+     // Batch buffer on the heap, the TLS session needs the stack
+     NotificationRecord* batch = new NotificationRecord[Constants::NOTIFICATION_BATCH_MAX];
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Wait for a notification, then take whatever queued up behind it
+         if (xQueueReceive(worker->queue, &batch[0], portMAX_DELAY) != pdTRUE) {
+             continue;
+         }
+         
+         size_t count = 1;
+         while (count < Constants::NOTIFICATION_BATCH_MAX && 
+                xQueueReceive(worker->queue, &batch[count], 0) == pdTRUE) {
+             count++;
+         }
+         
+         bool sent = false;
+         if (worker->channel == NotificationChannel::TELEGRAM) {
+             sent = notificationManager->sendTelegram(worker->connection, batch, count);
+         } else {
+             sent = notificationManager->sendWebhook(worker->connection, batch, count);
+         }
+         
+         if (sent) {
+             notificationManager->markSent(batch, count);
+             getAppCore()->getLogManager()->log(LogLevel::INFO, "Notification", 
+                 String(count) + " notification(s) sent via channel " + String(static_cast<uint8_t>(worker->channel)));
+         } else {
+             getAppCore()->getLogManager()->log(LogLevel::WARN, "Notification", 
+                 "Failed to send " + String(count) + " notification(s) via channel " + 
+                 String(static_cast<uint8_t>(worker->channel)));
          }
      }
  }
\ No newline at end of file
@@ -13,6 +13,9 @@
  #include <freertos/semphr.h>
  #include <freertos/queue.h>
  #include <vector>
+ #include <WiFiClient.h>
+ #include <WiFiClientSecure.h>
+ #include <HTTPClient.h>
  #include "../utils/Constants.h"
  
  // Forward declarations
@@ -52,13 +55,17 @@
      String recipient;    // Email address, chat ID, topic, etc.
      String credentials;  // API key, token, etc.
      String endpoint;     // Server, URL, etc.
+     String caCert;       // PEM root CA the HTTPS server must chain to
+     bool allowInsecureTls;  // Opt-in: HTTPS without a CA, the server is not verified
      
      NotificationConfig() : 
          channel(NotificationChannel::NONE),
          enabled(false),
          recipient(""),
          credentials(""),
-         endpoint("") {}
+         endpoint(""),
+         caCert(""),
+         allowInsecureTls(false) {}
      
      NotificationConfig(NotificationChannel channel, bool enabled, 
                         const String& recipient, const String& credentials, const String& endpoint) :
@@ -66,7 +73,9 @@
          enabled(enabled),
          recipient(recipient),
          credentials(credentials),
-         endpoint(endpoint) {}
+         endpoint(endpoint),
+         caCert(""),
+         allowInsecureTls(false) {}
  };
  
  /**
@@ -79,6 +88,7 @@
      String title;
      String message;
      uint32_t timestamp;
+     uint32_t id;
      bool sent;
      
      NotificationMessage() : 
@@ -87,6 +97,7 @@
          title(""),
          message(""),
          timestamp(0),
+         id(0),
          sent(false) {}
      
      NotificationMessage(NotificationLevel level, const String& source, 
@@ -96,12 +107,40 @@
          title(title),
          message(message),
          timestamp(millis()),
+         id(0),
          sent(false) {}
  };
  
+ /**
+  * @struct NotificationRecord
+  * @brief Fixed-size copy of a notification, the only thing the queues carry
+  *
+  * Texts are cut to the buffer sizes, so a record can be copied byte for
+  * byte through a FreeRTOS queue.
+  */
+ struct NotificationRecord {
+     uint32_t id;
+     uint32_t timestamp;
+     NotificationLevel level;
+     char source[Constants::NOTIFICATION_SOURCE_SIZE];
+     char title[Constants::NOTIFICATION_TITLE_SIZE];
+     char message[Constants::NOTIFICATION_MESSAGE_SIZE];
+ };
+ 
  /**
   * @class NotificationManager
   * @brief Manages notifications and alerts via different channels
+  *
+  * The dispatcher task hands every record to the local channels (MQTT,
+  * email, push) and copies it into the queue of each HTTP channel. Telegram
+  * and webhooks have a task each, so a slow endpoint does not hold up the
+  * others. Each one keeps its connection open between calls and sends all
+  * records that queued up during the previous call in one request.
+  *
+  * The Telegram token and the webhook bearer token travel inside the TLS
+  * session, so an HTTPS channel only connects with the server verified
+  * against the channel's caCert. Without one it refuses to send unless
+  * allowInsecureTls was set for that channel.
   */
  class NotificationManager {
  public:
@@ -188,24 +227,57 @@
      std::vector<NotificationMessage> _recentNotifications;
      size_t _maxHistorySize;
      
+     /**
+      * @struct ChannelConnection
+      * @brief Keep-alive HTTP(S) connection of one channel
+      */
+     struct ChannelConnection {
+         WiFiClientSecure tls;
+         WiFiClient plain;
+         HTTPClient http;
+         String url;               // URL the open connection was started for
+         String caCert;            // WiFiClientSecure keeps only a pointer, this is the copy
+         bool insecure = false;
+     };
+     
+     /**
+      * @struct ChannelWorker
+      * @brief Queue, task and connection of one HTTP channel
+      */
+     struct ChannelWorker {
+         NotificationChannel channel;
+         NotificationManager* owner;
+         QueueHandle_t queue;
+         TaskHandle_t taskHandle;
+         uint32_t dropped;         // Records lost to a full queue
+         ChannelConnection connection;
+     };
+     
+     static constexpr uint8_t CHANNEL_WORKERS = 2;
+     
      // RTOS resources
      SemaphoreHandle_t _notificationMutex;
      TaskHandle_t _notificationTaskHandle;
      QueueHandle_t _notificationQueue;
-     
-
-     //url encode
-     String urlEncode(const String& text);
+     ChannelWorker _workers[CHANNEL_WORKERS];
+     uint32_t _nextId;
      
      // Helper methods
-     bool sendEmail(const NotificationMessage& notification);
-     bool sendTelegram(const NotificationMessage& notification);
-     bool sendMqtt(const NotificationMessage& notification);
-     bool sendWebhook(const NotificationMessage& notification);
-     bool sendPushNotification(const NotificationMessage& notification);
+     bool isChannelEnabled(NotificationChannel channel);
+     void markSent(const NotificationRecord* records, size_t count);
+     static void fillRecord(NotificationRecord& record, NotificationLevel level, const String& source, 
+                            const String& title, const String& message);
+     static int postJson(ChannelConnection& connection, const NotificationConfig& config, const String& url, 
+                         const String& payload, const String& bearerToken);
+     bool sendEmail(const NotificationRecord& notification);
+     bool sendTelegram(ChannelConnection& connection, const NotificationRecord* records, size_t count);
+     bool sendMqtt(const NotificationRecord& notification);
+     bool sendWebhook(ChannelConnection& connection, const NotificationRecord* records, size_t count);
+     bool sendPushNotification(const NotificationRecord& notification);
      
-     // Task function
+     // Task functions
      static void notificationTask(void* parameter);
+     static void channelTask(void* parameter);
  };
  
  #endif // NOTIFICATION_MANAGER_H   
\ No newline at end of file
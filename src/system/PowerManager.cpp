@@ -8,13 +8,32 @@
  #include "../system/LogManager.h"
  #include "../system/TimeManager.h"
  
+ namespace {
+     const char* const LOCK_NAMES[] = {"web", "mqtt", "sensors"};
+     const char* const MODE_NAMES[] = {"no_sleep", "modem_sleep", "light_sleep", "deep_sleep", "hibernation"};
+     
+     // Datasheet typical currents in mA, clock fixed at 240 MHz / scaled down to 80 MHz
+     // when idle. There is no current sensor, these are for comparing modes only
+     const float TYPICAL_CURRENT_MA[][2] = {
+         {100.0f, 30.0f},    // Radio always on / modem sleep between beacons
+         {50.0f, 25.0f},     // Radio off, CPU running
+         {0.8f, 0.8f},
+         {0.15f, 0.15f},
+         {0.005f, 0.005f}
+     };
+ }
+ 
  PowerManager::PowerManager() :
      _currentMode(PowerMode::NO_SLEEP),
      _isWiFiEnabled(true),
      _isBluetoothEnabled(false),
      _isScheduleActive(false),
-     _powerMutex(nullptr),
-     _powerTaskHandle(nullptr)
+     _wakeButtonPin(Constants::DEFAULT_WAKE_BUTTON_PIN),
+     _isDynamicFrequency(false),
+     _locks{},
+     _modeStats{},
+     _statsSince(0),
+     _powerMutex(nullptr)
  {
  }
  
@@ -24,8 +43,10 @@
          vSemaphoreDelete(_powerMutex);
      }
      
-     if (_powerTaskHandle != nullptr) {
-         vTaskDelete(_powerTaskHandle);
+     for (auto& lock : _locks) {
+         if (lock != nullptr) {
+             esp_pm_lock_delete(lock);
+         }
      }
  }
  
@@ -37,44 +58,66 @@
          return false;
      }
      
-     // Load power schedule from NVS if available
-     nvs_handle_t nvsHandle;
-     esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
-     if (err == ESP_OK) {
-         uint8_t enabled;
-         if (nvs_get_u8(nvsHandle, "power_enabled", &enabled) == ESP_OK) {
-             _powerSchedule.enabled = (enabled == 1);
-         }
-         
-         uint8_t mode;
-         if (nvs_get_u8(nvsHandle, "power_mode", &mode) == ESP_OK) {
-             _powerSchedule.mode = static_cast<PowerMode>(mode);
-         }
-         
-         uint8_t startHour, startMinute, endHour, endMinute;
-         if (nvs_get_u8(nvsHandle, "power_start_hour", &startHour) == ESP_OK) {
-             _powerSchedule.startHour = startHour;
-         }
-         
-         if (nvs_get_u8(nvsHandle, "power_start_minute", &startMinute) == ESP_OK) {
-             _powerSchedule.startMinute = startMinute;
-         }
-         
-         if (nvs_get_u8(nvsHandle, "power_end_hour", &endHour) == ESP_OK) {
-             _powerSchedule.endHour = endHour;
+     // Load the power schedule block; older firmware kept one key per field
+     StorageManager* storageManager = getAppCore()->getStorageManager();
+     if (!storageManager->getSettings(SettingsBlock::POWER, _powerSchedule)) {
+         nvs_handle_t nvsHandle;
+         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
+         if (err == ESP_OK) {
+             uint8_t enabled;
+             if (nvs_get_u8(nvsHandle, "power_enabled", &enabled) == ESP_OK) {
+                 _powerSchedule.enabled = (enabled == 1);
+             }
+             
+             uint8_t mode;
+             if (nvs_get_u8(nvsHandle, "power_mode", &mode) == ESP_OK) {
+                 _powerSchedule.mode = static_cast<PowerMode>(mode);
+             }
+             
+             uint8_t startHour, startMinute, endHour, endMinute;
+             if (nvs_get_u8(nvsHandle, "power_start_hour", &startHour) == ESP_OK) {
+                 _powerSchedule.startHour = startHour;
+             }
+             
+             if (nvs_get_u8(nvsHandle, "power_start_minute", &startMinute) == ESP_OK) {
+                 _powerSchedule.startMinute = startMinute;
+             }
+             
+             if (nvs_get_u8(nvsHandle, "power_end_hour", &endHour) == ESP_OK) {
+                 _powerSchedule.endHour = endHour;
+             }
+             
+             if (nvs_get_u8(nvsHandle, "power_end_minute", &endMinute) == ESP_OK) {
+                 _powerSchedule.endMinute = endMinute;
+             }
+             
+             nvs_close(nvsHandle);
          }
          
-         if (nvs_get_u8(nvsHandle, "power_end_minute", &endMinute) == ESP_OK) {
-             _powerSchedule.endMinute = endMinute;
+         // Move them into the block once it is safely written
+         static const char* const LEGACY_KEYS[] = {"power_enabled", "power_mode", "power_start_hour", 
+                                                   "power_start_minute", "power_end_hour", "power_end_minute"};
+         storageManager->putSettings(SettingsBlock::POWER, _powerSchedule);
+         if (storageManager->saveSettings()) {
+             storageManager->eraseLegacyKeys(LEGACY_KEYS, sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]));
          }
-         
-         nvs_close(nvsHandle);
      }
      
      // Bluetooth is off by default to save power
      _isBluetoothEnabled = false;
      esp_bt_controller_disable();
      
+     configureWakeButton();
+     
+     // Locks only exist when the SDK was built with power management
+     _statsSince = millis();
+     for (uint8_t i = 0; i < static_cast<uint8_t>(PowerLock::COUNT); i++) {
+         if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, LOCK_NAMES[i], &_locks[i]) != ESP_OK) {
+             _locks[i] = nullptr;
+         }
+     }
+     setDynamicFrequency(Constants::DEFAULT_POWER_DFS);
+     
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Power", 
          "Power manager initialized");
      
@@ -103,14 +146,18 @@
                  break;
                  
              case PowerMode::LIGHT_SLEEP:
-                 success = enterLightSleep();
+                 // The scheduler task sleeps between deadlines while this mode is active
+                 success = true;
                  break;
                  
              case PowerMode::DEEP_SLEEP:
+                 // The panel would keep showing the last frame, the chip does not come back
+                 getAppCore()->getDisplayManager()->setPowerMode(mode);
                  success = enterDeepSleep();
                  break;
                  
              case PowerMode::HIBERNATION:
+                 getAppCore()->getDisplayManager()->setPowerMode(mode);
                  success = enterHibernation();
                  break;
                  
@@ -120,7 +167,9 @@
          }
          
          if (success) {
+             accountResidency();
              _currentMode = mode;
+             getAppCore()->getDisplayManager()->setPowerMode(mode);
              
              getAppCore()->getLogManager()->log(LogLevel::INFO, "Power", 
                  "Entered power-saving mode: " + String(static_cast<int>(mode)));
@@ -169,7 +218,9 @@
          }
          
          if (success) {
+             accountResidency();
              _currentMode = PowerMode::NO_SLEEP;
+             getAppCore()->getDisplayManager()->setPowerMode(PowerMode::NO_SLEEP);
              
              getAppCore()->getLogManager()->log(LogLevel::INFO, "Power", 
                  "Exited power-saving mode");
@@ -210,19 +261,8 @@
      if (xSemaphoreTake(_powerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          _powerSchedule = schedule;
          
-         // Save to NVS
-         nvs_handle_t nvsHandle;
-         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle);
-         if (err == ESP_OK) {
-             nvs_set_u8(nvsHandle, "power_enabled", schedule.enabled ? 1 : 0);
-             nvs_set_u8(nvsHandle, "power_mode", static_cast<uint8_t>(schedule.mode));
-             nvs_set_u8(nvsHandle, "power_start_hour", schedule.startHour);
-             nvs_set_u8(nvsHandle, "power_start_minute", schedule.startMinute);
-             nvs_set_u8(nvsHandle, "power_end_hour", schedule.endHour);
-             nvs_set_u8(nvsHandle, "power_end_minute", schedule.endMinute);
-             nvs_commit(nvsHandle);
-             nvs_close(nvsHandle);
-         }
+         // Committed with the next settings save
+         getAppCore()->getStorageManager()->putSettings(SettingsBlock::POWER, _powerSchedule);
          
          // Log the change
          getAppCore()->getLogManager()->log(LogLevel::INFO, "Power", 
@@ -356,21 +396,8 @@
  }
  
  void PowerManager::createTasks() {
-     // Create power management task
-     BaseType_t result = xTaskCreatePinnedToCore(
-         powerTask,                   // Task function
-         "PowerTask",                 // Task name
-         2048,                        // Stack size (words)
-         this,                        // Task parameters
-         1,                           // Priority (low)
-         &_powerTaskHandle,           // Task handle
-         0                            // Core ID (0 - protocol core)
-     );
-     
-     if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Power", 
-             "Failed to create power management task");
-     }
+     // Initial delay to allow system to stabilize
+     getAppCore()->getJobScheduler()->addJob("power schedule", scheduleJob, this, 30000);
  }
  
  bool PowerManager::enterModemSleep() {
@@ -401,12 +428,177 @@
      return true;
  }
  
- bool PowerManager::enterLightSleep() {
+ uint32_t PowerManager::msUntilNextDeadline() {
+     AppCore* appCore = getAppCore();
+     uint32_t deadlineMs = Constants::POWER_CHECK_INTERVAL_MS;
+     
+     deadlineMs = min(deadlineMs, appCore->getSensorManager()->msUntilNextRead());
+     deadlineMs = min(deadlineMs, appCore->getRelayManager()->msUntilNextEvent());
+     deadlineMs = min(deadlineMs, appCore->getMQTTClient()->msUntilKeepAlive());
+     deadlineMs = min(deadlineMs, appCore->getJobScheduler()->msUntilNextJob());
+     
+     return deadlineMs;
+ }
+ 
+ bool PowerManager::setDynamicFrequency(bool enable) {
+     esp_pm_config_esp32_t config = {};
+     config.max_freq_mhz = Constants::POWER_DFS_MAX_MHZ;
+     config.min_freq_mhz = enable ? Constants::POWER_DFS_MIN_MHZ : Constants::POWER_DFS_MAX_MHZ;
+     config.light_sleep_enable = false;  // Light sleep is planned by the scheduler task
+     
+     esp_err_t err = esp_pm_configure(&config);
+     if (err != ESP_OK) {
+         LOG_WARN("Power", "Dynamic frequency scaling unavailable: %s", esp_err_to_name(err));
+         return false;
+     }
+     
+     // Modem sleep goes with the scaled clock, the fixed clock keeps the
+     // radio on for the lowest latency
+     WiFi.setSleep(enable);
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_powerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         accountResidency();
+         _isDynamicFrequency = enable;
+         
+         // Release mutex
+         xSemaphoreGive(_powerMutex);
+     }
+     
+     LOG_INFO("Power", "CPU clock %s", enable ? "scaled between 80 and 240 MHz" : "fixed at 240 MHz");
+     return true;
+ }
+ 
+ bool PowerManager::isDynamicFrequencyEnabled() {
+     return _isDynamicFrequency;
+ }
+ 
+ esp_pm_lock_handle_t PowerManager::acquireLock(PowerLock lock) {
+     esp_pm_lock_handle_t handle = _locks[static_cast<uint8_t>(lock)];
+     if (handle != nullptr && esp_pm_lock_acquire(handle) != ESP_OK) {
+         return nullptr;
+     }
+     return handle;
+ }
+ 
+ void PowerManager::releaseLock(esp_pm_lock_handle_t handle) {
+     if (handle != nullptr) {
+         esp_pm_lock_release(handle);
+     }
+ }
+ 
+ void PowerManager::recordRequestLatency(uint32_t latencyUs) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_powerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         PowerModeStats& stats = _modeStats[static_cast<uint8_t>(_currentMode)][_isDynamicFrequency ? 1 : 0];
+         stats.requests++;
+         stats.latencyTotalUs += latencyUs;
+         stats.latencyMaxUs = max(stats.latencyMaxUs, latencyUs);
+         
+         // Release mutex
+         xSemaphoreGive(_powerMutex);
+     }
+ }
+ 
+ void PowerManager::fillModeJson(JsonObject obj) {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_powerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         accountResidency();
+         
+         obj["mode"] = static_cast<uint8_t>(_currentMode);
+         obj["mode_name"] = MODE_NAMES[static_cast<uint8_t>(_currentMode)];
+         obj["dynamic_frequency"] = _isDynamicFrequency;
+         obj["cpu_freq_mhz"] = getCpuFrequencyMhz();
+         obj["schedule_active"] = _isScheduleActive;
+         
+         // Every mode and clock setting the device has spent time in since boot
+         JsonArray statsArray = obj.createNestedArray("stats");
+         for (uint8_t mode = 0; mode < POWER_MODE_COUNT; mode++) {
+             for (uint8_t dfs = 0; dfs < 2; dfs++) {
+                 const PowerModeStats& stats = _modeStats[mode][dfs];
+                 if (stats.residencyMs == 0) {
+                     continue;
+                 }
+                 
+                 JsonObject statsObj = statsArray.createNestedObject();
+                 statsObj["mode"] = mode;
+                 statsObj["mode_name"] = MODE_NAMES[mode];
+                 statsObj["dynamic_frequency"] = dfs == 1;
+                 statsObj["residency_seconds"] = stats.residencyMs / 1000;
+                 statsObj["typical_current_ma"] = TYPICAL_CURRENT_MA[mode][dfs];
+                 statsObj["requests"] = stats.requests;
+                 statsObj["avg_latency_ms"] = stats.requests > 0 ? 
+                     static_cast<float>(stats.latencyTotalUs / stats.requests) / 1000.0f : 0.0f;
+                 statsObj["max_latency_ms"] = stats.latencyMaxUs / 1000.0f;
+             }
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_powerMutex);
+     }
+ }
+ 
+ void PowerManager::accountResidency() {
+     // Caller must hold _powerMutex
+     uint32_t now = millis();
+     _modeStats[static_cast<uint8_t>(_currentMode)][_isDynamicFrequency ? 1 : 0].residencyMs += now - _statsSince;
+     _statsSince = now;
+ }
+ 
+ void PowerManager::configureWakeButton() {
+     if (_wakeButtonPin < 0) {
+         return;
+     }
+     
+     gpio_num_t pin = static_cast<gpio_num_t>(_wakeButtonPin);
+     pinMode(_wakeButtonPin, INPUT_PULLUP);
+     
+     // Light sleep wakes on the GPIO level, deep sleep needs an RTC capable pin
+     gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+     esp_sleep_enable_gpio_wakeup();
+     
+     if (rtc_gpio_is_valid_gpio(pin)) {
+         rtc_gpio_pullup_en(pin);
+         esp_sleep_enable_ext0_wakeup(pin, 0);
+     }
+ }
+ 
+ void PowerManager::sleepUntilNextDeadline(uint32_t maxMs) {
+     uint32_t windowMs = min(msUntilNextDeadline(), maxMs);
+     
+     // Something is due or still running, let it finish first
+     if (windowMs < Constants::LIGHT_SLEEP_MIN_MS + Constants::LIGHT_SLEEP_GUARD_MS) {
+         vTaskDelay(pdMS_TO_TICKS(Constants::LIGHT_SLEEP_AWAKE_MS));
+         return;
+     }
+     
+     if (!enterLightSleep(static_cast<uint64_t>(windowMs - Constants::LIGHT_SLEEP_GUARD_MS) * 1000ULL)) {
+         vTaskDelay(pdMS_TO_TICKS(Constants::LIGHT_SLEEP_AWAKE_MS));
+         return;
+     }
+     
+     // The tick count may not have advanced while asleep, make the
+     // deadline-driven tasks compare against millis() again. The scheduler
+     // task is the one sleeping here and re-checks on its own.
+     getAppCore()->getSensorManager()->wakeTasks();
+     getAppCore()->getRelayManager()->notifyControlTask(RelayManager::WAKE_RESUME);
+     
+     // A button press keeps the device awake until the next scheduled window
+     if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+         LOG_INFO("Power", "Woken by the wake button, staying awake");
+         exitPowerSavingMode();
+     }
+     
+     // Give the woken tasks time to run before planning the next sleep
+     vTaskDelay(pdMS_TO_TICKS(Constants::LIGHT_SLEEP_AWAKE_MS));
+ }
+ 
+ bool PowerManager::enterLightSleep(uint64_t sleepTimeUs) {
      // In light sleep, CPU is suspended, but WiFi, BT, and peripherals
      // maintain their state (though not operating)
      
-     // Configure wake-up sources
-     esp_sleep_enable_timer_wakeup(15000000);  // Wake up after 15 seconds
+     // Wake at the planned deadline, or earlier on the wake button
+     esp_sleep_enable_timer_wakeup(sleepTimeUs);
      
      // Enter light sleep
      esp_err_t err = esp_light_sleep_start();
@@ -476,18 +668,10 @@
      return true;
  }
  
- void PowerManager::powerTask(void* parameter) {
-     PowerManager* powerManager = static_cast<PowerManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
-     
-     // Initial delay to allow system to stabilize
-     vTaskDelay(pdMS_TO_TICKS(30000));  // 30 seconds
+ uint32_t PowerManager::scheduleJob(void* context) {
+     PowerManager* powerManager = static_cast<PowerManager*>(context);
      
-     while (true) {
-         // Check if a power mode change is needed
-         powerManager->checkPowerSchedule();
-         
-         // Sleep until next check (every minute)
-         vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(60000));
-     }
+     // Check if a power mode change is needed
+     powerManager->checkPowerSchedule();
+     return Constants::POWER_CHECK_INTERVAL_MS;
  }
\ No newline at end of file
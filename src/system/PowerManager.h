@@ -13,6 +13,10 @@
  #include <esp_sleep.h>
  #include <esp_wifi.h>
  #include <esp_bt.h>
+ #include <esp_pm.h>
+ #include <ArduinoJson.h>
+ #include <driver/gpio.h>
+ #include <driver/rtc_io.h>
  #include "../utils/Constants.h"
  
  // Forward declarations
@@ -23,6 +27,8 @@
   * @brief Structure to hold power mode schedule
   */
  struct PowerSchedule {
+     static constexpr uint16_t SETTINGS_VERSION = 1;   // Bump when the layout changes
+     
      bool enabled;
      PowerMode mode;
      uint8_t startHour;
@@ -48,9 +54,40 @@
          endMinute(endMinute) {}
  };
  
+ /**
+  * @enum PowerLock
+  * @brief Work that holds the CPU at full clock while frequency scaling is on
+  */
+ enum class PowerLock : uint8_t {
+     WEB = 0,      // HTTP request, from the request line to the disconnect
+     MQTT,         // One pass of the MQTT task
+     SENSORS,      // DHT22 RMT captures and SCD40 I2C transfers
+     COUNT
+ };
+ 
+ /**
+  * @struct PowerModeStats
+  * @brief Time spent and HTTP request latency in one power mode and clock setting
+  */
+ struct PowerModeStats {
+     uint64_t residencyMs;
+     uint32_t requests;
+     uint64_t latencyTotalUs;
+     uint32_t latencyMaxUs;
+ };
+ 
  /**
   * @class PowerManager
   * @brief Manages power-saving modes and power-related functions
+  *
+  * While light sleep is the active mode the scheduler task plans each sleep
+  * from the deadlines of the other tasks and sleeps exactly until the
+  * earliest one, so the wakeups follow the work instead of a fixed timer.
+  * The wake button (low level) ends a sleep early.
+  *
+  * With dynamic frequency scaling the CPU idles at 80 MHz and WiFi uses
+  * modem sleep; the web server, MQTT task and sensor reads hold PM locks
+  * that raise the clock to 240 MHz while they run.
   */
  class PowerManager {
  public:
@@ -116,10 +153,60 @@
      bool checkPowerSchedule();
      
      /**
-      * @brief Create RTOS tasks for power management
+      * @brief Add the power schedule check to the job scheduler
       */
      void createTasks();
      
+     /**
+      * @brief Get the time until the earliest sensor read, relay event, MQTT keep-alive or scheduler job
+      * @return Milliseconds, at most until the next power schedule check
+      */
+     uint32_t msUntilNextDeadline();
+     
+     /**
+      * @brief Light sleep until the next deadline, called by the job scheduler in LIGHT_SLEEP mode
+      * @param maxMs Longest time to sleep
+      */
+     void sleepUntilNextDeadline(uint32_t maxMs);
+     
+     /**
+      * @brief Switch between an 80-240 MHz scaled clock and a fixed 240 MHz
+      * @param enable True for dynamic frequency scaling (with WiFi modem sleep)
+      * @return True if the PM configuration was applied (needs CONFIG_PM_ENABLE)
+      */
+     bool setDynamicFrequency(bool enable);
+     
+     /**
+      * @brief Check if dynamic frequency scaling is on
+      * @return True if the CPU clock scales with load
+      */
+     bool isDynamicFrequencyEnabled();
+     
+     /**
+      * @brief Raise the CPU to full clock for a piece of work
+      * @param lock Work taking the lock
+      * @return Lock to pass to releaseLock(), nullptr when PM locks are unavailable
+      */
+     esp_pm_lock_handle_t acquireLock(PowerLock lock);
+     
+     /**
+      * @brief Release a lock returned by acquireLock()
+      * @param handle Lock handle (nullptr is ignored)
+      */
+     void releaseLock(esp_pm_lock_handle_t handle);
+     
+     /**
+      * @brief Add an HTTP request to the statistics of the current mode
+      * @param latencyUs Time from the request line to the disconnect
+      */
+     void recordRequestLatency(uint32_t latencyUs);
+     
+     /**
+      * @brief Fill the current mode, clock setting and per-mode statistics
+      * @param obj Object to fill
+      */
+     void fillModeJson(JsonObject obj);
+     
  private:
      // Configuration
      PowerSchedule _powerSchedule;
@@ -127,19 +214,48 @@
      bool _isWiFiEnabled;
      bool _isBluetoothEnabled;
      bool _isScheduleActive;
+     int8_t _wakeButtonPin;
+     bool _isDynamicFrequency;
+     
+     // PM locks and the statistics per mode, with the clock fixed and scaled
+     static constexpr uint8_t POWER_MODE_COUNT = 5;
+     esp_pm_lock_handle_t _locks[static_cast<uint8_t>(PowerLock::COUNT)];
+     PowerModeStats _modeStats[POWER_MODE_COUNT][2];
+     uint32_t _statsSince;
      
      // RTOS resources
      SemaphoreHandle_t _powerMutex;
-     TaskHandle_t _powerTaskHandle;
      
      // Helper methods
      bool enterModemSleep();
-     bool enterLightSleep();
+     bool enterLightSleep(uint64_t sleepTimeUs);
+     void configureWakeButton();
+     void accountResidency();
      bool enterDeepSleep(uint64_t sleepTimeUs = 0);
      bool enterHibernation(uint64_t sleepTimeUs = 0);
      
-     // Task function
-     static void powerTask(void* parameter);
+     // Scheduler job
+     static uint32_t scheduleJob(void* context);
+ };
+ 
+ /**
+  * @class ScopedPowerLock
+  * @brief Holds a PM lock for the lifetime of the object
+  */
+ class ScopedPowerLock {
+ public:
+     ScopedPowerLock(PowerManager* powerManager, PowerLock lock) :
+         _powerManager(powerManager),
+         _handle(powerManager->acquireLock(lock)) {}
+     
+     ~ScopedPowerLock() { _powerManager->releaseLock(_handle); }
+     
+     ScopedPowerLock(const ScopedPowerLock&) = delete;
+     ScopedPowerLock& operator=(const ScopedPowerLock&) = delete;
+     
+ private:
+     PowerManager* _powerManager;
+     esp_pm_lock_handle_t _handle;
  };
  
  #endif // POWER_MANAGER_H
\ No newline at end of file
@@ -8,16 +8,24 @@
  #include "../system/LogManager.h"
  #include "../components/RelayManager.h"
  #include "../components/SensorManager.h"
+ #include "../utils/Helpers.h"
  
  ProfileManager::ProfileManager() :
      _currentProfile("Default"),
      _mqttEnabled(false),
-     _profileMutex(nullptr)
+     _saveDirty(false),
+     _profileMutex(nullptr),
+     _saveTaskHandle(nullptr)
  {
+     memset(_profileIndex, 0, sizeof(_profileIndex));
  }
  
  ProfileManager::~ProfileManager() {
      // Clean up RTOS resources
+     if (_saveTaskHandle != nullptr) {
+         vTaskDelete(_saveTaskHandle);
+     }
+     
      if (_profileMutex != nullptr) {
          vSemaphoreDelete(_profileMutex);
      }
@@ -41,6 +49,23 @@
      // Load the default profile
      loadProfile(_currentProfile);
      
+     // Create the write-behind task, it sleeps until an edit arrives
+     BaseType_t result = xTaskCreatePinnedToCore(
+         profileSaveTask,                         // Task function
+         "ProfileSave",                           // Task name
+         Constants::STACK_SIZE_PROFILE_SAVE,      // Stack size (words)
+         this,                                    // Task parameters
+         Constants::PRIORITY_PROFILE_SAVE,        // Priority
+         &_saveTaskHandle,                        // Task handle
+         0                                        // Core ID (0 - protocol core)
+     );
+     
+     if (result != pdPASS) {
+         _saveTaskHandle = nullptr;
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
+             "Failed to create profile save task, edits are written immediately");
+     }
+     
      return true;
  }
  
@@ -89,14 +114,61 @@
  }
  
  int ProfileManager::findProfileIndex(const String& name) {
-     for (size_t i = 0; i < _profiles.size(); i++) {
-         if (_profiles[i].name == name) {
-             return i;
+     uint32_t hash = Helpers::hashFNV1a(name.c_str());
+     uint8_t slot = hash & (Constants::PROFILE_INDEX_SLOTS - 1);
+     
+     while (_profileIndex[slot] != 0) {
+         const ProfileEntry& entry = _profiles[_profileIndex[slot] - 1];
+         if (entry.nameHash == hash && entry.name == name) {
+             return _profileIndex[slot] - 1;
          }
+         slot = (slot + 1) & (Constants::PROFILE_INDEX_SLOTS - 1);
      }
      return -1; // Not found
  }
  
+ void ProfileManager::rebuildProfileIndex() {
+     memset(_profileIndex, 0, sizeof(_profileIndex));
+     
+     // Open addressing with linear probing, MAX_PROFILES keeps the table half empty
+     for (size_t i = 0; i < _profiles.size(); i++) {
+         uint8_t slot = _profiles[i].nameHash & (Constants::PROFILE_INDEX_SLOTS - 1);
+         while (_profileIndex[slot] != 0) {
+             slot = (slot + 1) & (Constants::PROFILE_INDEX_SLOTS - 1);
+         }
+         _profileIndex[slot] = i + 1;
+     }
+ }
+ 
+ bool ProfileManager::storeProfile(const String& name, JsonObjectConst settings) {
+     int index = findProfileIndex(name);
+     
+     if (index < 0) {
+         if (_profiles.size() >= Constants::MAX_PROFILES) {
+             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
+                 "Profile limit reached, not storing: " + name);
+             return false;
+         }
+         
+         // Create new profile
+         ProfileEntry entry;
+         entry.name = name;
+         entry.nameHash = Helpers::hashFNV1a(name.c_str());
+         _profiles.push_back(entry);
+         index = _profiles.size() - 1;
+         rebuildProfileIndex();
+     }
+     
+     // Keep the JSON for the API and the file, the parsed struct for loading
+     ProfileEntry& entry = _profiles[index];
+     entry.json = "";
+     serializeJson(settings, entry.json);
+     entry.settings = ProfileSettings();
+     parseProfileSettings(settings, entry.settings);
+     
+     return true;
+ }
+ 
  String ProfileManager::getProfileJson(const String& name) {
      String json;
      
@@ -105,8 +177,7 @@
          // Find profile by name
          int index = findProfileIndex(name);
          if (index >= 0) {
-             // Serialize profile to JSON
-             serializeJson(_profiles[index].doc, json);
+             json = _profiles[index].json;
          }
          
          // Release mutex
@@ -116,38 +187,30 @@
      return json;
  }
  
+ bool ProfileManager::getProfileSettings(const String& name, ProfileSettings& settings) {
+     bool found = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         int index = findProfileIndex(name);
+         if (index >= 0) {
+             settings = _profiles[index].settings;
+             found = true;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_profileMutex);
+     }
+     
+     return found;
+ }
+ 
  String ProfileManager::getProfilesJson() {
      String json;
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Create JSON document with all profiles
-         DynamicJsonDocument doc(16384);  // Adjust size based on expected number of profiles
-         JsonObject profilesObj = doc.createNestedObject("profiles");
-         
-         for (const auto& entry : _profiles) {
-            JsonObject profileObj = profilesObj.createNestedObject(entry.name);
-            if (entry.doc.is<JsonObject>()) {
-                // Use serializeJson to copy the contents instead of direct conversion
-                String tempJson;
-                serializeJson(entry.doc, tempJson);
-                
-                // Parse it into the target object
-                DynamicJsonDocument tempDoc(8192);
-                deserializeJson(tempDoc, tempJson);
-                
-                // Now copy all key-value pairs
-                JsonObject tempObj = tempDoc.as<JsonObject>();
-                for (JsonPair kv : tempObj) {
-                    profileObj[kv.key()] = kv.value();
-                }
-            }
-        }
-         
-         doc["current_profile"] = _currentProfile;
-         
-         // Serialize to JSON
-         serializeJson(doc, json);
+         json = buildProfilesJson();
          
          // Release mutex
          xSemaphoreGive(_profileMutex);
@@ -156,6 +219,30 @@
      return json;
  }
  
+ String ProfileManager::buildProfilesJson() {
+     // The stored JSON is inserted verbatim, only the envelope is built here
+     size_t capacity = JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(_profiles.size()) + _currentProfile.length() + 1;
+     for (const auto& entry : _profiles) {
+         capacity += entry.name.length() + 1 + entry.json.length() + 1;
+     }
+     
+     DynamicJsonDocument doc(capacity);
+     JsonObject profilesObj = doc.createNestedObject("profiles");
+     for (const auto& entry : _profiles) {
+         profilesObj[entry.name] = serialized(entry.json);
+     }
+     doc["current_profile"] = _currentProfile;
+     
+     if (doc.overflowed()) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", "Profiles JSON overflowed");
+         return "";
+     }
+     
+     String json;
+     serializeJson(doc, json);
+     return json;
+ }
+ 
  bool ProfileManager::saveProfile(const String& name, const JsonObject& settings) {
      if (name.isEmpty()) {
          return false;
@@ -163,22 +250,12 @@
      
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Find existing profile or create a new one
-         int index = findProfileIndex(name);
-         
-         if (index >= 0) {
-             // Update existing profile
-             _profiles[index].doc.clear();
-             _profiles[index].doc.set(settings);
-         } else {
-             // Create new profile
-             _profiles.push_back(ProfileEntry(name, 8192));
-             _profiles.back().doc.set(settings);
+         // Update the existing profile or create a new one, the file follows later
+         bool success = storeProfile(name, settings);
+         if (success) {
+             markDirty();
          }
          
-         // Save to file
-         bool success = saveProfilesToFile();
-         
          // Release mutex
          xSemaphoreGive(_profileMutex);
          
@@ -211,8 +288,8 @@
              return false;
          }
          
-         // Apply profile settings
-         applyProfileSettings(_profiles[index].doc);
+         // Apply the parsed settings, no JSON involved
+         applyProfileSettings(_profiles[index].settings);
          
          // Set as current profile
          _currentProfile = name;
@@ -248,6 +325,8 @@
          
          // Rename profile
          _profiles[oldIndex].name = newName;
+         _profiles[oldIndex].nameHash = Helpers::hashFNV1a(newName.c_str());
+         rebuildProfileIndex();
          
          // Update current profile if needed
          if (_currentProfile == oldName) {
@@ -255,20 +334,15 @@
          }
          
          // Save changes
-         bool success = saveProfilesToFile();
+         markDirty();
          
          // Release mutex
          xSemaphoreGive(_profileMutex);
          
-         if (success) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Profiles", 
-                 "Profile renamed from '" + oldName + "' to '" + newName + "'");
-         } else {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
-                 "Failed to rename profile from '" + oldName + "' to '" + newName + "'");
-         }
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "Profiles", 
+             "Profile renamed from '" + oldName + "' to '" + newName + "'");
          
-         return success;
+         return true;
      }
      
      return false;
@@ -302,22 +376,18 @@
          
          // Remove profile
          _profiles.erase(_profiles.begin() + index);
+         rebuildProfileIndex();
          
          // Save changes
-         bool success = saveProfilesToFile();
+         markDirty();
          
          // Release mutex
          xSemaphoreGive(_profileMutex);
          
-         if (success) {
-             getAppCore()->getLogManager()->log(LogLevel::INFO, "Profiles", 
-                 "Profile deleted: " + name);
-         } else {
-             getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
-                 "Failed to delete profile: " + name);
-         }
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "Profiles", 
+             "Profile deleted: " + name);
          
-         return success;
+         return true;
      }
      
      return false;
@@ -347,6 +417,7 @@
     if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
         // Clear existing profiles
         _profiles.clear();
+        rebuildProfileIndex();
         
         // Import profiles
         for (JsonPair kv : profilesObj) {
@@ -354,12 +425,7 @@
             
             // Make sure this value is an object before trying to use it
             if (kv.value().is<JsonObject>()) {
-                JsonObject settings = kv.value().as<JsonObject>();
-                
-                ProfileEntry entry(name, 8192);
-                entry.doc.set(settings);
-                
-                _profiles.push_back(entry);
+                storeProfile(name, kv.value().as<JsonObject>());
             }
         }
         
@@ -378,12 +444,13 @@
             _currentProfile = _profiles[0].name;
         }
         
-        // Save changes and load current profile
-        bool success = saveProfilesToFile();
+        // Save changes once for the whole import and load current profile
+        bool success = !_profiles.empty();
+        markDirty();
         if (success && !_currentProfile.isEmpty()) {
             int index = findProfileIndex(_currentProfile);
             if (index >= 0) {
-                applyProfileSettings(_profiles[index].doc);
+                applyProfileSettings(_profiles[index].settings);
             }
         }
         
@@ -409,10 +476,11 @@
      if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Clear existing profiles
          _profiles.clear();
+         rebuildProfileIndex();
          
          // Create default profile
-         ProfileEntry defaultProfile("Default", 8192);
-         JsonObject defaultObj = defaultProfile.doc.to<JsonObject>();
+         DynamicJsonDocument defaultProfile(2048);
+         JsonObject defaultObj = defaultProfile.to<JsonObject>();
          
          // Default profile settings
          defaultObj["name"] = "Default";
@@ -428,6 +496,7 @@
          JsonObject timingObj = defaultObj.createNestedObject("timing");
          timingObj["dht_interval"] = Constants::DEFAULT_DHT_READ_INTERVAL_MS / 1000;  // Convert to seconds
          timingObj["scd_interval"] = Constants::DEFAULT_SCD40_READ_INTERVAL_MS / 1000;  // Convert to seconds
+         timingObj["scd_mode"] = "periodic";
          timingObj["graph_interval"] = Constants::DEFAULT_GRAPH_UPDATE_INTERVAL_MS / 1000;  // Convert to seconds
          timingObj["graph_points"] = Constants::DEFAULT_GRAPH_MAX_POINTS;
          
@@ -452,11 +521,11 @@
              relayObj["end_minute"] = 59;
          }
          
-         _profiles.push_back(defaultProfile);
+         storeProfile("Default", defaultObj);
          
          // Create Test profile
-         ProfileEntry testProfile("Test", 8192);
-         JsonObject testObj = testProfile.doc.to<JsonObject>();
+         DynamicJsonDocument testProfile(2048);
+         JsonObject testObj = testProfile.to<JsonObject>();
          
          // Test profile settings (similar to default but with different thresholds)
          testObj["name"] = "Test";
@@ -496,7 +565,7 @@
              relayObj["end_minute"] = 0;
          }
          
-         _profiles.push_back(testProfile);
+         storeProfile("Test", testObj);
          
          // Set default as current profile
          _currentProfile = "Default";
@@ -513,6 +582,18 @@
      return false;
  }
  bool ProfileManager::loadProfilesFromFile() {
+     // A reset between removing the old file and renaming the new one leaves only
+     // the complete temporary file; next to profiles.json it is an unfinished write
+     if (SPIFFS.exists(Constants::PROFILES_TEMP_FILE)) {
+         if (!SPIFFS.exists(Constants::PROFILES_FILE)) {
+             SPIFFS.rename(Constants::PROFILES_TEMP_FILE, Constants::PROFILES_FILE);
+             getAppCore()->getLogManager()->log(LogLevel::WARN, "Profiles", 
+                 "Recovered profiles from interrupted save");
+         } else {
+             SPIFFS.remove(Constants::PROFILES_TEMP_FILE);
+         }
+     }
+     
      // Check if profiles file exists
      if (!SPIFFS.exists(Constants::PROFILES_FILE)) {
          getAppCore()->getLogManager()->log(LogLevel::WARN, "Profiles", 
@@ -528,16 +609,10 @@
          return false;
      }
      
-     // Read file content
-     size_t size = file.size();
-     std::unique_ptr<char[]> buf(new char[size + 1]);
-     file.readBytes(buf.get(), size);
-     buf[size] = '\0';
-     file.close();
-     
-     // Parse JSON
+     // Parse JSON straight from the file, no copy of the text
      DynamicJsonDocument doc(16384);
-     DeserializationError error = deserializeJson(doc, buf.get());
+     DeserializationError error = deserializeJson(doc, file);
+     file.close();
      
      if (error) {
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
@@ -549,8 +624,9 @@
      if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          // Clear existing profiles
          _profiles.clear();
+         rebuildProfileIndex();
          
-        // Load profiles         
+        // Load profiles, the document is freed once they are parsed
         if (doc.containsKey("profiles") && doc["profiles"].is<JsonObject>()) {
             JsonObject profilesObj = doc["profiles"].as<JsonObject>();
             for (JsonPair kv : profilesObj) {
@@ -558,12 +634,7 @@
                 String name = kv.key().c_str();
                 // Check if this element is an object before converting
                 if (kv.value().is<JsonObject>()) {
-                    JsonObject settings = kv.value().as<JsonObject>();
-                    
-                    ProfileEntry entry(name, 8192);
-                    entry.doc.set(settings);
-                    
-                    _profiles.push_back(entry);
+                    storeProfile(name, kv.value().as<JsonObject>());
                 }
             }
         }
@@ -602,144 +673,245 @@
          SPIFFS.mkdir(configDir);
      }
      
-     // Create JSON document with all profiles
-     DynamicJsonDocument doc(16384);
-     JsonObject profilesObj = doc.createNestedObject("profiles");
-     
-     for (const auto& entry : _profiles) {
-        JsonObject profileObj = profilesObj.createNestedObject(entry.name);
-        if (entry.doc.is<JsonObject>()) {
-            // Use serializeJson to copy the contents instead of direct conversion
-            String tempJson;
-            serializeJson(entry.doc, tempJson);
-            
-            // Parse it into the target object
-            DynamicJsonDocument tempDoc(8192);
-            deserializeJson(tempDoc, tempJson);
-            
-            // Now copy all key-value pairs
-            JsonObject tempObj = tempDoc.as<JsonObject>();
-            for (JsonPair kv : tempObj) {
-                profileObj[kv.key()] = kv.value();
-            }
-        }
-    }
-     
-     doc["current_profile"] = _currentProfile;
+     // Same content as the API returns
+     String json = buildProfilesJson();
+     if (json.isEmpty()) {
+         return false;
+     }
      
-     // Open file for writing
-     File file = SPIFFS.open(Constants::PROFILES_FILE, FILE_WRITE);
+     // Write the temporary file first, profiles.json stays intact until it is complete
+     File file = SPIFFS.open(Constants::PROFILES_TEMP_FILE, FILE_WRITE);
      if (!file) {
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
-             "Failed to open profiles file for writing: " + String(Constants::PROFILES_FILE));
+             "Failed to open profiles file for writing: " + String(Constants::PROFILES_TEMP_FILE));
          return false;
      }
      
      // Write JSON to file
-     if (serializeJson(doc, file) == 0) {
+     if (file.print(json) != json.length()) {
          file.close();
+         SPIFFS.remove(Constants::PROFILES_TEMP_FILE);
          getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
-             "Failed to write profiles to file: " + String(Constants::PROFILES_FILE));
+             "Failed to write profiles to file: " + String(Constants::PROFILES_TEMP_FILE));
          return false;
      }
      
      file.close();
      
+     // SPIFFS cannot rename onto an existing file, loadProfilesFromFile() covers the gap
+     if (SPIFFS.exists(Constants::PROFILES_FILE)) {
+         SPIFFS.remove(Constants::PROFILES_FILE);
+     }
+     if (!SPIFFS.rename(Constants::PROFILES_TEMP_FILE, Constants::PROFILES_FILE)) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Profiles", 
+             "Failed to replace profiles file: " + String(Constants::PROFILES_FILE));
+         return false;
+     }
+     
      getAppCore()->getLogManager()->log(LogLevel::INFO, "Profiles", 
          "Profiles saved to file: " + String(Constants::PROFILES_FILE));
      
      return true;
  }
  
- void ProfileManager::applyProfileSettings(const DynamicJsonDocument& profileSettings) {
-    // Serialize the entire document to a string
-    String json;
-    serializeJson(profileSettings, json);
-    
-    // Parse it back into a temporary document
-    DynamicJsonDocument tempDoc(8192);
-    deserializeJson(tempDoc, json);
-    
-    // Now we can safely work with the copy
-    
-    // Apply environment settings
-    if (tempDoc.containsKey("environment")) {
-        const JsonObject& envObj = tempDoc["environment"];
-        
-        if (envObj.containsKey("humidity_low") && 
-            envObj.containsKey("humidity_high") && 
-            envObj.containsKey("temperature_low") && 
-            envObj.containsKey("temperature_high") && 
-            envObj.containsKey("co2_low") && 
-            envObj.containsKey("co2_high")) {
-            
-            getAppCore()->getRelayManager()->setEnvironmentalThresholds(
-                envObj["humidity_low"].as<float>(),
-                envObj["humidity_high"].as<float>(),
-                envObj["temperature_low"].as<float>(),
-                envObj["temperature_high"].as<float>(),
-                envObj["co2_low"].as<float>(),
-                envObj["co2_high"].as<float>()
-            );
-        }
-    }
-    
-    // Apply timing settings
-    if (tempDoc.containsKey("timing")) {
-        const JsonObject& timingObj = tempDoc["timing"];
-        
-        if (timingObj.containsKey("dht_interval") && timingObj.containsKey("scd_interval")) {
-            getAppCore()->getSensorManager()->setSensorIntervals(
-                timingObj["dht_interval"].as<uint32_t>() * 1000,  // Convert to milliseconds
-                timingObj["scd_interval"].as<uint32_t>() * 1000
-            );
-        }
-    }
-    
-    // Apply cycle settings
-    if (tempDoc.containsKey("cycle")) {
-        const JsonObject& cycleObj = tempDoc["cycle"];
-        
-        if (cycleObj.containsKey("on_duration") && cycleObj.containsKey("interval")) {
-            getAppCore()->getRelayManager()->setCycleConfig(
-                cycleObj["on_duration"].as<uint16_t>(),
-                cycleObj["interval"].as<uint16_t>()
-            );
-        }
-    }
-    
-    // Apply relay operating times
-    if (tempDoc.containsKey("relay_times")) {
-        const JsonObject& relayTimesObj = tempDoc["relay_times"];
-        
-        for (int i = 1; i <= 8; i++) {
-            String relayKey = "relay" + String(i);
-            if (relayTimesObj.containsKey(relayKey)) {
-                const JsonObject& relayObj = relayTimesObj[relayKey];
-                
-                if (relayObj.containsKey("start_hour") && 
-                    relayObj.containsKey("start_minute") && 
-                    relayObj.containsKey("end_hour") && 
-                    relayObj.containsKey("end_minute")) {
-                    
-                    getAppCore()->getRelayManager()->setRelayOperatingTime(
-                        i,
-                        relayObj["start_hour"].as<uint8_t>(),
-                        relayObj["start_minute"].as<uint8_t>(),
-                        relayObj["end_hour"].as<uint8_t>(),
-                        relayObj["end_minute"].as<uint8_t>()
-                    );
-                }
-            }
-        }
-    }
-    
-    // Apply MQTT settings
-    if (tempDoc.containsKey("mqtt")) {
-        const JsonObject& mqttObj = tempDoc["mqtt"];
-        
-        if (mqttObj.containsKey("enabled")) {
-            _mqttEnabled = mqttObj["enabled"].as<bool>();
-        }
-    }
-}
\ No newline at end of file
+ void ProfileManager::markDirty() {
+     // Called with _profileMutex held
+     _saveDirty = true;
+     
+     // Without the task there is nothing to debounce with
+     if (_saveTaskHandle == nullptr) {
+         _saveDirty = !saveProfilesToFile();
+         return;
+     }
+     
+     xTaskNotifyGive(_saveTaskHandle);
+ }
+ 
+ bool ProfileManager::flush() {
+     if (_profileMutex == nullptr) {
+         return false;
+     }
+     
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_profileMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         success = !_saveDirty || saveProfilesToFile();
+         if (success) {
+             _saveDirty = false;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_profileMutex);
+     }
+     
+     return success;
+ }
+ 
+ void ProfileManager::profileSaveTask(void* parameter) {
+     ProfileManager* profileManager = static_cast<ProfileManager*>(parameter);
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Sleep until the first edit
+         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+         
+         // Every further edit restarts the quiet period, up to the maximum delay
+         TickType_t firstEdit = xTaskGetTickCount();
+         while (xTaskGetTickCount() - firstEdit < pdMS_TO_TICKS(Constants::PROFILE_SAVE_MAX_DELAY_MS) &&
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(Constants::PROFILE_SAVE_DEBOUNCE_MS)) > 0) {
+         }
+         
+         // Retry a failed write later instead of waiting for the next edit
+         if (!profileManager->flush()) {
+             vTaskDelay(pdMS_TO_TICKS(Constants::PROFILE_SAVE_MAX_DELAY_MS));
+             xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+         }
+     }
+ }
+ 
+ void ProfileManager::parseProfileSettings(JsonObjectConst obj, ProfileSettings& settings) {
+     // Environment settings
+     JsonObjectConst envObj = obj["environment"];
+     settings.hasEnvironment = !envObj.isNull() && 
+         envObj.containsKey("humidity_low") && 
+         envObj.containsKey("humidity_high") && 
+         envObj.containsKey("temperature_low") && 
+         envObj.containsKey("temperature_high") && 
+         envObj.containsKey("co2_low") && 
+         envObj.containsKey("co2_high");
+     if (settings.hasEnvironment) {
+         settings.humidityLow = envObj["humidity_low"].as<float>();
+         settings.humidityHigh = envObj["humidity_high"].as<float>();
+         settings.temperatureLow = envObj["temperature_low"].as<float>();
+         settings.temperatureHigh = envObj["temperature_high"].as<float>();
+         settings.co2Low = envObj["co2_low"].as<float>();
+         settings.co2High = envObj["co2_high"].as<float>();
+     }
+     
+     // Timing settings
+     JsonObjectConst timingObj = obj["timing"];
+     settings.hasTiming = !timingObj.isNull() && 
+         timingObj.containsKey("dht_interval") && timingObj.containsKey("scd_interval");
+     if (settings.hasTiming) {
+         settings.dhtIntervalMs = timingObj["dht_interval"].as<uint32_t>() * 1000;  // Convert to milliseconds
+         settings.scdIntervalMs = timingObj["scd_interval"].as<uint32_t>() * 1000;
+     }
+     
+     // SCD40 measurement mode, "periodic", "low_power" or "single_shot"
+     const char* scdMode = timingObj["scd_mode"];
+     settings.hasScdMode = scdMode != nullptr;
+     if (settings.hasScdMode) {
+         if (strcmp(scdMode, "low_power") == 0) {
+             settings.scdMode = ScdMode::LOW_POWER;
+         } else if (strcmp(scdMode, "single_shot") == 0) {
+             settings.scdMode = ScdMode::SINGLE_SHOT;
+         } else {
+             settings.scdMode = ScdMode::PERIODIC;
+         }
+     }
+     
+     // Cycle settings
+     JsonObjectConst cycleObj = obj["cycle"];
+     settings.hasCycle = !cycleObj.isNull() && 
+         cycleObj.containsKey("on_duration") && cycleObj.containsKey("interval");
+     if (settings.hasCycle) {
+         settings.cycleOnMinutes = cycleObj["on_duration"].as<uint16_t>();
+         settings.cycleIntervalMinutes = cycleObj["interval"].as<uint16_t>();
+     }
+     
+     // Control strategies for the environmental relays
+     JsonObjectConst controlObj = obj["control"];
+     for (int i = 5; i <= 6; i++) {
+         JsonObjectConst relayObj = controlObj["relay" + String(i)];
+         if (relayObj.isNull()) {
+             continue;
+         }
+         
+         ControlSettings& control = settings.control[i - 5];
+         control.mode = strcmp(relayObj["mode"] | "hysteresis", "pid") == 0 ? 
+             ControlMode::PID : ControlMode::HYSTERESIS;
+         control.kp = relayObj["kp"] | Constants::DEFAULT_CONTROL_KP;
+         control.ki = relayObj["ki"] | Constants::DEFAULT_CONTROL_KI;
+         control.kd = relayObj["kd"] | Constants::DEFAULT_CONTROL_KD;
+         control.windowSeconds = relayObj["window"] | Constants::DEFAULT_CONTROL_WINDOW_SECONDS;
+         control.minOnSeconds = relayObj["min_on"] | Constants::DEFAULT_CONTROL_MIN_ON_SECONDS;
+         control.minOffSeconds = relayObj["min_off"] | Constants::DEFAULT_CONTROL_MIN_OFF_SECONDS;
+         settings.controlMask |= 1 << (i - 5);
+     }
+     
+     // Relay operating times
+     JsonObjectConst relayTimesObj = obj["relay_times"];
+     for (int i = 1; i <= 8; i++) {
+         JsonObjectConst relayObj = relayTimesObj["relay" + String(i)];
+         if (relayObj.isNull() || 
+             !relayObj.containsKey("start_hour") || 
+             !relayObj.containsKey("start_minute") || 
+             !relayObj.containsKey("end_hour") || 
+             !relayObj.containsKey("end_minute")) {
+             continue;
+         }
+         
+         settings.relayTimes[i - 1][0] = relayObj["start_hour"].as<uint8_t>();
+         settings.relayTimes[i - 1][1] = relayObj["start_minute"].as<uint8_t>();
+         settings.relayTimes[i - 1][2] = relayObj["end_hour"].as<uint8_t>();
+         settings.relayTimes[i - 1][3] = relayObj["end_minute"].as<uint8_t>();
+         settings.relayTimesMask |= 1 << (i - 1);
+     }
+     
+     // MQTT settings
+     JsonVariantConst mqttEnabled = obj["mqtt"]["enabled"];
+     settings.hasMqttEnabled = !mqttEnabled.isNull();
+     settings.mqttEnabled = mqttEnabled.as<bool>();
+ }
+ 
+ void ProfileManager::applyProfileSettings(const ProfileSettings& settings) {
+     RelayManager* relayManager = getAppCore()->getRelayManager();
+     
+     // Apply environment settings
+     if (settings.hasEnvironment) {
+         relayManager->setEnvironmentalThresholds(
+             settings.humidityLow,
+             settings.humidityHigh,
+             settings.temperatureLow,
+             settings.temperatureHigh,
+             settings.co2Low,
+             settings.co2High
+         );
+     }
+     
+     // Apply timing settings
+     if (settings.hasTiming) {
+         getAppCore()->getSensorManager()->setSensorIntervals(settings.dhtIntervalMs, settings.scdIntervalMs);
+     }
+     
+     if (settings.hasScdMode) {
+         getAppCore()->getSensorManager()->setScdMode(settings.scdMode);
+     }
+     
+     // Apply cycle settings
+     if (settings.hasCycle) {
+         relayManager->setCycleConfig(settings.cycleOnMinutes, settings.cycleIntervalMinutes);
+     }
+     
+     // Apply control strategies for the environmental relays
+     for (int i = 5; i <= 6; i++) {
+         if (settings.controlMask & (1 << (i - 5))) {
+             relayManager->setControlSettings(i, settings.control[i - 5]);
+         }
+     }
+     
+     // Apply relay operating times
+     for (int i = 1; i <= 8; i++) {
+         if (settings.relayTimesMask & (1 << (i - 1))) {
+             const uint8_t* times = settings.relayTimes[i - 1];
+             relayManager->setRelayOperatingTime(i, times[0], times[1], times[2], times[3]);
+         }
+     }
+     
+     // Apply MQTT settings
+     if (settings.hasMqttEnabled) {
+         _mqttEnabled = settings.mqttEnabled;
+     }
+ }
@@ -11,26 +11,82 @@
  #include <SPIFFS.h>
  #include <freertos/FreeRTOS.h>
  #include <freertos/semphr.h>
+ #include <freertos/task.h>
  #include <vector>
  #include "../utils/Constants.h"
+ #include "../components/ControlStrategy.h"
  
  // Forward declarations
  class AppCore;
  
+ /**
+  * @struct ProfileSettings
+  * @brief The settings of a profile, parsed once so that loading it applies a struct
+  *
+  * Sections missing from the profile JSON are flagged absent and leave the
+  * current configuration untouched.
+  */
+ struct ProfileSettings {
+     // Environmental thresholds
+     bool hasEnvironment;
+     float humidityLow;
+     float humidityHigh;
+     float temperatureLow;
+     float temperatureHigh;
+     float co2Low;
+     float co2High;
+     
+     // Sensor read intervals
+     bool hasTiming;
+     uint32_t dhtIntervalMs;
+     uint32_t scdIntervalMs;
+     bool hasScdMode;
+     ScdMode scdMode;
+     
+     // Fan cycle
+     bool hasCycle;
+     uint16_t cycleOnMinutes;
+     uint16_t cycleIntervalMinutes;
+     
+     // Control strategies of the environmental relays 5 and 6
+     uint8_t controlMask;              // Bit 0: relay 5, bit 1: relay 6
+     ControlSettings control[2];
+     
+     // Operating windows of relays 1-8
+     uint8_t relayTimesMask;           // Bit n: relay n + 1
+     uint8_t relayTimes[8][4];         // Start hour, start minute, end hour, end minute
+     
+     // MQTT
+     bool hasMqttEnabled;
+     bool mqttEnabled;
+     
+     ProfileSettings() : hasEnvironment(false), hasTiming(false), hasScdMode(false), hasCycle(false), controlMask(0), 
+                         relayTimesMask(0), hasMqttEnabled(false), mqttEnabled(false) {}
+ };
+ 
  /**
   * @class ProfileManager
   * @brief Manages user profiles for storing and applying configuration settings
+  *
+  * Each profile keeps its settings twice: as minified JSON, which is what the
+  * API returns and the file stores, and as a parsed ProfileSettings, which
+  * is what loading applies. No JSON document outlives a call. Profiles are
+  * found through a small open-addressing table keyed by the FNV-1a hash of
+  * the name.
+  *
+  * Edits only mark the profiles dirty. A low-priority task writes them once
+  * no edit arrived for PROFILE_SAVE_DEBOUNCE_MS (at most PROFILE_SAVE_MAX_DELAY_MS
+  * after the first one), into a temporary file that then replaces
+  * profiles.json, so a reset mid-write never leaves a truncated file.
   */
  class ProfileManager {
  public:
      // Structure to represent a profile
      struct ProfileEntry {
          String name;
-         DynamicJsonDocument doc;  // Each profile has its own JSON document
-         
-         // Constructor with mandatory size parameter
-         ProfileEntry(const String& name, size_t capacity = 8192) 
-             : name(name), doc(capacity) {}
+         uint32_t nameHash;
+         String json;                 // Minified settings, served and saved as is
+         ProfileSettings settings;    // Parsed from json when the profile is stored
      };
  
      ProfileManager();
@@ -67,6 +123,14 @@
       */
      String getProfileJson(const String& name);
      
+     /**
+      * @brief Get the parsed settings of a profile without applying them
+      * @param name Profile name
+      * @param settings Output parameter for the profile settings
+      * @return True if the profile exists
+      */
+     bool getProfileSettings(const String& name, ProfileSettings& settings);
+     
      /**
       * @brief Get all profiles as JSON string
       * @return All profiles as JSON string
@@ -116,24 +180,41 @@
       */
      bool createDefaultProfiles();
      
+     /**
+      * @brief Write pending profile edits now instead of after the debounce delay
+      * @return True if nothing was pending or the profiles were written
+      */
+     bool flush();
+     
  private:
      // Profile data
      std::vector<ProfileEntry> _profiles;
+     uint8_t _profileIndex[Constants::PROFILE_INDEX_SLOTS];   // _profiles position + 1, 0 = empty
      String _currentProfile;
      
      // MQTT status
      bool _mqttEnabled;
      
+     // Write-behind state, guarded by _profileMutex
+     bool _saveDirty;
+     
      // RTOS resources
      SemaphoreHandle_t _profileMutex;
+     TaskHandle_t _saveTaskHandle;
      
      // Private methods
      bool loadProfilesFromFile();
      bool saveProfilesToFile();
-     void applyProfileSettings(const DynamicJsonDocument& profileSettings);
+     void markDirty();
+     static void profileSaveTask(void* parameter);
+     String buildProfilesJson();
+     bool storeProfile(const String& name, JsonObjectConst settings);
+     void applyProfileSettings(const ProfileSettings& settings);
+     static void parseProfileSettings(JsonObjectConst obj, ProfileSettings& settings);
      
      // Helper methods
      int findProfileIndex(const String& name);
+     void rebuildProfileIndex();
  };
  
  #endif // PROFILE_MANAGER_H
\ No newline at end of file
@@ -5,12 +5,23 @@
 
  #include "StorageManager.h"
  #include "../core/AppCore.h"
+ #include "../utils/Helpers.h"
+ 
+ namespace {
+     // NVS key of each SettingsBlock, in enum order
+     const char* const SETTINGS_KEYS[static_cast<size_t>(SettingsBlock::COUNT)] = {
+         "time",
+         "power",
+         "maintenance"
+     };
+ }
  
  StorageManager::StorageManager() :
      _storageMutex(nullptr),
      _isInitialized(false),
      _factoryResetFlag(false)
  {
+     memset(_settings, 0, sizeof(_settings));
  }
  
  StorageManager::~StorageManager() {
@@ -28,6 +39,9 @@
          return false;
      }
      
+     // Settings blocks first, the other managers read them in their begin()
+     loadSettings();
+     
      // Initialize SPIFFS
      if (!SPIFFS.begin(true)) {
          Serial.println("Failed to mount SPIFFS!");
@@ -73,18 +87,61 @@
  }
  
  bool StorageManager::saveSettings() {
+     if (_storageMutex == nullptr) {
+         return false;
+     }
+     
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          bool success = true;
+         uint8_t written = 0;
          
-         // Log the action
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Storage", "Saving settings");
+         bool anyDirty = false;
+         for (const auto& slot : _settings) {
+             anyDirty = anyDirty || slot.dirty;
+         }
          
-         // TODO: In a real implementation, collect settings from various managers
-         // and save them to the appropriate files or NVS.
+         // Edits made since the last save go out together, clean blocks cost nothing
+         nvs_handle_t nvsHandle;
+         if (anyDirty && nvs_open(Constants::NVS_SETTINGS_NAMESPACE, NVS_READWRITE, &nvsHandle) == ESP_OK) {
+             uint8_t record[sizeof(SettingsRecordHeader) + Constants::SETTINGS_BLOCK_MAX_SIZE];
+             
+             for (size_t i = 0; i < static_cast<size_t>(SettingsBlock::COUNT); i++) {
+                 SettingsSlot& slot = _settings[i];
+                 if (!slot.dirty) {
+                     continue;
+                 }
+                 
+                 SettingsRecordHeader header;
+                 header.version = slot.version;
+                 header.size = slot.size;
+                 header.crc = Helpers::calculateCRC32(slot.data, slot.size);
+                 memcpy(record, &header, sizeof(header));
+                 memcpy(record + sizeof(header), slot.data, slot.size);
+                 
+                 if (nvs_set_blob(nvsHandle, SETTINGS_KEYS[i], record, sizeof(header) + slot.size) == ESP_OK) {
+                     slot.dirty = false;
+                     written++;
+                 } else {
+                     success = false;
+                 }
+             }
+             
+             success = nvs_commit(nvsHandle) == ESP_OK && success;
+             nvs_close(nvsHandle);
+         } else if (anyDirty) {
+             success = false;
+         }
          
          // Release mutex
          xSemaphoreGive(_storageMutex);
+         
+         if (written > 0) {
+             LOG_INFO("Storage", "Saved %u settings blocks", written);
+         }
+         if (!success) {
+             LOG_ERROR("Storage", "Failed to save settings");
+         }
          return success;
      }
      
@@ -94,20 +151,111 @@
  bool StorageManager::loadSettings() {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         bool success = true;
+         uint8_t loaded = 0;
+         
+         // One handle for all blocks, a missing namespace just means first boot
+         nvs_handle_t nvsHandle;
+         esp_err_t err = nvs_open(Constants::NVS_SETTINGS_NAMESPACE, NVS_READONLY, &nvsHandle);
+         if (err == ESP_OK) {
+             uint8_t record[sizeof(SettingsRecordHeader) + Constants::SETTINGS_BLOCK_MAX_SIZE];
+             
+             for (size_t i = 0; i < static_cast<size_t>(SettingsBlock::COUNT); i++) {
+                 SettingsSlot& slot = _settings[i];
+                 slot.valid = false;
+                 slot.dirty = false;
+                 
+                 size_t len = sizeof(record);
+                 if (nvs_get_blob(nvsHandle, SETTINGS_KEYS[i], record, &len) != ESP_OK || len < sizeof(SettingsRecordHeader)) {
+                     continue;
+                 }
+                 
+                 SettingsRecordHeader header;
+                 memcpy(&header, record, sizeof(header));
+                 const uint8_t* data = record + sizeof(header);
+                 if (header.size > Constants::SETTINGS_BLOCK_MAX_SIZE || len != sizeof(header) + header.size ||
+                     header.crc != Helpers::calculateCRC32(data, header.size)) {
+                     continue;
+                 }
+                 
+                 memcpy(slot.data, data, header.size);
+                 slot.version = header.version;
+                 slot.size = header.size;
+                 slot.valid = true;
+                 loaded++;
+             }
+             
+             nvs_close(nvsHandle);
+         }
          
-         // Log the action
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "Storage", "Loading settings");
+         // Release mutex
+         xSemaphoreGive(_storageMutex);
          
-         // TODO: In a real implementation, load settings from files or NVS
-         // and apply them to the appropriate managers.
+         Serial.printf("Loaded %u settings blocks\n", loaded);
+         return err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND;
+     }
+     
+     return false;
+ }
+ 
+ bool StorageManager::readBlock(SettingsBlock block, uint16_t version, void* value, size_t size) {
+     if (_storageMutex == nullptr || block >= SettingsBlock::COUNT) {
+         return false;
+     }
+     
+     bool found = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         const SettingsSlot& slot = _settings[static_cast<size_t>(block)];
+         if (slot.valid && slot.version == version && slot.size == size) {
+             memcpy(value, slot.data, size);
+             found = true;
+         }
          
          // Release mutex
          xSemaphoreGive(_storageMutex);
-         return success;
      }
      
-     return false;
+     return found;
+ }
+ 
+ void StorageManager::writeBlock(SettingsBlock block, uint16_t version, const void* value, size_t size) {
+     if (_storageMutex == nullptr || block >= SettingsBlock::COUNT) {
+         return;
+     }
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         SettingsSlot& slot = _settings[static_cast<size_t>(block)];
+         
+         // Unchanged, spare the flash
+         bool unchanged = slot.valid && slot.version == version && slot.size == size && 
+                          memcmp(slot.data, value, size) == 0;
+         if (!unchanged) {
+             memcpy(slot.data, value, size);
+             slot.version = version;
+             slot.size = size;
+             slot.valid = true;
+             slot.dirty = true;
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_storageMutex);
+     }
+ }
+ 
+ void StorageManager::eraseLegacyKeys(const char* const* keys, size_t count) {
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle) != ESP_OK) {
+         return;
+     }
+     
+     // Keys that were never written are fine
+     for (size_t i = 0; i < count; i++) {
+         nvs_erase_key(nvsHandle, keys[i]);
+     }
+     nvs_commit(nvsHandle);
+     nvs_close(nvsHandle);
  }
  
  bool StorageManager::saveDefaultConfig() {
@@ -250,7 +398,8 @@
              return content;
          }
          
-         // Read file content
+         // Read file content, sized once
+         content.reserve(file.size());
          while (file.available()) {
              content += (char)file.read();
          }
@@ -263,6 +412,79 @@
      return content;
  }
  
+ size_t StorageManager::readFile(const String& path, const FileChunkCallback& callback) {
+     size_t delivered = 0;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         String filePath = path.startsWith("/") ? path : "/" + path;
+         File file = SPIFFS.open(filePath, FILE_READ);
+         
+         if (file && !file.isDirectory()) {
+             uint8_t buffer[Constants::FILE_CHUNK_SIZE];
+             size_t len;
+             while ((len = file.read(buffer, sizeof(buffer))) > 0) {
+                 delivered += len;
+                 if (!callback(buffer, len)) {
+                     break;
+                 }
+             }
+             file.close();
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_storageMutex);
+     }
+     
+     return delivered;
+ }
+ 
+ bool StorageManager::writeFile(const String& path, Stream& source) {
+     bool success = false;
+     
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         String filePath = path.startsWith("/") ? path : "/" + path;
+         String directory = filePath.substring(0, filePath.lastIndexOf('/'));
+         if (directory.length() > 0) {
+             ensureDirectory(directory);
+         }
+         
+         File file = SPIFFS.open(filePath, FILE_WRITE);
+         if (file) {
+             uint8_t buffer[Constants::FILE_CHUNK_SIZE];
+             size_t len;
+             success = true;
+             while ((len = source.readBytes(buffer, sizeof(buffer))) > 0) {
+                 if (file.write(buffer, len) != len) {
+                     success = false;
+                     break;
+                 }
+             }
+             file.close();
+         }
+         
+         // Release mutex
+         xSemaphoreGive(_storageMutex);
+     }
+     
+     return success;
+ }
+ 
+ File StorageManager::openFile(const String& path, const char* mode) {
+     String filePath = path.startsWith("/") ? path : "/" + path;
+     
+     // Writers get their directory, like writeFile()
+     if (strcmp(mode, FILE_READ) != 0) {
+         String directory = filePath.substring(0, filePath.lastIndexOf('/'));
+         if (directory.length() > 0) {
+             ensureDirectory(directory);
+         }
+     }
+     
+     return SPIFFS.open(filePath, mode);
+ }
+ 
  bool StorageManager::writeFile(const String& path, const String& content) {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_storageMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
@@ -13,6 +13,8 @@
  #include <esp_partition.h>
  #include <ArduinoJson.h>
  #include <vector>
+ #include <functional>
+ #include <type_traits>
  #include <freertos/FreeRTOS.h>
  #include <freertos/semphr.h>
  #include "../utils/Constants.h"
@@ -37,9 +39,36 @@
      size_t totalEntries;
  };
  
+ /**
+  * @brief Callback receiving consecutive chunks of a file
+  * @param data Chunk, valid during the call only
+  * @param len Chunk length
+  * @return False to stop reading
+  */
+ typedef std::function<bool(const uint8_t* data, size_t len)> FileChunkCallback;
+ 
+ /**
+  * @enum SettingsBlock
+  * @brief Subsystems whose settings are stored as one typed NVS blob each
+  */
+ enum class SettingsBlock : uint8_t {
+     TIME = 0,
+     POWER,
+     MAINTENANCE,
+     COUNT
+ };
+ 
  /**
   * @class StorageManager
   * @brief Manages file system and NVS operations
+  *
+  * Subsystem settings live in the "settings" NVS namespace as one blob per
+  * SettingsBlock: a version, the struct size and a CRC32, followed by the raw
+  * struct. All blocks are read into RAM at boot with a single NVS handle;
+  * putSettings() only updates that copy and marks it dirty, and
+  * saveSettings() writes the dirty blocks with one commit. A block whose
+  * version, size or CRC does not match is ignored and the subsystem keeps
+  * its defaults.
   */
  class StorageManager {
  public:
@@ -65,17 +94,49 @@
      NVSStats getNVSStats();
      
      /**
-      * @brief Save settings to storage
-      * @return True if settings saved successfully
+      * @brief Commit the settings blocks changed since the last save
+      * @return True if nothing was pending or all dirty blocks were written
       */
      bool saveSettings();
      
      /**
-      * @brief Load settings from storage
-      * @return True if settings loaded successfully
+      * @brief Read every settings block from NVS into RAM
+      * @return True if the settings namespace could be read (it may be empty)
       */
      bool loadSettings();
      
+     /**
+      * @brief Get a settings block read at boot
+      * @param block Block ID
+      * @param value Output parameter, untouched if the block is missing or from another layout
+      * @return True if a valid block with T::SETTINGS_VERSION was found
+      */
+     template <typename T>
+     bool getSettings(SettingsBlock block, T& value) {
+         static_assert(std::is_trivially_copyable<T>::value, "Settings blocks are stored as raw bytes");
+         static_assert(sizeof(T) <= Constants::SETTINGS_BLOCK_MAX_SIZE, "Settings block too large");
+         return readBlock(block, T::SETTINGS_VERSION, &value, sizeof(T));
+     }
+     
+     /**
+      * @brief Update a settings block, written by the next saveSettings()
+      * @param block Block ID
+      * @param value New settings, an unchanged value does not mark the block dirty
+      */
+     template <typename T>
+     void putSettings(SettingsBlock block, const T& value) {
+         static_assert(std::is_trivially_copyable<T>::value, "Settings blocks are stored as raw bytes");
+         static_assert(sizeof(T) <= Constants::SETTINGS_BLOCK_MAX_SIZE, "Settings block too large");
+         writeBlock(block, T::SETTINGS_VERSION, &value, sizeof(T));
+     }
+     
+     /**
+      * @brief Erase per-field keys of the config namespace after migrating them to a block
+      * @param keys Key names
+      * @param count Number of keys
+      */
+     void eraseLegacyKeys(const char* const* keys, size_t count);
+     
      /**
       * @brief Save the default configuration
       * @return True if configuration saved successfully
@@ -102,12 +163,20 @@
      std::vector<String> listDirectory(const String& directory = "/");
      
      /**
-      * @brief Read a file as a string
+      * @brief Read a small file as a string
       * @param path File path
       * @return File contents as string
       */
      String readFile(const String& path);
      
+     /**
+      * @brief Read a file in FILE_CHUNK_SIZE chunks, memory use independent of the file size
+      * @param path File path
+      * @param callback Receives each chunk in order
+      * @return Bytes delivered to the callback
+      */
+     size_t readFile(const String& path, const FileChunkCallback& callback);
+     
      /**
       * @brief Write a string to a file
       * @param path File path
@@ -116,6 +185,22 @@
       */
      bool writeFile(const String& path, const String& content);
      
+     /**
+      * @brief Copy a stream into a file in FILE_CHUNK_SIZE chunks
+      * @param path File path
+      * @param source Stream read until it has no more data
+      * @return True if everything read was written
+      */
+     bool writeFile(const String& path, Stream& source);
+     
+     /**
+      * @brief Open a file for streaming outside the storage mutex (e.g. by a response filler)
+      * @param path File path
+      * @param mode FILE_READ, FILE_WRITE or FILE_APPEND; writing creates the directory
+      * @return File handle, false if it could not be opened
+      */
+     File openFile(const String& path, const char* mode = FILE_READ);
+     
      /**
       * @brief Delete a file
       * @param path File path
@@ -130,6 +215,31 @@
      bool formatFilesystem();
      
  private:
+     /**
+      * @struct SettingsSlot
+      * @brief RAM copy of one settings block
+      */
+     struct SettingsSlot {
+         uint8_t data[Constants::SETTINGS_BLOCK_MAX_SIZE];
+         uint16_t version;
+         uint16_t size;
+         bool valid;
+         bool dirty;
+     };
+     
+     /**
+      * @struct SettingsRecordHeader
+      * @brief Prefix of a settings blob in NVS
+      */
+     struct SettingsRecordHeader {
+         uint16_t version;
+         uint16_t size;
+         uint32_t crc;
+     };
+     
+     // Settings blocks, guarded by _storageMutex
+     SettingsSlot _settings[static_cast<size_t>(SettingsBlock::COUNT)];
+     
      // RTOS resources
      SemaphoreHandle_t _storageMutex;
      
@@ -139,6 +249,8 @@
      
      // Helper methods
      bool ensureDirectory(const String& dir);
+     bool readBlock(SettingsBlock block, uint16_t version, void* value, size_t size);
+     void writeBlock(SettingsBlock block, uint16_t version, const void* value, size_t size);
  };
  
  #endif // STORAGE_MANAGER_H
\ No newline at end of file
@@ -15,8 +15,7 @@
      _syncInterval(86400),  // Default: sync once per day
      _isTimeSet(false),
      _lastSyncTime(0),
-     _timeMutex(nullptr),
-     _timeTaskHandle(nullptr)
+     _timeMutex(nullptr)
  {
  }
  
@@ -25,10 +24,6 @@
      if (_timeMutex != nullptr) {
          vSemaphoreDelete(_timeMutex);
      }
-     
-     if (_timeTaskHandle != nullptr) {
-         vTaskDelete(_timeTaskHandle);
-     }
  }
  
  bool TimeManager::begin() {
@@ -39,19 +34,37 @@
          return false;
      }
      
-     // Load timezone from NVS if available
-     nvs_handle_t nvsHandle;
-     esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
-     if (err == ESP_OK) {
-         size_t len = 0;
-         err = nvs_get_str(nvsHandle, "timezone", nullptr, &len);
-         if (err == ESP_OK && len > 0) {
-             char* timezoneBuffer = new char[len];
-             nvs_get_str(nvsHandle, "timezone", timezoneBuffer, &len);
-             _timezone = String(timezoneBuffer);
-             delete[] timezoneBuffer;
+     // Load the time settings block; older firmware only kept the timezone key
+     TimeSettings settings;
+     StorageManager* storageManager = getAppCore()->getStorageManager();
+     if (storageManager->getSettings(SettingsBlock::TIME, settings)) {
+         _timezone = settings.timezone;
+         if (settings.ntpServers[0][0] != '\0') {
+             _ntpServer1 = settings.ntpServers[0];
+             _ntpServer2 = settings.ntpServers[1];
+             _ntpServer3 = settings.ntpServers[2];
+         }
+     } else {
+         nvs_handle_t nvsHandle;
+         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
+         if (err == ESP_OK) {
+             size_t len = 0;
+             err = nvs_get_str(nvsHandle, "timezone", nullptr, &len);
+             if (err == ESP_OK && len > 0) {
+                 char* timezoneBuffer = new char[len];
+                 nvs_get_str(nvsHandle, "timezone", timezoneBuffer, &len);
+                 _timezone = String(timezoneBuffer);
+                 delete[] timezoneBuffer;
+             }
+             nvs_close(nvsHandle);
+         }
+         
+         // Move it into the block once it is safely written
+         static const char* const LEGACY_KEYS[] = {"timezone"};
+         storeSettings();
+         if (storageManager->saveSettings()) {
+             storageManager->eraseLegacyKeys(LEGACY_KEYS, 1);
          }
-         nvs_close(nvsHandle);
      }
      
      // Configure NTP servers and timezone
@@ -160,14 +173,8 @@
          setenv("TZ", _timezone.c_str(), 1);
          tzset();
          
-         // Save to NVS
-         nvs_handle_t nvsHandle;
-         esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle);
-         if (err == ESP_OK) {
-             nvs_set_str(nvsHandle, "timezone", _timezone.c_str());
-             nvs_commit(nvsHandle);
-             nvs_close(nvsHandle);
-         }
+         // Committed with the next settings save
+         storeSettings();
          
          getAppCore()->getLogManager()->log(LogLevel::INFO, "Time", 
              "Timezone set to: " + _timezone);
@@ -202,6 +209,7 @@
          _ntpServer1 = server1;
          _ntpServer2 = server2;
          _ntpServer3 = server3;
+         storeSettings();
          
          getAppCore()->getLogManager()->log(LogLevel::INFO, "Time", 
              "NTP servers updated. Primary: " + _ntpServer1);
@@ -308,38 +316,36 @@
  }
  
  void TimeManager::createTasks() {
-     // Create time sync task
-     BaseType_t result = xTaskCreatePinnedToCore(
-         timeTask,                   // Task function
-         "TimeTask",                 // Task name
-         2048,                       // Stack size (words)
-         this,                       // Task parameters
-         1,                          // Priority (low)
-         &_timeTaskHandle,           // Task handle
-         0                           // Core ID (0 - protocol core)
-     );
-     
-     if (result != pdPASS) {
-         getAppCore()->getLogManager()->log(LogLevel::ERROR, "Time", 
-             "Failed to create time sync task");
-     }
+     // Initial delay to allow WiFi to connect first
+     getAppCore()->getJobScheduler()->addJob("time sync", syncJob, this, 10000);
  }
  
- void TimeManager::timeTask(void* parameter) {
-     TimeManager* timeManager = static_cast<TimeManager*>(parameter);
-     TickType_t lastWakeTime = xTaskGetTickCount();
+ void TimeManager::storeSettings() {
+     // Caller must hold _timeMutex (or be in begin())
+     TimeSettings settings = {};
+     strncpy(settings.timezone, _timezone.c_str(), sizeof(settings.timezone) - 1);
+     strncpy(settings.ntpServers[0], _ntpServer1.c_str(), sizeof(settings.ntpServers[0]) - 1);
+     strncpy(settings.ntpServers[1], _ntpServer2.c_str(), sizeof(settings.ntpServers[1]) - 1);
+     strncpy(settings.ntpServers[2], _ntpServer3.c_str(), sizeof(settings.ntpServers[2]) - 1);
+     
+     getAppCore()->getStorageManager()->putSettings(SettingsBlock::TIME, settings);
+ }
+ 
+ uint32_t TimeManager::syncJob(void* context) {
+     TimeManager* timeManager = static_cast<TimeManager*>(context);
      
-     // Initial delay to allow WiFi to connect first
-     vTaskDelay(pdMS_TO_TICKS(10000));
+     // Check if it's time to sync again
+     time_t now = time(nullptr);
+     if (now - timeManager->_lastSyncTime >= timeManager->_syncInterval) {
+         timeManager->syncTime();
+     }
      
-     while (true) {
-         // Check if it's time to sync again
-         time_t now = time(nullptr);
-         if (now - timeManager->_lastSyncTime >= timeManager->_syncInterval) {
-             timeManager->syncTime();
-         }
-         
-         // Sleep for an hour before checking again
-         vTaskDelay(pdMS_TO_TICKS(3600000));  // Check once per hour
+     // Check again when the next sync falls due, at least once per hour
+     // so a failed sync is retried
+     uint32_t waitMs = 3600000;
+     int64_t untilDue = static_cast<int64_t>(timeManager->_lastSyncTime) + timeManager->_syncInterval - time(nullptr);
+     if (untilDue > 0 && untilDue * 1000 < waitMs) {
+         waitMs = static_cast<uint32_t>(untilDue * 1000);
      }
+     return waitMs;
  }
\ No newline at end of file
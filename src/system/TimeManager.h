@@ -13,6 +13,17 @@
  #include <freertos/semphr.h>
  #include "../utils/Constants.h"
  
+ /**
+  * @struct TimeSettings
+  * @brief Persisted time zone and NTP servers, stored as one settings block
+  */
+ struct TimeSettings {
+     static constexpr uint16_t SETTINGS_VERSION = 1;   // Bump when the layout changes
+     
+     char timezone[64];
+     char ntpServers[3][48];
+ };
+ 
  /**
   * @class TimeManager
   * @brief Manages system time synchronization with NTP servers and provides time-related functions
@@ -126,7 +137,7 @@
      int getDayOfWeek();
      
      /**
-      * @brief Create RTOS tasks for time-related operations
+      * @brief Add the NTP sync check to the job scheduler
       */
      void createTasks();
      
@@ -144,10 +155,12 @@
      
      // RTOS resources
      SemaphoreHandle_t _timeMutex;
-     TaskHandle_t _timeTaskHandle;
      
-     // Task function
-     static void timeTask(void* parameter);
+     // Private methods
+     void storeSettings();
+     
+     // Scheduler job
+     static uint32_t syncJob(void* context);
  };
  
  #endif // TIME_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,436 @@
+/**
+ * @file TimeSeriesStore.cpp
+ * @brief Implementation of the TimeSeriesStore class
+ */
+
+ #include "TimeSeriesStore.h"
+ #include "../core/AppCore.h"
+ #include "../system/LogManager.h"
+
+ namespace {
+     constexpr uint32_t SEGMENT_MAGIC = 0x31535354;   // "TSS1"
+     constexpr uint16_t SEGMENT_VERSION = 1;
+     constexpr size_t READ_CHUNK_RECORDS = 16;
+     constexpr uint32_t MAX_OFFSET_SECONDS = 0xFFFF;
+
+     // Buckets of different sensors close a reading apart, so records are only
+     // ordered to within one bucket; searches are widened by this much
+     constexpr uint32_t ORDER_SLACK_SECONDS = 120;
+ }
+
+ TimeSeriesStore::TimeSeriesStore() :
+     _activeSegment(0),
+     _activeSequence(0),
+     _activeBaseTime(0),
+     _activeRecords(0),
+     _batchCount(0),
+     _isInitialized(false),
+     _storeMutex(nullptr)
+ {
+ }
+
+ TimeSeriesStore::~TimeSeriesStore() {
+     // Clean up RTOS resources
+     if (_storeMutex != nullptr) {
+         vSemaphoreDelete(_storeMutex);
+     }
+ }
+
+ bool TimeSeriesStore::begin() {
+     // Create mutex for thread-safe operations
+     _storeMutex = xSemaphoreCreateMutex();
+     if (_storeMutex == nullptr) {
+         Serial.println("Failed to create time-series mutex!");
+         return false;
+     }
+
+     // Find the segment with the highest sequence number, that is where appends continue
+     bool found = false;
+     for (uint8_t i = 0; i < Constants::TIME_SERIES_SEGMENT_COUNT; i++) {
+         SegmentHeader header;
+         if (!readHeader(i, header)) {
+             continue;
+         }
+
+         if (!found || header.sequence > _activeSequence) {
+             File file = SPIFFS.open(segmentPath(i), FILE_READ);
+             size_t size = file ? file.size() : 0;
+             if (file) {
+                 file.close();
+             }
+
+             _activeSegment = i;
+             _activeSequence = header.sequence;
+             _activeBaseTime = header.baseTime;
+             _activeRecords = (size - sizeof(SegmentHeader)) / sizeof(Record);
+             found = true;
+         }
+     }
+
+     _isInitialized = true;
+
+     if (found) {
+         LOG_INFO("TimeSeries", "Resuming segment %u with %zu records",
+             _activeSegment, _activeRecords);
+     } else {
+         LOG_INFO("TimeSeries", "No stored history found");
+     }
+     return true;
+ }
+
+ void TimeSeriesStore::append(uint8_t sensorId, const SensorRollup& rollup) {
+     // Records before NTP sync carry uptime instead of wall-clock time, drop them
+     if (!_isInitialized || rollup.timestamp < Constants::MIN_VALID_EPOCH) {
+         return;
+     }
+
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storeMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         _batch[_batchCount].sensorId = sensorId;
+         _batch[_batchCount].rollup = rollup;
+         _batchCount++;
+
+         // Write a full block at once to keep flash writes few and large
+         if (_batchCount >= Constants::TIME_SERIES_BATCH_RECORDS) {
+             writeBatch();
+         }
+
+         // Release mutex
+         xSemaphoreGive(_storeMutex);
+     }
+ }
+
+ bool TimeSeriesStore::flush() {
+     if (!_isInitialized) {
+         return false;
+     }
+
+     bool success = false;
+
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storeMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         success = writeBatch();
+
+         // Release mutex
+         xSemaphoreGive(_storeMutex);
+     }
+
+     return success;
+ }
+
+ size_t TimeSeriesStore::readRange(uint32_t from, uint32_t to, const TimeSeriesCallback& callback) {
+     if (!_isInitialized || from > to) {
+         return 0;
+     }
+
+     size_t delivered = 0;
+
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storeMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         // Collect valid segments and order them by sequence (oldest first)
+         uint8_t order[Constants::TIME_SERIES_SEGMENT_COUNT];
+         SegmentHeader headers[Constants::TIME_SERIES_SEGMENT_COUNT];
+         uint8_t segmentCount = 0;
+
+         for (uint8_t i = 0; i < Constants::TIME_SERIES_SEGMENT_COUNT; i++) {
+             if (readHeader(i, headers[i])) {
+                 uint8_t pos = segmentCount++;
+                 while (pos > 0 && headers[order[pos - 1]].sequence > headers[i].sequence) {
+                     order[pos] = order[pos - 1];
+                     pos--;
+                 }
+                 order[pos] = i;
+             }
+         }
+
+         for (uint8_t n = 0; n < segmentCount; n++) {
+             const SegmentHeader& header = headers[order[n]];
+
+             // Skip segments that cannot overlap the requested range
+             if (header.baseTime > to + ORDER_SLACK_SECONDS ||
+                 header.baseTime + MAX_OFFSET_SECONDS + ORDER_SLACK_SECONDS < from) {
+                 continue;
+             }
+
+             delivered += readSegment(order[n], header, from, to, callback);
+         }
+
+         // Release mutex
+         xSemaphoreGive(_storeMutex);
+     }
+
+     return delivered;
+ }
+
+ uint32_t TimeSeriesStore::getNewestTimestamp() {
+     if (!_isInitialized) {
+         return 0;
+     }
+
+     uint32_t newest = 0;
+
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storeMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         if (_batchCount > 0) {
+             newest = _batch[_batchCount - 1].rollup.timestamp;
+         } else if (_activeRecords > 0) {
+             File file = SPIFFS.open(segmentPath(_activeSegment), FILE_READ);
+             if (file) {
+                 Record record;
+                 file.seek(sizeof(SegmentHeader) + (_activeRecords - 1) * sizeof(Record));
+                 if (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record)) {
+                     newest = _activeBaseTime + record.offsetSeconds;
+                 }
+                 file.close();
+             }
+         }
+
+         // Release mutex
+         xSemaphoreGive(_storeMutex);
+     }
+
+     return newest;
+ }
+
+ void TimeSeriesStore::clear() {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_storeMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+         for (uint8_t i = 0; i < Constants::TIME_SERIES_SEGMENT_COUNT; i++) {
+             String path = segmentPath(i);
+             if (SPIFFS.exists(path)) {
+                 SPIFFS.remove(path);
+             }
+         }
+
+         _activeSegment = 0;
+         _activeSequence = 0;
+         _activeBaseTime = 0;
+         _activeRecords = 0;
+         _batchCount = 0;
+
+         // Release mutex
+         xSemaphoreGive(_storeMutex);
+     }
+
+     LOG_INFO("TimeSeries", "Stored history cleared");
+ }
+
+ String TimeSeriesStore::segmentPath(uint8_t index) {
+     char path[32];
+     snprintf(path, sizeof(path), "%s/seg%02u.bin", Constants::TIME_SERIES_DIR, index);
+     return String(path);
+ }
+
+ bool TimeSeriesStore::readHeader(uint8_t index, SegmentHeader& header) {
+     String path = segmentPath(index);
+     if (!SPIFFS.exists(path)) {
+         return false;
+     }
+
+     File file = SPIFFS.open(path, FILE_READ);
+     if (!file) {
+         return false;
+     }
+
+     size_t read = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header));
+     file.close();
+
+     return read == sizeof(header) &&
+            header.magic == SEGMENT_MAGIC &&
+            header.version == SEGMENT_VERSION &&
+            header.recordSize == sizeof(Record);
+ }
+
+ bool TimeSeriesStore::startSegment(uint8_t index, uint32_t sequence, uint32_t baseTime) {
+     String path = segmentPath(index);
+
+     // Recycle the slot, dropping the oldest data it held
+     if (SPIFFS.exists(path)) {
+         SPIFFS.remove(path);
+     }
+
+     File file = SPIFFS.open(path, FILE_WRITE);
+     if (!file) {
+         LOG_ERROR("TimeSeries", "Failed to create segment %s", path.c_str());
+         return false;
+     }
+
+     SegmentHeader header;
+     header.magic = SEGMENT_MAGIC;
+     header.version = SEGMENT_VERSION;
+     header.recordSize = sizeof(Record);
+     header.sequence = sequence;
+     header.baseTime = baseTime;
+
+     bool success = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+     file.close();
+
+     if (success) {
+         _activeSegment = index;
+         _activeSequence = sequence;
+         _activeBaseTime = baseTime;
+         _activeRecords = 0;
+     }
+
+     return success;
+ }
+
+ bool TimeSeriesStore::writeBatch() {
+     if (_batchCount == 0) {
+         return true;
+     }
+
+     const size_t maxRecords = (Constants::TIME_SERIES_SEGMENT_SIZE - sizeof(SegmentHeader)) / sizeof(Record);
+     Record encoded[Constants::TIME_SERIES_BATCH_RECORDS];
+     size_t encodedCount = 0;
+     bool success = true;
+     File file;
+
+     for (size_t i = 0; i < _batchCount && success; i++) {
+         const SensorRollup& rollup = _batch[i].rollup;
+
+         // Rotate when the segment is full or the offset no longer fits in 16 bits
+         bool needsNewSegment = _activeBaseTime == 0 ||
+                                _activeRecords >= maxRecords ||
+                                rollup.timestamp < _activeBaseTime ||
+                                rollup.timestamp - _activeBaseTime > MAX_OFFSET_SECONDS;
+
+         if (needsNewSegment) {
+             // Write out what belongs to the current segment first
+             if (encodedCount > 0) {
+                 size_t bytes = encodedCount * sizeof(Record);
+                 success = file.write(reinterpret_cast<const uint8_t*>(encoded), bytes) == bytes;
+                 encodedCount = 0;
+             }
+             if (file) {
+                 file.close();
+             }
+
+             uint8_t next = (_activeBaseTime == 0) ? _activeSegment
+                                                   : (_activeSegment + 1) % Constants::TIME_SERIES_SEGMENT_COUNT;
+             success = success && startSegment(next, _activeSequence + 1, rollup.timestamp);
+         }
+
+         if (success && !file) {
+             file = SPIFFS.open(segmentPath(_activeSegment), FILE_APPEND);
+             success = (bool)file;
+         }
+
+         if (success) {
+             encoded[encodedCount++] = encode(_batch[i], _activeBaseTime);
+             _activeRecords++;
+         }
+     }
+
+     // Write the remaining block in one go
+     if (success && encodedCount > 0) {
+         size_t bytes = encodedCount * sizeof(Record);
+         success = file.write(reinterpret_cast<const uint8_t*>(encoded), bytes) == bytes;
+     }
+
+     if (file) {
+         file.close();
+     }
+
+     if (!success) {
+         LOG_ERROR("TimeSeries", "Failed to write %zu history records", _batchCount);
+     }
+
+     _batchCount = 0;
+     return success;
+ }
+
+ size_t TimeSeriesStore::readSegment(uint8_t index, const SegmentHeader& header, uint32_t from, uint32_t to,
+                                     const TimeSeriesCallback& callback) {
+     File file = SPIFFS.open(segmentPath(index), FILE_READ);
+     if (!file) {
+         return 0;
+     }
+
+     size_t recordCount = (file.size() - sizeof(SegmentHeader)) / sizeof(Record);
+     uint32_t searchFrom = from > ORDER_SLACK_SECONDS ? from - ORDER_SLACK_SECONDS : 0;
+
+     // Binary search over file offsets for the first record at or after searchFrom
+     size_t low = 0;
+     size_t high = recordCount;
+     while (low < high) {
+         size_t mid = (low + high) / 2;
+         Record record;
+         file.seek(sizeof(SegmentHeader) + mid * sizeof(Record));
+         if (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+             high = mid;
+             continue;
+         }
+
+         if (header.baseTime + record.offsetSeconds < searchFrom) {
+             low = mid + 1;
+         } else {
+             high = mid;
+         }
+     }
+
+     // Scan forward in chunks until we pass the end of the range
+     size_t delivered = 0;
+     Record chunk[READ_CHUNK_RECORDS];
+     file.seek(sizeof(SegmentHeader) + low * sizeof(Record));
+
+     for (size_t pos = low; pos < recordCount; ) {
+         size_t want = min(READ_CHUNK_RECORDS, recordCount - pos);
+         size_t got = file.read(reinterpret_cast<uint8_t*>(chunk), want * sizeof(Record)) / sizeof(Record);
+         if (got == 0) {
+             break;
+         }
+
+         for (size_t i = 0; i < got; i++) {
+             uint32_t timestamp = header.baseTime + chunk[i].offsetSeconds;
+             if (timestamp > to + ORDER_SLACK_SECONDS) {
+                 file.close();
+                 return delivered;
+             }
+             if (timestamp >= from && timestamp <= to) {
+                 callback(chunk[i].sensorId, decode(chunk[i], header.baseTime));
+                 delivered++;
+             }
+         }
+
+         pos += got;
+     }
+
+     file.close();
+     return delivered;
+ }
+
+ TimeSeriesStore::Record TimeSeriesStore::encode(const PendingRecord& pending, uint32_t baseTime) {
+     const SensorRollup& rollup = pending.rollup;
+
+     Record record;
+     record.offsetSeconds = (uint16_t)(rollup.timestamp - baseTime);
+     record.sensorId = pending.sensorId;
+     record.count = (uint8_t)min((uint16_t)255, rollup.count);
+     record.temperatureMin = rollup.temperatureMin;
+     record.temperatureAvg = rollup.temperatureAvg;
+     record.temperatureMax = rollup.temperatureMax;
+     record.humidityMin = rollup.humidityMin;
+     record.humidityAvg = rollup.humidityAvg;
+     record.humidityMax = rollup.humidityMax;
+     record.co2Min = rollup.co2Min;
+     record.co2Avg = rollup.co2Avg;
+     record.co2Max = rollup.co2Max;
+     return record;
+ }
+
+ SensorRollup TimeSeriesStore::decode(const Record& record, uint32_t baseTime) {
+     SensorRollup rollup;
+     rollup.timestamp = baseTime + record.offsetSeconds;
+     rollup.count = record.count;
+     rollup.temperatureMin = record.temperatureMin;
+     rollup.temperatureAvg = record.temperatureAvg;
+     rollup.temperatureMax = record.temperatureMax;
+     rollup.humidityMin = record.humidityMin;
+     rollup.humidityAvg = record.humidityAvg;
+     rollup.humidityMax = record.humidityMax;
+     rollup.co2Min = record.co2Min;
+     rollup.co2Avg = record.co2Avg;
+     rollup.co2Max = record.co2Max;
+     return rollup;
+ }
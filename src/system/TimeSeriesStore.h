@@ -0,0 +1,136 @@
+/**
+ * @file TimeSeriesStore.h
+ * @brief Append-only binary time-series log of sensor rollups on SPIFFS
+ */
+
+ #ifndef TIME_SERIES_STORE_H
+ #define TIME_SERIES_STORE_H
+
+ #include <Arduino.h>
+ #include <SPIFFS.h>
+ #include <functional>
+ #include <freertos/FreeRTOS.h>
+ #include <freertos/semphr.h>
+ #include "../utils/Constants.h"
+ #include "../components/SensorHistory.h"
+
+ /**
+  * @brief Callback invoked for each record returned by a range read
+  * @param sensorId 0 for upper DHT22, 1 for lower DHT22, 2 for SCD40, 3 for the fused tent reading
+  * @param rollup Decoded 1-minute bucket (timestamp in Unix seconds)
+  */
+ typedef std::function<void(uint8_t sensorId, const SensorRollup& rollup)> TimeSeriesCallback;
+
+ /**
+  * @class TimeSeriesStore
+  * @brief Persists 1-minute sensor rollups in rotating fixed-record segment files
+  *
+  * Each segment starts with a small header holding its sequence number and a
+  * base timestamp; records store a 16-bit second offset from that base plus
+  * the fixed-point min/avg/max values, so every record has the same size and
+  * a timestamp can be located inside a segment with a binary search over file
+  * offsets. Records are batched in RAM and written one block at a time. When
+  * a segment is full (or its offset range is exhausted) the next segment slot
+  * is recycled, in the same spirit as LogManager::rotateLogFile.
+  */
+ class TimeSeriesStore {
+ public:
+     TimeSeriesStore();
+     ~TimeSeriesStore();
+
+     /**
+      * @brief Mount the store and locate the newest segment
+      * @return True if initialized successfully
+      */
+     bool begin();
+
+     /**
+      * @brief Queue a closed 1-minute bucket for persistence
+      * @param sensorId 0 for upper DHT22, 1 for lower DHT22, 2 for SCD40, 3 for the fused tent reading
+      * @param rollup Bucket to store (ignored until the clock is set)
+      */
+     void append(uint8_t sensorId, const SensorRollup& rollup);
+
+     /**
+      * @brief Write all batched records to flash
+      * @return True if the batch was written (or was empty)
+      */
+     bool flush();
+
+     /**
+      * @brief Read all records with a timestamp in [from, to], oldest segment first
+      * @param from Range start in Unix seconds
+      * @param to Range end in Unix seconds
+      * @param callback Called once per matching record
+      * @return Number of records delivered
+      */
+     size_t readRange(uint32_t from, uint32_t to, const TimeSeriesCallback& callback);
+
+     /**
+      * @brief Get the timestamp of the most recently appended record
+      * @return Unix seconds, 0 if the store is empty
+      */
+     uint32_t getNewestTimestamp();
+
+     /**
+      * @brief Delete all segments and pending records
+      */
+     void clear();
+
+ private:
+     struct __attribute__((packed)) SegmentHeader {
+         uint32_t magic;
+         uint16_t version;
+         uint16_t recordSize;
+         uint32_t sequence;
+         uint32_t baseTime;
+     };
+
+     struct __attribute__((packed)) Record {
+         uint16_t offsetSeconds;
+         uint8_t sensorId;
+         uint8_t count;
+         int16_t temperatureMin;
+         int16_t temperatureAvg;
+         int16_t temperatureMax;
+         int16_t humidityMin;
+         int16_t humidityAvg;
+         int16_t humidityMax;
+         uint16_t co2Min;
+         uint16_t co2Avg;
+         uint16_t co2Max;
+     };
+
+     struct PendingRecord {
+         uint8_t sensorId;
+         SensorRollup rollup;
+     };
+
+     // Segment state
+     uint8_t _activeSegment;
+     uint32_t _activeSequence;
+     uint32_t _activeBaseTime;
+     size_t _activeRecords;
+
+     // Write batch
+     PendingRecord _batch[Constants::TIME_SERIES_BATCH_RECORDS];
+     size_t _batchCount;
+
+     // Status tracking
+     bool _isInitialized;
+
+     // RTOS resources
+     SemaphoreHandle_t _storeMutex;
+
+     // Private methods
+     String segmentPath(uint8_t index);
+     bool readHeader(uint8_t index, SegmentHeader& header);
+     bool startSegment(uint8_t index, uint32_t sequence, uint32_t baseTime);
+     bool writeBatch();
+     size_t readSegment(uint8_t index, const SegmentHeader& header, uint32_t from, uint32_t to,
+                        const TimeSeriesCallback& callback);
+     static Record encode(const PendingRecord& pending, uint32_t baseTime);
+     static SensorRollup decode(const Record& record, uint32_t baseTime);
+ };
+
+ #endif // TIME_SERIES_STORE_H
@@ -27,14 +27,36 @@
      // Default pin assignments for sensors
      constexpr uint8_t DEFAULT_DHT1_PIN = 13;    // Upper DHT
      constexpr uint8_t DEFAULT_DHT2_PIN = 14;    // Lower DHT
+     constexpr uint8_t DHT1_RMT_CHANNEL = 2;     // RMT receive channel of the upper DHT
+     constexpr uint8_t DHT2_RMT_CHANNEL = 3;     // RMT receive channel of the lower DHT
      constexpr uint8_t DEFAULT_SCD40_SDA_PIN = 21;
      constexpr uint8_t DEFAULT_SCD40_SCL_PIN = 22;
+     constexpr uint8_t DISPLAY_I2C_ADDRESS = 0x3C;  // SSD1306 on the SCD40's bus
      
      // Default values for sensor reading intervals
      constexpr uint16_t DEFAULT_DHT_READ_INTERVAL_MS = 5000;      // 5 seconds
      constexpr uint16_t DEFAULT_SCD40_READ_INTERVAL_MS = 10000;   // 10 seconds
+     constexpr uint8_t SENSOR_FUSION_MEDIAN_WINDOW = 5;           // Samples per channel in the spike filter
+     constexpr float SENSOR_FUSION_EMA_ALPHA = 0.3f;              // Weight of a new median in the average
+     constexpr uint32_t SENSOR_FUSION_MAX_AGE_S = 60;             // Sensors without a newer sample drop out of the tent reading
+     constexpr float SENSOR_FUSION_TEMPERATURE_TOLERANCE = 2.0f;  // °C a sensor may differ from the others
+     constexpr float SENSOR_FUSION_HUMIDITY_TOLERANCE = 8.0f;     // %RH a sensor may differ from the others
+     constexpr uint16_t SCD40_ALTITUDE_M = 0;                     // Site altitude fed to the SCD40's pressure compensation
+     constexpr uint16_t SCD40_PERIODIC_MS = 5000;                 // Sample period in periodic mode
+     constexpr uint16_t SCD40_LOW_POWER_MS = 30000;               // Sample period in low-power periodic mode
+     constexpr uint16_t SCD40_SINGLE_SHOT_MS = 5000;              // Conversion time of a single shot
+     constexpr uint16_t SCD40_READY_LEAD_MS = 100;                // Start polling this long before a sample is due
+     constexpr uint16_t SCD40_READY_POLL_MS = 25;                 // Data-ready poll period
+     constexpr uint16_t SCD40_READY_TIMEOUT_MS = 1000;            // Poll time past the lead before a read counts as failed
      constexpr uint16_t DEFAULT_GRAPH_UPDATE_INTERVAL_MS = 30000; // 30 seconds
      constexpr uint16_t DEFAULT_GRAPH_MAX_POINTS = 100;
+     constexpr uint16_t GRAPH_MAX_POINTS = 720;                   // Upper bound for ?points=, a stream caches 20 bytes per point
+     constexpr size_t GRAPH_READ_BATCH_POINTS = 16;               // Points fetched per lock when streaming a graph
+     constexpr uint16_t DEFAULT_HISTORY_MAX_POINTS = 360;         // 30 minutes at the DHT rate
+     constexpr uint16_t MAX_HISTORY_POINTS = 2880;
+     constexpr uint16_t HISTORY_MINUTE_POINTS = 180;              // 3 hours of 1-minute buckets
+     constexpr uint16_t HISTORY_QUARTER_HOUR_POINTS = 96;         // 24 hours of 15-minute buckets
+     constexpr uint16_t HISTORY_HOUR_POINTS = 168;                // 7 days of 1-hour buckets
      
      // Default environmental thresholds
      constexpr float DEFAULT_HUMIDITY_LOW_THRESHOLD = 50.0f;
@@ -48,11 +70,34 @@
      constexpr uint16_t DEFAULT_USER_OVERRIDE_TIME_MIN = 5;      // 5 minutes
      constexpr uint16_t DEFAULT_FANS_ON_DURATION_MIN = 5;        // 5 minutes
      constexpr uint16_t DEFAULT_FANS_CYCLE_INTERVAL_MIN = 60;    // 60 minutes
+     constexpr uint32_t RELAY_CONTROL_MAX_SLEEP_MS = 60000;      // Re-check at least once a minute (clock adjustments)
+     constexpr size_t SCHEDULE_PREVIEW_MAX_EVENTS = 32;          // Slots returned by /api/relays/schedule
+     
+     // Default tuning for environmental control loops (humidifier, heater)
+     constexpr float DEFAULT_CONTROL_KP = 0.1f;                  // 10% duty per °C or %RH of error
+     constexpr float DEFAULT_CONTROL_KI = 0.0005f;               // Per unit of error per second
+     constexpr float DEFAULT_CONTROL_KD = 0.0f;
+     constexpr uint16_t DEFAULT_CONTROL_WINDOW_SECONDS = 300;    // PID time-proportioning period
+     constexpr uint16_t DEFAULT_CONTROL_MIN_ON_SECONDS = 60;
+     constexpr uint16_t DEFAULT_CONTROL_MIN_OFF_SECONDS = 60;
      
      // Web server related constants
      constexpr uint16_t DEFAULT_WEB_SERVER_PORT = 80;
+     constexpr uint16_t DEFAULT_HTTPS_PORT = 443;
+     constexpr uint8_t HTTPS_MAX_CONNECTIONS = 3;                // Open TLS connections, further clients wait in the accept backlog
+     constexpr uint32_t HTTPS_LOOP_INTERVAL_MS = 5;              // Pause between passes over the connections
+     constexpr size_t HTTPS_CERT_BUFFER_SIZE = 1024;             // DER certificate or key being written
+     constexpr const char* HTTPS_CERT_SUBJECT = "CN=mushroom.local,O=MushroomTentController,C=US";
      constexpr uint16_t DEFAULT_DEBUG_PORT = 23;
      constexpr uint16_t DEFAULT_OTA_PORT = 3232;
+     constexpr size_t OTA_STREAM_CHUNK_SIZE = 1024;              // Bytes hashed and written per pass
+     constexpr uint32_t OTA_STREAM_TIMEOUT_MS = 15000;           // Stall allowed before a pull update is aborted
+     // PEM public key (ECDSA P-256) that signs the update manifests, pull updates are refused while empty
+     constexpr const char* OTA_SIGNING_PUBLIC_KEY = "";
+     // PEM root CA of the update server, https manifest, image and delta URLs are refused while empty
+     constexpr const char* OTA_SERVER_CA_CERT = "";
+     constexpr uint8_t LIVE_EVENT_QUEUE_SIZE = 16;               // Pending server-sent events
+     constexpr const char* STATIC_CACHE_CONTROL = "no-cache";  // Always revalidated, an unchanged file costs a 304
      constexpr const char* DEFAULT_AP_SSID = "MushroomTent-Setup";
      constexpr const char* DEFAULT_AP_PASSWORD = "mushroom";     // Empty for open network
      constexpr const char* DEFAULT_HOSTNAME = "mushroom";
@@ -60,6 +105,29 @@
      // Security constants
      constexpr const char* DEFAULT_HTTP_USERNAME = "admin";
      constexpr const char* DEFAULT_HTTP_PASSWORD = "admin";
+     constexpr const char* HTTP_SESSION_COOKIE = "session";
+     constexpr uint8_t HTTP_SESSION_SLOTS = 4;                   // Concurrent logged-in browsers
+     constexpr size_t HTTP_SESSION_TOKEN_LENGTH = 32;            // 192 bits from esp_random()
+     constexpr uint32_t HTTP_SESSION_TTL_MS = 3600000;           // Idle time before a session expires
+     constexpr uint32_t PASSWORD_KDF_ITERATIONS = 2048;          // PBKDF2-HMAC-SHA256 rounds, hardware SHA
+     constexpr size_t PASSWORD_SALT_SIZE = 16;
+     constexpr size_t CRYPTO_GCM_IV_SIZE = 12;                   // AES-GCM nonce, random per message
+     constexpr size_t CRYPTO_GCM_TAG_SIZE = 16;
+     constexpr size_t CRYPTO_BENCH_BYTES = 4096;                 // Buffer hashed/encrypted by the boot benchmark
+     constexpr uint8_t CRYPTO_BENCH_ROUNDS = 8;
+     constexpr uint16_t BENCH_GRAPH_POINTS = 500;               // Points per graph serialization
+     constexpr uint8_t BENCH_GRAPH_ROUNDS = 4;
+     constexpr uint16_t BENCH_SCHEDULE_ROUNDS = 1440;            // One update per minute of a day
+     constexpr uint16_t BENCH_LOG_ROUNDS = 500;
+     constexpr uint16_t BENCH_RING_ROUNDS = 2000;
+     constexpr uint16_t BENCH_HELPER_ROUNDS = 500;
+     constexpr size_t BENCH_SPIFFS_BYTES = 32768;               // Written and read back sequentially
+     constexpr const char* BENCH_TEMP_FILE = "/bench.tmp";
+     constexpr uint8_t BENCH_NVS_ROUNDS = 8;
+     constexpr uint16_t BENCH_JSON_ROUNDS = 200;
+     constexpr uint32_t BENCH_RTT_TIMEOUT_MS = 3000;
+     constexpr const char* BENCH_RESULTS_FILE = "/config/benchmarks.json";
+     constexpr uint8_t BENCH_HISTORY_RUNS = 8;                  // Newest runs kept, across firmware versions
      
      // MQTT related constants
      constexpr const char* DEFAULT_MQTT_BROKER = "192.168.1.100";
@@ -67,19 +135,93 @@
      constexpr const char* DEFAULT_MQTT_TOPIC = "mushroom/tent";
      constexpr const char* DEFAULT_MQTT_USERNAME = "mqtt";
      constexpr const char* DEFAULT_MQTT_PASSWORD = "mqtt";
+     constexpr uint8_t MQTT_POOL_SLOTS = 8;                 // Preallocated publish messages
+     constexpr size_t MQTT_TOPIC_SIZE = 96;
+     constexpr size_t MQTT_PAYLOAD_SIZE = 1024;             // Fits the relay status of all 8 relays
+     constexpr size_t MQTT_JSON_DOC_SIZE = 2048;            // Shared document for the periodic publishes
+     constexpr uint32_t MQTT_SENSOR_CHECK_MS = 1000;        // How often readings are compared to the last publish
+     constexpr uint32_t MQTT_SENSOR_MIN_INTERVAL_MS = 5000; // Rate limit for sensor changes
+     constexpr uint32_t MQTT_SYSTEM_INTERVAL_MS = 60000;    // System status is not change-driven
+     constexpr uint32_t DEFAULT_MQTT_HEARTBEAT_SECONDS = 300;
+     constexpr float DEFAULT_MQTT_DEADBAND_TEMPERATURE = 0.2f;  // °C
+     constexpr float DEFAULT_MQTT_DEADBAND_HUMIDITY = 1.0f;     // %RH
+     constexpr float DEFAULT_MQTT_DEADBAND_CO2 = 25.0f;         // ppm
+     constexpr const char* MQTT_BACKLOG_DIR = "/mqtt";
+     constexpr size_t MQTT_BACKLOG_RAM_SAMPLES = 64;        // Unsent samples kept in RAM before spilling
+     constexpr size_t MQTT_BACKLOG_SEGMENT_SIZE = 16 * 1024; // About 334 samples of 49 bytes per segment, two segments
+     constexpr bool DEFAULT_MQTT_BACKLOG_SPILL = true;
+     constexpr uint8_t MQTT_REPLAY_BATCH = 4;               // Samples replayed per batch after a reconnect
+     constexpr uint32_t MQTT_REPLAY_INTERVAL_MS = 200;      // Pause between replay batches
+     constexpr const char* MQTT_HA_DISCOVERY_PREFIX = "homeassistant";
+     constexpr const char* MQTT_HA_STATUS_TOPIC = "homeassistant/status";  // "online" when Home Assistant restarts
+     constexpr bool DEFAULT_MQTT_HA_DISCOVERY = true;
+     constexpr uint8_t MQTT_DISCOVERY_BATCH = 4;            // Discovery configs published per MQTT task pass
+     constexpr uint16_t MQTT_KEEPALIVE_SECONDS = 60;        // Also bounds how long a connected device light sleeps
+     constexpr uint8_t MQTT_COMMAND_ROUTE_SLOTS = 16;       // Hash table of command topics, power of two
+     
+     // Notification constants
+     constexpr uint8_t NOTIFICATION_QUEUE_SIZE = 16;             // Records waiting for the dispatcher
+     constexpr uint8_t NOTIFICATION_CHANNEL_QUEUE_SIZE = 8;      // Records waiting per HTTP channel
+     constexpr uint8_t NOTIFICATION_BATCH_MAX = 8;               // Records sent in one Telegram/webhook call
+     constexpr size_t NOTIFICATION_SOURCE_SIZE = 16;
+     constexpr size_t NOTIFICATION_TITLE_SIZE = 48;
+     constexpr size_t NOTIFICATION_MESSAGE_SIZE = 160;
+     
+     // Tapo constants
+     constexpr uint8_t TAPO_POLL_WORKERS = 3;                    // Devices polled at the same time
+     constexpr uint8_t TAPO_POLL_QUEUE_SIZE = 16;                // Devices waiting for a poll worker
+     constexpr size_t TAPO_DEVICE_ID_SIZE = 48;                  // Tapo device IDs are 40 hex characters
+     constexpr uint32_t TAPO_POLL_INTERVAL_MS = 30000;           // Status sweep of all devices
+     constexpr uint32_t TAPO_STATUS_TTL_MS = 60000;              // Older cached status is refreshed when read
+     constexpr uint32_t TAPO_SESSION_MAX_MS = 3600000;           // Handshake again after this, even if the device allows longer
+     constexpr uint32_t TAPO_HTTP_TIMEOUT_MS = 3000;
+     constexpr size_t TAPO_STATUS_DOC_SIZE = 256;                // Filtered get_device_info response
+     constexpr uint8_t TAPO_MAX_DEVICES = 16;                    // One poll queue slot per device
+     constexpr size_t TAPO_DEVICES_DOC_SIZE = 4096;              // TAPO_MAX_DEVICES saved devices
      
      // File system constants
      constexpr const char* DEFAULT_CONFIG_FILE = "/config/default_config.json";
      constexpr const char* PROFILES_FILE = "/config/profiles.json";
+     constexpr uint8_t MAX_PROFILES = 16;
+     constexpr uint8_t PROFILE_INDEX_SLOTS = 32;            // Power of two, twice MAX_PROFILES
+     constexpr const char* PROFILES_TEMP_FILE = "/config/profiles.tmp";  // Written first, then renamed
+     constexpr uint32_t PROFILE_SAVE_DEBOUNCE_MS = 2000;    // Quiet time after the last edit before writing
+     constexpr uint32_t PROFILE_SAVE_MAX_DELAY_MS = 10000;  // Upper bound while edits keep arriving
+     constexpr const char* GROW_PHASES_FILE = "/config/grow_phases.json";
+     constexpr uint8_t MAX_GROW_PHASES = 8;
      constexpr const char* NETWORK_CONFIG_FILE = "/config/network.json";
+     constexpr const char* TAPO_DEVICES_FILE = "/config/tapo_devices.json";
+     constexpr size_t FILE_CHUNK_SIZE = 512;                // Buffer of the streaming file APIs, two SPIFFS pages
      
      // SPIFFS and NVS constants
      constexpr size_t MAX_LOG_FILE_SIZE = 50 * 1024;  // 50KB max log file size
      constexpr const char* LOG_FILE_PATH = "/logs/system.log";
+     constexpr size_t LOG_RING_RECORDS = 64;                      // Fixed-size records kept in RAM
+     constexpr size_t LOG_MODULE_NAME_SIZE = 16;
+     constexpr size_t LOG_RECORD_PAYLOAD_SIZE = 92;               // Keeps a LogRecord at 128 bytes
+     constexpr size_t LOG_LINE_SIZE = 192;                        // Formatted line incl. timestamp and module
+     constexpr size_t LOG_MAX_MODULE_LEVELS = 12;                 // Per-module runtime level overrides
+     constexpr size_t LOG_WRITE_BLOCK_SIZE = 512;                 // File write unit, two SPIFFS pages
+     constexpr uint16_t LOG_SYSLOG_DEFAULT_PORT = 514;
+     constexpr uint8_t LOG_SYSLOG_FACILITY = 16;                  // local0
+     constexpr size_t LOG_SYSLOG_DATAGRAM_SIZE = 1400;            // Stays below a 1500-byte MTU
+     constexpr uint8_t LOG_SYSLOG_DATAGRAMS_PER_CYCLE = 4;        // Send budget per log task pass
+     constexpr uint32_t LOG_SYSLOG_RESOLVE_RETRY_MS = 30000;
+     constexpr size_t LOG_SYSLOG_HOST_SIZE = 64;
+
+     // Time-series storage (1-minute rollups, 12 x 32KB segments = about 3 days for all series)
+     constexpr const char* TIME_SERIES_DIR = "/history";
+     constexpr uint8_t TIME_SERIES_SEGMENT_COUNT = 12;
+     constexpr size_t TIME_SERIES_SEGMENT_SIZE = 32 * 1024;
+     constexpr size_t TIME_SERIES_BATCH_RECORDS = 20;              // 5 minutes for the three sensors and the tent
+     constexpr uint32_t TIME_SERIES_RESTORE_SECONDS = 24UL * 3600UL;      // Replayed into RAM tiers at boot
+     constexpr uint32_t MIN_VALID_EPOCH = 1600000000UL;             // Anything earlier means NTP has not synced
      
      // NVS namespaces
      constexpr const char* NVS_WIFI_NAMESPACE = "bootwifi";
      constexpr const char* NVS_CONFIG_NAMESPACE = "config";
+     constexpr const char* NVS_SETTINGS_NAMESPACE = "settings";    // One typed blob per subsystem
+     constexpr size_t SETTINGS_BLOCK_MAX_SIZE = 256;                // Largest settings struct
      
      // NVS keys
      constexpr const char* NVS_WIFI_SSID1_KEY = "wifi_ssid1";
@@ -89,13 +231,40 @@
      constexpr const char* NVS_WIFI_SSID3_KEY = "wifi_ssid3";
      constexpr const char* NVS_WIFI_PASS3_KEY = "wifi_pass3";
      constexpr const char* NVS_HOSTNAME_KEY = "hostname";
+     constexpr const char* NVS_WIFI_FAST_KEY = "wifi_fast";    // Last access point and DHCP lease
      constexpr const char* NVS_HTTP_USER_KEY = "http_user";
      constexpr const char* NVS_HTTP_PASS_KEY = "http_pass";
+     constexpr const char* NVS_HTTPS_CERT_KEY = "https_cert";  // DER of the self-signed certificate
+     constexpr const char* NVS_HTTPS_PKEY_KEY = "https_pkey";  // DER of its P-256 private key
      
      // WiFi constants
      constexpr int32_t DEFAULT_MIN_RSSI = -80;         // Minimum acceptable RSSI value
      constexpr uint32_t WIFI_CONNECT_TIMEOUT = 10000;  // 10 second timeout for connection
-     constexpr uint32_t WIFI_CHECK_INTERVAL = 30000;   // Check WiFi every 30 seconds
+     constexpr uint32_t WIFI_FAST_CONNECT_TIMEOUT = 3000;  // Direct join of the cached access point
+     constexpr uint8_t WIFI_LEASE_MAX_REUSES = 8;      // Fast connects reusing a lease before asking DHCP again
+     constexpr uint32_t WIFI_SCAN_MAX_AGE_MS = 30000;  // Scan results served before a new scan is started
+     constexpr uint32_t WIFI_CHECK_INTERVAL = 30000;   // Longest retry backoff while disconnected
+     constexpr uint32_t WIFI_BACKOFF_MIN_MS = 1000;    // First retry delay, doubled per failed attempt
+     constexpr uint8_t WIFI_AP_FALLBACK_FAILURES = 5;  // Failed attempts before the configuration AP comes up
+     
+     // Power management
+     constexpr uint32_t POWER_CHECK_INTERVAL_MS = 60000;    // Power schedule evaluation
+     constexpr uint32_t LIGHT_SLEEP_MIN_MS = 50;            // Shorter idle windows are not worth a sleep
+     constexpr uint32_t LIGHT_SLEEP_GUARD_MS = 5;           // Wake this much before the deadline
+     constexpr uint32_t LIGHT_SLEEP_AWAKE_MS = 100;         // Time awake after a wakeup for due tasks to run
+     constexpr int8_t DEFAULT_WAKE_BUTTON_PIN = 0;          // Active-low button ending a sleep (BOOT), -1 for none
+     constexpr bool DEFAULT_POWER_DFS = true;               // Scale the CPU clock with load, WiFi modem sleep
+     constexpr int POWER_DFS_MAX_MHZ = 240;
+     constexpr int POWER_DFS_MIN_MHZ = 80;                  // Lowest clock that keeps the APB at 80 MHz
+     
+     // Status display
+     constexpr uint8_t DISPLAY_WIDTH = 128;
+     constexpr uint8_t DISPLAY_HEIGHT = 64;
+     constexpr uint32_t DISPLAY_I2C_CLOCK_HZ = 100000;      // The SCD40's bus clock, never switched for the display
+     constexpr uint32_t DISPLAY_FRAME_INTERVAL_MS = 500;    // At most two frames per second
+     constexpr uint8_t DISPLAY_CHUNK_BYTES = 32;             // Data bytes per I2C transaction, about 4 ms at 100 kHz with the address window
+     constexpr uint32_t DISPLAY_BUS_TIMEOUT_MS = 100;       // Give up on a frame if the bus stays busy this long
+     constexpr uint32_t I2C_RESERVATION_GUARD_MS = 10;      // Display stays off the bus this long before a sensor window
      
      // RTOS task priorities
      constexpr UBaseType_t PRIORITY_WIFI = 5;
@@ -104,14 +273,47 @@
      constexpr UBaseType_t PRIORITY_RELAY_CONTROL = 3;
      constexpr UBaseType_t PRIORITY_MQTT = 2;
      constexpr UBaseType_t PRIORITY_LOGGING = 1;
+     constexpr UBaseType_t PRIORITY_PROFILE_SAVE = 1;
+     constexpr UBaseType_t PRIORITY_SCHEDULER = 1;
+     constexpr UBaseType_t PRIORITY_BENCHMARK = 1;
+     constexpr UBaseType_t PRIORITY_OTA_PULL = 1;
+     constexpr UBaseType_t PRIORITY_NOTIFY_CHANNEL = 1;
+     constexpr UBaseType_t PRIORITY_TAPO = 1;
+     constexpr UBaseType_t PRIORITY_DISPLAY = 1;
      
      // RTOS task stack sizes (in words)
      constexpr uint32_t STACK_SIZE_WIFI = 4096;
      constexpr uint32_t STACK_SIZE_WEBSERVER = 8192;
+     constexpr uint32_t STACK_SIZE_WEB_EVENTS = 4096;
+     constexpr uint32_t STACK_SIZE_SECURE_WEB = 8192;           // TLS handshakes and the request handlers
      constexpr uint32_t STACK_SIZE_SENSORS = 4096;
      constexpr uint32_t STACK_SIZE_RELAY_CONTROL = 2048;
      constexpr uint32_t STACK_SIZE_MQTT = 4096;
      constexpr uint32_t STACK_SIZE_LOGGING = 2048;
+     constexpr uint32_t STACK_SIZE_PROFILE_SAVE = 4096;
+     constexpr uint32_t STACK_SIZE_SCHEDULER = 3072;            // Time sync, power schedule and maintenance jobs
+     constexpr uint32_t STACK_SIZE_BENCHMARK = 6144;
+     constexpr uint32_t STACK_SIZE_OTA_PULL = 8192;             // TLS handshake plus the chunk buffer
+     constexpr uint32_t STACK_SIZE_NOTIFY_CHANNEL = 8192;       // TLS session plus a batch of records
+     constexpr uint32_t STACK_SIZE_TAPO = 2048;
+     constexpr uint32_t STACK_SIZE_TAPO_WORKER = 6144;          // HTTP client plus the AES and hash contexts
+     constexpr uint32_t STACK_SIZE_DISPLAY = 3072;
+     
+     // Job scheduler
+     constexpr uint8_t SCHEDULER_MAX_JOBS = 8;              // Low-rate periodic jobs sharing the scheduler task
+     
+     // Task statistics (TASK_STATS_ENABLED builds)
+     constexpr uint8_t TASK_STATS_LOOP_SLOTS = 16;          // Application tasks reporting their loop period
+     constexpr uint8_t TASK_STATS_MAX_TASKS = 40;           // Including the framework's own tasks
+     
+     // Heap telemetry
+     constexpr size_t HEAP_HISTORY_SAMPLES = 144;           // 12 hours at one sample per interval
+     constexpr uint32_t HEAP_SAMPLE_INTERVAL_MS = 300000;
+     constexpr uint8_t HEAP_TRACKING_MAX_TASKS = 40;        // HEAP_TRACKING_ENABLED builds
+     
+     // Latency histograms
+     constexpr uint8_t LATENCY_PROBE_SLOTS = 48;            // Instrumented call sites
+     constexpr uint8_t LATENCY_BUCKETS = 20;                // log2 microsecond buckets, the last one is 0.5 s and up
  }
  
  // Enum definitions
@@ -130,6 +332,12 @@
      HIBERNATION
  };
  
+ enum class ScdMode : uint8_t {
+     PERIODIC = 0,       // New sample every 5 s
+     LOW_POWER,          // New sample every 30 s
+     SINGLE_SHOT         // Idle between reads, one conversion per read
+ };
+ 
  enum class RelayState : uint8_t {
      OFF = 0,
      ON = 1,
@@ -143,4 +351,9 @@
      DEPENDENT
  };
  
+ enum class RelayBackendType : uint8_t {
+     GPIO = 0,           // Relay module on a pin
+     TAPO                // Tapo plug with a matching relay replacement
+ };
+ 
  #endif // CONSTANTS_H
\ No newline at end of file
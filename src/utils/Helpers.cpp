@@ -78,6 +78,15 @@
      return ~crc;
  }
  
+ uint32_t hashFNV1a(const char* text, uint32_t seed) {
+     uint32_t hash = seed;
+     while (*text) {
+         hash ^= static_cast<uint8_t>(*text++);
+         hash *= 16777619UL;
+     }
+     return hash;
+ }
+ 
  String base64Encode(const String& input) {
      size_t inputLen = input.length();
      size_t outputLen = 0;
@@ -123,4 +132,25 @@
      
      return result;
  }
+ String formatDuration(uint64_t milliseconds) {
+     uint64_t seconds = milliseconds / 1000;
+     unsigned long days = static_cast<unsigned long>(seconds / 86400);
+     unsigned int hours = static_cast<unsigned int>(seconds / 3600 % 24);
+     unsigned int minutes = static_cast<unsigned int>(seconds / 60 % 60);
+     unsigned int secs = static_cast<unsigned int>(seconds % 60);
+     
+     // Leading zero units are left out, e.g. "3h 2m 1s"
+     char buffer[40];
+     if (days > 0) {
+         snprintf(buffer, sizeof(buffer), "%lud %uh %um %us", days, hours, minutes, secs);
+     } else if (hours > 0) {
+         snprintf(buffer, sizeof(buffer), "%uh %um %us", hours, minutes, secs);
+     } else if (minutes > 0) {
+         snprintf(buffer, sizeof(buffer), "%um %us", minutes, secs);
+     } else {
+         snprintf(buffer, sizeof(buffer), "%us", secs);
+     }
+     
+     return String(buffer);
+ }
  } // End of namespace Helpers
\ No newline at end of file
@@ -40,6 +40,14 @@
       */
      uint32_t calculateCRC32(const uint8_t* data, size_t len);
      
+     /**
+      * @brief Calculate the 32-bit FNV-1a hash of a string
+      * @param text Null-terminated string
+      * @param seed Starting value, pass a previous hash to chain strings
+      * @return FNV-1a hash
+      */
+     uint32_t hashFNV1a(const char* text, uint32_t seed = 2166136261UL);
+     
      /**
       * @brief Encode a string to Base64
       * @param input Input string
@@ -0,0 +1,135 @@
+/**
+ * @file RingBuffer.h
+ * @brief Fixed-capacity ring buffer with index-based readout
+ */
+
+ #ifndef RING_BUFFER_H
+ #define RING_BUFFER_H
+
+ #include <Arduino.h>
+ #include <new>
+
+ /**
+  * @class RingBuffer
+  * @brief Preallocated circular buffer that overwrites the oldest entry when full
+  *
+  * Storage is allocated once by reset() and never resized by push(), so adding
+  * an element is O(1) and does not touch the heap. Elements are addressed by
+  * logical index, where 0 is the oldest element and size() - 1 the newest.
+  * The buffer is not thread-safe; callers are expected to hold their own lock.
+  */
+ template <typename T>
+ class RingBuffer {
+ public:
+     RingBuffer() : _data(nullptr), _capacity(0), _head(0), _count(0), _pushed(0) {}
+
+     explicit RingBuffer(size_t capacity) : RingBuffer() {
+         reset(capacity);
+     }
+
+     ~RingBuffer() {
+         delete[] _data;
+     }
+
+     RingBuffer(const RingBuffer&) = delete;
+     RingBuffer& operator=(const RingBuffer&) = delete;
+
+     /**
+      * @brief Reallocate storage for a new capacity, discarding all contents
+      * @param capacity Maximum number of elements
+      * @return True if storage was allocated
+      */
+     bool reset(size_t capacity) {
+         delete[] _data;
+         _data = nullptr;
+         _capacity = 0;
+         _head = 0;
+         _count = 0;
+         _pushed = 0;
+
+         if (capacity == 0) {
+             return true;
+         }
+
+         _data = new (std::nothrow) T[capacity];
+         if (_data == nullptr) {
+             return false;
+         }
+
+         _capacity = capacity;
+         return true;
+     }
+
+     /**
+      * @brief Append an element, overwriting the oldest one if the buffer is full
+      * @param value Element to append
+      */
+     void push(const T& value) {
+         if (_capacity == 0) {
+             return;
+         }
+
+         _data[_head] = value;
+         _head = (_head + 1) % _capacity;
+         if (_count < _capacity) {
+             _count++;
+         }
+         _pushed++;
+     }
+
+     /**
+      * @brief Remove all elements without releasing storage
+      */
+     void clear() {
+         _head = 0;
+         _count = 0;
+         _pushed = 0;
+     }
+
+     /**
+      * @brief Access an element by logical index
+      * @param index 0 for the oldest element, size() - 1 for the newest
+      * @return Reference to the element
+      */
+     const T& operator[](size_t index) const {
+         return _data[physicalIndex(index)];
+     }
+
+     T& operator[](size_t index) {
+         return _data[physicalIndex(index)];
+     }
+
+     /**
+      * @brief Get the most recently pushed element
+      * @return Reference to the newest element (undefined if empty)
+      */
+     const T& newest() const {
+         return _data[(_head + _capacity - 1) % _capacity];
+     }
+
+     /**
+      * @brief Get the number of pushes since the last reset() or clear()
+      *
+      * The element at logical index i has sequence number pushed() - size() + i,
+      * which stays stable while newer elements are appended.
+      */
+     uint32_t pushed() const { return _pushed; }
+
+     size_t size() const { return _count; }
+     size_t capacity() const { return _capacity; }
+     bool empty() const { return _count == 0; }
+     bool full() const { return _count == _capacity; }
+
+ private:
+     T* _data;
+     size_t _capacity;
+     size_t _head;   // Next write position
+     size_t _count;
+     uint32_t _pushed;
+
+     size_t physicalIndex(size_t index) const {
+         return (_head + _capacity - _count + index) % _capacity;
+     }
+ };
+
+ #endif // RING_BUFFER_H
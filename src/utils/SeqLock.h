@@ -0,0 +1,69 @@
+/**
+ * @file SeqLock.h
+ * @brief Sequence lock for publishing small values to lock-free readers
+ */
+
+ #ifndef SEQ_LOCK_H
+ #define SEQ_LOCK_H
+
+ #include <Arduino.h>
+ #include <atomic>
+
+ /**
+  * @class SeqLock
+  * @brief Single-writer, multi-reader snapshot that never blocks readers
+  *
+  * The writer bumps the sequence to odd, copies the value and bumps it back to
+  * even; readers retry while the sequence is odd or changed during their copy.
+  * Suitable for small, trivially copyable values that are read far more often
+  * than written. Concurrent writers must be serialized by the caller.
+  */
+ template <typename T>
+ class SeqLock {
+ public:
+     SeqLock() : _sequence(0), _value() {}
+
+     explicit SeqLock(const T& initial) : _sequence(0), _value(initial) {}
+
+     SeqLock(const SeqLock&) = delete;
+     SeqLock& operator=(const SeqLock&) = delete;
+
+     /**
+      * @brief Publish a new value
+      * @param value Value to publish
+      */
+     void write(const T& value) {
+         uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+         _sequence.store(sequence + 1, std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_release);
+
+         _value = value;
+
+         _sequence.store(sequence + 2, std::memory_order_release);
+     }
+
+     /**
+      * @brief Read a consistent copy of the latest value
+      * @return Copy of the value, never torn by a concurrent write()
+      */
+     T read() const {
+         T copy;
+         uint32_t before;
+         uint32_t after;
+
+         do {
+             before = _sequence.load(std::memory_order_acquire);
+             copy = _value;
+             std::atomic_thread_fence(std::memory_order_acquire);
+             after = _sequence.load(std::memory_order_relaxed);
+         } while ((before & 1) != 0 || before != after);
+
+         return copy;
+     }
+
+ private:
+     std::atomic<uint32_t> _sequence;
+     T _value;
+ };
+
+ #endif // SEQ_LOCK_H
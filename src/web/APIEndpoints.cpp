@@ -7,6 +7,7 @@
  #include "WebServer.h"
  #include "../core/AppCore.h"
  #include "../components/SensorManager.h"
+ #include "GraphStream.h"
  #include "../components/RelayManager.h"
  #include "../network/NetworkManager.h"
  #include "../system/ProfileManager.h"
@@ -221,32 +222,14 @@
          maxPoints = request->getParam("points")->value().toInt();
      }
      
-     // Get graph data
-     std::vector<std::vector<float>> data = getAppCore()->getSensorManager()->getGraphData(dataType, maxPoints);
-     
-     // Create JSON response
-     DynamicJsonDocument doc(16384);  // Adjust size based on maxPoints
-     
-     JsonArray upperDhtArray = doc.createNestedArray("upper_dht");
-     JsonArray lowerDhtArray = doc.createNestedArray("lower_dht");
-     JsonArray scdArray = doc.createNestedArray("scd");
-     JsonArray timestampsArray = doc.createNestedArray("timestamps");
-     
-     // Check if we have data
-     if (data.size() >= 4 && !data[0].empty()) {
-         // Add data points
-         for (size_t i = 0; i < data[0].size(); i++) {
-             upperDhtArray.add(data[0][i]);
-             lowerDhtArray.add(data[1][i]);
-             scdArray.add(data[2][i]);
-             timestampsArray.add(data[3][i]);
-         }
+     // Stream the latest raw points straight from the history
+     GraphQuery query;
+     if (!getAppCore()->getSensorManager()->prepareGraphQuery(dataType, maxPoints, 0, query)) {
+         request->send(503, "application/json", createJsonResponse(false, "Sensor history busy"));
+         return;
      }
      
-     String response;
-     serializeJson(doc, response);
-     
-     request->send(200, "application/json", response);
+     GraphStream::send(request, query);
  }
  
  void APIEndpoints::handleTestSensor(AsyncWebServerRequest* request) {
@@ -330,7 +313,7 @@
      std::vector<RelayConfig> relayConfigs = getAppCore()->getRelayManager()->getAllRelayConfigs();
      
      // Create JSON response
-     DynamicJsonDocument doc(2048);
+     DynamicJsonDocument doc(3072);     // Eight relays with backend and schedule
      JsonArray relaysArray = doc.createNestedArray("relays");
      
      for (const auto& config : relayConfigs) {
@@ -338,6 +321,10 @@
          relayObj["id"] = config.relayId;
          relayObj["name"] = config.name;
          relayObj["pin"] = config.pin;
+         relayObj["backend"] = config.backend == RelayBackendType::TAPO ? "tapo" : "gpio";
+         if (config.backend == RelayBackendType::TAPO) {
+             relayObj["tapo_device"] = config.backendDevice;
+         }
          relayObj["visible"] = config.visible;
          relayObj["is_on"] = config.isOn;
          relayObj["state"] = static_cast<int>(config.state);
@@ -0,0 +1,89 @@
+/**
+ * @file DashboardStream.cpp
+ * @brief Implementation of the DashboardStream class
+ */
+
+ #include "DashboardStream.h"
+ 
+ DashboardStream::DashboardStream(const String& head, const GraphQuery* temperature, const GraphQuery* humidity) :
+     _head(head),
+     _part(HEAD),
+     _offset(0)
+ {
+     if (temperature != nullptr && humidity != nullptr) {
+         _temperature.reset(new GraphStream(*temperature, GraphStream::Format::JSON));
+         _humidity.reset(new GraphStream(*humidity, GraphStream::Format::JSON));
+     }
+ }
+ 
+ void DashboardStream::send(AsyncWebServerRequest* request, const String& etag, const String& head,
+                            const GraphQuery* temperature, const GraphQuery* humidity) {
+     // The stream lives as long as the response holds the filler
+     std::shared_ptr<DashboardStream> stream = std::make_shared<DashboardStream>(head, temperature, humidity);
+     AwsResponseFiller filler = [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+         return stream->fill(buffer, maxLen);
+     };
+     
+     AsyncWebServerResponse* response = request->beginChunkedResponse("application/json", filler);
+     response->addHeader("ETag", etag);
+     
+     // Sections left out are only meaningful to the client that sent the tags
+     response->addHeader("Cache-Control", "no-store");
+     request->send(response);
+ }
+ 
+ size_t DashboardStream::fill(uint8_t* buffer, size_t maxLen) {
+     size_t written = 0;
+     
+     while (written < maxLen && _part != DONE) {
+         if (_part == TEMPERATURE || _part == HUMIDITY) {
+             GraphStream* graph = _part == TEMPERATURE ? _temperature.get() : _humidity.get();
+             size_t length = graph->fill(buffer + written, maxLen - written);
+             if (length == 0) {
+                 advance();
+             }
+             written += length;
+             continue;
+         }
+         
+         const char* text = _part == HEAD ? _head.c_str() : literal();
+         size_t remaining = strlen(text + _offset);
+         size_t length = min(remaining, maxLen - written);
+         memcpy(buffer + written, text + _offset, length);
+         _offset += length;
+         written += length;
+         
+         // Fully copied, move on; otherwise the buffer is full
+         if (length == remaining) {
+             advance();
+         }
+     }
+     
+     return written;
+ }
+ 
+ const char* DashboardStream::literal() const {
+     switch (_part) {
+         case TEMPERATURE_KEY:
+             // The head is just "{" when every small section was left out
+             return _head.length() > 1 ? ",\"graphs\":{\"temperature\":" : "\"graphs\":{\"temperature\":";
+         case HUMIDITY_KEY:
+             return ",\"humidity\":";
+         case GRAPHS_END:
+             return "}";
+         case TAIL:
+             return "}";
+         default:
+             return "";
+     }
+ }
+ 
+ void DashboardStream::advance() {
+     _offset = 0;
+     _part++;
+     
+     // Without graphs the head is followed by the closing brace
+     if (_part == TEMPERATURE_KEY && !_temperature) {
+         _part = TAIL;
+     }
+ }
\ No newline at end of file
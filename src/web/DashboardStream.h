@@ -0,0 +1,75 @@
+/**
+ * @file DashboardStream.h
+ * @brief Streaming writer for the combined dashboard response
+ */
+
+ #ifndef DASHBOARD_STREAM_H
+ #define DASHBOARD_STREAM_H
+
+ #include <Arduino.h>
+ #include <ESPAsyncWebServer.h>
+ #include <memory>
+ #include "GraphStream.h"
+
+ /**
+  * @class DashboardStream
+  * @brief Writes the /api/dashboard document section after section
+  *
+  * The small sections (sensors, relays, thresholds) come in already
+  * serialized; the two graphs are appended through GraphStreams while
+  * AsyncWebServer asks for chunks, so the history never becomes a document.
+  */
+ class DashboardStream {
+ public:
+     /**
+      * @brief Constructor
+      * @param head Opening brace followed by the serialized small sections, comma separated
+      * @param temperature Temperature graph query, nullptr to leave the graphs out
+      * @param humidity Humidity graph query, nullptr to leave the graphs out
+      */
+     DashboardStream(const String& head, const GraphQuery* temperature, const GraphQuery* humidity);
+
+     /**
+      * @brief Send the dashboard as a chunked JSON response
+      * @param request Request to answer
+      * @param etag Combined section tags for the ETag header
+      * @param head Opening brace followed by the serialized small sections
+      * @param temperature Temperature graph query, nullptr to leave the graphs out
+      * @param humidity Humidity graph query, nullptr to leave the graphs out
+      */
+     static void send(AsyncWebServerRequest* request, const String& etag, const String& head,
+                      const GraphQuery* temperature, const GraphQuery* humidity);
+
+     /**
+      * @brief Fill the next chunk of the response
+      * @param buffer Output buffer
+      * @param maxLen Size of the output buffer
+      * @return Bytes written, 0 once the document is complete
+      */
+     size_t fill(uint8_t* buffer, size_t maxLen);
+
+ private:
+     enum Part : uint8_t {
+         HEAD = 0,
+         TEMPERATURE_KEY,
+         TEMPERATURE,
+         HUMIDITY_KEY,
+         HUMIDITY,
+         GRAPHS_END,
+         TAIL,
+         DONE
+     };
+
+     String _head;
+     std::unique_ptr<GraphStream> _temperature;
+     std::unique_ptr<GraphStream> _humidity;
+
+     // Position in the document
+     uint8_t _part;
+     size_t _offset;
+
+     const char* literal() const;
+     void advance();
+ };
+
+ #endif // DASHBOARD_STREAM_H
\ No newline at end of file
@@ -0,0 +1,197 @@
+/**
+ * @file GraphStream.cpp
+ * @brief Implementation of the GraphStream class
+ */
+
+ #include "GraphStream.h"
+ #include "../core/AppCore.h"
+ #include <new>
+ 
+ namespace {
+     const char* const kColumnPrefixes[] = {
+         "{\"upper_dht\":[",
+         "],\"lower_dht\":[",
+         "],\"scd\":[",
+         "],\"tent\":[",
+         "],\"timestamps\":["
+     };
+ }
+ 
+ GraphStream::GraphStream(const GraphQuery& query, Format format) :
+     _query(query),
+     _format(format),
+     _column(0),
+     _index(0),
+     _columnOpened(false),
+     _finished(false),
+     _loaded(0),
+     _batchFirst(0),
+     _batchCount(0),
+     _tokenLength(0),
+     _tokenPos(0)
+ {
+     if (query.pointCount > 0) {
+         _points.reset(new (std::nothrow) GraphPoint[query.pointCount]);
+     }
+ }
+ 
+ void GraphStream::send(AsyncWebServerRequest* request, const GraphQuery& query, Format format) {
+     // The stream lives as long as the response holds the filler
+     std::shared_ptr<GraphStream> stream = std::make_shared<GraphStream>(query, format);
+     AwsResponseFiller filler = [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+         return stream->fill(buffer, maxLen);
+     };
+     
+     AsyncWebServerResponse* response;
+     if (format == Format::BINARY) {
+         // Fixed-size values, so the length is known up front and no chunk framing is needed
+         size_t length = 2 * sizeof(uint32_t) + query.pointCount * COLUMN_COUNT * sizeof(uint32_t);
+         response = request->beginResponse("application/octet-stream", length, filler);
+     } else {
+         response = request->beginChunkedResponse("application/json", filler);
+     }
+     
+     request->send(response);
+ }
+ 
+ size_t GraphStream::fill(uint8_t* buffer, size_t maxLen) {
+     size_t written = 0;
+     
+     while (written < maxLen) {
+         // Fetch the next token once the current one is fully copied
+         if (_tokenPos >= _tokenLength && !nextToken()) {
+             break;
+         }
+         
+         size_t length = min(_tokenLength - _tokenPos, maxLen - written);
+         memcpy(buffer + written, _token + _tokenPos, length);
+         _tokenPos += length;
+         written += length;
+     }
+     
+     return written;
+ }
+ 
+ bool GraphStream::nextToken() {
+     _tokenPos = 0;
+     _tokenLength = 0;
+     
+     if (_finished) {
+         return false;
+     }
+     
+     // Advance to the next column once all points of this one are written
+     while (_column < COLUMN_COUNT && _columnOpened && _index >= _query.pointCount) {
+         _column++;
+         _index = 0;
+         _columnOpened = false;
+     }
+     
+     if (_format == Format::BINARY) {
+         return nextBinaryToken();
+     }
+     
+     int length;
+     if (_column >= COLUMN_COUNT) {
+         length = snprintf(_token, sizeof(_token), "],\"resolution\":%lu}", (unsigned long)_query.resolution);
+         _finished = true;
+     } else if (!_columnOpened) {
+         length = snprintf(_token, sizeof(_token), "%s", kColumnPrefixes[_column]);
+         _columnOpened = true;
+     } else {
+         const GraphPoint* point = pointAt(_index);
+         const char* separator = _index > 0 ? "," : "";
+         
+         if (point != nullptr && _column == TIMESTAMP_COLUMN) {
+             length = snprintf(_token, sizeof(_token), "%s%lu", separator, (unsigned long)point->timestamp);
+         } else {
+             float value = seriesValue(point, _column);
+             
+             // JSON has no NaN, gaps are sent as null
+             if (isnan(value)) {
+                 length = snprintf(_token, sizeof(_token), "%snull", separator);
+             } else {
+                 length = snprintf(_token, sizeof(_token), _query.dataType == 2 ? "%s%.0f" : "%s%.2f", separator, value);
+             }
+         }
+         _index++;
+     }
+     
+     _tokenLength = length > 0 ? min((size_t)length, sizeof(_token) - 1) : 0;
+     return true;
+ }
+ 
+ bool GraphStream::nextBinaryToken() {
+     if (_column >= COLUMN_COUNT) {
+         _finished = true;
+         return false;
+     }
+     
+     if (!_columnOpened) {
+         // Only the first column carries the header, the others follow back to back
+         if (_column == 0) {
+             uint32_t header[2] = {(uint32_t)_query.pointCount, _query.resolution};
+             memcpy(_token, header, sizeof(header));
+             _tokenLength = sizeof(header);
+         }
+         _columnOpened = true;
+         return true;
+     }
+     
+     const GraphPoint* point = pointAt(_index);
+     if (_column == TIMESTAMP_COLUMN) {
+         uint32_t timestamp = point != nullptr ? point->timestamp : 0;
+         memcpy(_token, &timestamp, sizeof(timestamp));
+     } else {
+         float value = seriesValue(point, _column);
+         memcpy(_token, &value, sizeof(value));
+     }
+     _tokenLength = sizeof(uint32_t);
+     _index++;
+     return true;
+ }
+ 
+ const GraphPoint* GraphStream::pointAt(size_t index) {
+     // The first column reads the points in order, the others find them cached
+     if (_points) {
+         while (index >= _loaded) {
+             size_t count = getAppCore()->getSensorManager()->readGraphPoints(
+                 _query, _loaded, Constants::GRAPH_READ_BATCH_POINTS, &_points[_loaded]);
+             if (count == 0) {
+                 return nullptr;
+             }
+             _loaded += count;
+         }
+         return &_points[index];
+     }
+     
+     // Refill the batch when the index falls outside it
+     if (index < _batchFirst || index >= _batchFirst + _batchCount) {
+         _batchFirst = index;
+         _batchCount = getAppCore()->getSensorManager()->readGraphPoints(
+             _query, index, Constants::GRAPH_READ_BATCH_POINTS, _batch);
+         
+         if (_batchCount == 0) {
+             return nullptr;
+         }
+     }
+     
+     return &_batch[index - _batchFirst];
+ }
+ 
+ float GraphStream::seriesValue(const GraphPoint* point, uint8_t column) {
+     if (point == nullptr) {
+         return NAN;
+     }
+     
+     switch (column) {
+         case 0:
+             return point->upperDht;
+         case 1:
+             return point->lowerDht;
+         case 2:
+             return point->scd;
+         default:
+             return point->tent;
+     }
+ }
\ No newline at end of file
@@ -0,0 +1,96 @@
+/**
+ * @file GraphStream.h
+ * @brief Streaming JSON/binary writer for graph responses
+ */
+
+ #ifndef GRAPH_STREAM_H
+ #define GRAPH_STREAM_H
+ 
+ #include <Arduino.h>
+ #include <ESPAsyncWebServer.h>
+ #include <memory>
+ #include "../utils/Constants.h"
+ #include "../components/SensorManager.h"
+ 
+ /**
+  * @class GraphStream
+  * @brief Serializes a GraphQuery straight into response buffers
+  *
+  * The output is produced token by token while AsyncWebServer asks for the
+  * next chunk, reading a small batch of points from SensorManager at a time.
+  * The output is column-major, so the points decoded while writing the first
+  * column are kept for the others and every batch is read only once (one
+  * TimeSeriesStore range read for a from/to query). That cache is 20 bytes
+  * per point, at most GRAPH_MAX_POINTS; if it cannot be allocated the
+  * stream falls back to rereading the batch for each column.
+  *
+  * The binary format is little-endian and 4-byte aligned so a browser can map
+  * it with typed arrays: uint32 point count N, uint32 resolution, then
+  * Float32[N] upper DHT, Float32[N] lower DHT, Float32[N] SCD40,
+  * Float32[N] fused tent reading and Uint32[N] timestamps. Missing values
+  * are NaN.
+  */
+ class GraphStream {
+ public:
+     enum class Format : uint8_t {
+         JSON = 0,
+         BINARY
+     };
+     
+     /**
+      * @brief Constructor
+      * @param query Prepared graph query
+      * @param format Output encoding
+      */
+     GraphStream(const GraphQuery& query, Format format);
+     
+     /**
+      * @brief Send a graph query as a streamed response
+      * @param request Request to answer
+      * @param query Prepared graph query
+      * @param format Output encoding (JSON is sent chunked, binary with a known length)
+      */
+     static void send(AsyncWebServerRequest* request, const GraphQuery& query, Format format = Format::JSON);
+     
+     /**
+      * @brief Fill the next chunk of the response
+      * @param buffer Output buffer
+      * @param maxLen Size of the output buffer
+      * @return Bytes written, 0 once the document is complete
+      */
+     size_t fill(uint8_t* buffer, size_t maxLen);
+     
+ private:
+     static constexpr uint8_t COLUMN_COUNT = 5;
+     static constexpr uint8_t TIMESTAMP_COLUMN = 4;
+     
+     GraphQuery _query;
+     Format _format;
+     
+     // Position in the document
+     uint8_t _column;
+     size_t _index;
+     bool _columnOpened;
+     bool _finished;
+     
+     // Points decoded so far, kept for the later columns
+     std::unique_ptr<GraphPoint[]> _points;
+     size_t _loaded;
+     
+     // Points of the current batch, only used without the cache
+     GraphPoint _batch[Constants::GRAPH_READ_BATCH_POINTS];
+     size_t _batchFirst;
+     size_t _batchCount;
+     
+     // Token not yet copied into a chunk
+     char _token[48];
+     size_t _tokenLength;
+     size_t _tokenPos;
+     
+     bool nextToken();
+     bool nextBinaryToken();
+     const GraphPoint* pointAt(size_t index);
+     static float seriesValue(const GraphPoint* point, uint8_t column);
+ };
+ 
+ #endif // GRAPH_STREAM_H
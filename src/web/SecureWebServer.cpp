@@ -7,6 +7,14 @@
  #include "../core/AppCore.h"
  #include "../network/NetworkManager.h"
  #include "../components/SensorManager.h"
+ #include <mbedtls/pk.h>
+ #include <mbedtls/ecp.h>
+ #include <mbedtls/x509_crt.h>
+ #include <mbedtls/entropy.h>
+ #include <mbedtls/ctr_drbg.h>
+ #include <mbedtls/platform_util.h>
+ #include <memory>
+ #include <string>
  
  // Initialize static members
  SecureWebServer* SecureWebServer::_instance = nullptr;
@@ -14,11 +22,12 @@
  SecureWebServer::SecureWebServer() :
      _serverCertificate(nullptr),
      _secureServer(nullptr),
-     _port(Constants::DEFAULT_WEB_SERVER_PORT),
+     _port(Constants::DEFAULT_HTTPS_PORT),
      _username(Constants::DEFAULT_HTTP_USERNAME),
      _password(Constants::DEFAULT_HTTP_PASSWORD),
      _isRunning(false),
      _isInConfigMode(false),
+     _restartPending(false),
      _webServerMutex(nullptr),
      _webServerTaskHandle(nullptr)
  {
@@ -27,6 +36,7 @@
  
  SecureWebServer::~SecureWebServer() {
      // Clean up resources
+     if (_webServerTaskHandle) vTaskDelete(_webServerTaskHandle);
      if (_serverCertificate) delete _serverCertificate;
      if (_secureServer) delete _secureServer;
      if (_webServerMutex) vSemaphoreDelete(_webServerMutex);
@@ -42,16 +52,16 @@
          return false;
      }
  
-     // Generate SSL certificate
-     _serverCertificate = generateSelfSignedCertificate();
+     // Reuse the stored certificate, generating one only on the first start
+     _serverCertificate = loadCertificate();
+     if (!_serverCertificate) {
+         _serverCertificate = generateSelfSignedCertificate();
+     }
      if (!_serverCertificate) {
          Serial.println("Failed to generate SSL certificate!");
          return false;
      }
  
-     // Create secure server
-     _secureServer = new HTTPSServer(_serverCertificate);
- 
      // Load authentication credentials from NVS
      nvs_handle_t nvsHandle;
      esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
@@ -82,53 +92,131 @@
      return true;
  }
  
- SSLCert* SecureWebServer::generateSelfSignedCertificate() {
-     // Create a new SSL certificate
-     SSLCert* cert = new SSLCert();
+ SSLCert* SecureWebServer::loadCertificate() {
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle) != ESP_OK) {
+         return nullptr;
+     }
      
-     // Common name (CN) for certificate
-     std::string cn = "CN=MushroomTentController,O=HomeAutomation,C=US";
-     // Validity period in days
-     std::string days = "365";
- 
-     // Generate a self-signed certificate with correct parameter list
-     int createCertResult = createSelfSignedCert(
-         *cert,
-         KEYSIZE_2048,   // Key size enum from the library
-         cn,             // Common Name and certificate info
-         days            // Valid duration in days (as string)
-     );
+     size_t certLength = 0;
+     size_t keyLength = 0;
+     SSLCert* cert = nullptr;
+     if (nvs_get_blob(nvsHandle, Constants::NVS_HTTPS_CERT_KEY, nullptr, &certLength) == ESP_OK &&
+         nvs_get_blob(nvsHandle, Constants::NVS_HTTPS_PKEY_KEY, nullptr, &keyLength) == ESP_OK &&
+         certLength > 0 && keyLength > 0) {
+         // SSLCert keeps the buffers, they live as long as the server
+         unsigned char* certData = new unsigned char[certLength];
+         unsigned char* keyData = new unsigned char[keyLength];
+         if (nvs_get_blob(nvsHandle, Constants::NVS_HTTPS_CERT_KEY, certData, &certLength) == ESP_OK &&
+             nvs_get_blob(nvsHandle, Constants::NVS_HTTPS_PKEY_KEY, keyData, &keyLength) == ESP_OK) {
+             cert = new SSLCert(certData, certLength, keyData, keyLength);
+         } else {
+             delete[] certData;
+             delete[] keyData;
+         }
+     }
+     
+     nvs_close(nvsHandle);
+     return cert;
+ }
  
-     if (createCertResult != 0) {
+ SSLCert* SecureWebServer::generateSelfSignedCertificate() {
+     // A P-256 key makes in well under a second what RSA-2048 takes tens of
+     // seconds for, and its handshakes are far cheaper on the ESP32
+     mbedtls_pk_context key;
+     mbedtls_x509write_cert writer;
+     mbedtls_entropy_context entropy;
+     mbedtls_ctr_drbg_context drbg;
+     mbedtls_mpi serial;
+     mbedtls_pk_init(&key);
+     mbedtls_x509write_crt_init(&writer);
+     mbedtls_entropy_init(&entropy);
+     mbedtls_ctr_drbg_init(&drbg);
+     mbedtls_mpi_init(&serial);
+     
+     std::unique_ptr<unsigned char[]> buffer(new (std::nothrow) unsigned char[Constants::HTTPS_CERT_BUFFER_SIZE]);
+     const char* personalization = "https_cert";
+     int certLength = -1;
+     int keyLength = -1;
+     SSLCert* cert = nullptr;
+     
+     bool success = buffer &&
+         mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, 
+                               reinterpret_cast<const unsigned char*>(personalization), strlen(personalization)) == 0 &&
+         mbedtls_pk_setup(&key, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY)) == 0 &&
+         mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(key), mbedtls_ctr_drbg_random, &drbg) == 0 &&
+         mbedtls_mpi_fill_random(&serial, 8, mbedtls_ctr_drbg_random, &drbg) == 0;
+     
+     if (success) {
+         mbedtls_x509write_crt_set_version(&writer, MBEDTLS_X509_CRT_VERSION_3);
+         mbedtls_x509write_crt_set_md_alg(&writer, MBEDTLS_MD_SHA256);
+         mbedtls_x509write_crt_set_subject_key(&writer, &key);
+         mbedtls_x509write_crt_set_issuer_key(&writer, &key);
+         success = mbedtls_x509write_crt_set_subject_name(&writer, Constants::HTTPS_CERT_SUBJECT) == 0 &&
+                   mbedtls_x509write_crt_set_issuer_name(&writer, Constants::HTTPS_CERT_SUBJECT) == 0 &&
+                   mbedtls_x509write_crt_set_serial(&writer, &serial) == 0 &&
+                   mbedtls_x509write_crt_set_validity(&writer, "20240101000000", "20491231235959") == 0 &&
+                   mbedtls_x509write_crt_set_basic_constraints(&writer, 0, -1) == 0;
+     }
+     
+     unsigned char* certData = nullptr;
+     unsigned char* keyData = nullptr;
+     if (success) {
+         // Both writers fill the buffer from its end
+         certLength = mbedtls_x509write_crt_der(&writer, buffer.get(), Constants::HTTPS_CERT_BUFFER_SIZE, 
+                                                mbedtls_ctr_drbg_random, &drbg);
+         if (certLength > 0) {
+             certData = new unsigned char[certLength];
+             memcpy(certData, buffer.get() + Constants::HTTPS_CERT_BUFFER_SIZE - certLength, certLength);
+             
+             keyLength = mbedtls_pk_write_key_der(&key, buffer.get(), Constants::HTTPS_CERT_BUFFER_SIZE);
+             if (keyLength > 0) {
+                 keyData = new unsigned char[keyLength];
+                 memcpy(keyData, buffer.get() + Constants::HTTPS_CERT_BUFFER_SIZE - keyLength, keyLength);
+             }
+         }
+         
+         // Don't leave the private key in the scratch buffer
+         mbedtls_platform_zeroize(buffer.get(), Constants::HTTPS_CERT_BUFFER_SIZE);
+     }
+     
+     mbedtls_mpi_free(&serial);
+     mbedtls_ctr_drbg_free(&drbg);
+     mbedtls_entropy_free(&entropy);
+     mbedtls_x509write_crt_free(&writer);
+     mbedtls_pk_free(&key);
+     
+     if (certData == nullptr || keyData == nullptr) {
+         delete[] certData;
+         delete[] keyData;
          Serial.println("Error generating certificate");
-         delete cert;
          return nullptr;
      }
- 
+     
+     cert = new SSLCert(certData, certLength, keyData, keyLength);
+     
+     // Keep it, the next boot and every browser that trusted it see the same certificate
+     nvs_handle_t nvsHandle;
+     if (nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle) == ESP_OK) {
+         nvs_set_blob(nvsHandle, Constants::NVS_HTTPS_CERT_KEY, certData, certLength);
+         nvs_set_blob(nvsHandle, Constants::NVS_HTTPS_PKEY_KEY, keyData, keyLength);
+         nvs_commit(nvsHandle);
+         nvs_close(nvsHandle);
+     }
+     
      return cert;
  }
  
  bool SecureWebServer::startConfigurationMode() {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_webServerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Reset server if already running
-         if (_isRunning) {
-             _secureServer->stop();
-         }
- 
-         // Setup configuration mode routes
-         setupConfigModeRoutes();
- 
-         // Start server
-         _secureServer->start();
-         _isRunning = true;
          _isInConfigMode = true;
- 
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "SecureWebServer", 
-             "Secure web server started in configuration mode on port " + String(_port));
- 
+         _restartPending = true;
+         
          // Release mutex
          xSemaphoreGive(_webServerMutex);
+         
+         scheduleRestart();
          return true;
      }
  
@@ -138,30 +226,61 @@
  bool SecureWebServer::startNormalMode() {
      // Take mutex to ensure thread safety
      if (xSemaphoreTake(_webServerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-         // Reset server if already running
-         if (_isRunning) {
-             _secureServer->stop();
-         }
- 
-         // Setup normal mode routes
-         setupNormalModeRoutes();
- 
-         // Start server
-         _secureServer->start();
-         _isRunning = true;
          _isInConfigMode = false;
- 
-         getAppCore()->getLogManager()->log(LogLevel::INFO, "SecureWebServer", 
-             "Secure web server started in normal mode on port " + String(_port));
- 
+         _restartPending = true;
+         
          // Release mutex
          xSemaphoreGive(_webServerMutex);
+         
+         scheduleRestart();
          return true;
      }
  
      return false;
  }
  
+ void SecureWebServer::scheduleRestart() {
+     // Applied by the server task on its next pass, or when it is created
+     if (_webServerTaskHandle != nullptr) {
+         xTaskNotifyGive(_webServerTaskHandle);
+     }
+ }
+ 
+ void SecureWebServer::applyRestart() {
+     // Take mutex to ensure thread safety
+     if (xSemaphoreTake(_webServerMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+         return;
+     }
+     _restartPending = false;
+     
+     // The port is fixed per HTTPSServer, so a change means a new instance
+     if (_secureServer != nullptr) {
+         _secureServer->stop();
+         delete _secureServer;
+     }
+     
+     // Connections beyond the limit queue in the backlog
+     _secureServer = new HTTPSServer(_serverCertificate, _port, Constants::HTTPS_MAX_CONNECTIONS);
+     if (_isInConfigMode) {
+         setupConfigModeRoutes();
+     } else {
+         setupNormalModeRoutes();
+     }
+     _isRunning = _secureServer->start() != 0;
+     
+     if (_isRunning) {
+         getAppCore()->getLogManager()->log(LogLevel::INFO, "SecureWebServer", 
+             "Secure web server started in " + String(_isInConfigMode ? "configuration" : "normal") + 
+             " mode on port " + String(_port));
+     } else {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "SecureWebServer", 
+             "Failed to start secure web server on port " + String(_port));
+     }
+     
+     // Release mutex
+     xSemaphoreGive(_webServerMutex);
+ }
+ 
  void SecureWebServer::setupConfigModeRoutes() {
      // Define static handler methods with C function pointers
      ResourceNode* wifiScanNode = new ResourceNode(
@@ -205,9 +324,8 @@
      std::string authHeaderStr = request->getHeader("Authorization");
      
      if (authHeaderStr.empty()) {
-         response->setStatusCode(401);
          response->setStatusText("Unauthorized");
-         response->println("Authentication required");
+         sendJson(response, 401, "{\"success\":false,\"message\":\"Authentication required\"}");
          return false;
      }
  
@@ -229,9 +347,8 @@
          }
      }
  
-     response->setStatusCode(401);
      response->setStatusText("Unauthorized");
-     response->println("Invalid credentials");
+     sendJson(response, 401, "{\"success\":false,\"message\":\"Invalid credentials\"}");
      return false;
  }
  
@@ -261,9 +378,6 @@
  }
  
  void SecureWebServer::handleWiFiScan(HTTPRequest* request, HTTPResponse* response) {
-     response->setStatusCode(200);
-     response->setHeader("Content-Type", "application/json");
- 
      // Scan networks and create JSON response
      std::vector<NetworkInfo> networks = getAppCore()->getNetworkManager()->scanNetworks();
      
@@ -289,7 +403,7 @@
      // Serialize JSON to response
      String jsonResponse;
      serializeJson(doc, jsonResponse);
-     response->println(jsonResponse.c_str());
+     sendJson(response, 200, jsonResponse);
  }
  
  void SecureWebServer::handleTestWiFi(HTTPRequest* request, HTTPResponse* response) {
@@ -306,17 +420,13 @@
      DeserializationError error = deserializeJson(doc, body.c_str());
      
      if (error) {
-         response->setStatusCode(400);
-         response->setHeader("Content-Type", "application/json");
-         response->println("{\"success\":false,\"message\":\"Invalid JSON\"}");
+         sendJson(response, 400, "{\"success\":false,\"message\":\"Invalid JSON\"}");
          return;
      }
  
      // Extract SSID and password
      if (!doc.containsKey("ssid") || !doc.containsKey("password")) {
-         response->setStatusCode(400);
-         response->setHeader("Content-Type", "application/json");
-         response->println("{\"success\":false,\"message\":\"Missing SSID or password\"}");
+         sendJson(response, 400, "{\"success\":false,\"message\":\"Missing SSID or password\"}");
          return;
      }
  
@@ -327,21 +437,16 @@
      bool success = getAppCore()->getNetworkManager()->testWiFiCredentials(ssid, password);
  
      // Prepare response
-     response->setStatusCode(200);
-     response->setHeader("Content-Type", "application/json");
-     
      String responseBody = "{\"success\":" + String(success ? "true" : "false") + 
                            ",\"message\":\"" + (success ? "Connection successful" : "Connection failed") + "\"}";
-     response->println(responseBody.c_str());
+     sendJson(response, 200, responseBody);
  }
  
  void SecureWebServer::handleSaveSettings(HTTPRequest* request, HTTPResponse* response) {
      // Similar implementation to existing save settings method
      // Parse request body, validate, save settings, etc.
      // You'll need to adapt the existing implementation to work with this new request/response model
-     response->setStatusCode(200);
-     response->setHeader("Content-Type", "application/json");
-     response->println("{\"success\":true,\"message\":\"Settings saved\"}");
+     sendJson(response, 200, "{\"success\":true,\"message\":\"Settings saved\"}");
  }
  
  void SecureWebServer::handleGetSensorData(HTTPRequest* request, HTTPResponse* response) {
@@ -363,11 +468,9 @@
      upperDhtObj["valid"] = upperDht.valid;
      
      // Serialize JSON to response
-     response->setStatusCode(200);
-     response->setHeader("Content-Type", "application/json");
      String jsonResponse;
      serializeJson(doc, jsonResponse);
-     response->println(jsonResponse.c_str());
+     sendJson(response, 200, jsonResponse);
  }
  
  bool SecureWebServer::setPort(uint16_t port) {
@@ -375,13 +478,10 @@
      if (xSemaphoreTake(_webServerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
          _port = port;
          
-         // If server is running, restart it
-         if (_isRunning) {
-             if (_isInConfigMode) {
-                 startConfigurationMode();
-             } else {
-                 startNormalMode();
-             }
+         // A started server moves to the new port on the task's next pass
+         bool restart = _secureServer != nullptr || _restartPending;
+         if (restart) {
+             _restartPending = true;
          }
          
          getAppCore()->getLogManager()->log(LogLevel::INFO, "SecureWebServer", 
@@ -389,6 +489,10 @@
          
          // Release mutex
          xSemaphoreGive(_webServerMutex);
+         
+         if (restart) {
+             scheduleRestart();
+         }
          return true;
      }
      
@@ -450,11 +554,52 @@
      return false;
  }
  
+ void SecureWebServer::sendJson(HTTPResponse* response, uint16_t statusCode, const String& body) {
+     // Without a length the server has to close the connection to end the body
+     response->setStatusCode(statusCode);
+     response->setHeader("Content-Type", "application/json");
+     response->setHeader("Content-Length", std::to_string(body.length()));
+     response->print(body.c_str());
+ }
+ 
  void SecureWebServer::createTasks() {
-     // No additional tasks needed for HTTPS server
-     // The ESP32 HTTPS server manages its own tasks internally
-     getAppCore()->getLogManager()->log(LogLevel::INFO, "SecureWebServer", 
-         "No additional tasks created for secure web server");
+     // The HTTPS server only works when its loop is called, one task serves all connections
+     BaseType_t result = xTaskCreatePinnedToCore(
+         serverTask,                        // Task function
+         "SecureWebTask",                   // Task name
+         Constants::STACK_SIZE_SECURE_WEB,  // Stack size (words)
+         this,                              // Task parameters
+         Constants::PRIORITY_WEBSERVER,     // Priority
+         &_webServerTaskHandle,             // Task handle
+         0                                  // Core ID (0 - protocol core)
+     );
+     
+     if (result != pdPASS) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "SecureWebServer", 
+             "Failed to create secure web server task");
+     }
+ }
+ 
+ void SecureWebServer::serverTask(void* parameter) {
+     SecureWebServer* server = static_cast<SecureWebServer*>(parameter);
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Mode and port changes, the lock is held only while the server is rebuilt
+         if (server->_restartPending) {
+             server->applyRestart();
+         }
+         
+         // Accepts while a connection slot is free, then reads and answers every open one.
+         // No lock, only this task touches the server and handlers may block for seconds.
+         if (server->_isRunning) {
+             server->_secureServer->loop();
+         }
+         
+         // A restart request cuts the pause short
+         ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(Constants::HTTPS_LOOP_INTERVAL_MS));
+     }
  }
  
  String SecureWebServer::decodeBase64(const String& input) {
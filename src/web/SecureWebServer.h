@@ -36,6 +36,23 @@
  
  using namespace httpsserver;
  
+ /**
+  * @class SecureWebServer
+  * @brief HTTPS variant of the web server for the setup and dashboard APIs
+  *
+  * The certificate is a self-signed ECDSA P-256 one, made on the first
+  * start and kept in NVS, so neither the boot nor a handshake pays for RSA.
+  * At most HTTPS_MAX_CONNECTIONS connections are open at once; a further
+  * client waits in the accept backlog until one closes. Responses carry a
+  * Content-Length so browsers keep the connection open and a polling
+  * dashboard does one handshake per connection instead of one per request.
+  * All connections are served by one task.
+  *
+  * That task is the only one that touches the HTTPSServer. Mode and port
+  * changes are recorded under the mutex and applied by the task between
+  * passes, so its loop runs without the lock and a handler that blocks for
+  * seconds (WiFi scan or test) does not hold up setPort() and the others.
+  */
  class SecureWebServer {
  public:
      SecureWebServer();
@@ -106,19 +123,47 @@
      String _username;
      String _password;
  
-     // Status tracking
+     // Status tracking, _isRunning is owned by the server task
      bool _isRunning;
      bool _isInConfigMode;
+     volatile bool _restartPending;
  
      // RTOS resources
      SemaphoreHandle_t _webServerMutex;
      TaskHandle_t _webServerTaskHandle;
  
      /**
-      * @brief Generate a self-signed SSL certificate
+      * @brief Load the certificate kept in NVS
+      * @return Pointer to the SSLCert, nullptr if none is stored
+      */
+     SSLCert* loadCertificate();
+     
+     /**
+      * @brief Generate a self-signed ECDSA P-256 certificate and store it in NVS
       * @return Pointer to generated SSLCert
       */
      SSLCert* generateSelfSignedCertificate();
+     
+     /**
+      * @brief Send a JSON body with its length, which lets the connection stay open
+      * @param response HTTP response
+      * @param statusCode HTTP status
+      * @param body JSON text
+      */
+     static void sendJson(HTTPResponse* response, uint16_t statusCode, const String& body);
+     
+     /**
+      * @brief Request a (re)start with the current mode and port
+      */
+     void scheduleRestart();
+     
+     /**
+      * @brief Rebuild and start the server, called by the server task only
+      */
+     void applyRestart();
+     
+     // Task function
+     static void serverTask(void* parameter);
  
      /**
       * @brief Setup routes for configuration mode
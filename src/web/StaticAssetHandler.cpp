@@ -0,0 +1,81 @@
+/**
+ * @file StaticAssetHandler.cpp
+ * @brief Implementation of the StaticAssetHandler class
+ */
+
+ #include "StaticAssetHandler.h"
+ #include "WebServer.h"
+ 
+ StaticAssetHandler::StaticAssetHandler(const char* defaultFile) :
+     _defaultFile(defaultFile)
+ {
+ }
+ 
+ bool StaticAssetHandler::canHandle(AsyncWebServerRequest* request) {
+     // Unknown API routes fall through to the not-found handler
+     if ((request->method() != HTTP_GET && request->method() != HTTP_HEAD) || 
+         request->url().startsWith("/api/")) {
+         return false;
+     }
+     
+     // AsyncWebServer drops every request header no handler asked for
+     request->addInterestingHeader("Accept-Encoding");
+     request->addInterestingHeader("If-None-Match");
+     return true;
+ }
+ 
+ void StaticAssetHandler::handleRequest(AsyncWebServerRequest* request) {
+     String path = request->url();
+     if (path.endsWith("/")) {
+         path += _defaultFile;
+     }
+     
+     // Prefer the copy compressed at build time
+     bool gzip = request->hasHeader("Accept-Encoding") &&
+                 request->header("Accept-Encoding").indexOf("gzip") >= 0 &&
+                 SPIFFS.exists(path + ".gz");
+     if (!gzip && !SPIFFS.exists(path)) {
+         request->send(404, "text/plain", "Not found");
+         return;
+     }
+     
+     // The gzip copy is a different representation, so it gets its own tag
+     String etag = readEtag(path);
+     if (etag.length() > 0) {
+         etag = gzip ? "\"" + etag + "-gz\"" : "\"" + etag + "\"";
+     }
+     
+     // Unchanged since the browser cached it
+     if (etag.length() > 0 && request->hasHeader("If-None-Match") && 
+         request->header("If-None-Match") == etag) {
+         AsyncWebServerResponse* response = request->beginResponse(304);
+         response->addHeader("ETag", etag);
+         response->addHeader("Cache-Control", Constants::STATIC_CACHE_CONTROL);
+         request->send(response);
+         return;
+     }
+     
+     AsyncWebServerResponse* response = request->beginResponse(SPIFFS, gzip ? path + ".gz" : path, 
+                                                               WebServer::getContentType(path));
+     if (gzip) {
+         response->addHeader("Content-Encoding", "gzip");
+     }
+     response->addHeader("Vary", "Accept-Encoding");
+     if (etag.length() > 0) {
+         response->addHeader("ETag", etag);
+     }
+     response->addHeader("Cache-Control", Constants::STATIC_CACHE_CONTROL);
+     request->send(response);
+ }
+ 
+ String StaticAssetHandler::readEtag(const String& path) {
+     File file = SPIFFS.open(path + ".etag", "r");
+     if (!file) {
+         return String();
+     }
+     
+     String tag = file.readString();
+     file.close();
+     tag.trim();
+     return tag;
+ }
@@ -0,0 +1,48 @@
+/**
+ * @file StaticAssetHandler.h
+ * @brief Serves the web UI from SPIFFS, preferring gzip-precompressed files
+ */
+
+ #ifndef STATIC_ASSET_HANDLER_H
+ #define STATIC_ASSET_HANDLER_H
+ 
+ #include <Arduino.h>
+ #include <ESPAsyncWebServer.h>
+ #include <SPIFFS.h>
+ #include "../utils/Constants.h"
+ 
+ /**
+  * @class StaticAssetHandler
+  * @brief Catch-all GET handler for files on SPIFFS
+  *
+  * When the browser accepts gzip and the build left a "<file>.gz" next to a
+  * file, the compressed copy is sent with Content-Encoding: gzip. The build
+  * also writes a "<file>.etag" with a hash of the file's content, which is
+  * sent as its ETag, and a matching If-None-Match is answered with 304 without
+  * opening the file. Every response is revalidated, so a changed file is
+  * picked up on the next load. Files without a ".etag", such as uploads, are
+  * sent without an ETag. Register it after the API routes.
+  */
+ class StaticAssetHandler : public AsyncWebHandler {
+ public:
+     /**
+      * @brief Constructor
+      * @param defaultFile File served for directory URLs
+      */
+     explicit StaticAssetHandler(const char* defaultFile = "index.html");
+     
+     bool canHandle(AsyncWebServerRequest* request) override;
+     void handleRequest(AsyncWebServerRequest* request) override;
+     
+ private:
+     /**
+      * @brief Read the content hash the build wrote next to a file
+      * @param path File path
+      * @return Hash, empty if the file has none
+      */
+     String readEtag(const String& path);
+     
+     String _defaultFile;
+ };
+ 
+ #endif // STATIC_ASSET_HANDLER_H
@@ -6,23 +6,119 @@
  #include "WebServer.h"
  #include "../core/AppCore.h"
  #include "../system/LogManager.h"
+ #include "../system/LatencyMonitor.h"
  #include "../system/StorageManager.h"
  #include "../network/NetworkManager.h"
  #include "../components/SensorManager.h"
+ #include "GraphStream.h"
+ #include "DashboardStream.h"
+ #include "StaticAssetHandler.h"
  #include "../components/RelayManager.h"
+ #include "../components/TapoManager.h"
  #include "../system/ProfileManager.h"
  #include "../ota/OTAManager.h"
+ #include "../utils/Helpers.h"
+ 
+ namespace {
+     /**
+      * Declines every request. Its only job is to run before the API
+      * handlers and keep the Cookie header, which the server drops unless a
+      * handler asks for it, so authenticate() can find the session. The
+      * dashboard's section tags arrive in If-None-Match, kept the same way.
+      */
+     class SessionCookieCollector : public AsyncWebHandler {
+     public:
+         bool canHandle(AsyncWebServerRequest* request) override {
+             request->addInterestingHeader("Cookie");
+             if (request->url() == "/api/dashboard") {
+                 request->addInterestingHeader("If-None-Match");
+             }
+             return false;
+         }
+     };
+     
+     /**
+      * Also declines every request. Holds the CPU at full clock from the
+      * request line until the client disconnects and records how long that
+      * took for the power statistics. The event stream is skipped, its
+      * request object is deleted without a disconnect callback.
+      */
+     class RequestPowerLock : public AsyncWebHandler {
+     public:
+         bool canHandle(AsyncWebServerRequest* request) override {
+             if (request->url() == "/api/events") {
+                 return false;
+             }
+             
+             PowerManager* powerManager = getAppCore()->getPowerManager();
+             esp_pm_lock_handle_t lock = powerManager->acquireLock(PowerLock::WEB);
+             uint32_t start = micros();
+             request->onDisconnect([powerManager, lock, start]() {
+                 powerManager->releaseLock(lock);
+                 powerManager->recordRequestLatency(micros() - start);
+             });
+             return false;
+         }
+     };
+     
+     /**
+      * One entry of the relay list, shared by /api/relays/status and /api/dashboard.
+      */
+     void serializeRelay(const RelayConfig& config, JsonObject relayObj) {
+         relayObj["id"] = config.relayId;
+         relayObj["name"] = config.name;
+         relayObj["pin"] = config.pin;
+         relayObj["backend"] = config.backend == RelayBackendType::TAPO ? "tapo" : "gpio";
+         if (config.backend == RelayBackendType::TAPO) {
+             relayObj["tapo_device"] = config.backendDevice;
+         }
+         relayObj["visible"] = config.visible;
+         relayObj["is_on"] = config.isOn;
+         relayObj["state"] = static_cast<int>(config.state);
+         relayObj["last_trigger"] = static_cast<int>(config.lastTrigger);
+         
+         if (config.hasDependency) {
+             relayObj["depends_on"] = config.dependsOnRelay;
+         }
+         
+         JsonObject timeObj = relayObj.createNestedObject("operating_time");
+         timeObj["start_hour"] = config.operatingTime.startHour;
+         timeObj["start_minute"] = config.operatingTime.startMinute;
+         timeObj["end_hour"] = config.operatingTime.endHour;
+         timeObj["end_minute"] = config.operatingTime.endMinute;
+     }
+     
+     /**
+      * Tag of a graph query, changes whenever a new point enters the selection.
+      */
+     uint32_t graphTag(const GraphQuery& query) {
+         char text[96];
+         snprintf(text, sizeof(text), "%u:%u:%lu:%u:%u:%lu:%lu:%lu:%lu",
+                  query.dataType, static_cast<uint8_t>(query.tier), (unsigned long)query.resolution,
+                  (unsigned)query.pointCount, (unsigned)query.available,
+                  (unsigned long)query.firstSequence[0], (unsigned long)query.firstSequence[1],
+                  (unsigned long)query.firstSequence[2], (unsigned long)query.firstSequence[3]);
+         return Helpers::hashFNV1a(text);
+     }
+ }
  
  WebServer::WebServer() :
      _server(nullptr),
+     _apiEndpoints(nullptr),
+     _events(nullptr),
      _port(Constants::DEFAULT_WEB_SERVER_PORT),
      _username(Constants::DEFAULT_HTTP_USERNAME),
      _password(Constants::DEFAULT_HTTP_PASSWORD),
      _isRunning(false),
      _isInConfigMode(false),
      _webServerMutex(nullptr),
-     _webServerTaskHandle(nullptr)
+     _webServerTaskHandle(nullptr),
+     _eventQueue(nullptr)
  {
+     for (uint8_t i = 0; i < 3; i++) {
+         _pushedValid[i] = false;
+         _pushedValues[i][0] = _pushedValues[i][1] = _pushedValues[i][2] = 0.0f;
+     }
  }
  
  WebServer::~WebServer() {
@@ -35,6 +131,10 @@
          vTaskDelete(_webServerTaskHandle);
      }
      
+     if (_eventQueue != nullptr) {
+         vQueueDelete(_eventQueue);
+     }
+     
      // Clean up server
      if (_server != nullptr) {
          delete _server;
@@ -49,6 +149,13 @@
          return false;
      }
      
+     // Queue for live update events, producers never block on it
+     _eventQueue = xQueueCreate(Constants::LIVE_EVENT_QUEUE_SIZE, sizeof(LiveEvent));
+     if (_eventQueue == nullptr) {
+         Serial.println("Failed to create web server event queue!");
+         return false;
+     }
+     
      // Load authentication credentials from NVS
      nvs_handle_t nvsHandle;
      esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READONLY, &nvsHandle);
@@ -86,6 +193,7 @@
          } else if (_isRunning) {
              // Stop the server if it's already running
              getAppCore()->getLogManager()->log(LogLevel::INFO, "WebServer", "Stopping existing web server");
+             _events = nullptr;   // Freed by reset()
              _server->reset();
          }
          
@@ -120,6 +228,7 @@
          } else if (_isRunning) {
              // Stop the server if it's already running
              getAppCore()->getLogManager()->log(LogLevel::INFO, "WebServer", "Stopping existing web server");
+             _events = nullptr;   // Freed by reset()
              _server->reset();
          }
          
@@ -194,6 +303,13 @@
          _username = username;
          _password = password;
          
+         // Sessions opened with the old password end here
+         getAppCore()->getSecurityManager()->revokeAllSessions();
+         
+         if (_events != nullptr) {
+             _events->setAuthentication(_username.c_str(), _password.c_str());
+         }
+         
          // Save credentials to NVS
          nvs_handle_t nvsHandle;
          esp_err_t err = nvs_open(Constants::NVS_CONFIG_NAMESPACE, NVS_READWRITE, &nvsHandle);
@@ -230,8 +346,149 @@
  }
  
  void WebServer::createTasks() {
-     // No tasks needed for now since we're using AsyncWebServer,
-     // but we could add a monitoring task in the future if needed
+     // AsyncWebServer handles requests itself, the task only pushes live updates.
+     // It sends through lwIP, so it stays with the network stack and out of the
+     // way of sensor and relay tasks on the application core.
+     BaseType_t result = xTaskCreatePinnedToCore(
+         eventTask,                       // Task function
+         "WebEventTask",                  // Task name
+         Constants::STACK_SIZE_WEB_EVENTS,// Stack size (words)
+         this,                            // Task parameters
+         Constants::PRIORITY_WEBSERVER,   // Priority
+         &_webServerTaskHandle,           // Task handle
+         0                                // Core ID (0 - protocol core)
+     );
+     
+     if (result != pdPASS) {
+         getAppCore()->getLogManager()->log(LogLevel::ERROR, "WebServer", 
+             "Failed to create web event task");
+     }
+ }
+ 
+ void WebServer::notifySensorUpdate() {
+     if (_eventQueue == nullptr) {
+         return;
+     }
+     
+     // A pending SENSORS event already covers this update if the queue is full
+     LiveEvent event = {LiveEvent::SENSORS, 0, false, 0};
+     xQueueSend(_eventQueue, &event, 0);
+ }
+ 
+ void WebServer::notifyRelayUpdate(uint8_t relayId, bool isOn, uint8_t trigger) {
+     if (_eventQueue == nullptr) {
+         return;
+     }
+     
+     LiveEvent event = {LiveEvent::RELAY, relayId, isOn, trigger};
+     xQueueSend(_eventQueue, &event, 0);
+ }
+ 
+ void WebServer::setupEventSource() {
+     // The previous instance, if any, was freed together with the other handlers
+     _events = new AsyncEventSource("/api/events");
+     _events->setAuthentication(_username.c_str(), _password.c_str());
+     
+     // New clients get the full current state once, afterwards only changes
+     _events->onConnect([this](AsyncEventSourceClient* client) {
+         LiveEvent event = {LiveEvent::SNAPSHOT, 0, false, 0};
+         xQueueSend(_eventQueue, &event, 0);
+     });
+     
+     _server->addHandler(_events);
+ }
+ 
+ void WebServer::sendSensorEvent(bool force) {
+     SensorReading readings[3];
+     getAppCore()->getSensorManager()->getSensorReadings(readings[0], readings[1], readings[2]);
+     
+     // Only push when a value moved by at least its display resolution
+     bool changed = force;
+     for (uint8_t i = 0; i < 3; i++) {
+         const SensorReading& r = readings[i];
+         if (r.valid != _pushedValid[i] ||
+             (r.valid && (fabsf(r.temperature - _pushedValues[i][0]) >= 0.05f ||
+                          fabsf(r.humidity - _pushedValues[i][1]) >= 0.05f ||
+                          fabsf(r.co2 - _pushedValues[i][2]) >= 1.0f))) {
+             changed = true;
+         }
+     }
+     
+     if (!changed) {
+         return;
+     }
+     
+     for (uint8_t i = 0; i < 3; i++) {
+         _pushedValid[i] = readings[i].valid;
+         _pushedValues[i][0] = readings[i].temperature;
+         _pushedValues[i][1] = readings[i].humidity;
+         _pushedValues[i][2] = readings[i].co2;
+     }
+     
+     // Same layout as /api/sensors/data without the averages and thresholds
+     char payload[320];
+     snprintf(payload, sizeof(payload),
+         "{\"upper_dht\":{\"temperature\":%.2f,\"humidity\":%.2f,\"valid\":%s},"
+         "\"lower_dht\":{\"temperature\":%.2f,\"humidity\":%.2f,\"valid\":%s},"
+         "\"scd\":{\"temperature\":%.2f,\"humidity\":%.2f,\"co2\":%.0f,\"valid\":%s}}",
+         readings[0].valid ? readings[0].temperature : 0, readings[0].valid ? readings[0].humidity : 0,
+         readings[0].valid ? "true" : "false",
+         readings[1].valid ? readings[1].temperature : 0, readings[1].valid ? readings[1].humidity : 0,
+         readings[1].valid ? "true" : "false",
+         readings[2].valid ? readings[2].temperature : 0, readings[2].valid ? readings[2].humidity : 0,
+         readings[2].valid ? readings[2].co2 : 0, readings[2].valid ? "true" : "false");
+     
+     _events->send(payload, "sensors", millis());
+ }
+ 
+ void WebServer::sendRelayEvent(uint8_t relayId, bool isOn, uint8_t trigger) {
+     char payload[64];
+     snprintf(payload, sizeof(payload), "{\"id\":%u,\"is_on\":%s,\"last_trigger\":%u}",
+              relayId, isOn ? "true" : "false", trigger);
+     _events->send(payload, "relay", millis());
+ }
+ 
+ void WebServer::sendSnapshot() {
+     sendSensorEvent(true);
+     
+     std::vector<RelayConfig> relayConfigs = getAppCore()->getRelayManager()->getAllRelayConfigs();
+     for (const auto& config : relayConfigs) {
+         sendRelayEvent(config.relayId, config.isOn, static_cast<uint8_t>(config.lastTrigger));
+     }
+ }
+ 
+ void WebServer::eventTask(void* parameter) {
+     WebServer* webServer = static_cast<WebServer*>(parameter);
+     LiveEvent event;
+     
+     while (true) {
+         TASK_LOOP_MARK();
+         
+         // Sleep until a producer posts something
+         if (xQueueReceive(webServer->_eventQueue, &event, portMAX_DELAY) != pdTRUE) {
+             continue;
+         }
+         
+         // Take mutex so the event source is not replaced while sending
+         if (xSemaphoreTake(webServer->_webServerMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+             if (webServer->_events != nullptr && webServer->_events->count() > 0) {
+                 switch (event.type) {
+                     case LiveEvent::SENSORS:
+                         webServer->sendSensorEvent(false);
+                         break;
+                     case LiveEvent::RELAY:
+                         webServer->sendRelayEvent(event.relayId, event.isOn, event.trigger);
+                         break;
+                     case LiveEvent::SNAPSHOT:
+                         webServer->sendSnapshot();
+                         break;
+                 }
+             }
+             
+             // Release mutex
+             xSemaphoreGive(webServer->_webServerMutex);
+         }
+     }
  }
  
  void WebServer::setupConfigModeRoutes() {
@@ -248,11 +505,21 @@
  }
  
  void WebServer::setupNormalModeRoutes() {
+     // Must come first, see SessionCookieCollector
+     _server->addHandler(new SessionCookieCollector());
+     _server->addHandler(new RequestPowerLock());
+     
+     // Log in once, later requests are checked against the session table
+     _server->on("/api/auth/session", HTTP_POST, std::bind(&WebServer::handleCreateSession, this, std::placeholders::_1));
+     _server->on("/api/auth/session", HTTP_DELETE, std::bind(&WebServer::handleDeleteSession, this, std::placeholders::_1));
+     
      // Require authentication for all endpoints
+     _server->on("/api/dashboard", HTTP_GET, std::bind(&WebServer::handleGetDashboard, this, std::placeholders::_1));
      _server->on("/api/sensors/data", HTTP_GET, std::bind(&WebServer::handleGetSensorData, this, std::placeholders::_1));
      _server->on("/api/sensors/graph", HTTP_GET, std::bind(&WebServer::handleGetGraphData, this, std::placeholders::_1));
      
      _server->on("/api/relays/status", HTTP_GET, std::bind(&WebServer::handleGetRelayStatus, this, std::placeholders::_1));
+     _server->on("/api/relays/schedule", HTTP_GET, std::bind(&WebServer::handleGetRelaySchedule, this, std::placeholders::_1));
      _server->addHandler(new AsyncCallbackJsonWebHandler("/api/relays/set", 
          std::bind(&WebServer::handleSetRelayState, this, std::placeholders::_1, std::placeholders::_2)));
      
@@ -272,6 +539,16 @@
      _server->on("/api/system/files", HTTP_GET, std::bind(&WebServer::handleGetFilesList, this, std::placeholders::_1));
      _server->on("/api/system/delete", HTTP_DELETE, std::bind(&WebServer::handleFileDelete, this, std::placeholders::_1));
      
+     _server->on("/api/maintenance/tasks", HTTP_GET, std::bind(&WebServer::handleGetTaskStats, this, std::placeholders::_1));
+     _server->on("/api/maintenance/heap", HTTP_GET, std::bind(&WebServer::handleGetHeapStats, this, std::placeholders::_1));
+     _server->on("/api/maintenance/diagnostics", HTTP_GET, std::bind(&WebServer::handleGetDiagnostics, this, std::placeholders::_1));
+     _server->on("/api/maintenance/benchmark", HTTP_GET, std::bind(&WebServer::handleGetBenchmarks, this, std::placeholders::_1));
+     _server->on("/api/maintenance/benchmark", HTTP_POST, std::bind(&WebServer::handleStartBenchmark, this, std::placeholders::_1));
+     
+     _server->on("/api/ota/status", HTTP_GET, std::bind(&WebServer::handleGetUpdateStatus, this, std::placeholders::_1));
+     _server->addHandler(new AsyncCallbackJsonWebHandler("/api/ota/update", 
+         std::bind(&WebServer::handleStartUpdate, this, std::placeholders::_1, std::placeholders::_2)));
+     
      _server->on("/api/system/reboot", HTTP_POST, std::bind(&WebServer::handleReboot, this, std::placeholders::_1));
      _server->on("/api/system/factory-reset", HTTP_POST, std::bind(&WebServer::handleFactoryReset, this, std::placeholders::_1));
      
@@ -290,11 +567,32 @@
      _server->on("/api/profiles/export", HTTP_GET, std::bind(&WebServer::handleExportProfiles, this, std::placeholders::_1));
      _server->addHandler(new AsyncCallbackJsonWebHandler("/api/profiles/import", 
          std::bind(&WebServer::handleImportProfiles, this, std::placeholders::_1, std::placeholders::_2)));
+     
+     // Power mode and clock setting
+     _server->on("/api/power/mode", HTTP_GET, std::bind(&WebServer::handleGetPowerMode, this, std::placeholders::_1));
+     _server->addHandler(new AsyncCallbackJsonWebHandler("/api/power/mode", 
+         std::bind(&WebServer::handleSetPowerMode, this, std::placeholders::_1, std::placeholders::_2)));
+     
+     // Grow phase schedule
+     _server->on("/api/phases", HTTP_GET, std::bind(&WebServer::handleGetGrowPhases, this, std::placeholders::_1));
+     _server->addHandler(new AsyncCallbackJsonWebHandler("/api/phases/save", 
+         std::bind(&WebServer::handleSaveGrowPhases, this, std::placeholders::_1, std::placeholders::_2)));
+     
+     // Tapo devices, a relay replacement moves that relay to the plug
+     _server->on("/api/tapo/devices", HTTP_GET, std::bind(&WebServer::handleGetTapoDevices, this, std::placeholders::_1));
+     _server->addHandler(new AsyncCallbackJsonWebHandler("/api/tapo/add", 
+         std::bind(&WebServer::handleSaveTapoDevice, this, std::placeholders::_1, std::placeholders::_2, false)));
+     _server->addHandler(new AsyncCallbackJsonWebHandler("/api/tapo/update", 
+         std::bind(&WebServer::handleSaveTapoDevice, this, std::placeholders::_1, std::placeholders::_2, true)));
+     _server->on("/api/tapo/remove", HTTP_DELETE, std::bind(&WebServer::handleRemoveTapoDevice, this, std::placeholders::_1));
+     
+     // Live sensor and relay updates
+     setupEventSource();
  }
  
  void WebServer::setupCommonRoutes() {
-     // Serve static files from SPIFFS
-     _server->serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+     // Serve static files from SPIFFS, gzipped and cacheable
+     _server->addHandler(new StaticAssetHandler("index.html"));
      
      // Handle not found
      _server->onNotFound([](AsyncWebServerRequest* request) {
@@ -307,6 +605,12 @@
      DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
  }
  bool WebServer::authenticate(AsyncWebServerRequest* request) {
+     // A live session is a table lookup, no password check
+     String token = getSessionToken(request);
+     if (!token.isEmpty() && getAppCore()->getSecurityManager()->validateSession(token)) {
+         return true;
+     }
+     
      if (!request->authenticate(_username.c_str(), _password.c_str())) {
          request->requestAuthentication();
          return false;
@@ -314,14 +618,83 @@
      return true;
  }
  
+ String WebServer::getSessionToken(AsyncWebServerRequest* request) {
+     if (!request->hasHeader("Cookie")) {
+         return "";
+     }
+     
+     // "name1=value1; session=<token>; name2=value2"
+     const String& cookies = request->header("Cookie");
+     String key = String(Constants::HTTP_SESSION_COOKIE) + "=";
+     int start = 0;
+     while ((start = cookies.indexOf(key, start)) >= 0) {
+         if (start == 0 || cookies[start - 1] == ' ' || cookies[start - 1] == ';') {
+             start += key.length();
+             int end = cookies.indexOf(';', start);
+             return cookies.substring(start, end < 0 ? cookies.length() : end);
+         }
+         start += key.length();
+     }
+     
+     return "";
+ }
+ 
+ void WebServer::handleCreateSession(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.create_session");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     String token = getAppCore()->getSecurityManager()->createSession();
+     if (token.isEmpty()) {
+         request->send(503, "application/json", "{\"success\":false,\"error\":\"Sessions unavailable\"}");
+         return;
+     }
+     
+     // HttpOnly, the browser sends it back by itself and scripts never see it
+     uint32_t maxAge = Constants::HTTP_SESSION_TTL_MS / 1000;
+     AsyncWebServerResponse* response = request->beginResponse(200, "application/json", 
+         "{\"success\":true,\"expires_in\":" + String(maxAge) + "}");
+     response->addHeader("Set-Cookie", String(Constants::HTTP_SESSION_COOKIE) + "=" + token + 
+         "; Path=/; Max-Age=" + String(maxAge) + "; HttpOnly; SameSite=Strict");
+     request->send(response);
+ }
+ 
+ void WebServer::handleDeleteSession(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.delete_session");
+     
+     getAppCore()->getSecurityManager()->revokeSession(getSessionToken(request));
+     
+     AsyncWebServerResponse* response = request->beginResponse(200, "application/json", "{\"success\":true}");
+     response->addHeader("Set-Cookie", String(Constants::HTTP_SESSION_COOKIE) + "=; Path=/; Max-Age=0; HttpOnly; SameSite=Strict");
+     request->send(response);
+ }
+ 
  void WebServer::handleWiFiScan(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.wifi_scan");
+     
      // No authentication required for AP mode
      
-     // Get network scan results
-     std::vector<NetworkInfo> networks = getAppCore()->getNetworkManager()->scanNetworks();
+     // Never scan inside the AsyncTCP callback, that blocks the server for seconds.
+     // Serve the cached results and start a background scan when they are stale.
+     NetworkManager* networkManager = getAppCore()->getNetworkManager();
+     std::vector<NetworkInfo> networks;
+     uint32_t ageMs = 0;
+     bool running = false;
+     bool valid = networkManager->getScanResults(networks, ageMs, running);
+     
+     bool refresh = request->hasParam("refresh");
+     if (!running && (!valid || refresh || ageMs > Constants::WIFI_SCAN_MAX_AGE_MS)) {
+         running = networkManager->startScan();
+     }
      
      // Create JSON response
      DynamicJsonDocument doc(4096);  // Adjust size based on expected number of networks
+     doc["scanning"] = running;
+     if (valid) {
+         doc["age"] = ageMs / 1000;  // Seconds
+     }
      JsonArray networksArray = doc.createNestedArray("networks");
      
      for (const auto& network : networks) {
@@ -342,10 +715,13 @@
      String response;
      serializeJson(doc, response);
      
-     request->send(200, "application/json", response);
+     // 202 while the results are missing or being refreshed
+     request->send(running ? 202 : 200, "application/json", response);
  }
  
  void WebServer::handleTestWiFi(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.test_wifi");
+     
      // No authentication required for AP mode
      
      // Parse JSON request
@@ -370,6 +746,8 @@
  }
  
  void WebServer::handleSaveSettings(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.save_settings");
+     
      // No authentication required for AP mode
      
      // Parse JSON request
@@ -493,6 +871,8 @@
  }
  
  void WebServer::handleGetSensorData(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_sensor_data");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -501,25 +881,6 @@
      SensorReading upperDht, lowerDht, scd;
      getAppCore()->getSensorManager()->getSensorReadings(upperDht, lowerDht, scd);
      
-     // Create JSON response
-     DynamicJsonDocument doc(512);
-     
-     JsonObject upperDhtObj = doc.createNestedObject("upper_dht");
-     upperDhtObj["temperature"] = upperDht.valid ? upperDht.temperature : 0;
-     upperDhtObj["humidity"] = upperDht.valid ? upperDht.humidity : 0;
-     upperDhtObj["valid"] = upperDht.valid;
-     
-     JsonObject lowerDhtObj = doc.createNestedObject("lower_dht");
-     lowerDhtObj["temperature"] = lowerDht.valid ? lowerDht.temperature : 0;
-     lowerDhtObj["humidity"] = lowerDht.valid ? lowerDht.humidity : 0;
-     lowerDhtObj["valid"] = lowerDht.valid;
-     
-     JsonObject scdObj = doc.createNestedObject("scd");
-     scdObj["temperature"] = scd.valid ? scd.temperature : 0;
-     scdObj["humidity"] = scd.valid ? scd.humidity : 0;
-     scdObj["co2"] = scd.valid ? scd.co2 : 0;
-     scdObj["valid"] = scd.valid;
-     
      // Calculate averages
      float avgTemp = 0;
      float avgHumidity = 0;
@@ -548,15 +909,53 @@
          avgHumidity /= validCount;
      }
      
-     JsonObject avgObj = doc.createNestedObject("average");
-     avgObj["temperature"] = avgTemp;
-     avgObj["humidity"] = avgHumidity;
-     
      // Get environmental thresholds for reference
      float humidityLow, humidityHigh, temperatureLow, temperatureHigh, co2Low, co2High;
      getAppCore()->getRelayManager()->getEnvironmentalThresholds(
          humidityLow, humidityHigh, temperatureLow, temperatureHigh, co2Low, co2High);
      
+     if (wantsBinary(request)) {
+         // Little-endian Float32[15] followed by a uint32 validity mask, NaN for invalid readings
+         float packed[16] = {
+             upperDht.valid ? upperDht.temperature : NAN, upperDht.valid ? upperDht.humidity : NAN,
+             lowerDht.valid ? lowerDht.temperature : NAN, lowerDht.valid ? lowerDht.humidity : NAN,
+             scd.valid ? scd.temperature : NAN, scd.valid ? scd.humidity : NAN, scd.valid ? scd.co2 : NAN,
+             avgTemp, avgHumidity,
+             humidityLow, humidityHigh, temperatureLow, temperatureHigh, co2Low, co2High,
+             0
+         };
+         uint32_t validMask = (upperDht.valid ? 1 : 0) | (lowerDht.valid ? 2 : 0) | (scd.valid ? 4 : 0);
+         memcpy(&packed[15], &validMask, sizeof(validMask));
+         
+         AsyncResponseStream* response = request->beginResponseStream("application/octet-stream", sizeof(packed));
+         response->write(reinterpret_cast<const uint8_t*>(packed), sizeof(packed));
+         request->send(response);
+         return;
+     }
+     
+     // Create JSON response
+     DynamicJsonDocument doc(512);
+     
+     JsonObject upperDhtObj = doc.createNestedObject("upper_dht");
+     upperDhtObj["temperature"] = upperDht.valid ? upperDht.temperature : 0;
+     upperDhtObj["humidity"] = upperDht.valid ? upperDht.humidity : 0;
+     upperDhtObj["valid"] = upperDht.valid;
+     
+     JsonObject lowerDhtObj = doc.createNestedObject("lower_dht");
+     lowerDhtObj["temperature"] = lowerDht.valid ? lowerDht.temperature : 0;
+     lowerDhtObj["humidity"] = lowerDht.valid ? lowerDht.humidity : 0;
+     lowerDhtObj["valid"] = lowerDht.valid;
+     
+     JsonObject scdObj = doc.createNestedObject("scd");
+     scdObj["temperature"] = scd.valid ? scd.temperature : 0;
+     scdObj["humidity"] = scd.valid ? scd.humidity : 0;
+     scdObj["co2"] = scd.valid ? scd.co2 : 0;
+     scdObj["valid"] = scd.valid;
+     
+     JsonObject avgObj = doc.createNestedObject("average");
+     avgObj["temperature"] = avgTemp;
+     avgObj["humidity"] = avgHumidity;
+     
      JsonObject thresholdsObj = doc.createNestedObject("thresholds");
      thresholdsObj["humidity_low"] = humidityLow;
      thresholdsObj["humidity_high"] = humidityHigh;
@@ -572,6 +971,8 @@
  }
  
  void WebServer::handleGetGraphData(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_graph_data");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -588,35 +989,159 @@
          maxPoints = request->getParam("points")->value().toInt();
      }
      
-     // Get graph data
-     std::vector<std::vector<float>> data = getAppCore()->getSensorManager()->getGraphData(dataType, maxPoints);
+     // Optional time span in seconds, selects the matching history resolution
+     uint32_t spanSeconds = 0;
+     if (request->hasParam("span")) {
+         spanSeconds = request->getParam("span")->value().toInt();
+     }
      
-     // Create JSON response
-     DynamicJsonDocument doc(16384);  // Adjust size based on maxPoints
-     
-     JsonArray upperDhtArray = doc.createNestedArray("upper_dht");
-     JsonArray lowerDhtArray = doc.createNestedArray("lower_dht");
-     JsonArray scdArray = doc.createNestedArray("scd");
-     JsonArray timestampsArray = doc.createNestedArray("timestamps");
-     
-     // Check if we have data
-     if (data.size() >= 4 && !data[0].empty()) {
-         // Add data points
-         for (size_t i = 0; i < data[0].size(); i++) {
-             upperDhtArray.add(data[0][i]);
-             lowerDhtArray.add(data[1][i]);
-             scdArray.add(data[2][i]);
-             timestampsArray.add(data[3][i]);
+     // Resolve the query, an absolute from/to range is served from the persistent store
+     GraphQuery query;
+     SensorManager* sensorManager = getAppCore()->getSensorManager();
+     if (request->hasParam("from")) {
+         uint32_t from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+         uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10)
+                                               : (uint32_t)time(nullptr);
+         if (!sensorManager->prepareGraphRangeQuery(dataType, maxPoints, from, to, query)) {
+             request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid time range\"}");
+             return;
          }
+     } else if (!sensorManager->prepareGraphQuery(dataType, maxPoints, spanSeconds, query)) {
+         request->send(503, "application/json", "{\"success\":false,\"message\":\"Sensor history busy\"}");
+         return;
      }
      
-     String response;
-     serializeJson(doc, response);
+     // Stream straight from the history instead of building a document
+     GraphStream::send(request, query, wantsBinary(request) ? GraphStream::Format::BINARY : GraphStream::Format::JSON);
+ }
+ 
+ void WebServer::handleGetDashboard(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_dashboard");
      
-     request->send(200, "application/json", response);
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     uint16_t maxPoints = Constants::DEFAULT_GRAPH_MAX_POINTS;
+     if (request->hasParam("points")) {
+         maxPoints = request->getParam("points")->value().toInt();
+     }
+     
+     // One lock-free sensor snapshot and one relay lock instead of a request per section
+     SensorReading readings[3];
+     FusedReading tent;
+     getAppCore()->getSensorManager()->getSensorReadings(readings[0], readings[1], readings[2], tent);
+     
+     RelayStatus relayStatus;
+     bool hasRelays = getAppCore()->getRelayManager()->getStatus(relayStatus);
+     
+     // A busy history only drops the graphs, the tag of 0 makes the client ask again
+     GraphQuery queries[2];
+     SensorManager* sensorManager = getAppCore()->getSensorManager();
+     bool hasGraphs = sensorManager->prepareGraphQuery(0, maxPoints, 0, queries[0]) &&
+                      sensorManager->prepareGraphQuery(1, maxPoints, 0, queries[1]);
+     
+     // Serialize the small sections one after another in the same document
+     DynamicJsonDocument doc(3072);     // Eight relays with backend and schedule
+     String sections[3];
+     
+     static const char* const sensorKeys[] = {"upper_dht", "lower_dht", "scd"};
+     for (uint8_t i = 0; i < 3; i++) {
+         JsonObject sensorObj = doc.createNestedObject(sensorKeys[i]);
+         sensorObj["temperature"] = readings[i].valid ? readings[i].temperature : 0;
+         sensorObj["humidity"] = readings[i].valid ? readings[i].humidity : 0;
+         if (i == 2) {
+             sensorObj["co2"] = readings[i].valid ? readings[i].co2 : 0;
+         }
+         sensorObj["valid"] = readings[i].valid;
+     }
+     JsonObject tentObj = doc.createNestedObject("tent");
+     tentObj["temperature"] = tent.reading.valid ? tent.reading.temperature : 0;
+     tentObj["humidity"] = tent.reading.valid ? tent.reading.humidity : 0;
+     tentObj["co2"] = tent.hasCo2 ? tent.reading.co2 : 0;
+     tentObj["confidence"] = tent.confidence;
+     tentObj["valid"] = tent.reading.valid;
+     serializeJson(doc, sections[0]);
+     
+     if (hasRelays) {
+         doc.clear();
+         JsonArray relaysArray = doc.createNestedArray("relays");
+         for (const auto& config : relayStatus.relays) {
+             serializeRelay(config, relaysArray.createNestedObject());
+         }
+         JsonObject cycleObj = doc.createNestedObject("cycle_config");
+         cycleObj["on_duration"] = relayStatus.cycle.onDurationMinutes;
+         cycleObj["interval"] = relayStatus.cycle.intervalMinutes;
+         doc["override_duration"] = relayStatus.overrideDurationMinutes;
+         serializeJson(doc, sections[1]);
+         
+         doc.clear();
+         doc["humidity_low"] = relayStatus.thresholds.humidityLow;
+         doc["humidity_high"] = relayStatus.thresholds.humidityHigh;
+         doc["temperature_low"] = relayStatus.thresholds.temperatureLow;
+         doc["temperature_high"] = relayStatus.thresholds.temperatureHigh;
+         doc["co2_low"] = relayStatus.thresholds.co2Low;
+         doc["co2_high"] = relayStatus.thresholds.co2High;
+         serializeJson(doc, sections[2]);
+     }
+     
+     // Section tags in the order sensors, relays, thresholds, graphs
+     uint32_t tags[4];
+     for (uint8_t i = 0; i < 3; i++) {
+         tags[i] = sections[i].isEmpty() ? 0 : Helpers::hashFNV1a(sections[i].c_str());
+     }
+     tags[3] = hasGraphs ? graphTag(queries[1]) ^ (graphTag(queries[0]) * 16777619UL) : 0;
+     
+     char etag[40];
+     snprintf(etag, sizeof(etag), "\"%08lx-%08lx-%08lx-%08lx\"",
+              (unsigned long)tags[0], (unsigned long)tags[1], (unsigned long)tags[2], (unsigned long)tags[3]);
+     
+     // The client sends back the tags of the sections it already has
+     unsigned long known[4] = {0, 0, 0, 0};
+     if (request->hasHeader("If-None-Match")) {
+         sscanf(request->header("If-None-Match").c_str(), "\"%8lx-%8lx-%8lx-%8lx\"",
+                &known[0], &known[1], &known[2], &known[3]);
+     }
+     
+     bool unchanged[4];
+     bool anyChanged = false;
+     for (uint8_t i = 0; i < 4; i++) {
+         unchanged[i] = tags[i] != 0 && known[i] == tags[i];
+         anyChanged = anyChanged || !unchanged[i];
+     }
+     
+     if (!anyChanged) {
+         AsyncWebServerResponse* response = request->beginResponse(304);
+         response->addHeader("ETag", etag);
+         response->addHeader("Cache-Control", "no-store");
+         request->send(response);
+         return;
+     }
+     
+     static const char* const sectionKeys[] = {"sensors", "relays", "thresholds"};
+     String head;
+     head.reserve(sections[0].length() + sections[1].length() + sections[2].length() + 48);
+     head = "{";
+     for (uint8_t i = 0; i < 3; i++) {
+         if (unchanged[i] || sections[i].isEmpty()) {
+             continue;
+         }
+         if (head.length() > 1) {
+             head += ',';
+         }
+         head += '"';
+         head += sectionKeys[i];
+         head += "\":";
+         head += sections[i];
+     }
+     
+     bool sendGraphs = hasGraphs && !unchanged[3];
+     DashboardStream::send(request, etag, head, sendGraphs ? &queries[0] : nullptr, sendGraphs ? &queries[1] : nullptr);
  }
  
  void WebServer::handleGetRelayStatus(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_relay_status");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -625,28 +1150,11 @@
      std::vector<RelayConfig> relayConfigs = getAppCore()->getRelayManager()->getAllRelayConfigs();
      
      // Create JSON response
-     DynamicJsonDocument doc(2048);
+     DynamicJsonDocument doc(3072);     // Eight relays with backend and schedule
      JsonArray relaysArray = doc.createNestedArray("relays");
      
      for (const auto& config : relayConfigs) {
-         JsonObject relayObj = relaysArray.createNestedObject();
-         relayObj["id"] = config.relayId;
-         relayObj["name"] = config.name;
-         relayObj["pin"] = config.pin;
-         relayObj["visible"] = config.visible;
-         relayObj["is_on"] = config.isOn;
-         relayObj["state"] = static_cast<int>(config.state);
-         relayObj["last_trigger"] = static_cast<int>(config.lastTrigger);
-         
-         if (config.hasDependency) {
-             relayObj["depends_on"] = config.dependsOnRelay;
-         }
-         
-         JsonObject timeObj = relayObj.createNestedObject("operating_time");
-         timeObj["start_hour"] = config.operatingTime.startHour;
-         timeObj["start_minute"] = config.operatingTime.startMinute;
-         timeObj["end_hour"] = config.operatingTime.endHour;
-         timeObj["end_minute"] = config.operatingTime.endMinute;
+         serializeRelay(config, relaysArray.createNestedObject());
      }
      
      // Get cycle configuration
@@ -666,7 +1174,56 @@
      request->send(200, "application/json", response);
  }
  
+ void WebServer::handleGetRelaySchedule(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_relay_schedule");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     // Get upcoming schedule slots
+     std::vector<ScheduleEvent> events;
+     time_t nextTransition = 0;
+     if (!getAppCore()->getRelayManager()->getSchedulePreview(events, nextTransition)) {
+         request->send(503, "application/json", "{\"error\":\"Relay manager busy\"}");
+         return;
+     }
+     
+     // Create JSON response
+     DynamicJsonDocument doc(8192);
+     doc["now"] = static_cast<uint32_t>(time(nullptr));
+     doc["next_transition"] = static_cast<uint32_t>(nextTransition);
+     
+     JsonArray eventsArray = doc.createNestedArray("events");
+     for (const auto& event : events) {
+         JsonObject eventObj = eventsArray.createNestedObject();
+         eventObj["time"] = static_cast<uint32_t>(event.time);
+         
+         struct tm timeInfo;
+         localtime_r(&event.time, &timeInfo);
+         char at[6];
+         snprintf(at, sizeof(at), "%02d:%02d", timeInfo.tm_hour, timeInfo.tm_min);
+         eventObj["at"] = at;
+         eventObj["cycle_on"] = event.cycleOn;
+         
+         // Relays inside their operating window during this slot
+         JsonArray windowArray = eventObj.createNestedArray("in_window");
+         for (uint8_t relayId = 1; relayId <= 8; relayId++) {
+             if (event.windowMask & (1 << (relayId - 1))) {
+                 windowArray.add(relayId);
+             }
+         }
+     }
+     
+     String response;
+     serializeJson(doc, response);
+     
+     request->send(200, "application/json", response);
+ }
+ 
  void WebServer::handleSetRelayState(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.set_relay_state");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -699,6 +1256,8 @@
  }
  
  void WebServer::handleGetSettings(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_settings");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -755,6 +1314,11 @@
      JsonObject loggingObj = doc.createNestedObject("logging");
      loggingObj["level"] = static_cast<int>(getAppCore()->getLogManager()->getLogLevel());
      loggingObj["max_size"] = Constants::MAX_LOG_FILE_SIZE / 1024;  // Convert to KB
+     loggingObj["log_server"] = getAppCore()->getLogManager()->getRemoteLogServer();
+     JsonObject modulesObj = loggingObj.createNestedObject("modules");
+     for (const auto& module : getAppCore()->getLogManager()->getModuleLogLevels()) {
+         modulesObj[module.first] = static_cast<int>(module.second);
+     }
      
      // Add reboot scheduler settings
      RebootSchedule rebootSchedule = getAppCore()->getMaintenanceManager()->getRebootSchedule();
@@ -782,6 +1346,8 @@
  }
  
  void WebServer::handleUpdateSettings(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.update_settings");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -877,7 +1443,41 @@
      
      // Update logging settings
      if (jsonObj.containsKey("logging")) {
-         // This would be handled by a LogManager in a real implementation
+         JsonObject loggingObj = jsonObj["logging"];
+         LogManager* logManager = getAppCore()->getLogManager();
+         
+         if (loggingObj.containsKey("level")) {
+             int level = loggingObj["level"].as<int>();
+             if (level >= static_cast<int>(LogLevel::DEBUG) && level <= static_cast<int>(LogLevel::ERROR)) {
+                 logManager->setLogLevel(static_cast<LogLevel>(level));
+             }
+         }
+         
+         if (loggingObj.containsKey("max_size")) {
+             logManager->setMaxLogSize(loggingObj["max_size"].as<size_t>());
+         }
+         
+         if (loggingObj.containsKey("flush_interval")) {
+             logManager->setFlushInterval(loggingObj["flush_interval"].as<uint32_t>());
+         }
+         
+         if (loggingObj.containsKey("log_server")) {
+             logManager->setRemoteLogServer(loggingObj["log_server"].as<String>());
+         }
+         
+         // Per-module overrides, null or a negative level removes one
+         if (loggingObj.containsKey("modules")) {
+             JsonObject modulesObj = loggingObj["modules"];
+             for (JsonPair module : modulesObj) {
+                 if (module.value().isNull() || module.value().as<int>() < 0) {
+                     logManager->clearModuleLogLevel(module.key().c_str());
+                 } else {
+                     int level = min(module.value().as<int>(), static_cast<int>(LogLevel::ERROR));
+                     logManager->setModuleLogLevel(module.key().c_str(), static_cast<LogLevel>(level));
+                 }
+             }
+         }
+         
          settingsUpdated = true;
      }
      
@@ -900,6 +1500,8 @@
  }
  
  void WebServer::handleGetNetworkConfig(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_network_config");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -954,6 +1556,24 @@
      mqttObj["username"] = "";
      mqttObj["password"] = "";
      
+     // Change-driven publishing
+     MqttDeadbands deadbands = getAppCore()->getMQTTClient()->getSensorDeadbands();
+     JsonObject publishObj = mqttObj.createNestedObject("publish");
+     publishObj["temperature_deadband"] = deadbands.temperature;
+     publishObj["humidity_deadband"] = deadbands.humidity;
+     publishObj["co2_deadband"] = deadbands.co2;
+     publishObj["heartbeat"] = getAppCore()->getMQTTClient()->getHeartbeatInterval();
+     
+     // Store-and-forward while the broker is unreachable
+     MqttBacklog* backlog = getAppCore()->getMQTTClient()->getBacklog();
+     JsonObject backlogObj = mqttObj.createNestedObject("backlog");
+     backlogObj["spill_to_flash"] = backlog->getSpillToFlash();
+     backlogObj["queued"] = backlog->size();
+     backlogObj["dropped"] = backlog->getDropped();
+     
+     // Home Assistant discovery
+     mqttObj["discovery"] = getAppCore()->getMQTTClient()->isDiscoveryEnabled();
+     
      String response;
      serializeJson(doc, response);
      
@@ -961,6 +1581,8 @@
  }
  
  void WebServer::handleUpdateNetworkConfig(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.update_network_config");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1047,7 +1669,32 @@
      
      // Update MQTT settings
      if (jsonObj.containsKey("mqtt")) {
-         // This would be handled by an MQTT manager in a real implementation
+         JsonObject mqttObj = jsonObj["mqtt"];
+         
+         // Change-driven publishing, missing fields keep their current value
+         if (mqttObj.containsKey("publish")) {
+             JsonObject publishObj = mqttObj["publish"];
+             MQTTClient* mqttClient = getAppCore()->getMQTTClient();
+             
+             MqttDeadbands deadbands = mqttClient->getSensorDeadbands();
+             deadbands.temperature = publishObj["temperature_deadband"] | deadbands.temperature;
+             deadbands.humidity = publishObj["humidity_deadband"] | deadbands.humidity;
+             deadbands.co2 = publishObj["co2_deadband"] | deadbands.co2;
+             mqttClient->setSensorDeadbands(deadbands);
+             
+             if (publishObj.containsKey("heartbeat")) {
+                 mqttClient->setHeartbeatInterval(publishObj["heartbeat"].as<uint32_t>());
+             }
+         }
+         
+         if (mqttObj.containsKey("backlog") && mqttObj["backlog"].containsKey("spill_to_flash")) {
+             getAppCore()->getMQTTClient()->getBacklog()->setSpillToFlash(mqttObj["backlog"]["spill_to_flash"].as<bool>());
+         }
+         
+         if (mqttObj.containsKey("discovery")) {
+             getAppCore()->getMQTTClient()->setDiscoveryEnabled(mqttObj["discovery"].as<bool>());
+         }
+         
          configUpdated = true;
      }
      
@@ -1072,6 +1719,8 @@
  }
  
  void WebServer::handleGetEnvironmentalThresholds(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_environmental_thresholds");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1098,6 +1747,8 @@
  }
  
  void WebServer::handleUpdateEnvironmentalThresholds(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.update_environmental_thresholds");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1136,6 +1787,8 @@
  }
  
  void WebServer::handleGetSystemInfo(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_system_info");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1177,6 +1830,15 @@
      cpuObj["cycle_count"] = ESP.getCycleCount();
      cpuObj["sdk_version"] = ESP.getSdkVersion();
      
+     // Remote syslog sink
+     RemoteLogStats remoteStats = getAppCore()->getLogManager()->getRemoteLogStats();
+     JsonObject remoteLogObj = doc.createNestedObject("remote_log");
+     remoteLogObj["server"] = getAppCore()->getLogManager()->getRemoteLogServer();
+     remoteLogObj["resolved"] = remoteStats.resolved;
+     remoteLogObj["sent"] = remoteStats.sent;
+     remoteLogObj["dropped"] = remoteStats.dropped;
+     remoteLogObj["datagrams"] = remoteStats.datagrams;
+     
      // Uptime
      doc["uptime_seconds"] = millis() / 1000;
      
@@ -1187,13 +1849,23 @@
  }
  
  void WebServer::handleGetFilesList(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_files_list");
+     
      if (!authenticate(request)) {
          return;
      }
      
-     // Create JSON response
-     DynamicJsonDocument doc(16384);  // Adjust size based on expected number of files
-     JsonArray filesArray = doc.createNestedArray("files");
+     // ?path= downloads one file, streamed from flash a chunk at a time
+     if (request->hasParam("path")) {
+         String path = request->getParam("path")->value();
+         if (path.isEmpty() || !path.startsWith("/") || !SPIFFS.exists(path)) {
+             request->send(404, "application/json", "{\"success\":false,\"message\":\"File not found\"}");
+             return;
+         }
+         
+         request->send(request->beginResponse(SPIFFS, path, getContentType(path), true));
+         return;
+     }
      
      // Open the file system directory
      File root = SPIFFS.open("/");
@@ -1202,30 +1874,38 @@
          return;
      }
      
-     // Iterate through all files
+     // Write each entry as it is found instead of building one document for all files
+     AsyncResponseStream* response = request->beginResponseStream("application/json");
+     response->print("{\"files\":[");
+     
+     bool first = true;
      File file = root.openNextFile();
      while (file) {
          if (!file.isDirectory()) {
-             JsonObject fileObj = filesArray.createNestedObject();
-             fileObj["name"] = String(file.name());
-             fileObj["size"] = file.size();
-             fileObj["url"] = String(file.name());
+             StaticJsonDocument<192> entry;
+             entry["name"] = file.name();
+             entry["size"] = file.size();
+             entry["url"] = file.name();
+             
+             if (!first) {
+                 response->print(',');
+             }
+             serializeJson(entry, *response);
+             first = false;
          }
          file = root.openNextFile();
      }
      
      // Add file system stats
-     doc["total_bytes"] = SPIFFS.totalBytes();
-     doc["used_bytes"] = SPIFFS.usedBytes();
-     doc["free_bytes"] = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+     response->printf("],\"total_bytes\":%u,\"used_bytes\":%u,\"free_bytes\":%u}", 
+                      SPIFFS.totalBytes(), SPIFFS.usedBytes(), SPIFFS.totalBytes() - SPIFFS.usedBytes());
      
-     String response;
-     serializeJson(doc, response);
-     
-     request->send(200, "application/json", response);
+     request->send(response);
  }
  
  void WebServer::handleFileDelete(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.file_delete");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1259,6 +1939,8 @@
  }
  
  void WebServer::handleFileUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
+     LATENCY_SCOPE("http.file_upload");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1277,6 +1959,15 @@
              SPIFFS.remove(filename);
          }
          
+         // The build's gzip copy and content hash no longer match the new file
+         String source = filename.endsWith(".gz") ? filename.substring(0, filename.length() - 3) : filename;
+         if (source == filename && SPIFFS.exists(source + ".gz")) {
+             SPIFFS.remove(source + ".gz");
+         }
+         if (SPIFFS.exists(source + ".etag")) {
+             SPIFFS.remove(source + ".etag");
+         }
+         
          request->_tempFile = SPIFFS.open(filename, FILE_WRITE);
          if (!request->_tempFile) {
              getAppCore()->getLogManager()->log(LogLevel::ERROR, "WebServer", "Failed to open file for writing: " + filename);
@@ -1300,6 +1991,8 @@
  }
  
  void WebServer::handleReboot(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.reboot");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1313,6 +2006,8 @@
  }
  
  void WebServer::handleFactoryReset(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.factory_reset");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1326,6 +2021,8 @@
  }
  
  void WebServer::handleGetProfiles(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_profiles");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1337,6 +2034,8 @@
  }
  
  void WebServer::handleSaveProfile(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.save_profile");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1363,6 +2062,8 @@
  }
  
  void WebServer::handleLoadProfile(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.load_profile");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1388,6 +2089,8 @@
  }
  
  void WebServer::handleExportProfiles(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.export_profiles");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1402,6 +2105,8 @@
  }
  
  void WebServer::handleImportProfiles(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.import_profiles");
+     
      if (!authenticate(request)) {
          return;
      }
@@ -1416,6 +2121,282 @@
      request->send(200, "application/json", response);
  }
  
+ void WebServer::handleGetGrowPhases(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_grow_phases");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     request->send(200, "application/json", getAppCore()->getGrowPhaseScheduler()->getScheduleJson());
+ }
+ 
+ void WebServer::handleSaveGrowPhases(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.save_grow_phases");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     // Replace the schedule, the phase due now is entered right away
+     bool success = getAppCore()->getGrowPhaseScheduler()->setSchedule(json.as<JsonObjectConst>());
+     
+     // Return result
+     String response = "{\"success\":" + String(success ? "true" : "false") + 
+                       ",\"message\":\"" + (success ? "Grow phases saved" : "Invalid grow phase schedule") + "\"}";
+     
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleGetTaskStats(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_task_stats");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     String json = getAppCore()->getMaintenanceManager()->getTaskStatsJson();
+     if (json.isEmpty()) {
+         request->send(501, "application/json", "{\"success\":false,\"message\":\"Task statistics are not enabled in this build\"}");
+         return;
+     }
+     
+     request->send(200, "application/json", json);
+ }
+ 
+ void WebServer::handleGetHeapStats(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_heap_stats");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     // The history is written row by row instead of through one large document
+     AsyncResponseStream* response = request->beginResponseStream("application/json");
+     getAppCore()->getMaintenanceManager()->printHeapJson(*response);
+     request->send(response);
+ }
+ 
+ void WebServer::handleGetDiagnostics(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_diagnostics");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     bool fullTest = request->hasParam("full") && request->getParam("full")->value() == "true";
+     request->send(200, "application/json", getAppCore()->getMaintenanceManager()->runDiagnostics(fullTest));
+ }
+ 
+ void WebServer::handleGetBenchmarks(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_benchmarks");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     MaintenanceManager* maintenanceManager = getAppCore()->getMaintenanceManager();
+     String response = "{\"running\":" + String(maintenanceManager->isBenchmarkRunning() ? "true" : "false") + 
+                       ",\"runs\":" + maintenanceManager->getBenchmarkResults() + "}";
+     
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleStartBenchmark(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.start_benchmark");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     bool success = getAppCore()->getMaintenanceManager()->startBenchmark();
+     
+     // Return result
+     String response = "{\"success\":" + String(success ? "true" : "false") + 
+                       ",\"message\":\"" + (success ? "Benchmark started" : "A benchmark is already running") + "\"}";
+     
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleGetUpdateStatus(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_update_status");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     OTAManager* otaManager = getAppCore()->getOTAManager();
+     DynamicJsonDocument doc(512);
+     doc["version"] = otaManager->getFirmwareVersion();
+     doc["status"] = static_cast<uint8_t>(otaManager->getUpdateStatus());
+     doc["progress"] = otaManager->getUpdateProgress();
+     doc["bytes"] = otaManager->getUpdateBytes();
+     doc["error"] = otaManager->getLastError();
+     
+     String response;
+     serializeJson(doc, response);
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleStartUpdate(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.start_update");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     JsonObject jsonObj = json.as<JsonObject>();
+     if (!jsonObj.containsKey("manifest_url")) {
+         request->send(400, "application/json", "{\"success\":false,\"message\":\"Missing manifest_url\"}");
+         return;
+     }
+     
+     OTAManager* otaManager = getAppCore()->getOTAManager();
+     bool success = otaManager->startPullUpdate(jsonObj["manifest_url"].as<String>(), jsonObj["force"] | false);
+     
+     // Return result
+     DynamicJsonDocument doc(256);
+     doc["success"] = success;
+     doc["message"] = success ? String("Update started") : otaManager->getLastError();
+     
+     String response;
+     serializeJson(doc, response);
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleGetPowerMode(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_power_mode");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     DynamicJsonDocument doc(2048);
+     getAppCore()->getPowerManager()->fillModeJson(doc.to<JsonObject>());
+     
+     String response;
+     serializeJson(doc, response);
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleSetPowerMode(AsyncWebServerRequest* request, JsonVariant& json) {
+     LATENCY_SCOPE("http.set_power_mode");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     PowerManager* powerManager = getAppCore()->getPowerManager();
+     JsonObject jsonObj = json.as<JsonObject>();
+     bool success = true;
+     
+     if (jsonObj.containsKey("dynamic_frequency")) {
+         success = powerManager->setDynamicFrequency(jsonObj["dynamic_frequency"].as<bool>());
+     }
+     
+     // Deep sleep and hibernation would drop the connection before the reply
+     if (success && jsonObj.containsKey("mode")) {
+         uint8_t mode = jsonObj["mode"].as<uint8_t>();
+         if (mode == static_cast<uint8_t>(PowerMode::NO_SLEEP)) {
+             success = powerManager->exitPowerSavingMode();
+         } else if (mode <= static_cast<uint8_t>(PowerMode::LIGHT_SLEEP)) {
+             success = powerManager->enterPowerSavingMode(static_cast<PowerMode>(mode));
+         } else {
+             success = false;
+         }
+     }
+     
+     // Return result
+     String response = "{\"success\":" + String(success ? "true" : "false") + 
+                       ",\"message\":\"" + (success ? "Power mode updated" : "Failed to update power mode") + "\"}";
+     
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleGetTapoDevices(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.get_tapo_devices");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     // Cached status, never waits on a plug
+     std::vector<TapoDevice> devices = getAppCore()->getTapoManager()->getAllDevices();
+     
+     DynamicJsonDocument doc(Constants::TAPO_DEVICES_DOC_SIZE + 1024);
+     JsonArray devicesArray = doc.createNestedArray("devices");
+     for (const TapoDevice& device : devices) {
+         JsonObject deviceObj = devicesArray.createNestedObject();
+         deviceObj["id"] = device.id;
+         deviceObj["name"] = device.name;
+         deviceObj["type"] = device.deviceType;
+         deviceObj["ip"] = device.ipAddress;
+         deviceObj["mac"] = device.macAddress;
+         deviceObj["relay"] = device.relayReplacement;
+         deviceObj["is_on"] = device.isOn;
+         deviceObj["online"] = device.online;
+     }
+     
+     String response;
+     serializeJson(doc, response);
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleSaveTapoDevice(AsyncWebServerRequest* request, JsonVariant& json, bool update) {
+     LATENCY_SCOPE("http.save_tapo_device");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     JsonObject jsonObj = json.as<JsonObject>();
+     TapoDevice device(jsonObj["id"] | "", jsonObj["name"] | "", jsonObj["type"] | "", 
+                       jsonObj["ip"] | "", jsonObj["mac"] | "", jsonObj["relay"] | 0);
+     
+     if (device.id.isEmpty() || device.ipAddress.isEmpty()) {
+         request->send(400, "application/json", "{\"success\":false,\"message\":\"Missing device id or ip\"}");
+         return;
+     }
+     
+     TapoManager* tapoManager = getAppCore()->getTapoManager();
+     bool success = update ? tapoManager->updateDevice(device.id, device) : tapoManager->addDevice(device);
+     
+     // Return result
+     String response = "{\"success\":" + String(success ? "true" : "false") + 
+                       ",\"message\":\"" + (success ? "Tapo device saved" : "Failed to save Tapo device") + "\"}";
+     
+     request->send(200, "application/json", response);
+ }
+ 
+ void WebServer::handleRemoveTapoDevice(AsyncWebServerRequest* request) {
+     LATENCY_SCOPE("http.remove_tapo_device");
+     
+     if (!authenticate(request)) {
+         return;
+     }
+     
+     if (!request->hasParam("id")) {
+         request->send(400, "application/json", "{\"success\":false,\"message\":\"Missing device id\"}");
+         return;
+     }
+     
+     if (getAppCore()->getTapoManager()->removeDevice(request->getParam("id")->value())) {
+         request->send(200, "application/json", "{\"success\":true,\"message\":\"Tapo device removed\"}");
+     } else {
+         request->send(404, "application/json", "{\"success\":false,\"message\":\"Tapo device not found\"}");
+     }
+ }
+ 
+ bool WebServer::wantsBinary(AsyncWebServerRequest* request) {
+     // Opt in with ?format=bin or an Accept header asking for octet-stream
+     if (request->hasParam("format")) {
+         return request->getParam("format")->value() == "bin";
+     }
+     
+     return request->hasHeader("Accept") &&
+            request->header("Accept").indexOf("application/octet-stream") >= 0;
+ }
+ 
  String WebServer::getContentType(const String& filename) {
      if (filename.endsWith(".html")) return "text/html";
      else if (filename.endsWith(".css")) return "text/css";
@@ -1444,16 +2425,17 @@
              return;
          }
          
-         // Read file content
-         size_t size = file.size();
-         std::unique_ptr<char[]> buf(new char[size + 1]);
-         file.readBytes(buf.get(), size);
-         buf[size] = '\0';
-         file.close();
+         // Only the sections applied below are kept while parsing
+         StaticJsonDocument<128> filter;
+         filter["network"] = true;
+         filter["sensors"] = true;
+         filter["relays"] = true;
+         filter["environment"] = true;
          
-         // Parse JSON
-         DynamicJsonDocument doc(8192);
-         DeserializationError error = deserializeJson(doc, buf.get());
+         // Parse JSON straight from the file, no copy of the text
+         DynamicJsonDocument doc(2048);
+         DeserializationError error = deserializeJson(doc, file, DeserializationOption::Filter(filter));
+         file.close();
          
          if (error) {
              getAppCore()->getLogManager()->log(LogLevel::ERROR, "WebServer", 
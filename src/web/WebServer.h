@@ -15,6 +15,7 @@
  #include <freertos/FreeRTOS.h>
  #include <freertos/task.h>
  #include <freertos/semphr.h>
+ #include <freertos/queue.h>
  #include "../utils/Constants.h"
  
  // Forward declarations
@@ -82,6 +83,22 @@
       */
      void createTasks();
      
+     /**
+      * @brief Signal that new sensor readings are available for live clients
+      *
+      * Non-blocking; the event task compares against what was last pushed and
+      * only sends when a value actually changed.
+      */
+     void notifySensorUpdate();
+     
+     /**
+      * @brief Push a relay state change to live clients
+      * @param relayId Relay ID (1-8)
+      * @param isOn New relay state
+      * @param trigger What caused the change (RelayTrigger value)
+      */
+     void notifyRelayUpdate(uint8_t relayId, bool isOn, uint8_t trigger);
+     
      /**
       * @brief Get the AsyncWebServer instance
       * @return Pointer to the AsyncWebServer
@@ -89,12 +106,19 @@
      AsyncWebServer* getServer() { return _server; }
      
      /**
-      * @brief Authenticate a request
+      * @brief Authenticate a request by its session cookie, falling back to Basic auth
       * @param request HTTP request to authenticate
       * @return True if authentication successful
       */
      bool authenticate(AsyncWebServerRequest* request);
      
+     /**
+      * @brief Get the MIME type for a file name
+      * @param filename File name or path
+      * @return Content type
+      */
+     static String getContentType(const String& filename);
+     
  private:
      // Web server instance
      AsyncWebServer* _server;
@@ -102,6 +126,9 @@
      // API endpoints manager
      APIEndpoints* _apiEndpoints;
      
+     // Live update channel (server-sent events)
+     AsyncEventSource* _events;
+     
      // Configuration
      uint16_t _port;
      String _username;
@@ -113,6 +140,23 @@
      
      // RTOS resources
      SemaphoreHandle_t _webServerMutex;
+     TaskHandle_t _webServerTaskHandle;
+     QueueHandle_t _eventQueue;
+     
+     /**
+      * @struct LiveEvent
+      * @brief Item posted to the event task
+      */
+     struct LiveEvent {
+         enum Type : uint8_t { SENSORS = 0, RELAY, SNAPSHOT } type;
+         uint8_t relayId;
+         bool isOn;
+         uint8_t trigger;
+     };
+     
+     // Last readings pushed to live clients (upper DHT, lower DHT, SCD40)
+     float _pushedValues[3][3];
+     bool _pushedValid[3];
      
      // Private methods
      void setupConfigModeRoutes();
@@ -121,9 +165,35 @@
      void handleWiFiScan(AsyncWebServerRequest* request);
      void handleTestWiFi(AsyncWebServerRequest* request, JsonVariant& json);
      void handleSaveSettings(AsyncWebServerRequest* request, JsonVariant& json);
+     void handleGetRelaySchedule(AsyncWebServerRequest* request);
+     void handleCreateSession(AsyncWebServerRequest* request);
+     void handleDeleteSession(AsyncWebServerRequest* request);
+     void handleGetGrowPhases(AsyncWebServerRequest* request);
+     void handleSaveGrowPhases(AsyncWebServerRequest* request, JsonVariant& json);
+     void handleGetTaskStats(AsyncWebServerRequest* request);
+     void handleGetHeapStats(AsyncWebServerRequest* request);
+     void handleGetDiagnostics(AsyncWebServerRequest* request);
+     void handleGetBenchmarks(AsyncWebServerRequest* request);
+     void handleStartBenchmark(AsyncWebServerRequest* request);
+     void handleGetUpdateStatus(AsyncWebServerRequest* request);
+     void handleStartUpdate(AsyncWebServerRequest* request, JsonVariant& json);
+     void handleGetPowerMode(AsyncWebServerRequest* request);
+     void handleSetPowerMode(AsyncWebServerRequest* request, JsonVariant& json);
+     void handleGetDashboard(AsyncWebServerRequest* request);
+     void handleGetTapoDevices(AsyncWebServerRequest* request);
+     void handleSaveTapoDevice(AsyncWebServerRequest* request, JsonVariant& json, bool update);
+     void handleRemoveTapoDevice(AsyncWebServerRequest* request);
+     
+     // Live updates
+     void setupEventSource();
+     void sendSensorEvent(bool force);
+     void sendRelayEvent(uint8_t relayId, bool isOn, uint8_t trigger);
+     void sendSnapshot();
+     static void eventTask(void* parameter);
      
      // Helper methods
-     String getContentType(const String& filename);
+     bool wantsBinary(AsyncWebServerRequest* request);
+     String getSessionToken(AsyncWebServerRequest* request);
  };
  
  #endif // WEB_SERVER_H
\ No newline at end of file
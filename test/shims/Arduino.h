@@ -0,0 +1,48 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the ESP32 Arduino core, just what the native tests build
+ */
+
+ #ifndef NATIVE_ARDUINO_H
+ #define NATIVE_ARDUINO_H
+
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <ctype.h>
+ #include <math.h>
+ #include <algorithm>
+ #include <chrono>
+ #include <thread>
+ #include "freertos/FreeRTOS.h"
+ #include "WString.h"
+
+ using std::min;
+ using std::max;
+
+ #define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+ namespace NativeClock {
+     inline std::chrono::steady_clock::time_point start() {
+         static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+         return boot;
+     }
+ }
+
+ inline unsigned long millis() {
+     return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::steady_clock::now() - NativeClock::start()).count());
+ }
+
+ inline unsigned long micros() {
+     return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(
+         std::chrono::steady_clock::now() - NativeClock::start()).count());
+ }
+
+ inline void delay(unsigned long ms) {
+     std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+ }
+
+ #endif // NATIVE_ARDUINO_H
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ * @file WString.h
+ * @brief Host stand-in for the Arduino String class, backed by std::string
+ *
+ * Only the members the host-built sources and tests use. Numbers convert the
+ * way the ESP32 core does: integers in base 10, floats with two decimals
+ * unless asked otherwise.
+ */
+
+ #ifndef NATIVE_WSTRING_H
+ #define NATIVE_WSTRING_H
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <algorithm>
+ #include <string>
+
+ class String {
+ public:
+     String() {}
+     String(const char* text) : _text(text != nullptr ? text : "") {}
+     String(const String& other) = default;
+     String(String&& other) = default;
+     explicit String(char c) : _text(1, c) {}
+     explicit String(int value) : _text(std::to_string(value)) {}
+     explicit String(unsigned int value) : _text(std::to_string(value)) {}
+     explicit String(long value) : _text(std::to_string(value)) {}
+     explicit String(unsigned long value) : _text(std::to_string(value)) {}
+     explicit String(float value, unsigned int decimals = 2) : String(static_cast<double>(value), decimals) {}
+     explicit String(double value, unsigned int decimals = 2) {
+         char buffer[64];
+         snprintf(buffer, sizeof(buffer), "%.*f", static_cast<int>(decimals), value);
+         _text = buffer;
+     }
+
+     String& operator=(const String& other) = default;
+     String& operator=(String&& other) = default;
+     String& operator=(const char* text) {
+         _text = text != nullptr ? text : "";
+         return *this;
+     }
+
+     const char* c_str() const { return _text.c_str(); }
+     unsigned int length() const { return static_cast<unsigned int>(_text.length()); }
+     bool isEmpty() const { return _text.empty(); }
+     bool reserve(unsigned int size) {
+         _text.reserve(size);
+         return true;
+     }
+
+     char charAt(unsigned int index) const { return index < _text.length() ? _text[index] : 0; }
+     char operator[](unsigned int index) const { return charAt(index); }
+
+     bool concat(const String& other) {
+         _text += other._text;
+         return true;
+     }
+     bool concat(const char* text) {
+         _text += text != nullptr ? text : "";
+         return true;
+     }
+     bool concat(const char* text, unsigned int length) {
+         _text.append(text, length);
+         return true;
+     }
+     bool concat(char c) {
+         _text += c;
+         return true;
+     }
+
+     String& operator+=(const String& other) { concat(other); return *this; }
+     String& operator+=(const char* text) { concat(text); return *this; }
+     String& operator+=(char c) { concat(c); return *this; }
+
+     bool operator==(const String& other) const { return _text == other._text; }
+     bool operator==(const char* text) const { return _text == (text != nullptr ? text : ""); }
+     bool operator!=(const String& other) const { return !(*this == other); }
+     bool operator!=(const char* text) const { return !(*this == text); }
+     bool operator<(const String& other) const { return _text < other._text; }
+
+     int indexOf(char c, unsigned int from = 0) const { return position(_text.find(c, from)); }
+     int indexOf(const String& text, unsigned int from = 0) const { return position(_text.find(text._text, from)); }
+     bool startsWith(const String& prefix) const { return _text.compare(0, prefix._text.length(), prefix._text) == 0; }
+     bool endsWith(const String& suffix) const {
+         return _text.length() >= suffix._text.length() &&
+                _text.compare(_text.length() - suffix._text.length(), suffix._text.length(), suffix._text) == 0;
+     }
+
+     String substring(unsigned int from) const { return substring(from, length()); }
+     String substring(unsigned int from, unsigned int to) const {
+         if (from > to) {
+             std::swap(from, to);
+         }
+         from = std::min(from, length());
+         to = std::min(to, length());
+         return String(_text.substr(from, to - from).c_str());
+     }
+
+     void replace(const String& from, const String& to) {
+         if (from.isEmpty()) {
+             return;
+         }
+         for (size_t pos = _text.find(from._text); pos != std::string::npos; pos = _text.find(from._text, pos + to._text.length())) {
+             _text.replace(pos, from._text.length(), to._text);
+         }
+     }
+
+     void trim() {
+         size_t begin = _text.find_first_not_of(" \t\r\n");
+         size_t end = _text.find_last_not_of(" \t\r\n");
+         _text = begin == std::string::npos ? std::string() : _text.substr(begin, end - begin + 1);
+     }
+
+     long toInt() const { return strtol(_text.c_str(), nullptr, 10); }
+     float toFloat() const { return strtof(_text.c_str(), nullptr); }
+
+ private:
+     std::string _text;
+
+     static int position(size_t index) { return index == std::string::npos ? -1 : static_cast<int>(index); }
+ };
+
+ // The core returns a StringSumHelper from operator+, libraries may name it
+ class StringSumHelper : public String {
+ public:
+     using String::String;
+     StringSumHelper(const String& text) : String(text) {}
+ };
+
+ inline StringSumHelper operator+(const String& left, const String& right) {
+     StringSumHelper sum(left);
+     sum += right;
+     return sum;
+ }
+
+ inline StringSumHelper operator+(const String& left, const char* right) {
+     StringSumHelper sum(left);
+     sum += right;
+     return sum;
+ }
+
+ inline StringSumHelper operator+(const char* left, const String& right) {
+     StringSumHelper sum(left);
+     sum += right;
+     return sum;
+ }
+
+ inline bool operator==(const char* left, const String& right) {
+     return right == left;
+ }
+
+ #endif // NATIVE_WSTRING_H
\ No newline at end of file
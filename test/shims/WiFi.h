@@ -0,0 +1,11 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the WiFi library, nothing built for the host uses it
+ */
+
+ #ifndef NATIVE_WIFI_H
+ #define NATIVE_WIFI_H
+
+ #include <Arduino.h>
+
+ #endif // NATIVE_WIFI_H
\ No newline at end of file
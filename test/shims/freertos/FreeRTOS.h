@@ -0,0 +1,21 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types used in headers, no scheduler behind them
+ */
+
+ #ifndef NATIVE_FREERTOS_H
+ #define NATIVE_FREERTOS_H
+
+ #include <stdint.h>
+
+ typedef int BaseType_t;
+ typedef unsigned int UBaseType_t;
+ typedef uint32_t TickType_t;
+
+ #define pdFALSE 0
+ #define pdTRUE 1
+ #define portMAX_DELAY 0xFFFFFFFFUL
+ #define portTICK_PERIOD_MS 1
+ #define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+ #endif // NATIVE_FREERTOS_H
\ No newline at end of file
@@ -0,0 +1,13 @@
+/**
+ * @file queue.h
+ * @brief Host stand-in for FreeRTOS queue handles
+ */
+
+ #ifndef NATIVE_FREERTOS_QUEUE_H
+ #define NATIVE_FREERTOS_QUEUE_H
+
+ #include "FreeRTOS.h"
+
+ typedef struct NativeQueue* QueueHandle_t;
+
+ #endif // NATIVE_FREERTOS_QUEUE_H
\ No newline at end of file
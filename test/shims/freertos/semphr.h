@@ -0,0 +1,13 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS semaphore handles
+ */
+
+ #ifndef NATIVE_FREERTOS_SEMPHR_H
+ #define NATIVE_FREERTOS_SEMPHR_H
+
+ #include "queue.h"
+
+ typedef QueueHandle_t SemaphoreHandle_t;
+
+ #endif // NATIVE_FREERTOS_SEMPHR_H
\ No newline at end of file
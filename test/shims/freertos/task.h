@@ -0,0 +1,13 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for FreeRTOS task handles
+ */
+
+ #ifndef NATIVE_FREERTOS_TASK_H
+ #define NATIVE_FREERTOS_TASK_H
+
+ #include "FreeRTOS.h"
+
+ typedef struct NativeTask* TaskHandle_t;
+
+ #endif // NATIVE_FREERTOS_TASK_H
\ No newline at end of file
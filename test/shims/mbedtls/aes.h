@@ -0,0 +1,9 @@
+/**
+ * @file aes.h
+ * @brief Host stand-in for mbedTLS aes, nothing built for the host uses it
+ */
+
+ #ifndef NATIVE_MBEDTLS_AES_H
+ #define NATIVE_MBEDTLS_AES_H
+
+ #endif // NATIVE_MBEDTLS_AES_H
\ No newline at end of file
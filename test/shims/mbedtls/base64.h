@@ -0,0 +1,100 @@
+/**
+ * @file base64.h
+ * @brief Host stand-in for mbedTLS base64 with the same length and error contract
+ */
+
+ #ifndef NATIVE_MBEDTLS_BASE64_H
+ #define NATIVE_MBEDTLS_BASE64_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+ #include <string.h>
+
+ #define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+ #define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+ namespace NativeBase64 {
+     const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+     inline int digit(unsigned char c) {
+         const char* found = c != 0 ? strchr(ALPHABET, c) : nullptr;
+         return found != nullptr ? static_cast<int>(found - ALPHABET) : -1;
+     }
+ }
+
+ // Without room for the output and its terminator, *olen is the size needed
+ inline int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) {
+     size_t n = (slen + 2) / 3 * 4;
+     if (slen == 0) {
+         *olen = 0;
+         return 0;
+     }
+     if (dst == nullptr || dlen < n + 1) {
+         *olen = n + 1;
+         return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+     }
+
+     unsigned char* p = dst;
+     for (size_t i = 0; i < slen; i += 3) {
+         uint32_t block = static_cast<uint32_t>(src[i]) << 16;
+         if (i + 1 < slen) block |= static_cast<uint32_t>(src[i + 1]) << 8;
+         if (i + 2 < slen) block |= src[i + 2];
+         *p++ = NativeBase64::ALPHABET[(block >> 18) & 0x3F];
+         *p++ = NativeBase64::ALPHABET[(block >> 12) & 0x3F];
+         *p++ = i + 1 < slen ? NativeBase64::ALPHABET[(block >> 6) & 0x3F] : '=';
+         *p++ = i + 2 < slen ? NativeBase64::ALPHABET[block & 0x3F] : '=';
+     }
+     *p = 0;
+     *olen = n;
+     return 0;
+ }
+
+ // Line breaks and spaces are skipped, without room for the output *olen is the size needed
+ inline int mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) {
+     size_t digits = 0;
+     size_t padding = 0;
+     for (size_t i = 0; i < slen; i++) {
+         unsigned char c = src[i];
+         if (c == ' ' || c == '\r' || c == '\n') {
+             continue;
+         }
+         if (c == '=') {
+             if (++padding > 2) {
+                 return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+             }
+         } else if (padding > 0 || NativeBase64::digit(c) < 0) {
+             return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+         }
+         digits++;
+     }
+
+     size_t n = ((digits * 6) + 7) / 8 - padding;
+     if (digits == 0) {
+         *olen = 0;
+         return 0;
+     }
+     if (dst == nullptr || dlen < n) {
+         *olen = n;
+         return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+     }
+
+     uint32_t block = 0;
+     size_t bits = 0;
+     size_t written = 0;
+     for (size_t i = 0; i < slen && written < n; i++) {
+         int value = NativeBase64::digit(src[i]);
+         if (value < 0) {
+             continue;
+         }
+         block = (block << 6) | static_cast<uint32_t>(value);
+         bits += 6;
+         if (bits >= 8) {
+             bits -= 8;
+             dst[written++] = static_cast<unsigned char>(block >> bits);
+         }
+     }
+     *olen = written;
+     return 0;
+ }
+
+ #endif // NATIVE_MBEDTLS_BASE64_H
\ No newline at end of file
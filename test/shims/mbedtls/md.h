@@ -0,0 +1,9 @@
+/**
+ * @file md.h
+ * @brief Host stand-in for mbedTLS md, nothing built for the host uses it
+ */
+
+ #ifndef NATIVE_MBEDTLS_MD_H
+ #define NATIVE_MBEDTLS_MD_H
+
+ #endif // NATIVE_MBEDTLS_MD_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+/**
+ * @file test_main.cpp
+ * @brief Host microbenchmarks of the hot paths that build for the host, reported in ns/op
+ *
+ * Run with "pio test -e native -f test_bench -v" to see the results. Numbers
+ * are for comparing changes on one machine, the device figures come from
+ * /api/maintenance/benchmark.
+ */
+
+ #include <unity.h>
+ #include <chrono>
+ #include <stdlib.h>
+ #include <time.h>
+ #include "../../src/components/ScheduleTimeline.h"
+ #include "../../src/components/SensorHistory.h"
+ #include "../../src/network/HomeAssistantDiscovery.h"
+ #include "../../src/utils/Helpers.h"
+
+ namespace {
+     const time_t MIDNIGHT = 1699920000;    // 2023-11-14 00:00 UTC
+     const uint32_t ROUNDS = 20000;
+
+     volatile uint32_t sink;    // Keeps the measured work from being optimized away
+
+     // Time ops calls of body and print the cost of one
+     template <typename Body>
+     void measure(const char* name, uint32_t ops, Body body) {
+         auto start = std::chrono::steady_clock::now();
+         for (uint32_t i = 0; i < ops; i++) {
+             body(i);
+         }
+         auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+         char line[96];
+         snprintf(line, sizeof(line), "%s: %.1f ns/op", name, static_cast<double>(elapsed.count()) / ops);
+         TEST_MESSAGE(line);
+     }
+ }
+
+ void setUp() {
+ }
+
+ void tearDown() {
+ }
+
+ void bench_schedule_update() {
+     TimeRange windows[8];
+     for (uint8_t i = 0; i < 8; i++) {
+         windows[i] = TimeRange(i * 3, 15, (i * 3 + 14) % 24, 45);
+     }
+     ScheduleTimeline timeline;
+     timeline.build(windows, 8, CycleConfig(5, 60));
+
+     // One update per minute, wrapping through the day
+     measure("schedule_update", ROUNDS, [&](uint32_t i) {
+         timeline.update(MIDNIGHT + (i % 1440) * 60);
+         sink = sink + timeline.isCycleOn();
+     });
+     TEST_ASSERT_TRUE(timeline.size() > 1);
+ }
+
+ void bench_time_range_in_range() {
+     TimeRange range(22, 0, 6, 0);
+     measure("time_range_in_range", ROUNDS, [&](uint32_t i) {
+         sink = sink + range.isInRange((i / 60) % 24, i % 60);
+     });
+ }
+
+ void bench_history_add() {
+     SensorHistory history;
+     TEST_ASSERT_TRUE(history.begin(Constants::DEFAULT_HISTORY_MAX_POINTS));
+
+     // One reading every 5 seconds, so every tier closes buckets along the way
+     measure("history_add", ROUNDS, [&](uint32_t i) {
+         SensorReading reading = {20.0f + (i % 10) * 0.1f, 80.0f, 800.0f, static_cast<uint32_t>(MIDNIGHT) + i * 5, true};
+         sink = sink + history.add(reading);
+     });
+     TEST_ASSERT_EQUAL_size_t(Constants::DEFAULT_HISTORY_MAX_POINTS, history.size(HistoryTier::RAW));
+ }
+
+ void bench_helpers() {
+     uint8_t block[256];
+     for (size_t i = 0; i < sizeof(block); i++) {
+         block[i] = static_cast<uint8_t>(i);
+     }
+
+     measure("helpers_crc32_256b", ROUNDS, [&](uint32_t i) {
+         block[0] = static_cast<uint8_t>(i);
+         sink = sink + Helpers::calculateCRC32(block, sizeof(block));
+     });
+     measure("helpers_fnv1a", ROUNDS, [&](uint32_t i) {
+         sink = sink + Helpers::hashFNV1a("relays/5/state", i);
+     });
+     measure("helpers_format_duration", ROUNDS, [&](uint32_t i) {
+         sink = sink + Helpers::formatDuration(static_cast<uint64_t>(i) * 3723000ULL).length();
+     });
+ }
+
+ void bench_discovery_build() {
+     HomeAssistantDiscovery discovery;
+     char nodeId[16];
+
+     // A new identity rebuilds all nine sensor configs
+     measure("discovery_configure", ROUNDS / 100, [&](uint32_t i) {
+         snprintf(nodeId, sizeof(nodeId), "tent%u", static_cast<unsigned>(i));
+         discovery.configure(nodeId, "mushroom/tent/", "Tent");
+     });
+     TEST_ASSERT_NOT_NULL(discovery.nextPending());
+ }
+
+ int main(int argc, char** argv) {
+     setenv("TZ", "UTC0", 1);
+     tzset();
+
+     UNITY_BEGIN();
+     RUN_TEST(bench_schedule_update);
+     RUN_TEST(bench_time_range_in_range);
+     RUN_TEST(bench_history_add);
+     RUN_TEST(bench_helpers);
+     RUN_TEST(bench_discovery_build);
+     return UNITY_END();
+ }
\ No newline at end of file
@@ -0,0 +1,76 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of the Helpers utilities
+ */
+
+ #include <unity.h>
+ #include "../../src/utils/Helpers.h"
+
+ void setUp() {
+ }
+
+ void tearDown() {
+ }
+
+ void test_bytes_to_hex() {
+     const uint8_t data[] = {0x00, 0x1A, 0xFF};
+     TEST_ASSERT_EQUAL_STRING("001AFF", Helpers::bytesToHex(data, sizeof(data)).c_str());
+     TEST_ASSERT_EQUAL_STRING("00:1A:FF", Helpers::bytesToHex(data, sizeof(data), ':').c_str());
+     TEST_ASSERT_EQUAL_STRING("", Helpers::bytesToHex(data, 0).c_str());
+ }
+
+ void test_hex_to_bytes_skips_separators() {
+     uint8_t data[4] = {};
+     TEST_ASSERT_EQUAL_size_t(3, Helpers::hexToBytes("aa:BB-0c", data, sizeof(data)));
+     TEST_ASSERT_EQUAL_HEX8(0xAA, data[0]);
+     TEST_ASSERT_EQUAL_HEX8(0xBB, data[1]);
+     TEST_ASSERT_EQUAL_HEX8(0x0C, data[2]);
+
+     // Output is cut at the buffer size
+     TEST_ASSERT_EQUAL_size_t(2, Helpers::hexToBytes("01020304", data, 2));
+ }
+
+ void test_hex_to_bytes_rejects_invalid_input() {
+     uint8_t data[4] = {};
+     TEST_ASSERT_EQUAL_size_t(0, Helpers::hexToBytes("abc", data, sizeof(data)));
+     TEST_ASSERT_EQUAL_size_t(0, Helpers::hexToBytes("zz", data, sizeof(data)));
+ }
+
+ void test_crc32_check_value() {
+     const char* text = "123456789";
+     TEST_ASSERT_EQUAL_HEX32(0xCBF43926, Helpers::calculateCRC32(reinterpret_cast<const uint8_t*>(text), 9));
+     TEST_ASSERT_EQUAL_HEX32(0x00000000, Helpers::calculateCRC32(nullptr, 0));
+ }
+
+ void test_fnv1a_known_values_and_chaining() {
+     TEST_ASSERT_EQUAL_HEX32(0x811C9DC5, Helpers::hashFNV1a(""));
+     TEST_ASSERT_EQUAL_HEX32(0xE40C292C, Helpers::hashFNV1a("a"));
+     TEST_ASSERT_EQUAL_HEX32(Helpers::hashFNV1a("foobar"), Helpers::hashFNV1a("bar", Helpers::hashFNV1a("foo")));
+ }
+
+ void test_base64_round_trip() {
+     TEST_ASSERT_EQUAL_STRING("TWFu", Helpers::base64Encode("Man").c_str());
+     TEST_ASSERT_EQUAL_STRING("TWE=", Helpers::base64Encode("Ma").c_str());
+     TEST_ASSERT_EQUAL_STRING("TQ==", Helpers::base64Encode("M").c_str());
+     TEST_ASSERT_EQUAL_STRING("", Helpers::base64Encode("").c_str());
+     TEST_ASSERT_EQUAL_STRING("Mushroom tent", Helpers::base64Decode(Helpers::base64Encode("Mushroom tent")).c_str());
+ }
+
+ void test_format_duration_drops_leading_zero_units() {
+     TEST_ASSERT_EQUAL_STRING("0s", Helpers::formatDuration(999).c_str());
+     TEST_ASSERT_EQUAL_STRING("1m 5s", Helpers::formatDuration(65000).c_str());
+     TEST_ASSERT_EQUAL_STRING("1h 2m 3s", Helpers::formatDuration(3723000).c_str());
+     TEST_ASSERT_EQUAL_STRING("2d 0h 0m 1s", Helpers::formatDuration(172801000ULL).c_str());
+ }
+
+ int main(int argc, char** argv) {
+     UNITY_BEGIN();
+     RUN_TEST(test_bytes_to_hex);
+     RUN_TEST(test_hex_to_bytes_skips_separators);
+     RUN_TEST(test_hex_to_bytes_rejects_invalid_input);
+     RUN_TEST(test_crc32_check_value);
+     RUN_TEST(test_fnv1a_known_values_and_chaining);
+     RUN_TEST(test_base64_round_trip);
+     RUN_TEST(test_format_duration_drops_leading_zero_units);
+     return UNITY_END();
+ }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of RingBuffer and SensorHistory
+ */
+
+ #include <unity.h>
+ #include "../../src/utils/RingBuffer.h"
+ #include "../../src/components/SensorHistory.h"
+ #include "../../src/utils/Constants.h"
+
+ namespace {
+     const uint32_t START = 1699920000;    // On a 1-hour boundary
+
+     SensorReading reading(uint32_t timestamp, float temperature, float humidity, float co2) {
+         SensorReading sample = {temperature, humidity, co2, timestamp, true};
+         return sample;
+     }
+ }
+
+ void setUp() {
+ }
+
+ void tearDown() {
+ }
+
+ void test_ring_buffer_keeps_order_until_full() {
+     RingBuffer<int> ring(3);
+     TEST_ASSERT_TRUE(ring.empty());
+
+     ring.push(1);
+     ring.push(2);
+     TEST_ASSERT_EQUAL_size_t(2, ring.size());
+     TEST_ASSERT_FALSE(ring.full());
+     TEST_ASSERT_EQUAL_INT(1, ring[0]);
+     TEST_ASSERT_EQUAL_INT(2, ring[1]);
+     TEST_ASSERT_EQUAL_INT(2, ring.newest());
+ }
+
+ void test_ring_buffer_overwrites_oldest() {
+     RingBuffer<int> ring(3);
+     for (int i = 1; i <= 5; i++) {
+         ring.push(i);
+     }
+
+     TEST_ASSERT_TRUE(ring.full());
+     TEST_ASSERT_EQUAL_INT(3, ring[0]);
+     TEST_ASSERT_EQUAL_INT(4, ring[1]);
+     TEST_ASSERT_EQUAL_INT(5, ring[2]);
+     TEST_ASSERT_EQUAL_INT(5, ring.newest());
+
+     // Sequence number of index i is pushed() - size() + i
+     TEST_ASSERT_EQUAL_UINT32(5, ring.pushed());
+ }
+
+ void test_ring_buffer_clear_and_reset() {
+     RingBuffer<int> ring(2);
+     ring.push(1);
+     ring.clear();
+     TEST_ASSERT_TRUE(ring.empty());
+     TEST_ASSERT_EQUAL_UINT32(0, ring.pushed());
+     TEST_ASSERT_EQUAL_size_t(2, ring.capacity());
+
+     // Without capacity every push is dropped
+     TEST_ASSERT_TRUE(ring.reset(0));
+     ring.push(1);
+     TEST_ASSERT_TRUE(ring.empty());
+ }
+
+ void test_history_closes_minute_buckets() {
+     SensorHistory history;
+     TEST_ASSERT_TRUE(history.begin(16));
+
+     TEST_ASSERT_FALSE(history.add(reading(START, 20.0f, 80.0f, 800.0f)));
+     TEST_ASSERT_FALSE(history.add(reading(START + 30, 22.0f, 90.0f, 1000.0f)));
+     TEST_ASSERT_EQUAL_size_t(0, history.size(HistoryTier::MINUTE));
+
+     // The first reading of the next minute closes the previous one
+     TEST_ASSERT_TRUE(history.add(reading(START + 60, 25.0f, 85.0f, 900.0f)));
+     TEST_ASSERT_EQUAL_size_t(3, history.size(HistoryTier::RAW));
+     TEST_ASSERT_EQUAL_size_t(1, history.size(HistoryTier::MINUTE));
+
+     const SensorRollup& minute = history.newestRollup(HistoryTier::MINUTE);
+     TEST_ASSERT_EQUAL_UINT32(START, minute.timestamp);
+     TEST_ASSERT_EQUAL_UINT16(2, minute.count);
+     TEST_ASSERT_EQUAL_INT16(2000, minute.temperatureMin);
+     TEST_ASSERT_EQUAL_INT16(2100, minute.temperatureAvg);
+     TEST_ASSERT_EQUAL_INT16(2200, minute.temperatureMax);
+     TEST_ASSERT_EQUAL_INT16(8500, minute.humidityAvg);
+     TEST_ASSERT_EQUAL_UINT16(800, minute.co2Min);
+     TEST_ASSERT_EQUAL_UINT16(900, minute.co2Avg);
+     TEST_ASSERT_EQUAL_UINT16(1000, minute.co2Max);
+ }
+
+ void test_history_ignores_readings_behind_the_open_bucket() {
+     SensorHistory history;
+     history.begin(16);
+     history.add(reading(START + 120, 20.0f, 80.0f, 800.0f));
+
+     // A clock still behind the restored buckets does not reopen them
+     TEST_ASSERT_FALSE(history.add(reading(START, 30.0f, 70.0f, 400.0f)));
+     TEST_ASSERT_TRUE(history.add(reading(START + 180, 20.0f, 80.0f, 800.0f)));
+     TEST_ASSERT_EQUAL_INT16(2000, history.newestRollup(HistoryTier::MINUTE).temperatureMax);
+ }
+
+ void test_history_restored_minutes_fold_into_coarser_tiers() {
+     SensorHistory history;
+     history.begin(16);
+
+     SensorRollup minute = {};
+     minute.count = 4;
+     minute.temperatureMin = minute.temperatureAvg = minute.temperatureMax = 2000;
+     minute.humidityMin = minute.humidityAvg = minute.humidityMax = 8000;
+     minute.co2Min = minute.co2Avg = minute.co2Max = 800;
+     for (uint32_t i = 0; i < 16; i++) {
+         minute.timestamp = START + i * 60;
+         history.restoreRollup(minute);
+     }
+
+     TEST_ASSERT_EQUAL_size_t(16, history.size(HistoryTier::MINUTE));
+     TEST_ASSERT_EQUAL_size_t(1, history.size(HistoryTier::QUARTER_HOUR));
+
+     const SensorRollup& quarter = history.newestRollup(HistoryTier::QUARTER_HOUR);
+     TEST_ASSERT_EQUAL_UINT32(START, quarter.timestamp);
+     TEST_ASSERT_EQUAL_UINT16(60, quarter.count);
+     TEST_ASSERT_EQUAL_INT16(2000, quarter.temperatureAvg);
+ }
+
+ void test_history_selects_finest_covering_tier() {
+     SensorHistory history;
+     history.begin(4);
+     for (uint32_t i = 0; i < 4; i++) {
+         history.add(reading(START + i * 5, 20.0f, 80.0f, 800.0f));
+     }
+
+     // The full raw ring spans 15 seconds
+     TEST_ASSERT_EQUAL(HistoryTier::RAW, history.selectTier(0));
+     TEST_ASSERT_EQUAL(HistoryTier::RAW, history.selectTier(15));
+     TEST_ASSERT_EQUAL(HistoryTier::MINUTE, history.selectTier(3600));
+     TEST_ASSERT_EQUAL(HistoryTier::QUARTER_HOUR, history.selectTier(6 * 3600));
+     TEST_ASSERT_EQUAL(HistoryTier::HOUR, history.selectTier(3 * 86400));
+     TEST_ASSERT_EQUAL_size_t(Constants::HISTORY_HOUR_POINTS, SensorHistory::rollupCapacity(HistoryTier::HOUR));
+ }
+
+ int main(int argc, char** argv) {
+     UNITY_BEGIN();
+     RUN_TEST(test_ring_buffer_keeps_order_until_full);
+     RUN_TEST(test_ring_buffer_overwrites_oldest);
+     RUN_TEST(test_ring_buffer_clear_and_reset);
+     RUN_TEST(test_history_closes_minute_buckets);
+     RUN_TEST(test_history_ignores_readings_behind_the_open_bucket);
+     RUN_TEST(test_history_restored_minutes_fold_into_coarser_tiers);
+     RUN_TEST(test_history_selects_finest_covering_tier);
+     return UNITY_END();
+ }
\ No newline at end of file
@@ -0,0 +1,110 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of the Home Assistant discovery payload builder
+ */
+
+ #include <unity.h>
+ #include <ArduinoJson.h>
+ #include "../../src/network/HomeAssistantDiscovery.h"
+
+ namespace {
+     std::vector<RelayConfig> makeRelays() {
+         std::vector<RelayConfig> relays(HomeAssistantDiscovery::RELAY_ENTITIES);
+         for (uint8_t i = 0; i < relays.size(); i++) {
+             relays[i].relayId = i + 1;
+             relays[i].name = String("Relay ") + String(i + 1);
+         }
+         return relays;
+     }
+
+     size_t drainPending(HomeAssistantDiscovery& discovery) {
+         size_t count = 0;
+         while (DiscoveryEntity* entity = discovery.nextPending()) {
+             entity->pending = false;
+             count++;
+         }
+         return count;
+     }
+ }
+
+ void setUp() {
+ }
+
+ void tearDown() {
+ }
+
+ void test_sensor_configs_are_built_on_configure() {
+     HomeAssistantDiscovery discovery;
+     discovery.configure("tent1", "mushroom/tent1/", "Tent");
+
+     DiscoveryEntity* entity = discovery.nextPending();
+     TEST_ASSERT_NOT_NULL(entity);
+     TEST_ASSERT_EQUAL_STRING("homeassistant/sensor/tent1/upper_temperature/config", entity->topic);
+
+     StaticJsonDocument<1024> doc;
+     TEST_ASSERT_FALSE(deserializeJson(doc, entity->payload));
+     TEST_ASSERT_EQUAL_STRING("mushroom/tent1/", doc["~"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("tent1_upper_temperature", doc["uniq_id"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("~sensors", doc["stat_t"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("temperature", doc["dev_cla"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("tent1", doc["dev"]["ids"][0].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("Tent", doc["dev"]["name"].as<const char*>());
+
+     TEST_ASSERT_EQUAL_size_t(HomeAssistantDiscovery::SENSOR_ENTITIES, drainPending(discovery));
+ }
+
+ void test_relay_configs_follow_name_and_visibility() {
+     HomeAssistantDiscovery discovery;
+     discovery.configure("tent1", "mushroom/tent1/", "Tent");
+     drainPending(discovery);
+
+     std::vector<RelayConfig> relays = makeRelays();
+     relays[1].visible = false;
+     discovery.updateRelays(relays);
+
+     DiscoveryEntity* entity = discovery.nextPending();
+     TEST_ASSERT_NOT_NULL(entity);
+     TEST_ASSERT_EQUAL_STRING("homeassistant/switch/tent1/relay1/config", entity->topic);
+
+     StaticJsonDocument<1024> doc;
+     TEST_ASSERT_FALSE(deserializeJson(doc, entity->payload));
+     TEST_ASSERT_EQUAL_STRING("Relay 1", doc["name"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("~command/relay/1", doc["cmd_t"].as<const char*>());
+     TEST_ASSERT_EQUAL_STRING("{{ 'ON' if value_json.relays[0].is_on else 'OFF' }}", doc["val_tpl"].as<const char*>());
+     entity->pending = false;
+
+     // A hidden relay publishes an empty config to remove it
+     entity = discovery.nextPending();
+     TEST_ASSERT_EQUAL_STRING("homeassistant/switch/tent1/relay2/config", entity->topic);
+     TEST_ASSERT_TRUE(entity->payload.isEmpty());
+
+     TEST_ASSERT_EQUAL_size_t(HomeAssistantDiscovery::RELAY_ENTITIES, drainPending(discovery));
+ }
+
+ void test_unchanged_inputs_are_not_rebuilt() {
+     HomeAssistantDiscovery discovery;
+     std::vector<RelayConfig> relays = makeRelays();
+     discovery.configure("tent1", "mushroom/tent1/", "Tent");
+     discovery.updateRelays(relays);
+     drainPending(discovery);
+
+     discovery.configure("tent1", "mushroom/tent1/", "Tent");
+     discovery.updateRelays(relays);
+     TEST_ASSERT_NULL(discovery.nextPending());
+
+     relays[4].name = "Humidifier";
+     discovery.updateRelays(relays);
+     TEST_ASSERT_EQUAL_size_t(1, drainPending(discovery));
+
+     // Republishing after a Home Assistant restart queues every built config
+     discovery.markAllPending();
+     TEST_ASSERT_EQUAL_size_t(HomeAssistantDiscovery::ENTITY_COUNT, drainPending(discovery));
+ }
+
+ int main(int argc, char** argv) {
+     UNITY_BEGIN();
+     RUN_TEST(test_sensor_configs_are_built_on_configure);
+     RUN_TEST(test_relay_configs_follow_name_and_visibility);
+     RUN_TEST(test_unchanged_inputs_are_not_rebuilt);
+     return UNITY_END();
+ }
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests of TimeRange and ScheduleTimeline
+ */
+
+ #include <unity.h>
+ #include <stdlib.h>
+ #include <time.h>
+ #include "../../src/components/ScheduleTimeline.h"
+
+ namespace {
+     const time_t MIDNIGHT = 1699920000;    // 2023-11-14 00:00 UTC
+
+     time_t at(uint8_t hour, uint8_t minute) {
+         return MIDNIGHT + hour * 3600 + minute * 60;
+     }
+ }
+
+ void setUp() {
+ }
+
+ void tearDown() {
+ }
+
+ void test_time_range_round_trips_through_string() {
+     TimeRange range(8, 5, 16, 30);
+     TEST_ASSERT_EQUAL_STRING("08:05-16:30", range.toString().c_str());
+
+     TimeRange parsed;
+     parsed.fromString("22:00-06:15");
+     TEST_ASSERT_EQUAL_UINT8(22, parsed.startHour);
+     TEST_ASSERT_EQUAL_UINT8(0, parsed.startMinute);
+     TEST_ASSERT_EQUAL_UINT8(6, parsed.endHour);
+     TEST_ASSERT_EQUAL_UINT8(15, parsed.endMinute);
+ }
+
+ void test_time_range_falls_back_to_all_day() {
+     TimeRange range(8, 0, 9, 0);
+     range.fromString("not a range");
+     TEST_ASSERT_EQUAL_STRING("00:00-23:59", range.toString().c_str());
+ }
+
+ void test_time_range_includes_both_ends() {
+     TimeRange range(8, 0, 16, 0);
+     TEST_ASSERT_FALSE(range.isInRange(7, 59));
+     TEST_ASSERT_TRUE(range.isInRange(8, 0));
+     TEST_ASSERT_TRUE(range.isInRange(16, 0));
+     TEST_ASSERT_FALSE(range.isInRange(16, 1));
+ }
+
+ void test_time_range_wraps_past_midnight() {
+     TimeRange range(22, 0, 6, 0);
+     TEST_ASSERT_TRUE(range.isInRange(23, 30));
+     TEST_ASSERT_TRUE(range.isInRange(0, 0));
+     TEST_ASSERT_TRUE(range.isInRange(6, 0));
+     TEST_ASSERT_FALSE(range.isInRange(12, 0));
+ }
+
+ void test_timeline_defaults_to_all_day_windows() {
+     ScheduleTimeline timeline;
+     TEST_ASSERT_TRUE(timeline.update(at(12, 0)));
+     for (uint8_t relayId = 1; relayId <= 8; relayId++) {
+         TEST_ASSERT_TRUE(timeline.isInWindow(relayId));
+     }
+     TEST_ASSERT_FALSE(timeline.isInWindow(0));
+     TEST_ASSERT_FALSE(timeline.isInWindow(9));
+ }
+
+ void test_timeline_follows_windows() {
+     TimeRange windows[2] = {TimeRange(8, 0, 16, 0), TimeRange(22, 0, 6, 0)};
+     ScheduleTimeline timeline;
+     timeline.build(windows, 2, CycleConfig(0, 0));
+
+     timeline.update(at(7, 59));
+     TEST_ASSERT_FALSE(timeline.isInWindow(1));
+     TEST_ASSERT_FALSE(timeline.isInWindow(2));
+
+     timeline.update(at(8, 0));
+     TEST_ASSERT_TRUE(timeline.isInWindow(1));
+     TEST_ASSERT_EQUAL(at(16, 1), timeline.getNextTransition());
+
+     timeline.update(at(23, 0));
+     TEST_ASSERT_FALSE(timeline.isInWindow(1));
+     TEST_ASSERT_TRUE(timeline.isInWindow(2));
+
+     timeline.update(at(3, 0));
+     TEST_ASSERT_TRUE(timeline.isInWindow(2));
+     TEST_ASSERT_EQUAL(at(6, 1), timeline.getNextTransition());
+ }
+
+ void test_timeline_reports_slot_changes_only() {
+     TimeRange windows[1] = {TimeRange(8, 0, 16, 0)};
+     ScheduleTimeline timeline;
+     timeline.build(windows, 1, CycleConfig(0, 0));
+
+     TEST_ASSERT_TRUE(timeline.update(at(9, 0)));
+     TEST_ASSERT_FALSE(timeline.update(at(9, 1)));
+     TEST_ASSERT_FALSE(timeline.update(at(16, 0)));
+     TEST_ASSERT_TRUE(timeline.update(at(16, 1)));
+
+     // A clock that jumps back is located again
+     TEST_ASSERT_TRUE(timeline.update(at(10, 0)));
+     TEST_ASSERT_TRUE(timeline.isInWindow(1));
+ }
+
+ void test_timeline_follows_cycle() {
+     ScheduleTimeline timeline;
+     timeline.build(nullptr, 0, CycleConfig(5, 60));
+
+     timeline.update(at(10, 0));
+     TEST_ASSERT_TRUE(timeline.isCycleOn());
+     TEST_ASSERT_EQUAL(at(10, 5), timeline.getNextTransition());
+
+     timeline.update(at(10, 5));
+     TEST_ASSERT_FALSE(timeline.isCycleOn());
+     TEST_ASSERT_EQUAL(at(11, 0), timeline.getNextTransition());
+ }
+
+ void test_timeline_preview_wraps_to_next_day() {
+     TimeRange windows[1] = {TimeRange(8, 0, 16, 0)};
+     ScheduleTimeline timeline;
+     timeline.build(windows, 1, CycleConfig(0, 0));
+
+     std::vector<ScheduleEvent> events;
+     timeline.preview(at(20, 0), events, 8);
+
+     // 16:01 (active), then 00:00 and 08:00 of the next day
+     TEST_ASSERT_EQUAL_size_t(3, events.size());
+     TEST_ASSERT_EQUAL(at(16, 1), events[0].time);
+     TEST_ASSERT_EQUAL_UINT8(0, events[0].windowMask);
+     TEST_ASSERT_EQUAL(MIDNIGHT + 86400, events[1].time);
+     TEST_ASSERT_EQUAL(MIDNIGHT + 86400 + 8 * 3600, events[2].time);
+     TEST_ASSERT_EQUAL_UINT8(1, events[2].windowMask);
+ }
+
+ int main(int argc, char** argv) {
+     // The timeline works in local time
+     setenv("TZ", "UTC0", 1);
+     tzset();
+
+     UNITY_BEGIN();
+     RUN_TEST(test_time_range_round_trips_through_string);
+     RUN_TEST(test_time_range_falls_back_to_all_day);
+     RUN_TEST(test_time_range_includes_both_ends);
+     RUN_TEST(test_time_range_wraps_past_midnight);
+     RUN_TEST(test_timeline_defaults_to_all_day_windows);
+     RUN_TEST(test_timeline_follows_windows);
+     RUN_TEST(test_timeline_reports_slot_changes_only);
+     RUN_TEST(test_timeline_follows_cycle);
+     RUN_TEST(test_timeline_preview_wraps_to_next_day);
+     return UNITY_END();
+ }
\ No newline at end of file